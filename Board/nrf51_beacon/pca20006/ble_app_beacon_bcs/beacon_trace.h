@@ -0,0 +1,44 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Trace messages of the beacon application.
+ *
+ * @details The format strings are only read by the host decoder, host/trace_decode.c, see
+ *          @ref app_trace. New messages must be added at the end, so the IDs of existing messages
+ *          do not change.
+ */
+
+#ifndef BEACON_TRACE_H__
+#define BEACON_TRACE_H__
+
+#include "app_trace.h"
+
+#define BEACON_TRACE_MSG_LIST(X)                                                            \
+    X(TRACE_MSG_BOOT,           "boot, reset reason %08X")                                   \
+    X(TRACE_MSG_ERROR,          "error %08X at line %u, file name at %08X")                  \
+    X(TRACE_MSG_MODE,           "beacon mode %u")                                            \
+    X(TRACE_MSG_CONNECTED,      "connected, handle %u")                                      \
+    X(TRACE_MSG_DISCONNECTED,   "disconnected, reason %02X")                                 \
+    X(TRACE_MSG_ADV_TIMEOUT,    "advertising timeout")                                       \
+    X(TRACE_MSG_MOTION,         "motion status %02X, activity %u mg")                        \
+    X(TRACE_MSG_MOTION_NO_SENSOR, "motion sensor not found")
+
+/**@brief Trace message IDs. */
+typedef enum
+{
+    BEACON_TRACE_MSG_LIST(APP_TRACE_ID_ENUM)
+    TRACE_MSG_COUNT
+} beacon_trace_msg_t;
+
+#endif // BEACON_TRACE_H__
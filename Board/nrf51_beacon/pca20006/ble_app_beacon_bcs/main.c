@@ -22,7 +22,9 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "ble_conn_params.h"
+#include "ble_conn_policy.h"
 #include "ble.h"
 #include "ble_hci.h"
 #include "ble_srv_common.h"
@@ -35,6 +37,16 @@
 #include "app_button.h"
 #include "pca20006.h"
 #include "ble_bcs.h"
+#include "crc16.h"
+#include "beacon_trace.h"
+#include "ble_error_log.h"
+#include "beacon_eid.h"
+#include "nrf_ecb.h"
+#ifdef BEACON_MOTION
+#include "twi_master.h"
+#include "mpu6050.h"
+#include "beacon_motion.h"
+#endif // BEACON_MOTION
 
 #define LED_R_MSK  (1UL << LED_RED)
 #define LED_G_MSK  (1UL << LED_GREEN)
@@ -42,7 +54,11 @@
 
 #define BOOTLOADER_BUTTON_PIN           BUTTON_0                                    /**< Button used to enter DFU mode. */
 #define CONFIG_MODE_BUTTON_PIN          BUTTON_1                                    /**< Button used to enter config mode. */
+#ifdef BEACON_MOTION
+#define APP_GPIOTE_MAX_USERS            3                                           /**< Buttons and the MPU6050 INT pin. */
+#else
 #define APP_GPIOTE_MAX_USERS            2  
+#endif // BEACON_MOTION
 #define BUTTON_DETECTION_DELAY          APP_TIMER_TICKS(50, APP_TIMER_PRESCALER)  
 
 #define CONFIG_MODE_LED_MSK            (LED_R_MSK | LED_G_MSK)                      /**< Blinking yellow when device is in config mode */
@@ -55,6 +71,10 @@
 #define APP_CFG_NON_CONN_ADV_TIMEOUT  0                                             /**< Time for which the device must be advertising in non-connectable mode (in seconds). 0 disables timeout. */
 //#define NON_CONNECTABLE_ADV_INTERVAL  MSEC_TO_UNITS(760, UNIT_0_625_MS)            /**< The advertising interval for non-connectable advertisement (852 ms). This value can vary between 100ms to 10.24s). */
 #define NON_CONNECTABLE_ADV_INTERVAL  MSEC_TO_UNITS(851, UNIT_0_625_MS) 
+#define APP_BEACON_ADV_INTERVAL_MS    851                               /**< Default beacon advertising interval in ms, as stored in the config record. */
+#define APP_BEACON_ADV_INTERVAL_MIN_MS 100                              /**< Lowest interval allowed for non-connectable advertising. */
+#define APP_BEACON_ADV_INTERVAL_MAX_MS 10240                            /**< Highest interval allowed for advertising. */
+#define APP_BEACON_TX_POWER           0                                 /**< Default radio TX power in dBm. */
 /**/
 
 // -----------------------------------
@@ -76,11 +96,17 @@
 #define NEXT_CONN_PARAMS_UPDATE_DELAY   APP_TIMER_TICKS(5000, APP_TIMER_PRESCALER)  /**< Time between each call to sd_ble_gap_conn_param_update after the first (5 seconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT    3                                           /**< Number of attempts before giving up the connection parameter negotiation. */
 
+#define BULK_MIN_CONN_INTERVAL          MSEC_TO_UNITS(15, UNIT_1_25_MS)             /**< Minimum connection interval while a configuration transfer is active (15 ms, the lowest iOS accepts). */
+#define BULK_MAX_CONN_INTERVAL          MSEC_TO_UNITS(30, UNIT_1_25_MS)             /**< Maximum connection interval while a configuration transfer is active (30 ms, at least 15 ms above the minimum for iOS). */
+#define IDLE_SLAVE_LATENCY              3                                           /**< Slave latency once the configuration transfer is over; 300 ms x (3 + 1) x 3 stays below the 4 s supervision timeout, as iOS requires. */
+#define CONN_POLICY_RELAX_DELAY         APP_TIMER_TICKS(2000, APP_TIMER_PRESCALER)  /**< Time from the end of a transfer until the idle connection parameters are requested (2 seconds). */
+#define CONN_POLICY_BULK_TIMEOUT        APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER) /**< Time after which a configuration transfer that was never committed stops holding the bulk parameters (30 seconds). */
+
 #define SEC_PARAM_TIMEOUT               30                                          /**< Timeout for Pairing Request or Security Request (in seconds). */
 #define SEC_PARAM_BOND                  0                                           /**< Perform bonding. */
-#define SEC_PARAM_MITM                  0                                           /**< Man In The Middle protection not required. */
+#define SEC_PARAM_MITM                  0                                           /**< Man In The Middle protection not required, only requested when the peer has the OOB key, see on_ble_evt(). */
 #define SEC_PARAM_IO_CAPABILITIES       BLE_GAP_IO_CAPS_NONE                        /**< No I/O capabilities. */
-#define SEC_PARAM_OOB                   0                                           /**< Out Of Band data not available. */
+#define SEC_PARAM_OOB                   0                                           /**< Out Of Band data only offered when the peer has it, see oob_key_init(). */
 #define SEC_PARAM_MIN_KEY_SIZE          7                                           /**< Minimum encryption key size. */
 #define SEC_PARAM_MAX_KEY_SIZE          16                                          /**< Maximum encryption key size. */
 
@@ -122,7 +148,11 @@
 #define DEAD_BEEF                     0xDEADBEEF                        /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
 #define APP_TIMER_PRESCALER         0                                   /**< RTC prescaler value used by app_timer */
-#define APP_TIMER_MAX_TIMERS        3                                   /**< One for each module + one for ble_conn_params + a few extra */
+#ifdef BEACON_MOTION
+#define APP_TIMER_MAX_TIMERS        8                                   /**< As below, + two for the motion sampling */
+#else
+#define APP_TIMER_MAX_TIMERS        6                                   /**< One for each module + one for ble_conn_params + one for ble_conn_policy + one for ble_error_log + one for the rotating identifiers */
+#endif // BEACON_MOTION
 #define APP_TIMER_OP_QUEUE_SIZE     3                                   /**< Maximum number of timeout handlers pending execution */
 
 #define SCHED_MAX_EVENT_DATA_SIZE       sizeof(app_timer_event_t)       /**< Maximum size of scheduler events. Note that scheduler BLE stack events do not contain any data, as the events are being pulled from the stack in the event handler. */
@@ -134,6 +164,54 @@
 #define LED_PWM_OFF_PAUSE_MS      4000                                  /**< LED Softblink PWM pause between blinks in ms. */
 
 #define MAGIC_FLASH_BYTE 0x42                                           /**< Magic byte used to recognise that flash has been written */
+#define OOB_KEY_LABEL    "BCS OOB PAIRING"                              /**< Block encrypted with the encryption root to get the OOB pairing key, 16 bytes with the terminating zero. */
+
+#define BEACON_ADV_PAYLOAD_LEN      (3 + 4 + APP_BEACON_INFO_LENGTH)    /**< Encoded beacon advertising data: flags AD structure + manufacturer specific AD structure. */
+
+#define EID_ROTATION_EXP_DEFAULT    10                                  /**< Default rotation exponent, a new identifier every 1024 s. */
+#define EID_TIMER_STEP_MAX_S        256                                 /**< Longest EID timer timeout in seconds, within the 512 s range of the RTC at prescaler 0. */
+#define EID_CHECKPOINT_INTERVAL_S   1024                                /**< Shortest interval at which the beacon time is saved to flash, also the longest with the default rotation exponent. */
+#define EID_CHECKPOINT_SIZE         (2 * sizeof(uint32_t))              /**< Size of a time checkpoint in the config page: the time and its complement. */
+#define EID_PAYLOAD_OFFSET          (3 + 4 + 2 + 12)                    /**< Offset of the identifier in the advertising payload: the last 4 bytes of the UUID, then major and minor. */
+
+#ifdef BEACON_MOTION
+#ifndef MOTION_INT_PIN
+#error "Define MOTION_INT_PIN as the pin wired to the MPU6050 INT output, provide twi_master_config.h, and build with twi_hw_master.c and mpu6050.c."
+#endif
+#define MOTION_MPU6050_ADDRESS      0x68                                /**< MPU6050 TWI address with AD0 low. */
+#define MOTION_THRESHOLD            20                                  /**< Motion interrupt threshold, 40 mg of high pass filtered acceleration. */
+#define MOTION_DURATION_MS          1                                   /**< Time the threshold must be exceeded; one sample at the wake up rate. */
+#define MOTION_WAKE_FREQ            MPU6050_WAKE_FREQ_5_HZ              /**< Accelerometer sample rate while waiting for motion. */
+#define MOTION_FIFO_SAMPLES         (MPU6050_FIFO_SIZE / MPU6050_ACCEL_SAMPLE_SIZE)  /**< Samples held by the MPU6050 FIFO. */
+#define MOTION_DRAIN_INTERVAL       APP_TIMER_TICKS(25600, APP_TIMER_PRESCALER)      /**< FIFO drain interval, 128 samples at 5 Hz, three quarters of the FIFO. */
+#define MOTION_ADV_INTERVAL_MS      100                                 /**< Advertising interval while the tag moves. */
+#define MOTION_BOOST_TIMEOUT        APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER)      /**< Time the fast interval is kept after the last motion (30 s). */
+#define MOTION_ACTIVITY_MIN_MG      30                                  /**< Activity of a drained window that counts as motion. */
+#endif // BEACON_MOTION
+
+#ifdef BOOT_PROFILING
+#define BOOT_PROFILE_TIMER          NRF_TIMER1                          /**< Timer used to time the boot sequence, free while the application runs. */
+#define BOOT_PROFILE_PRESCALER      9                                   /**< 16 MHz / 2^9, i.e. 32 us per tick; a 16 bit timer then covers 2 s. */
+
+typedef enum
+{
+    BOOT_MARK_SD_ENABLED,                                               /**< SoftDevice enabled, LFCLK running. */
+    BOOT_MARK_CONFIG_LOADED,                                            /**< Config record read and advertising payload ready. */
+    BOOT_MARK_ADV_STARTED,                                              /**< GATT table built and first advertisement scheduled. */
+    BOOT_MARK_INIT_DONE,                                                /**< Buttons and LEDs up, entering the main loop. */
+    BOOT_MARK_COUNT
+}boot_mark_t;
+
+static uint16_t m_boot_profile[BOOT_MARK_COUNT];                        /**< Boot timestamps in 32 us ticks since reset handler, inspect with a debugger. */
+
+#define BOOT_PROFILE_START()        boot_profile_start()
+#define BOOT_PROFILE_MARK(MARK)     boot_profile_mark(MARK)
+#define BOOT_PROFILE_STOP()         boot_profile_stop()
+#else
+#define BOOT_PROFILE_START()
+#define BOOT_PROFILE_MARK(MARK)
+#define BOOT_PROFILE_STOP()
+#endif // BOOT_PROFILING
 
 typedef enum
 {
@@ -148,6 +226,15 @@ typedef struct
     uint8_t  major_value[2];
     uint8_t  minor_value[2];
     uint8_t  measured_rssi;
+    int8_t   tx_power;
+    uint16_t adv_interval_ms;
+    uint8_t  adv_payload[BEACON_ADV_PAYLOAD_LEN];                       /**< Pre-encoded beacon advertising data matching the fields above. */
+    uint8_t  adv_payload_len;
+    uint16_t adv_payload_crc;                                           /**< CRC16 over the record up to this field, validates the cached payload. */
+    uint8_t  eid_identity_key[BEACON_EID_KEY_LEN];                      /**< Secret the rotating identifiers are derived from. */
+    uint8_t  eid_rotation_exp;                                          /**< The identifier changes every 2^eid_rotation_exp seconds. */
+    uint8_t  eid_enabled;                                               /**< 1 if rotating identifiers are advertised instead of the static ones. */
+    uint32_t eid_time;                                                  /**< Beacon time at the last checkpoint, in seconds. */
 }flash_db_layout_t;
 
 typedef union
@@ -157,6 +244,7 @@ typedef union
 }flash_db_t;
 
 flash_db_t           *p_flash_db;
+static flash_db_t           m_flash_db;                                 /**< RAM copy of the config record, source of every flash write. */
 static pstorage_handle_t    pstorage_block_id;
 
 static ble_gap_sec_params_t m_sec_params;                               /**< Security requirements for this application. */
@@ -167,6 +255,26 @@ static uint32_t        s_leds_bit_mask = 0;
 static app_timer_id_t  s_leds_timer_id;
 
 static ble_gap_adv_params_t m_adv_params;                               /**< Parameters to be passed to the stack when starting advertising. */
+static beacon_mode_t        m_beacon_mode = beacon_mode_normal;         /**< Mode the device is currently advertising in. */
+static bool                 m_is_advertising = false;                   /**< True while the SoftDevice is advertising. */
+static bool                 m_is_error_log_char_stale = false;          /**< True while the error log characteristic waits for crash records to reach flash. */
+static app_timer_id_t       m_eid_timer_id;                             /**< Advances the beacon time of the rotating identifiers. */
+static uint32_t             m_eid_time;                                 /**< Beacon time in seconds, at the start of the running EID timer. */
+static uint32_t             m_eid_step;                                 /**< Timeout of the running EID timer in seconds. */
+static uint8_t              m_eid_payload[2][BEACON_ADV_PAYLOAD_LEN];   /**< Advertised payload, and the precomputed payload of the next rotation period. */
+static uint8_t              m_eid_current;                              /**< Index of the advertised payload in m_eid_payload. */
+static uint32_t             m_eid_checkpoint[2];                        /**< Source of the last time checkpoint write, the time and its complement. */
+static uint16_t             m_eid_checkpoint_count;                     /**< Number of time checkpoints in the config page after the config record. */
+static uint8_t              m_oob_key[BLE_GAP_SEC_KEY_LEN];             /**< OOB pairing key of this beacon. */
+#ifdef BEACON_MOTION
+static bool                 m_motion_boost = false;                     /**< True while advertising at MOTION_ADV_INTERVAL_MS after motion. */
+static app_timer_id_t       m_motion_drain_timer_id;                    /**< Drains the MPU6050 FIFO before it overflows. */
+static app_timer_id_t       m_motion_boost_timer_id;                    /**< Ends the fast advertising interval. */
+static app_gpiote_user_id_t m_motion_gpiote_user_id;                    /**< GPIOTE user of the MPU6050 INT pin. */
+static uint8_t              m_motion_samples[MOTION_FIFO_SAMPLES * MPU6050_ACCEL_SAMPLE_SIZE];  /**< Samples drained from the FIFO. */
+static bool                 m_motion_draining = false;                  /**< True from the start of a drain until its samples are processed. */
+static bool                 m_motion_drain_pending = false;             /**< True if a drain was requested while one was running. */
+#endif // BEACON_MOTION
 static uint8_t clbeacon_info[APP_BEACON_INFO_LENGTH] =                /**< Information advertised by the beacon. */
 {
     APP_DEVICE_TYPE,     // Manufacturer specific information. Specifies the device type in this 
@@ -192,6 +300,10 @@ static uint8_t clbeacon_info[APP_BEACON_INFO_LENGTH] =                /**< Infor
 void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
 {
     nrf_gpio_pin_clear(ASSERT_LED_PIN_NO);
+    APP_TRACE3(TRACE_MSG_ERROR, error_code, line_num, p_file_name);
+    
+    // Kept in RAM over the reset, and copied to flash after it.
+    ble_error_log_ring_add(error_code, line_num, p_file_name, BLE_ERROR_LOG_RETURN_ADDRESS());
 
     // This call can be used for debug purposes during application development.
     // @note CAUTION: Activating this code will write the stack to flash on an error.
@@ -223,6 +335,35 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
     app_error_handler(DEAD_BEEF, line_num, p_file_name);
 }
 
+#ifdef BOOT_PROFILING
+/**@brief Function for starting the boot profiling timer.
+ */
+static void boot_profile_start(void)
+{
+    BOOT_PROFILE_TIMER->MODE      = TIMER_MODE_MODE_Timer;
+    BOOT_PROFILE_TIMER->BITMODE   = TIMER_BITMODE_BITMODE_16Bit;
+    BOOT_PROFILE_TIMER->PRESCALER = BOOT_PROFILE_PRESCALER;
+    BOOT_PROFILE_TIMER->TASKS_CLEAR = 1;
+    BOOT_PROFILE_TIMER->TASKS_START = 1;
+}
+
+/**@brief Function for recording the time at which a boot step completed.
+ */
+static void boot_profile_mark(boot_mark_t mark)
+{
+    BOOT_PROFILE_TIMER->TASKS_CAPTURE[0] = 1;
+    m_boot_profile[mark] = (uint16_t)BOOT_PROFILE_TIMER->CC[0];
+}
+
+/**@brief Function for stopping the boot profiling timer, so it does not keep the HFCLK running.
+ */
+static void boot_profile_stop(void)
+{
+    BOOT_PROFILE_TIMER->TASKS_STOP     = 1;
+    BOOT_PROFILE_TIMER->TASKS_SHUTDOWN = 1;
+}
+#endif // BOOT_PROFILING
+
 static void wait_for_flash_and_reset(void)
 {
     uint32_t err_code;
@@ -340,6 +481,77 @@ static void leds_init(void)
     APP_ERROR_CHECK(err_code);   
 }
 
+/**@brief Function for encoding the beacon advertising data into the config record.
+ *
+ * @details Produces the same flags and manufacturer specific AD structures as ble_advdata_set()
+ *          would, so that the payload can be stored next to the configuration and handed to the
+ *          stack at boot without being rebuilt.
+ *
+ * @param[in,out]   p_db   Config record to update the cached payload in.
+ */
+static void adv_payload_cache_build(flash_db_t * p_db)
+{
+    uint8_t * p_payload = p_db->data.adv_payload;
+    uint8_t   len       = 0;
+    
+    p_payload[len++] = 2;
+    p_payload[len++] = BLE_GAP_AD_TYPE_FLAGS;
+    p_payload[len++] = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+    
+    p_payload[len++] = 1 + sizeof(uint16_t) + APP_BEACON_INFO_LENGTH;
+    p_payload[len++] = BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    len             += uint16_encode(APP_COMPANY_IDENTIFIER, &p_payload[len]);
+    memcpy(&p_payload[len], clbeacon_info, APP_BEACON_INFO_LENGTH);
+    len             += APP_BEACON_INFO_LENGTH;
+    
+    p_db->data.adv_payload_len = len;
+    p_db->data.adv_payload_crc = crc16_compute((uint8_t *)p_db, 
+                                               offsetof(flash_db_layout_t, adv_payload_crc), 
+                                               NULL);
+}
+
+/**@brief Function for checking that the cached advertising payload belongs to the stored config.
+ */
+static bool adv_payload_cache_is_valid(const flash_db_t * p_db)
+{
+    return (p_db->data.adv_payload_len == BEACON_ADV_PAYLOAD_LEN) &&
+           (p_db->data.adv_payload_crc == crc16_compute((const uint8_t *)p_db,
+                                                        offsetof(flash_db_layout_t, adv_payload_crc),
+                                                        NULL));
+}
+
+/**@brief Function for passing the cached beacon advertising data to the stack.
+ *
+ * @details May be called while advertising; the SoftDevice swaps the payload atomically between
+ *          two advertising events. With rotating identifiers the payload of the current rotation
+ *          period is used.
+ */
+static void beacon_advdata_set(void)
+{
+    uint32_t        err_code;
+    const uint8_t * p_payload = m_flash_db.data.eid_enabled ? m_eid_payload[m_eid_current]
+                                                             : m_flash_db.data.adv_payload;
+    
+    err_code = sd_ble_gap_adv_data_set(p_payload, 
+                                       m_flash_db.data.adv_payload_len, 
+                                       NULL, 
+                                       0);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for getting the beacon advertising interval in ms, shortened while the tag moves.
+ */
+static uint16_t beacon_adv_interval_get(void)
+{
+#ifdef BEACON_MOTION
+    if (m_motion_boost)
+    {
+        return MIN(m_flash_db.data.adv_interval_ms, MOTION_ADV_INTERVAL_MS);
+    }
+#endif // BEACON_MOTION
+    return m_flash_db.data.adv_interval_ms;
+}
+
 /**@brief Function for initializing the Advertising functionality.
  *
  * @details Encodes the required advertising data and passes it to the stack.
@@ -349,25 +561,7 @@ static void advertising_init(beacon_mode_t mode)
 {
     if (mode == beacon_mode_normal)
     {
-        uint32_t        err_code;
-        ble_advdata_t   advdata;
-        uint8_t         flags = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
-        ble_advdata_manuf_data_t manuf_specific_data;
-        
-        manuf_specific_data.company_identifier = APP_COMPANY_IDENTIFIER;
-        manuf_specific_data.data.p_data        = (uint8_t *) clbeacon_info;
-        manuf_specific_data.data.size          = APP_BEACON_INFO_LENGTH;
-
-        // Build and set advertising data.
-        memset(&advdata, 0, sizeof(advdata));
-
-        advdata.name_type               = BLE_ADVDATA_NO_NAME;
-        advdata.flags.size              = sizeof(flags);
-        advdata.flags.p_data            = &flags;
-        advdata.p_manuf_specific_data   = &manuf_specific_data;
-
-        err_code = ble_advdata_set(&advdata, NULL);
-        APP_ERROR_CHECK(err_code);
+        beacon_advdata_set();
 
         // Initialize advertising parameters (used when starting advertising).
         memset(&m_adv_params, 0, sizeof(m_adv_params));
@@ -375,7 +569,7 @@ static void advertising_init(beacon_mode_t mode)
         m_adv_params.type        = BLE_GAP_ADV_TYPE_ADV_NONCONN_IND;
         m_adv_params.p_peer_addr = NULL;                             // Undirected advertisement.
         m_adv_params.fp          = BLE_GAP_ADV_FP_ANY;
-        m_adv_params.interval    = NON_CONNECTABLE_ADV_INTERVAL;
+        m_adv_params.interval    = MSEC_TO_UNITS(beacon_adv_interval_get(), UNIT_0_625_MS);
         m_adv_params.timeout     = APP_CFG_NON_CONN_ADV_TIMEOUT;
     }
     else if (mode == beacon_mode_config)
@@ -424,13 +618,76 @@ static void advertising_start(void)
 
     err_code = sd_ble_gap_adv_start(&m_adv_params);
     APP_ERROR_CHECK(err_code);
+    
+    m_is_advertising = true;
+}
+
+/**@brief Function for switching between config and beacon advertising at runtime.
+ *
+ * @details Stops any ongoing advertising, rebuilds the advertising data and parameters for the
+ *          requested mode and restarts advertising. This replaces the reset previously needed to
+ *          enter or leave config mode.
+ *
+ * @param[in]   mode   Mode to advertise in.
+ */
+static void beacon_mode_set(beacon_mode_t mode)
+{
+    uint32_t err_code;
+    
+    if (m_is_advertising)
+    {
+        err_code = sd_ble_gap_adv_stop();
+        APP_ERROR_CHECK(err_code);
+        m_is_advertising = false;
+    }
+    
+    // Turn off the LEDs of the previous mode before the softblink picks up the new mask.
+    NRF_GPIO->OUTSET = s_leds_bit_mask;
+    s_leds_bit_mask  = (mode == beacon_mode_config) ? CONFIG_MODE_LED_MSK : BEACON_MODE_LED_MSK;
+    
+    m_beacon_mode = mode;
+    APP_TRACE1(TRACE_MSG_MODE, mode);
+    advertising_init(mode);
+    advertising_start();
+}
+
+/**@brief Function for exposing the crash records stored in flash in the error log characteristic.
+ *
+ * @details Waits, if called while connected, until the crash records from before the reset have
+ *          been copied to flash.
+ */
+static void error_log_char_refresh(void)
+{
+    uint32_t               err_code;
+    ble_error_log_record_t records[BCS_ERROR_LOG_MAX_LEN / sizeof(ble_error_log_record_t)];
+    uint16_t               count;
+    
+    if (!m_is_error_log_char_stale || !ble_error_log_is_flushed() ||
+        (m_conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return;
+    }
+    m_is_error_log_char_stale = false;
+
+    count    = ble_error_log_records_get(records, sizeof(records) / sizeof(records[0]));
+    err_code = ble_bcs_error_log_update(&m_bcs,
+                                        (uint8_t *)records,
+                                        count * sizeof(ble_error_log_record_t));
+    APP_ERROR_CHECK(err_code);
 }
 
 /**@brief Function for the Power manager.
  */
 static void power_manage(void)
 {
-    uint32_t err_code = sd_app_evt_wait();
+    uint32_t err_code;
+    
+    // Idle: drain the trace and copy new crash records to flash before sleeping.
+    app_trace_process();
+    ble_error_log_process();
+    error_log_char_refresh();
+    
+    err_code = sd_app_evt_wait();
     APP_ERROR_CHECK(err_code);
 }
 
@@ -440,7 +697,10 @@ static void button_handler(uint8_t pin_no)
 {
     if(pin_no == CONFIG_MODE_BUTTON_PIN)
     { nrf_gpio_pin_set( LED1 );
-        wait_for_flash_and_reset();
+        if ((m_beacon_mode == beacon_mode_normal) && (m_conn_handle == BLE_CONN_HANDLE_INVALID))
+        {
+            beacon_mode_set(beacon_mode_config);
+        }
 		   
     }
     else if (pin_no == BOOTLOADER_BUTTON_PIN)
@@ -469,6 +729,274 @@ static void buttons_init(void)
     APP_BUTTON_INIT(buttons, sizeof(buttons) / sizeof(buttons[0]), BUTTON_DETECTION_DELAY, true);
 }
 
+/**@brief Function for copying the beacon fields of the config record into clbeacon_info.
+ */
+static void beacon_info_load(void)
+{
+    memcpy(&clbeacon_info[2], m_flash_db.data.beacon_uuid, 16);
+    clbeacon_info[18] = m_flash_db.data.major_value[0];
+    clbeacon_info[19] = m_flash_db.data.major_value[1];
+    clbeacon_info[20] = m_flash_db.data.minor_value[0];
+    clbeacon_info[21] = m_flash_db.data.minor_value[1];
+    clbeacon_info[22] = m_flash_db.data.measured_rssi;
+}
+
+/**@brief Function for writing the RAM copy of the config record to flash.
+ *
+ * @details Erasing the page also drops the time checkpoints, so the current beacon time goes into
+ *          the record.
+ */
+static void flash_db_store(void)
+{
+    uint32_t err_code;
+    
+    m_flash_db.data.eid_time = m_eid_time;
+    m_eid_checkpoint_count   = 0;
+    
+    err_code = pstorage_clear(&pstorage_block_id, sizeof(flash_db_t));
+    APP_ERROR_CHECK(err_code);
+    
+    err_code = pstorage_store(&pstorage_block_id, (uint8_t *)&m_flash_db, sizeof(flash_db_t), 0);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for getting the number of time checkpoints the config page can hold.
+ */
+static uint16_t eid_checkpoint_slots_get(void)
+{
+    return (uint16_t)((PSTORAGE_FLASH_PAGE_SIZE - sizeof(flash_db_t)) / EID_CHECKPOINT_SIZE);
+}
+
+/**@brief Function for finding the beacon time to resume from after a reset.
+ *
+ * @details The time checkpoints follow the config record in its flash page, see 
+ *          eid_checkpoint_store(). A checkpoint torn by a reset does not match its complement
+ *          and is passed over.
+ *
+ * @return      Time of the newest checkpoint, or the time in the config record if there is none.
+ */
+static uint32_t eid_checkpoint_load(void)
+{
+    const uint32_t * p_slot = (const uint32_t *)(p_flash_db + 1);
+    uint32_t         time   = m_flash_db.data.eid_time;
+    
+    m_eid_checkpoint_count = 0;
+    while ((m_eid_checkpoint_count < eid_checkpoint_slots_get()) && 
+           (p_slot[0] != PSTORAGE_FLASH_EMPTY_MASK))
+    {
+        if (p_slot[1] == ~p_slot[0])
+        {
+            time = p_slot[0];
+        }
+        p_slot += EID_CHECKPOINT_SIZE / sizeof(uint32_t);
+        m_eid_checkpoint_count++;
+    }
+    
+    return time;
+}
+
+/**@brief Function for saving the beacon time.
+ *
+ * @details Appended to the erased part of the config page, so the page is only erased, and the
+ *          config record rewritten with the time, once every checkpoint slot has been used.
+ */
+static void eid_checkpoint_store(void)
+{
+    uint32_t err_code;
+    
+    if (m_eid_checkpoint_count == eid_checkpoint_slots_get())
+    {
+        flash_db_store();
+        return;
+    }
+    
+    m_eid_checkpoint[0] = m_eid_time;
+    m_eid_checkpoint[1] = ~m_eid_time;
+    
+    err_code = pstorage_store(&pstorage_block_id, 
+                              (uint8_t *)m_eid_checkpoint, 
+                              EID_CHECKPOINT_SIZE, 
+                              sizeof(flash_db_t) + (m_eid_checkpoint_count * EID_CHECKPOINT_SIZE));
+    APP_ERROR_CHECK(err_code);
+    m_eid_checkpoint_count++;
+}
+
+/**@brief Function for AES-128 block encryption with the ECB driver.
+ */
+static uint32_t eid_aes(const uint8_t * p_key, const uint8_t * p_cleartext, uint8_t * p_ciphertext)
+{
+    nrf_ecb_job_t job;
+    
+    memset(&job, 0, sizeof(job));
+    job.p_key       = p_key;
+    job.mode        = NRF_ECB_MODE_ECB;
+    job.p_in        = p_cleartext;
+    job.p_out       = p_ciphertext;
+    job.block_count = 1;
+    
+    return nrf_ecb_job_run(&job) ? NRF_SUCCESS : NRF_ERROR_INVALID_STATE;
+}
+
+/**@brief Function for building the advertising payload of a rotation period.
+ *
+ * @details The cached payload with the identifier written over the end of the UUID and over
+ *          major and minor, see @ref beacon_eid.
+ *
+ * @param[in]   index   Buffer in m_eid_payload to build.
+ * @param[in]   time    Beacon time within the rotation period.
+ */
+static void eid_payload_build(uint8_t index, uint32_t time)
+{
+    uint32_t err_code;
+    
+    memcpy(m_eid_payload[index], m_flash_db.data.adv_payload, BEACON_ADV_PAYLOAD_LEN);
+    err_code = beacon_eid_compute(eid_aes,
+                                  m_flash_db.data.eid_identity_key,
+                                  m_flash_db.data.eid_rotation_exp,
+                                  time,
+                                  &m_eid_payload[index][EID_PAYLOAD_OFFSET]);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for building the payloads of the current and of the next rotation period.
+ */
+static void eid_payloads_build(void)
+{
+    uint32_t period = 1UL << m_flash_db.data.eid_rotation_exp;
+    
+    eid_payload_build(m_eid_current, m_eid_time);
+    eid_payload_build(m_eid_current ^ 1, (m_eid_time & ~(period - 1)) + period);
+}
+
+/**@brief Function for starting the EID timer towards the next rotation.
+ *
+ * @details Runs in steps of at most EID_TIMER_STEP_MAX_S, so that the beacon time lands exactly
+ *          on every rotation boundary, whatever time was provisioned.
+ */
+static void eid_timer_start(void)
+{
+    uint32_t err_code;
+    uint32_t period    = 1UL << m_flash_db.data.eid_rotation_exp;
+    uint32_t remaining = period - (m_eid_time & (period - 1));
+    
+    m_eid_step = MIN(remaining, EID_TIMER_STEP_MAX_S);
+    
+    err_code = app_timer_start(m_eid_timer_id, 
+                               APP_TIMER_TICKS(m_eid_step * 1000, APP_TIMER_PRESCALER), 
+                               NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for handling the EID timer timeout.
+ *
+ * @details Advances the beacon time. On a rotation boundary the precomputed payload is swapped in
+ *          right away, and only then is the payload of the following period computed. The time is
+ *          saved on the rotation boundaries, at most once per EID_CHECKPOINT_INTERVAL_S, so a
+ *          power cycle loses at most one rotation period, or EID_CHECKPOINT_INTERVAL_S for short
+ *          periods.
+ */
+static void eid_timer_handler(void * p_context)
+{
+    uint32_t period = 1UL << m_flash_db.data.eid_rotation_exp;
+    
+    m_eid_time += m_eid_step;
+    
+    if ((m_eid_time & (period - 1)) == 0)
+    {
+        m_eid_current ^= 1;
+        if ((m_beacon_mode == beacon_mode_normal) && m_is_advertising)
+        {
+            beacon_advdata_set();
+        }
+        eid_payload_build(m_eid_current ^ 1, m_eid_time + period);
+        
+        if ((m_eid_time & (EID_CHECKPOINT_INTERVAL_S - 1)) == 0)
+        {
+            eid_checkpoint_store();
+        }
+    }
+    
+    eid_timer_start();
+}
+
+/**@brief Function for (re)starting the rotating identifiers from the config record.
+ *
+ * @details Stops them if they are disabled. The advertising data is left to the caller.
+ */
+static void eid_start(void)
+{
+    uint32_t err_code;
+    
+    err_code = app_timer_stop(m_eid_timer_id);
+    APP_ERROR_CHECK(err_code);
+    
+    if (m_flash_db.data.eid_enabled)
+    {
+        eid_payloads_build();
+        eid_timer_start();
+    }
+}
+
+/**@brief Function for patching the advertised beacon information from the config record.
+ *
+ * @details If the device is advertising as a beacon the payload is swapped in place, otherwise
+ *          it takes effect when the device returns to beacon mode. The TX power is applied
+ *          right away.
+ */
+static void beacon_info_apply(void)
+{
+    uint32_t err_code;
+    
+    beacon_info_load();
+    adv_payload_cache_build(&m_flash_db);
+    if (m_flash_db.data.eid_enabled)
+    {
+        eid_payloads_build();
+    }
+    
+    err_code = sd_ble_gap_tx_power_set(m_flash_db.data.tx_power);
+    APP_ERROR_CHECK(err_code);
+    
+    if ((m_beacon_mode == beacon_mode_normal) && m_is_advertising)
+    {
+        beacon_advdata_set();
+    }
+}
+
+/**@brief Function for checking that a TX power value is supported by the radio.
+ */
+static bool tx_power_is_valid(int8_t tx_power)
+{
+    switch (tx_power)
+    {
+        case -40:
+        case -30:
+        case -20:
+        case -16:
+        case -12:
+        case -8:
+        case -4:
+        case 0:
+        case 4:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**@brief Function for checking the TX power and advertising interval of a written config blob.
+ *
+ * @details Passed to the beacon configuration service, which rejects a blob that fails the check
+ *          with an ATT error, before it is stored or applied.
+ */
+static bool beacon_config_is_valid(const uint8_t * p_config)
+{
+    uint16_t adv_interval_ms = uint16_decode(&p_config[BCS_CONFIG_INTERVAL_OFFSET]);
+    
+    return tx_power_is_valid((int8_t)p_config[BCS_CONFIG_TX_POWER_OFFSET]) &&
+           (adv_interval_ms >= APP_BEACON_ADV_INTERVAL_MIN_MS)             &&
+           (adv_interval_ms <= APP_BEACON_ADV_INTERVAL_MAX_MS);
+}
 
 /**@brief Function for handling the writes to the configuration characteristics of the beacon configuration service. 
  * @detail A pointer to this function is passed to the service in its init structure. 
@@ -477,40 +1005,94 @@ static void beacon_write_handler(ble_bcs_t * p_lbs, beacon_data_type_t type, uin
 {
     uint32_t err_code;
     
-    static flash_db_t tmp;
-    
-    memcpy(&tmp, p_flash_db, sizeof(flash_db_t));
-    
-    tmp.data.magic_byte = MAGIC_FLASH_BYTE;
+    m_flash_db.data.magic_byte = MAGIC_FLASH_BYTE;
     
     switch(type)
     {
         case beacon_maj_min_data:
-            tmp.data.major_value[0] = data[0];
-            tmp.data.major_value[1] = data[1];
-            tmp.data.minor_value[0] = data[2];
-            tmp.data.minor_value[1] = data[3];
+            m_flash_db.data.major_value[0] = data[0];
+            m_flash_db.data.major_value[1] = data[1];
+            m_flash_db.data.minor_value[0] = data[2];
+            m_flash_db.data.minor_value[1] = data[3];
             break;
         case beacon_measured_rssi_data:
-            tmp.data.measured_rssi = data[0];
+            m_flash_db.data.measured_rssi = data[0];
             break;
         case beacon_uuid_data:
             for(uint8_t i = 0; i < 16; i++)
             {
-                tmp.data.beacon_uuid[i] = data[i];
+                m_flash_db.data.beacon_uuid[i] = data[i];
+            }
+            break;
+        case beacon_config_data:
+            if (!beacon_config_is_valid(data))
+            {
+                // Already rejected by the service, never let it reach the SoftDevice.
+                return;
             }
+            memcpy(m_flash_db.data.beacon_uuid, &data[BCS_CONFIG_UUID_OFFSET], 16);
+            m_flash_db.data.major_value[0]  = data[BCS_CONFIG_MAJ_MIN_OFFSET];
+            m_flash_db.data.major_value[1]  = data[BCS_CONFIG_MAJ_MIN_OFFSET + 1];
+            m_flash_db.data.minor_value[0]  = data[BCS_CONFIG_MAJ_MIN_OFFSET + 2];
+            m_flash_db.data.minor_value[1]  = data[BCS_CONFIG_MAJ_MIN_OFFSET + 3];
+            m_flash_db.data.measured_rssi   = data[BCS_CONFIG_RSSI_OFFSET];
+            m_flash_db.data.tx_power        = (int8_t)data[BCS_CONFIG_TX_POWER_OFFSET];
+            m_flash_db.data.adv_interval_ms = uint16_decode(&data[BCS_CONFIG_INTERVAL_OFFSET]);
+            break;
+        case beacon_eid_data:
+            m_flash_db.data.eid_enabled = (data[BCS_EID_ROTATION_EXP_OFFSET] <= BEACON_EID_ROTATION_EXP_MAX);
+            if (m_flash_db.data.eid_enabled)
+            {
+                memcpy(m_flash_db.data.eid_identity_key, &data[BCS_EID_KEY_OFFSET], BEACON_EID_KEY_LEN);
+                m_flash_db.data.eid_rotation_exp = data[BCS_EID_ROTATION_EXP_OFFSET];
+            }
+            else
+            {
+                // Do not keep the secret of a disabled mode around.
+                memset(m_flash_db.data.eid_identity_key, 0, BEACON_EID_KEY_LEN);
+            }
+            // Stored with the config record below.
+            m_eid_time = uint32_decode(&data[BCS_EID_TIME_OFFSET]);
+            eid_start();
             break;
         default:
             break;
     }
     
-    err_code = pstorage_clear(&pstorage_block_id, sizeof(flash_db_t));
-    APP_ERROR_CHECK(err_code);
+    // Refresh the cached payload before storing, so it is persisted with the new config.
+    beacon_info_apply();
+    flash_db_store();
     
-    err_code = pstorage_store(&pstorage_block_id, (uint8_t *)&tmp, sizeof(flash_db_t), 0);
+    // Writes within a transaction only reach here on COMMIT, so every call ends a write and the
+    // link can relax.
+    err_code = ble_conn_policy_bulk_stop(BLE_CONN_POLICY_USER_CONFIG);
     APP_ERROR_CHECK(err_code);
 }
 
+/**@brief Function for replacing fields that were never written (records from older firmware) 
+ *        or that are out of range by their defaults.
+ */
+static void flash_db_sanitize(flash_db_t * p_db)
+{
+    if (!tx_power_is_valid(p_db->data.tx_power))
+    {
+        p_db->data.tx_power = APP_BEACON_TX_POWER;
+    }
+    if ((p_db->data.adv_interval_ms < APP_BEACON_ADV_INTERVAL_MIN_MS) ||
+        (p_db->data.adv_interval_ms > APP_BEACON_ADV_INTERVAL_MAX_MS))
+    {
+        p_db->data.adv_interval_ms = APP_BEACON_ADV_INTERVAL_MS;
+    }
+    if (p_db->data.eid_rotation_exp > BEACON_EID_ROTATION_EXP_MAX)
+    {
+        p_db->data.eid_rotation_exp = EID_ROTATION_EXP_DEFAULT;
+    }
+    if (p_db->data.eid_enabled != 1)
+    {
+        p_db->data.eid_enabled = 0;
+    }
+}
+
 /**@brief Function for the GAP initialization.
  *
  * @details This function shall be used to setup all the necessary GAP (Generic Access Profile) 
@@ -538,6 +1120,15 @@ static void gap_params_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+/**@brief Function for handling a Beacon Configuration Service error.
+ *
+ * @param[in]   nrf_error   Error code containing information about what went wrong.
+ */
+static void service_error_handler(uint32_t nrf_error)
+{
+    APP_ERROR_HANDLER(nrf_error);
+}
+
 /**@brief Function for initializing services that will be used by the application.
  */
 static void services_init(void)
@@ -546,12 +1137,34 @@ static void services_init(void)
     ble_bcs_init_t init;
     
     init.beacon_write_handler = beacon_write_handler;
+    init.config_check         = beacon_config_is_valid;
     init.p_beacon_info = clbeacon_info;
+    init.tx_power = m_flash_db.data.tx_power;
+    init.adv_interval_ms = m_flash_db.data.adv_interval_ms;
+    init.error_handler = service_error_handler;
     
     err_code = ble_bcs_init(&m_bcs, &init);
     APP_ERROR_CHECK(err_code);
 }
 
+/**@brief Function for deriving the OOB pairing key of this beacon.
+ *
+ * @details The key is AES-128(FICR ER, OOB_KEY_LABEL), ER read as little endian words. ER is random
+ *          per chip and can only be read through the debug port, so production reads it, computes
+ *          the key with host/eid_resolve.c, and hands it to the provisioning app, e.g. as a QR
+ *          code on the label. Pairing with it gives the MITM protection the identity key of the
+ *          rotating identifiers requires.
+ */
+static void oob_key_init(void)
+{
+    uint32_t er[4];
+    uint32_t err_code;
+    
+    memcpy(er, (const void *)NRF_FICR->ER, sizeof(er));
+    err_code = eid_aes((const uint8_t *)er, (const uint8_t *)OOB_KEY_LABEL, m_oob_key);
+    APP_ERROR_CHECK(err_code);
+}
+
 /**@brief Function for initializing security parameters.
  */
 static void sec_params_init(void)
@@ -619,6 +1232,246 @@ static void conn_params_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+/**@brief Function for initializing the Connection Parameters Policy module.
+ *
+ * @details A provisioning connection starts out with short intervals; once the configuration 
+ *          has been committed, or the transfer has timed out, the link relaxes to long intervals
+ *          with slave latency.
+ */
+static void conn_policy_init(void)
+{
+    uint32_t               err_code;
+    ble_conn_policy_init_t policy_init;
+    
+    memset(&policy_init, 0, sizeof(policy_init));
+    
+    policy_init.idle_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
+    policy_init.idle_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
+    policy_init.idle_conn_params.slave_latency     = IDLE_SLAVE_LATENCY;
+    policy_init.idle_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
+    
+    policy_init.bulk_conn_params.min_conn_interval = BULK_MIN_CONN_INTERVAL;
+    policy_init.bulk_conn_params.max_conn_interval = BULK_MAX_CONN_INTERVAL;
+    policy_init.bulk_conn_params.slave_latency     = 0;
+    policy_init.bulk_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
+    
+    policy_init.relax_delay   = CONN_POLICY_RELAX_DELAY;
+    policy_init.bulk_timeout  = CONN_POLICY_BULK_TIMEOUT;
+    policy_init.error_handler = conn_params_error_handler;
+    
+    err_code = ble_conn_policy_init(&policy_init);
+    APP_ERROR_CHECK(err_code);
+}
+
+#ifdef BEACON_MOTION
+/**@brief Function for switching the beacon between the configured and the fast advertising interval.
+ *
+ * @details If the device is advertising as a beacon, advertising is restarted with the new
+ *          interval, otherwise it takes effect when the device returns to beacon mode.
+ */
+static void motion_boost_set(bool boost)
+{
+    uint32_t err_code;
+    
+    if (boost == m_motion_boost)
+    {
+        return;
+    }
+    m_motion_boost = boost;
+    
+    if ((m_beacon_mode == beacon_mode_normal) && m_is_advertising)
+    {
+        err_code = sd_ble_gap_adv_stop();
+        APP_ERROR_CHECK(err_code);
+        
+        m_adv_params.interval = MSEC_TO_UNITS(beacon_adv_interval_get(), UNIT_0_625_MS);
+        err_code = sd_ble_gap_adv_start(&m_adv_params);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+/**@brief Result of a drain of the MPU6050 FIFO, passed from the TWI interrupt to the scheduler.
+ */
+typedef struct
+{
+    uint8_t  status;                                                    /**< INT_STATUS, 0 if it could not be read. */
+    uint16_t sample_count;                                              /**< Number of samples in m_motion_samples. */
+} motion_drain_evt_t;
+
+static void motion_drain_start(void * p_event_data, uint16_t event_size);
+
+/**@brief Function for processing the drained samples, from the scheduler.
+ *
+ * @details A motion interrupt, or enough activity in the drained samples, (re)starts the fast
+ *          advertising interval for MOTION_BOOST_TIMEOUT. Reading the status releases the latched
+ *          INT pin; if it fails the pin stays high and the next drain timeout retries.
+ */
+static void motion_process(void * p_event_data, uint16_t event_size)
+{
+    uint32_t                   err_code;
+    const motion_drain_evt_t * p_evt = (const motion_drain_evt_t *)p_event_data;
+    beacon_motion_features_t   features;
+    
+    UNUSED_PARAMETER(event_size);
+    
+    beacon_motion_features_compute(m_motion_samples, p_evt->sample_count, &features);
+    APP_TRACE2(TRACE_MSG_MOTION, p_evt->status, features.activity_mg);
+    
+    if (((p_evt->status & MPU6050_INT_MOTION) != 0) || (features.activity_mg >= MOTION_ACTIVITY_MIN_MG))
+    {
+        err_code = app_timer_stop(m_motion_boost_timer_id);
+        APP_ERROR_CHECK(err_code);
+        err_code = app_timer_start(m_motion_boost_timer_id, MOTION_BOOST_TIMEOUT, NULL);
+        APP_ERROR_CHECK(err_code);
+        
+        motion_boost_set(true);
+    }
+    
+    // The samples are used, the buffer is free for the next drain.
+    m_motion_draining = false;
+    if (m_motion_drain_pending)
+    {
+        m_motion_drain_pending = false;
+        motion_drain_start(NULL, 0);
+    }
+}
+
+/**@brief Function for handling the end of a drain, in the TWI interrupt.
+ */
+static void motion_drain_handler(bool success, uint8_t int_status, uint16_t sample_count)
+{
+    uint32_t           err_code;
+    motion_drain_evt_t evt;
+    
+    UNUSED_PARAMETER(success);
+    
+    evt.status       = int_status;
+    evt.sample_count = sample_count;
+    
+    err_code = app_sched_event_put(&evt, sizeof(evt), motion_process);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for reading the MPU6050 interrupt status and draining its FIFO, from the scheduler.
+ *
+ * @details The reads run from the TWI interrupt while the CPU sleeps, and the samples are
+ *          processed when they are done. A drain requested meanwhile follows that one.
+ */
+static void motion_drain_start(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+    
+    if (m_motion_draining)
+    {
+        m_motion_drain_pending = true;
+        return;
+    }
+    
+    // If the bus is stuck, the INT pin stays high and the next drain timeout retries.
+    m_motion_draining = mpu6050_fifo_drain_start(m_motion_samples,
+                                                 MOTION_FIFO_SAMPLES,
+                                                 motion_drain_handler);
+}
+
+/**@brief Function for going back to the configured advertising interval, from the scheduler.
+ */
+static void motion_boost_end(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+    
+    motion_boost_set(false);
+}
+
+/**@brief Function for handling a rising edge on the MPU6050 INT pin.
+ *
+ * @details The drain is started from the main loop, as it may first have to recover the TWI bus.
+ */
+static void motion_int_handler(uint32_t event_pins_low_to_high, uint32_t event_pins_high_to_low)
+{
+    uint32_t err_code;
+    
+    UNUSED_PARAMETER(event_pins_low_to_high);
+    UNUSED_PARAMETER(event_pins_high_to_low);
+    
+    err_code = app_sched_event_put(NULL, 0, motion_drain_start);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for handling the FIFO drain timer timeout.
+ *
+ * @details The MPU6050 has no FIFO watermark interrupt, the timer stands in for it.
+ */
+static void motion_drain_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+    
+    UNUSED_PARAMETER(p_context);
+    
+    err_code = app_sched_event_put(NULL, 0, motion_drain_start);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for handling the end of the fast advertising interval.
+ */
+static void motion_boost_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+    
+    UNUSED_PARAMETER(p_context);
+    
+    err_code = app_sched_event_put(NULL, 0, motion_boost_end);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for putting the MPU6050 in motion mode and waiting for its interrupts.
+ *
+ * @details Without a working sensor the beacon keeps advertising at the configured interval.
+ */
+static void motion_init(void)
+{
+    uint32_t                err_code;
+    mpu6050_motion_config_t config;
+    
+    config.motion_threshold   = MOTION_THRESHOLD;
+    config.motion_duration_ms = MOTION_DURATION_MS;
+    config.wake_freq          = MOTION_WAKE_FREQ;
+    
+    if (!twi_master_init() ||
+        !mpu6050_init(MOTION_MPU6050_ADDRESS) ||
+        !mpu6050_motion_mode_enable(&config))
+    {
+        APP_TRACE0(TRACE_MSG_MOTION_NO_SENSOR);
+        return;
+    }
+    
+    err_code = app_timer_create(&m_motion_drain_timer_id,
+                                APP_TIMER_MODE_REPEATED,
+                                motion_drain_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+    
+    err_code = app_timer_create(&m_motion_boost_timer_id,
+                                APP_TIMER_MODE_SINGLE_SHOT,
+                                motion_boost_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+    
+    nrf_gpio_cfg_input(MOTION_INT_PIN, NRF_GPIO_PIN_NOPULL);
+    err_code = app_gpiote_user_register(&m_motion_gpiote_user_id,
+                                        1UL << MOTION_INT_PIN,
+                                        0,
+                                        motion_int_handler);
+    APP_ERROR_CHECK(err_code);
+    
+    err_code = app_gpiote_user_enable(m_motion_gpiote_user_id);
+    APP_ERROR_CHECK(err_code);
+    
+    err_code = app_timer_start(m_motion_drain_timer_id, MOTION_DRAIN_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+#endif // BEACON_MOTION
+
+
 /**@brief Function for handling the Application's BLE Stack events.
  *
  * @param[in]   p_ble_evt   Bluetooth stack event.
@@ -628,28 +1481,67 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
     uint32_t                         err_code = NRF_SUCCESS;
     static ble_gap_evt_auth_status_t m_auth_status;
     ble_gap_enc_info_t *             p_enc_info;
+    ble_gap_sec_params_t             sec_params;
     
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_CONNECTED:
             m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            m_is_advertising = false;
+            APP_TRACE1(TRACE_MSG_CONNECTED, m_conn_handle);
+            // Done here or, if a copy of crash records to flash is pending, once it has completed.
+            m_is_error_log_char_stale = true;
+            error_log_char_refresh();
+            // Only provisioning apps connect, so expect a configuration transfer.
+            err_code = ble_conn_policy_bulk_start(BLE_CONN_POLICY_USER_CONFIG);
             break;
             
         case BLE_GAP_EVT_DISCONNECTED:
+            APP_TRACE1(TRACE_MSG_DISCONNECTED, p_ble_evt->evt.gap_evt.params.disconnected.reason);
             m_conn_handle = BLE_CONN_HANDLE_INVALID;
-            wait_for_flash_and_reset();
+            // Go back to beacon advertising with the new configuration, no reset needed.
+            beacon_mode_set(beacon_mode_normal);
             break;
             
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
+            // Just Works by default, the OOB key is only used when the peer has it. Only the 
+            // identity key characteristic needs the resulting MITM protection.
+            sec_params = m_sec_params;
+            if (p_ble_evt->evt.gap_evt.params.sec_params_request.peer_params.oob)
+            {
+                sec_params.oob  = 1;
+                sec_params.mitm = 1;
+            }
             err_code = sd_ble_gap_sec_params_reply(m_conn_handle, 
                                                    BLE_GAP_SEC_STATUS_SUCCESS, 
-                                                   &m_sec_params);
+                                                   &sec_params);
+            break;
+            
+        case BLE_EVT_USER_MEM_REQUEST:
+            // Queued writes are kept by the SoftDevice, the service checks them on execute.
+            err_code = sd_ble_user_mem_reply(m_conn_handle, NULL);
             break;
             
         case BLE_GATTS_EVT_SYS_ATTR_MISSING:
             err_code = sd_ble_gatts_sys_attr_set(m_conn_handle, NULL, 0);
             break;
 
+        case BLE_GAP_EVT_AUTH_KEY_REQUEST:
+            if (p_ble_evt->evt.gap_evt.params.auth_key_request.key_type == BLE_GAP_AUTH_KEY_TYPE_OOB)
+            {
+                err_code = sd_ble_gap_auth_key_reply(m_conn_handle, 
+                                                     BLE_GAP_AUTH_KEY_TYPE_OOB, 
+                                                     m_oob_key);
+            }
+            else
+            {
+                // Without I/O capabilities there is no passkey to give.
+                err_code = sd_ble_gap_auth_key_reply(m_conn_handle, 
+                                                     BLE_GAP_AUTH_KEY_TYPE_NONE, 
+                                                     NULL);
+            }
+            break;
+            
         case BLE_GAP_EVT_AUTH_STATUS:
             m_auth_status = p_ble_evt->evt.gap_evt.params.auth_status;
             break;
@@ -670,7 +1562,9 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
         case BLE_GAP_EVT_TIMEOUT:
             if (p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_ADVERTISEMENT)
             { 
-                wait_for_flash_and_reset();
+                APP_TRACE0(TRACE_MSG_ADV_TIMEOUT);
+                m_is_advertising = false;
+                beacon_mode_set(beacon_mode_normal);
             }
             break;
 
@@ -692,6 +1586,7 @@ static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
 {
     on_ble_evt(p_ble_evt);
     ble_conn_params_on_ble_evt(p_ble_evt);
+    ble_conn_policy_on_ble_evt(p_ble_evt);
     ble_bcs_on_ble_evt(&m_bcs, p_ble_evt);
 }
 
@@ -738,26 +1633,35 @@ int main(void)
 		//bool config_mode = true;
     pstorage_module_param_t pstorage_param;
     
-    // Initialize.
+    BOOT_PROFILE_START();
+    
+    // Initialize what the first advertisement needs; peripherals follow after it.
     APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
     APP_TIMER_INIT(APP_TIMER_PRESCALER, APP_TIMER_MAX_TIMERS, APP_TIMER_OP_QUEUE_SIZE, false);
-    APP_GPIOTE_INIT(APP_GPIOTE_MAX_USERS);
-    buttons_init();    
-    leds_init();
-
-    err_code = app_button_enable();
-    APP_ERROR_CHECK(err_code);
     
-    err_code = app_button_is_pushed(CONFIG_MODE_BUTTON_PIN, &config_mode);//ֶл㲥
-    APP_ERROR_CHECK(err_code);    
+    // No UART on this board, the trace is kept in RAM for reading out with a debugger.
+    app_trace_init(NULL);
+    APP_TRACE1(TRACE_MSG_BOOT, NRF_POWER->RESETREAS);
+    
+    // Sample the config button directly, app_button is not up yet.
+    nrf_gpio_cfg_input(CONFIG_MODE_BUTTON_PIN, BUTTON_PULL);
+    config_mode = (nrf_gpio_pin_read(CONFIG_MODE_BUTTON_PIN) == 0);//ֶл㲥
     
     ble_stack_init();
+    BOOT_PROFILE_MARK(BOOT_MARK_SD_ENABLED);
+    
+    if (!nrf_ecb_init())
+    {
+        APP_ERROR_CHECK(NRF_ERROR_INTERNAL);
+    }
+    oob_key_init();
     
     err_code = pstorage_init();
     APP_ERROR_CHECK(err_code);
     
     pstorage_param.cb = pstorage_ntf_cb;
-    pstorage_param.block_size = sizeof(flash_db_t);
+    // The whole page, the time checkpoints follow the config record.
+    pstorage_param.block_size = PSTORAGE_FLASH_PAGE_SIZE;
     pstorage_param.block_count = 1;
     
     err_code = pstorage_register(&pstorage_param, &pstorage_block_id);
@@ -765,10 +1669,14 @@ int main(void)
     
     p_flash_db = (flash_db_t *)pstorage_block_id.block_id;
     
+    err_code = ble_error_log_init();
+    APP_ERROR_CHECK(err_code);
+    
     if (p_flash_db->data.magic_byte != MAGIC_FLASH_BYTE)
     {
         flash_db_t tmp;
         
+        memset(&tmp, 0, sizeof(tmp));
         tmp.data.magic_byte = MAGIC_FLASH_BYTE;
         memcpy(tmp.data.beacon_uuid, &clbeacon_info[2], 16);
         tmp.data.major_value[0] = clbeacon_info[18] = 0x00;
@@ -778,43 +1686,67 @@ int main(void)
 				tmp.data.minor_value[1] = clbeacon_info[21] = 0x05;//(uint8_t)NRF_FICR->ER[3];
         //tmp.data.minor_value[1] = clbeacon_info[21] = (uint8_t)NRF_FICR->ER[0];
         tmp.data.measured_rssi  = clbeacon_info[22] = APP_MEASURED_RSSI;//beacon??uuid,major,minor??
+        tmp.data.tx_power        = APP_BEACON_TX_POWER;
+        tmp.data.adv_interval_ms = APP_BEACON_ADV_INTERVAL_MS;
+        tmp.data.eid_rotation_exp = EID_ROTATION_EXP_DEFAULT;
         
-        err_code = pstorage_clear(&pstorage_block_id, sizeof(flash_db_t));
-        APP_ERROR_CHECK(err_code);
-        
-        err_code = pstorage_store(&pstorage_block_id, (uint8_t *)&tmp, sizeof(flash_db_t), 0);
-        APP_ERROR_CHECK(err_code);
-        
-        err_code = pstorage_access_wait();
-        APP_ERROR_CHECK(err_code);
+        m_flash_db = tmp;
     }
     else
     {
-        memcpy(&clbeacon_info[2], p_flash_db->data.beacon_uuid, 16);
-        clbeacon_info[18] = p_flash_db->data.major_value[0];
-        clbeacon_info[19] = p_flash_db->data.major_value[1];
-        clbeacon_info[20] = p_flash_db->data.minor_value[0];
-        clbeacon_info[21] = p_flash_db->data.minor_value[1];;
-        clbeacon_info[22] = p_flash_db->data.measured_rssi;
+        m_flash_db = *p_flash_db;
+        flash_db_sanitize(&m_flash_db);
     }
     
-    if(config_mode)
-    {
-        gap_params_init();
-        services_init();
-        advertising_init(beacon_mode_config);
-        conn_params_init();
-        sec_params_init();
-        s_leds_bit_mask |= CONFIG_MODE_LED_MSK;
-    }
-    else
+    // Resume the rotating identifiers from the last checkpoint, before anything stores the record.
+    m_eid_time = eid_checkpoint_load();
+    
+    beacon_info_load();
+    
+    if (!adv_payload_cache_is_valid(&m_flash_db))
     {
-        advertising_init(beacon_mode_normal);
-        s_leds_bit_mask |= BEACON_MODE_LED_MSK;
+        // First boot or config written by older firmware: encode once and persist, so the
+        // next boot can hand the payload straight to the stack.
+        adv_payload_cache_build(&m_flash_db);
+        flash_db_store();
+        
+        err_code = pstorage_access_wait();
+        APP_ERROR_CHECK(err_code);
     }
     
+    err_code = app_timer_create(&m_eid_timer_id, APP_TIMER_MODE_SINGLE_SHOT, eid_timer_handler);
+    APP_ERROR_CHECK(err_code);
+    eid_start();
+    BOOT_PROFILE_MARK(BOOT_MARK_CONFIG_LOADED);
+    
+    err_code = sd_ble_gap_tx_power_set(m_flash_db.data.tx_power);
+    APP_ERROR_CHECK(err_code);
+    
+    // The GATT table is fixed once built, so the config service is always present; it is only
+    // reachable while advertising in config mode. Every module that receives BLE events is
+    // initialized before the first advertisement.
+    gap_params_init();
+    services_init();
+    conn_params_init();
+    conn_policy_init();
+    sec_params_init();
+    
     // Start execution.
-    advertising_start();
+    beacon_mode_set(config_mode ? beacon_mode_config : beacon_mode_normal);
+    BOOT_PROFILE_MARK(BOOT_MARK_ADV_STARTED);
+    
+    // Modules below are not needed for the first advertisement.
+    APP_GPIOTE_INIT(APP_GPIOTE_MAX_USERS);
+    buttons_init();    
+    leds_init();
+#ifdef BEACON_MOTION
+    motion_init();
+#endif // BEACON_MOTION
+
+    err_code = app_button_enable();
+    APP_ERROR_CHECK(err_code);
+    BOOT_PROFILE_MARK(BOOT_MARK_INIT_DONE);
+    BOOT_PROFILE_STOP();
 
     // Enter main loop.
     for (;;)
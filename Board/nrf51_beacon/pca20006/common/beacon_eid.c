@@ -0,0 +1,118 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "beacon_eid.h"
+#include <string.h>
+#include "nrf_error.h"
+
+#define BLOCK_LEN               16                                      /**< Length of an AES block. */
+#define PAD_LEN                 11                                      /**< Number of zero bytes at the start of both blocks. */
+
+
+/**@brief Function for encoding a 32 bit value big endian. */
+static void uint32_big_encode(uint32_t value, uint8_t * p_encoded)
+{
+    p_encoded[0] = (uint8_t)(value >> 24);
+    p_encoded[1] = (uint8_t)(value >> 16);
+    p_encoded[2] = (uint8_t)(value >> 8);
+    p_encoded[3] = (uint8_t)value;
+}
+
+
+uint32_t beacon_eid_compute(beacon_eid_aes_t aes,
+                            const uint8_t *  p_identity_key,
+                            uint8_t          rotation_exp,
+                            uint32_t         time,
+                            uint8_t *        p_eid)
+{
+    uint32_t err_code;
+    uint8_t  block[BLOCK_LEN];
+    uint8_t  temporary_key[BLOCK_LEN];
+    uint8_t  result[BLOCK_LEN];
+
+    // Temporary key, changes every 2^16 seconds.
+    memset(block, 0, sizeof(block));
+    block[PAD_LEN]     = 0xFF;
+    block[PAD_LEN + 3] = (uint8_t)(time >> 24);
+    block[PAD_LEN + 4] = (uint8_t)(time >> 16);
+
+    err_code = aes(p_identity_key, block, temporary_key);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Identifier, changes every rotation period.
+    memset(block, 0, sizeof(block));
+    block[PAD_LEN] = rotation_exp;
+    uint32_big_encode(time & ~((1UL << rotation_exp) - 1), &block[PAD_LEN + 1]);
+
+    err_code = aes(temporary_key, block, result);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    memcpy(p_eid, result, BEACON_EID_LEN);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for checking if an identifier belongs to a rotation period.
+ *
+ * @return      True if it does, false if it does not or the encryption failed.
+ */
+static bool eid_matches(beacon_eid_aes_t aes,
+                        const uint8_t *  p_identity_key,
+                        uint8_t          rotation_exp,
+                        const uint8_t *  p_eid,
+                        uint32_t         time)
+{
+    uint8_t eid[BEACON_EID_LEN];
+
+    return (beacon_eid_compute(aes, p_identity_key, rotation_exp, time, eid) == NRF_SUCCESS) &&
+           (memcmp(eid, p_eid, BEACON_EID_LEN) == 0);
+}
+
+
+bool beacon_eid_resolve(beacon_eid_aes_t aes,
+                        const uint8_t *  p_identity_key,
+                        uint8_t          rotation_exp,
+                        const uint8_t *  p_eid,
+                        uint32_t         time_hint,
+                        uint32_t         window,
+                        uint32_t *       p_time)
+{
+    uint32_t period = 1UL << rotation_exp;
+    uint32_t start  = time_hint & ~(period - 1);
+    uint32_t i;
+
+    for (i = 0; i <= window; i++)
+    {
+        uint32_t offset = i * period;
+
+        // Later periods first, the beacon time only moves forward.
+        if (eid_matches(aes, p_identity_key, rotation_exp, p_eid, start + offset))
+        {
+            *p_time = start + offset;
+            return true;
+        }
+        if ((i > 0) && (offset <= start) &&
+            eid_matches(aes, p_identity_key, rotation_exp, p_eid, start - offset))
+        {
+            *p_time = start - offset;
+            return true;
+        }
+    }
+
+    return false;
+}
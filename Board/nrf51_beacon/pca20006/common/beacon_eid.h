@@ -0,0 +1,99 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup beacon_eid Rotating Beacon Identifiers
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Ephemeral identifiers derived from a provisioned key and the beacon time.
+ *
+ * @details The identifier follows the Eddystone-EID derivation. The beacon time is a 32 bit count
+ *          of seconds, and the identifier changes every 2^rotation_exp seconds:
+ *          - The temporary key is AES-128(identity key, 11 x 0x00, 0xFF, 0x00, 0x00, time[31:16]).
+ *          - The identifier is the first 8 bytes of
+ *            AES-128(temporary key, 11 x 0x00, rotation_exp, time with the lowest rotation_exp
+ *            bits cleared).
+ *          Multi-byte values are big endian.
+ *
+ *          Only the holder of the identity key can tell which beacon sent an identifier, so the
+ *          beacon can neither be tracked nor cloned beyond the current rotation period.
+ *
+ *          The module does not depend on the nRF51, the AES block cipher is passed in. The same
+ *          code therefore resolves identifiers on the host, see host/eid_resolve.c.
+ */
+
+#ifndef BEACON_EID_H__
+#define BEACON_EID_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BEACON_EID_KEY_LEN              16                              /**< Length of the identity key. */
+#define BEACON_EID_LEN                  8                               /**< Length of an identifier. */
+#define BEACON_EID_ROTATION_EXP_MAX     15                              /**< Largest rotation exponent, a period of about 9 hours. */
+
+/**@brief AES-128 block encryption.
+ *
+ * @param[in]   p_key          16 byte key.
+ * @param[in]   p_cleartext    16 byte block to encrypt.
+ * @param[out]  p_ciphertext   16 byte result.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+typedef uint32_t (*beacon_eid_aes_t)(const uint8_t * p_key,
+                                     const uint8_t * p_cleartext,
+                                     uint8_t *       p_ciphertext);
+
+/**@brief Function for computing the identifier of a beacon at a time.
+ *
+ * @param[in]   aes              AES-128 block encryption.
+ * @param[in]   p_identity_key   Identity key of the beacon, BEACON_EID_KEY_LEN bytes.
+ * @param[in]   rotation_exp     Rotation exponent, at most BEACON_EID_ROTATION_EXP_MAX.
+ * @param[in]   time             Beacon time in seconds.
+ * @param[out]  p_eid            Identifier, BEACON_EID_LEN bytes.
+ *
+ * @return      NRF_SUCCESS on success, otherwise the error code of the block encryption.
+ */
+uint32_t beacon_eid_compute(beacon_eid_aes_t aes,
+                            const uint8_t *  p_identity_key,
+                            uint8_t          rotation_exp,
+                            uint32_t         time,
+                            uint8_t *        p_eid);
+
+/**@brief Function for finding the time an identifier was computed for.
+ *
+ * @details Tries the rotation periods around an expected time, nearest first. The window covers
+ *          the clock drift of the beacon and the time lost by a power cycle, see the beacon
+ *          application.
+ *
+ * @param[in]   aes              AES-128 block encryption.
+ * @param[in]   p_identity_key   Identity key of the beacon, BEACON_EID_KEY_LEN bytes.
+ * @param[in]   rotation_exp     Rotation exponent of the beacon.
+ * @param[in]   p_eid            Observed identifier, BEACON_EID_LEN bytes.
+ * @param[in]   time_hint        Expected beacon time, e.g. from the previous resolution.
+ * @param[in]   window           Number of rotation periods to try on each side of time_hint.
+ * @param[out]  p_time           Start of the rotation period of the identifier.
+ *
+ * @return      True if the identifier belongs to the beacon, false otherwise.
+ */
+bool beacon_eid_resolve(beacon_eid_aes_t aes,
+                        const uint8_t *  p_identity_key,
+                        uint8_t          rotation_exp,
+                        const uint8_t *  p_eid,
+                        uint32_t         time_hint,
+                        uint32_t         window,
+                        uint32_t *       p_time);
+
+#endif // BEACON_EID_H__
+
+/** @} */
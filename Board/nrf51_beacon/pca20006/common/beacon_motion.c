@@ -0,0 +1,100 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "beacon_motion.h"
+#include <string.h>
+
+
+/**@brief Function for computing the integer square root, rounded down. */
+static uint32_t isqrt32(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit  = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root   = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+
+/**@brief Function for getting the magnitude of a sample in mg. */
+static uint32_t magnitude_mg(const uint8_t * p_sample)
+{
+    uint32_t sum = 0;
+    uint8_t  i;
+
+    // Each square is at most 2^30, so three of them fit in 32 bits.
+    for (i = 0; i < 3; i++)
+    {
+        int32_t axis = (int16_t)((p_sample[2 * i] << 8) | p_sample[2 * i + 1]);
+
+        sum += (uint32_t)(axis * axis);
+    }
+
+    return (isqrt32(sum) * 1000) / BEACON_MOTION_LSB_PER_G;
+}
+
+
+void beacon_motion_features_compute(const uint8_t *            p_samples,
+                                    uint16_t                   sample_count,
+                                    beacon_motion_features_t * p_features)
+{
+    uint32_t sum = 0;
+    uint32_t mean;
+    uint16_t i;
+
+    memset(p_features, 0, sizeof(*p_features));
+    if (sample_count == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < sample_count; i++)
+    {
+        sum += magnitude_mg(&p_samples[i * BEACON_MOTION_SAMPLE_SIZE]);
+    }
+    mean = sum / sample_count;
+
+    // Second pass for the spread, recomputing the magnitudes saves a buffer on the stack.
+    sum = 0;
+    for (i = 0; i < sample_count; i++)
+    {
+        uint32_t magnitude = magnitude_mg(&p_samples[i * BEACON_MOTION_SAMPLE_SIZE]);
+        uint32_t deviation = (magnitude > mean) ? (magnitude - mean) : (mean - magnitude);
+
+        sum += deviation;
+        if (deviation > p_features->peak_mg)
+        {
+            p_features->peak_mg = (uint16_t)deviation;
+        }
+    }
+
+    p_features->sample_count = sample_count;
+    p_features->mean_mg      = (uint16_t)mean;
+    p_features->activity_mg  = (uint16_t)(sum / sample_count);
+}
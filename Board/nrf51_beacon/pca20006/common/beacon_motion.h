@@ -0,0 +1,57 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup beacon_motion Beacon Activity Features
+ * @{
+ * @ingroup ble_sdk_app_beacon
+ * @brief Fixed point activity features of a window of accelerometer samples.
+ *
+ * @details The features are computed on the magnitude of the acceleration, so they do not depend
+ *          on how the tag is mounted. A tag at rest reads about 1000 mg whatever its orientation;
+ *          the spread of the magnitude around its mean tells how much it is being moved.
+ *
+ *          Samples are in the MPU6050 FIFO format: X, Y, Z as 16 bit big endian values, in the
+ *          +-2 g range. Only integer arithmetic is used, the nRF51 has no FPU.
+ */
+
+#ifndef BEACON_MOTION_H__
+#define BEACON_MOTION_H__
+
+#include <stdint.h>
+
+#define BEACON_MOTION_SAMPLE_SIZE       6                               /**< Size of a sample: X, Y, Z, 16 bit big endian. */
+#define BEACON_MOTION_LSB_PER_G         16384                           /**< Sensitivity in the +-2 g range. */
+
+/**@brief Activity features of a window of samples. */
+typedef struct
+{
+    uint16_t sample_count;                                              /**< Number of samples in the window. */
+    uint16_t mean_mg;                                                   /**< Mean magnitude, about 1000 mg at rest. */
+    uint16_t activity_mg;                                               /**< Mean absolute deviation of the magnitude from mean_mg. */
+    uint16_t peak_mg;                                                   /**< Largest deviation of the magnitude from mean_mg. */
+} beacon_motion_features_t;
+
+/**@brief Function for computing the activity features of a window of samples.
+ *
+ * @param[in]   p_samples      Samples, BEACON_MOTION_SAMPLE_SIZE bytes each.
+ * @param[in]   sample_count   Number of samples. All features are 0 if there are none.
+ * @param[out]  p_features     Activity features.
+ */
+void beacon_motion_features_compute(const uint8_t *            p_samples,
+                                    uint16_t                   sample_count,
+                                    beacon_motion_features_t * p_features);
+
+#endif // BEACON_MOTION_H__
+
+/** @} */
@@ -24,7 +24,49 @@
  */
 static void on_connect(ble_bcs_t * p_bcs, ble_evt_t * p_ble_evt)
 {
-    p_bcs->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    p_bcs->conn_handle  = p_ble_evt->evt.gap_evt.conn_handle;
+    p_bcs->prepared_len = 0;
+}
+
+
+/**@brief Function for reporting an error to the application.
+ *
+ * @param[in]   p_bcs      Beacon Configuration Service structure.
+ * @param[in]   err_code   Error code returned by the SoftDevice.
+ */
+static void bcs_error_report(ble_bcs_t * p_bcs, uint32_t err_code)
+{
+    if ((err_code != NRF_SUCCESS) && (p_bcs->error_handler != NULL))
+    {
+        p_bcs->error_handler(err_code);
+    }
+}
+
+
+/**@brief Set the value of one characteristic from a part of a config blob.
+ *
+ * @param[in]   handle     Value handle of the characteristic.
+ * @param[in]   p_data     New value.
+ * @param[in]   len        Length of the new value.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t char_value_set(uint16_t handle, const uint8_t * p_data, uint16_t len)
+{
+    return sd_ble_gatts_value_set(handle, 0, &len, p_data);
+}
+
+
+/**@brief Abort an open configuration transaction.
+ *
+ * @details Restores the characteristic values to the last committed configuration.
+ *
+ * @param[in]   p_bcs       Beacon Configuration Service structure.
+ */
+static void transaction_abort(ble_bcs_t * p_bcs)
+{
+    p_bcs->is_transaction_open = false;
+    bcs_error_report(p_bcs, ble_bcs_config_update(p_bcs, p_bcs->config));
 }
 
 
@@ -37,10 +79,225 @@ static void on_disconnect(ble_bcs_t * p_bcs, ble_evt_t * p_ble_evt)
 {
     UNUSED_PARAMETER(p_ble_evt);
     p_bcs->conn_handle = BLE_CONN_HANDLE_INVALID;
+    
+    if (p_bcs->is_transaction_open)
+    {
+        // A transaction that was never committed is discarded.
+        transaction_abort(p_bcs);
+    }
+}
+
+
+/**@brief Function for checking a config blob before it is accepted.
+ *
+ * @return      BLE_GATT_STATUS_SUCCESS, or the ATT error to reject the write with.
+ */
+static uint16_t config_check(ble_bcs_t * p_bcs, const uint8_t * p_config, uint16_t len)
+{
+    if (len != BCS_CONFIG_BLOB_LEN)
+    {
+        return BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+    if ((p_bcs->config_check != NULL) && !p_bcs->config_check(p_config))
+    {
+        return BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE;
+    }
+    return BLE_GATT_STATUS_SUCCESS;
+}
+
+
+/**@brief Function for checking a control point write before it is accepted.
+ *
+ * @details COMMIT and ABORT need an open transaction, and COMMIT needs a staged configuration the
+ *          application accepts. A refused COMMIT leaves the transaction open.
+ *
+ * @return      BLE_GATT_STATUS_SUCCESS, or the ATT error to reject the write with.
+ */
+static uint16_t ctrlpt_check(ble_bcs_t * p_bcs, const uint8_t * p_data, uint16_t len)
+{
+    if (len != 1)
+    {
+        return BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+    
+    switch (p_data[0])
+    {
+        case BCS_CTRLPT_OP_PREPARE:
+            return BLE_GATT_STATUS_SUCCESS;
+            
+        case BCS_CTRLPT_OP_COMMIT:
+            if (!p_bcs->is_transaction_open)
+            {
+                return BCS_CTRLPT_NACK_NO_TRANSACTION;
+            }
+            return config_check(p_bcs, p_bcs->staged_config, BCS_CONFIG_BLOB_LEN);
+            
+        case BCS_CTRLPT_OP_ABORT:
+            if (!p_bcs->is_transaction_open)
+            {
+                return BCS_CTRLPT_NACK_NO_TRANSACTION;
+            }
+            return BLE_GATT_STATUS_SUCCESS;
+            
+        default:
+            return BCS_CTRLPT_NACK_OP_CODE_NOT_SUPPORTED;
+    }
+}
+
+
+/**@brief Control point write handler, called once the operation has been accepted.
+ *
+ * @param[in]   p_bcs       Beacon Configuration Service structure.
+ * @param[in]   op_code     Control point operation.
+ */
+static void on_ctrlpt_write(ble_bcs_t * p_bcs, uint8_t op_code)
+{
+    switch (op_code)
+    {
+        case BCS_CTRLPT_OP_PREPARE:
+            memcpy(p_bcs->staged_config, p_bcs->config, BCS_CONFIG_BLOB_LEN);
+            p_bcs->is_transaction_open = true;
+            break;
+            
+        case BCS_CTRLPT_OP_COMMIT:
+            p_bcs->is_transaction_open = false;
+            bcs_error_report(p_bcs, ble_bcs_config_update(p_bcs, p_bcs->staged_config));
+            p_bcs->beacon_write_handler(p_bcs, beacon_config_data, p_bcs->config);
+            break;
+            
+        case BCS_CTRLPT_OP_ABORT:
+            transaction_abort(p_bcs);
+            break;
+            
+        default:
+            break;
+    }
+}
+
+
+/**@brief Function for finding the part of the config blob a characteristic exposes.
+ *
+ * @param[in]   p_bcs       Beacon Configuration Service structure.
+ * @param[in]   handle      Value handle of the written characteristic.
+ * @param[out]  p_type      Part of the config blob.
+ * @param[out]  p_offset    Offset of the part in the config blob.
+ * @param[out]  p_len       Length of the part.
+ *
+ * @return      True if the handle is the value handle of the config blob or of one of its parts.
+ */
+static bool config_part_get(ble_bcs_t *          p_bcs,
+                            uint16_t             handle,
+                            beacon_data_type_t * p_type,
+                            uint16_t *           p_offset,
+                            uint16_t *           p_len)
+{
+    if (handle == p_bcs->beacon_config_char_handles.value_handle)
+    {
+        *p_type   = beacon_config_data;
+        *p_offset = 0;
+        *p_len    = BCS_CONFIG_BLOB_LEN;
+    }
+    else if (handle == p_bcs->beacon_maj_min_char_handles.value_handle)
+    {
+        *p_type   = beacon_maj_min_data;
+        *p_offset = BCS_CONFIG_MAJ_MIN_OFFSET;
+        *p_len    = 4;
+    }
+    else if (handle == p_bcs->beacon_calib_char_handles.value_handle)
+    {
+        *p_type   = beacon_measured_rssi_data;
+        *p_offset = BCS_CONFIG_RSSI_OFFSET;
+        *p_len    = 1;
+    }
+    else if (handle == p_bcs->beacon_id_char_handles.value_handle)
+    {
+        *p_type   = beacon_uuid_data;
+        *p_offset = BCS_CONFIG_UUID_OFFSET;
+        *p_len    = 16;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+
+/**@brief Function for checking a write to one part of the config blob before it is accepted.
+ *
+ * @details The part is checked within the config blob it ends up in. While a transaction is open
+ *          the write is only staged, and the staged blob is checked as a whole on COMMIT.
+ *
+ * @return      BLE_GATT_STATUS_SUCCESS, or the ATT error to reject the write with.
+ */
+static uint16_t config_part_check(ble_bcs_t *     p_bcs,
+                                  uint16_t        offset,
+                                  uint16_t        part_len,
+                                  const uint8_t * p_data,
+                                  uint16_t        len)
+{
+    uint8_t config[BCS_CONFIG_BLOB_LEN];
+    
+    if (len != part_len)
+    {
+        return BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+    if (p_bcs->is_transaction_open)
+    {
+        return BLE_GATT_STATUS_SUCCESS;
+    }
+    
+    memcpy(config, p_bcs->config, BCS_CONFIG_BLOB_LEN);
+    memcpy(&config[offset], p_data, len);
+    return config_check(p_bcs, config, BCS_CONFIG_BLOB_LEN);
+}
+
+
+/**@brief Function for applying a write to a part of the config blob.
+ *
+ * @details While a transaction is open the write is only staged, otherwise it is passed to the
+ *          application right away.
+ *
+ * @param[in]   p_bcs       Beacon Configuration Service structure.
+ * @param[in]   type        Part of the config blob that was written.
+ * @param[in]   offset      Offset of the part in the config blob.
+ * @param[in]   p_data      New value of the part.
+ * @param[in]   len         Length of the part.
+ */
+static void config_write(ble_bcs_t *         p_bcs,
+                         beacon_data_type_t  type,
+                         uint16_t            offset,
+                         const uint8_t *     p_data,
+                         uint16_t            len)
+{
+    if (p_bcs->is_transaction_open)
+    {
+        memcpy(&p_bcs->staged_config[offset], p_data, len);
+        return;
+    }
+    
+    memcpy(&p_bcs->config[offset], p_data, len);
+    
+    if (type == beacon_config_data)
+    {
+        // Bring the individual characteristics in line with the new blob.
+        bcs_error_report(p_bcs, ble_bcs_config_update(p_bcs, p_bcs->config));
+        p_bcs->beacon_write_handler(p_bcs, beacon_config_data, p_bcs->config);
+    }
+    else
+    {
+        bcs_error_report(p_bcs, char_value_set(p_bcs->beacon_config_char_handles.value_handle,
+                                               p_bcs->config,
+                                               BCS_CONFIG_BLOB_LEN));
+        p_bcs->beacon_write_handler(p_bcs, type, &p_bcs->config[offset]);
+    }
 }
 
 
 /**@brief Write event handler.
+ *
+ * @details Only the rotating identifier settings are written without authorization, the config
+ *          blob, its parts and the control point are handled in on_rw_authorize_request.
  *
  * @param[in]   p_bcs       Beacon Configuration Service structure.
  * @param[in]   p_ble_evt   Event received from the BLE stack.
@@ -49,28 +306,129 @@ static void on_write(ble_bcs_t * p_bcs, ble_evt_t * p_ble_evt)
 {
     ble_gatts_evt_write_t * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
     
-    if (p_bcs->beacon_write_handler == NULL)
+    if ((p_bcs->beacon_write_handler != NULL) &&
+        (p_evt_write->handle == p_bcs->beacon_eid_char_handles.value_handle) &&
+        (p_evt_write->len == BCS_EID_SETTINGS_LEN))
+    {
+        // Not part of the config blob, so never staged.
+        p_bcs->beacon_write_handler(p_bcs, beacon_eid_data, p_evt_write->data);
+    }
+}
+
+
+/**@brief Write authorization request handler.
+ *
+ * @details A single write to the config blob, to one of its parts or to the control point is
+ *          checked right away. Queued writes are only supported for the config blob: they are
+ *          collected in prepared_config, in order, and the blob is checked when they are executed.
+ *          An execute with nothing queued succeeds without any change. A write is only applied
+ *          once it has been accepted.
+ *
+ * @param[in]   p_bcs       Beacon Configuration Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_bcs_t * p_bcs, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req  = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_evt_write_t *                p_evt_write = &p_auth_req->request.write;
+    ble_gatts_rw_authorize_reply_params_t  auth_reply;
+    bool                                   is_accepted = false;
+    bool                                   is_ctrlpt   = false;
+    beacon_data_type_t                     type        = beacon_config_data;
+    uint16_t                               offset      = 0;
+    uint16_t                               len         = BCS_CONFIG_BLOB_LEN;
+    const uint8_t *                        p_data      = p_bcs->prepared_config;
+    
+    if (p_auth_req->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE)
     {
         return;
     }
     
-   if ((p_evt_write->handle == p_bcs->beacon_maj_min_char_handles.value_handle) &&
-       (p_evt_write->len == 4))
-   {
-       p_bcs->beacon_write_handler(p_bcs, beacon_maj_min_data, p_evt_write->data);
-   }
-   
-   if ((p_evt_write->handle == p_bcs->beacon_calib_char_handles.value_handle) &&
-       (p_evt_write->len == 1))
-   {
-       p_bcs->beacon_write_handler(p_bcs, beacon_measured_rssi_data, p_evt_write->data);
-   }
-
-   if ((p_evt_write->handle == p_bcs->beacon_id_char_handles.value_handle) &&
-       (p_evt_write->len == 16))
-   {
-       p_bcs->beacon_write_handler(p_bcs, beacon_uuid_data, p_evt_write->data);
-   }   
+    memset(&auth_reply, 0, sizeof(auth_reply));
+    auth_reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    
+    switch (p_evt_write->op)
+    {
+        case BLE_GATTS_OP_WRITE_REQ:
+            if (p_evt_write->handle == p_bcs->beacon_ctrlpt_char_handles.value_handle)
+            {
+                is_ctrlpt = true;
+                auth_reply.params.write.gatt_status = ctrlpt_check(p_bcs, p_evt_write->data, p_evt_write->len);
+            }
+            else if (!config_part_get(p_bcs, p_evt_write->handle, &type, &offset, &len))
+            {
+                return;
+            }
+            else if (type == beacon_config_data)
+            {
+                auth_reply.params.write.gatt_status = config_check(p_bcs, p_evt_write->data, p_evt_write->len);
+                if (auth_reply.params.write.gatt_status == BLE_GATT_STATUS_SUCCESS)
+                {
+                    memcpy(p_bcs->prepared_config, p_evt_write->data, BCS_CONFIG_BLOB_LEN);
+                }
+            }
+            else
+            {
+                auth_reply.params.write.gatt_status = config_part_check(p_bcs,
+                                                                        offset,
+                                                                        len,
+                                                                        p_evt_write->data,
+                                                                        p_evt_write->len);
+                p_data = p_evt_write->data;
+            }
+            is_accepted = (auth_reply.params.write.gatt_status == BLE_GATT_STATUS_SUCCESS);
+            break;
+            
+        case BLE_GATTS_OP_PREP_WRITE_REQ:
+            if (p_evt_write->handle != p_bcs->beacon_config_char_handles.value_handle)
+            {
+                auth_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_LONG;
+                break;
+            }
+            if ((p_evt_write->offset != p_bcs->prepared_len) ||
+                (p_evt_write->len > BCS_CONFIG_BLOB_LEN - p_evt_write->offset))
+            {
+                p_bcs->prepared_len = 0;
+                auth_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INVALID_OFFSET;
+                break;
+            }
+            memcpy(&p_bcs->prepared_config[p_evt_write->offset], p_evt_write->data, p_evt_write->len);
+            p_bcs->prepared_len += p_evt_write->len;
+            break;
+            
+        case BLE_GATTS_OP_EXEC_WRITE_REQ_NOW:
+            if (p_bcs->prepared_len != 0)
+            {
+                auth_reply.params.write.gatt_status = config_check(p_bcs,
+                                                                   p_bcs->prepared_config,
+                                                                   p_bcs->prepared_len);
+                is_accepted = (auth_reply.params.write.gatt_status == BLE_GATT_STATUS_SUCCESS);
+                p_bcs->prepared_len = 0;
+            }
+            break;
+            
+        case BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL:
+            p_bcs->prepared_len = 0;
+            break;
+            
+        default:
+            return;
+    }
+    
+    bcs_error_report(p_bcs, sd_ble_gatts_rw_authorize_reply(p_bcs->conn_handle, &auth_reply));
+    
+    if (is_accepted && (p_bcs->beacon_write_handler != NULL))
+    {
+        if (is_ctrlpt)
+        {
+            on_ctrlpt_write(p_bcs, p_evt_write->data[0]);
+        }
+        else
+        {
+            config_write(p_bcs, type, offset, p_data, len);
+        }
+    }
 }
 
 
@@ -90,6 +448,10 @@ void ble_bcs_on_ble_evt(ble_bcs_t * p_bcs, ble_evt_t * p_ble_evt)
             on_write(p_bcs, p_ble_evt);
             break;
             
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            on_rw_authorize_request(p_bcs, p_ble_evt);
+            break;
+            
         default:
             break;
     }
@@ -131,7 +493,7 @@ static uint32_t beacon_maj_min_char_add(ble_bcs_t * p_bcs, const ble_bcs_init_t
     
     attr_md.vloc       = BLE_GATTS_VLOC_STACK;
     attr_md.rd_auth    = 0;
-    attr_md.wr_auth    = 0;
+    attr_md.wr_auth    = 1;
     attr_md.vlen       = 0;
     
     memset(&attr_char_value, 0, sizeof(attr_char_value));
@@ -183,7 +545,7 @@ static uint32_t beacon_calib_char_add(ble_bcs_t * p_bcs, const ble_bcs_init_t *
     
     attr_md.vloc       = BLE_GATTS_VLOC_STACK;
     attr_md.rd_auth    = 0;
-    attr_md.wr_auth    = 0;
+    attr_md.wr_auth    = 1;
     attr_md.vlen       = 0;
     
     memset(&attr_char_value, 0, sizeof(attr_char_value));
@@ -235,7 +597,7 @@ static uint32_t beacon_id_char_add(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_b
     
     attr_md.vloc       = BLE_GATTS_VLOC_STACK;
     attr_md.rd_auth    = 0;
-    attr_md.wr_auth    = 0;
+    attr_md.wr_auth    = 1;
     attr_md.vlen       = 0;
     
     memset(&attr_char_value, 0, sizeof(attr_char_value));
@@ -252,6 +614,210 @@ static uint32_t beacon_id_char_add(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_b
                                                &p_bcs->beacon_id_char_handles);
 }
 
+/**@brief Add Beacon Configuration config blob characteristic.
+ *
+ * @param[in]   p_bcs        Beacon Configuration Service structure.
+ * @param[in]   p_bcs_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t beacon_config_char_add(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_bcs_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    
+    UNUSED_PARAMETER(p_bcs_init);
+
+    memset(&char_md, 0, sizeof(char_md));
+    
+    char_md.char_props.read   = 1;
+    char_md.char_props.write  = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = NULL;
+    char_md.p_sccd_md         = NULL;
+    
+    ble_uuid.type = p_bcs->uuid_type;
+    ble_uuid.uuid = BCS_UUID_BEACON_CONFIG_CHAR;
+    
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    
+    // Written blobs are checked before they are stored, see on_rw_authorize_request.
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 1;
+    attr_md.vlen       = 0;
+    
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = BCS_CONFIG_BLOB_LEN;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = BCS_CONFIG_BLOB_LEN;
+    attr_char_value.p_value      = p_bcs->config;
+    
+    return sd_ble_gatts_characteristic_add(p_bcs->service_handle, &char_md,
+                                               &attr_char_value,
+                                               &p_bcs->beacon_config_char_handles);
+}
+
+/**@brief Add Beacon Configuration control point characteristic.
+ *
+ * @param[in]   p_bcs        Beacon Configuration Service structure.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t beacon_ctrlpt_char_add(ble_bcs_t * p_bcs)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    uint8_t             initial_value = 0;
+
+    memset(&char_md, 0, sizeof(char_md));
+    
+    char_md.char_props.write  = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = NULL;
+    char_md.p_sccd_md         = NULL;
+    
+    ble_uuid.type = p_bcs->uuid_type;
+    ble_uuid.uuid = BCS_UUID_BEACON_CTRLPT_CHAR;
+    
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 1;
+    attr_md.vlen       = 0;
+    
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 1;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = 1;
+    attr_char_value.p_value      = &initial_value;
+    
+    return sd_ble_gatts_characteristic_add(p_bcs->service_handle, &char_md,
+                                               &attr_char_value,
+                                               &p_bcs->beacon_ctrlpt_char_handles);
+}
+
+/**@brief Add Beacon Configuration error log characteristic.
+ *
+ * @param[in]   p_bcs        Beacon Configuration Service structure.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t beacon_error_log_char_add(ble_bcs_t * p_bcs)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+    
+    char_md.char_props.read   = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = NULL;
+    char_md.p_sccd_md         = NULL;
+    
+    ble_uuid.type = p_bcs->uuid_type;
+    ble_uuid.uuid = BCS_UUID_BEACON_ERROR_LOG_CHAR;
+    
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    // Crash records hold code addresses and stack contents, only for a bonded or paired peer.
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 1;
+    
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 0;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = BCS_ERROR_LOG_MAX_LEN;
+    attr_char_value.p_value      = NULL;
+    
+    return sd_ble_gatts_characteristic_add(p_bcs->service_handle, &char_md,
+                                               &attr_char_value,
+                                               &p_bcs->beacon_error_log_char_handles);
+}
+
+/**@brief Add Beacon Configuration rotating identifier characteristic.
+ *
+ * @param[in]   p_bcs        Beacon Configuration Service structure.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t beacon_eid_char_add(ble_bcs_t * p_bcs)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+    
+    char_md.char_props.write  = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = NULL;
+    char_md.p_sccd_md         = NULL;
+    
+    ble_uuid.type = p_bcs->uuid_type;
+    ble_uuid.uuid = BCS_UUID_BEACON_EID_CHAR;
+    
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    // The identity key must never be readable, nor written without an authenticated pairing.
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_WITH_MITM(&attr_md.write_perm);
+    
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 1;
+    
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 0;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = BCS_EID_SETTINGS_LEN;
+    attr_char_value.p_value      = NULL;
+    
+    return sd_ble_gatts_characteristic_add(p_bcs->service_handle, &char_md,
+                                               &attr_char_value,
+                                               &p_bcs->beacon_eid_char_handles);
+}
+
 uint32_t ble_bcs_init(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_bcs_init)
 {
     uint32_t   err_code;
@@ -260,6 +826,17 @@ uint32_t ble_bcs_init(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_bcs_init)
     // Initialize service structure
     p_bcs->conn_handle       = BLE_CONN_HANDLE_INVALID;
     p_bcs->beacon_write_handler = p_bcs_init->beacon_write_handler;
+    p_bcs->config_check      = p_bcs_init->config_check;
+    p_bcs->prepared_len      = 0;
+    p_bcs->error_handler     = p_bcs_init->error_handler;
+    p_bcs->is_transaction_open = false;
+    
+    // Build the config blob from the advertised beacon info.
+    memcpy(&p_bcs->config[BCS_CONFIG_UUID_OFFSET], &p_bcs_init->p_beacon_info[2], 16);
+    memcpy(&p_bcs->config[BCS_CONFIG_MAJ_MIN_OFFSET], &p_bcs_init->p_beacon_info[18], 4);
+    p_bcs->config[BCS_CONFIG_RSSI_OFFSET]     = p_bcs_init->p_beacon_info[22];
+    p_bcs->config[BCS_CONFIG_TX_POWER_OFFSET] = (uint8_t)p_bcs_init->tx_power;
+    (void)uint16_encode(p_bcs_init->adv_interval_ms, &p_bcs->config[BCS_CONFIG_INTERVAL_OFFSET]);
     
     // Add base UUID to softdevice's internal list. 
     ble_uuid128_t base_uuid = BCS_UUID_BASE;
@@ -296,6 +873,78 @@ uint32_t ble_bcs_init(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_bcs_init)
         return err_code;
     }    
     
+    err_code = beacon_config_char_add(p_bcs, p_bcs_init);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = beacon_ctrlpt_char_add(p_bcs);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = beacon_error_log_char_add(p_bcs);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = beacon_eid_char_add(p_bcs);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
     return NRF_SUCCESS;
 }
 
+uint32_t ble_bcs_config_update(ble_bcs_t * p_bcs, const uint8_t * p_config)
+{
+    uint32_t err_code;
+    
+    if (p_config != p_bcs->config)
+    {
+        memcpy(p_bcs->config, p_config, BCS_CONFIG_BLOB_LEN);
+    }
+    
+    err_code = char_value_set(p_bcs->beacon_id_char_handles.value_handle,
+                              &p_bcs->config[BCS_CONFIG_UUID_OFFSET],
+                              16);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    
+    err_code = char_value_set(p_bcs->beacon_maj_min_char_handles.value_handle,
+                              &p_bcs->config[BCS_CONFIG_MAJ_MIN_OFFSET],
+                              4);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    
+    err_code = char_value_set(p_bcs->beacon_calib_char_handles.value_handle,
+                              &p_bcs->config[BCS_CONFIG_RSSI_OFFSET],
+                              1);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    
+    return char_value_set(p_bcs->beacon_config_char_handles.value_handle,
+                          p_bcs->config,
+                          BCS_CONFIG_BLOB_LEN);
+}
+
+
+uint32_t ble_bcs_error_log_update(ble_bcs_t * p_bcs, const uint8_t * p_data, uint16_t len)
+{
+    if (len > BCS_ERROR_LOG_MAX_LEN)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    
+    return char_value_set(p_bcs->beacon_error_log_char_handles.value_handle, p_data, len);
+}
@@ -28,6 +28,22 @@
  *          If an event handler is supplied by the application, the LEDButton Service will
  *          generate Beacon Configuration Service events to the application.
  *
+ *          All beacon parameters are also exposed as one config blob characteristic. Writing the blob
+ *          results in a single call to the write handler, so the application needs only one flash
+ *          commit per provisioning. A control point allows a PREPARE/COMMIT transaction: while a
+ *          transaction is open, writes to the blob and to the individual characteristics are staged
+ *          and only handed to the application as one config blob on COMMIT.
+ *
+ *          The identity key of the rotating identifiers is write only, and needs a link encrypted
+ *          with MITM protection, i.e. paired with the OOB key of the beacon.
+ *          It is not part of the config blob, and is handed to the application as soon as it is
+ *          written.
+ *          Writes to the config blob and to the individual characteristics need authorization: the
+ *          resulting blob is checked with the config_check function of the application, and a
+ *          value it refuses is rejected with an ATT error, before it is stored. Queued (long)
+ *          writes are checked when they are executed. Within a transaction the staged blob is
+ *          checked on COMMIT, and a COMMIT or ABORT without a PREPARE is rejected.
+ *
  * @note The application must propagate BLE stack events to the Beacon Configuration Service module by calling
  *       ble_bcs_on_ble_evt() from the from the @ref ble_stack_handler callback.
  */
@@ -48,11 +64,38 @@
 #define BCS_UUID_BEACON_MAJ_MIN_CHAR 0x1526
 #define BCS_UUID_BEACON_CALIB_CHAR   0x1525
 #define BCS_UUID_BEACON_ID_CHAR      0x1524
+#define BCS_UUID_BEACON_CONFIG_CHAR  0x1527
+#define BCS_UUID_BEACON_CTRLPT_CHAR  0x1528
+#define BCS_UUID_BEACON_ERROR_LOG_CHAR 0x1529
+#define BCS_UUID_BEACON_EID_CHAR     0x152A
+
+#define BCS_CONFIG_UUID_OFFSET       0                                /**< Offset of the beacon UUID in the config blob. */
+#define BCS_CONFIG_MAJ_MIN_OFFSET    16                               /**< Offset of major and minor in the config blob. */
+#define BCS_CONFIG_RSSI_OFFSET       20                               /**< Offset of the measured RSSI in the config blob. */
+#define BCS_CONFIG_TX_POWER_OFFSET   21                               /**< Offset of the radio TX power (dBm, signed) in the config blob. */
+#define BCS_CONFIG_INTERVAL_OFFSET   22                               /**< Offset of the advertising interval (ms, little endian) in the config blob. */
+#define BCS_CONFIG_BLOB_LEN          24                               /**< Total length of the config blob. */
+
+#define BCS_ERROR_LOG_MAX_LEN        96                               /**< Maximum length of the error log characteristic, four crash records. */
+
+#define BCS_EID_KEY_OFFSET           0                                /**< Offset of the identity key in the rotating identifier settings. */
+#define BCS_EID_ROTATION_EXP_OFFSET  16                               /**< Offset of the rotation exponent, 0xFF disables rotating identifiers. */
+#define BCS_EID_TIME_OFFSET          17                               /**< Offset of the beacon time (s, little endian). */
+#define BCS_EID_SETTINGS_LEN         21                               /**< Total length of the rotating identifier settings. */
+
+#define BCS_CTRLPT_OP_PREPARE        0x01                             /**< Open a configuration transaction. */
+#define BCS_CTRLPT_OP_COMMIT         0x02                             /**< Commit the staged configuration in one flash write. */
+#define BCS_CTRLPT_OP_ABORT          0x03                             /**< Discard the staged configuration. */
+
+#define BCS_CTRLPT_NACK_NO_TRANSACTION        (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0) /**< Reply to a COMMIT or ABORT without an open transaction. */
+#define BCS_CTRLPT_NACK_OP_CODE_NOT_SUPPORTED (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 1) /**< Reply to an unknown control point operation. */
 
 typedef enum {
     beacon_maj_min_data,
     beacon_measured_rssi_data,
-    beacon_uuid_data
+    beacon_uuid_data,
+    beacon_config_data,                                               /**< Complete config blob, BCS_CONFIG_BLOB_LEN bytes. */
+    beacon_eid_data                                                   /**< Rotating identifier settings, BCS_EID_SETTINGS_LEN bytes. */
 }beacon_data_type_t;
 
 // Forward declaration of the ble_bcs_t type. 
@@ -61,12 +104,22 @@ typedef struct ble_bcs_s ble_bcs_t;
 /**@brief Beacon Configuration Service event handler type. */
 typedef void (*ble_bcs_write_handler_t) (ble_bcs_t * p_bcs, beacon_data_type_t type, uint8_t *data);
 
+/**@brief Config blob check type.
+ * @param[in]   p_config   Config blob of BCS_CONFIG_BLOB_LEN bytes.
+ * @return      True if the application accepts the blob, false to reject the write.
+ */
+typedef bool (*ble_bcs_config_check_t) (const uint8_t * p_config);
+
 /**@brief Beacon Configuration Service init structure. This contains all options and data needed for
  *        initialization of the service.*/
 typedef struct
 {
     ble_bcs_write_handler_t   beacon_write_handler;
+    ble_bcs_config_check_t    config_check;                           /**< Function checking a written config blob. NULL accepts every blob. */
     uint8_t                   *p_beacon_info;
+    int8_t                    tx_power;                               /**< Initial TX power exposed in the config blob. */
+    uint16_t                  adv_interval_ms;                        /**< Initial advertising interval exposed in the config blob. */
+    ble_srv_error_handler_t   error_handler;                          /**< Function to be called in case of an error. */
 } ble_bcs_init_t;
 
 
@@ -77,10 +130,21 @@ typedef struct ble_bcs_s
     ble_gatts_char_handles_t     beacon_maj_min_char_handles;
     ble_gatts_char_handles_t     beacon_calib_char_handles;
     ble_gatts_char_handles_t     beacon_id_char_handles;
+    ble_gatts_char_handles_t     beacon_config_char_handles;
+    ble_gatts_char_handles_t     beacon_ctrlpt_char_handles;
+    ble_gatts_char_handles_t     beacon_error_log_char_handles;
+    ble_gatts_char_handles_t     beacon_eid_char_handles;
     uint8_t                      uuid_type;
     uint16_t                     conn_handle;  
     bool                         is_notifying;
+    bool                         is_transaction_open;             /**< True between a PREPARE and a COMMIT/ABORT on the control point. */
+    uint8_t                      config[BCS_CONFIG_BLOB_LEN];     /**< Last configuration handed to the application. */
+    uint8_t                      staged_config[BCS_CONFIG_BLOB_LEN]; /**< Configuration collected while a transaction is open. */
+    uint8_t                      prepared_config[BCS_CONFIG_BLOB_LEN]; /**< Config blob collected from queued writes, checked on execute. */
+    uint16_t                     prepared_len;                    /**< Bytes of the blob received in queued writes so far, which must come in order. */
     ble_bcs_write_handler_t      beacon_write_handler;
+    ble_bcs_config_check_t       config_check;
+    ble_srv_error_handler_t      error_handler;
 } ble_lbs_t;
 
 
@@ -102,6 +166,28 @@ uint32_t ble_bcs_init(ble_bcs_t * p_bcs, const ble_bcs_init_t * p_bcs_init);
  */
 void ble_bcs_on_ble_evt(ble_bcs_t * p_bcs, ble_evt_t * p_ble_evt);
 
+/**@brief Update all Beacon Configuration characteristics from a config blob.
+ *
+ * @details Keeps the individual characteristics and the config blob characteristic consistent,
+ *          e.g. after the application has committed a new configuration.
+ *
+ * @param[in]   p_bcs      Beacon Configuration Service structure.
+ * @param[in]   p_config   Config blob of BCS_CONFIG_BLOB_LEN bytes.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_bcs_config_update(ble_bcs_t * p_bcs, const uint8_t * p_config);
+
+/**@brief Set the value of the read only error log characteristic, readable on an encrypted link.
+ *
+ * @param[in]   p_bcs      Beacon Configuration Service structure.
+ * @param[in]   p_data     Crash records, see @ref ble_error_log_records_get.
+ * @param[in]   len        Length of the records, at most BCS_ERROR_LOG_MAX_LEN bytes.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_bcs_error_log_update(ble_bcs_t * p_bcs, const uint8_t * p_data, uint16_t len);
+
 
 #endif // BLE_BCS_H__
 
@@ -0,0 +1,65 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Core function access for the host builds, replacing the Cortex-M0 one in Include/gcc.
+ *
+ * @details Found before Include/gcc/core_cmFunc.h as the host directory comes first in the
+ *          include path. The host tools run single threaded and only run their emulated
+ *          interrupts from their wait functions, so masking interrupts has no effect. PRIMASK is
+ *          kept so that code reading it back sees what it wrote.
+ */
+
+#ifndef __CORE_CMFUNC_H
+#define __CORE_CMFUNC_H
+
+#include <stdint.h>
+
+static uint32_t host_primask;
+
+static inline void __enable_irq(void)
+{
+    host_primask = 0;
+}
+
+static inline void __disable_irq(void)
+{
+    host_primask = 1;
+}
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return host_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t priMask)
+{
+    host_primask = priMask & 1;
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+    return 0;
+}
+
+static inline uint32_t __get_CONTROL(void)
+{
+    return 0;
+}
+
+static inline void __set_CONTROL(uint32_t control)
+{
+    (void)control;
+}
+
+#endif // __CORE_CMFUNC_H
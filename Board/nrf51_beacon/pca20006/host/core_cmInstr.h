@@ -0,0 +1,72 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Core instruction access for the host builds, replacing the Cortex-M0 one in Include/gcc.
+ *
+ * @details Found before Include/gcc/core_cmInstr.h as the host directory comes first in the
+ *          include path. __WFE calls host_wfe(), which a host tool using it must provide: it
+ *          returns once an emulated interrupt has run.
+ */
+
+#ifndef __CORE_CMINSTR_H
+#define __CORE_CMINSTR_H
+
+#include <stdint.h>
+
+void host_wfe(void);
+
+static inline void __NOP(void)
+{
+}
+
+static inline void __WFI(void)
+{
+    host_wfe();
+}
+
+static inline void __WFE(void)
+{
+    host_wfe();
+}
+
+static inline void __SEV(void)
+{
+}
+
+static inline void __ISB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __DSB(void)
+{
+    __sync_synchronize();
+}
+
+static inline void __DMB(void)
+{
+    __sync_synchronize();
+}
+
+static inline uint32_t __REV(uint32_t value)
+{
+    return __builtin_bswap32(value);
+}
+
+static inline uint32_t __REV16(uint32_t value)
+{
+    return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);
+}
+
+#endif // __CORE_CMINSTR_H
@@ -0,0 +1,180 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host reference resolver for rotating beacon identifiers, see @ref beacon_eid.
+ *
+ * @details Runs the beacon's own derivation, with the AES block cipher of OpenSSL. Build with:
+ *
+ *          gcc -I../common -I../../../../Include/s110 eid_resolve.c ../common/beacon_eid.c -lcrypto
+ *
+ *          Usage:
+ *          - eid_resolve <key> <exp> <eid> [time_hint [window]]
+ *            Prints the beacon time of the rotation period of an observed identifier.
+ *          - eid_resolve -c <key> <exp> <time>
+ *            Prints the identifier the beacon advertises at a time.
+ *          - eid_resolve -o <er>
+ *            Prints the OOB pairing key of a beacon from its encryption root, the 16 bytes of
+ *            FICR ER at 0x10000080 in memory order. Writing the identity key needs a pairing
+ *            with this key.
+ *
+ *          Keys and identifiers are given as hex strings. In the advertising packet the
+ *          identifier takes the last four bytes of the beacon UUID, followed by major and minor.
+ *
+ *          The beacon saves its time on rotation boundaries, at most every 1024 seconds, and
+ *          resumes from there after a power cycle. So it may lag by one rotation period, or by
+ *          up to 2^(10 - exp) periods for exponents below 10. The default window covers that for
+ *          exponents from 4.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "beacon_eid.h"
+#include "nrf_error.h"
+
+#define DEFAULT_WINDOW      64                                          /**< Rotation periods tried on each side of the time hint. */
+#define OOB_KEY_LABEL       "BCS OOB PAIRING"                           /**< Block the beacon encrypts with its encryption root to get the OOB key. */
+
+
+/**@brief AES-128 block encryption with OpenSSL. */
+static uint32_t aes_encrypt(const uint8_t * p_key, const uint8_t * p_cleartext, uint8_t * p_ciphertext)
+{
+    EVP_CIPHER_CTX * p_ctx = EVP_CIPHER_CTX_new();
+    int              len;
+    uint32_t         err_code = NRF_ERROR_INTERNAL;
+
+    if ((p_ctx != NULL)                                                          &&
+        EVP_EncryptInit_ex(p_ctx, EVP_aes_128_ecb(), NULL, p_key, NULL)          &&
+        EVP_CIPHER_CTX_set_padding(p_ctx, 0)                                     &&
+        EVP_EncryptUpdate(p_ctx, p_ciphertext, &len, p_cleartext, 16))
+    {
+        err_code = NRF_SUCCESS;
+    }
+    EVP_CIPHER_CTX_free(p_ctx);
+
+    return err_code;
+}
+
+
+/**@brief Function for decoding a hex string of a given length.
+ *
+ * @return      True on success, false if the string is not len bytes of hex.
+ */
+static bool hex_decode(const char * p_hex, uint8_t * p_data, size_t len)
+{
+    size_t i;
+
+    if (strlen(p_hex) != (2 * len))
+    {
+        return false;
+    }
+    for (i = 0; i < len; i++)
+    {
+        unsigned int byte;
+
+        if (sscanf(&p_hex[2 * i], "%2x", &byte) != 1)
+        {
+            return false;
+        }
+        p_data[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+
+static int usage(void)
+{
+    fprintf(stderr, "usage: eid_resolve <key> <exp> <eid> [time_hint [window]]\n"
+                    "       eid_resolve -c <key> <exp> <time>\n"
+                    "       eid_resolve -o <er>\n");
+    return 2;
+}
+
+
+int main(int argc, char ** argv)
+{
+    uint8_t  key[BEACON_EID_KEY_LEN];
+    uint8_t  eid[BEACON_EID_LEN];
+    bool     compute = (argc > 1) && (strcmp(argv[1], "-c") == 0);
+    char **  p_args  = compute ? &argv[2] : &argv[1];
+    int      count   = compute ? (argc - 2) : (argc - 1);
+    uint32_t rotation_exp;
+    uint32_t time;
+    int      i;
+
+    if ((argc == 3) && (strcmp(argv[1], "-o") == 0))
+    {
+        uint8_t oob_key[BEACON_EID_KEY_LEN];
+
+        if (!hex_decode(argv[2], key, sizeof(key)))
+        {
+            return usage();
+        }
+        if (aes_encrypt(key, (const uint8_t *)OOB_KEY_LABEL, oob_key) != NRF_SUCCESS)
+        {
+            return 1;
+        }
+        for (i = 0; i < BEACON_EID_KEY_LEN; i++)
+        {
+            printf("%02x", oob_key[i]);
+        }
+        printf("\n");
+        return 0;
+    }
+
+    if ((count < 3) || !hex_decode(p_args[0], key, sizeof(key)))
+    {
+        return usage();
+    }
+    rotation_exp = strtoul(p_args[1], NULL, 0);
+    if (rotation_exp > BEACON_EID_ROTATION_EXP_MAX)
+    {
+        return usage();
+    }
+
+    if (compute)
+    {
+        time = strtoul(p_args[2], NULL, 0);
+        if (beacon_eid_compute(aes_encrypt, key, (uint8_t)rotation_exp, time, eid) != NRF_SUCCESS)
+        {
+            return 1;
+        }
+        for (i = 0; i < BEACON_EID_LEN; i++)
+        {
+            printf("%02x", eid[i]);
+        }
+        printf("\n");
+        return 0;
+    }
+
+    if (!hex_decode(p_args[2], eid, sizeof(eid)))
+    {
+        return usage();
+    }
+    if (beacon_eid_resolve(aes_encrypt,
+                           key,
+                           (uint8_t)rotation_exp,
+                           eid,
+                           (count > 3) ? strtoul(p_args[3], NULL, 0) : 0,
+                           (count > 4) ? strtoul(p_args[4], NULL, 0) : DEFAULT_WINDOW,
+                           &time))
+    {
+        printf("%lu\n", (unsigned long)time);
+        return 0;
+    }
+
+    printf("not resolved\n");
+    return 1;
+}
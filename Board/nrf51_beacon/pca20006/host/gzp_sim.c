@@ -0,0 +1,275 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host simulation of Gazell Pairing encrypted user data, Devices to one Host.
+ *
+ * @details The Devices, @ref nrf_gzp_device.c, run in child processes of this program. The Host,
+ *          @ref nrf_gzp_host.c, runs in gzp_sim_host, connected to every Device over a socketpair
+ *          acting as the air, see gzp_sim_port.h. The Host hands out the pairing parameters, then
+ *          lets the Devices take turns sending frames with gzp_crypt_data_send(), which it reads
+ *          with gzp_crypt_user_data_read() and checks. Build both with:
+ *
+ *          gcc -O2 -Wall -Wno-attributes -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast
+ *              -DNRF51 -DBLE_STACK_SUPPORT_REQD -DSVCALL_AS_NORMAL_FUNCTION -I.
+ *              -I../../../../Include -I../../../../Include/gcc -I../../../../Include/gzp
+ *              -I../../../../Include/gzll -I../../../../Include/s110
+ *              -I../../../../Include/sd_common -no-pie -Wl,--wrap=gzp_crypt,--wrap=gzp_crypt_select_key
+ *              gzp_sim.c gzp_sim_port.c ../../../../Source/gzp/nrf_gzp.c
+ *              ../../../../Source/gzp/nrf_gzp_device.c ../../../../Source/nrf_ecb/nrf_ecb.c
+ *              -lcrypto -o gzp_sim
+ *
+ *          and gzp_sim_host the same way from gzp_sim_host.c gzp_sim_port.c
+ *          ../../../../Source/gzp/nrf_gzp.c ../../../../Source/gzp/nrf_gzp_host.c
+ *          ../../../../Source/gzp/nrf_gzp_host_nrf51.c ../../../../Source/nrf_ecb/nrf_ecb.c.
+ *
+ *          Usage: gzp_sim [-n devices] [-p frames] [-t turns] [-s seed] [-r] [-w duty] [-R]
+ *                         [-h gzp_sim_host]
+ *          - devices   Number of Devices, default 1.
+ *          - frames    Frames a Device sends per turn, default 1000.
+ *          - turns     Turns of every Device, default 1.
+ *          - -r        Run gzp_crypt() as before the keystream cache, one ECB block per call.
+ *          - duty      Share of the time Wi-Fi APs on channels 1, 6 and 13 transmit, per mille,
+ *                      default 0. See gzp_port_air_set().
+ *          - -R        Restart the Host and the Devices between turns, as after a reset.
+ *
+ *          The Host prints the frames received and lost, and per side the gzp_crypt() calls, the
+ *          ECB blocks and the time spent in gzp_crypt(). A change of the encrypted data path is
+ *          evaluated by comparing the figures with and without -r.
+ *
+ *          With -w the Devices replace the channels the APs disturb. The Host prints the channel
+ *          updates and syncs it received, and the Devices whose channel table differed from its
+ *          own at the end of their turns. With -R the tables come from the flash after a restart.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "gzp_sim.h"
+#include "nrf_gzp_config.h"
+#include "nrf_nvmc.h"
+
+#define DEVICE_COUNT_MAX        16                  /**< Devices a Host can have, see gzp_sim_port.c. */
+#define MAX_TX_ATTEMPTS         100                 /**< Gazell attempts per packet, as in the SDK examples. */
+#define INDEX_DB_OFFSET         126                 /**< Index database in the Device flash, after 14 entries of 9 bytes. */
+
+
+/**@brief Function for starting Gazell and Gazell Pairing, as after a reset. */
+static void device_start(void)
+{
+    (void)nrf_gzll_init(NRF_GZLL_MODE_DEVICE);
+    (void)nrf_gzll_set_max_tx_attempts(MAX_TX_ATTEMPTS);
+    gzp_init();
+    (void)nrf_gzll_enable();
+}
+
+
+/**@brief Function for storing the pairing parameters as gzp_id_req_send() would, in entry 0. */
+static void device_setup(const gzp_sim_setup_t * p_setup)
+{
+    nrf_nvmc_write_bytes(GZP_PARAMS_STORAGE_ADR, p_setup->system_address, GZP_SYSTEM_ADDRESS_WIDTH);
+    nrf_nvmc_write_bytes(GZP_PARAMS_STORAGE_ADR + GZP_SYSTEM_ADDRESS_WIDTH, p_setup->host_id,
+                         GZP_HOST_ID_LENGTH);
+    nrf_nvmc_write_byte(GZP_PARAMS_STORAGE_ADR + INDEX_DB_OFFSET, 0xF0);
+
+    device_start();
+}
+
+
+/**@brief Function for running a turn of a Device. */
+static void device_turn(uint32_t index, const gzp_sim_run_t * p_run)
+{
+    gzp_sim_done_t done;
+    uint8_t        frame[GZP_SIM_FRAME_LENGTH];
+    uint32_t       i;
+
+    memset(&done, 0, sizeof(done));
+    gzp_port_time_set(p_run->time);
+    if (p_run->is_restart)
+    {
+        nrf_gzll_disable();
+        device_start();
+    }
+    for (i = 0; i < p_run->frame_count; i++)
+    {
+        gzp_sim_frame_fill(frame, index, p_run->first_sequence + i);
+        if (!gzp_crypt_data_send(frame, sizeof(frame)))
+        {
+            done.fail_count++;
+        }
+    }
+
+    done.time          = gzp_port_time_get();
+    done.channel_count = sizeof(done.channels);
+    (void)nrf_gzll_get_channel_table(done.channels, &done.channel_count);
+    gzp_port_stats_get(&done.stats);
+    gzp_port_send(0, GZP_SIM_MSG_DONE, &done, sizeof(done));
+}
+
+
+/**@brief Function for running a Device until the Host tells it to quit. */
+static void device_run(int fd, uint32_t index, uint32_t seed, bool is_reference, uint32_t duty)
+{
+    uint8_t  msg[GZP_PORT_MSG_SIZE_MAX];
+    uint32_t length;
+
+    gzp_port_device_init(fd, seed + index + 1);
+    gzp_port_reference_set(is_reference);
+    gzp_port_air_set(duty, seed);
+    for (;;)
+    {
+        switch (gzp_port_wait(0, msg, &length))
+        {
+            case GZP_SIM_MSG_SETUP:
+                device_setup((const gzp_sim_setup_t *)msg);
+                break;
+
+            case GZP_SIM_MSG_RUN:
+                device_turn(index, (const gzp_sim_run_t *)msg);
+                break;
+
+            case GZP_SIM_MSG_QUIT:
+            case GZP_PORT_MSG_CLOSED:
+                exit(0);
+
+            default:
+                fprintf(stderr, "gzp_sim: unexpected message\n");
+                exit(1);
+        }
+    }
+}
+
+
+int main(int argc, char * argv[])
+{
+    const char * p_host_path  = "./gzp_sim_host";
+    uint32_t     device_count = 1;
+    uint32_t     seed         = 1;
+    bool         is_reference = false;
+    uint32_t     duty         = 0;
+    int          fds[DEVICE_COUNT_MAX][2];
+    char         fd_arg[DEVICE_COUNT_MAX * 12];
+    char **      pp_host_argv;
+    int          status;
+    int          result = 0;
+    uint32_t     i;
+    int          opt;
+
+    while ((opt = getopt(argc, argv, "n:p:t:s:rw:Rh:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                device_count = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                is_reference = true;
+                break;
+            case 'w':
+                duty = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'h':
+                p_host_path = optarg;
+                break;
+            case 'p':
+            case 't':
+            case 'R':
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n devices] [-p frames] [-t turns] [-s seed] [-r] "
+                        "[-w duty] [-R] [-h gzp_sim_host]\n", argv[0]);
+                return 1;
+        }
+    }
+    if ((device_count == 0) || (device_count > DEVICE_COUNT_MAX))
+    {
+        fprintf(stderr, "gzp_sim: 1 to %d devices\n", DEVICE_COUNT_MAX);
+        return 1;
+    }
+
+    fd_arg[0] = '\0';
+    for (i = 0; i < device_count; i++)
+    {
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds[i]) != 0)
+        {
+            perror("socketpair");
+            return 1;
+        }
+        snprintf(fd_arg + strlen(fd_arg), sizeof(fd_arg) - strlen(fd_arg), "%s%d",
+                 (i == 0) ? "" : ",", fds[i][0]);
+    }
+
+    for (i = 0; i < device_count; i++)
+    {
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            uint32_t j;
+
+            for (j = 0; j < device_count; j++)
+            {
+                close(fds[j][0]);
+                if (j != i)
+                {
+                    close(fds[j][1]);
+                }
+            }
+            device_run(fds[i][1], i, seed, is_reference, duty);
+        }
+        if (pid < 0)
+        {
+            perror("fork");
+            return 1;
+        }
+        close(fds[i][1]);
+    }
+
+    // The Host takes the same options, and the sockets to the Devices.
+    pp_host_argv = calloc((size_t)argc + 3, sizeof(char *));
+    if (pp_host_argv == NULL)
+    {
+        return 1;
+    }
+    memcpy(pp_host_argv, argv, (size_t)argc * sizeof(char *));
+    pp_host_argv[0]        = (char *)p_host_path;
+    pp_host_argv[argc]     = "-f";
+    pp_host_argv[argc + 1] = fd_arg;
+
+    if (fork() == 0)
+    {
+        execv(p_host_path, pp_host_argv);
+        perror(p_host_path);
+        exit(1);
+    }
+    for (i = 0; i < device_count; i++)
+    {
+        close(fds[i][0]);
+    }
+
+    // The Host reports, the Devices exit when it closes their sockets.
+    while (wait(&status) > 0)
+    {
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        {
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Messages between the Host and the Devices of the Gazell Pairing simulation, see gzp_sim.c.
+ */
+
+#ifndef GZP_SIM_H__
+#define GZP_SIM_H__
+
+#include <stdint.h>
+#include "gzp_sim_port.h"
+#include "nrf_gzll.h"
+#include "nrf_gzp.h"
+
+#define GZP_SIM_MSG_SETUP   (GZP_PORT_MSG_APP + 0)      /**< Host to Device: pairing parameters, gzp_sim_setup_t. */
+#define GZP_SIM_MSG_RUN     (GZP_PORT_MSG_APP + 1)      /**< Host to Device: send frames, gzp_sim_run_t. */
+#define GZP_SIM_MSG_DONE    (GZP_PORT_MSG_APP + 2)      /**< Device to Host: frames sent, gzp_sim_done_t. */
+#define GZP_SIM_MSG_QUIT    (GZP_PORT_MSG_APP + 3)      /**< Host to Device: exit. */
+
+#define GZP_SIM_FRAME_LENGTH GZP_ENCRYPTED_USER_DATA_MAX_LENGTH /**< Length of a frame. */
+
+/**@brief Pairing parameters the Host gives a Device, instead of pairing in proximity. */
+typedef struct
+{
+    uint8_t system_address[GZP_SYSTEM_ADDRESS_WIDTH];   /**< System address of the Host. */
+    uint8_t host_id[GZP_HOST_ID_LENGTH];                /**< Host ID. */
+} gzp_sim_setup_t;
+
+/**@brief Turn of a Device. */
+typedef struct
+{
+    uint64_t time;                                      /**< Time the turn starts. */
+    uint32_t frame_count;                               /**< Frames to send. */
+    uint32_t first_sequence;                            /**< Sequence number of the first frame. */
+    bool     is_restart;                                /**< Restart Gazell and Gazell Pairing first, as after a reset. */
+} gzp_sim_run_t;
+
+/**@brief Result of a turn. */
+typedef struct
+{
+    uint64_t         time;                              /**< Time the turn ended. */
+    uint32_t         fail_count;                        /**< Frames gzp_crypt_data_send() failed. */
+    uint32_t         channel_count;                     /**< Size of the channel table. */
+    uint8_t          channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE]; /**< Channel table. */
+    gzp_port_stats_t stats;                             /**< Statistics of the Device. */
+} gzp_sim_done_t;
+
+/**@brief Function for filling a frame with its sequence number, which the Host checks. */
+static inline void gzp_sim_frame_fill(uint8_t * p_frame, uint32_t device, uint32_t sequence)
+{
+    uint32_t i;
+
+    p_frame[0] = (uint8_t)device;
+    p_frame[1] = (uint8_t)sequence;
+    p_frame[2] = (uint8_t)(sequence >> 8);
+    p_frame[3] = (uint8_t)(sequence >> 16);
+    for (i = 4; i < GZP_SIM_FRAME_LENGTH; i++)
+    {
+        p_frame[i] = (uint8_t)(sequence * i);
+    }
+}
+
+#endif // GZP_SIM_H__
@@ -0,0 +1,304 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host side of the Gazell Pairing simulation, started by gzp_sim, see gzp_sim.c for how to
+ *        build and run it.
+ *
+ * @details Takes the options of gzp_sim, and the sockets to the Devices with -f fd,fd,...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gzp_sim.h"
+#include "nrf_gzp_config.h"
+#include "nrf_nvmc.h"
+
+#define DEVICE_COUNT_MAX        16                  /**< Devices a Host can have, see gzp_sim_port.c. */
+#define HOST_ID_FLAG_OFFSET     0                   /**< Host ID written flag in the Host flash. */
+#define HOST_ID_OFFSET          1                   /**< Host ID in the Host flash. */
+#define CHIP_ID_OFFSET          (HOST_ID_OFFSET + GZP_HOST_ID_LENGTH + 1) /**< Chip ID, the system address, in the Host flash. */
+
+/**@brief State of a Device, as seen by the Host. */
+typedef struct
+{
+    uint32_t       sequence;                        /**< Sequence number of the next frame sent. */
+    uint32_t       expected;                        /**< Sequence number of the next frame expected. */
+    uint32_t       rx_count;                        /**< Frames received in order. */
+    uint32_t       bad_count;                       /**< Frames received out of order or corrupt. */
+    uint32_t       table_diff_count;                /**< Turns which ended with a channel table other than the Host's. */
+    gzp_sim_done_t done;                            /**< Result of the last turn. */
+} device_t;
+
+static device_t m_devices[DEVICE_COUNT_MAX];        /**< Devices. */
+static uint32_t m_device_count;                     /**< Number of Devices. */
+
+
+/**@brief Function for checking a frame received from the Device taking its turn. */
+static void frame_check(uint32_t index, const uint8_t * p_frame, uint8_t length)
+{
+    device_t * p_device = &m_devices[index];
+    uint8_t    expected[GZP_SIM_FRAME_LENGTH];
+
+    gzp_sim_frame_fill(expected, index, p_device->expected);
+    if ((length == sizeof(expected)) && (memcmp(p_frame, expected, sizeof(expected)) == 0))
+    {
+        p_device->expected++;
+        p_device->rx_count++;
+        return;
+    }
+
+    // A lost frame, the Device moved on to the next one.
+    gzp_sim_frame_fill(expected, index, p_device->expected + 1);
+    if ((length == sizeof(expected)) && (memcmp(p_frame, expected, sizeof(expected)) == 0))
+    {
+        p_device->expected += 2;
+        p_device->rx_count++;
+        return;
+    }
+    p_device->bad_count++;
+}
+
+
+/**@brief Function for running a turn of a Device, handling its packets until it is done. */
+static void host_turn(uint32_t index, uint32_t frame_count, bool is_restart)
+{
+    device_t *    p_device = &m_devices[index];
+    gzp_sim_run_t run;
+    uint8_t       msg[GZP_PORT_MSG_SIZE_MAX];
+    uint8_t       frame[GZP_ENCRYPTED_USER_DATA_MAX_LENGTH];
+    uint8_t       frame_length;
+    uint8_t       channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+    uint32_t      channel_count = sizeof(channels);
+    uint32_t      length;
+
+    memset(&run, 0, sizeof(run));
+    run.time           = gzp_port_time_get();
+    run.frame_count    = frame_count;
+    run.first_sequence = p_device->sequence;
+    run.is_restart     = is_restart;
+    p_device->expected = p_device->sequence;
+    p_device->sequence += frame_count;
+    gzp_port_send(index, GZP_SIM_MSG_RUN, &run, sizeof(run));
+
+    for (;;)
+    {
+        switch (gzp_port_wait(index, msg, &length))
+        {
+            case GZP_PORT_MSG_RADIO:
+                gzp_host_execute();
+                if (gzp_crypt_user_data_received())
+                {
+                    frame_length = sizeof(frame);
+                    if (gzp_crypt_user_data_read(frame, &frame_length))
+                    {
+                        frame_check(index, frame, frame_length);
+                    }
+                }
+                break;
+
+            case GZP_SIM_MSG_DONE:
+                memcpy(&p_device->done, msg, sizeof(p_device->done));
+                gzp_port_time_set(p_device->done.time);
+                (void)nrf_gzll_get_channel_table(channels, &channel_count);
+                if ((channel_count != p_device->done.channel_count) ||
+                    (memcmp(channels, p_device->done.channels, channel_count) != 0))
+                {
+                    p_device->table_diff_count++;
+                }
+                return;
+
+            default:
+                fprintf(stderr, "gzp_sim_host: Device %u left\n", (unsigned)index);
+                exit(1);
+        }
+    }
+}
+
+
+/**@brief Function for starting Gazell and Gazell Pairing on the Host, as after a reset. */
+static void host_start(void)
+{
+    (void)nrf_gzll_init(NRF_GZLL_MODE_HOST);
+    gzp_init();
+    gzll_rx_start();
+}
+
+
+/**@brief Function for printing a channel table. */
+static void table_print(const char * p_name, const uint8_t * p_channels, uint32_t channel_count)
+{
+    uint32_t i;
+
+    printf("%-8s", p_name);
+    for (i = 0; i < channel_count; i++)
+    {
+        printf(" %2u", (unsigned)p_channels[i]);
+    }
+    printf("\n");
+}
+
+
+/**@brief Function for printing the gzp_crypt() figures of one side. */
+static void crypt_report(const char * p_side, const gzp_port_stats_t * p_stats, uint32_t frame_count)
+{
+    printf("%-8s %12u %12u %14.2f %10.0f\n",
+           p_side,
+           (unsigned)p_stats->crypt_count,
+           (unsigned)p_stats->ecb_block_count,
+           (frame_count == 0) ? 0.0 : ((double)p_stats->ecb_block_count / frame_count),
+           (p_stats->crypt_count == 0) ? 0.0 : ((double)p_stats->crypt_ns / p_stats->crypt_count));
+}
+
+
+int main(int argc, char * argv[])
+{
+    int              fds[DEVICE_COUNT_MAX];
+    gzp_sim_setup_t  setup;
+    gzp_port_stats_t host_stats;
+    gzp_port_stats_t device_stats;
+    uint32_t         frame_count  = 1000;
+    uint32_t         turn_count   = 1;
+    uint32_t         seed         = 1;
+    bool             is_reference = false;
+    bool             is_restart   = false;
+    uint32_t         duty         = 0;
+    uint32_t         rx_count     = 0;
+    uint32_t         bad_count    = 0;
+    uint32_t         fail_count   = 0;
+    uint32_t         table_diff_count = 0;
+    uint8_t          channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+    uint32_t         channel_count = sizeof(channels);
+    char             name[16];
+    uint32_t         sent_count;
+    uint32_t         i;
+    uint32_t         turn;
+    char *           p_fd;
+    int              opt;
+
+    while ((opt = getopt(argc, argv, "n:p:t:s:rw:Rh:f:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                frame_count = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                turn_count = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                is_reference = true;
+                break;
+            case 'w':
+                duty = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'R':
+                is_restart = true;
+                break;
+            case 'f':
+                for (p_fd = strtok(optarg, ","); (p_fd != NULL) && (m_device_count < DEVICE_COUNT_MAX);
+                     p_fd = strtok(NULL, ","))
+                {
+                    fds[m_device_count++] = atoi(p_fd);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if (m_device_count == 0)
+    {
+        fprintf(stderr, "gzp_sim_host: started by gzp_sim\n");
+        return 1;
+    }
+
+    gzp_port_host_init(fds, m_device_count, seed);
+    gzp_port_reference_set(is_reference);
+
+    // Host ID as written by the first Host ID request, the chip ID is generated by gzp_init().
+    gzp_random_numbers_generate(setup.host_id, GZP_HOST_ID_LENGTH);
+    nrf_nvmc_write_bytes(GZP_PARAMS_STORAGE_ADR + HOST_ID_OFFSET, setup.host_id, GZP_HOST_ID_LENGTH);
+    nrf_nvmc_write_byte(GZP_PARAMS_STORAGE_ADR + HOST_ID_FLAG_OFFSET, 0x00);
+
+    host_start();
+    memcpy(setup.system_address, (uint8_t *)(GZP_PARAMS_STORAGE_ADR + CHIP_ID_OFFSET),
+           GZP_SYSTEM_ADDRESS_WIDTH);
+
+    for (i = 0; i < m_device_count; i++)
+    {
+        gzp_port_send(i, GZP_SIM_MSG_SETUP, &setup, sizeof(setup));
+    }
+    for (turn = 0; turn < turn_count; turn++)
+    {
+        if (is_restart && (turn != 0))
+        {
+            nrf_gzll_disable();
+            host_start();
+        }
+        for (i = 0; i < m_device_count; i++)
+        {
+            host_turn(i, frame_count, is_restart && (turn != 0));
+        }
+    }
+
+    memset(&device_stats, 0, sizeof(device_stats));
+    for (i = 0; i < m_device_count; i++)
+    {
+        const gzp_port_stats_t * p_stats = &m_devices[i].done.stats;
+
+        device_stats.tx_packet_count  += p_stats->tx_packet_count;
+        device_stats.tx_attempt_count += p_stats->tx_attempt_count;
+        device_stats.ecb_block_count  += p_stats->ecb_block_count;
+        device_stats.crypt_count      += p_stats->crypt_count;
+        device_stats.crypt_ns         += p_stats->crypt_ns;
+        rx_count                      += m_devices[i].rx_count;
+        bad_count                     += m_devices[i].bad_count;
+        fail_count                    += m_devices[i].done.fail_count;
+        table_diff_count              += m_devices[i].table_diff_count;
+        gzp_port_send(i, GZP_SIM_MSG_QUIT, NULL, 0);
+    }
+    gzp_port_stats_get(&host_stats);
+    sent_count = m_device_count * turn_count * frame_count;
+
+    printf("gzp_sim: %u devices, %u turns of %u frames, %s gzp_crypt()\n",
+           (unsigned)m_device_count, (unsigned)turn_count, (unsigned)frame_count,
+           is_reference ? "reference" : "cached");
+    printf("frames sent %u, received %u, lost %u, corrupt %u, send failures %u\n",
+           (unsigned)sent_count, (unsigned)rx_count, (unsigned)(sent_count - rx_count),
+           (unsigned)bad_count, (unsigned)fail_count);
+    printf("packets %u, attempts %u, time %llu timeslots\n",
+           (unsigned)device_stats.tx_packet_count, (unsigned)device_stats.tx_attempt_count,
+           (unsigned long long)gzp_port_time_get());
+    printf("%-8s %12s %12s %14s %10s\n", "side", "crypt calls", "ECB blocks", "blocks/frame", "ns/call");
+    crypt_report("device", &device_stats, sent_count);
+    crypt_report("host", &host_stats, sent_count);
+
+    printf("air %u per mille busy%s, channel updates %u, syncs %u, turns ending out of sync %u\n",
+           (unsigned)duty, is_restart ? ", restarts" : "",
+           (unsigned)host_stats.rx_cmd_count[GZP_CMD_CHANNEL_UPDATE],
+           (unsigned)host_stats.rx_cmd_count[GZP_CMD_CHANNEL_SYNC], (unsigned)table_diff_count);
+    (void)nrf_gzll_get_channel_table(channels, &channel_count);
+    table_print("host", channels, channel_count);
+    for (i = 0; i < m_device_count; i++)
+    {
+        snprintf(name, sizeof(name), "device%u", (unsigned)i);
+        table_print(name, m_devices[i].done.channels, m_devices[i].done.channel_count);
+    }
+
+    return ((rx_count == sent_count) && (bad_count == 0) && (table_diff_count == 0)) ? 0 : 1;
+}
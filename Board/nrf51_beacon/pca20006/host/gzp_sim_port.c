@@ -0,0 +1,1248 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include "gzp_sim_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <openssl/evp.h>
+#include "nrf_gzll.h"
+#include "nrf_gzp.h"
+#include "nrf_nvmc.h"
+#include "nrf_ecb.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+
+#define LINK_COUNT_MAX          16u                                 /**< Number of Devices a Host can have. */
+#define FLASH_PAGE_SIZE         1024u                               /**< Flash page size of the nRF51. */
+#define TIMESLOT_PERIOD_US      600u                                /**< Default Gazell timeslot period. */
+#define TIMESLOTS_PER_CHANNEL   2u                                  /**< Default attempts on one channel. */
+#define ACK_RSSI                (-50)                               /**< RSSI of every packet, within pairing proximity. */
+
+#define AIR_AP_WIDTH            10u                                 /**< Channels on each side of a Wi-Fi AP it disturbs, 20 MHz wide. */
+#define AIR_BURST               50u                                 /**< Timeslots an AP transmits in a burst. */
+#define AIR_OK_PERMILLE         980u                                /**< Attempts which get through a clear channel, per mille. */
+#define AIR_AP_LOSS_FACTOR      10u                                 /**< Attempts which get through divide by this per busy AP. */
+
+#define MSG_PACKET              0x02                                /**< Device to Host: transmission attempt. */
+#define MSG_ACK                 0x03                                /**< Host to Device: response to an attempt. */
+
+/**@brief Message on a link. */
+typedef struct
+{
+    uint8_t type;                                                   /**< Message type. */
+    uint8_t data[GZP_PORT_MSG_SIZE_MAX];                            /**< Message data. */
+} port_msg_t;
+
+/**@brief Transmission attempt of a Device. */
+typedef struct
+{
+    uint64_t time;                                                  /**< Time of the attempt. */
+    uint32_t base_address;                                          /**< Base address of the pipe. */
+    uint8_t  prefix;                                                /**< Prefix byte of the pipe. */
+    uint8_t  pipe;                                                  /**< Pipe. */
+    uint8_t  channel;                                               /**< Channel of the attempt. */
+    uint8_t  length;                                                /**< Payload length. */
+    uint8_t  payload[NRF_GZLL_CONST_MAX_PAYLOAD_LENGTH];            /**< Payload. */
+} port_packet_t;
+
+/**@brief Response of the Host to an attempt. */
+typedef struct
+{
+    uint8_t is_acked;                                               /**< The Host received the packet. */
+    uint8_t length;                                                 /**< ACK payload length, 0 for none. */
+    uint8_t payload[NRF_GZLL_CONST_MAX_PAYLOAD_LENGTH];             /**< ACK payload. */
+} port_ack_t;
+
+/**@brief Packet in a FIFO. */
+typedef struct
+{
+    uint8_t length;                                                 /**< Payload length. */
+    uint8_t payload[NRF_GZLL_CONST_MAX_PAYLOAD_LENGTH];             /**< Payload. */
+} port_fifo_packet_t;
+
+/**@brief TX or RX FIFO of a pipe. */
+typedef struct
+{
+    port_fifo_packet_t packets[NRF_GZLL_CONST_FIFO_LENGTH];         /**< Packets, in order. */
+    uint32_t           head;                                        /**< Index of the oldest packet. */
+    uint32_t           count;                                       /**< Number of packets. */
+} port_fifo_t;
+
+uint8_t gzp_port_flash[GZP_DEVICE_PARAMS_STORAGE_SIZE] __attribute__((aligned(FLASH_PAGE_SIZE)));
+
+static int                  m_fds[LINK_COUNT_MAX];                  /**< Sockets to the other side. */
+static uint32_t             m_link_count;                           /**< Number of links. */
+static uint32_t             m_rand_state;                           /**< State of the RNG. */
+static NRF_RNG_Type         m_rng;                                  /**< Emulated RNG registers. */
+static uint64_t             m_time;                                 /**< Emulated time in timeslots. */
+static gzp_port_stats_t     m_stats;                                /**< Statistics. */
+static bool                 m_is_reference;                         /**< Reference gzp_crypt() selected. */
+static gzp_key_select_t     m_key_select;                           /**< Key selected for the reference gzp_crypt(). */
+static uint32_t             m_ecb_irq_pending;                      /**< SWI3 of the ECB driver pending. */
+static uint8_t              m_critical_region;                      /**< Inside sd_nvic_critical_region_enter(). */
+static uint32_t             m_air_duty;                             /**< Share of the time the APs transmit, per mille, 0 for a clear air. */
+static uint32_t             m_air_seed;                             /**< Seed of the AP schedules, the same on all sides. */
+
+static nrf_gzll_mode_t      m_mode;                                 /**< Gazell mode. */
+static bool                 m_is_enabled;                           /**< Gazell enabled. */
+static nrf_gzll_error_code_t m_error_code;                          /**< Last Gazell error. */
+static uint32_t             m_base_address[2];                      /**< Base addresses 0 and 1. */
+static uint8_t              m_prefix[NRF_GZLL_CONST_PIPE_COUNT];    /**< Address prefix byte per pipe. */
+static uint32_t             m_rx_pipes;                             /**< Pipes the Host listens to. */
+static uint32_t             m_timeslot_period;                      /**< Timeslot period in microseconds. */
+static uint32_t             m_timeslots_per_channel;                /**< Attempts on a channel before the next. */
+static uint32_t             m_timeslots_out_of_sync;                /**< Kept for the getter only. */
+static uint32_t             m_sync_lifetime;                        /**< Kept for the getter only. */
+static uint16_t             m_max_tx_attempts;                      /**< Attempts per packet, 0 for no limit. */
+static nrf_gzll_device_channel_selection_policy_t m_policy;         /**< Channel a packet starts on. */
+static uint8_t              m_channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE]; /**< Channel table. */
+static uint32_t             m_channel_count;                        /**< Size of the channel table. */
+static nrf_gzll_tx_power_t  m_tx_power;                             /**< Kept for the getter only. */
+static nrf_gzll_datarate_t  m_datarate;                             /**< Kept for the getter only. */
+static nrf_gzll_xosc_ctl_t  m_xosc_ctl;                             /**< Kept for the getter only. */
+static uint32_t             m_auto_disable;                         /**< Ticks until the Host disables itself, 0 for never. */
+static uint32_t             m_tick_count;                           /**< Timeslots since enabled or cleared. */
+static uint32_t             m_slot;                                 /**< Channel table slot a Device is on. */
+static uint32_t             m_success_slot;                         /**< Slot of the last successful packet. */
+static port_fifo_t          m_tx_fifo[NRF_GZLL_CONST_PIPE_COUNT];   /**< TX FIFO per pipe. */
+static port_fifo_t          m_rx_fifo[NRF_GZLL_CONST_PIPE_COUNT];   /**< RX FIFO per pipe. */
+
+
+/**@brief Function for stopping on a broken link or an emulation error. */
+static void port_fail(const char * p_what)
+{
+    fprintf(stderr, "gzp_sim_port: %s\n", p_what);
+    exit(1);
+}
+
+
+/**@brief Function for generating the next pseudo random number. */
+static uint32_t rand_next(void)
+{
+    m_rand_state ^= m_rand_state << 13;
+    m_rand_state ^= m_rand_state >> 17;
+    m_rand_state ^= m_rand_state << 5;
+    return m_rand_state;
+}
+
+
+/**@brief Function for getting a monotonic time stamp in nanoseconds. */
+static uint64_t clock_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+}
+
+
+/**@brief Function for passing emulated time, running the Host auto disable. */
+static void time_advance(uint32_t timeslots)
+{
+    m_time += timeslots;
+    if (!m_is_enabled)
+    {
+        return;
+    }
+
+    m_tick_count += timeslots;
+    if ((m_mode == NRF_GZLL_MODE_HOST) && (m_auto_disable != 0) && (m_tick_count >= m_auto_disable))
+    {
+        nrf_gzll_disable();
+    }
+}
+
+
+static void fifo_flush(port_fifo_t * p_fifo)
+{
+    p_fifo->head  = 0;
+    p_fifo->count = 0;
+}
+
+
+static bool fifo_push(port_fifo_t * p_fifo, const uint8_t * p_payload, uint32_t length)
+{
+    port_fifo_packet_t * p_packet;
+
+    if (p_fifo->count == NRF_GZLL_CONST_FIFO_LENGTH)
+    {
+        return false;
+    }
+    p_packet = &p_fifo->packets[(p_fifo->head + p_fifo->count) % NRF_GZLL_CONST_FIFO_LENGTH];
+    p_packet->length = (uint8_t)length;
+    memcpy(p_packet->payload, p_payload, length);
+    p_fifo->count++;
+    return true;
+}
+
+
+static port_fifo_packet_t * fifo_peek(port_fifo_t * p_fifo)
+{
+    return (p_fifo->count == 0) ? NULL : &p_fifo->packets[p_fifo->head];
+}
+
+
+static void fifo_pop(port_fifo_t * p_fifo)
+{
+    p_fifo->head = (p_fifo->head + 1) % NRF_GZLL_CONST_FIFO_LENGTH;
+    p_fifo->count--;
+}
+
+
+/**@brief Function for sending a message on a link. */
+static void msg_send(uint32_t link, uint8_t type, const void * p_data, uint32_t length)
+{
+    port_msg_t msg;
+
+    msg.type = type;
+    memcpy(msg.data, p_data, length);
+    if (send(m_fds[link], &msg, 1 + length, 0) != (ssize_t)(1 + length))
+    {
+        port_fail("send failed");
+    }
+}
+
+
+/**@brief Function for receiving the next message on a link.
+ *
+ * @return Message type, GZP_PORT_MSG_CLOSED if the other side closed the link.
+ */
+static uint8_t msg_receive(uint32_t link, void * p_data, uint32_t * p_length)
+{
+    port_msg_t msg;
+    ssize_t    size;
+
+    do
+    {
+        size = recv(m_fds[link], &msg, sizeof(msg), 0);
+    } while ((size < 0) && (errno == EINTR));
+
+    if (size <= 0)
+    {
+        *p_length = 0;
+        return GZP_PORT_MSG_CLOSED;
+    }
+    *p_length = (uint32_t)(size - 1);
+    memcpy(p_data, msg.data, *p_length);
+    return msg.type;
+}
+
+
+/**@brief Function for telling if a Wi-Fi AP transmits in a burst period.
+ *
+ * @details The schedule depends on the time only, so that every Device sees the same air.
+ */
+static bool air_ap_busy(uint32_t ap, uint64_t burst)
+{
+    uint32_t hash = m_air_seed ^ (ap * 0x9E3779B9u) ^ (uint32_t)(burst * 0x85EBCA6Bu) ^
+                    (uint32_t)(burst >> 32);
+
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+    return ((hash % 1000u) < m_air_duty);
+}
+
+
+/**@brief Function for telling if an attempt on a channel gets through the air.
+ *
+ * @details Wi-Fi APs on channels 1, 6 and 13 transmit in bursts of AIR_BURST timeslots, for
+ *          m_air_duty of the time. Each one busy within AIR_AP_WIDTH of the channel divides the
+ *          chance of the attempt by AIR_AP_LOSS_FACTOR. Channels 23 to 26 and 48 to 61 stay clear.
+ */
+static bool air_attempt_ok(uint8_t channel)
+{
+    static const uint8_t ap_channels[] = {12, 37, 72};
+    uint32_t             ok_permille   = AIR_OK_PERMILLE;
+    uint32_t             ap;
+
+    if (m_air_duty == 0)
+    {
+        return true;
+    }
+    for (ap = 0; ap < sizeof(ap_channels); ap++)
+    {
+        if ((abs((int)channel - (int)ap_channels[ap]) <= (int)AIR_AP_WIDTH) &&
+            air_ap_busy(ap, m_time / AIR_BURST))
+        {
+            ok_permille /= AIR_AP_LOSS_FACTOR;
+        }
+    }
+    return ((rand_next() % 1000u) < ok_permille);
+}
+
+
+/**@brief Function for getting the address of a pipe, base address and prefix byte. */
+static void pipe_address_get(uint32_t pipe, uint32_t * p_base, uint8_t * p_prefix)
+{
+    *p_base   = m_base_address[(pipe == 0) ? 0 : 1];
+    *p_prefix = m_prefix[pipe];
+}
+
+
+/**@brief Function for making one transmission attempt of a Device.
+ *
+ * @return true if the Host acknowledged the packet.
+ */
+static bool device_attempt(uint32_t pipe, uint8_t channel, const port_fifo_packet_t * p_packet,
+                           port_ack_t * p_ack)
+{
+    port_packet_t packet;
+    uint32_t      length;
+
+    // The packet or its ACK got lost, the Host state is the same either way.
+    if (!air_attempt_ok(channel))
+    {
+        return false;
+    }
+
+    memset(&packet, 0, sizeof(packet));
+    packet.time    = m_time;
+    pipe_address_get(pipe, &packet.base_address, &packet.prefix);
+    packet.pipe    = (uint8_t)pipe;
+    packet.channel = channel;
+    packet.length  = p_packet->length;
+    memcpy(packet.payload, p_packet->payload, p_packet->length);
+
+    msg_send(0, MSG_PACKET, &packet, sizeof(packet));
+    if ((msg_receive(0, p_ack, &length) != MSG_ACK) || (length != sizeof(*p_ack)))
+    {
+        port_fail("no ACK from the Host");
+    }
+    return (p_ack->is_acked != 0);
+}
+
+
+/**@brief Function for transmitting the next packet of a Device, as the radio would while the CPU
+ *        sleeps, and calling the Gazell callback.
+ *
+ * @return false if there is no packet to transmit.
+ */
+static bool device_tx(void)
+{
+    nrf_gzll_device_tx_info_t tx_info;
+    port_fifo_packet_t *      p_packet = NULL;
+    port_ack_t                ack;
+    uint32_t                  pipe;
+    uint32_t                  slot;
+    uint32_t                  attempts_on_channel = 0;
+    bool                      is_acked            = false;
+
+    for (pipe = 0; pipe < NRF_GZLL_CONST_PIPE_COUNT; pipe++)
+    {
+        p_packet = fifo_peek(&m_tx_fifo[pipe]);
+        if (p_packet != NULL)
+        {
+            break;
+        }
+    }
+    if (p_packet == NULL)
+    {
+        return false;
+    }
+
+    memset(&tx_info, 0, sizeof(tx_info));
+    slot = (m_policy == NRF_GZLL_DEVICE_CHANNEL_SELECTION_POLICY_USE_SUCCESSFUL) ? m_success_slot : m_slot;
+    for (;;)
+    {
+        if (attempts_on_channel == m_timeslots_per_channel)
+        {
+            slot                = (slot + 1) % m_channel_count;
+            attempts_on_channel = 0;
+            tx_info.num_channel_switches++;
+        }
+        attempts_on_channel++;
+        tx_info.num_tx_attempts++;
+        m_stats.tx_attempt_count++;
+        time_advance(1);
+
+        if (device_attempt(pipe, m_channels[slot], p_packet, &ack))
+        {
+            is_acked = true;
+            break;
+        }
+        if ((m_max_tx_attempts != 0) && (tx_info.num_tx_attempts >= m_max_tx_attempts))
+        {
+            break;
+        }
+    }
+
+    m_slot = slot;
+    fifo_pop(&m_tx_fifo[pipe]);
+    m_stats.tx_packet_count++;
+    tx_info.rssi = ACK_RSSI;
+
+    if (is_acked)
+    {
+        m_success_slot = slot;
+        if (ack.length != 0)
+        {
+            if (fifo_push(&m_rx_fifo[pipe], ack.payload, ack.length))
+            {
+                tx_info.payload_received_in_ack = true;
+            }
+            else
+            {
+                m_error_code = NRF_GZLL_ERROR_CODE_NO_SPACE_IN_RX_FIFO_FOR_ACK;
+            }
+        }
+        nrf_gzll_device_tx_success(pipe, tx_info);
+    }
+    else
+    {
+        m_stats.tx_fail_count++;
+        nrf_gzll_device_tx_failed(pipe, tx_info);
+    }
+    return true;
+}
+
+
+/**@brief Function for receiving a transmission attempt on the Host and building the response. */
+static void host_rx(const port_packet_t * p_packet, port_ack_t * p_ack)
+{
+    nrf_gzll_host_rx_info_t rx_info;
+    port_fifo_packet_t *    p_ack_packet;
+    uint32_t                pipe = p_packet->pipe;
+    uint32_t                base;
+    uint8_t                 prefix;
+    uint32_t                i;
+    bool                    is_on_channel = false;
+
+    memset(p_ack, 0, sizeof(*p_ack));
+    if (m_time < p_packet->time)
+    {
+        time_advance((uint32_t)(p_packet->time - m_time));
+    }
+
+    if (!m_is_enabled || (m_mode != NRF_GZLL_MODE_HOST) || (pipe >= NRF_GZLL_CONST_PIPE_COUNT) ||
+        ((m_rx_pipes & (1u << pipe)) == 0))
+    {
+        return;
+    }
+    pipe_address_get(pipe, &base, &prefix);
+    if ((base != p_packet->base_address) || (prefix != p_packet->prefix))
+    {
+        return;
+    }
+    // The Host hops over its table on its own, it is taken to hear every channel of it.
+    for (i = 0; i < m_channel_count; i++)
+    {
+        is_on_channel = is_on_channel || (m_channels[i] == p_packet->channel);
+    }
+    if (!is_on_channel || !fifo_push(&m_rx_fifo[pipe], p_packet->payload, p_packet->length))
+    {
+        return;
+    }
+
+    p_ack->is_acked = 1;
+    m_stats.rx_packet_count++;
+    if ((p_packet->length != 0) && (p_packet->payload[0] < 16))
+    {
+        m_stats.rx_cmd_count[p_packet->payload[0]]++;
+    }
+
+    p_ack_packet = fifo_peek(&m_tx_fifo[pipe]);
+    rx_info.packet_removed_from_tx_fifo = (p_ack_packet != NULL);
+    rx_info.rssi                        = ACK_RSSI;
+    if (p_ack_packet != NULL)
+    {
+        p_ack->length = p_ack_packet->length;
+        memcpy(p_ack->payload, p_ack_packet->payload, p_ack_packet->length);
+        fifo_pop(&m_tx_fifo[pipe]);
+    }
+    m_tick_count = 0;
+    nrf_gzll_host_rx_data_ready(pipe, rx_info);
+}
+
+
+/**@brief Function for the gzp_crypt() of the SDK, one ECB block per call and a bytewise XOR. */
+static void reference_crypt(uint8_t * p_dst, const uint8_t * p_src, uint8_t length)
+{
+    static const uint8_t secret_key[16] = GZP_SECRET_KEY;
+    uint8_t              key[16];
+    uint8_t              iv[16];
+    uint8_t              i;
+
+    memcpy(key, secret_key, sizeof(key));
+    switch (m_key_select)
+    {
+        case GZP_ID_EXCHANGE:
+            break;
+        case GZP_KEY_EXCHANGE:
+            gzp_get_host_id(key);
+            break;
+        case GZP_DATA_EXCHANGE:
+            gzp_crypt_get_dyn_key(key);
+            break;
+        default:
+            return;
+    }
+
+    memset(iv, 0, sizeof(iv));
+    gzp_crypt_get_session_token(iv);
+
+    (void)nrf_ecb_init();
+    nrf_ecb_set_key(key);
+    (void)nrf_ecb_crypt(iv, iv);
+
+    for (i = 0; i < length; i++)
+    {
+        p_dst[i] = p_src[i] ^ iv[i];
+    }
+}
+
+
+void __real_gzp_crypt(uint8_t * dst, const uint8_t * src, uint8_t length);
+void __real_gzp_crypt_select_key(gzp_key_select_t key_select);
+
+
+/**@brief Function for timing gzp_crypt(), linked with -Wl,--wrap=gzp_crypt. */
+void __wrap_gzp_crypt(uint8_t * dst, const uint8_t * src, uint8_t length)
+{
+    uint64_t start = clock_ns();
+
+    if (m_is_reference)
+    {
+        reference_crypt(dst, src, length);
+    }
+    else
+    {
+        __real_gzp_crypt(dst, src, length);
+    }
+    m_stats.crypt_ns += clock_ns() - start;
+    m_stats.crypt_count++;
+}
+
+
+/**@brief Function for tracking the key selection, linked with -Wl,--wrap=gzp_crypt_select_key. */
+void __wrap_gzp_crypt_select_key(gzp_key_select_t key_select)
+{
+    m_key_select = key_select;
+    __real_gzp_crypt_select_key(key_select);
+}
+
+
+static void port_init(const int * p_fds, uint32_t count, uint32_t seed, nrf_gzll_mode_t mode)
+{
+    static const uint8_t channels[] = NRF_GZLL_DEFAULT_CHANNEL_TABLE;
+
+    if ((count == 0) || (count > LINK_COUNT_MAX))
+    {
+        port_fail("bad number of links");
+    }
+    memcpy(m_fds, p_fds, count * sizeof(int));
+    m_link_count = count;
+    m_rand_state = (seed != 0) ? seed : 1;
+    memset(gzp_port_flash, 0xFF, sizeof(gzp_port_flash));
+
+    m_mode                   = mode;
+    m_base_address[0]        = NRF_GZLL_DEFAULT_BASE_ADDRESS_0;
+    m_base_address[1]        = NRF_GZLL_DEFAULT_BASE_ADDRESS_1;
+    m_rx_pipes               = 0;
+    m_timeslot_period        = TIMESLOT_PERIOD_US;
+    m_timeslots_per_channel  = TIMESLOTS_PER_CHANNEL;
+    m_timeslots_out_of_sync  = 15;
+    m_policy                 = NRF_GZLL_DEVICE_CHANNEL_SELECTION_POLICY_USE_SUCCESSFUL;
+    m_tx_power               = NRF_GZLL_DEFAULT_TX_POWER;
+    m_datarate               = NRF_GZLL_DEFAULT_DATARATE;
+    m_channel_count          = sizeof(channels);
+    memcpy(m_channels, channels, sizeof(channels));
+}
+
+
+void gzp_port_device_init(int fd, uint32_t seed)
+{
+    port_init(&fd, 1, seed, NRF_GZLL_MODE_DEVICE);
+}
+
+
+void gzp_port_host_init(const int * p_fds, uint32_t count, uint32_t seed)
+{
+    port_init(p_fds, count, seed, NRF_GZLL_MODE_HOST);
+}
+
+
+void gzp_port_send(uint32_t link, uint8_t type, const void * p_data, uint32_t length)
+{
+    msg_send(link, type, p_data, length);
+}
+
+
+uint8_t gzp_port_wait(uint32_t link, void * p_data, uint32_t * p_length)
+{
+    uint8_t    data[GZP_PORT_MSG_SIZE_MAX];
+    uint8_t    type;
+    port_ack_t ack;
+
+    type = msg_receive(link, data, p_length);
+    if (type != MSG_PACKET)
+    {
+        memcpy(p_data, data, *p_length);
+        return type;
+    }
+
+    host_rx((const port_packet_t *)data, &ack);
+    msg_send(link, MSG_ACK, &ack, sizeof(ack));
+    *p_length = 0;
+    return GZP_PORT_MSG_RADIO;
+}
+
+
+uint64_t gzp_port_time_get(void)
+{
+    return m_time;
+}
+
+
+void gzp_port_time_set(uint64_t time)
+{
+    if (time > m_time)
+    {
+        time_advance((uint32_t)(time - m_time));
+    }
+}
+
+
+void gzp_port_reference_set(bool is_reference)
+{
+    m_is_reference = is_reference;
+}
+
+
+void gzp_port_air_set(uint32_t duty, uint32_t seed)
+{
+    m_air_duty = duty;
+    m_air_seed = seed;
+}
+
+
+void gzp_port_stats_get(gzp_port_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+
+void host_wfe(void)
+{
+    // On a Device the radio works while the CPU sleeps, which ends with the Gazell callback.
+    if ((m_mode == NRF_GZLL_MODE_DEVICE) && m_is_enabled && device_tx())
+    {
+        return;
+    }
+    time_advance(1);
+}
+
+
+void host_delay_us(uint32_t number_of_us)
+{
+    time_advance(number_of_us / m_timeslot_period);
+}
+
+
+NRF_RNG_Type * gzp_port_rng(void)
+{
+    m_rng.EVENTS_VALRDY = 1;
+    // VALUE is read only to the application.
+    *(uint32_t *)&m_rng.VALUE = rand_next() & 0xFF;
+    return &m_rng;
+}
+
+
+/**@brief Function for getting the emulated flash byte at an address, stopping outside the page. */
+static uint8_t * flash_byte_get(uint32_t address)
+{
+    uint32_t offset = address - GZP_PARAMS_STORAGE_ADR;
+
+    if (offset >= sizeof(gzp_port_flash))
+    {
+        port_fail("flash access outside the parameter page");
+    }
+    return &gzp_port_flash[offset];
+}
+
+
+void nrf_nvmc_page_erase(uint32_t address)
+{
+    if ((address & (FLASH_PAGE_SIZE - 1)) != 0)
+    {
+        port_fail("page erase not on a page boundary");
+    }
+    memset(flash_byte_get(address), 0xFF, FLASH_PAGE_SIZE);
+}
+
+
+void nrf_nvmc_write_byte(uint32_t address, uint8_t value)
+{
+    // Programming only clears bits.
+    *flash_byte_get(address) &= value;
+}
+
+
+void nrf_nvmc_write_word(uint32_t address, uint32_t value)
+{
+    uint32_t i;
+
+    if ((address & 3) != 0)
+    {
+        port_fail("unaligned word write");
+    }
+    for (i = 0; i < sizeof(value); i++)
+    {
+        nrf_nvmc_write_byte(address + i, (uint8_t)(value >> (i * 8)));
+    }
+}
+
+
+void nrf_nvmc_write_bytes(uint32_t address, const uint8_t * src, uint32_t num_bytes)
+{
+    uint32_t i;
+
+    for (i = 0; i < num_bytes; i++)
+    {
+        nrf_nvmc_write_byte(address + i, src[i]);
+    }
+}
+
+
+void nrf_nvmc_write_words(uint32_t address, const uint32_t * src, uint32_t num_words)
+{
+    uint32_t i;
+
+    for (i = 0; i < num_words; i++)
+    {
+        nrf_nvmc_write_word(address + (i * sizeof(uint32_t)), src[i]);
+    }
+}
+
+
+uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t * p_ecb_data)
+{
+    EVP_CIPHER_CTX * p_ctx = EVP_CIPHER_CTX_new();
+    int              length;
+
+    if ((p_ctx == NULL)                                                                     ||
+        !EVP_EncryptInit_ex(p_ctx, EVP_aes_128_ecb(), NULL, p_ecb_data->key, NULL)          ||
+        !EVP_CIPHER_CTX_set_padding(p_ctx, 0)                                               ||
+        !EVP_EncryptUpdate(p_ctx, p_ecb_data->ciphertext, &length, p_ecb_data->cleartext, 16))
+    {
+        port_fail("AES failed");
+    }
+    EVP_CIPHER_CTX_free(p_ctx);
+    m_stats.ecb_block_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_SetPendingIRQ(IRQn_Type IRQn)
+{
+    m_ecb_irq_pending = 1;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    m_ecb_irq_pending = 0;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_GetPendingIRQ(IRQn_Type IRQn, uint32_t * p_pending_irq)
+{
+    *p_pending_irq = m_ecb_irq_pending;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, nrf_app_irq_priority_t priority)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region)
+{
+    *p_is_nested_critical_region = m_critical_region;
+    m_critical_region            = 1;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region)
+{
+    m_critical_region = is_nested_critical_region;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_app_evt_wait(void)
+{
+    // The ECB driver takes its pending interrupt itself from nrf_ecb_job_run().
+    return NRF_SUCCESS;
+}
+
+
+bool nrf_gzll_init(nrf_gzll_mode_t mode)
+{
+    uint32_t pipe;
+
+    m_mode         = mode;
+    m_is_enabled   = false;
+    m_error_code   = NRF_GZLL_ERROR_CODE_NO_ERROR;
+    m_prefix[0]    = NRF_GZLL_DEFAULT_PREFIX_BYTE_0;
+    m_prefix[1]    = NRF_GZLL_DEFAULT_PREFIX_BYTE_1;
+    for (pipe = 2; pipe < NRF_GZLL_CONST_PIPE_COUNT; pipe++)
+    {
+        m_prefix[pipe] = (uint8_t)(pipe + 1);
+    }
+    for (pipe = 0; pipe < NRF_GZLL_CONST_PIPE_COUNT; pipe++)
+    {
+        fifo_flush(&m_tx_fifo[pipe]);
+        fifo_flush(&m_rx_fifo[pipe]);
+    }
+    return true;
+}
+
+
+bool nrf_gzll_enable(void)
+{
+    m_is_enabled = true;
+    m_tick_count = 0;
+    return true;
+}
+
+
+void nrf_gzll_disable(void)
+{
+    if (m_is_enabled)
+    {
+        m_is_enabled = false;
+        nrf_gzll_disabled();
+    }
+}
+
+
+bool nrf_gzll_is_enabled(void)
+{
+    return m_is_enabled;
+}
+
+
+/**@brief Function for checking that Gazell may be configured. */
+static bool config_allowed(void)
+{
+    if (m_is_enabled)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_ATTEMPTED_TO_CONFIGURE_WHEN_ENABLED;
+        return false;
+    }
+    return true;
+}
+
+
+bool nrf_gzll_add_packet_to_tx_fifo(uint32_t pipe, uint8_t * payload, uint32_t length)
+{
+    if (pipe >= NRF_GZLL_CONST_PIPE_COUNT)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_INVALID_PIPE;
+        return false;
+    }
+    if (length > NRF_GZLL_CONST_MAX_PAYLOAD_LENGTH)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_INVALID_PAYLOAD_LENGTH;
+        return false;
+    }
+    if (!fifo_push(&m_tx_fifo[pipe], payload, length))
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_ATTEMPTED_TO_ADD_TO_FULL_FIFO;
+        return false;
+    }
+    return true;
+}
+
+
+bool nrf_gzll_fetch_packet_from_rx_fifo(uint32_t pipe, uint8_t * payload, uint32_t * length)
+{
+    port_fifo_packet_t * p_packet;
+
+    if (pipe >= NRF_GZLL_CONST_PIPE_COUNT)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_INVALID_PIPE;
+        return false;
+    }
+    p_packet = fifo_peek(&m_rx_fifo[pipe]);
+    if (p_packet == NULL)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_ATTEMPTED_TO_FETCH_FROM_EMPTY_FIFO;
+        return false;
+    }
+    if (p_packet->length > *length)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_INVALID_PAYLOAD_LENGTH;
+        return false;
+    }
+    memcpy(payload, p_packet->payload, p_packet->length);
+    *length = p_packet->length;
+    fifo_pop(&m_rx_fifo[pipe]);
+    return true;
+}
+
+
+int32_t nrf_gzll_get_tx_fifo_packet_count(uint32_t pipe)
+{
+    return (pipe < NRF_GZLL_CONST_PIPE_COUNT) ? (int32_t)m_tx_fifo[pipe].count : -1;
+}
+
+
+int32_t nrf_gzll_get_rx_fifo_packet_count(uint32_t pipe)
+{
+    return (pipe < NRF_GZLL_CONST_PIPE_COUNT) ? (int32_t)m_rx_fifo[pipe].count : -1;
+}
+
+
+uint32_t nrf_gzll_get_total_allocated_packet_count(void)
+{
+    uint32_t count = 0;
+    uint32_t pipe;
+
+    for (pipe = 0; pipe < NRF_GZLL_CONST_PIPE_COUNT; pipe++)
+    {
+        count += m_tx_fifo[pipe].count + m_rx_fifo[pipe].count;
+    }
+    return count;
+}
+
+
+bool nrf_gzll_ok_to_add_packet_to_tx_fifo(uint32_t pipe)
+{
+    return (pipe < NRF_GZLL_CONST_PIPE_COUNT) && (m_tx_fifo[pipe].count < NRF_GZLL_CONST_FIFO_LENGTH);
+}
+
+
+bool nrf_gzll_flush_tx_fifo(uint32_t pipe)
+{
+    if (pipe >= NRF_GZLL_CONST_PIPE_COUNT)
+    {
+        return false;
+    }
+    fifo_flush(&m_tx_fifo[pipe]);
+    return true;
+}
+
+
+bool nrf_gzll_flush_rx_fifo(uint32_t pipe)
+{
+    if (pipe >= NRF_GZLL_CONST_PIPE_COUNT)
+    {
+        return false;
+    }
+    fifo_flush(&m_rx_fifo[pipe]);
+    return true;
+}
+
+
+bool nrf_gzll_set_mode(nrf_gzll_mode_t mode)
+{
+    if (!config_allowed())
+    {
+        return false;
+    }
+    m_mode = mode;
+    return true;
+}
+
+
+nrf_gzll_mode_t nrf_gzll_get_mode(void)
+{
+    return m_mode;
+}
+
+
+bool nrf_gzll_set_base_address_0(uint32_t base_address)
+{
+    if (!config_allowed())
+    {
+        return false;
+    }
+    m_base_address[0] = base_address;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_base_address_0(void)
+{
+    return m_base_address[0];
+}
+
+
+bool nrf_gzll_set_base_address_1(uint32_t base_address)
+{
+    if (!config_allowed())
+    {
+        return false;
+    }
+    m_base_address[1] = base_address;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_base_address_1(void)
+{
+    return m_base_address[1];
+}
+
+
+bool nrf_gzll_set_address_prefix_byte(uint32_t pipe, uint8_t address_prefix_byte)
+{
+    if (!config_allowed() || (pipe >= NRF_GZLL_CONST_PIPE_COUNT))
+    {
+        return false;
+    }
+    m_prefix[pipe] = address_prefix_byte;
+    return true;
+}
+
+
+bool nrf_gzll_get_address_prefix_byte(uint32_t pipe, uint8_t * out_address_prefix_byte)
+{
+    if (pipe >= NRF_GZLL_CONST_PIPE_COUNT)
+    {
+        return false;
+    }
+    *out_address_prefix_byte = m_prefix[pipe];
+    return true;
+}
+
+
+bool nrf_gzll_set_rx_pipes_enabled(uint32_t pipes)
+{
+    m_rx_pipes = pipes;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_rx_pipes_enabled(void)
+{
+    return m_rx_pipes;
+}
+
+
+bool nrf_gzll_set_timeslot_period(uint32_t period_us)
+{
+    if (!config_allowed() || (period_us == 0))
+    {
+        return false;
+    }
+    m_timeslot_period = period_us;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_timeslot_period(void)
+{
+    return m_timeslot_period;
+}
+
+
+bool nrf_gzll_set_device_channel_selection_policy(nrf_gzll_device_channel_selection_policy_t policy)
+{
+    m_policy = policy;
+    return true;
+}
+
+
+nrf_gzll_device_channel_selection_policy_t nrf_gzll_get_device_channel_selection_policy(void)
+{
+    return m_policy;
+}
+
+
+bool nrf_gzll_set_timeslots_per_channel(uint32_t timeslots)
+{
+    if (!config_allowed() || (timeslots == 0))
+    {
+        return false;
+    }
+    m_timeslots_per_channel = timeslots;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_timeslots_per_channel(void)
+{
+    return m_timeslots_per_channel;
+}
+
+
+bool nrf_gzll_set_timeslots_per_channel_when_device_out_of_sync(uint32_t timeslots)
+{
+    m_timeslots_out_of_sync = timeslots;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_timeslots_per_channel_when_device_out_of_sync(void)
+{
+    return m_timeslots_out_of_sync;
+}
+
+
+bool nrf_gzll_set_sync_lifetime(uint32_t lifetime)
+{
+    m_sync_lifetime = lifetime;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_sync_lifetime(void)
+{
+    return m_sync_lifetime;
+}
+
+
+bool nrf_gzll_set_max_tx_attempts(uint16_t max_tx_attempts)
+{
+    m_max_tx_attempts = max_tx_attempts;
+    return true;
+}
+
+
+uint16_t nrf_gzll_get_max_tx_attempts(void)
+{
+    return m_max_tx_attempts;
+}
+
+
+bool nrf_gzll_set_channel_table(uint8_t * channel_table, uint32_t size)
+{
+    if (!config_allowed())
+    {
+        return false;
+    }
+    if ((size == 0) || (size > NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE))
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_INVALID_CHANNEL_TABLE_SIZE;
+        return false;
+    }
+    memcpy(m_channels, channel_table, size);
+    m_channel_count = size;
+    m_slot          = 0;
+    m_success_slot  = 0;
+    return true;
+}
+
+
+bool nrf_gzll_get_channel_table(uint8_t * channel_table, uint32_t * size)
+{
+    if (*size < m_channel_count)
+    {
+        m_error_code = NRF_GZLL_ERROR_CODE_INVALID_CHANNEL_TABLE_SIZE;
+        return false;
+    }
+    memcpy(channel_table, m_channels, m_channel_count);
+    *size = m_channel_count;
+    return true;
+}
+
+
+uint32_t nrf_gzll_get_channel_table_size(void)
+{
+    return m_channel_count;
+}
+
+
+bool nrf_gzll_set_tx_power(nrf_gzll_tx_power_t tx_power)
+{
+    m_tx_power = tx_power;
+    return true;
+}
+
+
+nrf_gzll_tx_power_t nrf_gzll_get_tx_power(void)
+{
+    return m_tx_power;
+}
+
+
+bool nrf_gzll_set_datarate(nrf_gzll_datarate_t data_rate)
+{
+    if (!config_allowed())
+    {
+        return false;
+    }
+    m_datarate = data_rate;
+    return true;
+}
+
+
+nrf_gzll_datarate_t nrf_gzll_get_datarate(void)
+{
+    return m_datarate;
+}
+
+
+bool nrf_gzll_set_xosc_ctl(nrf_gzll_xosc_ctl_t xosc_ctl)
+{
+    m_xosc_ctl = xosc_ctl;
+    return true;
+}
+
+
+nrf_gzll_xosc_ctl_t nrf_gzll_get_xosc_ctl(void)
+{
+    return m_xosc_ctl;
+}
+
+
+void nrf_gzll_set_auto_disable(uint32_t num_ticks)
+{
+    m_auto_disable = num_ticks;
+}
+
+
+uint32_t nrf_gzll_get_tick_count(void)
+{
+    return m_tick_count;
+}
+
+
+void nrf_gzll_clear_tick_count(void)
+{
+    m_tick_count = 0;
+}
+
+
+nrf_gzll_error_code_t nrf_gzll_get_error_code(void)
+{
+    return m_error_code;
+}
+
+
+void nrf_gzll_reset_error_code(void)
+{
+    m_error_code = NRF_GZLL_ERROR_CODE_NO_ERROR;
+}
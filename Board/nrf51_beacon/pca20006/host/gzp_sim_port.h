@@ -0,0 +1,131 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host platform of the Gazell Pairing simulation, see gzp_sim.c.
+ *
+ * @details Replaces the Gazell link layer, the NVMC, the RNG and the SoftDevice ECB calls for one
+ *          side of the link, a Device or the Host. Each Device is a process with a socket to the
+ *          Host process. Every transmission attempt of a Device is a message to the Host, which
+ *          answers with the ACK and the ACK payload if it listens to the address, pipe and
+ *          channel. Gazell walks the channel table as on the target: timeslots per channel
+ *          attempts on a channel, then the next one, starting on the last successful channel.
+ *
+ *          Time is counted in Gazell timeslots. A Device spends one per attempt and one per
+ *          emulated interrupt it waits for, and passes its time to the Host with every packet.
+ *
+ *          The program runs single threaded. A Device transmits the packets in its TX FIFO when
+ *          it waits with __WFI, and calls the Gazell callbacks from there. The Host handles
+ *          packets from @ref gzp_port_wait.
+ *
+ *          gzp_crypt() is timed, and @ref gzp_port_reference_set swaps in the implementation that
+ *          ran one ECB block per call, to compare against.
+ */
+
+#ifndef GZP_SIM_PORT_H__
+#define GZP_SIM_PORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GZP_PORT_MSG_RADIO      0x00                /**< A Host handled a radio packet, run gzp_host_execute(). */
+#define GZP_PORT_MSG_CLOSED     0x01                /**< The other side closed the link. */
+#define GZP_PORT_MSG_APP        0x10                /**< First message type free for the application. */
+#define GZP_PORT_MSG_SIZE_MAX   240                 /**< Largest application message. */
+
+/**@brief Statistics of one side. */
+typedef struct
+{
+    uint32_t tx_packet_count;                       /**< Packets sent, Device. */
+    uint32_t tx_fail_count;                         /**< Packets which ran out of attempts, Device. */
+    uint32_t tx_attempt_count;                      /**< Transmission attempts, Device. */
+    uint32_t rx_packet_count;                       /**< Packets received, Host. */
+    uint32_t rx_cmd_count[16];                      /**< Packets received per gzp command, by the first byte, Host. */
+    uint32_t ecb_block_count;                       /**< Blocks encrypted with sd_ecb_block_encrypt(). */
+    uint32_t crypt_count;                           /**< Calls of gzp_crypt(). */
+    uint64_t crypt_ns;                              /**< Time spent in gzp_crypt(). */
+} gzp_port_stats_t;
+
+/**@brief Function for initializing a Device.
+ *
+ * @param[in]  fd     Connected socket to the Host.
+ * @param[in]  seed   Seed of the RNG.
+ */
+void gzp_port_device_init(int fd, uint32_t seed);
+
+/**@brief Function for initializing the Host.
+ *
+ * @param[in]  p_fds   Connected sockets to the Devices.
+ * @param[in]  count   Number of Devices.
+ * @param[in]  seed    Seed of the RNG.
+ */
+void gzp_port_host_init(const int * p_fds, uint32_t count, uint32_t seed);
+
+/**@brief Function for sending an application message to the other side.
+ *
+ * @param[in]  link       Index of the Device on the Host, 0 on a Device.
+ * @param[in]  type       Message type, from GZP_PORT_MSG_APP.
+ * @param[in]  p_data     Message data.
+ * @param[in]  length     Length of the message data, at most GZP_PORT_MSG_SIZE_MAX.
+ */
+void gzp_port_send(uint32_t link, uint8_t type, const void * p_data, uint32_t length);
+
+/**@brief Function for waiting for the next message from the other side.
+ *
+ * @details On the Host, radio packets from the Device are handled on the way, each is reported
+ *          with GZP_PORT_MSG_RADIO.
+ *
+ * @param[in]  link       Index of the Device on the Host, 0 on a Device.
+ * @param[out] p_data     Message data, GZP_PORT_MSG_SIZE_MAX bytes.
+ * @param[out] p_length   Length of the message data.
+ *
+ * @return Message type.
+ */
+uint8_t gzp_port_wait(uint32_t link, void * p_data, uint32_t * p_length);
+
+/**@brief Function for getting the emulated time.
+ *
+ * @return Timeslots since the start.
+ */
+uint64_t gzp_port_time_get(void);
+
+/**@brief Function for setting the emulated time, when a side becomes active.
+ *
+ * @param[in]  time   Timeslots since the start, not before the current time.
+ */
+void gzp_port_time_set(uint64_t time);
+
+/**@brief Function for selecting the gzp_crypt() implementation.
+ *
+ * @param[in]  is_reference   true for one ECB block per call and a bytewise XOR, as before the
+ *                            keystream cache. false for the implementation in nrf_gzp.c.
+ */
+void gzp_port_reference_set(bool is_reference);
+
+/**@brief Function for adding Wi-Fi interference to the air of a Device.
+ *
+ * @details Wi-Fi APs on channels 1, 6 and 13 transmit in bursts, on a schedule that depends on the
+ *          time only, and the attempts on their channels mostly get lost while they do.
+ *
+ * @param[in]  duty   Share of the time the APs transmit, per mille. 0 for a clear air.
+ * @param[in]  seed   Seed of the AP schedules, the same for all Devices.
+ */
+void gzp_port_air_set(uint32_t duty, uint32_t seed);
+
+/**@brief Function for getting the statistics.
+ *
+ * @param[out] p_stats   Statistics.
+ */
+void gzp_port_stats_get(gzp_port_stats_t * p_stats);
+
+#endif // GZP_SIM_PORT_H__
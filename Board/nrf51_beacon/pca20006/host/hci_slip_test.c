@@ -0,0 +1,724 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host round-trip fuzz test and benchmark of the block SLIP codec, see @ref hci_slip.
+ *
+ * @details The codec runs against an emulated app_uart and is compared with a reference copy of
+ *          the per-byte codec it replaced. Build with:
+ *
+ *          gcc -O2 -DBOARD_PCA10001 -Wno-pointer-to-int-cast -I. -I../../../../Include
+ *              -I../../../../Include/gcc -I../../../../Include/app_common -I../../../../Include/s110
+ *              hci_slip_test.c ../../../../Source/app_common/hci_slip.c -o hci_slip_test
+ *
+ *          Usage:
+ *          - hci_slip_test [iterations [seed]]
+ *            Fuzz test. TX: random packets and alignments are written with a UART FIFO that
+ *            accepts a random number of bytes per APP_UART_TX_EMPTY, the output must equal the
+ *            reference encoding. RX: random streams of frames, noise, invalid escapes and
+ *            oversized frames are fed in random chunks through APP_UART_DATA_READY and
+ *            APP_UART_DATA, the events must equal those of the reference decoder. The frame
+ *            API must round trip. Exits with 1 on the first mismatch.
+ *          - hci_slip_test -b
+ *            Prints the encode and decode cost per byte of both codecs: encoding a frame into
+ *            memory, and decoding frames read from the UART, in blocks through
+ *            APP_UART_DATA_READY or a byte at a time for the reference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hci_slip.h"
+#include "app_uart.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+
+#define APP_SLIP_END            0xC0                                /**< SLIP end byte. */
+#define APP_SLIP_ESC            0xDB                                /**< SLIP escape byte. */
+#define APP_SLIP_ESC_END        0xDC                                /**< Escaped SLIP end byte. */
+#define APP_SLIP_ESC_ESC        0xDD                                /**< Escaped SLIP escape byte. */
+
+#define PKT_SIZE_MAX            600                                 /**< Largest packet generated. */
+#define FRAME_SIZE_MAX          (2 * PKT_SIZE_MAX + 2)              /**< Largest encoded frame. */
+#define STREAM_SIZE_MAX         8192                                /**< Size of an RX stream. */
+#define EVT_COUNT_MAX           1024                                /**< Max number of RX events recorded per stream. */
+#define DEFAULT_ITERATIONS      20000                               /**< Default number of fuzz iterations. */
+#define BENCH_BYTES             (64u * 1024u * 1024u)               /**< Bytes encoded and decoded per benchmark run. */
+
+/**@brief RX event as recorded for comparison. */
+typedef struct
+{
+    hci_slip_evt_type_t type;                                       /**< Event type. */
+    uint32_t            length;                                     /**< Packet length. */
+    uint8_t             data[PKT_SIZE_MAX];                         /**< Packet data, for HCI_SLIP_RX_RDY. */
+} rec_evt_t;
+
+/**@brief RX event log of one decoder. */
+typedef struct
+{
+    rec_evt_t evts[EVT_COUNT_MAX];                                  /**< Recorded events. */
+    uint32_t  count;                                                /**< Number of recorded events. */
+    uint32_t  register_count;                                       /**< Number of RX buffers registered. */
+    uint8_t   buffer[PKT_SIZE_MAX + 16];                            /**< RX buffer. */
+} rec_log_t;
+
+static app_uart_event_handler_t m_uart_handler;                     /**< Event handler of the SLIP layer. */
+static uint8_t                  m_uart_tx[FRAME_SIZE_MAX];          /**< Bytes put to the UART. */
+static uint32_t                 m_uart_tx_count;                    /**< Number of bytes put to the UART. */
+static uint32_t                 m_uart_tx_room;                     /**< Bytes the UART FIFO accepts before the next TX empty event. */
+static const uint8_t *          mp_uart_rx;                         /**< Bytes waiting in the UART RX FIFO. */
+static uint32_t                 m_uart_rx_count;                    /**< Number of bytes waiting in the UART RX FIFO. */
+static uint32_t                 m_tx_done_count;                    /**< Number of HCI_SLIP_TX_DONE events. */
+static uint32_t                 m_rx_sizes[64];                     /**< Sizes of consecutively registered RX buffers. */
+static rec_log_t                m_log;                              /**< Events of the block codec. */
+static rec_log_t                m_ref_log;                          /**< Events of the reference codec. */
+
+
+uint32_t app_uart_init(const app_uart_comm_params_t * p_comm_params,
+                             app_uart_buffers_t *     p_buffers,
+                             app_uart_event_handler_t error_handler,
+                             app_irq_priority_t       irq_priority,
+                             uint16_t *               p_uart_uid)
+{
+    m_uart_handler = error_handler;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_put(uint8_t byte)
+{
+    if (m_uart_tx_room == 0)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_uart_tx_room--;
+    m_uart_tx[m_uart_tx_count++] = byte;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_get(uint8_t * p_byte)
+{
+    if (m_uart_rx_count == 0)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    *p_byte = *mp_uart_rx++;
+    m_uart_rx_count--;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_close(uint16_t app_uart_id)
+{
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for recording an RX event. */
+static void log_evt(rec_log_t * p_log, hci_slip_evt_t event)
+{
+    rec_evt_t * p_evt = &p_log->evts[p_log->count];
+
+    if (p_log->count++ >= EVT_COUNT_MAX)
+    {
+        // Only the event count is compared from here on.
+        return;
+    }
+    p_evt->type   = event.evt_type;
+    p_evt->length = event.packet_length;
+    if (event.evt_type == HCI_SLIP_RX_RDY)
+    {
+        memcpy(p_evt->data, event.packet, event.packet_length);
+    }
+}
+
+
+/**@brief Function for getting the size of the next RX buffer registered to a decoder. */
+static uint32_t rx_size_next(rec_log_t * p_log)
+{
+    return m_rx_sizes[p_log->register_count++ % (sizeof(m_rx_sizes) / sizeof(m_rx_sizes[0]))];
+}
+
+
+static void slip_evt_handler(hci_slip_evt_t event)
+{
+    switch (event.evt_type)
+    {
+        case HCI_SLIP_TX_DONE:
+            m_tx_done_count++;
+            break;
+
+        case HCI_SLIP_RX_RDY:
+        case HCI_SLIP_RX_OVERFLOW:
+            log_evt(&m_log, event);
+            (void)hci_slip_rx_buffer_register(m_log.buffer, rx_size_next(&m_log));
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/*
+ * Reference codec: the per-byte state machines of the original hci_slip.c, with the UART
+ * replaced by a buffer.
+ */
+
+static const uint8_t * mp_ref_tx_buffer;                            /**< Packet being encoded by the reference encoder. */
+static uint32_t        m_ref_tx_length;                             /**< Length of the packet being encoded. */
+static uint32_t        m_ref_tx_index;                              /**< Index of the next byte to encode. */
+static uint8_t *       mp_ref_out;                                  /**< Output of the reference encoder. */
+static uint32_t        m_ref_out_count;                             /**< Number of bytes output by the reference encoder. */
+static uint8_t *       mp_ref_rx_buffer;                            /**< RX buffer of the reference decoder. */
+static uint32_t        m_ref_rx_length;                             /**< Size of the RX buffer of the reference decoder. */
+static uint32_t        m_ref_rx_count;                              /**< Bytes decoded into the RX buffer of the reference decoder. */
+
+static uint32_t ref_send_default(void);
+static void     ref_rx_wait_start(uint8_t byte);
+static void     ref_rx_default(uint8_t byte);
+
+static uint32_t (*ref_send_byte) (void)        = ref_send_default;  /**< Next step of the reference encoder. */
+static void     (*ref_rx_byte) (uint8_t byte)  = ref_rx_wait_start; /**< Next step of the reference decoder. */
+
+
+static uint32_t ref_put(uint8_t byte)
+{
+    mp_ref_out[m_ref_out_count++] = byte;
+    return NRF_SUCCESS;
+}
+
+
+static uint32_t ref_send_end(void)
+{
+    uint32_t err_code = ref_put(APP_SLIP_END);
+
+    if ((err_code == NRF_SUCCESS) && (m_ref_tx_index == 0))
+    {
+        ref_send_byte = ref_send_default;
+    }
+    return err_code;
+}
+
+
+static uint32_t ref_send_default(void)
+{
+    uint32_t err_code = ref_put(mp_ref_tx_buffer[m_ref_tx_index]);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_ref_tx_index++;
+    }
+    return err_code;
+}
+
+
+static uint32_t ref_send_encoded(void)
+{
+    uint32_t err_code = ref_put((mp_ref_tx_buffer[m_ref_tx_index] == APP_SLIP_END) ?
+                                APP_SLIP_ESC_END : APP_SLIP_ESC_ESC);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_ref_tx_index++;
+        ref_send_byte = ref_send_default;
+    }
+    return err_code;
+}
+
+
+static uint32_t ref_send_esc(void)
+{
+    uint32_t err_code = ref_put(APP_SLIP_ESC);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        ref_send_byte = ref_send_encoded;
+    }
+    return err_code;
+}
+
+
+/**@brief Function for encoding a frame with the reference encoder.
+ *
+ * @return Length of the encoded frame.
+ */
+static uint32_t ref_frame_encode(const uint8_t * p_src, uint32_t length, uint8_t * p_dst)
+{
+    mp_ref_tx_buffer = p_src;
+    m_ref_tx_length  = length;
+    m_ref_tx_index   = 0;
+    mp_ref_out       = p_dst;
+    m_ref_out_count  = 0;
+
+    ref_send_byte = ref_send_end;
+    (void)ref_send_byte();
+    while (m_ref_tx_index < m_ref_tx_length)
+    {
+        if (((mp_ref_tx_buffer[m_ref_tx_index] == APP_SLIP_END) ||
+             (mp_ref_tx_buffer[m_ref_tx_index] == APP_SLIP_ESC)) &&
+            (ref_send_byte == ref_send_default))
+        {
+            ref_send_byte = ref_send_esc;
+        }
+        (void)ref_send_byte();
+    }
+    ref_send_byte = ref_send_end;
+    (void)ref_send_byte();
+
+    return m_ref_out_count;
+}
+
+
+static void ref_rx_buffer_register(uint8_t * p_buffer, uint32_t length)
+{
+    mp_ref_rx_buffer = p_buffer;
+    m_ref_rx_length  = length;
+    m_ref_rx_count   = 0;
+    ref_rx_byte      = ref_rx_wait_start;
+}
+
+
+static void ref_evt(hci_slip_evt_type_t type, uint8_t * p_packet, uint32_t length)
+{
+    hci_slip_evt_t event = {type, p_packet, length};
+
+    log_evt(&m_ref_log, event);
+    ref_rx_buffer_register(m_ref_log.buffer, rx_size_next(&m_ref_log));
+}
+
+
+static void ref_rx_end(void)
+{
+    if (m_ref_rx_count > 0)
+    {
+        uint32_t count = m_ref_rx_count;
+
+        m_ref_rx_count   = 0;
+        mp_ref_rx_buffer = NULL;
+        ref_evt(HCI_SLIP_RX_RDY, m_ref_log.buffer, count);
+    }
+}
+
+
+static void ref_rx_esc(uint8_t byte)
+{
+    switch (byte)
+    {
+        case APP_SLIP_END:
+            ref_rx_end();
+            break;
+
+        case APP_SLIP_ESC_END:
+            mp_ref_rx_buffer[m_ref_rx_count++] = APP_SLIP_END;
+            break;
+
+        case APP_SLIP_ESC_ESC:
+            mp_ref_rx_buffer[m_ref_rx_count++] = APP_SLIP_ESC;
+            break;
+
+        default:
+            mp_ref_rx_buffer[m_ref_rx_count++] = byte;
+            break;
+    }
+    ref_rx_byte = ref_rx_default;
+}
+
+
+static void ref_rx_default(uint8_t byte)
+{
+    switch (byte)
+    {
+        case APP_SLIP_END:
+            ref_rx_end();
+            break;
+
+        case APP_SLIP_ESC:
+            ref_rx_byte = ref_rx_esc;
+            break;
+
+        default:
+            mp_ref_rx_buffer[m_ref_rx_count++] = byte;
+            break;
+    }
+}
+
+
+static void ref_rx_wait_start(uint8_t byte)
+{
+    if (byte == APP_SLIP_END)
+    {
+        ref_rx_byte = ref_rx_default;
+    }
+}
+
+
+/**@brief Function for decoding received bytes with the reference decoder. */
+static void ref_rx_decode(const uint8_t * p_data, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if ((mp_ref_rx_buffer == NULL) || (m_ref_rx_count >= m_ref_rx_length))
+        {
+            ref_evt(HCI_SLIP_RX_OVERFLOW, mp_ref_rx_buffer, m_ref_rx_count);
+            continue;
+        }
+        ref_rx_byte(p_data[i]);
+    }
+}
+
+
+/*
+ * Fuzz test.
+ */
+
+/**@brief Function for generating packet data with a given share of SLIP special bytes. */
+static void data_generate(uint8_t * p_data, uint32_t length, uint32_t special_per_256)
+{
+    uint32_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if ((uint32_t)(rand() & 0xFF) < special_per_256)
+        {
+            p_data[i] = (rand() & 1) ? APP_SLIP_END : APP_SLIP_ESC;
+        }
+        else
+        {
+            p_data[i] = (uint8_t)rand();
+        }
+    }
+}
+
+
+/**@brief Function for checking the TX path and the frame API with one random packet.
+ *
+ * @return true if the block codec matches the reference.
+ */
+static bool tx_check(uint32_t iteration)
+{
+    static uint8_t src[PKT_SIZE_MAX + 4];
+    static uint8_t ref[FRAME_SIZE_MAX];
+    static uint8_t frame[FRAME_SIZE_MAX];
+    uint32_t       length = (uint32_t)rand() % (PKT_SIZE_MAX + 1);
+    uint32_t       offset = (uint32_t)rand() % 4;
+    uint32_t       ref_length;
+    uint32_t       frame_length;
+
+    data_generate(&src[offset], length, (uint32_t)rand() % 256);
+    ref_length = ref_frame_encode(&src[offset], length, ref);
+
+    // Streaming encoder, UART FIFO accepting 0 to 40 bytes per TX empty event.
+    m_uart_tx_count = 0;
+    m_tx_done_count = 0;
+    m_uart_tx_room  = (uint32_t)rand() % 41;
+    if (hci_slip_write(&src[offset], length) != NRF_SUCCESS)
+    {
+        printf("%lu: write failed\n", (unsigned long)iteration);
+        return false;
+    }
+    while (m_tx_done_count == 0)
+    {
+        app_uart_evt_t evt = {.evt_type = APP_UART_TX_EMPTY};
+
+        m_uart_tx_room = (uint32_t)rand() % 41;
+        m_uart_handler(&evt);
+    }
+    if ((m_tx_done_count != 1) || (m_uart_tx_count != ref_length) ||
+        (memcmp(m_uart_tx, ref, ref_length) != 0))
+    {
+        printf("%lu: TX of %lu bytes differs from the reference\n",
+               (unsigned long)iteration, (unsigned long)length);
+        return false;
+    }
+
+    // Frame API: exact fit, one byte short, and decoding back.
+    frame_length = ref_length;
+    if ((hci_slip_frame_encode(&src[offset], length, frame, &frame_length) != NRF_SUCCESS) ||
+        (frame_length != ref_length) || (memcmp(frame, ref, ref_length) != 0))
+    {
+        printf("%lu: frame encoding differs from the reference\n", (unsigned long)iteration);
+        return false;
+    }
+    frame_length = ref_length - 1;
+    if (hci_slip_frame_encode(&src[offset], length, frame, &frame_length) != NRF_ERROR_NO_MEM)
+    {
+        printf("%lu: frame encoding overran its buffer\n", (unsigned long)iteration);
+        return false;
+    }
+    memcpy(frame, ref, ref_length);
+    frame_length = ref_length;
+    if ((hci_slip_frame_decode(frame, &frame_length) != NRF_SUCCESS) || (frame_length != length) ||
+        (memcmp(frame, &src[offset], length) != 0))
+    {
+        printf("%lu: frame does not decode back\n", (unsigned long)iteration);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**@brief Function for generating an RX stream of frames, noise, invalid escapes and oversized
+ *        frames.
+ *
+ * @return Length of the stream.
+ */
+static uint32_t stream_generate(uint8_t * p_stream)
+{
+    static uint8_t pkt[PKT_SIZE_MAX];
+    uint32_t       length = 0;
+
+    while (length < (STREAM_SIZE_MAX - FRAME_SIZE_MAX - 8))
+    {
+        uint32_t pkt_length = (uint32_t)rand() % (PKT_SIZE_MAX + 1);
+
+        switch (rand() % 8)
+        {
+            case 0:
+                // Noise.
+                data_generate(&p_stream[length], pkt_length % 32, 64);
+                length += pkt_length % 32;
+                break;
+
+            case 1:
+                // Invalid escape sequence.
+                p_stream[length++] = APP_SLIP_ESC;
+                p_stream[length++] = (uint8_t)rand();
+                break;
+
+            case 2:
+                // Truncated frame.
+                data_generate(pkt, pkt_length, 16);
+                length += ref_frame_encode(pkt, pkt_length, &p_stream[length]) / 2;
+                break;
+
+            default:
+                data_generate(pkt, pkt_length, (uint32_t)rand() % 64);
+                length += ref_frame_encode(pkt, pkt_length, &p_stream[length]);
+                break;
+        }
+    }
+
+    return length;
+}
+
+
+/**@brief Function for checking the RX path with one random stream.
+ *
+ * @return true if the block codec produced the same events as the reference.
+ */
+static bool rx_check(uint32_t iteration)
+{
+    static uint8_t stream[STREAM_SIZE_MAX];
+    const uint32_t length = stream_generate(stream);
+    uint32_t       index;
+    uint32_t       i;
+
+    for (i = 0; i < (sizeof(m_rx_sizes) / sizeof(m_rx_sizes[0])); i++)
+    {
+        // Mostly large enough, sometimes too small for the frame.
+        m_rx_sizes[i] = (rand() % 4) ? (PKT_SIZE_MAX + 1) : (1 + (uint32_t)rand() % 64);
+    }
+
+    m_log.count            = 0;
+    m_log.register_count   = 0;
+    m_ref_log.count        = 0;
+    m_ref_log.register_count = 0;
+    (void)hci_slip_rx_buffer_register(m_log.buffer, rx_size_next(&m_log));
+    ref_rx_buffer_register(m_ref_log.buffer, rx_size_next(&m_ref_log));
+
+    ref_rx_decode(stream, length);
+
+    for (index = 0; index < length; )
+    {
+        app_uart_evt_t evt;
+
+        if (rand() & 1)
+        {
+            // UART with FIFO.
+            uint32_t chunk = 1 + (uint32_t)rand() % 64;
+
+            if (chunk > (length - index))
+            {
+                chunk = length - index;
+            }
+            mp_uart_rx      = &stream[index];
+            m_uart_rx_count = chunk;
+            evt.evt_type    = APP_UART_DATA_READY;
+            m_uart_handler(&evt);
+            index += chunk;
+        }
+        else
+        {
+            evt.evt_type   = APP_UART_DATA;
+            evt.data.value = stream[index++];
+            m_uart_handler(&evt);
+        }
+    }
+
+    if (m_log.count != m_ref_log.count)
+    {
+        printf("%lu: %lu RX events, reference %lu\n", (unsigned long)iteration,
+               (unsigned long)m_log.count, (unsigned long)m_ref_log.count);
+        return false;
+    }
+    for (i = 0; i < MIN(m_log.count, EVT_COUNT_MAX); i++)
+    {
+        const rec_evt_t * p_evt     = &m_log.evts[i];
+        const rec_evt_t * p_ref_evt = &m_ref_log.evts[i];
+
+        if ((p_evt->type != p_ref_evt->type) || (p_evt->length != p_ref_evt->length) ||
+            ((p_evt->type == HCI_SLIP_RX_RDY) &&
+             (memcmp(p_evt->data, p_ref_evt->data, p_evt->length) != 0)))
+        {
+            printf("%lu: RX event %lu differs from the reference\n",
+                   (unsigned long)iteration, (unsigned long)i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Benchmark.
+ */
+
+static double seconds_get(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec * 1e-9);
+}
+
+
+/**@brief Function for printing the cost per byte of both codecs on packets with a given share
+ *        of SLIP special bytes.
+ */
+static void bench_run(uint32_t special_per_256)
+{
+    static uint8_t src[256];
+    static uint8_t frame[2 * sizeof(src) + 2];
+    const uint32_t rounds = BENCH_BYTES / sizeof(src);
+    uint32_t       frame_length;
+    uint32_t       i;
+    double         t_enc;
+    double         t_dec;
+    double         t_ref_enc;
+    double         t_ref_dec;
+    double         t;
+
+    data_generate(src, sizeof(src), special_per_256);
+    frame_length = ref_frame_encode(src, sizeof(src), frame);
+
+    t = seconds_get();
+    for (i = 0; i < rounds; i++)
+    {
+        uint32_t length = sizeof(frame);
+
+        (void)hci_slip_frame_encode(src, sizeof(src), frame, &length);
+        __asm__ volatile("" : : "r" (frame) : "memory");
+    }
+    t_enc = seconds_get() - t;
+
+    t = seconds_get();
+    for (i = 0; i < rounds; i++)
+    {
+        (void)ref_frame_encode(src, sizeof(src), frame);
+        __asm__ volatile("" : : "r" (frame) : "memory");
+    }
+    t_ref_enc = seconds_get() - t;
+
+    // Decoding through the UART path, one RX buffer per frame.
+    for (i = 0; i < (sizeof(m_rx_sizes) / sizeof(m_rx_sizes[0])); i++)
+    {
+        m_rx_sizes[i] = PKT_SIZE_MAX;
+    }
+    t = seconds_get();
+    for (i = 0; i < rounds; i++)
+    {
+        app_uart_evt_t evt = {.evt_type = APP_UART_DATA_READY};
+
+        mp_uart_rx      = frame;
+        m_uart_rx_count = frame_length;
+        m_uart_handler(&evt);
+    }
+    t_dec = seconds_get() - t;
+
+    // The per-byte decoder took one byte per UART event.
+    t = seconds_get();
+    for (i = 0; i < rounds; i++)
+    {
+        uint8_t byte;
+
+        mp_uart_rx      = frame;
+        m_uart_rx_count = frame_length;
+        while (app_uart_get(&byte) == NRF_SUCCESS)
+        {
+            ref_rx_decode(&byte, 1);
+        }
+    }
+    t_ref_dec = seconds_get() - t;
+
+    printf("%3lu/256 special: encode %.2f ns/B (reference %.2f), decode %.2f ns/B (reference %.2f)\n",
+           (unsigned long)special_per_256,
+           t_enc * 1e9 / BENCH_BYTES, t_ref_enc * 1e9 / BENCH_BYTES,
+           t_dec * 1e9 / BENCH_BYTES, t_ref_dec * 1e9 / BENCH_BYTES);
+}
+
+
+int main(int argc, char ** argv)
+{
+    uint32_t iterations = DEFAULT_ITERATIONS;
+    uint32_t i;
+
+    (void)hci_slip_evt_handler_register(slip_evt_handler);
+    if (hci_slip_open() != NRF_SUCCESS)
+    {
+        return 1;
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "-b") == 0))
+    {
+        (void)hci_slip_rx_buffer_register(m_log.buffer, PKT_SIZE_MAX);
+        ref_rx_buffer_register(m_ref_log.buffer, PKT_SIZE_MAX);
+        bench_run(0);
+        bench_run(2);
+        bench_run(32);
+        return 0;
+    }
+
+    if (argc > 1)
+    {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+    srand((argc > 2) ? strtoul(argv[2], NULL, 0) : 1);
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (!tx_check(i) || (((i % 16) == 0) && !rx_check(i)))
+        {
+            return 1;
+        }
+    }
+
+    printf("%lu iterations passed\n", (unsigned long)iterations);
+    return 0;
+}
@@ -0,0 +1,40 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief HCI transport configuration for the host builds of the serialization transport.
+ *
+ * @details The UART pins are unused, the host tools replace app_uart. The baud rate only sets
+ *          the retransmission timeout of @ref hci_transport; the harnesses emulate the line rate
+ *          themselves.
+ */
+
+#ifndef HCI_TRANSPORT_CONFIG_H__
+#define HCI_TRANSPORT_CONFIG_H__
+
+#include "app_uart.h"
+
+#define HCI_SLIP_UART_RX_PIN_NUMBER     0                                   /**< UART RX pin number, unused on host. */
+#define HCI_SLIP_UART_TX_PIN_NUMBER     1                                   /**< UART TX pin number, unused on host. */
+#define HCI_SLIP_UART_RTS_PIN_NUMBER    2                                   /**< UART RTS pin number, unused on host. */
+#define HCI_SLIP_UART_CTS_PIN_NUMBER    3                                   /**< UART CTS pin number, unused on host. */
+
+#define HCI_SLIP_UART_MODE              APP_UART_FLOW_CONTROL_ENABLED       /**< Flow control mode of the UART. */
+#define HCI_SLIP_UART_BAUDRATE          0x10000000UL                        /**< UART baud rate register value for 1 Mbaud, unused on host. */
+
+#define MAX_PACKET_SIZE_IN_BITS         8000u                               /**< Maximum packet size of a single application packet in bits. */
+#ifndef USED_BAUD_RATE
+#define USED_BAUD_RATE                  1000000u                            /**< The used uart baudrate. Set it to the emulated line rate, or retransmissions time out early. */
+#endif
+
+#endif // HCI_TRANSPORT_CONFIG_H__
@@ -0,0 +1,38 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Busy wait for the host builds, replacing Include/nrf_delay.h.
+ *
+ * @details Found first as the host directory comes first in the include path. The delay passes
+ *          emulated time, host_delay_us() must be provided by a host tool using it.
+ */
+
+#ifndef _NRF_DELAY_H
+#define _NRF_DELAY_H
+
+#include <stdint.h>
+
+void host_delay_us(uint32_t number_of_us);
+
+static inline void nrf_delay_us(uint32_t number_of_us)
+{
+    host_delay_us(number_of_us);
+}
+
+static inline void nrf_delay_ms(uint32_t number_of_ms)
+{
+    host_delay_us(number_of_ms * 1000);
+}
+
+#endif // _NRF_DELAY_H
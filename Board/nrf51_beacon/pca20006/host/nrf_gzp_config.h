@@ -0,0 +1,85 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Gazell Pairing configuration of the host simulation, see gzp_sim.c.
+ *
+ * @details The values of the SDK examples. The pairing parameters are stored in the emulated
+ *          flash of gzp_sim_port.c, and the RNG is emulated too. Both are at fixed addresses on the
+ *          target, so the simulation must be linked with -no-pie to keep the flash below 4 GB.
+ */
+
+#ifndef __GZP_CONFIG_H
+#define __GZP_CONFIG_H
+
+#include <stdint.h>
+
+/** Definition of "secret key" used during "Host ID exchange". */
+#define GZP_SECRET_KEY {1, 23, 45, 57, 26, 68, 12, 64, 13, 73, 13, 62, 26, 45, 12, 77}
+
+/** First static pairing channel, in the lower Nth of the channel range. */
+#define GZP_CHANNEL_LOW 2
+
+/** Second static pairing channel, in the upper Nth of the channel range. */
+#define GZP_CHANNEL_HIGH 79
+
+/** Static "global" pairing address. */
+#define GZP_ADDRESS 4, 6, 8, 9
+
+/** Reduced TX power for close proximity pairing. */
+#define GZP_POWER NRF_GZLL_TX_POWER_N16_DBM
+
+/** Pairing request timeout. */
+#define GZP_REQ_TX_TIMEOUT 200
+
+/** Maximum number of "backoff" packets (step 0) to be transmitted. */
+#define GZP_MAX_BACKOFF_PACKETS 100
+
+/** Period a Device waits before fetching the pairing response (step 1). */
+#define GZP_TX_ACK_WAIT_TIMEOUT (GZP_CLOSE_PROXIMITY_BACKOFF_RX_TIMEOUT + 50)
+
+/** Period a Device in close proximity backs off after a backoff packet has been received. */
+#define GZP_CLOSE_PROXIMITY_BACKOFF_RX_TIMEOUT ((GZP_REQ_TX_TIMEOUT / 2) + 50)
+
+/** Period a Device not in close proximity backs off after a backoff packet has been received. */
+#define GZP_NOT_PROXIMITY_BACKOFF_RX_TIMEOUT (GZP_CLOSE_PROXIMITY_BACKOFF_RX_TIMEOUT + GZP_STEP1_RX_TIMEOUT)
+
+/** Time the Host waits for a Device to fetch the pairing response. */
+#define GZP_STEP1_RX_TIMEOUT (((GZP_REQ_TX_TIMEOUT / 2) + GZP_TX_ACK_WAIT_TIMEOUT) + 50)
+
+/** Size of the Device pairing database, one flash page. */
+#define GZP_DEVICE_PARAMS_STORAGE_SIZE 1024
+
+/** Emulated flash page holding the pairing parameters. */
+extern uint8_t gzp_port_flash[GZP_DEVICE_PARAMS_STORAGE_SIZE];
+#define GZP_PARAMS_STORAGE_ADR ((uint32_t)(uintptr_t)gzp_port_flash)
+
+/** Maximum Device to Host payload length. */
+#define GZP_MAX_FW_PAYLOAD_LENGTH 17
+
+/** Maximum Host to Device payload length. */
+#define GZP_MAX_ACK_PAYLOAD_LENGTH 10
+
+/** Upper and lower bound of the channel range. */
+#define GZP_CHANNEL_MAX 80
+#define GZP_CHANNEL_MIN 2
+
+/** Minimum spacing between the channels of the table. */
+#define GZP_CHANNEL_SPACING_MIN 5
+
+/** Emulated RNG, a fresh value is ready on every access. */
+NRF_RNG_Type * gzp_port_rng(void);
+#undef NRF_RNG
+#define NRF_RNG gzp_port_rng()
+
+#endif // __GZP_CONFIG_H
@@ -0,0 +1,689 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host latency and throughput benchmark of the serialized S110 API.
+ *
+ * @details The application side, the command encoder, @ref ble_rpc_pkt_receiver.c and the event
+ *          decoder on @ref hci_transport and @ref hci_slip, runs in this program. The
+ *          connectivity side, rpc_bench_conn.c, runs in a child process connected over a
+ *          socketpair acting as the UART, see rpc_bench_port.h. Build both with:
+ *
+ *          gcc -O2 -Wall -Wno-pointer-to-int-cast -DNRF51 -DBOARD_PCA10001 -DBLE_STACK_SUPPORT_REQD
+ *              -DSVCALL_AS_NORMAL_FUNCTION -I. -I../../../../Include -I../../../../Include/gcc
+ *              -I../../../../Include/app_common -I../../../../Include/s110
+ *              -I../../../../Include/sd_common -I../../../../Include/ble/rpc
+ *              rpc_bench.c rpc_bench_port.c ../../../../Source/ble/rpc/ble_rpc_cmd_encoder*.c
+ *              ../../../../Source/ble/rpc/ble_rpc_event_decoder*.c
+ *              ../../../../Source/ble/rpc/ble_rpc_pkt_receiver.c
+ *              ../../../../Source/ble/rpc/ble_rpc_codec*.c
+ *              ../../../../Source/app_common/hci_transport.c
+ *              ../../../../Source/app_common/hci_mem_pool.c
+ *              ../../../../Source/app_common/hci_slip.c
+ *              ../../../../Source/app_common/crc16.c -o rpc_bench
+ *
+ *          and rpc_bench_conn as described in rpc_bench_conn.c. Add -DUSED_BAUD_RATE=<baud>u to
+ *          both builds when emulating a line rate below 1 Mbaud, as it sets the retransmission
+ *          timeout of @ref hci_transport.
+ *
+ *          Usage: rpc_bench [-r baud] [-l loss_ppm] [-d drop_interval] [-s seed]
+ *                           [-c rpc_bench_conn] [-f script] [workload ...]
+ *          - baud      Emulated line rate, 10 bits per byte, 0 for no limit. Default
+ *                      USED_BAUD_RATE.
+ *          - loss_ppm  Bytes in a million which get a bit flipped on the line, both directions.
+ *          - drop_interval  Every Nth SLIP frame is lost on the line, both directions, so the
+ *                      transport has to retransmit it. 0 (default) for none.
+ *          - script    File of workloads, separated by white space, # starts a comment.
+ *          - workload  adv:count          sd_ble_gap_adv_start, synchronous.
+ *                      write:count:len    sd_ble_gatts_value_set of len bytes, synchronous.
+ *                      notify:count:len   ble_rpc_gatts_hvx_async of len bytes, pipelined. The
+ *                                         connectivity side echoes every notification as a
+ *                                         BLE_GATTS_EVT_WRITE, reported as notify-echo.
+ *                      Default: adv:500 write:1000:20 notify:2000:20
+ *
+ *          For every workload the completed operations per second and the p50, p99 and maximum
+ *          latency in microseconds are printed, followed by the transport statistics of both
+ *          sides. A transport change is evaluated by running the same workloads and seed before
+ *          and after it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "rpc_bench_port.h"
+#include "ble.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_util.h"
+#include "hci_transport.h"
+#include "hci_transport_config.h"
+#include "ble_rpc_cmd_encoder.h"
+#include "ble_rpc_pkt_receiver.h"
+#include "ble_stack_handler_types.h"
+#include "softdevice_handler.h"
+
+#define WORKLOAD_COUNT_MAX      32u                                 /**< Number of workloads in a run. */
+#define SCRIPT_SIZE_MAX         4096u                               /**< Largest script file. */
+#define VALUE_LEN_MAX           (GATT_MTU_SIZE_DEFAULT - 3u)        /**< Largest notification or attribute value. */
+#define SEQ_SIZE                sizeof(uint32_t)                    /**< Operation number at the start of a notification. */
+#define ECHO_DRAIN_TIME_US      1000000u                            /**< Time echoes may still arrive after the last notification completed. */
+#define BENCH_CONN_HANDLE       0u                                  /**< Connection handle the notifications are sent on. */
+#define BENCH_SRVC_UUID         0x1523u                             /**< UUID of the service added for the workloads. */
+#define BENCH_CHAR_UUID         0x1524u                             /**< UUID of the characteristic added for the workloads. */
+#define DEFAULT_SCRIPT          "adv:500 write:1000:20 notify:2000:20"  /**< Workloads run when none are given. */
+
+/**@brief Workload types. */
+typedef enum
+{
+    WORKLOAD_ADV,                                                   /**< Advertising start. */
+    WORKLOAD_WRITE,                                                 /**< Attribute value write. */
+    WORKLOAD_NOTIFY                                                 /**< Notifications. */
+} workload_type_t;
+
+/**@brief Workload of a run. */
+typedef struct
+{
+    workload_type_t type;                                           /**< Workload type. */
+    uint32_t        count;                                          /**< Number of operations. */
+    uint16_t        len;                                            /**< Value length, where applicable. */
+} workload_t;
+
+/**@brief Results of one workload. */
+typedef struct
+{
+    uint32_t * p_latency;                                           /**< Latency of each operation in microseconds, 0 if not completed. */
+    uint64_t * p_send_time;                                         /**< Start time of each operation in microseconds. */
+    uint32_t   count;                                               /**< Number of operations. */
+    uint32_t   done_count;                                          /**< Number of completed operations. */
+    uint32_t   error_count;                                         /**< Number of operations completed with an error. */
+    uint32_t * p_echo_latency;                                      /**< Time from sending until the echo of each notification arrived. */
+    uint32_t   echo_count;                                          /**< Number of echoes received. */
+} result_t;
+
+static workload_t m_workloads[WORKLOAD_COUNT_MAX];                  /**< Workloads, in order. */
+static uint32_t   m_workload_count;                                 /**< Number of workloads. */
+static uint16_t   m_value_handle;                                   /**< Handle of the characteristic value used by the workloads. */
+static result_t * mp_result;                                        /**< Results of the running workload. */
+static uint32_t   m_evt_count;                                      /**< Number of BLE events received. */
+
+
+/**@brief Function for parsing one workload.
+ *
+ * @return false if the workload is not valid.
+ */
+static bool workload_parse(const char * p_text)
+{
+    workload_t * p_workload = &m_workloads[m_workload_count];
+    unsigned     count      = 0;
+    unsigned     len        = VALUE_LEN_MAX;
+    char         name[16];
+
+    if ((m_workload_count == WORKLOAD_COUNT_MAX) ||
+        (sscanf(p_text, "%15[a-z]:%u:%u", name, &count, &len) < 2) ||
+        (count == 0) || (len > VALUE_LEN_MAX))
+    {
+        return false;
+    }
+
+    if (strcmp(name, "adv") == 0)
+    {
+        p_workload->type = WORKLOAD_ADV;
+    }
+    else if (strcmp(name, "write") == 0)
+    {
+        p_workload->type = WORKLOAD_WRITE;
+    }
+    else if ((strcmp(name, "notify") == 0) && (len >= SEQ_SIZE))
+    {
+        p_workload->type = WORKLOAD_NOTIFY;
+    }
+    else
+    {
+        return false;
+    }
+
+    p_workload->count = count;
+    p_workload->len   = (uint16_t)len;
+    m_workload_count++;
+    return true;
+}
+
+
+/**@brief Function for parsing the workloads of a script.
+ *
+ * @return false if a workload is not valid.
+ */
+static bool script_parse(char * p_script)
+{
+    char * p_line;
+    char * p_line_save;
+
+    for (p_line = strtok_r(p_script, "\n", &p_line_save);
+         p_line != NULL;
+         p_line = strtok_r(NULL, "\n", &p_line_save))
+    {
+        char * p_comment = strchr(p_line, '#');
+        char * p_token;
+        char * p_token_save;
+
+        if (p_comment != NULL)
+        {
+            *p_comment = '\0';
+        }
+        for (p_token = strtok_r(p_line, " \t\r", &p_token_save);
+             p_token != NULL;
+             p_token = strtok_r(NULL, " \t\r", &p_token_save))
+        {
+            if (!workload_parse(p_token))
+            {
+                fprintf(stderr, "invalid workload: %s\n", p_token);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/**@brief Function for running the scheduled event handlers, which fetch the BLE events. */
+static void main_loop_run(void)
+{
+    app_sched_execute();
+}
+
+
+void intern_softdevice_events_execute(void)
+{
+    uint32_t evt_buf[CEIL_DIV(BLE_STACK_EVT_MSG_BUF_SIZE, sizeof(uint32_t))];
+
+    for (;;)
+    {
+        const ble_evt_t * p_evt = (const ble_evt_t *)evt_buf;
+        uint16_t          len   = sizeof(evt_buf);
+        uint32_t          err_code;
+
+        err_code = sd_ble_evt_get((uint8_t *)evt_buf, &len);
+        if (err_code == NRF_ERROR_NOT_FOUND)
+        {
+            return;
+        }
+        APP_ERROR_CHECK(err_code);
+        m_evt_count++;
+
+        if ((p_evt->header.evt_id == BLE_GATTS_EVT_WRITE) && (mp_result != NULL) &&
+            (mp_result->p_echo_latency != NULL) &&
+            (p_evt->evt.gatts_evt.params.write.len >= SEQ_SIZE))
+        {
+            const uint32_t seq = uint32_decode(p_evt->evt.gatts_evt.params.write.data);
+
+            if ((seq < mp_result->count) && (mp_result->p_echo_latency[seq] == 0))
+            {
+                mp_result->p_echo_latency[seq] =
+                    (uint32_t)(rpc_port_time_us() - mp_result->p_send_time[seq]) + 1u;
+                mp_result->echo_count++;
+            }
+        }
+    }
+}
+
+
+/**@brief Function for recording the completion of an operation. */
+static void op_complete(uint32_t seq, uint32_t err_code)
+{
+    // 0 marks an operation which has not completed, so latencies are at least 1 us.
+    mp_result->p_latency[seq] = (uint32_t)(rpc_port_time_us() - mp_result->p_send_time[seq]) + 1u;
+    mp_result->done_count++;
+    if (err_code != NRF_SUCCESS)
+    {
+        mp_result->error_count++;
+    }
+}
+
+
+/**@brief Function for handling the response of a notification. */
+static void hvx_resp_handle(uint16_t        cmd_id,
+                            uint32_t        err_code,
+                            const uint8_t * p_data,
+                            uint16_t        data_len,
+                            void *          p_context)
+{
+    op_complete((uint32_t)(uintptr_t)p_context, err_code);
+}
+
+
+/**@brief Function for running a synchronous workload. */
+static void sync_workload_run(const workload_t * p_workload)
+{
+    ble_gap_adv_params_t adv_params;
+    uint8_t              value[VALUE_LEN_MAX] = {0};
+    uint32_t             seq;
+
+    memset(&adv_params, 0, sizeof(adv_params));
+    adv_params.type     = BLE_GAP_ADV_TYPE_ADV_IND;
+    adv_params.fp       = BLE_GAP_ADV_FP_ANY;
+    adv_params.interval = 0x0020;
+
+    for (seq = 0; seq < p_workload->count; seq++)
+    {
+        uint32_t err_code;
+
+        mp_result->p_send_time[seq] = rpc_port_time_us();
+        if (p_workload->type == WORKLOAD_ADV)
+        {
+            err_code = sd_ble_gap_adv_start(&adv_params);
+        }
+        else
+        {
+            uint16_t len = p_workload->len;
+
+            (void)uint32_encode(seq, value);
+            err_code = sd_ble_gatts_value_set(m_value_handle, 0, &len, value);
+        }
+        op_complete(seq, err_code);
+
+        main_loop_run();
+    }
+}
+
+
+/**@brief Function for running a notification workload.
+ *
+ * @details Notifications are sent as long as the command encoder has room for them, and the
+ *          echoes are collected until all arrived or none arrived for a while.
+ */
+static void notify_workload_run(const workload_t * p_workload)
+{
+    uint8_t  value[VALUE_LEN_MAX] = {0};
+    uint32_t seq                  = 0;
+    uint64_t idle_start;
+
+    while (mp_result->done_count < p_workload->count)
+    {
+        if (seq < p_workload->count)
+        {
+            ble_gatts_hvx_params_t hvx_params;
+            uint16_t               len = p_workload->len;
+            uint32_t               err_code;
+
+            (void)uint32_encode(seq, value);
+            memset(&hvx_params, 0, sizeof(hvx_params));
+            hvx_params.handle = m_value_handle;
+            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+            hvx_params.p_len  = &len;
+            hvx_params.p_data = value;
+
+            mp_result->p_send_time[seq] = rpc_port_time_us();
+            err_code = ble_rpc_gatts_hvx_async(BENCH_CONN_HANDLE,
+                                               &hvx_params,
+                                               hvx_resp_handle,
+                                               (void *)(uintptr_t)seq,
+                                               NULL);
+            if (err_code == NRF_SUCCESS)
+            {
+                seq++;
+                continue;
+            }
+            if (err_code != NRF_ERROR_NO_MEM)
+            {
+                op_complete(seq++, err_code);
+                continue;
+            }
+        }
+
+        // No room for another notification, or all sent.
+        UNUSED_VARIABLE(rpc_port_wait());
+        main_loop_run();
+    }
+
+    idle_start = rpc_port_time_us();
+    while ((mp_result->echo_count < (mp_result->done_count - mp_result->error_count)) &&
+           ((rpc_port_time_us() - idle_start) < ECHO_DRAIN_TIME_US))
+    {
+        const uint32_t echo_count = mp_result->echo_count;
+
+        UNUSED_VARIABLE(rpc_port_wait());
+        main_loop_run();
+        if (mp_result->echo_count != echo_count)
+        {
+            idle_start = rpc_port_time_us();
+        }
+    }
+}
+
+
+/**@brief Function for comparing two latencies for sorting. */
+static int latency_compare(const void * p_a, const void * p_b)
+{
+    const uint32_t a = *(const uint32_t *)p_a;
+    const uint32_t b = *(const uint32_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Function for printing the latency distribution of the completed operations.
+ *
+ * @param[in] p_name      Name of the row.
+ * @param[in] p_latency   Latencies, 0 for operations which did not complete.
+ * @param[in] count       Number of operations.
+ * @param[in] errors      Number of operations completed with an error.
+ * @param[in] elapsed_us  Duration of the workload.
+ */
+static void latency_print(const char *     p_name,
+                          uint32_t *       p_latency,
+                          uint32_t         count,
+                          uint32_t         errors,
+                          uint64_t         elapsed_us)
+{
+    uint32_t done = 0;
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (p_latency[i] != 0)
+        {
+            p_latency[done++] = p_latency[i];
+        }
+    }
+    qsort(p_latency, done, sizeof(uint32_t), latency_compare);
+
+    printf("%-14s %8u %7u %10.0f", p_name, done, errors,
+           (elapsed_us != 0) ? (done * 1e6 / elapsed_us) : 0.0);
+    if (done != 0)
+    {
+        // Nearest rank percentiles.
+        printf(" %9u %9u %9u\n",
+               p_latency[(done * 50u + 99u) / 100u - 1u],
+               p_latency[(done * 99u + 99u) / 100u - 1u],
+               p_latency[done - 1u]);
+    }
+    else
+    {
+        printf(" %9s %9s %9s\n", "-", "-", "-");
+    }
+}
+
+
+/**@brief Function for running a workload and printing its results. */
+static void workload_run(const workload_t * p_workload)
+{
+    static const char * const names[] = {"adv", "write", "notify"};
+    result_t                  result;
+    uint64_t                  start;
+    uint64_t                  elapsed;
+
+    memset(&result, 0, sizeof(result));
+    result.count       = p_workload->count;
+    result.p_latency   = calloc(p_workload->count, sizeof(uint32_t));
+    result.p_send_time = calloc(p_workload->count, sizeof(uint64_t));
+    if (p_workload->type == WORKLOAD_NOTIFY)
+    {
+        result.p_echo_latency = calloc(p_workload->count, sizeof(uint32_t));
+    }
+    mp_result = &result;
+
+    start = rpc_port_time_us();
+    if (p_workload->type == WORKLOAD_NOTIFY)
+    {
+        notify_workload_run(p_workload);
+    }
+    else
+    {
+        sync_workload_run(p_workload);
+    }
+    elapsed   = rpc_port_time_us() - start;
+    mp_result = NULL;
+
+    latency_print(names[p_workload->type], result.p_latency, result.count, result.error_count,
+                  elapsed);
+    if (result.p_echo_latency != NULL)
+    {
+        latency_print("notify-echo", result.p_echo_latency, result.count, 0, elapsed);
+    }
+
+    free(result.p_latency);
+    free(result.p_send_time);
+    free(result.p_echo_latency);
+}
+
+
+/**@brief Function for adding the service used by the workloads. */
+static void service_add(void)
+{
+    ble_uuid_t               uuid;
+    ble_gatts_char_md_t      char_md;
+    ble_gatts_attr_md_t      cccd_md;
+    ble_gatts_attr_md_t      attr_md;
+    ble_gatts_attr_t         attr_char_value;
+    ble_gatts_char_handles_t handles;
+    uint16_t                 service_handle;
+    uint8_t                  init_value[VALUE_LEN_MAX] = {0};
+    uint32_t                 err_code;
+
+    BLE_UUID_BLE_ASSIGN(uuid, BENCH_SRVC_UUID);
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &uuid, &service_handle);
+    APP_ERROR_CHECK(err_code);
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.notify        = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_cccd_md                = &cccd_md;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    attr_md.vloc = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen = 1;
+
+    BLE_UUID_BLE_ASSIGN(uuid, BENCH_CHAR_UUID);
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid    = &uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(init_value);
+    attr_char_value.max_len   = sizeof(init_value);
+    attr_char_value.p_value   = init_value;
+
+    err_code = sd_ble_gatts_characteristic_add(service_handle, &char_md, &attr_char_value,
+                                               &handles);
+    APP_ERROR_CHECK(err_code);
+    m_value_handle = handles.value_handle;
+}
+
+
+/**@brief Function for starting the connectivity side.
+ *
+ * @return Socket to the connectivity side.
+ */
+static int conn_start(const char * p_path,
+                      uint32_t     baud_rate,
+                      uint32_t     loss_ppm,
+                      uint32_t     drop_interval,
+                      uint32_t     seed)
+{
+    int   fds[2];
+    pid_t pid;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        perror("socketpair");
+        exit(1);
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        char fd_arg[16];
+        char baud_arg[16];
+        char loss_arg[16];
+        char drop_arg[16];
+        char seed_arg[16];
+
+        close(fds[0]);
+        snprintf(fd_arg, sizeof(fd_arg), "%d", fds[1]);
+        snprintf(baud_arg, sizeof(baud_arg), "%u", baud_rate);
+        snprintf(loss_arg, sizeof(loss_arg), "%u", loss_ppm);
+        snprintf(drop_arg, sizeof(drop_arg), "%u", drop_interval);
+        // The two directions get different corruption patterns.
+        snprintf(seed_arg, sizeof(seed_arg), "%u", seed ^ 0x5A5A5A5Au);
+        execl(p_path, p_path, fd_arg, baud_arg, loss_arg, drop_arg, seed_arg, (char *)NULL);
+        perror(p_path);
+        _exit(1);
+    }
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+
+    close(fds[1]);
+    return fds[0];
+}
+
+
+int main(int argc, char * argv[])
+{
+    static char           script[SCRIPT_SIZE_MAX];
+    const char *          p_conn_path   = NULL;
+    char                  conn_path[256];
+    uint32_t              baud_rate     = USED_BAUD_RATE;
+    uint32_t              loss_ppm      = 0;
+    uint32_t              drop_interval = 0;
+    uint32_t              seed          = 1;
+    uint32_t              err_code;
+    uint32_t              i;
+    int                   fd;
+    int                   opt;
+    hci_transport_stats_t stats;
+    rpc_port_stats_t      port_stats;
+
+    while ((opt = getopt(argc, argv, "r:l:d:s:c:f:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                baud_rate = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 'l':
+                loss_ppm = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 'd':
+                drop_interval = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 'c':
+                p_conn_path = optarg;
+                break;
+
+            case 'f':
+            {
+                FILE * p_file = fopen(optarg, "r");
+                size_t length;
+
+                if (p_file == NULL)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                length         = fread(script, 1, sizeof(script) - 1, p_file);
+                script[length] = '\0';
+                fclose(p_file);
+                if (!script_parse(script))
+                {
+                    return 1;
+                }
+                break;
+            }
+
+            default:
+                fprintf(stderr,
+                        "usage: %s [-r baud] [-l loss_ppm] [-d drop_interval] [-s seed] "
+                        "[-c rpc_bench_conn] [-f script] [workload ...]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    for (i = optind; i < (uint32_t)argc; i++)
+    {
+        if (!workload_parse(argv[i]))
+        {
+            fprintf(stderr, "invalid workload: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (m_workload_count == 0)
+    {
+        strcpy(script, DEFAULT_SCRIPT);
+        UNUSED_VARIABLE(script_parse(script));
+    }
+
+    if (p_conn_path == NULL)
+    {
+        // Next to this program.
+        const char * p_slash = strrchr(argv[0], '/');
+        const int    dir_len = (p_slash != NULL) ? (int)(p_slash - argv[0] + 1) : 0;
+
+        snprintf(conn_path, sizeof(conn_path), "%.*srpc_bench_conn", dir_len, argv[0]);
+        p_conn_path = conn_path;
+    }
+
+    fd = conn_start(p_conn_path, baud_rate, loss_ppm, drop_interval, seed);
+    rpc_port_init(fd, baud_rate, loss_ppm, drop_interval, seed);
+
+    // As sd_softdevice_enable of the application chip does.
+    err_code = ble_rpc_pkt_receiver_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = ble_rpc_cmd_encoder_init();
+    APP_ERROR_CHECK(err_code);
+
+    service_add();
+
+    printf("baud %u, loss %u ppm, drop interval %u, seed %u\n",
+           baud_rate, loss_ppm, drop_interval, seed);
+    printf("%-14s %8s %7s %10s %9s %9s %9s\n",
+           "workload", "ops", "errors", "ops/s", "p50 us", "p99 us", "max us");
+    for (i = 0; i < m_workload_count; i++)
+    {
+        workload_run(&m_workloads[i]);
+    }
+
+    hci_transport_stats_get(&stats);
+    rpc_port_stats_get(&port_stats);
+    printf("events received: %u\n", m_evt_count);
+    printf("application:  tx %u retransmit %u timeout %u fail %u resync %u, "
+           "rx %u discard %u, bytes corrupted %u, frames dropped %u\n",
+           stats.tx_pkt_count, stats.tx_retransmit_count, stats.tx_timeout_count,
+           stats.tx_fail_count, stats.tx_resync_count, stats.rx_pkt_count,
+           stats.rx_discard_count, port_stats.tx_corrupt_count, port_stats.tx_drop_count);
+    fflush(stdout);
+
+    // The connectivity side prints its statistics once the link is closed.
+    close(fd);
+    wait(NULL);
+    return 0;
+}
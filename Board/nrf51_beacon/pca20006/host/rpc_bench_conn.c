@@ -0,0 +1,401 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Connectivity side of the RPC benchmark, started by rpc_bench.c.
+ *
+ * @details Runs the command decoders and the event encoder on @ref hci_transport against a fake
+ *          SoftDevice. Every notification is echoed as a BLE_GATTS_EVT_WRITE carrying the same
+ *          data, as from a peer acknowledging each notification with a Write Command, which
+ *          loads the event path. Build with:
+ *
+ *          gcc -O2 -Wall -Wno-pointer-to-int-cast -DNRF51 -DBOARD_PCA10001 -DBLE_STACK_SUPPORT_REQD
+ *              -DSVCALL_AS_NORMAL_FUNCTION -I. -I../../../../Include -I../../../../Include/gcc
+ *              -I../../../../Include/app_common -I../../../../Include/s110
+ *              -I../../../../Include/sd_common -I../../../../Include/ble/rpc
+ *              rpc_bench_conn.c rpc_bench_port.c ../../../../Source/ble/rpc/ble_rpc_cmd_decoder*.c
+ *              ../../../../Source/ble/rpc/ble_rpc_event_encoder*.c
+ *              ../../../../Source/ble/rpc/ble_rpc_codec*.c
+ *              ../../../../Source/app_common/hci_transport.c
+ *              ../../../../Source/app_common/hci_mem_pool.c
+ *              ../../../../Source/app_common/hci_slip.c
+ *              ../../../../Source/app_common/crc16.c -Wl,--wrap=hci_transport_pkt_write
+ *              -o rpc_bench_conn
+ *
+ *          Usage: rpc_bench_conn fd baud_rate loss_ppm drop_interval seed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "rpc_bench_port.h"
+#include "ble.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "hci_transport.h"
+#include "ble_rpc_cmd_decoder.h"
+#include "ble_rpc_event_encoder.h"
+#include "ble_stack_handler_types.h"
+
+#define EVT_QUEUE_SIZE          32u                                 /**< Number of SoftDevice events waiting to be encoded. */
+#define TX_QUEUE_SIZE           (HCI_TRANSPORT_TX_WINDOW_SIZE + 1u) /**< Number of packets waiting for TX done. */
+#define ECHO_DATA_SIZE_MAX      (GATT_MTU_SIZE_DEFAULT - 3u)        /**< Largest data of an echoed Write Command. */
+#define FIRST_ATTR_HANDLE       0x000Cu                             /**< Handle of the first attribute added. */
+
+/**@brief SoftDevice event, word aligned storage for a @ref ble_evt_t. */
+typedef struct
+{
+    uint32_t evt_buf[CEIL_DIV(BLE_STACK_EVT_MSG_BUF_SIZE, sizeof(uint32_t))]; /**< Event data. */
+} evt_elem_t;
+
+uint32_t __real_hci_transport_pkt_write(const uint8_t * p_buffer, uint32_t length);
+
+static evt_elem_t      m_evt_queue[EVT_QUEUE_SIZE];                 /**< SoftDevice events, in order. */
+static uint32_t        m_evt_head;                                  /**< Index of the oldest event. */
+static uint32_t        m_evt_count;                                 /**< Number of events. */
+static const uint8_t * m_tx_queue[TX_QUEUE_SIZE];                   /**< Written packets waiting for TX done, in order. */
+static uint32_t        m_tx_head;                                   /**< Index of the oldest written packet. */
+static uint32_t        m_tx_count;                                  /**< Number of written packets. */
+static uint16_t        m_next_handle = FIRST_ATTR_HANDLE;           /**< Next attribute handle given out. */
+
+
+/**@brief Function for queuing a SoftDevice event.
+ *
+ * @return Event to fill in, NULL if the queue is full.
+ */
+static ble_evt_t * evt_alloc(void)
+{
+    ble_evt_t * p_evt;
+
+    if (m_evt_count == EVT_QUEUE_SIZE)
+    {
+        return NULL;
+    }
+
+    p_evt = (ble_evt_t *)m_evt_queue[(m_evt_head + m_evt_count) % EVT_QUEUE_SIZE].evt_buf;
+    m_evt_count++;
+    memset(p_evt, 0, sizeof(evt_elem_t));
+    return p_evt;
+}
+
+
+/**@brief Function for passing the SoftDevice events to the event encoder, as the SoftDevice
+ *        handler does.
+ */
+static void evts_process(void)
+{
+    while (m_evt_count != 0)
+    {
+        ble_evt_t * p_evt = (ble_evt_t *)m_evt_queue[m_evt_head].evt_buf;
+
+        ble_rpc_event_handle(p_evt);
+        m_evt_head = (m_evt_head + 1u) % EVT_QUEUE_SIZE;
+        m_evt_count--;
+    }
+}
+
+
+/**@brief Function for recording the written packets, so the TX done handler frees the right
+ *        buffer.
+ */
+uint32_t __wrap_hci_transport_pkt_write(const uint8_t * p_buffer, uint32_t length)
+{
+    const uint32_t err_code = __real_hci_transport_pkt_write(p_buffer, length);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_tx_queue[(m_tx_head + m_tx_count) % TX_QUEUE_SIZE] = p_buffer;
+        m_tx_count++;
+    }
+    return err_code;
+}
+
+
+/**@brief Function for handling the TX done event, as the connectivity application does. */
+static void transport_tx_done_handle(hci_transport_tx_done_result_t result)
+{
+    uint32_t err_code;
+
+    APP_ERROR_CHECK_BOOL(m_tx_count != 0);
+
+    err_code = hci_transport_tx_buffer_free((uint8_t *)m_tx_queue[m_tx_head]);
+    APP_ERROR_CHECK(err_code);
+    m_tx_head = (m_tx_head + 1u) % TX_QUEUE_SIZE;
+    m_tx_count--;
+
+    ble_rpc_cmd_tx_done_handle();
+    ble_rpc_event_tx_done_handle();
+}
+
+
+/**@brief Function for handling the transport layer events, as the connectivity application does. */
+static void transport_evt_handle(hci_transport_evt_t event)
+{
+    if (event.evt_type == HCI_TRANSPORT_RX_RDY)
+    {
+        const uint32_t err_code = app_sched_event_put(NULL, 0, ble_rpc_cmd_handle);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+uint32_t sd_app_evt_wait(void)
+{
+    return rpc_port_wait() ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+}
+
+
+uint32_t sd_power_system_off(void)
+{
+    rpc_port_flush();
+    exit(0);
+}
+
+
+uint32_t sd_ble_uuid_encode(ble_uuid_t const * const p_uuid,
+                            uint8_t * const          p_uuid_le_len,
+                            uint8_t * const          p_uuid_le)
+{
+    if (p_uuid_le_len != NULL)
+    {
+        *p_uuid_le_len = sizeof(uint16_t);
+    }
+    if (p_uuid_le != NULL)
+    {
+        p_uuid_le[0] = (uint8_t)p_uuid->uuid;
+        p_uuid_le[1] = (uint8_t)(p_uuid->uuid >> 8);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_data_set(uint8_t const * const p_data,
+                                 uint8_t               dlen,
+                                 uint8_t const * const p_sr_data,
+                                 uint8_t               srdlen)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * const p_adv_params)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_appearance_get(uint16_t * const p_appearance)
+{
+    *p_appearance = 0;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t                            conn_handle,
+                                      ble_gap_conn_params_t const * const p_conn_params)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_name_get(uint8_t * const p_dev_name, uint16_t * const p_len)
+{
+    static const char name[] = "rpc_bench";
+
+    if (*p_len < (sizeof(name) - 1))
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    memcpy(p_dev_name, name, sizeof(name) - 1);
+    *p_len = sizeof(name) - 1;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * const p_write_perm,
+                                    uint8_t const * const                 p_dev_name,
+                                    uint16_t                              len)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t * const p_conn_params)
+{
+    memset(p_conn_params, 0, sizeof(*p_conn_params));
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * const p_conn_params)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_sec_info_reply(uint16_t                          conn_handle,
+                                   ble_gap_enc_info_t const * const  p_enc_info,
+                                   ble_gap_sign_info_t const * const p_sign_info)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_sec_params_reply(uint16_t                           conn_handle,
+                                     uint8_t                            sec_status,
+                                     ble_gap_sec_params_t const * const p_sec_params)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_service_add(uint8_t                  type,
+                                  ble_uuid_t const * const p_uuid,
+                                  uint16_t * const         p_handle)
+{
+    *p_handle = m_next_handle++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t                         service_handle,
+                                         ble_gatts_char_md_t const * const p_char_md,
+                                         ble_gatts_attr_t const * const    p_attr_char_value,
+                                         ble_gatts_char_handles_t * const  p_handles)
+{
+    m_next_handle++;                                                // Declaration.
+    p_handles->value_handle     = m_next_handle++;
+    p_handles->user_desc_handle = BLE_GATT_HANDLE_INVALID;
+    p_handles->cccd_handle      = m_next_handle++;
+    p_handles->sccd_handle      = BLE_GATT_HANDLE_INVALID;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * const p_hvx_params)
+{
+    ble_evt_t *             p_evt;
+    ble_gatts_evt_write_t * p_write;
+    uint16_t                len;
+
+    if ((p_hvx_params->p_len == NULL) || (p_hvx_params->p_data == NULL))
+    {
+        return NRF_SUCCESS;
+    }
+
+    p_evt = evt_alloc();
+    if (p_evt == NULL)
+    {
+        return BLE_ERROR_NO_TX_BUFFERS;
+    }
+
+    len     = MIN(*p_hvx_params->p_len, ECHO_DATA_SIZE_MAX);
+    p_write = &p_evt->evt.gatts_evt.params.write;
+
+    p_evt->header.evt_id                = BLE_GATTS_EVT_WRITE;
+    p_evt->header.evt_len               = (uint16_t)(offsetof(ble_gatts_evt_t, params) +
+                                                     offsetof(ble_gatts_evt_write_t, data) + len);
+    p_evt->evt.gatts_evt.conn_handle    = conn_handle;
+    p_write->handle                     = p_hvx_params->handle;
+    p_write->op                         = BLE_GATTS_OP_WRITE_CMD;
+    p_write->context.value_handle       = p_hvx_params->handle;
+    p_write->len                        = len;
+    memcpy(p_write->data, p_hvx_params->p_data, len);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_sys_attr_get(uint16_t          conn_handle,
+                                   uint8_t * const   p_sys_attr_data,
+                                   uint16_t * const  p_len)
+{
+    *p_len = 0;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t              conn_handle,
+                                   uint8_t const * const p_sys_attr_data,
+                                   uint16_t              len)
+{
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_set(uint16_t              handle,
+                                uint16_t              offset,
+                                uint16_t * const      p_len,
+                                uint8_t const * const p_value)
+{
+    return NRF_SUCCESS;
+}
+
+
+int main(int argc, char * argv[])
+{
+    uint32_t              err_code;
+    hci_transport_stats_t stats;
+    rpc_port_stats_t      port_stats;
+
+    if (argc != 6)
+    {
+        fprintf(stderr, "usage: %s fd baud_rate loss_ppm drop_interval seed\n", argv[0]);
+        return 1;
+    }
+
+    rpc_port_init(atoi(argv[1]),
+                  (uint32_t)strtoul(argv[2], NULL, 0),
+                  (uint32_t)strtoul(argv[3], NULL, 0),
+                  (uint32_t)strtoul(argv[4], NULL, 0),
+                  (uint32_t)strtoul(argv[5], NULL, 0));
+
+    err_code = hci_transport_open();
+    APP_ERROR_CHECK(err_code);
+    err_code = hci_transport_evt_handler_reg(transport_evt_handle);
+    APP_ERROR_CHECK(err_code);
+    err_code = hci_transport_tx_done_register(transport_tx_done_handle);
+    APP_ERROR_CHECK(err_code);
+
+    // Runs until the application side closes the link.
+    while (rpc_port_wait())
+    {
+        app_sched_execute();
+        evts_process();
+    }
+
+    hci_transport_stats_get(&stats);
+    rpc_port_stats_get(&port_stats);
+    fprintf(stderr,
+            "connectivity: tx %u retransmit %u timeout %u fail %u resync %u, "
+            "rx %u discard %u, bytes corrupted %u, frames dropped %u\n",
+            stats.tx_pkt_count, stats.tx_retransmit_count, stats.tx_timeout_count,
+            stats.tx_fail_count, stats.tx_resync_count, stats.rx_pkt_count,
+            stats.rx_discard_count, port_stats.tx_corrupt_count, port_stats.tx_drop_count);
+    return 0;
+}
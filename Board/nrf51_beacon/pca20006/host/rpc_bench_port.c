@@ -0,0 +1,516 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include "rpc_bench_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include "app_uart.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+#include "app_error.h"
+#include "nrf_error.h"
+#include "nordic_common.h"
+
+#define UART_TX_FIFO_SIZE       32u                                 /**< Size of the emulated UART TX FIFO. */
+#define UART_RX_FIFO_SIZE       4096u                               /**< Size of the emulated UART RX FIFO. */
+#define BITS_PER_BYTE           10u                                 /**< Start bit, 8 data bits and stop bit. */
+#define TIMER_COUNT_MAX         8u                                  /**< Number of app_timer instances. */
+#define TIMER_COUNTER_MASK      0x00FFFFFFu                         /**< The RTC counter is 24 bits. */
+#define SCHED_QUEUE_SIZE        64u                                 /**< Number of scheduler events. */
+#define SCHED_EVENT_SIZE_MAX    32u                                 /**< Largest scheduler event data. */
+#define SLIP_END                0xC0u                               /**< Delimiter at the start and end of a SLIP frame. */
+
+/**@brief Emulated app_timer instance. */
+typedef struct
+{
+    app_timer_timeout_handler_t handler;                            /**< Timeout handler, NULL if not created. */
+    app_timer_mode_t            mode;                               /**< Single shot or repeated. */
+    bool                        is_running;                         /**< True if the timer is started. */
+    uint64_t                    expiry_us;                          /**< Time of the next timeout. */
+    uint64_t                    period_us;                          /**< Timeout interval. */
+    void *                      p_context;                          /**< Context given to the timeout handler. */
+} port_timer_t;
+
+/**@brief Scheduler event. */
+typedef struct
+{
+    app_sched_event_handler_t handler;                              /**< Event handler. */
+    uint16_t                  size;                                 /**< Size of the event data. */
+    uint8_t                   data[SCHED_EVENT_SIZE_MAX];           /**< Copy of the event data. */
+} port_sched_evt_t;
+
+static int                      m_fd;                               /**< Socket to the other side. */
+static uint32_t                 m_byte_time_ns;                     /**< Time one byte takes on the line, 0 for no limit. */
+static uint32_t                 m_loss_ppm;                         /**< Bytes in a million which are corrupted. */
+static uint32_t                 m_drop_interval;                    /**< Every Nth SLIP frame sent is lost, 0 for none. */
+static uint32_t                 m_tx_frame_count;                   /**< SLIP frames started on the line. */
+static bool                     m_is_tx_in_frame;                   /**< True between the delimiters of a SLIP frame. */
+static bool                     m_is_tx_frame_dropped;              /**< True if the SLIP frame being sent is lost. */
+static uint32_t                 m_rand_state;                       /**< State of the corruption pattern generator. */
+static struct timespec          m_start_time;                       /**< Time of rpc_port_init. */
+static rpc_port_stats_t         m_stats;                            /**< Link statistics. */
+
+static app_uart_event_handler_t m_uart_handler;                     /**< Event handler of the SLIP layer. */
+static uint8_t                  m_tx_fifo[UART_TX_FIFO_SIZE];       /**< Bytes waiting to go on the line. */
+static uint32_t                 m_tx_count;                         /**< Number of bytes in m_tx_fifo. */
+static uint64_t                 m_tx_line_free_ns;                  /**< Time the line is done with the byte being sent. */
+static uint8_t                  m_rx_fifo[UART_RX_FIFO_SIZE];       /**< Bytes received. */
+static uint32_t                 m_rx_head;                          /**< Index of the next byte to read from m_rx_fifo. */
+static uint32_t                 m_rx_count;                         /**< Number of bytes in m_rx_fifo. */
+
+static port_timer_t             m_timers[TIMER_COUNT_MAX];          /**< Timer instances. */
+static uint32_t                 m_timer_count;                      /**< Number of timers created. */
+
+static port_sched_evt_t         m_sched_queue[SCHED_QUEUE_SIZE];    /**< Scheduler events, in order. */
+static uint32_t                 m_sched_head;                       /**< Index of the oldest scheduler event. */
+static uint32_t                 m_sched_count;                      /**< Number of scheduler events. */
+
+
+/**@brief Function for getting the time since rpc_port_init in nanoseconds. */
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - m_start_time.tv_sec) * 1000000000uLL +
+           (uint64_t)now.tv_nsec - (uint64_t)m_start_time.tv_nsec;
+}
+
+
+uint64_t rpc_port_time_us(void)
+{
+    return time_ns() / 1000u;
+}
+
+
+/**@brief Function for getting the next value of the corruption pattern (xorshift32). */
+static uint32_t rand_next(void)
+{
+    m_rand_state ^= m_rand_state << 13;
+    m_rand_state ^= m_rand_state >> 17;
+    m_rand_state ^= m_rand_state << 5;
+    return m_rand_state;
+}
+
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "error 0x%x at %s:%u\n", error_code, (const char *)p_file_name, line_num);
+    exit(2);
+}
+
+
+uint32_t app_uart_init(const app_uart_comm_params_t * p_comm_params,
+                             app_uart_buffers_t *     p_buffers,
+                             app_uart_event_handler_t error_handler,
+                             app_irq_priority_t       irq_priority,
+                             uint16_t *               p_uart_uid)
+{
+    m_uart_handler = error_handler;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_put(uint8_t byte)
+{
+    if (m_tx_count == UART_TX_FIFO_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    if (m_tx_count == 0)
+    {
+        // The line has been idle.
+        const uint64_t now = time_ns();
+
+        if (m_tx_line_free_ns < now)
+        {
+            m_tx_line_free_ns = now;
+        }
+    }
+
+    m_tx_fifo[m_tx_count++] = byte;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_get(uint8_t * p_byte)
+{
+    if (m_rx_count == 0)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *p_byte   = m_rx_fifo[m_rx_head];
+    m_rx_head = (m_rx_head + 1u) % UART_RX_FIFO_SIZE;
+    m_rx_count--;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_uart_close(uint16_t app_uart_id)
+{
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for writing all bytes of a buffer to the socket. */
+static void socket_write(const uint8_t * p_data, uint32_t length)
+{
+    while (length != 0)
+    {
+        const ssize_t written = write(m_fd, p_data, length);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // The other side has gone, its bytes are not needed any more.
+            return;
+        }
+        p_data += written;
+        length -= (uint32_t)written;
+    }
+}
+
+
+/**@brief Function for deciding whether a byte sent is lost with its SLIP frame.
+ *
+ * @details Emulates a lossy link at the packet level: the other side never sees the frame, so
+ *          the transport has to retransmit it, or its acknowledgement.
+ *
+ * @param[in]  byte   Byte sent.
+ *
+ * @return true if the byte is lost.
+ */
+static bool tx_frame_drop(uint8_t byte)
+{
+    bool is_dropped;
+
+    if (!m_is_tx_in_frame && (byte == SLIP_END))
+    {
+        m_is_tx_in_frame      = true;
+        m_tx_frame_count++;
+        m_is_tx_frame_dropped = (m_drop_interval != 0) && ((m_tx_frame_count % m_drop_interval) == 0);
+        if (m_is_tx_frame_dropped)
+        {
+            m_stats.tx_drop_count++;
+        }
+        return m_is_tx_frame_dropped;
+    }
+
+    is_dropped = m_is_tx_in_frame && m_is_tx_frame_dropped;
+    if (m_is_tx_in_frame && (byte == SLIP_END))
+    {
+        m_is_tx_in_frame = false;
+    }
+    return is_dropped;
+}
+
+
+/**@brief Function for putting the bytes on the line which the line rate allows by now.
+ *
+ * @return true if the TX FIFO became empty, and the SLIP layer got APP_UART_TX_EMPTY.
+ */
+static bool uart_tx_process(void)
+{
+    const uint64_t now   = time_ns();
+    uint32_t       count = 0;
+    uint32_t       sent  = 0;
+    uint8_t        line[UART_TX_FIFO_SIZE];
+    uint32_t       i;
+
+    while ((count < m_tx_count) && (m_tx_line_free_ns <= now))
+    {
+        m_tx_line_free_ns += m_byte_time_ns;
+        count++;
+    }
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (tx_frame_drop(m_tx_fifo[i]))
+        {
+            continue;
+        }
+        line[sent] = m_tx_fifo[i];
+        if ((m_loss_ppm != 0) && ((rand_next() % 1000000u) < m_loss_ppm))
+        {
+            line[sent] ^= (uint8_t)(1u << (rand_next() & 7u));
+            m_stats.tx_corrupt_count++;
+        }
+        sent++;
+    }
+    socket_write(line, sent);
+    m_stats.tx_byte_count += count;
+
+    m_tx_count -= count;
+    memmove(m_tx_fifo, &m_tx_fifo[count], m_tx_count);
+
+    if (m_tx_count == 0)
+    {
+        app_uart_evt_t evt;
+
+        evt.evt_type = APP_UART_TX_EMPTY;
+        m_uart_handler(&evt);
+        return true;
+    }
+    return false;
+}
+
+
+/**@brief Function for running the timers which have expired.
+ *
+ * @return true if a timeout handler was run.
+ */
+static bool timers_process(void)
+{
+    const uint64_t now    = rpc_port_time_us();
+    bool           is_run = false;
+    uint32_t       i;
+
+    for (i = 0; i < m_timer_count; i++)
+    {
+        port_timer_t * p_timer = &m_timers[i];
+
+        if (p_timer->is_running && (p_timer->expiry_us <= now))
+        {
+            if (p_timer->mode == APP_TIMER_MODE_REPEATED)
+            {
+                p_timer->expiry_us += p_timer->period_us;
+            }
+            else
+            {
+                p_timer->is_running = false;
+            }
+            p_timer->handler(p_timer->p_context);
+            is_run = true;
+        }
+    }
+    return is_run;
+}
+
+
+/**@brief Function for getting the time until the next timer expiry or TX byte.
+ *
+ * @return Time in nanoseconds, UINT64_MAX if nothing is pending.
+ */
+static uint64_t next_deadline_get(void)
+{
+    const uint64_t now      = time_ns();
+    uint64_t       deadline = UINT64_MAX;
+    uint32_t       i;
+
+    if (m_tx_count != 0)
+    {
+        deadline = m_tx_line_free_ns;
+    }
+    for (i = 0; i < m_timer_count; i++)
+    {
+        if (m_timers[i].is_running && ((m_timers[i].expiry_us * 1000u) < deadline))
+        {
+            deadline = m_timers[i].expiry_us * 1000u;
+        }
+    }
+
+    if (deadline == UINT64_MAX)
+    {
+        return deadline;
+    }
+    return (deadline > now) ? (deadline - now) : 0;
+}
+
+
+bool rpc_port_wait(void)
+{
+    for (;;)
+    {
+        struct pollfd   pfd = {m_fd, POLLIN, 0};
+        struct timespec timeout;
+        uint64_t        wait_ns;
+        int             ready;
+
+        if (timers_process() | uart_tx_process())
+        {
+            return true;
+        }
+
+        wait_ns         = next_deadline_get();
+        timeout.tv_sec  = (time_t)(wait_ns / 1000000000u);
+        timeout.tv_nsec = (long)(wait_ns % 1000000000u);
+
+        ready = ppoll(&pfd, 1, (wait_ns == UINT64_MAX) ? NULL : &timeout, NULL);
+        if ((ready > 0) && (pfd.revents != 0))
+        {
+            uint8_t        buffer[UART_RX_FIFO_SIZE];
+            const uint32_t room   = UART_RX_FIFO_SIZE - m_rx_count;
+            const ssize_t  length = read(m_fd, buffer, room);
+            ssize_t        i;
+            app_uart_evt_t evt;
+
+            if (length <= 0)
+            {
+                return false;
+            }
+
+            for (i = 0; i < length; i++)
+            {
+                m_rx_fifo[(m_rx_head + m_rx_count) % UART_RX_FIFO_SIZE] = buffer[i];
+                m_rx_count++;
+            }
+            m_stats.rx_byte_count += (uint32_t)length;
+
+            evt.evt_type = APP_UART_DATA_READY;
+            m_uart_handler(&evt);
+            return true;
+        }
+    }
+}
+
+
+void rpc_port_flush(void)
+{
+    while (m_tx_count != 0)
+    {
+        UNUSED_VARIABLE(rpc_port_wait());
+    }
+}
+
+
+void host_wfe(void)
+{
+    if (!rpc_port_wait())
+    {
+        fprintf(stderr, "link closed\n");
+        exit(2);
+    }
+}
+
+
+void rpc_port_init(int fd, uint32_t baud_rate, uint32_t loss_ppm, uint32_t drop_interval, uint32_t seed)
+{
+    clock_gettime(CLOCK_MONOTONIC, &m_start_time);
+
+    m_fd            = fd;
+    m_byte_time_ns  = (baud_rate == 0) ? 0 : (uint32_t)(BITS_PER_BYTE * 1000000000uLL / baud_rate);
+    m_loss_ppm      = loss_ppm;
+    m_drop_interval = drop_interval;
+    m_rand_state    = (seed == 0) ? 1u : seed;
+}
+
+
+void rpc_port_stats_get(rpc_port_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+
+uint32_t app_timer_create(app_timer_id_t *            p_timer_id,
+                          app_timer_mode_t            mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    if (m_timer_count == TIMER_COUNT_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    m_timers[m_timer_count].handler = timeout_handler;
+    m_timers[m_timer_count].mode    = mode;
+    *p_timer_id                     = m_timer_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    port_timer_t * p_timer = &m_timers[timer_id];
+
+    p_timer->period_us  = (uint64_t)timeout_ticks * 1000000u / APP_TIMER_CLOCK_FREQ;
+    p_timer->expiry_us  = rpc_port_time_us() + p_timer->period_us;
+    p_timer->p_context  = p_context;
+    p_timer->is_running = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    m_timers[timer_id].is_running = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    *p_ticks = (uint32_t)(rpc_port_time_us() * APP_TIMER_CLOCK_FREQ / 1000000u) &
+               TIMER_COUNTER_MASK;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t   ticks_to,
+                                    uint32_t   ticks_from,
+                                    uint32_t * p_ticks_diff)
+{
+    *p_ticks_diff = (ticks_to - ticks_from) & TIMER_COUNTER_MASK;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_sched_event_put(void *                    p_event_data,
+                             uint16_t                  event_size,
+                             app_sched_event_handler_t handler)
+{
+    port_sched_evt_t * p_evt;
+
+    if ((m_sched_count == SCHED_QUEUE_SIZE) || (event_size > SCHED_EVENT_SIZE_MAX))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_evt          = &m_sched_queue[(m_sched_head + m_sched_count) % SCHED_QUEUE_SIZE];
+    p_evt->handler = handler;
+    p_evt->size    = event_size;
+    if (event_size != 0)
+    {
+        memcpy(p_evt->data, p_event_data, event_size);
+    }
+    m_sched_count++;
+    return NRF_SUCCESS;
+}
+
+
+void app_sched_execute(void)
+{
+    while (m_sched_count != 0)
+    {
+        port_sched_evt_t evt = m_sched_queue[m_sched_head];
+
+        m_sched_head = (m_sched_head + 1u) % SCHED_QUEUE_SIZE;
+        m_sched_count--;
+
+        evt.handler((evt.size != 0) ? evt.data : NULL, evt.size);
+    }
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host platform of the RPC benchmark, see rpc_bench.c.
+ *
+ * @details Replaces app_uart, app_timer, app_scheduler and app_error for one side of the
+ *          serialization link. The UART is a socket to the other side. Bytes leave the TX FIFO at
+ *          the emulated line rate, and each byte can be corrupted to emulate a noisy line.
+ *
+ *          The program runs single threaded. UART and timer events, the interrupts of the target,
+ *          are only run from @ref rpc_port_wait. The main loop runs the scheduler with
+ *          app_sched_execute.
+ */
+
+#ifndef RPC_BENCH_PORT_H__
+#define RPC_BENCH_PORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Link statistics of one side. */
+typedef struct
+{
+    uint32_t tx_byte_count;                 /**< Bytes sent. */
+    uint32_t tx_corrupt_count;              /**< Bytes corrupted on the way to the other side. */
+    uint32_t tx_drop_count;                 /**< SLIP frames lost on the way to the other side. */
+    uint32_t rx_byte_count;                 /**< Bytes received. */
+} rpc_port_stats_t;
+
+/**@brief Function for initializing the host platform.
+ *
+ * @param[in]  fd              Connected socket to the other side.
+ * @param[in]  baud_rate       Emulated line rate in baud, 10 bits per byte. 0 for no limit.
+ * @param[in]  loss_ppm        Bytes in a million which get a bit flipped on the line.
+ * @param[in]  drop_interval   Every Nth SLIP frame sent is lost on the line, 0 for none.
+ * @param[in]  seed            Seed of the corruption pattern.
+ */
+void rpc_port_init(int fd, uint32_t baud_rate, uint32_t loss_ppm, uint32_t drop_interval, uint32_t seed);
+
+/**@brief Function for waiting until an emulated interrupt has run.
+ *
+ * @details Runs the timers which have expired and the UART events, sleeping until there is one.
+ *
+ * @return false once the other side has closed the link.
+ */
+bool rpc_port_wait(void);
+
+/**@brief Function for sending the bytes in the TX FIFO before exiting. */
+void rpc_port_flush(void);
+
+/**@brief Function for getting the time since @ref rpc_port_init.
+ *
+ * @return Time in microseconds.
+ */
+uint64_t rpc_port_time_us(void);
+
+/**@brief Function for getting the link statistics.
+ *
+ * @param[out] p_stats   Link statistics.
+ */
+void rpc_port_stats_get(rpc_port_stats_t * p_stats);
+
+#endif // RPC_BENCH_PORT_H__
@@ -0,0 +1,269 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @brief Host decoder of the beacon trace, see @ref app_trace.
+ *
+ * @details Takes the format strings from beacon_trace.h, so it must be built from the same source
+ *          as the firmware the trace comes from. Build with:
+ *
+ *          gcc -I../ble_app_beacon_bcs -I../../../../Include/app_common trace_decode.c
+ *              -o trace_decode
+ *
+ *          Usage:
+ *          - trace_decode [-p prescaler] <file>
+ *            Decodes a stream of records, as passed to the trace sink.
+ *          - trace_decode [-p prescaler] -r <read_pos> <write_pos> <file>
+ *            Decodes a dump of the trace ring m_ring, given the values of m_read_pos and
+ *            m_write_pos. The beacon has no UART and keeps the trace in RAM, read it out with a
+ *            debugger, e.g. "savebin trace.bin <address of m_ring> <APP_TRACE_BUF_WORDS * 4>".
+ *
+ *          Each record is printed with its sequence number and, if present, the time in
+ *          seconds from the RTC1 counter at 32768 / (prescaler + 1) Hz, APP_TIMER_PRESCALER of
+ *          the firmware, default 0. The 24 bit counter wraps every 512 s at prescaler 0, wraps
+ *          between records are counted as long as records are at most one wrap apart. Gaps in the
+ *          sequence numbers are reported as dropped records.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "beacon_trace.h"
+
+#define RTC_FREQUENCY       32768u                                      /**< RTC1 input frequency in Hz. */
+#define RTC_COUNTER_MASK    0x00FFFFFFu                                 /**< RTC1 counter width. */
+#define RECORD_WORDS_MAX    (1 + 1 + APP_TRACE_ARGS_MAX)                /**< Largest record: header, timestamp and arguments. */
+#define FILE_WORDS_MAX      (1u << 20)                                  /**< Largest input file in 32 bit words. */
+
+#define TRACE_FORMAT(ID, FORMAT)    [ID] = FORMAT,                      /**< Turns a message list into format strings indexed by ID. */
+
+static const char * const m_formats[TRACE_MSG_COUNT] =                  /**< Format strings of the messages. */
+{
+    BEACON_TRACE_MSG_LIST(TRACE_FORMAT)
+};
+
+static uint32_t m_prescaler;                                            /**< APP_TIMER_PRESCALER of the firmware. */
+static bool     m_is_first = true;                                      /**< No record printed yet. */
+static uint8_t  m_next_seq;                                             /**< Sequence number of the next record. */
+static uint32_t m_last_ticks;                                           /**< Timestamp of the previous record. */
+static uint64_t m_ticks;                                                /**< Unwrapped timestamp of the previous record. */
+
+
+/**@brief Function for decoding a little endian word. */
+static uint32_t word_decode(const uint8_t * p_data)
+{
+    return ((uint32_t)p_data[0])       |
+           ((uint32_t)p_data[1] << 8)  |
+           ((uint32_t)p_data[2] << 16) |
+           ((uint32_t)p_data[3] << 24);
+}
+
+
+/**@brief Function for getting the number of words of a record from its header. */
+static uint32_t record_words(uint32_t header)
+{
+    uint32_t words = 1 + ((header & APP_TRACE_HDR_ARGC_MSK) >> APP_TRACE_HDR_ARGC_POS);
+
+    if ((header & APP_TRACE_HDR_TIMESTAMP_MSK) != 0)
+    {
+        words++;
+    }
+    return words;
+}
+
+
+/**@brief Function for checking that a word can be a record header of this firmware. */
+static bool is_header_valid(uint32_t header)
+{
+    // Bits 19-23 are not used.
+    return ((header & APP_TRACE_HDR_ID_MSK) < TRACE_MSG_COUNT) && ((header & 0x00F80000uL) == 0);
+}
+
+
+/**@brief Function for printing a record.
+ *
+ * @param[in]   p_record   Record, starting with the header.
+ */
+static void record_print(const uint32_t * p_record)
+{
+    const uint32_t   header = p_record[0];
+    const uint32_t   argc   = (header & APP_TRACE_HDR_ARGC_MSK) >> APP_TRACE_HDR_ARGC_POS;
+    const uint8_t    seq    = (uint8_t)(header >> APP_TRACE_HDR_SEQ_POS);
+    const uint32_t * p_args = &p_record[1];
+    uint32_t         args[APP_TRACE_ARGS_MAX] = {0};
+
+    if (!m_is_first && (seq != m_next_seq))
+    {
+        printf("        -- %u records dropped\n", (uint8_t)(seq - m_next_seq));
+    }
+    m_next_seq = (uint8_t)(seq + 1);
+
+    printf("%3u ", seq);
+    if ((header & APP_TRACE_HDR_TIMESTAMP_MSK) != 0)
+    {
+        const uint32_t ticks = *p_args++ & RTC_COUNTER_MASK;
+
+        m_ticks      += m_is_first ? ticks : ((ticks - m_last_ticks) & RTC_COUNTER_MASK);
+        m_last_ticks  = ticks;
+        printf("%12.6f ", (double)m_ticks * (m_prescaler + 1) / RTC_FREQUENCY);
+    }
+    m_is_first = false;
+
+    memcpy(args, p_args, argc * sizeof(uint32_t));
+    // The format strings only hold unsigned conversions, unused arguments are ignored.
+    printf(m_formats[header & APP_TRACE_HDR_ID_MSK], args[0], args[1], args[2]);
+    printf("\n");
+}
+
+
+/**@brief Function for decoding a stream of records.
+ *
+ * @details Words which are not a valid header are skipped, so decoding recovers from a partly
+ *          captured record.
+ *
+ * @param[in]   p_words   Words of the stream.
+ * @param[in]   count     Number of words.
+ */
+static void stream_decode(const uint32_t * p_words, uint32_t count)
+{
+    uint32_t pos     = 0;
+    uint32_t skipped = 0;
+
+    while (pos < count)
+    {
+        if (!is_header_valid(p_words[pos]) || ((pos + record_words(p_words[pos])) > count))
+        {
+            pos++;
+            skipped++;
+            continue;
+        }
+        if (skipped != 0)
+        {
+            printf("        -- %u words skipped\n", skipped);
+            skipped = 0;
+        }
+
+        record_print(&p_words[pos]);
+        pos += record_words(p_words[pos]);
+    }
+
+    if (skipped != 0)
+    {
+        printf("        -- %u words skipped\n", skipped);
+    }
+}
+
+
+/**@brief Function for decoding a dump of the trace ring.
+ *
+ * @param[in]   p_ring      Words of the ring.
+ * @param[in]   size        Number of words, APP_TRACE_BUF_WORDS of the firmware.
+ * @param[in]   read_pos    Value of m_read_pos.
+ * @param[in]   write_pos   Value of m_write_pos.
+ *
+ * @return      true if the ring is consistent.
+ */
+static bool ring_decode(const uint32_t * p_ring, uint32_t size, uint32_t read_pos, uint32_t write_pos)
+{
+    if (((size & (size - 1)) != 0) || ((write_pos - read_pos) > size))
+    {
+        fprintf(stderr, "ring size or positions not valid\n");
+        return false;
+    }
+
+    while (read_pos != write_pos)
+    {
+        uint32_t record[RECORD_WORDS_MAX];
+        uint32_t header = p_ring[read_pos & (size - 1)];
+        uint32_t words  = record_words(header);
+        uint32_t i;
+
+        if (!is_header_valid(header) || (words > (write_pos - read_pos)))
+        {
+            fprintf(stderr, "no valid record at position %u\n", read_pos);
+            return false;
+        }
+
+        // A record may wrap around the end of the ring.
+        for (i = 0; i < words; i++)
+        {
+            record[i] = p_ring[(read_pos + i) & (size - 1)];
+        }
+        record_print(record);
+        read_pos += words;
+    }
+    return true;
+}
+
+
+static int usage(void)
+{
+    fprintf(stderr, "usage: trace_decode [-p prescaler] <file>\n"
+                    "       trace_decode [-p prescaler] -r <read_pos> <write_pos> <file>\n");
+    return 2;
+}
+
+
+int main(int argc, char ** argv)
+{
+    static uint8_t  data[FILE_WORDS_MAX * sizeof(uint32_t)];
+    static uint32_t words[FILE_WORDS_MAX];
+    bool            is_ring = false;
+    uint32_t        read_pos  = 0;
+    uint32_t        write_pos = 0;
+    uint32_t        count;
+    uint32_t        i;
+    size_t          length;
+    FILE *          p_file;
+    int             arg = 1;
+
+    if ((argc > (arg + 1)) && (strcmp(argv[arg], "-p") == 0))
+    {
+        m_prescaler = strtoul(argv[arg + 1], NULL, 0);
+        arg += 2;
+    }
+    if ((argc > (arg + 2)) && (strcmp(argv[arg], "-r") == 0))
+    {
+        is_ring   = true;
+        read_pos  = strtoul(argv[arg + 1], NULL, 0);
+        write_pos = strtoul(argv[arg + 2], NULL, 0);
+        arg += 3;
+    }
+    if (argc != (arg + 1))
+    {
+        return usage();
+    }
+
+    p_file = fopen(argv[arg], "rb");
+    if (p_file == NULL)
+    {
+        perror(argv[arg]);
+        return 1;
+    }
+    length = fread(data, 1, sizeof(data), p_file);
+    fclose(p_file);
+
+    count = (uint32_t)(length / sizeof(uint32_t));
+    for (i = 0; i < count; i++)
+    {
+        words[i] = word_decode(&data[i * sizeof(uint32_t)]);
+    }
+
+    if (is_ring)
+    {
+        return ring_decode(words, count, read_pos, write_pos) ? 0 : 1;
+    }
+    stream_decode(words, count);
+    return 0;
+}
@@ -70,6 +70,20 @@ uint32_t app_fifo_put(app_fifo_t * p_fifo, uint8_t byte);
  */
 uint32_t app_fifo_get(app_fifo_t * p_fifo, uint8_t * p_byte);
 
+/**@brief Function for adding a block of bytes to the FIFO.
+ *
+ * @details Either all bytes are added or, if they do not fit, none. The bytes become visible to
+ *          the reader at once.
+ *
+ * @param[in]  p_fifo   Pointer to the FIFO.
+ * @param[in]  p_data   Data bytes to add to the FIFO.
+ * @param[in]  length   Number of bytes to add.
+ *
+ * @retval     NRF_SUCCESS              If all bytes have been added to the FIFO.
+ * @retval     NRF_ERROR_NO_MEM         If the FIFO does not have room for all bytes.
+ */
+uint32_t app_fifo_write(app_fifo_t * p_fifo, const uint8_t * p_data, uint16_t length);
+
 /**@brief Function for flushing the FIFO.
  *
  * @param[in]  p_fifo   Pointer to the FIFO.
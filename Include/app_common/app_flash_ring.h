@@ -0,0 +1,246 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup app_flash_ring Flash Record Ring
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Ring of fixed size records in flash, oldest first.
+ *
+ * @details The records are appended to a set of flash pages registered with @ref pstorage. When
+ *          all pages are full, the oldest page is erased and its records are lost. Records are
+ *          addressed by their index, 0 being the oldest, and are read in place, without copying.
+ *
+ *          Each page starts with a header holding a page sequence number, which orders the pages
+ *          when the ring is mounted. Each record is preceded by a word holding a marker and the
+ *          CRC16 of its data, so a record torn by a reset is detected.
+ *
+ *          New records are staged in a RAM buffer, and all staged records which fit in the current
+ *          page are written by one flash operation. Staged records can be read like the records
+ *          in flash. To save energy, the writes can be coalesced: the staged records are then only
+ *          written when there are write_threshold of them, when they fill the current page, or
+ *          when @ref app_flash_ring_flush is called. Staged records are lost by a reset.
+ *
+ *          With erase-ahead, the next page is erased as soon as the current page is started, so
+ *          moving on to the next page only takes a header write. One page is then always kept
+ *          erased, at the cost of its capacity.
+ *
+ * @note The pstorage callback given in @ref app_flash_ring_init_t must pass its events to
+ *       @ref app_flash_ring_on_pstorage_evt. The pages are registered as one pstorage module, so
+ *       PSTORAGE_DATA_START_ADDR in pstorage_platform.h must leave room for them.
+ */
+
+#ifndef APP_FLASH_RING_H__
+#define APP_FLASH_RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pstorage.h"
+
+#define APP_FLASH_RING_PAGE_HEADER_SIZE     8       /**< Size of the header at the start of each page. */
+#define APP_FLASH_RING_RECORD_HEADER_SIZE   4       /**< Size of the header preceding each record. */
+#define APP_FLASH_RING_PAGE_INVALID         0xFFFF  /**< Page number meaning no page. */
+
+/**@brief Macro for getting the size in 32 bit words of a staging buffer.
+ *
+ * @param[in] DATA_SIZE   Size of the data of a record, a multiple of 4.
+ * @param[in] RECORDS     Number of records the buffer can hold.
+ */
+#define APP_FLASH_RING_BUF_WORDS(DATA_SIZE, RECORDS)                                               \
+    ((RECORDS) * (((DATA_SIZE) + APP_FLASH_RING_RECORD_HEADER_SIZE) / sizeof(uint32_t)))
+
+/**@brief Flash ring error handler type. */
+typedef void (*app_flash_ring_error_handler_t)(uint32_t nrf_error);
+
+/**@brief Function for comparing the data of a record to a search key.
+ *
+ * @param[in]   p_data   Data of a record.
+ * @param[in]   p_key    Search key.
+ *
+ * @return      Negative if the record sorts before the key, otherwise zero or positive.
+ */
+typedef int32_t (*app_flash_ring_cmp_t)(const uint8_t * p_data, const void * p_key);
+
+/**@brief Flash ring state. */
+typedef enum
+{
+    APP_FLASH_RING_STATE_IDLE,                      /**< No flash operation in progress. */
+    APP_FLASH_RING_STATE_ERASING,                   /**< Erasing the next page. */
+    APP_FLASH_RING_STATE_PAGE_HEADER,               /**< Writing the header of the next page. */
+    APP_FLASH_RING_STATE_STORING,                   /**< Writing staged records. */
+    APP_FLASH_RING_STATE_DELETING                   /**< Marking a record as deleted. */
+} app_flash_ring_state_t;
+
+/**@brief Flash ring init structure. */
+typedef struct
+{
+    pstorage_ntf_cb_t               pstorage_cb;    /**< pstorage callback for the pages. Must pass its events to @ref app_flash_ring_on_pstorage_evt. */
+    app_flash_ring_error_handler_t  error_handler;  /**< Function to be called in case of a flash error. */
+    uint16_t                        data_size;      /**< Size of the data of a record, a multiple of 4. */
+    uint16_t                        page_count;     /**< Number of flash pages, at least 2. */
+    uint32_t *                      p_buffer;       /**< Staging buffer, see @ref APP_FLASH_RING_BUF_WORDS. */
+    uint16_t                        buffer_records; /**< Number of records the staging buffer can hold. */
+    uint16_t                        write_threshold;/**< Number of staged records which triggers a write, 1 to write each record at once. */
+    bool                            erase_ahead;    /**< Erase the next page as soon as the current page is started. */
+} app_flash_ring_init_t;
+
+/**@brief Flash ring instance. Set up by @ref app_flash_ring_init. */
+typedef struct
+{
+    pstorage_handle_t               storage;        /**< Base identifier of the pages. */
+    app_flash_ring_error_handler_t  error_handler;  /**< Function to be called in case of a flash error. */
+    uint8_t *                       p_buffer;       /**< Staging buffer. */
+    uint16_t                        buffer_records; /**< Number of records the staging buffer can hold. */
+    uint16_t                        write_threshold;/**< Number of staged records which triggers a write. */
+    bool                            erase_ahead;    /**< Erase the next page as soon as the current page is started. */
+    bool                            flush_pending;  /**< Write the staged records regardless of the threshold. */
+    uint16_t                        erased_page;    /**< Page known to be erased, APP_FLASH_RING_PAGE_INVALID if none. */
+    uint32_t                        removed_count;  /**< Number of records removed from the front of the ring since init. */
+    uint32_t                        delete_pos;     /**< Position of the next record to be marked as deleted, see @ref app_flash_ring_removed_count_get. */
+    uint32_t                        delete_end;     /**< Position after the last record to be marked as deleted. */
+    uint16_t                        slot_size;      /**< Size of a record including its header. */
+    uint16_t                        page_size;      /**< Size of a flash page. */
+    uint16_t                        page_count;     /**< Number of pages. */
+    uint16_t                        page_records;   /**< Number of records in a page. */
+    uint16_t                        first_page;     /**< Page holding the oldest record. */
+    uint16_t                        first_slot;     /**< Slot of the oldest record in its page. */
+    uint16_t                        used_pages;     /**< Number of pages holding records, including the page being written. */
+    uint16_t                        write_slot;     /**< Number of slots written in the newest page. */
+    uint16_t                        staged;         /**< Number of records in the staging buffer. */
+    uint16_t                        in_flight;      /**< Number of staged records being written. */
+    uint32_t                        page_header[2]; /**< Header of the page being started, also the source of its write. */
+    app_flash_ring_state_t          state;          /**< Flash operation in progress. */
+} app_flash_ring_t;
+
+/**@brief Function for initializing a flash ring and mounting the records already in flash.
+ *
+ * @details Registers the pages with pstorage, so pstorage_init must have been called.
+ *
+ * @param[out]  p_ring    Flash ring instance.
+ * @param[in]   p_init    Parameters of the ring.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t app_flash_ring_init(app_flash_ring_t * p_ring, const app_flash_ring_init_t * p_init);
+
+/**@brief Function for getting the number of records in the ring.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ *
+ * @return      Number of records, including the staged records.
+ */
+uint32_t app_flash_ring_count_get(const app_flash_ring_t * p_ring);
+
+/**@brief Function for adding a record after the newest record.
+ *
+ * @details The record is copied to the staging buffer and written to flash in the background.
+ *          If the ring is full, the oldest page is erased to make room, which changes the
+ *          indexes of all remaining records, see @ref app_flash_ring_removed_count_get.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ * @param[in]   p_data    Data of the record, of the size given at init.
+ *
+ * @retval      NRF_SUCCESS       Record added.
+ * @retval      NRF_ERROR_NO_MEM  Staging buffer full, try again after the pending write.
+ */
+uint32_t app_flash_ring_add(app_flash_ring_t * p_ring, const uint8_t * p_data);
+
+/**@brief Function for getting the number of records removed from the front of the ring.
+ *
+ * @details Records are removed when the oldest page is erased to make room, or when the oldest
+ *          records have been deleted by @ref app_flash_ring_delete. Adding this count to an index gives a position which
+ *          does not change when records are removed, so a reader can keep its place.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ *
+ * @return      Number of records removed since @ref app_flash_ring_init.
+ */
+uint32_t app_flash_ring_removed_count_get(const app_flash_ring_t * p_ring);
+
+/**@brief Function for writing the staged records without waiting for the write threshold.
+ *
+ * @details The write completes in the background. Call it e.g. before a download, or before the
+ *          system is powered off.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ */
+void app_flash_ring_flush(app_flash_ring_t * p_ring);
+
+/**@brief Function for getting the data of a record, without copying it.
+ *
+ * @details The pointer is valid until the ring is modified, i.e. until the next call to
+ *          @ref app_flash_ring_add, @ref app_flash_ring_delete or
+ *          @ref app_flash_ring_on_pstorage_evt.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ * @param[in]   index     Index of the record, 0 being the oldest.
+ * @param[out]  pp_data   Data of the record.
+ *
+ * @retval      NRF_SUCCESS             Record found.
+ * @retval      NRF_ERROR_NOT_FOUND     No such record.
+ * @retval      NRF_ERROR_INVALID_DATA  The record is corrupt, e.g. torn by a reset, or deleted.
+ */
+uint32_t app_flash_ring_get(const app_flash_ring_t * p_ring,
+                            uint32_t                 index,
+                            const uint8_t **         pp_data);
+
+/**@brief Function for finding the first record not sorting before a key.
+ *
+ * @details Binary search, so the records must be sorted with respect to the compare function,
+ *          e.g. by a sequence number or a time stamp. Corrupt records are passed over.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ * @param[in]   cmp       Function comparing a record to the key.
+ * @param[in]   p_key     Search key.
+ *
+ * @return      Index of the first record which does not sort before the key, or the number of
+ *              records if there is none.
+ */
+uint32_t app_flash_ring_lower_bound(const app_flash_ring_t * p_ring,
+                                    app_flash_ring_cmp_t     cmp,
+                                    const void *             p_key);
+
+/**@brief Function for deleting a range of records.
+ *
+ * @details The records are marked as deleted in flash in the background, one at a time, and are
+ *          not mounted again. Until then, and afterwards, they are reported as corrupt by
+ *          @ref app_flash_ring_get, so they keep their index. Deleted records at the front of the
+ *          ring are removed, see @ref app_flash_ring_removed_count_get.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ * @param[in]   index     Index of the first record to delete, 0 being the oldest.
+ * @param[in]   count     Number of records to delete, limited to the records in the ring.
+ *
+ * @retval      NRF_SUCCESS          Deletion started.
+ * @retval      NRF_ERROR_NOT_FOUND  No record in the range.
+ * @retval      NRF_ERROR_BUSY       A deletion is still in progress, or a record of the range is
+ *                                   being written, try again later.
+ */
+uint32_t app_flash_ring_delete(app_flash_ring_t * p_ring, uint32_t index, uint32_t count);
+
+/**@brief Function for handling the pstorage events of the pages.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ * @param[in]   op_code   Operation the event is for.
+ * @param[in]   result    Result of the operation.
+ * @param[in]   p_data    Source of a store operation.
+ */
+void app_flash_ring_on_pstorage_evt(app_flash_ring_t * p_ring,
+                                    uint8_t            op_code,
+                                    uint32_t           result,
+                                    uint8_t *          p_data);
+
+#endif // APP_FLASH_RING_H__
+
+/** @} */
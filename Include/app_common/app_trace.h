@@ -0,0 +1,139 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup app_trace Binary Trace
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Deferred binary trace, cheap enough to stay enabled in production builds.
+ *
+ * @details A trace call stores a message ID and up to three raw 32 bit arguments in a RAM ring.
+ *          Nothing is formatted on the target. The format strings are listed next to the IDs with
+ *          @ref APP_TRACE_ID_ENUM, and the preprocessor removes them, so they take no flash. A host
+ *          decoder reads the same list to turn the records back into text.
+ *
+ *          The ring is drained by @ref app_trace_process, typically in the main loop just before
+ *          sd_app_evt_wait(), to a sink such as @ref app_uart_put_buf. Without a sink the ring
+ *          keeps the most recent records, for reading out with a debugger.
+ *
+ *          Each record is a sequence of little endian 32 bit words:
+ *          - Header: message ID in bits 0-15, argument count in bits 16-17, bit 18 set if a
+ *            timestamp follows, sequence number in bits 24-31. A gap in the sequence numbers
+ *            shows that records were dropped.
+ *          - Timestamp, the RTC1 counter, if @ref APP_TRACE_TIMESTAMP_ENABLED is set.
+ *          - The arguments.
+ *
+ * @note All trace calls must be made from the same interrupt level, e.g. from the main context and
+ *       handlers run by the scheduler, as the ring is not protected by a critical region. The only
+ *       exception is an error handler which does not return.
+ */
+
+#ifndef APP_TRACE_H__
+#define APP_TRACE_H__
+
+#include <stdint.h>
+
+#ifndef APP_TRACE_ENABLED
+#define APP_TRACE_ENABLED               1       /**< Set to 0 to compile out all trace calls. */
+#endif
+
+#ifndef APP_TRACE_BUF_WORDS
+#define APP_TRACE_BUF_WORDS             64      /**< Size of the trace ring in 32 bit words, must be a power of two. */
+#endif
+
+#ifndef APP_TRACE_TIMESTAMP_ENABLED
+#define APP_TRACE_TIMESTAMP_ENABLED     1       /**< Add the RTC1 counter to each record. Requires app_timer to be running. */
+#endif
+
+#define APP_TRACE_ARGS_MAX              3       /**< Maximum number of arguments of a trace record. */
+
+#define APP_TRACE_HDR_ID_MSK            0x0000FFFFuL    /**< Message ID field of a record header. */
+#define APP_TRACE_HDR_ARGC_POS          16              /**< Position of the argument count in a record header. */
+#define APP_TRACE_HDR_ARGC_MSK          0x00030000uL    /**< Argument count field of a record header. */
+#define APP_TRACE_HDR_TIMESTAMP_MSK     0x00040000uL    /**< Timestamp flag of a record header. */
+#define APP_TRACE_HDR_SEQ_POS           24              /**< Position of the sequence number in a record header. */
+
+/**@brief Macro for turning a message list into enumerators.
+ *
+ * @details A message list is a macro taking a macro parameter, and applying it to an ID and a
+ *          format string for each message, e.g.
+ * @code
+ * #define MY_TRACE_MSG_LIST(X)                                     \
+ *     X(TRACE_MSG_BOOT,  "boot, reset reason %08X")                \
+ *     X(TRACE_MSG_ERROR, "error %u at line %u")
+ *
+ * enum { MY_TRACE_MSG_LIST(APP_TRACE_ID_ENUM) };
+ * @endcode
+ */
+#define APP_TRACE_ID_ENUM(ID, FORMAT)   ID,
+
+/**@brief Trace sink, called with one record at a time.
+ *
+ * @details Must either accept the whole record, or return NRF_ERROR_NO_MEM to have it offered
+ *          again by a later call to @ref app_trace_process. @ref app_uart_put_buf fits.
+ *
+ * @param[in]   p_data   Record.
+ * @param[in]   length   Length of the record in bytes.
+ *
+ * @return      NRF_SUCCESS if the record was accepted, otherwise an error code.
+ */
+typedef uint32_t (*app_trace_sink_t)(const uint8_t * p_data, uint16_t length);
+
+#if APP_TRACE_ENABLED
+#define APP_TRACE0(ID)                  app_trace_write((ID), 0, 0, 0, 0)                           /**< Trace a message without arguments. */
+#define APP_TRACE1(ID, A0)              app_trace_write((ID), 1, (uint32_t)(A0), 0, 0)              /**< Trace a message with one argument. */
+#define APP_TRACE2(ID, A0, A1)          app_trace_write((ID), 2, (uint32_t)(A0), (uint32_t)(A1), 0) /**< Trace a message with two arguments. */
+#define APP_TRACE3(ID, A0, A1, A2)      app_trace_write((ID), 3, (uint32_t)(A0), (uint32_t)(A1), (uint32_t)(A2)) /**< Trace a message with three arguments. */
+#else
+#define APP_TRACE0(ID)
+#define APP_TRACE1(ID, A0)
+#define APP_TRACE2(ID, A0, A1)
+#define APP_TRACE3(ID, A0, A1, A2)
+#endif
+
+/**@brief Function for initializing the trace module.
+ *
+ * @param[in]   sink   Sink the ring is drained to, NULL to keep the records in RAM.
+ */
+void app_trace_init(app_trace_sink_t sink);
+
+/**@brief Function for adding a record to the trace ring. Use the APP_TRACEn macros instead.
+ *
+ * @details If the ring is full, the record is dropped when a sink is set, otherwise the oldest
+ *          records are discarded to make room.
+ *
+ * @param[in]   id      Message ID.
+ * @param[in]   argc    Number of arguments, at most @ref APP_TRACE_ARGS_MAX.
+ * @param[in]   arg0    First argument.
+ * @param[in]   arg1    Second argument.
+ * @param[in]   arg2    Third argument.
+ */
+void app_trace_write(uint16_t id, uint32_t argc, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+/**@brief Function for passing the records in the ring to the sink.
+ *
+ * @details Returns when the ring is empty or the sink is full. Call it when the application is
+ *          idle, before sd_app_evt_wait().
+ */
+void app_trace_process(void);
+
+/**@brief Function for getting the number of records dropped because the ring was full.
+ *
+ * @return      Number of dropped records since @ref app_trace_init.
+ */
+uint32_t app_trace_dropped_count_get(void);
+
+#endif // APP_TRACE_H__
+
+/** @} */
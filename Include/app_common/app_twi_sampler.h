@@ -0,0 +1,132 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/**@file
+ *
+ * @defgroup app_twi_sampler TWI Sensor Sampler
+ * @{
+ * @ingroup app_common
+ *
+ * @brief Periodic burst reads of TWI sensors, delivered in batches through the scheduler.
+ *
+ * @details Each sample period, one app_timer timeout starts a list of register burst reads from
+ *          one or more slaves, see @ref twi_master_xfer_list_start. The list runs from the TWI
+ *          interrupt, and the data goes straight into the batch buffer, after the timestamp of
+ *          the sample. The timestamp is the RTC1 counter at the start of the period, see
+ *          app_timer_cnt_get.
+ *
+ *          When batch_size samples are collected, the batch is passed to the handler through
+ *          the scheduler, and the following samples go to the other half of the buffer. The
+ *          batch stays valid until the next one is passed.
+ *
+ *          A sample is dropped when its reads fail, or when they are still running at the start
+ *          of the next period, e.g. because a slave holds the clock line. Dropped samples are
+ *          counted in @ref app_twi_sampler_batch_t.
+ *
+ * @note Uses the hardware TWI master (twi_hw_master.c) and one app_timer timer. The scheduler
+ *       must hold events of sizeof(app_twi_sampler_batch_t).
+ */
+
+#ifndef APP_TWI_SAMPLER_H__
+#define APP_TWI_SAMPLER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef APP_TWI_SAMPLER_MAX_READS
+#define APP_TWI_SAMPLER_MAX_READS       4       /**< Maximum number of burst reads in a sample. */
+#endif
+
+#define APP_TWI_SAMPLER_TIMESTAMP_SIZE  4       /**< Size of the timestamp at the start of each sample. */
+
+/**@brief Macro for getting the size of a sample.
+ *
+ * @param[in] DATA_SIZE   Sum of the lengths of the burst reads.
+ */
+#define APP_TWI_SAMPLER_SAMPLE_SIZE(DATA_SIZE)                                                     \
+    (APP_TWI_SAMPLER_TIMESTAMP_SIZE + (((DATA_SIZE) + 3) & ~3))
+
+/**@brief Macro for getting the size in 32 bit words of a sample buffer.
+ *
+ * @param[in] DATA_SIZE   Sum of the lengths of the burst reads.
+ * @param[in] BATCH_SIZE  Number of samples in a batch.
+ */
+#define APP_TWI_SAMPLER_BUF_WORDS(DATA_SIZE, BATCH_SIZE)                                           \
+    (2 * (BATCH_SIZE) * (APP_TWI_SAMPLER_SAMPLE_SIZE(DATA_SIZE) / sizeof(uint32_t)))
+
+/**@brief Burst read of consecutive registers of a slave. */
+typedef struct
+{
+    uint8_t                     device_address;     /**< Slave TWI address in bits [6:0]. */
+    uint8_t                     register_address;   /**< First register to read. */
+    uint8_t                     length;             /**< Number of bytes to read, at least 1. */
+} app_twi_sampler_read_t;
+
+/**@brief Batch of samples.
+ *
+ * @details Each sample holds the timestamp, followed by the data of the burst reads in the order
+ *          they were given at init, padded to a multiple of 4 bytes.
+ */
+typedef struct
+{
+    const uint8_t *             p_samples;          /**< First sample of the batch. */
+    uint16_t                    count;              /**< Number of samples. */
+    uint16_t                    sample_size;        /**< Size of a sample, see @ref APP_TWI_SAMPLER_SAMPLE_SIZE. */
+    uint32_t                    dropped_count;      /**< Number of samples dropped since init. */
+} app_twi_sampler_batch_t;
+
+/**@brief Batch handler type. Called from the scheduler. */
+typedef void (*app_twi_sampler_handler_t)(const app_twi_sampler_batch_t * p_batch);
+
+/**@brief Sampler init structure. */
+typedef struct
+{
+    const app_twi_sampler_read_t *  p_reads;        /**< Burst reads of a sample, copied at init. */
+    uint8_t                         read_count;     /**< Number of burst reads, at most APP_TWI_SAMPLER_MAX_READS. */
+    uint32_t                        period_ticks;   /**< Sample period in app_timer ticks, see APP_TIMER_TICKS. */
+    uint32_t *                      p_buffer;       /**< Sample buffer, see @ref APP_TWI_SAMPLER_BUF_WORDS. */
+    uint16_t                        batch_size;     /**< Number of samples in a batch. */
+    app_twi_sampler_handler_t       handler;        /**< Function to be called with each batch. */
+} app_twi_sampler_init_t;
+
+/**@brief Function for initializing the sampler.
+ *
+ * @details The TWI master must have been initialized with twi_master_init, and the app_timer
+ *          module with APP_TIMER_INIT.
+ *
+ * @param[in]   p_init    Parameters of the sampler.
+ *
+ * @retval      NRF_SUCCESS             Sampler initialized.
+ * @retval      NRF_ERROR_NULL          Missing buffer, reads or handler.
+ * @retval      NRF_ERROR_INVALID_PARAM Invalid number of reads, read length or batch size.
+ * @return      Otherwise the error code of app_timer_create.
+ */
+uint32_t app_twi_sampler_init(const app_twi_sampler_init_t * p_init);
+
+/**@brief Function for starting periodic sampling.
+ *
+ * @return      NRF_SUCCESS on success, otherwise the error code of app_timer_start.
+ */
+uint32_t app_twi_sampler_start(void);
+
+/**@brief Function for stopping periodic sampling.
+ *
+ * @details Reads in progress are aborted, and the samples collected so far are passed to the
+ *          handler as a shorter batch.
+ *
+ * @return      NRF_SUCCESS on success, otherwise the error code of app_timer_stop.
+ */
+uint32_t app_twi_sampler_stop(void);
+
+#endif // APP_TWI_SAMPLER_H__
+
+/** @} */
@@ -233,6 +233,20 @@ uint32_t app_uart_get(uint8_t * p_byte);
  */
 uint32_t app_uart_put(uint8_t byte);
 
+/**@brief Function for putting a block of bytes on the UART.
+ *
+ * @details This call is non-blocking. Either all bytes are put on the TX buffer or, if they do
+ *          not fit, none, so a message is never transmitted partially. Without a FIFO only a
+ *          single byte fits.
+ *
+ * @param[in] p_data   Bytes to be transmitted on the UART.
+ * @param[in] length   Number of bytes.
+ *
+ * @retval NRF_SUCCESS        If all bytes were put on the TX buffer for transmission.
+ * @retval NRF_ERROR_NO_MEM   If the TX buffer does not have room for all bytes.
+ */
+uint32_t app_uart_put_buf(const uint8_t * p_data, uint16_t length);
+
 /**@brief Function for getting the current state of the UART.
  *
  * @details If flow control is disabled, the state is assumed to always be APP_UART_CONNECTED.
@@ -19,10 +19,14 @@
  * @brief Memory pool implementation
  *
  * Memory pool implementation, based on circular buffer data structure, which supports asynchronous 
- * processing of RX data. The current default implementation supports 1 TX buffer and 4 RX buffers.
- * The memory managed by the pool is allocated from static storage instead of heap. The internal 
- * design of the circular buffer implementing the RX memory layout is illustrated in the picture 
- * below. 
+ * processing of RX data. The current default implementation supports 2 TX buffers of TX_BUF_SIZE 
+ * bytes, 2 TX buffers of TX_SMALL_BUF_SIZE bytes and 4 RX buffers. The memory managed by the pool 
+ * is allocated from static storage instead of heap. The internal design of the circular buffer 
+ * implementing the RX memory layout is illustrated in the picture below. 
+ *
+ * TX buffers are organized in size classes. Each class keeps a bitmap of its free buffers, so 
+ * allocation and freeing by pointer take constant time. Several TX buffers can be allocated at 
+ * the same time, which lets the HCI transport keep more than one packet in flight.
  *
  * @image html memory_pool.png "Circular buffer design"
  *
@@ -38,6 +42,9 @@
  *
  * The following compile time configuration options are available to suit various implementations:
  * - TX_BUF_SIZE TX buffer size in bytes. 
+ * - TX_BUF_QUEUE_SIZE Number of TX buffers of TX_BUF_SIZE bytes. 
+ * - TX_SMALL_BUF_SIZE Small TX buffer size in bytes. 
+ * - TX_SMALL_BUF_QUEUE_SIZE Number of TX buffers of TX_SMALL_BUF_SIZE bytes. 
  * - RX_BUF_SIZE RX buffer size in bytes. 
  * - RX_BUF_QUEUE_SIZE RX buffer element size.
  */
@@ -48,6 +55,17 @@
 #include <stdint.h>
 #include "nrf_error.h"
 
+/**@brief Memory pool usage statistics. */
+typedef struct
+{
+    uint32_t tx_alloc_count;                /**< Number of successful TX buffer allocations. */
+    uint32_t tx_alloc_fail_count;           /**< Number of TX buffer allocations failed because no suitable buffer was free. */
+    uint32_t rx_produce_fail_count;         /**< Number of RX buffer produce requests failed because no buffer was free. */
+    uint8_t  tx_in_use;                     /**< Number of TX buffers currently allocated. */
+    uint8_t  tx_in_use_max;                 /**< Highest number of TX buffers allocated at the same time. */
+    uint8_t  rx_in_use_max;                 /**< Highest number of RX buffers in use at the same time. */
+} hci_mem_pool_stats_t;
+
 /**@brief Function for opening the module.
  *
  * @retval NRF_SUCCESS          Operation success. 
@@ -60,7 +78,7 @@ uint32_t hci_mem_pool_open(void);
  */
 uint32_t hci_mem_pool_close(void);
 
-/**@brief Function for allocating requested amount of TX memory.
+/**@brief Function for allocating a TX buffer of TX_BUF_SIZE bytes.
  *
  * @param[out] pp_buffer        Pointer to the allocated memory.
  *
@@ -69,16 +87,41 @@ uint32_t hci_mem_pool_close(void);
  * @retval NRF_ERROR_NULL       Operation failure. NULL pointer supplied.  
  */
 uint32_t hci_mem_pool_tx_alloc(void ** pp_buffer);
+
+/**@brief Function for allocating a TX buffer of at least the requested size.
+ *
+ * @details The buffer is taken from the smallest size class which fits the request and has a free
+ *          buffer.
+ *
+ * @param[in]  length           Amount, in bytes, of TX memory needed.
+ * @param[out] pp_buffer        Pointer to the allocated memory.
+ *
+ * @retval NRF_SUCCESS          Operation success. Memory was allocated.
+ * @retval NRF_ERROR_NO_MEM     Operation failure. No memory available for allocation.
+ * @retval NRF_ERROR_DATA_SIZE  Operation failure. Request size exceeds limit.
+ * @retval NRF_ERROR_NULL       Operation failure. NULL pointer supplied.  
+ */
+uint32_t hci_mem_pool_tx_alloc_sized(uint32_t length, void ** pp_buffer);
  
 /**@brief Function for freeing previously allocated TX memory.
  *
  * @note Memory management follows the FIFO principle meaning that free() order must match the 
  *       alloc(...) order, which is the reason for omitting exact memory block identifier as an 
- *       input parameter.
+ *       input parameter. The buffer allocated first of the ones still allocated is freed. Use 
+ *       @ref hci_mem_pool_tx_buffer_free for buffers freed in a different order.
  *
  * @retval NRF_SUCCESS          Operation success. Memory was freed.
  */
 uint32_t hci_mem_pool_tx_free(void);
+
+/**@brief Function for freeing a specific TX buffer.
+ *
+ * @param[in] p_buffer             Pointer to the buffer, as returned upon allocation.
+ *
+ * @retval NRF_SUCCESS             Operation success. Memory was freed.
+ * @retval NRF_ERROR_INVALID_ADDR  Operation failure. Not an allocated TX buffer. 
+ */
+uint32_t hci_mem_pool_tx_buffer_free(void * p_buffer);
  
 /**@brief Function for producing a free RX memory block for usage.
  *
@@ -126,6 +169,14 @@ uint32_t hci_mem_pool_rx_extract(uint8_t ** pp_buffer, uint32_t * p_length);
  * @retval NRF_ERROR_INVALID_ADDR  Operation failure. Not a valid pointer. 
  */
 uint32_t hci_mem_pool_rx_consume(uint8_t * p_buffer);
+
+/**@brief Function for reading the memory pool usage statistics.
+ *
+ * @note The statistics are reset by @ref hci_mem_pool_open.
+ *
+ * @param[out] p_stats             Current statistics.
+ */
+void hci_mem_pool_stats_get(hci_mem_pool_stats_t * p_stats);
  
 #endif // HCI_MEM_POOL_H__
  
@@ -22,10 +22,19 @@
 #ifndef MEM_POOL_INTERNAL_H__
 #define MEM_POOL_INTERNAL_H__
 
-#define TX_BUF_SIZE       600u         /**< TX buffer size in bytes. */
-#define RX_BUF_SIZE       TX_BUF_SIZE  /**< RX buffer size in bytes. */
+#define TX_BUF_SIZE             600u         /**< TX buffer size in bytes. */
+#define TX_BUF_QUEUE_SIZE       2u           /**< Number of TX buffers of TX_BUF_SIZE bytes. */
+#define TX_SMALL_BUF_SIZE       64u          /**< Small TX buffer size in bytes, used for command responses and short events. */
+#define TX_SMALL_BUF_QUEUE_SIZE 2u           /**< Number of TX buffers of TX_SMALL_BUF_SIZE bytes. */
+#define RX_BUF_SIZE             TX_BUF_SIZE  /**< RX buffer size in bytes. */
 
-#define RX_BUF_QUEUE_SIZE 4u           /**< RX buffer element size. */
+#define RX_BUF_QUEUE_SIZE       4u           /**< RX buffer element size. */
+
+// @note: the total number of TX buffers should not exceed the TX window size of the HCI transport,
+// so that a packet written to an allocated buffer always fits in the window.
+#if (TX_BUF_QUEUE_SIZE > 8u) || (TX_SMALL_BUF_QUEUE_SIZE > 8u)
+#error "At most 8 TX buffers per size class are supported."
+#endif
 
 #endif // MEM_POOL_INTERNAL_H__
  
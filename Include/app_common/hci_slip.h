@@ -26,6 +26,9 @@
  *
  *          The SLIP layer uses events to notify the upper layer when data transmission is complete
  *          and when a SLIP packet is received.
+ *          Encoding and decoding work on blocks: runs of bytes needing no escaping are located
+ *          a word at a time and copied as a whole. The same codec is available for complete
+ *          frames in memory through \ref hci_slip_frame_encode and \ref hci_slip_frame_decode.
  */
 
 #ifndef HCI_SLIP_H__
@@ -33,6 +36,10 @@
 
 #include <stdint.h>
 
+/**@brief Largest possible SLIP frame for a packet of the given length: every byte escaped, plus
+ *        the opening and closing SLIP end bytes. */
+#define HCI_SLIP_FRAME_SIZE_MAX(PACKET_LENGTH)  (2u * (PACKET_LENGTH) + 2u)
+
 /**@brief Event types from the SLIP Layer. */
 typedef enum
 {
@@ -123,6 +130,34 @@ uint32_t hci_slip_write(const uint8_t * p_buffer, uint32_t length);
  * @retval NRF_SUCCESS              Operation success. 
  */
 uint32_t hci_slip_rx_buffer_register(uint8_t * p_buffer, uint32_t length);
+
+/**@brief Function for SLIP encoding a complete packet into a buffer, including the opening and
+ *        closing SLIP end bytes. The UART is not used.
+ *
+ * @param[in]     p_src             Packet to encode.
+ * @param[in]     src_length        Packet length, in bytes.
+ * @param[out]    p_dst             Buffer for the encoded frame.
+ * @param[in,out] p_dst_length      In: size of p_dst, see \ref HCI_SLIP_FRAME_SIZE_MAX. 
+ *                                  Out: length of the encoded frame.
+ * @retval NRF_SUCCESS              Operation success.
+ * @retval NRF_ERROR_NO_MEM         Operation failure. Encoded frame does not fit in p_dst.
+ * @retval NRF_ERROR_INVALID_ADDR   If a NULL pointer is provided.
+ */
+uint32_t hci_slip_frame_encode(const uint8_t * p_src,
+                               uint32_t        src_length,
+                               uint8_t *       p_dst,
+                               uint32_t *      p_dst_length);
+
+/**@brief Function for decoding a complete SLIP frame in place. Leading SLIP end bytes are
+ *        skipped and decoding stops at the first SLIP end byte following the packet data.
+ *
+ * @param[in,out] p_buffer          In: SLIP encoded frame. Out: decoded packet.
+ * @param[in,out] p_length          In: frame length, in bytes. Out: packet length, in bytes.
+ * @retval NRF_SUCCESS              Operation success.
+ * @retval NRF_ERROR_INVALID_DATA   Operation failure. Frame contains an invalid escape sequence.
+ * @retval NRF_ERROR_INVALID_ADDR   If a NULL pointer is provided.
+ */
+uint32_t hci_slip_frame_decode(uint8_t * p_buffer, uint32_t * p_length);
  
 #endif // HCI_SLIP_H__
  
@@ -26,13 +26,15 @@
  * - Transmission and reception of reliable packets: defined by chapter 6 of the specification.
  *
  * \par Features not supported
- * - Link establishment procedure: defined by chapter 8 of the specification.
+ * - Link establishment procedure: defined by chapter 8 of the specification, apart from the SYNC
+ * and SYNC RESPONSE messages used to resynchronize sequence numbers (see TX window below).
  * - Low power: defined by chapter 9 of the specification. 
  *
  * \par Implementation specific behaviour
  * - As Link establishment procedure is not supported following static link configuration parameters
  * are used:
- * + TX window size is 1.
+ * + TX window size is HCI_TRANSPORT_TX_WINDOW_SIZE, at most 7 as limited by the 3 bit sequence 
+ * number.
  * + 16 bit CCITT-CRC must be used.
  * + Out of frame software flow control not supported.
  * + Parameters specific for resending reliable packets are compile time configurable (clarifed 
@@ -40,24 +42,35 @@
  * + Acknowledgement packet transmissions are not timeout driven , meaning they are delivered for 
  * transmission within same context which the corresponding application packet was received. 
  *
- * \par Implementation specific limitations
- * Current implementation has the following limitations which will have impact to system wide 
- * behaviour:
- * - Delayed acknowledgement scheduling not implemented: 
- * There exists a possibility that acknowledgement TX packet and application TX packet will collide 
- * in the TX pipeline having the end result that acknowledgement packet will be excluded from the TX 
- * pipeline which will trigger the retransmission algorithm within the peer protocol entity.
- * - Delayed retransmission scheduling not implemented:  
- * There exists a possibility that retransmitted application TX packet and acknowledgement TX packet
- * will collide in the TX pipeline having the end result that retransmitted application TX packet 
- * will be excluded from the TX pipeline.
- * - Processing of the acknowledgement number from RX application packets:
- * Acknowledgement number is not processed from the RX application packets having the end result 
- * that unnecessary application packet retransmissions can occur.
- *
- * The application TX packet processing flow is illustrated by the statemachine below. 
- *
- * @image html hci_transport_tx_sm.png "TX - application packet statemachine"
+ * \par TX window
+ * Up to HCI_TRANSPORT_TX_WINDOW_SIZE application packets can be written without waiting for the 
+ * peer acknowledgement. Packets are handed to the slip layer in sequence number order as soon as it
+ * is free, an acknowledgement packet waiting for the slip layer always going first. 
+ * - Acknowledgements are cumulative: the acknowledgement number of a received acknowledgement 
+ * packet acknowledges every outstanding packet up to it. A TX done event is sent for each 
+ * acknowledged packet, in write order. The acknowledgement number of RX application packets is 
+ * not processed, as a retransmitted packet carries the number valid at its first transmission.
+ * - On retransmission timeout the outstanding packets are retransmitted starting from the oldest
+ * (go-back-N). Packets acknowledged while the retransmission is in progress are skipped. The 
+ * receiver only accepts the packet with the expected sequence number and the acknowledgement is 
+ * cumulative, so retransmitting single packets would not make the peer keep packets received after
+ * a lost one.
+ * - When MAX_RETRY_COUNT retransmission rounds pass without the window advancing, the sequence 
+ * numbers are resynchronized, as the peer may have received packets whose acknowledgement was 
+ * lost: a SYNC is sent on every retransmission timeout until the peer answers with SYNC RESPONSE,
+ * after which both ends restart from the initial sequence number. A received SYNC resets the 
+ * expected sequence number and is answered with SYNC RESPONSE, whose Acknowledge Number is the 
+ * sequence number expected before the SYNC. The Sequence Number of both packets numbers the 
+ * resynchronization, so a SYNC of a new resynchronization is told apart from a repeated one. The 
+ * packets the peer received are completed, the 
+ * others are renumbered and retransmitted, so no packet is lost or duplicated. Packets written in 
+ * the meantime are held until the resynchronization has completed, so both ends must run this 
+ * implementation.
+ * - When MAX_RETRY_COUNT SYNCs are not answered either, every packet in the window is completed 
+ * with HCI_TRANSPORT_TX_DONE_FAILURE. The peer may then have received some of them.
+ *
+ * As the TX buffers are owned by the caller, a buffer must not be freed or reused before its TX 
+ * done event has been received.
  *
  * \par Component specific configuration options
  *
@@ -70,6 +83,10 @@
  * The following compile time configuration option is available to configure module specific 
  * behaviour:
  * - MAX_RETRY_COUNT Max retransmission retry count for applicaton packets.
+ * - HCI_TRANSPORT_TX_WINDOW_SIZE Max number of application packets waiting for acknowledgement.
+ *
+ * \par Statistics
+ * Packet counters are kept for measuring the transport performance, see @ref hci_transport_stats_get.
  */
  
 #ifndef HCI_TRANSPORT_H__
@@ -78,6 +95,26 @@
 #include <stdint.h>
 #include "nrf_error.h"
 
+#ifndef HCI_TRANSPORT_TX_WINDOW_SIZE
+#define HCI_TRANSPORT_TX_WINDOW_SIZE    4u  /**< Max number of application packets waiting for peer acknowledgement. */
+#endif
+
+#if (HCI_TRANSPORT_TX_WINDOW_SIZE < 1u) || (HCI_TRANSPORT_TX_WINDOW_SIZE > 7u)
+#error "HCI_TRANSPORT_TX_WINDOW_SIZE must be in the range 1 to 7."
+#endif
+
+/**@brief Transport statistics. */
+typedef struct
+{
+    uint32_t tx_pkt_count;              /**< Application packets written. */
+    uint32_t tx_retransmit_count;       /**< Application packets retransmitted. */
+    uint32_t tx_timeout_count;          /**< Retransmission timeouts. */
+    uint32_t tx_fail_count;             /**< Application packets completed with HCI_TRANSPORT_TX_DONE_FAILURE. */
+    uint32_t tx_resync_count;           /**< TX sequence number resynchronizations started. */
+    uint32_t rx_pkt_count;              /**< Application packets received and acknowledged. */
+    uint32_t rx_discard_count;          /**< Application packets discarded, due to errors or an unexpected sequence number. */
+} hci_transport_stats_t;
+
 /**@brief Generic event callback function events. */
 typedef enum
 {
@@ -161,6 +198,21 @@ uint32_t hci_transport_close(void);
  */
 uint32_t hci_transport_tx_alloc(uint8_t ** pp_memory);
 
+/**@brief Function for allocating tx packet memory for a packet of known maximum length.
+ *
+ * @details Short packets, like command responses, are given a small buffer so that the large 
+ *          buffers stay available for long packets.
+ * 
+ * @param[in]  length               Max length of the packet data in bytes.
+ * @param[out] pp_memory            Pointer to the packet data.
+ * 
+ * @retval NRF_SUCCESS              Operation success. Memory was allocated.
+ * @retval NRF_ERROR_NO_MEM         Operation failure. No memory available.
+ * @retval NRF_ERROR_DATA_SIZE      Operation failure. Packet size exceeds limit.   
+ * @retval NRF_ERROR_NULL           Operation failure. NULL pointer supplied.   
+ */
+uint32_t hci_transport_tx_alloc_sized(uint32_t length, uint8_t ** pp_memory);
+
 /**@brief Function for freeing tx packet memory.
  *
  * @note Memory management works in FIFO principle meaning that free order must match the alloc 
@@ -170,6 +222,15 @@ uint32_t hci_transport_tx_alloc(uint8_t ** pp_memory);
  */
 uint32_t hci_transport_tx_free(void);
 
+/**@brief Function for freeing specific tx packet memory, regardless of the alloc order.
+ *
+ * @param[in] p_memory              Pointer to the packet data, as returned upon allocation.
+ * 
+ * @retval NRF_SUCCESS              Operation success. Memory was freed.   
+ * @retval NRF_ERROR_INVALID_ADDR   Operation failure. Not allocated tx packet memory.   
+ */
+uint32_t hci_transport_tx_buffer_free(uint8_t * p_memory);
+
 /**@brief Function for writing a packet.
  *
  * @note Completion of this method does not guarantee that actual peripheral transmission would 
@@ -180,9 +241,9 @@ uint32_t hci_transport_tx_free(void);
  *
  * @retval NRF_SUCCESS              Operation success. Packet was added to the transmission queue 
  *                                  and an event will be send upon transmission completion. 
- * @retval NRF_ERROR_NO_MEM         Operation failure. Transmission queue is full and packet was not
- *                                  added to the transmission queue. User should wait for 
- *                                  a appropriate event prior issuing this operation again.
+ * @retval NRF_ERROR_NO_MEM         Operation failure. TX window is full and packet was not added
+ *                                  to the transmission queue. User should wait for a TX done 
+ *                                  event prior issuing this operation again.
  * @retval NRF_ERROR_DATA_SIZE      Operation failure. Packet size exceeds limit.   
  * @retval NRF_ERROR_NULL           Operation failure. NULL pointer supplied.  
  * @retval NRF_ERROR_INVALID_STATE  Operation failure. Channel is not open.
@@ -190,6 +251,9 @@ uint32_t hci_transport_tx_free(void);
 uint32_t hci_transport_pkt_write(const uint8_t * p_buffer, uint32_t length);
 
 /**@brief Function for extracting received packet.
+ *
+ * @details Packets are extracted in the order received, one for each HCI_TRANSPORT_RX_RDY event.
+ *          Extraction may be deferred: packets received meanwhile wait in the RX buffer queue.
  *
  * @note Extracted memory can't be reused by the underlying transport layer untill freed by call to 
  *       hci_transport_rx_pkt_consume().
@@ -215,6 +279,16 @@ uint32_t hci_transport_rx_pkt_extract(uint8_t ** pp_buffer, uint32_t * p_length)
  */
 uint32_t hci_transport_rx_pkt_consume(uint8_t * p_buffer);
 
+/**@brief Function for reading the transport statistics.
+ *
+ * @param[out] p_stats              Current statistics.
+ */
+void hci_transport_stats_get(hci_transport_stats_t * p_stats);
+
+/**@brief Function for clearing the transport statistics.
+ */
+void hci_transport_stats_reset(void);
+
 #endif // HCI_TRANSPORT_H__
 
 /** @} */
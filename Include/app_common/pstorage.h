@@ -247,6 +247,26 @@ uint32_t pstorage_load(uint8_t *           p_dest,
  */
 uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size);
 
+/**@brief Routine to clear some of the pages of a module in persistent memory.
+ *
+ * @details Unlike @ref pstorage_clear, which erases all pages of the module, only the pages from
+ *          the one holding p_dest are erased. This allows a module to reuse its pages one at a
+ *          time, e.g. as a ring.
+ *
+ * @param[in]  p_dest     Block identifier in the first page to be cleared.
+ * @param[in]  page_count Number of pages to be cleared.
+ *
+ * @retval     NRF_SUCCESS on success, otherwise an appropriate error code.
+ * @retval     NRF_ERROR_INVALID_STATE is returned is API is called without module initialization.
+ * @retval     NRF_ERROR_NULL if NULL parameter has been passed.
+ * @retval     NRF_ERROR_INVALID_PARAM if the pages are not all within the module.
+ * @retval     NRF_ERROR_NO_MEM in case request cannot be processed.
+ *
+ * @note       The application is notified of the completion with a PSTORAGE_CLEAR_OP_CODE
+ *             notification, as for @ref pstorage_clear.
+ */
+uint32_t pstorage_page_clear(pstorage_handle_t * p_dest, pstorage_size_t page_count);
+
 #ifdef PSTORAGE_RAW_MODE_ENABLE
 
 /**@brief      Function for registering with persistent storage interface.
@@ -62,6 +62,13 @@
  *          should use the Bond Manager API @ref ble_bondmngr_bonded_centrals_store to write the
  *          latest Bonding Information and System Attributes to flash.
  *
+ *          The flash pages are append-only logs. Each record has a header with a signature, a
+ *          format version and a CRC16 of the record. A changed central gets a new record, which
+ *          supersedes its earlier ones. A page is erased only when it is full, and then only the
+ *          latest record of each central is written back. Records from older firmware, whose CRC
+ *          is chained over all records before them, are still read, and are replaced as their
+ *          centrals change.
+ *
  *          The bond manager provides the API @ref ble_bondmngr_sys_attr_store to allow the
  *          application to write the System Attributes to flash while in a connection. Your
  *          application should call this API when it considers that all CCCDs and other persistent
@@ -135,7 +142,7 @@ typedef enum
     BLE_BONDMNGR_EVT_CONN_TO_BONDED_CENTRAL,                    /**< Connected to a previously bonded central. */
     BLE_BONDMNGR_EVT_ENCRYPTED,                                 /**< Current link is encrypted. */
     BLE_BONDMNGR_EVT_AUTH_STATUS_UPDATED,                       /**< Authentication status updated for current central. */
-    BLE_BONDMNGR_EVT_BOND_FLASH_FULL                            /**< Flash block for storing Bonding Information is full. */
+    BLE_BONDMNGR_EVT_BOND_FLASH_FULL                            /**< Flash block for storing Bonding Information is full. The Bonding Information is written by the next call to @ref ble_bondmngr_bonded_centrals_store, which compacts the flash block. */
 } ble_bondmngr_evt_type_t;
 
 /** @} */
@@ -206,8 +213,9 @@ void ble_bondmngr_on_ble_evt(ble_evt_t * p_ble_evt);
 /**@brief Function for storing the bonded centrals data including bonding info and System Attributes into
  *          flash memory.
  *
- * @details If the data to be written is different from the existing data, this function erases the
- *          flash pages before writing to flash.
+ * @details Only the centrals whose data differs from the latest data in flash are written, each as
+ *          a new record appended to the flash page. A flash page is erased only when it is full,
+ *          after which the latest data of all centrals is written back to it.
  *
  * @warning This function could prevent the radio from running. Therefore it MUST be called ONLY
  *          when the application knows that the <i>Bluetooth</i> radio is not active. An example of
@@ -228,17 +236,31 @@ uint32_t ble_bondmngr_bonded_centrals_store(void);
  */
 uint32_t ble_bondmngr_bonded_centrals_delete(void);
 
-/**@brief Function for getting the whitelist containing all currently bonded centrals.
+/**@brief Function for getting the whitelist containing the currently bonded centrals.
  *
  * @details     This function populates the whitelist with either the IRKs or the public adresses
- *              of all bonded centrals.
+ *              of the bonded centrals. If there are more bonded centrals than the stack accepts in
+ *              a whitelist (BLE_GAP_WHITELIST_ADDR_MAX_COUNT), only the current window of them is
+ *              included, see @ref ble_bondmngr_whitelist_rotate.
  *
- * @param[out]  p_whitelist  Whitelist structure with all bonded centrals.
+ * @param[out]  p_whitelist  Whitelist structure with the bonded centrals.
  *
  * @return      NRF_SUCCESS on success, an error_code otherwise.
  */
 uint32_t ble_bondmngr_whitelist_get(ble_gap_whitelist_t * p_whitelist);
 
+/**@brief Function for moving the whitelist window to the next bonded centrals.
+ *
+ * @details     Call it when advertising with the whitelist times out without a connection, before
+ *              calling @ref ble_bondmngr_whitelist_get for the next advertising round. Successive
+ *              rounds then cover all bonded centrals.
+ *
+ * @return      NRF_SUCCESS on success.
+ *              NRF_ERROR_INVALID_STATE if the bond manager was not initialized, or if all bonded
+ *              centrals fit in one whitelist.
+ */
+uint32_t ble_bondmngr_whitelist_rotate(void);
+
 /**@brief Function for getting the central's address corresponding to a given central_handle.
  *
  * @note        This function returns NRF_ERROR_INVALID_PARAM if the given central has a private
@@ -0,0 +1,126 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup ble_sdk_lib_conn_policy Connection Parameters Policy
+ * @{
+ * @ingroup ble_sdk_lib
+ * @brief Module for switching connection parameters between an idle and a bulk transfer profile.
+ *
+ * @details Modules that move larger amounts of data (DFU, batched configuration, log download)
+ *          register the start and end of their transfer. While at least one transfer is active the
+ *          module requests the bulk profile (short interval, no slave latency). When the last
+ *          transfer ends, and no new one is started within the relax delay, the idle profile
+ *          (long interval, slave latency) is requested again.
+ *
+ *          The bulk requests are sent with sd_ble_gap_conn_param_update, outside the negotiation
+ *          of the Connection Parameters module: a central that refuses the bulk profile only makes
+ *          the transfer slower, it does not fail the negotiation or end the link. While the bulk
+ *          profile is requested the negotiation of that module is stopped, so it does not ask for
+ *          its preferred parameters in the middle of a transfer. The idle profile is requested
+ *          with ble_conn_params_change_conn_params, which hands the negotiation back to that
+ *          module with the idle profile as its preferred parameters. The Connection Parameters
+ *          module must be initialized first, and its BLE event handler must be called before
+ *          @ref ble_conn_policy_on_ble_evt.
+ *
+ *          A transfer that never ends, e.g. because the peer gave up half way, keeps the bulk
+ *          profile for at most bulk_timeout. Transfers also end with the connection.
+ *
+ *          The parameters actually granted by the central are tracked and can be read with
+ *          @ref ble_conn_policy_granted_get.
+ *
+ * @note The application must propagate BLE stack events to this module by calling
+ *       ble_conn_policy_on_ble_evt() after ble_conn_params_on_ble_evt().
+ */
+
+#ifndef BLE_CONN_POLICY_H__
+#define BLE_CONN_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+
+/**@defgroup BLE_CONN_POLICY_USERS Bulk transfer users
+ * @{ */
+#define BLE_CONN_POLICY_USER_DFU     0x01                           /**< Device Firmware Update. */
+#define BLE_CONN_POLICY_USER_CONFIG  0x02                           /**< Batched configuration. */
+#define BLE_CONN_POLICY_USER_LOG     0x04                           /**< Log or record download. */
+/** @} */
+
+/**@brief Connection Parameters Policy init structure. This contains all options and data needed
+ *        for initialization of the module. */
+typedef struct
+{
+    ble_gap_conn_params_t   idle_conn_params;                       /**< Parameters requested while no bulk transfer is active. */
+    ble_gap_conn_params_t   bulk_conn_params;                       /**< Parameters requested while at least one bulk transfer is active. */
+    uint32_t                relax_delay;                            /**< Time from the end of the last bulk transfer until the idle parameters are requested (in number of timer ticks). */
+    uint32_t                bulk_timeout;                           /**< Time from the start of the last bulk transfer until it is ended anyway (in number of timer ticks). 0 for no limit. */
+    ble_srv_error_handler_t error_handler;                          /**< Function to be called in case of an error. */
+} ble_conn_policy_init_t;
+
+
+/**@brief Function for initializing the Connection Parameters Policy module.
+ *
+ * @param[in]   p_init  This contains information needed to initialize this module.
+ *
+ * @return      NRF_SUCCESS on successful initialization, otherwise an error code.
+ */
+uint32_t ble_conn_policy_init(const ble_conn_policy_init_t * p_init);
+
+/**@brief Function for registering the start of a bulk transfer.
+ *
+ * @details Requests the bulk parameters if no other transfer is active. If not connected, the
+ *          request is issued as soon as a connection is established. Restarts the bulk timeout.
+ *
+ * @param[in]   user    One of @ref BLE_CONN_POLICY_USERS.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_conn_policy_bulk_start(uint8_t user);
+
+/**@brief Function for registering the end of a bulk transfer.
+ *
+ * @details When no transfer is left, the idle parameters are requested after the relax delay.
+ *
+ * @param[in]   user    One of @ref BLE_CONN_POLICY_USERS.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_conn_policy_bulk_stop(uint8_t user);
+
+/**@brief Function for getting the connection parameters granted by the central.
+ *
+ * @param[out]  p_conn_params   Parameters of the current connection.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if not connected.
+ */
+uint32_t ble_conn_policy_granted_get(ble_gap_conn_params_t * p_conn_params);
+
+/**@brief Function for checking whether the central has granted the bulk parameters.
+ *
+ * @return      true if connected with an interval no longer than the bulk maximum interval.
+ */
+bool ble_conn_policy_is_bulk_granted(void);
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @details Handles all events from the BLE stack that are of interest to this module.
+ *
+ * @param[in]   p_ble_evt  The event received from the BLE stack.
+ */
+void ble_conn_policy_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // BLE_CONN_POLICY_H__
+
+/** @} */
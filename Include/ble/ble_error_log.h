@@ -20,6 +20,16 @@
  * @details It contains functions for writing an error code, line number, filename/message and
  *          the stack to the flash during an error, e.g. in the assert handler.
  *
+ *          It also keeps a crash ring in RAM which is not initialized at startup, so it survives
+ *          the reset done by the error handler. The error handler adds a record with
+ *          @ref ble_error_log_ring_add, which neither writes to flash nor disturbs the radio. After
+ *          the reset, @ref ble_error_log_process copies the new records to a flash page reserved
+ *          through pstorage, one at a time when the application is idle. The records in flash can
+ *          be read with @ref ble_error_log_records_get, e.g. to expose them in a characteristic.
+ *
+ * @note The crash ring must be placed in RAM which is not zeroed by the startup code. With the
+ *       ARM compiler it is placed at @ref BLE_ERROR_LOG_RAM_ADDR, which the project must define as
+ *       a separate RAM area with NoInit set. With GCC it is placed in the .noinit section.
  */
 #ifndef BLE_ERROR_LOG_H__
 #define BLE_ERROR_LOG_H__
@@ -27,6 +37,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ble_flash.h"
+#include "pstorage.h"
 
 #define ERROR_MESSAGE_LENGTH  128                                /**< Length of error message to stored. */
 #define STACK_DUMP_LENGTH     256                                /**< Length of stack to be stored at max: 64 entries of 4 bytes each. */
@@ -47,6 +58,91 @@ typedef struct
 } ble_error_log_data_t;
 
 
+#ifndef BLE_ERROR_LOG_RAM_ADDR
+#define BLE_ERROR_LOG_RAM_ADDR      0x20003F00                   /**< Address of the crash ring, the last 256 bytes of a 16 kB RAM. */
+#endif
+#define BLE_ERROR_LOG_RAM_SIZE      256                          /**< Size of the crash ring in RAM. */
+#define BLE_ERROR_LOG_RING_SIZE     10                           /**< Number of records in the crash ring. */
+
+#ifndef BLE_ERROR_LOG_UPTIME_INTERVAL
+#define BLE_ERROR_LOG_UPTIME_INTERVAL  60                        /**< Interval of the uptime timer (in seconds). Must be less than the app_timer counter wrap. */
+#endif
+
+/**@brief Crash record, as kept in RAM and in flash. */
+typedef struct
+{
+    uint32_t                  err_code;                          /**< Error code. */
+    uint32_t                  pc;                                /**< Address the error handler was called from. */
+    uint32_t                  lr;                                /**< First return address found on the stack of the error handler, usually the caller of the failing function. */
+    uint32_t                  uptime;                            /**< Time since startup (in seconds). */
+    uint16_t                  line_number;                       /**< Line number. */
+    uint16_t                  file_hash;                         /**< CRC16 of the file name. */
+    uint16_t                  seq;                               /**< Sequence number, incremented for each record. */
+    uint16_t                  crc;                               /**< CRC16 of the fields above. */
+} ble_error_log_record_t;
+
+/**@brief Macro for getting the return address of the calling function, to be passed as the pc
+ *        parameter of @ref ble_error_log_ring_add from the error handler.
+ */
+#if defined ( __CC_ARM )
+#define BLE_ERROR_LOG_RETURN_ADDRESS()  __return_address()
+#elif defined ( __GNUC__ )
+#define BLE_ERROR_LOG_RETURN_ADDRESS()  ((uint32_t)__builtin_return_address(0))
+#else
+#define BLE_ERROR_LOG_RETURN_ADDRESS()  0
+#endif
+
+/**@brief Function for initializing the crash ring.
+ *
+ * @details Keeps the records of the crash ring if it survived the reset, registers the flash page
+ *          the records are copied to, and starts the uptime timer. Requires one app_timer and one
+ *          pstorage application, and must be called after pstorage_init() and app_timer_init().
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_error_log_init(void);
+
+/**@brief Function for adding a record to the crash ring. To be called from the error handler.
+ *
+ * @details Only writes to RAM, so it is safe to call from any context, just before a reset.
+ *
+ * @param[in]   err_code     Error code.
+ * @param[in]   line_number  Line number where the error occurred.
+ * @param[in]   p_file_name  Name of the file where the error occurred.
+ * @param[in]   pc           Address the error handler was called from, see
+ *                           @ref BLE_ERROR_LOG_RETURN_ADDRESS.
+ */
+void ble_error_log_ring_add(uint32_t        err_code,
+                            uint32_t        line_number,
+                            const uint8_t * p_file_name,
+                            uint32_t        pc);
+
+/**@brief Function for copying a new record of the crash ring to flash.
+ *
+ * @details Starts at most one flash operation, and returns at once if one is already pending. Call
+ *          it when the application is idle, before sd_app_evt_wait().
+ */
+void ble_error_log_process(void);
+
+/**@brief Function for checking that every record of the crash ring has been copied to flash.
+ *
+ * @details The records from before the last reset are only readable with
+ *          @ref ble_error_log_records_get once this returns true.
+ *
+ * @return      true if no record is waiting for @ref ble_error_log_process and no flash operation
+ *              is pending, or if no flash page is registered.
+ */
+bool ble_error_log_is_flushed(void);
+
+/**@brief Function for getting the most recent records stored in flash.
+ *
+ * @param[out]  p_records    Buffer for the records, oldest first.
+ * @param[in]   max_count    Number of records the buffer has room for.
+ *
+ * @return      Number of records copied to the buffer.
+ */
+uint16_t ble_error_log_records_get(ble_error_log_record_t * p_records, uint16_t max_count);
+
 /**@brief Function for writing the file name/message, line number, and current program stack
  *        to flash.
  * 
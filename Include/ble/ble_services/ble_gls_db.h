@@ -18,6 +18,19 @@
  *
  * @details This module implements at database of stored glucose measurement values.
  *
+ *          The records are kept in a ring of flash pages, see @ref app_flash_ring, in the order
+ *          they were added. When the ring is full, the oldest page of records is erased. The
+ *          records are expected to be added in order of their sequence number and time stamp, so
+ *          they can be found by a binary search, and are read from flash without copying.
+ *          Sequence numbers wrap around, and are compared relative to the oldest record.
+ *
+ *          Deleted records keep their index until they are removed from the front of the
+ *          database, and are reported as corrupt meanwhile.
+ *
+ *          The records survive a reset. pstorage must be initialized before @ref ble_gls_db_init
+ *          is called, and PSTORAGE_DATA_START_ADDR must leave room for
+ *          @ref BLE_GLS_DB_PAGE_COUNT pages.
+ *
  * @note Attention! 
  *  To maintain compliance with Nordic Semiconductor ASA Bluetooth profile 
  *  qualification listings, These APIs must not be modified. However, the corresponding
@@ -30,7 +43,15 @@
 #include <stdint.h>
 #include "ble_gls.h"
 
-#define BLE_GLS_DB_MAX_RECORDS      20
+#ifndef BLE_GLS_DB_PAGE_COUNT
+#define BLE_GLS_DB_PAGE_COUNT       4                                       /**< Number of flash pages holding the records. */
+#endif
+
+#ifndef BLE_GLS_DB_BUF_RECORDS
+#define BLE_GLS_DB_BUF_RECORDS      4                                       /**< Number of records which can wait in RAM to be written to flash. */
+#endif
+
+#define BLE_GLS_DB_MAX_RECORDS      0xFFFF                                  /**< Largest number of records, limited by the size of an index. */
 
 /**@brief Function for initializing the glucose record database.
  *
@@ -57,7 +78,7 @@ uint16_t ble_gls_db_num_records_get(void);
  * 
  * @return      NRF_SUCCESS on success.
  */
-uint32_t ble_gls_db_record_get(uint8_t record_num, ble_gls_rec_t * p_rec);
+uint32_t ble_gls_db_record_get(uint16_t record_num, ble_gls_rec_t * p_rec);
 
 /**@brief Function for adding a record at the end of the database.
  *
@@ -71,13 +92,74 @@ uint32_t ble_gls_db_record_add(ble_gls_rec_t * p_rec);
 
 /**@brief Function for deleting a database entry.
  *
- * @details This call deletes an record from the database.
+ * @details This call deletes an record from the database, see @ref ble_gls_db_records_delete.
  *
  * @param[in]   record_num   Index of record to delete.
  * 
- * @return      NRF_SUCCESS on success.
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_gls_db_record_delete(uint16_t record_num);
+
+/**@brief Function for deleting a range of database entries.
+ *
+ * @details The records are marked as deleted in flash in the background.
+ *
+ * @param[in]   record_num    Index of the first record to delete.
+ * @param[in]   num_records   Number of records to delete.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_NOT_FOUND if there is no record in the range,
+ *              NRF_ERROR_BUSY if a deletion is still in progress.
+ */
+uint32_t ble_gls_db_records_delete(uint16_t record_num, uint16_t num_records);
+
+/**@brief Function for getting the number of records removed from the front of the database.
+ *
+ * @details Adding this count to an index gives a position which does not change when the oldest
+ *          records are removed, so a reader can keep its place, see
+ *          @ref app_flash_ring_removed_count_get.
+ *
+ * @return      Number of records removed since @ref ble_gls_db_init.
+ */
+uint32_t ble_gls_db_removed_count_get(void);
+
+/**@brief Function for getting a record from the database without copying it.
+ *
+ * @details The record is read in place, in flash or in the RAM buffer of records waiting to be
+ *          written. The pointer is valid until the database is modified, or a flash operation
+ *          completes.
+ *
+ * @param[in]   record_num    Index of the record to retrieve, 0 being the oldest.
+ * @param[out]  pp_rec        Record.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_DATA if the record is corrupt, otherwise
+ *              an error code.
+ */
+uint32_t ble_gls_db_record_ptr_get(uint16_t record_num, const ble_gls_rec_t ** pp_rec);
+
+/**@brief Function for finding the first record with a sequence number not less than a given one.
+ *
+ * @details The records must have been added in increasing order of sequence number. Sequence
+ *          numbers are compared with serial number arithmetic, relative to the oldest record, so
+ *          the search still works after the sequence number has wrapped around.
+ *
+ * @param[in]   seq_num   Sequence number to search for.
+ *
+ * @return      Index of the first record with a sequence number greater than or equal to seq_num,
+ *              or the number of records if there is none.
+ */
+uint16_t ble_gls_db_seq_num_lower_bound(uint16_t seq_num);
+
+/**@brief Function for finding the first record with a time stamp not earlier than a given one.
+ *
+ * @details The base time of the records is compared, without their time offset. The records must
+ *          have been added in chronological order.
+ *
+ * @param[in]   p_time    Time to search for.
+ *
+ * @return      Index of the first record with a base time later than or equal to p_time, or the
+ *              number of records if there is none.
  */
-uint32_t ble_gls_db_record_delete(uint8_t record_num);
+uint16_t ble_gls_db_time_lower_bound(const ble_date_time_t * p_time);
 
 #endif // BLE_GLS_DB_H__
 
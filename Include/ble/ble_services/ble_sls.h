@@ -0,0 +1,175 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup ble_sdk_srv_sls Sensor Log Service
+ * @{
+ * @ingroup ble_sdk_srv
+ * @brief Sensor Log Service module.
+ *
+ * @details This module logs timestamped sensor samples, e.g. temperature, acceleration or battery
+ *          level, to a ring of flash pages, see @ref app_flash_ring, and lets a central download
+ *          them through a Record Access Control Point.
+ *
+ *          To keep the energy per sample low, samples are collected in RAM and written to flash
+ *          BLE_SLS_WRITE_THRESHOLD at a time, and the next flash page is erased ahead. Samples
+ *          still in RAM are lost by a reset, unless @ref ble_sls_flush is called first.
+ *
+ *          The Record Access Control Point supports the Report Stored Records, Report Number of
+ *          Stored Records and Abort Operation op codes, with all operators. The filter is either
+ *          the sequence number (@ref BLE_SLS_FILTER_SEQ_NUM) or the timestamp
+ *          (@ref BLE_SLS_FILTER_TIMESTAMP), each a 32 bit little endian value. Samples are found by
+ *          a binary search, so samples must be added with timestamps that do not decrease.
+ *
+ *          Reported samples are packed into notifications of the Sample characteristic through
+ *          the @ref ble_sdk_srv_ntf_queue, several samples per notification. Each sample is encoded
+ *          as:
+ *          - Sequence number, lower 16 bits.
+ *          - Timestamp, 32 bits.
+ *          - Type in bits 0-5 and the number of values in bits 6-7.
+ *          - The values, 16 bits each.
+ *          All fields are little endian. The central extends the sequence numbers, as the samples
+ *          are reported in order.
+ *
+ *          While samples are being reported, the bulk connection parameters are requested through
+ *          @ref ble_conn_policy.
+ *
+ * @note The application must propagate BLE stack events to this module by calling
+ *       ble_sls_on_ble_evt() from the @ref ble_stack_handler callback, after
+ *       ble_srv_ntf_queue_on_ble_evt(). pstorage must be initialized before @ref ble_sls_init is
+ *       called, and PSTORAGE_DATA_START_ADDR must leave room for @ref BLE_SLS_PAGE_COUNT pages.
+ */
+
+#ifndef BLE_SLS_H__
+#define BLE_SLS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+
+#ifndef BLE_SLS_PAGE_COUNT
+#define BLE_SLS_PAGE_COUNT              8                               /**< Number of flash pages holding the samples, one of them kept erased. */
+#endif
+
+#ifndef BLE_SLS_BUF_SAMPLES
+#define BLE_SLS_BUF_SAMPLES             8                               /**< Number of samples which can wait in RAM to be written to flash. */
+#endif
+
+#ifndef BLE_SLS_WRITE_THRESHOLD
+#define BLE_SLS_WRITE_THRESHOLD         (BLE_SLS_BUF_SAMPLES / 2)       /**< Number of samples waiting in RAM which triggers a flash write. */
+#endif
+
+#define BLE_SLS_UUID_BASE               {0x3E, 0x70, 0x1B, 0x6C, 0x85, 0x2A, 0x4F, 0x9D, \
+                                         0xB1, 0x47, 0xC2, 0x58, 0x00, 0x00, 0xE4, 0x71}    /**< Vendor specific base UUID of the service. */
+#define BLE_SLS_UUID_SERVICE            0x1540                          /**< UUID of the Sensor Log Service. */
+#define BLE_SLS_UUID_SAMPLE_CHAR        0x1541                          /**< UUID of the Sample characteristic. */
+
+#define BLE_SLS_SAMPLE_VALUES_MAX       3                               /**< Largest number of values of a sample. */
+
+/**@defgroup BLE_SLS_SAMPLE_TYPES Sample types
+ * @{ */
+#define BLE_SLS_SAMPLE_TEMPERATURE      0x01                            /**< Temperature in 0.01 degrees Celsius, one value. */
+#define BLE_SLS_SAMPLE_ACCELERATION     0x02                            /**< Acceleration in mg, x, y and z. */
+#define BLE_SLS_SAMPLE_BATTERY_LEVEL    0x03                            /**< Battery level in percent, one value. */
+/** @} */
+
+/**@defgroup BLE_SLS_FILTER_TYPES RACP filter types
+ * @{ */
+#define BLE_SLS_FILTER_SEQ_NUM          0x01                            /**< Filter on the sequence number. */
+#define BLE_SLS_FILTER_TIMESTAMP        0x02                            /**< Filter on the timestamp. */
+/** @} */
+
+/**@brief Sensor sample, as stored in flash. */
+typedef struct
+{
+    uint32_t seq_num;                                                   /**< Sequence number, set by @ref ble_sls_sample_add. */
+    uint32_t timestamp;                                                 /**< Time of the sample, e.g. in seconds. Must not decrease from one sample to the next. */
+    uint8_t  type;                                                      /**< Type of the sample, see @ref BLE_SLS_SAMPLE_TYPES. Application specific types must be below 64. */
+    uint8_t  value_count;                                               /**< Number of values, at most @ref BLE_SLS_SAMPLE_VALUES_MAX. */
+    int16_t  value[BLE_SLS_SAMPLE_VALUES_MAX];                          /**< Values of the sample. */
+} ble_sls_sample_t;
+
+/**@brief Sensor Log Service init structure. This contains all options and data needed for
+ *        initialization of the service. */
+typedef struct
+{
+    ble_srv_error_handler_t      error_handler;                         /**< Function to be called in case of an error. */
+    ble_srv_cccd_security_mode_t sample_attr_md;                        /**< Initial security level for the Sample characteristic CCCD. */
+    ble_srv_cccd_security_mode_t racp_attr_md;                          /**< Initial security level for the Record Access Control Point. */
+} ble_sls_init_t;
+
+/**@brief Sensor Log Service structure. This contains various status information for the
+ *        service. */
+typedef struct
+{
+    ble_srv_error_handler_t      error_handler;                         /**< Function to be called in case of an error. */
+    uint16_t                     service_handle;                        /**< Handle of Sensor Log Service (as provided by the BLE stack). */
+    ble_gatts_char_handles_t     sample_handles;                        /**< Handles related to the Sample characteristic. */
+    ble_gatts_char_handles_t     racp_handles;                          /**< Handles related to the Record Access Control Point characteristic. */
+    uint16_t                     conn_handle;                           /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection). */
+    uint8_t                      uuid_type;                             /**< UUID type of the vendor specific base UUID. */
+} ble_sls_t;
+
+/**@brief Function for initializing the Sensor Log Service.
+ *
+ * @details Mounts the samples already in flash, and adds the service and its characteristics.
+ *
+ * @param[out]  p_sls       Sensor Log Service structure. This structure will have to be supplied
+ *                          by the application. It will be initialized by this function, and will
+ *                          later be used to identify this particular service instance.
+ * @param[in]   p_sls_init  Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+uint32_t ble_sls_init(ble_sls_t * p_sls, const ble_sls_init_t * p_sls_init);
+
+/**@brief Function for adding a sample to the log.
+ *
+ * @details The sample gets the next sequence number. If the log is full, the oldest page of
+ *          samples is erased.
+ *
+ * @param[in]     p_sls      Sensor Log Service structure.
+ * @param[in,out] p_sample   Sample to add. Its sequence number is set by this function.
+ *
+ * @retval      NRF_SUCCESS          Sample added.
+ * @retval      NRF_ERROR_NO_MEM     The samples waiting to be written fill the RAM buffer.
+ * @retval      NRF_ERROR_INVALID_PARAM  Too many values, type out of range, or timestamp before
+ *                                       the timestamp of the previous sample.
+ */
+uint32_t ble_sls_sample_add(ble_sls_t * p_sls, ble_sls_sample_t * p_sample);
+
+/**@brief Function for writing the samples waiting in RAM to flash.
+ *
+ * @param[in]   p_sls   Sensor Log Service structure.
+ */
+void ble_sls_flush(ble_sls_t * p_sls);
+
+/**@brief Function for getting the number of samples in the log.
+ *
+ * @return      Number of samples, including the samples waiting in RAM.
+ */
+uint32_t ble_sls_sample_count_get(void);
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @details Handles all events from the BLE stack of interest to the Sensor Log Service.
+ *
+ * @param[in]   p_sls      Sensor Log Service structure.
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ */
+void ble_sls_on_ble_evt(ble_sls_t * p_sls, ble_evt_t * p_ble_evt);
+
+#endif // BLE_SLS_H__
+
+/** @} */
@@ -0,0 +1,132 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup ble_sdk_srv_ntf_queue Notification Queue
+ * @{
+ * @ingroup ble_sdk_srv
+ * @brief Shared queue for sending notifications at the rate the SoftDevice TX buffers allow.
+ *
+ * @details Services hand their notifications to this module instead of calling
+ *          sd_ble_gatts_hvx() directly. The queue keeps pushing notifications to the SoftDevice
+ *          until it reports @ref BLE_ERROR_NO_TX_BUFFERS, so every available TX buffer is used in
+ *          each connection event. The remaining entries are retried when @ref BLE_EVT_TX_COMPLETE
+ *          is received.
+ *
+ *          Where a profile allows several samples in one notification,
+ *          @ref ble_srv_ntf_queue_append packs the sample into the last queued notification for
+ *          the same characteristic, as long as it fits.
+ *
+ *          The module counts the packets reported in each @ref BLE_EVT_TX_COMPLETE, which gives
+ *          the number of notifications sent per connection event.
+ *
+ * @note The application must propagate BLE stack events to this module by calling
+ *       ble_srv_ntf_queue_on_ble_evt() from the @ref ble_stack_handler callback.
+ */
+
+#ifndef BLE_SRV_NTF_QUEUE_H__
+#define BLE_SRV_NTF_QUEUE_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+
+#ifndef BLE_SRV_NTF_QUEUE_SIZE
+#define BLE_SRV_NTF_QUEUE_SIZE      8                               /**< Number of notifications that can be queued. */
+#endif
+
+#define BLE_SRV_NTF_MAX_LEN         (GATT_MTU_SIZE_DEFAULT - 3)     /**< Largest notification payload with the default ATT MTU. */
+
+/**@brief Notification Queue init structure. */
+typedef struct
+{
+    ble_srv_error_handler_t error_handler;                          /**< Function to be called in case of an error. */
+} ble_srv_ntf_queue_init_t;
+
+/**@brief Notification Queue statistics. */
+typedef struct
+{
+    uint32_t queued;                                                /**< Notifications accepted into the queue. */
+    uint32_t sent;                                                  /**< Notifications accepted by the SoftDevice. */
+    uint32_t dropped;                                               /**< Notifications dropped, e.g. on disconnect or when notification was disabled. */
+    uint32_t packed;                                                /**< Samples packed into an already queued notification. */
+    uint32_t tx_complete_evts;                                      /**< Number of BLE_EVT_TX_COMPLETE events, one per connection event with traffic. */
+    uint32_t tx_complete_pkts;                                      /**< Packets reported by those events. */
+    uint8_t  max_pkts_per_evt;                                      /**< Highest number of packets sent in one connection event. */
+} ble_srv_ntf_queue_stats_t;
+
+
+/**@brief Function for initializing the Notification Queue.
+ *
+ * @param[in]   p_init  Information needed to initialize the module.
+ *
+ * @return      NRF_SUCCESS on successful initialization.
+ */
+uint32_t ble_srv_ntf_queue_init(const ble_srv_ntf_queue_init_t * p_init);
+
+/**@brief Function for queueing a notification.
+ *
+ * @details The notification is passed to the SoftDevice right away if a TX buffer is free.
+ *
+ * @param[in]   conn_handle   Connection to send the notification on.
+ * @param[in]   value_handle  Value handle of the characteristic.
+ * @param[in]   p_data        Notification payload, copied by this function.
+ * @param[in]   len           Length of the payload.
+ *
+ * @return      NRF_SUCCESS if queued or sent, NRF_ERROR_NO_MEM if the queue is full,
+ *              NRF_ERROR_DATA_SIZE if the payload does not fit a notification.
+ */
+uint32_t ble_srv_ntf_queue_send(uint16_t        conn_handle,
+                                uint16_t        value_handle,
+                                const uint8_t * p_data,
+                                uint16_t        len);
+
+/**@brief Function for queueing a sample that may share a notification with earlier samples.
+ *
+ * @details If the last queued notification is for the same connection and characteristic and has
+ *          room for the sample, the sample is appended to it. Otherwise a new notification is
+ *          queued as with @ref ble_srv_ntf_queue_send.
+ *
+ * @param[in]   conn_handle   Connection to send the sample on.
+ * @param[in]   value_handle  Value handle of the characteristic.
+ * @param[in]   p_data        Encoded sample, copied by this function.
+ * @param[in]   len           Length of the sample.
+ *
+ * @return      NRF_SUCCESS if queued, packed or sent, otherwise an error code.
+ */
+uint32_t ble_srv_ntf_queue_append(uint16_t        conn_handle,
+                                  uint16_t        value_handle,
+                                  const uint8_t * p_data,
+                                  uint16_t        len);
+
+/**@brief Function for getting the number of free queue entries.
+ *
+ * @return      Number of notifications that can still be queued.
+ */
+uint8_t ble_srv_ntf_queue_free_count_get(void);
+
+/**@brief Function for reading the queue statistics.
+ *
+ * @param[out]  p_stats   Current statistics.
+ */
+void ble_srv_ntf_queue_stats_get(ble_srv_ntf_queue_stats_t * p_stats);
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ */
+void ble_srv_ntf_queue_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // BLE_SRV_NTF_QUEUE_H__
+
+/** @} */
@@ -69,6 +69,11 @@ uint32_t ble_rpc_cmd_resp_data_send(uint8_t               op_code,
  * @details     The function will read the arrived packet from the transport layer
  *              which is passed for decoding by the rpc_cmd_decoder module.
  *
+ *              A TX buffer for the Command Response is reserved before the command is processed.
+ *              If none is available the command waits, together with the commands received after
+ *              it, until @ref ble_rpc_cmd_tx_done_handle is called. It must be scheduled once for
+ *              each HCI_TRANSPORT_RX_RDY event of a command packet.
+ *
  * @param[in]   p_event_data   Event data. This will be NULL as rpc_evt_schedule
  *                             does not set any data.
  * @param[in]   event_size     Event data size. This will be 0 as rpc_evt_schedule
@@ -76,6 +81,14 @@ uint32_t ble_rpc_cmd_resp_data_send(uint8_t               op_code,
  */
 void ble_rpc_cmd_handle(void * p_event_data, uint16_t event_size);
 
+/**@brief Function for resuming the processing of commands waiting for a TX buffer.
+ *
+ * @details Must be called from the HCI transport TX done handler, after the TX buffer of the 
+ *          completed packet has been freed. Processing continues from the scheduler, in the same
+ *          context as @ref ble_rpc_cmd_handle. Takes one scheduler queue entry.
+ */
+void ble_rpc_cmd_tx_done_handle(void);
+
 #endif // BLE_RPC_CMD_DECODER_H__
 
 /** @} */
@@ -20,21 +20,76 @@
  *
  * @details This file contains the declaration of the functions that encode serialized commands
  *          from Application Chip.
+ *
+ *          The sd_* functions are synchronous, they return once the response has been received.
+ *          Commands sent with @ref ble_rpc_cmd_async_send, such as @ref ble_rpc_gatts_hvx_async
+ *          and @ref ble_rpc_gatts_value_set_async, return as soon as the command is handed to the
+ *          transport layer. Up to @ref BLE_RPC_CMD_ASYNC_QUEUE_SIZE of them can be in flight, each
+ *          in its own TX buffer, and every response is passed to the handler given with the
+ *          command. The connectivity chip executes the commands in the order received, so the
+ *          responses are matched to the commands by order.
+ *
+ *          A command which the transport layer completes with HCI_TRANSPORT_TX_DONE_FAILURE
+ *          fails with NRF_ERROR_TIMEOUT, both synchronous and asynchronous ones. The connectivity
+ *          chip may still have executed it.
+ *
+ *          The round trip time of every command, from the write to the transport layer until the
+ *          response, is recorded in @ref ble_rpc_cmd_stats_t. Together with the
+ *          @ref hci_transport statistics this gives the command latency percentiles and the
+ *          command rate for a workload run on the target.
+ *
+ * @note  Synchronous and asynchronous commands must be issued from the same context.
+ *        Response handlers are called from the context of the transport layer RX event; use
+ *        @ref app_scheduler to defer the processing to the main loop.
  */
 
 #ifndef BLE_RPC_CMD_ENCODER_H__
 #define BLE_RPC_CMD_ENCODER_H__
 
 #include <stdint.h>
+#include "ble_gatts.h"
 #include "ble_rpc_defines.h"
 
+#ifndef BLE_RPC_CMD_ASYNC_QUEUE_SIZE
+#define BLE_RPC_CMD_ASYNC_QUEUE_SIZE    4   /**< Number of asynchronous commands which can be in flight. */
+#endif
+
 /**@brief Command response type. */
 typedef struct
 {
     uint8_t  op_code;   /**< Operation code for which this response applies. */
     uint32_t err_code;  /**< Error code received for this response applies. */
+    uint16_t length;    /**< Length of the response packet, for decoding its data. */
 } cmd_response_t;
 
+#define BLE_RPC_CMD_LATENCY_BUCKET_COUNT    16  /**< Number of buckets in the command latency histogram. */
+
+/**@brief Command latency statistics. Latencies are in RTC1 ticks, see @ref app_timer. */
+typedef struct
+{
+    uint32_t cmd_count;                                             /**< Number of commands completed. */
+    uint32_t latency_min;                                           /**< Lowest latency. */
+    uint32_t latency_max;                                           /**< Highest latency. */
+    uint32_t latency_sum;                                           /**< Sum of all latencies, for the mean. */
+    uint32_t latency_histogram[BLE_RPC_CMD_LATENCY_BUCKET_COUNT];   /**< Bucket n counts the latencies from 2^(n-1) to 2^n - 1 ticks, bucket 0 the zero latencies. The last bucket also counts all longer latencies. */
+} ble_rpc_cmd_stats_t;
+
+/**@brief Asynchronous command response handler type.
+ *
+ * @param[in] cmd_id      Identifier given to the command by @ref ble_rpc_cmd_async_send.
+ * @param[in] err_code    Error code received from the connectivity chip, NRF_ERROR_TIMEOUT if
+ *                        the transport layer failed to deliver the command.
+ * @param[in] p_data      Response data following the error code, NULL if the response was 
+ *                        invalid. Only valid until the handler returns.
+ * @param[in] data_len    Length of the response data.
+ * @param[in] p_context   Context given with the command.
+ */
+typedef void (*ble_rpc_cmd_resp_handler_t)(uint16_t        cmd_id,
+                                           uint32_t        err_code,
+                                           const uint8_t * p_data,
+                                           uint16_t        data_len,
+                                           void *          p_context);
+
 /**@brief Function for initializing the BLE S110 RPC Command Encoder module.
  *
  * @details This function uses the HCI Transport module, \ref hci_transport and executes
@@ -51,6 +106,8 @@ uint32_t ble_rpc_cmd_encoder_init(void);
  *
  * @param[in] op_code       The Operation Code for which a response message is expected.
  *
+ * @retval NRF_ERROR_TIMEOUT  The transport layer failed to deliver the command. The response
+ *                            buffer then holds no data.
  * @return The decoded error code received from the connectivity chip.
  */
 uint32_t ble_rpc_cmd_resp_wait(uint8_t op_code);
@@ -65,6 +122,102 @@ uint32_t ble_rpc_cmd_resp_wait(uint8_t op_code);
  */
 void ble_rpc_cmd_rsp_pkt_received(uint8_t * p_packet, uint16_t packet_length);
 
+/**@brief Function for sending a serialized command without waiting for its response.
+ *
+ * @details The buffer is owned by this module from the call on, and is freed when its 
+ *          transmission is complete, or immediately if an error is returned.
+ *
+ * @param[in]  p_buffer       Serialized command, allocated with \ref hci_transport_tx_alloc or 
+ *                            \ref hci_transport_tx_alloc_sized .
+ * @param[in]  length         Length of the serialized command.
+ * @param[in]  resp_handler   Function to be called with the response, NULL to ignore it.
+ * @param[in]  p_context      Context passed to the response handler.
+ * @param[out] p_cmd_id       Identifier given to the command, may be NULL.
+ *
+ * @retval NRF_SUCCESS        Command handed to the transport layer.
+ * @retval NRF_ERROR_NO_MEM   Too many commands in flight, retry once a response has arrived.
+ * @return                    Errors from \ref hci_transport_pkt_write .
+ */
+uint32_t ble_rpc_cmd_async_send(uint8_t *                  p_buffer,
+                                uint16_t                   length,
+                                ble_rpc_cmd_resp_handler_t resp_handler,
+                                void *                     p_context,
+                                uint16_t *                 p_cmd_id);
+
+/**@brief Function for getting the number of asynchronous commands awaiting their response.
+ *
+ * @return Number of asynchronous commands in flight.
+ */
+uint8_t ble_rpc_cmd_async_pending_count_get(void);
+
+/**@brief Function for reading the command latency statistics.
+ *
+ * @details The command rate is the difference in cmd_count between two reads, divided by the 
+ *          time between them.
+ *
+ * @param[out] p_stats    Current statistics.
+ */
+void ble_rpc_cmd_stats_get(ble_rpc_cmd_stats_t * p_stats);
+
+/**@brief Function for clearing the command latency statistics.
+ */
+void ble_rpc_cmd_stats_reset(void);
+
+/**@brief Function for estimating a command latency percentile from the statistics.
+ *
+ * @param[in] p_stats     Statistics read with @ref ble_rpc_cmd_stats_get.
+ * @param[in] percent     Percentile, e.g. 50 or 99.
+ *
+ * @return    Upper bound of the histogram bucket holding the percentile, in RTC1 ticks.
+ */
+uint32_t ble_rpc_cmd_latency_percentile_get(const ble_rpc_cmd_stats_t * p_stats, uint8_t percent);
+
+/**@brief Function for sending a notification or indication without waiting for the response.
+ *
+ * @details Asynchronous variant of sd_ble_gatts_hvx. The response data holds the number of bytes
+ *          written, as a 16 bit value.
+ *
+ * @param[in]  conn_handle    Connection handle.
+ * @param[in]  p_hvx_params   Notification or indication parameters, copied by this function.
+ * @param[in]  resp_handler   Function to be called with the response, NULL to ignore it.
+ * @param[in]  p_context      Context passed to the response handler.
+ * @param[out] p_cmd_id       Identifier given to the command, may be NULL.
+ *
+ * @retval NRF_SUCCESS        Command handed to the transport layer.
+ * @retval NRF_ERROR_NO_MEM   No TX buffer available or too many commands in flight.
+ * @return                    Other errors from encoding or \ref ble_rpc_cmd_async_send .
+ */
+uint32_t ble_rpc_gatts_hvx_async(uint16_t                             conn_handle,
+                                 ble_gatts_hvx_params_t const * const p_hvx_params,
+                                 ble_rpc_cmd_resp_handler_t           resp_handler,
+                                 void *                               p_context,
+                                 uint16_t *                           p_cmd_id);
+
+/**@brief Function for setting an attribute value without waiting for the response.
+ *
+ * @details Asynchronous variant of sd_ble_gatts_value_set. The response data holds the number of
+ *          bytes written, as an 8 bit value.
+ *
+ * @param[in]  handle         Attribute handle.
+ * @param[in]  offset         Offset in bytes to write.
+ * @param[in]  len            Length in bytes to write.
+ * @param[in]  p_value        Value to write, copied by this function. May be NULL.
+ * @param[in]  resp_handler   Function to be called with the response, NULL to ignore it.
+ * @param[in]  p_context      Context passed to the response handler.
+ * @param[out] p_cmd_id       Identifier given to the command, may be NULL.
+ *
+ * @retval NRF_SUCCESS        Command handed to the transport layer.
+ * @retval NRF_ERROR_NO_MEM   No TX buffer available or too many commands in flight.
+ * @return                    Other errors from encoding or \ref ble_rpc_cmd_async_send .
+ */
+uint32_t ble_rpc_gatts_value_set_async(uint16_t                   handle,
+                                       uint16_t                   offset,
+                                       uint16_t                   len,
+                                       uint8_t const * const      p_value,
+                                       ble_rpc_cmd_resp_handler_t resp_handler,
+                                       void *                     p_context,
+                                       uint16_t *                 p_cmd_id);
+
 #endif  // BLE_RPC_CMD_ENCODER_H__
 
 /**@} */
@@ -0,0 +1,192 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup ble_rpc_codec Structure Codec
+ * @{
+ * @ingroup ble_sdk_lib_serialization
+ *
+ * @brief   Table driven encoding and decoding of S110 SoftDevice structures.
+ *
+ * @details A structure is described once, by a table of @ref ble_rpc_field_desc_t, and the same
+ *          table is used by the encoders on one chip and the decoders on the other. All functions
+ *          check the buffer length, so a truncated packet is reported instead of being read past
+ *          its end.
+ *
+ *          Fields can be encoded with a fixed size or as a varint, 7 bits per byte with the most
+ *          significant bit set in all bytes but the last. A structure described with
+ *          @ref BLE_RPC_STRUCT_OMIT_ZERO is preceded by a bitmap of its non-zero fields, and its
+ *          zero fields are left out.
+ */
+
+#ifndef BLE_RPC_CODEC_H__
+#define BLE_RPC_CODEC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLE_RPC_STRUCT_OMIT_ZERO        0x01    /**< Flag for leaving out the zero fields of a structure. */
+
+#define BLE_RPC_STRUCT_FIELD_COUNT_MAX  16      /**< Maximum number of fields in a structure description. */
+
+/**@brief Encoding of a structure field. */
+typedef enum
+{
+    BLE_RPC_FIELD_UINT,                         /**< Unsigned value, encoded little endian with the size of the field. */
+    BLE_RPC_FIELD_VARUINT,                      /**< Unsigned value, encoded as a varint. */
+    BLE_RPC_FIELD_ARRAY                         /**< Byte array, encoded as is. */
+} ble_rpc_field_type_t;
+
+/**@brief Description of a structure field. */
+typedef struct
+{
+    uint8_t type;                               /**< Encoding of the field, see @ref ble_rpc_field_type_t. */
+    uint8_t offset;                             /**< Offset of the field in the structure. */
+    uint8_t size;                               /**< Size of the field in the structure. 1, 2 or 4 for values. */
+} ble_rpc_field_desc_t;
+
+/**@brief Description of a structure. */
+typedef struct
+{
+    const ble_rpc_field_desc_t * p_fields;      /**< Fields, in the order they are encoded. */
+    uint8_t                      field_count;   /**< Number of fields. */
+    uint8_t                      flags;         /**< Encoding flags, e.g. @ref BLE_RPC_STRUCT_OMIT_ZERO. */
+} ble_rpc_struct_desc_t;
+
+/**@brief Macro for describing a structure field. */
+#define BLE_RPC_FIELD(TYPE, STRUCT, MEMBER)                                                       \
+    {(TYPE), (uint8_t)offsetof(STRUCT, MEMBER), (uint8_t)sizeof(((STRUCT *)0)->MEMBER)}
+
+/**@brief Macro for describing a structure from an array of field descriptions. */
+#define BLE_RPC_STRUCT(FIELDS, FLAGS)                                                             \
+    {(FIELDS), (uint8_t)(sizeof(FIELDS) / sizeof((FIELDS)[0])), (FLAGS)}
+
+
+/**@brief Function for encoding a value as a varint.
+ *
+ * @param[in]     value     Value to encode.
+ * @param[out]    p_buffer  Buffer for the encoded data.
+ * @param[in]     buf_len   Size of the buffer.
+ * @param[in,out] p_index   Position in the buffer, advanced past the encoded value.
+ *
+ * @retval NRF_SUCCESS          Value encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
+ */
+uint32_t ble_rpc_varint_encode(uint32_t  value,
+                               uint8_t * p_buffer,
+                               uint32_t  buf_len,
+                               uint32_t * p_index);
+
+/**@brief Function for decoding a varint.
+ *
+ * @param[out]    p_value   Decoded value.
+ * @param[in]     p_buffer  Encoded data.
+ * @param[in]     buf_len   Length of the encoded data.
+ * @param[in,out] p_index   Position in the buffer, advanced past the decoded value.
+ *
+ * @retval NRF_SUCCESS               Value decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Data ends within the value.
+ * @retval NRF_ERROR_INVALID_DATA    Value does not fit 32 bits.
+ */
+uint32_t ble_rpc_varint_decode(uint32_t *      p_value,
+                               const uint8_t * p_buffer,
+                               uint32_t        buf_len,
+                               uint32_t *      p_index);
+
+/**@brief Function for encoding a structure.
+ *
+ * @param[in]     p_desc    Structure description.
+ * @param[in]     p_struct  Structure to encode.
+ * @param[out]    p_buffer  Buffer for the encoded data.
+ * @param[in]     buf_len   Size of the buffer.
+ * @param[in,out] p_index   Position in the buffer, advanced past the encoded structure.
+ *
+ * @retval NRF_SUCCESS          Structure encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
+ */
+uint32_t ble_rpc_struct_encode(const ble_rpc_struct_desc_t * p_desc,
+                               const void *                  p_struct,
+                               uint8_t *                     p_buffer,
+                               uint32_t                      buf_len,
+                               uint32_t *                    p_index);
+
+/**@brief Function for decoding a structure.
+ *
+ * @details Fields left out by the encoder are set to zero.
+ *
+ * @param[in]     p_desc    Structure description.
+ * @param[out]    p_struct  Decoded structure.
+ * @param[in]     p_buffer  Encoded data.
+ * @param[in]     buf_len   Length of the encoded data.
+ * @param[in,out] p_index   Position in the buffer, advanced past the decoded structure.
+ *
+ * @retval NRF_SUCCESS               Structure decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Data ends within the structure.
+ * @retval NRF_ERROR_INVALID_DATA    A value does not fit its field.
+ */
+uint32_t ble_rpc_struct_decode(const ble_rpc_struct_desc_t * p_desc,
+                               void *                        p_struct,
+                               const uint8_t *               p_buffer,
+                               uint32_t                      buf_len,
+                               uint32_t *                    p_index);
+
+/**@brief Function for encoding an optional structure, preceded by RPC_BLE_FIELD_PRESENT or
+ *        RPC_BLE_FIELD_NOT_PRESENT.
+ *
+ * @param[in]     p_desc    Structure description.
+ * @param[in]     p_struct  Structure to encode, NULL if not present.
+ * @param[out]    p_buffer  Buffer for the encoded data.
+ * @param[in]     buf_len   Size of the buffer.
+ * @param[in,out] p_index   Position in the buffer, advanced past the encoded data.
+ *
+ * @retval NRF_SUCCESS          Structure encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
+ */
+uint32_t ble_rpc_opt_struct_encode(const ble_rpc_struct_desc_t * p_desc,
+                                   const void *                  p_struct,
+                                   uint8_t *                     p_buffer,
+                                   uint32_t                      buf_len,
+                                   uint32_t *                    p_index);
+
+/**@brief Function for decoding an optional structure encoded by
+ *        @ref ble_rpc_opt_struct_encode.
+ *
+ * @param[in]     p_desc    Structure description.
+ * @param[in]     p_storage Storage for the decoded structure.
+ * @param[out]    pp_struct Set to p_storage if the structure is present, otherwise to NULL.
+ * @param[in]     p_buffer  Encoded data.
+ * @param[in]     buf_len   Length of the encoded data.
+ * @param[in,out] p_index   Position in the buffer, advanced past the decoded data.
+ *
+ * @retval NRF_SUCCESS               Structure decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Data ends within the structure.
+ * @retval NRF_ERROR_INVALID_DATA    A value does not fit its field.
+ */
+uint32_t ble_rpc_opt_struct_decode(const ble_rpc_struct_desc_t * p_desc,
+                                   void *                        p_storage,
+                                   void **                       pp_struct,
+                                   const uint8_t *               p_buffer,
+                                   uint32_t                      buf_len,
+                                   uint32_t *                    p_index);
+
+/**@brief Function for getting the largest encoded size of a structure.
+ *
+ * @param[in] p_desc    Structure description.
+ *
+ * @return    Largest number of bytes @ref ble_rpc_struct_encode can produce.
+ */
+uint32_t ble_rpc_struct_size_max(const ble_rpc_struct_desc_t * p_desc);
+
+#endif // BLE_RPC_CODEC_H__
+
+/** @} */
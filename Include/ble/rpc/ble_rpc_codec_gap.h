@@ -0,0 +1,44 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+/** @file
+ *
+ * @defgroup ble_rpc_codec_gap GAP Structure Descriptions
+ * @{
+ * @ingroup ble_sdk_lib_serialization
+ *
+ * @brief   Descriptions of the GAP structures serialized with @ref ble_rpc_codec.
+ *
+ * @details Shared by the command encoder and the event decoder on the Application Chip, and the
+ *          command decoder and the event encoder on the connectivity chip.
+ *
+ *          Only @ref ble_gap_conn_params_t and @ref ble_gap_addr_t are described. The commands and 
+ *          events holding them use these descriptions for those fields, and code their other fields 
+ *          by hand. Structures with bit fields, such as @ref ble_gap_sec_params_t, cannot be 
+ *          described with offsetof and are all coded by hand.
+ */
+
+#ifndef BLE_RPC_CODEC_GAP_H__
+#define BLE_RPC_CODEC_GAP_H__
+
+#include "ble_gap.h"
+#include "ble_rpc_codec.h"
+
+/**@brief Largest encoded size of a @ref ble_gap_conn_params_t, four varints and the field bitmap. */
+#define BLE_RPC_GAP_CONN_PARAMS_SIZE_MAX    (1 + 4 * 3)
+
+extern const ble_rpc_struct_desc_t g_ble_rpc_gap_conn_params_desc;  /**< Description of @ref ble_gap_conn_params_t. Zero fields are omitted, the others are encoded as varints. */
+extern const ble_rpc_struct_desc_t g_ble_rpc_gap_addr_desc;         /**< Description of @ref ble_gap_addr_t. */
+
+#endif // BLE_RPC_CODEC_GAP_H__
+
+/** @} */
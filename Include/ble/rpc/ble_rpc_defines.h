@@ -40,6 +40,7 @@
 
 #define RPC_BLE_CMD_RESP_PKT_MIN_SIZE           6                      /**< Minimum length of a command response. */
 #define RPC_BLE_PKT_MAX_SIZE                    596                    /**< Maximum size for a BLE packet on the HCI Transport layer. This value is the hci_mem_pool buffer size minus the HCI Transport size. @note This value must be aligned with TX_BUF_SIZE in hci_mem_pool_internal.h. */
+#define BLE_RPC_EVT_BATCH_LEN_SIZE              2                      /**< Size of the length field preceding each event in an event batch packet. */
 
 /**@brief The types of packets. */
 typedef enum
@@ -47,6 +48,7 @@ typedef enum
     BLE_RPC_PKT_CMD,                                                   /**< Command packet type. */
     BLE_RPC_PKT_RESP,                                                  /**< Command Response packet type. */
     BLE_RPC_PKT_EVT,                                                   /**< Event packet type. */
+    BLE_RPC_PKT_EVT_BATCH,                                             /**< Event batch packet type, several events in one packet. */
     BLE_RPC_PKT_TYPE_MAX                                               /**< Upper bound. */
 } ble_rpc_pkt_type_t;
 
@@ -40,9 +40,15 @@ void ble_rpc_gap_evt_length_decode(uint8_t event_id, uint16_t * p_event_length);
  *
  * @param[out]  p_ble_evt       The pointer for storing the decoded event.
  * @param[in]   p_packet        The pointer to the encoded event.
+ * @param[in]   packet_length   Length of the encoded event.
+ *
+ * @retval NRF_SUCCESS               Event decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Encoded event is truncated.
+ * @retval NRF_ERROR_INVALID_DATA    A value does not fit its field.
  */
-void ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
-                                   uint8_t const * const p_packet);
+uint32_t ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
+                                       uint8_t const * const p_packet,
+                                       uint16_t              packet_length);
 
 #endif // BLE_RPC_EVENT_DECODER_GAP_H__
 
@@ -20,19 +20,82 @@
  *
  * @details This module provides a function for serializing S110 SoftDevice events.
  *
+ *          Events are packed into one event batch packet, holding a sequence of records, each a
+ *          16 bit length followed by the event in plain event packet format. A batch is bounded
+ *          by @ref BLE_RPC_EVT_BATCH_SIZE_MAX and @ref BLE_RPC_EVT_BATCH_COUNT_MAX. A batch
+ *          holding a single event is sent as a plain event packet.
+ *
+ *          An event arriving while no event packet is in transfer is sent at once. Otherwise it
+ *          opens a batch, which collects further events until the next TX done
+ *          (@ref ble_rpc_event_tx_done_handle), and events which had to wait for a TX buffer go
+ *          into the same batch.
+ *
+ *          With @ref BLE_RPC_EVT_BATCH_LATENCY_MS greater than 0, an open batch is also sent
+ *          after that time at the latest. This requires one additional app_timer, whose timeout
+ *          is passed to the scheduler, as the batch is only changed from there.
+ *
+ * @note The application chip must run an event decoder which handles event batch packets.
  */
 #ifndef BLE_RPC_EVENT_ENCODER_H__
 #define BLE_RPC_EVENT_ENCODER_H__
 
 #include "ble.h"
+#include "ble_rpc_defines.h"
+#include "ble_stack_handler_types.h"
+
+#ifndef BLE_RPC_EVT_QUEUE_SIZE
+#define BLE_RPC_EVT_QUEUE_SIZE  4   /**< Number of events which can wait for a TX buffer. */
+#endif
+
+#ifndef BLE_RPC_EVT_BATCH_SIZE_MAX
+#define BLE_RPC_EVT_BATCH_SIZE_MAX      RPC_BLE_PKT_MAX_SIZE    /**< Maximum size of an event batch packet. */
+#endif
+
+#ifndef BLE_RPC_EVT_BATCH_COUNT_MAX
+#define BLE_RPC_EVT_BATCH_COUNT_MAX     8                       /**< Maximum number of events in an event batch packet. */
+#endif
+
+#ifndef BLE_RPC_EVT_BATCH_LATENCY_MS
+#define BLE_RPC_EVT_BATCH_LATENCY_MS    5                       /**< Maximum time an event batch is held open for further events (in milliseconds). 0 to only send it on TX done. */
+#endif
+
+#define BLE_RPC_EVT_ENCODED_SIZE_MAX    (BLE_PKT_TYPE_SIZE + BLE_STACK_EVT_MSG_BUF_SIZE) /**< Upper bound of the size of one encoded event. */
 
 /**@brief Function for encoding a @ref ble_evt_t. The function will pass the serialized byte stream to the
  *        transport layer after encoding.
  *
+ * @details If no TX buffer is available the event is queued, and encoded by a later call to
+ *          @ref ble_rpc_event_queue_process. Only when the queue is full does this function wait
+ *          for a TX buffer to be freed, sleeping in sd_app_evt_wait in between.
+ *
+ *          Must be called from the scheduler. With @ref BLE_RPC_EVT_BATCH_LATENCY_MS greater than
+ *          0 the batch timer timeout is also passed through the scheduler, and the scheduler queue
+ *          must have room for it.
+ *
  * @param[in]   p_ble_evt    S110 SoftDevice event to serialize.
  */
 void ble_rpc_event_handle(ble_evt_t * p_ble_evt);
 
+/**@brief Function for encoding queued events into the TX buffers which have become available.
+ *
+ * @details Called by the scheduler after @ref ble_rpc_event_tx_done_handle. Must be called from 
+ *          the same context as @ref ble_rpc_event_handle.
+ */
+void ble_rpc_event_queue_process(void);
+
+/**@brief Function for scheduling the encoding of queued events once a TX buffer has been freed.
+ *
+ * @details Must be called from the HCI transport TX done handler, after the TX buffer of the 
+ *          completed packet has been freed. Takes one scheduler queue entry, and
+ *          @ref ble_rpc_event_handle must also be called from the scheduler.
+ *
+ * @note The encoder does not own the TX done handler of the transport layer, the application 
+ *       registers it with hci_transport_tx_done_register. If it does not call this function, 
+ *       queued events are never encoded, and each event batch after the first one is held for
+ *       @ref BLE_RPC_EVT_BATCH_LATENCY_MS, or forever with a latency of 0.
+ */
+void ble_rpc_event_tx_done_handle(void);
+
 #endif // BLE_RPC_EVENT_ENCODER_H__
 
 /** @} */
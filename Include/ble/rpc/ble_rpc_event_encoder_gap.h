@@ -31,10 +31,16 @@
  *
  * @param[in]   p_ble_evt    S110 SoftDevice event to serialize.
  * @param[out]  p_buffer     Pointer to a buffer for the encoded event.
+ * @param[in]   buf_len      Size of the buffer.
+ * @param[out]  p_length     Number of bytes encoded.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small for the event.
  */
-uint32_t ble_rpc_evt_gap_encode(ble_evt_t * p_ble_evt, uint8_t * p_buffer);
+uint32_t ble_rpc_evt_gap_encode(ble_evt_t * p_ble_evt,
+                                uint8_t *   p_buffer,
+                                uint32_t    buf_len,
+                                uint32_t *  p_length);
 
 #endif // BLE_RPC_EVENT_ENCODER_GAP_H__
 
@@ -17,8 +17,16 @@
  *
  * Higher-level functions for writing to, and reading from, the UART.
  *
- * Lower-level functions are provided by hal_uart.h and its implementations,
- * which this module uses to obtain hardware indpendency.
+ * The module is built on the app_uart FIFO driver (app_uart_fifo.c).  Output is
+ * never blocking: each call to an output function is one message, which is either
+ * put in the TX FIFO as a whole and transmitted from the UART interrupt, or, if
+ * the FIFO does not have room for it, dropped and counted, see 
+ * console_dropped_count_get().  Logging therefore changes the timing of the 
+ * application as little as possible.  Input functions wait for the requested 
+ * characters.
+ *
+ * Numbers are converted to decimal by subtracting powers of ten, without division,
+ * as the Cortex-M0 has no divide instruction.
  *
  * Before the other functions of this module is used, the module must be initialized
  * by calling console_init().
@@ -66,14 +74,15 @@
  * The module may be configured by the use of suitable defines.  To change the newline style
  * used, define CONSOLE_NEWLINE_INPUT and CONSOLE_NEWLINE_OUTPUT to suitable values.  (See 
  * this file (console.h) for possible values.)  To enable echoing of input to output, define
- * CONSOLE_ENABLE_ECHO.
+ * CONSOLE_ENABLE_ECHO.  The size of the UART FIFOs, the baud rate and the UART interrupt
+ * priority are set by CONSOLE_TX_BUF_SIZE, CONSOLE_RX_BUF_SIZE, CONSOLE_BAUDRATE and
+ * CONSOLE_IRQ_PRIORITY, and the UART pins are taken from boards.h.
  *
  * \section console_note Note
  * 
- * The console functions that access the UART driver will enable the rewired
- * interrupts for the driver.  This ensures that the driver will not stall and
- * lock the program.  The interrupts will be restored to their former value
- * before returning to the caller in each instance that this is used.
+ * The output functions must all be called from the same interrupt level, or from 
+ * the main context only.  The console uses UART0 and its interrupt through app_uart,
+ * so it can not be used together with other users of the UART.
  *
  */
 
@@ -82,6 +91,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "nrf.h"
+#include "app_util.h"
 
 /* Newline character sequences */
 #define CONSOLE_NEWLINE_CRLF          "\r\n" //!< CRLF newline 
@@ -105,12 +116,35 @@
   #define CONSOLE_NEWLINE_OUTPUT     CONSOLE_NEWLINE_DEFAULT //!< Newline style for output 
 #endif
 
+/* Size of the UART FIFOs, must be powers of two */
+#ifndef CONSOLE_TX_BUF_SIZE
+  #define CONSOLE_TX_BUF_SIZE        256   //!< Size of the TX FIFO, bounds the output which can be pending
+#endif
+
+#ifndef CONSOLE_RX_BUF_SIZE
+  #define CONSOLE_RX_BUF_SIZE        16    //!< Size of the RX FIFO
+#endif
+
+#ifndef CONSOLE_BAUDRATE
+  #define CONSOLE_BAUDRATE           UART_BAUDRATE_BAUDRATE_Baud19200 //!< UART baud rate
+#endif
+
+#ifndef CONSOLE_IRQ_PRIORITY
+  #define CONSOLE_IRQ_PRIORITY       APP_IRQ_PRIORITY_LOW //!< Priority of the UART interrupt
+#endif
+
+#ifndef CONSOLE_PRINTF_BUF_SIZE
+  #define CONSOLE_PRINTF_BUF_SIZE    64    //!< Longest message console_printf() produces, longer output is truncated
+#endif
+
 /** 
  * @brief Function for initializing the console.
  * Init must be called prior to any other console functions.
  * The success of init() can be tested using the console_available() function.
  * console_init() is idempotent (can be called multiple times)
  * \post Interrupts required for the console I/O device (UART) are enabled.
+ * \note If the initialization fails, e.g. because the GPIOTE module has no room for
+ * another user, the console stays unavailable and all output is discarded.
 */
 void console_init(void);
 
@@ -196,10 +230,9 @@ void console_get_string(uint8_t * string, uint8_t num_chars);
  */
 void console_get_line(uint8_t * string, uint8_t max_len);
 
-/** \brief Function for getting number of characters sent to console.
- *
+/** \brief Function for testing if a character has been received.
  *
- * \return Number of characters (0..255)
+ * \return true if a character can be read without waiting.
 */
 bool console_chars_available(void);
 
@@ -214,9 +247,6 @@ void console_get_chars(uint8_t * chars, uint8_t num_chars);
 
 /** \brief Function for writing a single character (octet).
  *
- * This function is nothing but a direct wrapper for hal_uart_putchar().
- * It is provided here for completeness only.  You may consider to use
- * hal_uart_putchar() directly instead.
  * \param ch Character to write
  * \pre only works if init() previously called
  */
@@ -225,9 +255,8 @@ void console_put_char(uint8_t ch);
 
 /** \brief Function for reading a single character (octet).
  *
- * This function is a wrapper for hal_uart_getchar(), with the additional opption
- * of echo of input to output (if the console module is so configured, see the 
- * module documentation).
+ * Waits for a character, with the additional option of echo of input to output 
+ * (if the console module is so configured, see the module documentation).
  * \pre only works if init() previously called
  * \return Read character
  */
@@ -236,9 +265,6 @@ uint8_t console_get_char(void);
 
 /** \brief Function for printing the decimal ASCII representation of an 8-bit number.
  * 
- * \warning: This function is larger and more complex than the corresponding
- * functions to write hexadecimal representations.
- *
  * \param b Number in the range [0 255]
  * \pre only works if init() previously called
  */
@@ -247,9 +273,6 @@ void console_put_decbyte(uint8_t b);
 
 /** \brief Function for printing the decimal ASCII representation of a 16-bit number.
  * 
- * \warning: This function is larger and more complex than the corresponding
- * functions to write hexadecimal representations.
- *
  * \param w Number in the range [0 65535]
  * \pre only works if init() previously called
  */
@@ -258,9 +281,6 @@ void console_put_decword(uint16_t w);
 
 /** \brief Function for printing the decimal ASCII representation of a 32-bit number.
  * 
- * \warning: This function is larger and more complex than the corresponding
- * functions to write hexadecimal representations.
- *
  * \param ww Number in the range [0 4294967295]
  * \pre only works if init() previously called
  */
@@ -339,5 +359,24 @@ uint16_t console_get_hexword(void);
  */
 bool console_tx_completed(void);
 
+/** \brief Function for printing formatted output.
+ *
+ * A small subset of printf().  Supported conversions are %d, %i, %u, %x, %X, %c, %s
+ * and %%, with an optional '0' flag and field width, e.g. "%08X".  A 'l' length 
+ * modifier is accepted and ignored, all integers are 32 bits.
+ *
+ * The output is one message, and is truncated to CONSOLE_PRINTF_BUF_SIZE characters.
+ *
+ * \param[in] p_format Format string.
+ * \pre only works if init() previously called
+ */
+void console_printf(char const * p_format, ...);
+
+/** \brief Function for getting the number of messages dropped because the TX FIFO was full.
+ *
+ * \return Number of dropped messages since console_init().
+ */
+uint32_t console_dropped_count_get(void);
+
 #endif
 
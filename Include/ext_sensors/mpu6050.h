@@ -28,6 +28,34 @@
 * @brief MPU6050 gyro/accelerometer driver.
 */
 
+#define MPU6050_INT_MOTION        (0x40U)  //!< INT_STATUS bit, motion above the threshold detected.
+#define MPU6050_INT_FIFO_OVERFLOW (0x10U)  //!< INT_STATUS bit, the FIFO overflowed and lost its oldest samples.
+
+#define MPU6050_FIFO_SIZE         (1024U)  //!< Size of the FIFO in bytes.
+#define MPU6050_ACCEL_SAMPLE_SIZE (6U)     //!< Size of an accelerometer sample in the FIFO: X, Y, Z, 16 bit big endian.
+#define MPU6050_ACCEL_LSB_PER_G   (16384U) //!< Accelerometer sensitivity in the +-2 g range of the motion mode.
+
+/**
+ * @brief Rate at which the accelerometer wakes up in motion mode.
+ */
+typedef enum
+{
+  MPU6050_WAKE_FREQ_1_25_HZ, //!< 1.25 Hz.
+  MPU6050_WAKE_FREQ_5_HZ,    //!< 5 Hz.
+  MPU6050_WAKE_FREQ_20_HZ,   //!< 20 Hz.
+  MPU6050_WAKE_FREQ_40_HZ    //!< 40 Hz.
+} mpu6050_wake_freq_t;
+
+/**
+ * @brief Motion mode configuration.
+ */
+typedef struct
+{
+  uint8_t             motion_threshold;   //!< MOT_THR, high pass filtered acceleration to exceed, 2 mg per LSB.
+  uint8_t             motion_duration_ms; //!< MOT_DUR, time the threshold must be exceeded, 1 ms per LSB.
+  mpu6050_wake_freq_t wake_freq;          //!< Accelerometer wake up rate, also the FIFO sample rate.
+} mpu6050_motion_config_t;
+
 /**
  * @brief Function for initializing MPU6050 and verifies it's on the bus.
  *
@@ -65,6 +93,66 @@ bool mpu6050_register_read(uint8_t register_address, uint8_t *destination, uint8
 */
 bool mpu6050_verify_product_id(void);
 
+/**
+  @brief Function for putting the MPU6050 in low power motion mode.
+  The gyros and the temperature sensor are put in standby, and the accelerometer wakes up at
+  wake_freq. Each accelerometer sample goes to the FIFO, which is reset first.
+  The INT pin goes high, push-pull, on motion and on FIFO overflow, and stays high until
+  INT_STATUS is read, see @ref mpu6050_int_status_read.
+  The MPU6050 has no FIFO watermark interrupt, the FIFO must be drained within
+  MPU6050_FIFO_SIZE / MPU6050_ACCEL_SAMPLE_SIZE samples to keep all of them.
+  @param[in] p_config Motion mode configuration
+  @retval true Motion mode enabled
+  @retval false Register write failed
+*/
+bool mpu6050_motion_mode_enable(const mpu6050_motion_config_t * p_config);
+
+/**
+  @brief Function for reading and clearing the interrupt status.
+  @param[out] p_status INT_STATUS, see MPU6050_INT_MOTION and MPU6050_INT_FIFO_OVERFLOW
+  @retval true Register read succeeded
+  @retval false Register read failed
+*/
+bool mpu6050_int_status_read(uint8_t * p_status);
+
+/**
+  @brief Function for draining the accelerometer samples from the FIFO.
+  Reads the FIFO count, then as many whole samples as fit in the buffer, in bursts of up to 42
+  samples. Samples left in the FIFO are read by the next call.
+  @param[out] p_data Buffer for the samples, see MPU6050_ACCEL_SAMPLE_SIZE
+  @param[in]  max_samples Number of samples that fit in the buffer
+  @param[out] p_sample_count Number of samples read
+  @retval true FIFO read succeeded
+  @retval false FIFO read failed
+*/
+bool mpu6050_fifo_accel_read(uint8_t * p_data, uint16_t max_samples, uint16_t * p_sample_count);
+
+/**
+ * @brief FIFO drain completion handler type, see @ref mpu6050_fifo_drain_start.
+ *
+ * Called from the TWI interrupt.
+ *
+ * @param success      true if all reads succeeded.
+ * @param int_status   INT_STATUS, 0 if it could not be read.
+ * @param sample_count Number of samples read into the buffer.
+ */
+typedef void (*mpu6050_fifo_handler_t)(bool success, uint8_t int_status, uint16_t sample_count);
+
+/**
+  @brief Function for reading and clearing the interrupt status, and draining the accelerometer
+  samples from the FIFO, in the background.
+  The reads run as TWI transfer lists, see @ref twi_master_xfer_list_start, so the CPU can sleep
+  during the burst: INT_STATUS and the FIFO count first, then as many whole samples as fit in the
+  buffer, in bursts of up to 42 samples. Samples left in the FIFO are read by the next drain.
+  @note Needs the hardware TWI master, twi_hw_master.c.
+  @param[out] p_data Buffer for the samples, see MPU6050_ACCEL_SAMPLE_SIZE. Must stay valid until the handler is called.
+  @param[in]  max_samples Number of samples that fit in the buffer, at most MPU6050_FIFO_SIZE / MPU6050_ACCEL_SAMPLE_SIZE
+  @param[in]  handler Function to call when the drain is done
+  @retval true Drain started
+  @retval false A transfer list is running, or the bus is stuck
+*/
+bool mpu6050_fifo_drain_start(uint8_t * p_data, uint16_t max_samples, mpu6050_fifo_handler_t handler);
+
 /**
  *@}
  **/
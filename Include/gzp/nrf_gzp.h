@@ -52,6 +52,33 @@
 
 #define GZP_HOST_RX_POWER_THRESHOLD -64 ///< RSSI threshold for when signal strength in RX packet power is high enough.
 
+#if !defined(GZP_CRYPT_DISABLE) && !defined(GZP_CHANNEL_ADAPT_DISABLE)
+  #define GZP_CHANNEL_ADAPT_ENABLE        ///< Replace channels that keep failing. Needs encryption, which authenticates the change.
+#endif
+
+#ifndef GZP_CHANNEL_FAIL_THRESHOLD
+  #define GZP_CHANNEL_FAIL_THRESHOLD 128  ///< Average failure rate of a channel, in 1/256 units, above which the Device replaces it.
+#endif
+
+#ifndef GZP_CHANNEL_MIN_VISITS
+  #define GZP_CHANNEL_MIN_VISITS 16       ///< Number of visits to a channel before it is judged.
+#endif
+
+#ifndef GZP_CHANNEL_BLOCK_WIDTH
+  #define GZP_CHANNEL_BLOCK_WIDTH 8       ///< Channels on each side of a replaced channel that are not used either. A Wi-Fi channel is 20 MHz wide.
+#endif
+
+#ifndef GZP_CHANNEL_LOG_ENTRIES
+  #define GZP_CHANNEL_LOG_ENTRIES 64      ///< Channel updates kept in flash, on the Host and on each Device. A Host with a full log takes no more updates.
+#endif
+
+#if(GZP_CHANNEL_LOG_ENTRIES > 254)
+  #error GZP_CHANNEL_LOG_ENTRIES must be less than 255, the channel table generation is one byte.
+#endif
+
+#define GZP_CHANNEL_FAIL_SHIFT 3          ///< Weight of the latest visit in the failure rate, 1/2^n.
+#define GZP_CHANNEL_NONE 0xFF             ///< No channel table slot or channel.
+
 /** @} */
 
 
@@ -101,6 +128,17 @@
 
 #define GZP_CMD_FETCH_RESP_PAYLOAD_LENGTH 1    ///< General "fetch response" packet, payload_length
 
+#define GZP_CMD_CHANNEL_UPDATE_VALIDATION_ID 1  ///< "Channel update" packet, validation ID position
+#define GZP_CMD_CHANNEL_UPDATE_GENERATION (GZP_CMD_CHANNEL_UPDATE_VALIDATION_ID + GZP_VALIDATION_ID_LENGTH) ///< "Channel update" packet, generation position
+#define GZP_CMD_CHANNEL_UPDATE_SLOT (GZP_CMD_CHANNEL_UPDATE_GENERATION + 1)         ///< "Channel update" packet, channel table slot position
+#define GZP_CMD_CHANNEL_UPDATE_CHANNEL (GZP_CMD_CHANNEL_UPDATE_SLOT + 1)            ///< "Channel update" packet, new channel position
+#define GZP_CMD_CHANNEL_UPDATE_PAYLOAD_LENGTH (GZP_CMD_CHANNEL_UPDATE_CHANNEL + 1)  ///< "Channel update" packet, payload length
+
+#define GZP_CMD_CHANNEL_SYNC_VALIDATION_ID 1    ///< "Channel sync" packet, validation ID position
+#define GZP_CMD_CHANNEL_SYNC_GENERATION (GZP_CMD_CHANNEL_SYNC_VALIDATION_ID + GZP_VALIDATION_ID_LENGTH) ///< "Channel sync" packet, generation position
+#define GZP_CMD_CHANNEL_SYNC_SLOT (GZP_CMD_CHANNEL_SYNC_GENERATION + 1)             ///< "Channel sync" packet, channel table slot position
+#define GZP_CMD_CHANNEL_SYNC_PAYLOAD_LENGTH (GZP_CMD_CHANNEL_SYNC_SLOT + 1)         ///< "Channel sync" packet, payload length
+
 /** @} */
 
 
@@ -138,12 +176,35 @@
 
 #define GZP_CMD_ENCRYPTED_USER_DATA_RESP_SESSION_TOKEN 1      ///< "Encrypted user data" response packet, session token position
 #define GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID (GZP_CMD_ENCRYPTED_USER_DATA_RESP_SESSION_TOKEN + GZP_SESSION_TOKEN_LENGTH) ///< "Encrypted user data" response packet, validation ID position
-#define GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH (GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID + GZP_VALIDATION_ID_LENGTH) ///< "Encrypted user data" response packet, payload length position
+#define GZP_CMD_ENCRYPTED_USER_DATA_RESP_GENERATION (GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID + GZP_VALIDATION_ID_LENGTH) ///< "Encrypted user data" response packet, channel table generation position
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+#define GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH (GZP_CMD_ENCRYPTED_USER_DATA_RESP_GENERATION + 1) ///< "Encrypted user data" response packet, payload length position
+#else
+#define GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH GZP_CMD_ENCRYPTED_USER_DATA_RESP_GENERATION ///< "Encrypted user data" response packet, payload length position
+#endif
 
 #if(GZP_MAX_ACK_PAYLOAD_LENGTH < GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH)
   #error GZP_MAX_ACK_PAYLOAD_LENGTH must be greater or equal to GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH.
 #endif
 
+#define GZP_CMD_CHANNEL_UPDATE_RESP_SESSION_TOKEN 1      ///< "Channel update" response packet, session token position
+#define GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID (GZP_CMD_CHANNEL_UPDATE_RESP_SESSION_TOKEN + GZP_SESSION_TOKEN_LENGTH) ///< "Channel update" response packet, validation ID position
+#define GZP_CMD_CHANNEL_UPDATE_RESP_GENERATION (GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID + GZP_VALIDATION_ID_LENGTH)    ///< "Channel update" response packet, generation position
+#define GZP_CMD_CHANNEL_UPDATE_RESP_PAYLOAD_LENGTH (GZP_CMD_CHANNEL_UPDATE_RESP_GENERATION + 1)                          ///< "Channel update" response packet, payload length
+
+#if(defined(GZP_CHANNEL_ADAPT_ENABLE) && (GZP_MAX_ACK_PAYLOAD_LENGTH < GZP_CMD_CHANNEL_UPDATE_RESP_PAYLOAD_LENGTH))
+  #error GZP_MAX_ACK_PAYLOAD_LENGTH must be greater or equal to GZP_CMD_CHANNEL_UPDATE_RESP_PAYLOAD_LENGTH, or GZP_CHANNEL_ADAPT_DISABLE be defined.
+#endif
+
+#define GZP_CMD_CHANNEL_SYNC_RESP_SESSION_TOKEN 1        ///< "Channel sync" response packet, session token position
+#define GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID (GZP_CMD_CHANNEL_SYNC_RESP_SESSION_TOKEN + GZP_SESSION_TOKEN_LENGTH)  ///< "Channel sync" response packet, validation ID position
+#define GZP_CMD_CHANNEL_SYNC_RESP_CHANNEL (GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID + GZP_VALIDATION_ID_LENGTH)       ///< "Channel sync" response packet, channel position, GZP_CHANNEL_NONE if the generation moved on
+#define GZP_CMD_CHANNEL_SYNC_RESP_PAYLOAD_LENGTH (GZP_CMD_CHANNEL_SYNC_RESP_CHANNEL + 1)                             ///< "Channel sync" response packet, payload length
+
+#if(defined(GZP_CHANNEL_ADAPT_ENABLE) && (GZP_MAX_ACK_PAYLOAD_LENGTH < GZP_CMD_CHANNEL_SYNC_RESP_PAYLOAD_LENGTH))
+  #error GZP_MAX_ACK_PAYLOAD_LENGTH must be greater or equal to GZP_CMD_CHANNEL_SYNC_RESP_PAYLOAD_LENGTH, or GZP_CHANNEL_ADAPT_DISABLE be defined.
+#endif
+
 #if(GZP_VALIDATION_ID_LENGTH > GZP_HOST_ID_LENGTH)
   #error GZP_HOST_ID_LENGTH should be greater or equal to GZP_VALIDATION_ID_LENGTH.
 #endif
@@ -197,6 +258,10 @@ typedef enum
   GZP_CMD_HOST_ID_FETCH_RESP,       ///< Host ID fetch response
   GZP_CMD_KEY_UPDATE_PREPARE_RESP,  ///< Key update prepare 
   GZP_CMD_ENCRYPTED_USER_DATA_RESP, ///< Encrypted user data response
+  GZP_CMD_CHANNEL_UPDATE,           ///< Channel update
+  GZP_CMD_CHANNEL_UPDATE_RESP,      ///< Channel update response
+  GZP_CMD_CHANNEL_SYNC,             ///< Channel sync
+  GZP_CMD_CHANNEL_SYNC_RESP,        ///< Channel sync response
 } gzp_cmd_t;
 
 
@@ -288,6 +353,9 @@ void gzp_crypt_select_key(gzp_key_select_t key_select);
  *  AES is a symmetric encryption scheme, this function can be used
  * to perform both encryption and decryption.
  *
+ * The encrypted IV is cached per key-set, so the ECB peripheral only runs
+ * when the key or the session token has changed since the last call.
+ *
  * @param dst Destination to write encrypted data to. Should be 16 bytes long.
  * @param src Source data to encrypt.
  * @param length Length in bytes of src.
@@ -352,6 +420,22 @@ bool gzp_update_radio_params(const uint8_t *system_address);
 void gzp_generate_channels(uint8_t *ch_dst, const uint8_t * address, uint8_t channel_set_size);
 
 
+/**
+ * Replace one channel of the Gazell channel table.
+ *
+ * The first and last slots keep GZP_CHANNEL_LOW and GZP_CHANNEL_HIGH, as 
+ * Devices that are not paired yet only share those with the Host.
+ * Gazell is disabled during the update and enabled again if it was enabled.
+ *
+ * @param slot Position in the channel table.
+ * @param channel New channel, between GZP_CHANNEL_MIN and GZP_CHANNEL_MAX.
+ *
+ * @retval true  If the channel table was updated.
+ * @retval false If the slot or channel was invalid, or the update failed.
+ */
+bool gzp_update_channel(uint8_t slot, uint8_t channel);
+
+
 /**
  * Perform an XOR on two byte strings.
  *
@@ -359,6 +443,8 @@ void gzp_generate_channels(uint8_t *ch_dst, const uint8_t * address, uint8_t cha
  * @param src
  * @param pad 
  * @param length Number of bytes to perform the XOR operation on. 
+ *
+ * Works on 32 bit words when dst, src and pad have the same alignment.
  */
 void gzp_xor_cipher(uint8_t* dst, const uint8_t* src, const uint8_t* pad, uint8_t length);
 
@@ -375,6 +461,10 @@ void gzp_xor_cipher(uint8_t* dst, const uint8_t* src, const uint8_t* pad, uint8_
  * This function must be called before any of the other Gazell Pairing Library functions are 
  * used and must be called @b after gzll_init() is called. 
  *
+ * On a Device, NV memory written with another layout, e.g. by a firmware without 
+ * channel adaptation, is converted on the first call. This erases and rewrites 
+ * the parameters page once, keeping the pairing.
+ *
  */
 void gzp_init(void);
 
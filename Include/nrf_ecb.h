@@ -1,13 +1,13 @@
 /* Copyright (c) 2012 Nordic Semiconductor. All Rights Reserved.
  *
- * The information contained herein is confidential property of Nordic 
- * Semiconductor ASA.Terms and conditions of usage are described in detail 
- * in NORDIC SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT. 
+ * The information contained herein is confidential property of Nordic
+ * Semiconductor ASA.Terms and conditions of usage are described in detail
+ * in NORDIC SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
  *
  * Licensees are granted free, non-transferable use of the information. NO
  * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
  * the file.
- *              
+ *
  * $LastChangedRevision: 13999 $
  */
 
@@ -27,26 +27,85 @@
  *
  * In order to encrypt and decrypt data the peripheral must be powered on
  * using nrf_ecb_init() and then the key set using nrf_ecb_set_key.
+ *
+ * Batches of blocks are encrypted by jobs. Jobs are queued with
+ * nrf_ecb_job_submit() and run from the ECB interrupt, one block after the
+ * other, so the CPU can sleep or do other work meanwhile. Besides plain ECB,
+ * a job can generate a CTR mode keystream, optionally XOR'ed with data, or
+ * chain the blocks for a CBC-MAC. nrf_ecb_cmac() computes an AES-CMAC on top
+ * of this.
+ *
+ * The blocking functions sleep until their job is done. They may be called
+ * from any priority, also above the ECB interrupt.
+ *
+ * When built with a SoftDevice, BLE_STACK_SUPPORT_REQD or
+ * ANT_STACK_SUPPORT_REQD defined, the ECB peripheral is restricted. Each block
+ * is then encrypted by sd_ecb_block_encrypt() from the SWI3 interrupt, which
+ * the driver takes over at NRF_ECB_IRQ_PRIORITY through the sd_nvic_*()
+ * functions. The SoftDevice must be enabled before nrf_ecb_init(). The CPU
+ * runs during sd_ecb_block_encrypt(), but higher priorities are served between
+ * the blocks.
  */
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#ifndef NRF_ECB_IRQ_PRIORITY
+#define NRF_ECB_IRQ_PRIORITY  3     ///< Priority of the ECB interrupt, APP_IRQ_PRIORITY_LOW.
+#endif
+
+#define NRF_ECB_BLOCK_SIZE    16    ///< Size of an AES block and of an AES-128 key.
+
+/** Operation of an ECB job. */
+typedef enum
+{
+  NRF_ECB_MODE_ECB,                 ///< Encrypt each input block.
+  NRF_ECB_MODE_CTR,                 ///< Encrypt the counter, increment it, and XOR the result with the input.
+  NRF_ECB_MODE_CBC_MAC              ///< Encrypt each input block XOR'ed with the previous result.
+} nrf_ecb_mode_t;
+
+typedef struct nrf_ecb_job_s nrf_ecb_job_t;
+
+/**
+ * Handler called from the ECB interrupt when a job is done.
+ *
+ * @param p_job The job which is done.
+ */
+typedef void (*nrf_ecb_job_handler_t)(nrf_ecb_job_t * p_job);
+
+/**
+ * ECB job. Must stay in place, with its key and data, until it is done.
+ */
+struct nrf_ecb_job_s
+{
+  const uint8_t *       p_key;        ///< 16 byte key.
+  nrf_ecb_mode_t        mode;         ///< Operation of the job.
+  const uint8_t *       p_in;         ///< Input blocks. CTR: data to XOR with the keystream, NULL for the bare keystream.
+  uint8_t *             p_out;        ///< Output blocks, may be the same as p_in. CBC-MAC: 16 bytes, the MAC.
+  uint8_t *             p_chain;      ///< CTR: 16 byte counter, left at the next value. CBC-MAC: 16 byte IV.
+  uint16_t              block_count;  ///< Number of blocks.
+  nrf_ecb_job_handler_t handler;      ///< Called when the job is done, may be NULL.
+  volatile bool         done;         ///< Set by the driver when the job is done.
+  uint16_t              block;        ///< Internal, block being encrypted.
+  nrf_ecb_job_t *       p_next;       ///< Internal, next job in the queue.
+};
 
 /**
  * Initialize and power on the ECB peripheral.
  *
- * Allocates memory for the ECBDATAPTR.
+ * Sets the ECBDATAPTR and enables the ECB interrupt, or the SWI3 interrupt
+ * with a SoftDevice.
  * @retval true Initialization was successful.
- * @retval false Powering up failed.
+ * @retval false Powering up failed, or the SoftDevice refused the interrupt.
  */
 bool nrf_ecb_init(void);
 
 /**
  * Encrypt/decrypt 16-byte data using current key.
  *
- * The function avoids unnecessary copying of data if the point to the 
- * correct locations in the ECB data structure.
+ * Blocking, the CPU sleeps until the block is done.
  *
- * @param dst Result of encryption/decryption. 16 bytes will be written. 
+ * @param dst Result of encryption/decryption. 16 bytes will be written.
  * @param src Source with 16-byte data to be encrypted/decrypted.
  *
  * @retval true  If the encryption operation completed.
@@ -57,10 +116,49 @@ bool nrf_ecb_crypt(uint8_t * dst, const uint8_t * src);
 /**
  * Set the key to be used for encryption/decryption.
  *
+ * Only used by nrf_ecb_crypt(), jobs carry their own key.
+ *
  * @param key Pointer to key. 16 bytes will be read.
  */
 void nrf_ecb_set_key(const uint8_t * key);
 
+/**
+ * Queue a job.
+ *
+ * The job starts when the jobs queued before it are done. Its handler is
+ * called from the ECB interrupt.
+ *
+ * @param p_job Job to queue.
+ *
+ * @retval true  The job was queued.
+ * @retval false Not initialized, no blocks, or a CTR or CBC-MAC job without
+ *               p_chain.
+ */
+bool nrf_ecb_job_submit(nrf_ecb_job_t * p_job);
+
+/**
+ * Run a job and wait for it to be done.
+ *
+ * @param p_job Job to run. Its handler, if any, is called as well.
+ *
+ * @retval true  The job is done.
+ * @retval false The job is not valid, see nrf_ecb_job_submit().
+ */
+bool nrf_ecb_job_run(nrf_ecb_job_t * p_job);
+
+/**
+ * Compute an AES-CMAC (RFC 4493). Blocking.
+ *
+ * @param p_key Pointer to key. 16 bytes will be read.
+ * @param p_msg Message.
+ * @param len   Length of the message.
+ * @param p_mac Result. 16 bytes will be written, truncate as needed.
+ *
+ * @retval true  The MAC was computed.
+ * @retval false The ECB peripheral is not initialized.
+ */
+bool nrf_ecb_cmac(const uint8_t * p_key, const uint8_t * p_msg, uint32_t len, uint8_t * p_mac);
+
 #endif  // NRF_ECB_H__
 
 /** @} */
@@ -40,6 +40,10 @@
 #define TWI_ISSUE_STOP               ((bool)true)  //!< Parameter for @ref twi_master_transfer
 #define TWI_DONT_ISSUE_STOP          ((bool)false) //!< Parameter for @ref twi_master_transfer
 
+#ifndef TWI_MASTER_IRQ_PRIORITY
+#define TWI_MASTER_IRQ_PRIORITY      3             //!< Priority of the TWI interrupt used by @ref twi_master_xfer_list_start, APP_IRQ_PRIORITY_LOW.
+#endif
+
 /* These macros are needed to see if the slave is stuck and we as master send dummy clock cycles to end its wait */
 /*lint -e717 -save "Suppress do {} while (0) for these macros" */
 /*lint ++flb "Enter library region" */
@@ -91,6 +95,76 @@ bool twi_master_init(void);
  */
 bool twi_master_transfer(uint8_t address, uint8_t *data, uint8_t data_length, bool issue_stop_condition);
 
+/**
+ * @brief One transfer of a transfer list, see @ref twi_master_xfer_list_start.
+ */
+typedef struct
+{
+    uint8_t   address;              //!< Data transfer direction (LSB) / Slave address (7 MSBs), as for @ref twi_master_transfer.
+    uint8_t * p_data;               //!< Data to write, or where to store the data read.
+    uint8_t   data_length;          //!< Number of bytes to transfer, at least 1.
+    bool      issue_stop_condition; //!< @ref TWI_ISSUE_STOP or @ref TWI_DONT_ISSUE_STOP. Reads always end with a STOP condition.
+} twi_master_xfer_t;
+
+/**
+ * @brief Transfer list completion handler type.
+ *
+ * Called from the TWI interrupt.
+ *
+ * The handler may start the next list. After a failure, start it from thread context instead,
+ * e.g. through the scheduler, as the next transfer first recovers the bus, which takes a while.
+ *
+ * @param success   true if all transfers succeeded, false if one failed. The transfers after a failed one are not run.
+ * @param p_context Context given to @ref twi_master_xfer_list_start.
+ */
+typedef void (*twi_master_xfer_handler_t)(bool success, void * p_context);
+
+/**
+ * @brief Function for running a list of transfers in the background.
+ *
+ * The transfers run back to back from the TWI interrupt, so a burst read of several registers of
+ * several slaves takes one call and one completion. A write without STOP condition followed by a
+ * read is the usual register read, with a repeated start.
+ *
+ * @note Only provided by the hardware TWI master, twi_hw_master.c. @ref twi_master_transfer
+ *       fails while a list is running.
+ *
+ * @note twi_hw_master.c defines SPI1_TWI1_IRQHandler, the interrupt vector TWI1 shares with SPI1
+ *       and SPIS1. It can not be linked together with another driver of that vector, such as
+ *       spi_slave.c, and SPI1 is not available to the application.
+ *
+ * @param p_xfers   Transfers to run in order. Must stay valid until the handler is called.
+ * @param count     Number of transfers.
+ * @param handler   Function to call when the list is done.
+ * @param p_context Passed to the handler.
+ * @return
+ * @retval true The list was started.
+ * @retval false A list is running already, the list is empty, ends with a write without STOP
+ *               condition, or the bus is stuck.
+ */
+bool twi_master_xfer_list_start(const twi_master_xfer_t * p_xfers,
+                                uint8_t                   count,
+                                twi_master_xfer_handler_t handler,
+                                void *                    p_context);
+
+/**
+ * @brief Function for checking if a transfer list is running.
+ *
+ * @return
+ * @retval true A list is running.
+ * @retval false No list is running.
+ */
+bool twi_master_xfer_list_busy(void);
+
+/**
+ * @brief Function for stopping the running transfer list, e.g. when a slave holds the bus.
+ *
+ * The peripheral is stopped, and the handler of the list is not called. The bus is recovered by
+ * the next transfer. Must be called from the priority of the TWI interrupt, or with the interrupt
+ * blocked.
+ */
+void twi_master_xfer_list_abort(void);
+
 /**
  *@}
  **/
@@ -65,6 +65,29 @@ uint32_t app_fifo_get(app_fifo_t * p_fifo, uint8_t * p_byte)
     
 }
 
+uint32_t app_fifo_write(app_fifo_t * p_fifo, const uint8_t * p_data, uint16_t length)
+{
+    uint32_t write_pos = p_fifo->write_pos;
+    uint16_t i;
+
+    if (((uint32_t)p_fifo->buf_size_mask + 1 - FIFO_LENGTH) < length)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        p_fifo->p_buf[write_pos & p_fifo->buf_size_mask] = p_data[i];
+        write_pos++;
+    }
+
+    // Publish all bytes at once, after they have been stored.
+    p_fifo->write_pos = write_pos;
+
+    return NRF_SUCCESS;
+}
+
+
 uint32_t app_fifo_flush(app_fifo_t * p_fifo)
 {
     p_fifo->read_pos = p_fifo->write_pos;
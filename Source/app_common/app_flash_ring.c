@@ -0,0 +1,633 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_flash_ring.h"
+#include <string.h>
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "crc16.h"
+
+#define PAGE_MAGIC          0x46520000uL    /**< Upper half of the first page header word, the lower half holds the record data size. */
+#define RECORD_MARKER       0x5AA50000uL    /**< Upper half of a record header, the lower half holds the CRC16 of the data. */
+#define RECORD_MARKER_MSK   0xFFFF0000uL    /**< Mask for the marker of a record header. */
+#define RECORD_CRC_MSK      0x0000FFFFuL    /**< Mask for the CRC16 of a record header. */
+#define RECORD_EMPTY        0xFFFFFFFFuL    /**< Header of a slot which has not been written. */
+#define RECORD_DELETED      0x00000000uL    /**< Header of a deleted record. */
+
+static uint32_t m_record_deleted = RECORD_DELETED;  /**< Source of the writes deleting records. */
+
+
+/**@brief Function for getting the address of a page. */
+static __INLINE uint8_t * page_addr(const app_flash_ring_t * p_ring, uint16_t page)
+{
+    return (uint8_t *)(p_ring->storage.block_id + (uint32_t)page * p_ring->page_size);
+}
+
+
+/**@brief Function for getting the offset of a slot from the start of its page. */
+static __INLINE uint16_t slot_offset(const app_flash_ring_t * p_ring, uint16_t slot)
+{
+    return APP_FLASH_RING_PAGE_HEADER_SIZE + slot * p_ring->slot_size;
+}
+
+
+/**@brief Function for getting the header of a slot in flash. */
+static __INLINE uint32_t slot_header(const app_flash_ring_t * p_ring, uint16_t page, uint16_t slot)
+{
+    return *(uint32_t *)(page_addr(p_ring, page) + slot_offset(p_ring, slot));
+}
+
+
+/**@brief Function for reading the header of a page.
+ *
+ * @param[in]   p_ring    Flash ring instance.
+ * @param[in]   page      Page to read.
+ * @param[out]  p_seq     Sequence number of the page.
+ *
+ * @return      true if the page has a valid header.
+ */
+static bool page_header_read(const app_flash_ring_t * p_ring, uint16_t page, uint32_t * p_seq)
+{
+    uint32_t * p_header = (uint32_t *)page_addr(p_ring, page);
+
+    *p_seq = p_header[1];
+
+    return (p_header[0] == (PAGE_MAGIC | (p_ring->slot_size - APP_FLASH_RING_RECORD_HEADER_SIZE))) &&
+           (p_header[1] != RECORD_EMPTY);
+}
+
+
+/**@brief Function for getting the number of records in flash. */
+static uint32_t flash_count(const app_flash_ring_t * p_ring)
+{
+    if (p_ring->used_pages == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(p_ring->used_pages - 1) * p_ring->page_records +
+           p_ring->write_slot - p_ring->first_slot;
+}
+
+
+/**@brief Function for advancing the oldest record past one slot. */
+static void first_advance(app_flash_ring_t * p_ring)
+{
+    p_ring->removed_count++;
+    p_ring->first_slot++;
+    if (p_ring->first_slot == p_ring->page_records)
+    {
+        p_ring->first_page = (p_ring->first_page + 1) % p_ring->page_count;
+        p_ring->first_slot = 0;
+        p_ring->used_pages--;
+    }
+}
+
+
+/**@brief Function for removing the deleted records from the front of the ring.
+ *
+ * @details Staged records are only removed when none is being written, as the write reads the
+ *          staging buffer.
+ */
+static void front_trim(app_flash_ring_t * p_ring)
+{
+    while ((flash_count(p_ring) > 0) &&
+           (slot_header(p_ring, p_ring->first_page, p_ring->first_slot) == RECORD_DELETED))
+    {
+        first_advance(p_ring);
+    }
+
+    while ((flash_count(p_ring) == 0) && (p_ring->staged > 0) && (p_ring->in_flight == 0) &&
+           (*(uint32_t *)p_ring->p_buffer == RECORD_DELETED))
+    {
+        p_ring->removed_count++;
+        p_ring->staged--;
+        memmove(p_ring->p_buffer,
+                p_ring->p_buffer + p_ring->slot_size,
+                p_ring->staged * p_ring->slot_size);
+    }
+}
+
+
+/**@brief Function for finding the records already in flash.
+ *
+ * @details The newest page is the one with the highest sequence number, and the pages in use are
+ *          those before it with consecutive sequence numbers. As the slots of a page are written
+ *          in order, the first empty slot of the newest page is found by a binary search.
+ */
+static void ring_mount(app_flash_ring_t * p_ring)
+{
+    uint32_t newest_seq = 0;
+    uint16_t newest_page = 0;
+    bool     found       = false;
+    uint16_t page;
+    uint16_t lo;
+    uint16_t hi;
+
+    for (page = 0; page < p_ring->page_count; page++)
+    {
+        uint32_t seq;
+
+        if (page_header_read(p_ring, page, &seq) && (!found || ((int32_t)(seq - newest_seq) > 0)))
+        {
+            newest_seq  = seq;
+            newest_page = page;
+            found       = true;
+        }
+    }
+
+    p_ring->first_page = 0;
+    p_ring->first_slot = 0;
+    p_ring->used_pages = 0;
+    p_ring->write_slot = 0;
+
+    if (!found)
+    {
+        // Sequence number of the first page will be 0.
+        p_ring->page_header[1] = RECORD_EMPTY;
+        return;
+    }
+
+    p_ring->page_header[1] = newest_seq;
+    p_ring->used_pages     = 1;
+
+    page = newest_page;
+    while (p_ring->used_pages < p_ring->page_count)
+    {
+        uint16_t prev = (page + p_ring->page_count - 1) % p_ring->page_count;
+        uint32_t seq;
+
+        if (!page_header_read(p_ring, prev, &seq) || (seq != newest_seq - p_ring->used_pages))
+        {
+            break;
+        }
+        p_ring->used_pages++;
+        page = prev;
+    }
+    p_ring->first_page = page;
+
+    lo = 0;
+    hi = p_ring->page_records;
+    while (lo < hi)
+    {
+        uint16_t mid = lo + (hi - lo) / 2;
+
+        if (slot_header(p_ring, newest_page, mid) == RECORD_EMPTY)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    p_ring->write_slot = lo;
+
+    front_trim(p_ring);
+}
+
+
+/**@brief Function for dropping the oldest page, to make room for the next one. */
+static void oldest_page_drop(app_flash_ring_t * p_ring)
+{
+    p_ring->removed_count += p_ring->page_records - p_ring->first_slot;
+    p_ring->first_page     = (p_ring->first_page + 1) % p_ring->page_count;
+    p_ring->first_slot     = 0;
+    p_ring->used_pages--;
+}
+
+
+/**@brief Function for checking whether the staged records are to be written now. */
+static bool write_due(const app_flash_ring_t * p_ring)
+{
+    return (p_ring->staged > 0) &&
+           (p_ring->flush_pending                                                ||
+            (p_ring->staged >= p_ring->write_threshold)                          ||
+            (p_ring->used_pages == 0)                                            ||
+            (p_ring->staged >= (p_ring->page_records - p_ring->write_slot)));
+}
+
+
+/**@brief Function for checking whether a record in flash is to be marked as deleted now.
+ *
+ * @details Records of the range which were removed with their page meanwhile are passed over.
+ */
+static bool delete_due(app_flash_ring_t * p_ring)
+{
+    if (p_ring->delete_pos < p_ring->removed_count)
+    {
+        p_ring->delete_pos = MIN(p_ring->removed_count, p_ring->delete_end);
+    }
+    if ((p_ring->delete_pos < p_ring->delete_end) &&
+        (p_ring->delete_pos - p_ring->removed_count >= flash_count(p_ring)))
+    {
+        // Records of the range are only in flash when no write is in progress.
+        p_ring->delete_pos = p_ring->delete_end;
+    }
+
+    return (p_ring->delete_pos < p_ring->delete_end);
+}
+
+
+/**@brief Function for starting the next flash operation, if any.
+ *
+ * @details Pending deletions are done first, one record at a time. A new page is erased, unless it was erased ahead, and then started by writing its
+ *          header. Staged records are written when due. With erase-ahead, the page after the
+ *          current one is erased when there is nothing else to do.
+ */
+static void flash_process(app_flash_ring_t * p_ring)
+{
+    uint32_t          err_code;
+    pstorage_handle_t page_handle;
+    uint16_t          page;
+    bool              new_page;
+
+    if (p_ring->state != APP_FLASH_RING_STATE_IDLE)
+    {
+        return;
+    }
+    if (p_ring->staged == 0)
+    {
+        p_ring->flush_pending = false;
+    }
+
+    new_page = (p_ring->used_pages == 0) || (p_ring->write_slot == p_ring->page_records);
+
+    if (delete_due(p_ring))
+    {
+        uint32_t pos = p_ring->first_slot + (p_ring->delete_pos - p_ring->removed_count);
+
+        page = (p_ring->first_page + pos / p_ring->page_records) % p_ring->page_count;
+
+        err_code = pstorage_block_identifier_get(&p_ring->storage, page, &page_handle);
+        if (err_code == NRF_SUCCESS)
+        {
+            err_code = pstorage_store(&page_handle,
+                                      (uint8_t *)&m_record_deleted,
+                                      sizeof(m_record_deleted),
+                                      slot_offset(p_ring, pos % p_ring->page_records));
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+            p_ring->state = APP_FLASH_RING_STATE_DELETING;
+        }
+    }
+    else if (write_due(p_ring) && !new_page)
+    {
+        uint16_t count = MIN(p_ring->staged, p_ring->page_records - p_ring->write_slot);
+
+        page = (p_ring->first_page + p_ring->used_pages - 1) % p_ring->page_count;
+
+        err_code = pstorage_block_identifier_get(&p_ring->storage, page, &page_handle);
+        if (err_code == NRF_SUCCESS)
+        {
+            err_code = pstorage_store(&page_handle,
+                                      p_ring->p_buffer,
+                                      count * p_ring->slot_size,
+                                      slot_offset(p_ring, p_ring->write_slot));
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+            p_ring->in_flight = count;
+            p_ring->state     = APP_FLASH_RING_STATE_STORING;
+        }
+    }
+    else if ((write_due(p_ring) && new_page) ||
+             (p_ring->erase_ahead && (p_ring->used_pages > 0) &&
+              (p_ring->erased_page == APP_FLASH_RING_PAGE_INVALID)))
+    {
+        page = (p_ring->first_page + p_ring->used_pages) % p_ring->page_count;
+
+        if (new_page && (page == p_ring->erased_page))
+        {
+            p_ring->page_header[1]++;
+
+            err_code = pstorage_block_identifier_get(&p_ring->storage, page, &page_handle);
+            if (err_code == NRF_SUCCESS)
+            {
+                err_code = pstorage_store(&page_handle,
+                                          (uint8_t *)p_ring->page_header,
+                                          APP_FLASH_RING_PAGE_HEADER_SIZE,
+                                          0);
+            }
+            if (err_code == NRF_SUCCESS)
+            {
+                p_ring->state = APP_FLASH_RING_STATE_PAGE_HEADER;
+            }
+        }
+        else
+        {
+            // Erase the next page, dropping the oldest one if all pages are in use.
+            if (p_ring->used_pages == p_ring->page_count)
+            {
+                oldest_page_drop(p_ring);
+                page = (p_ring->first_page + p_ring->used_pages) % p_ring->page_count;
+            }
+
+            err_code = pstorage_block_identifier_get(&p_ring->storage, page, &page_handle);
+            if (err_code == NRF_SUCCESS)
+            {
+                err_code = pstorage_page_clear(&page_handle, 1);
+            }
+            if (err_code == NRF_SUCCESS)
+            {
+                p_ring->erased_page = APP_FLASH_RING_PAGE_INVALID;
+                p_ring->state       = APP_FLASH_RING_STATE_ERASING;
+            }
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    if ((err_code != NRF_SUCCESS) && (p_ring->error_handler != NULL))
+    {
+        p_ring->error_handler(err_code);
+    }
+}
+
+
+uint32_t app_flash_ring_init(app_flash_ring_t * p_ring, const app_flash_ring_init_t * p_init)
+{
+    uint32_t                err_code;
+    pstorage_module_param_t param;
+
+    if ((p_init->data_size == 0)                          ||
+        ((p_init->data_size % sizeof(uint32_t)) != 0)     ||
+        (p_init->page_count < 2)                          ||
+        (p_init->p_buffer == NULL)                        ||
+        (p_init->buffer_records == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_ring->error_handler   = p_init->error_handler;
+    p_ring->p_buffer        = (uint8_t *)p_init->p_buffer;
+    p_ring->buffer_records  = p_init->buffer_records;
+    p_ring->write_threshold = MAX(1, MIN(p_init->write_threshold, p_init->buffer_records));
+    p_ring->erase_ahead     = p_init->erase_ahead;
+    p_ring->flush_pending   = false;
+    p_ring->erased_page     = APP_FLASH_RING_PAGE_INVALID;
+    p_ring->delete_pos      = 0;
+    p_ring->delete_end      = 0;
+    p_ring->slot_size       = p_init->data_size + APP_FLASH_RING_RECORD_HEADER_SIZE;
+    p_ring->page_size       = PSTORAGE_FLASH_PAGE_SIZE;
+    p_ring->page_count      = p_init->page_count;
+    p_ring->page_records    = (p_ring->page_size - APP_FLASH_RING_PAGE_HEADER_SIZE) / p_ring->slot_size;
+    p_ring->staged          = 0;
+    p_ring->in_flight       = 0;
+    p_ring->state           = APP_FLASH_RING_STATE_IDLE;
+    p_ring->page_header[0]  = PAGE_MAGIC | p_init->data_size;
+
+    if (p_ring->page_records == 0)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    param.cb          = p_init->pstorage_cb;
+    param.block_size  = p_ring->page_size;
+    param.block_count = p_ring->page_count;
+
+    err_code = pstorage_register(&param, &p_ring->storage);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    ring_mount(p_ring);
+    p_ring->removed_count = 0;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_flash_ring_count_get(const app_flash_ring_t * p_ring)
+{
+    return flash_count(p_ring) + p_ring->staged;
+}
+
+
+uint32_t app_flash_ring_removed_count_get(const app_flash_ring_t * p_ring)
+{
+    return p_ring->removed_count;
+}
+
+
+void app_flash_ring_flush(app_flash_ring_t * p_ring)
+{
+    p_ring->flush_pending = true;
+    flash_process(p_ring);
+}
+
+
+uint32_t app_flash_ring_add(app_flash_ring_t * p_ring, const uint8_t * p_data)
+{
+    uint16_t   data_size = p_ring->slot_size - APP_FLASH_RING_RECORD_HEADER_SIZE;
+    uint8_t *  p_slot;
+
+    if (p_ring->staged == p_ring->buffer_records)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_slot = p_ring->p_buffer + p_ring->staged * p_ring->slot_size;
+
+    *(uint32_t *)p_slot = RECORD_MARKER | crc16_compute(p_data, data_size, NULL);
+    memcpy(p_slot + APP_FLASH_RING_RECORD_HEADER_SIZE, p_data, data_size);
+    p_ring->staged++;
+
+    flash_process(p_ring);
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_flash_ring_get(const app_flash_ring_t * p_ring,
+                            uint32_t                 index,
+                            const uint8_t **         pp_data)
+{
+    uint32_t  count = flash_count(p_ring);
+    uint8_t * p_slot;
+    uint32_t  header;
+
+    if ((p_ring->removed_count + index >= p_ring->delete_pos) &&
+        (p_ring->removed_count + index < p_ring->delete_end))
+    {
+        // Being deleted.
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    if (index < count)
+    {
+        uint32_t pos = p_ring->first_slot + index;
+
+        p_slot = page_addr(p_ring, (p_ring->first_page + pos / p_ring->page_records) % p_ring->page_count) +
+                 slot_offset(p_ring, pos % p_ring->page_records);
+    }
+    else if (index < count + p_ring->staged)
+    {
+        p_slot = p_ring->p_buffer + (index - count) * p_ring->slot_size;
+    }
+    else
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    header   = *(uint32_t *)p_slot;
+    *pp_data = p_slot + APP_FLASH_RING_RECORD_HEADER_SIZE;
+
+    if (((header & RECORD_MARKER_MSK) != RECORD_MARKER) ||
+        ((header & RECORD_CRC_MSK) != crc16_compute(*pp_data,
+                                                    p_ring->slot_size - APP_FLASH_RING_RECORD_HEADER_SIZE,
+                                                    NULL)))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_flash_ring_lower_bound(const app_flash_ring_t * p_ring,
+                                    app_flash_ring_cmp_t     cmp,
+                                    const void *             p_key)
+{
+    uint32_t lo = 0;
+    uint32_t hi = app_flash_ring_count_get(p_ring);
+
+    while (lo < hi)
+    {
+        uint32_t        mid   = lo + (hi - lo) / 2;
+        uint32_t        probe = mid;
+        const uint8_t * p_data;
+
+        // Pass over corrupt records.
+        while ((probe < hi) && (app_flash_ring_get(p_ring, probe, &p_data) != NRF_SUCCESS))
+        {
+            probe++;
+        }
+
+        if ((probe < hi) && (cmp(p_data, p_key) < 0))
+        {
+            lo = probe + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+
+uint32_t app_flash_ring_delete(app_flash_ring_t * p_ring, uint32_t index, uint32_t count)
+{
+    uint32_t written = flash_count(p_ring) + p_ring->in_flight;
+    uint32_t total   = flash_count(p_ring) + p_ring->staged;
+    uint32_t end;
+    uint32_t i;
+
+    if (p_ring->delete_pos < p_ring->delete_end)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if ((index >= total) || (count == 0))
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    end = index + MIN(count, total - index);
+
+    // Records in flash, or being written to it, are marked in flash by flash_process.
+    if (index < written)
+    {
+        p_ring->delete_pos = p_ring->removed_count + index;
+        p_ring->delete_end = p_ring->removed_count + MIN(end, written);
+    }
+
+    // Records not written yet are marked in the staging buffer, and written as deleted.
+    for (i = MAX(index, written); i < end; i++)
+    {
+        *(uint32_t *)(p_ring->p_buffer + (i - flash_count(p_ring)) * p_ring->slot_size) = RECORD_DELETED;
+    }
+
+    front_trim(p_ring);
+    flash_process(p_ring);
+
+    return NRF_SUCCESS;
+}
+
+
+void app_flash_ring_on_pstorage_evt(app_flash_ring_t * p_ring,
+                                    uint8_t            op_code,
+                                    uint32_t           result,
+                                    uint8_t *          p_data)
+{
+    UNUSED_PARAMETER(p_data);
+
+    if ((result != NRF_SUCCESS) && (p_ring->error_handler != NULL))
+    {
+        p_ring->error_handler(result);
+    }
+
+    switch (p_ring->state)
+    {
+        case APP_FLASH_RING_STATE_ERASING:
+            if (result == NRF_SUCCESS)
+            {
+                p_ring->erased_page = (p_ring->first_page + p_ring->used_pages) % p_ring->page_count;
+            }
+            // Otherwise the erase is tried again.
+            p_ring->state = APP_FLASH_RING_STATE_IDLE;
+            break;
+
+        case APP_FLASH_RING_STATE_PAGE_HEADER:
+            if (result == NRF_SUCCESS)
+            {
+                if (p_ring->used_pages == 0)
+                {
+                    p_ring->first_slot = 0;
+                }
+                p_ring->used_pages++;
+                p_ring->write_slot  = 0;
+            }
+            p_ring->erased_page = APP_FLASH_RING_PAGE_INVALID;
+            p_ring->state       = APP_FLASH_RING_STATE_IDLE;
+            break;
+
+        case APP_FLASH_RING_STATE_STORING:
+            // Even a failed write is not repeated, as flash must not be written twice. Records
+            // torn by the failure are reported as corrupt.
+            p_ring->write_slot += p_ring->in_flight;
+            p_ring->staged     -= p_ring->in_flight;
+            memmove(p_ring->p_buffer,
+                    p_ring->p_buffer + p_ring->in_flight * p_ring->slot_size,
+                    p_ring->staged * p_ring->slot_size);
+            p_ring->in_flight = 0;
+            p_ring->state     = APP_FLASH_RING_STATE_IDLE;
+            break;
+
+        case APP_FLASH_RING_STATE_DELETING:
+            // A failed deletion is not repeated either, the record is then mounted again.
+            p_ring->delete_pos++;
+            p_ring->state = APP_FLASH_RING_STATE_IDLE;
+            break;
+
+        default:
+            // No implementation needed.
+            return;
+    }
+
+    front_trim(p_ring);
+    flash_process(p_ring);
+}
@@ -0,0 +1,146 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_trace.h"
+#include <stdlib.h>
+#include "nrf.h"
+#include "nrf_error.h"
+#include "app_util.h"
+
+// The ring indices are masked, so the size must be a power of two.
+STATIC_ASSERT(IS_POWER_OF_TWO(APP_TRACE_BUF_WORDS));
+
+#define RING_MASK           (APP_TRACE_BUF_WORDS - 1)                   /**< Mask for turning a position into a ring index. */
+#define TIMESTAMP_WORDS     ((APP_TRACE_TIMESTAMP_ENABLED) ? 1 : 0)     /**< Number of timestamp words in a record. */
+#define RECORD_WORDS_MAX    (1 + 1 + APP_TRACE_ARGS_MAX)                /**< Largest record: header, timestamp and arguments. */
+
+static uint32_t          m_ring[APP_TRACE_BUF_WORDS];                  /**< Trace ring. */
+static uint32_t          m_write_pos;                                   /**< Position of the next record, free running. */
+static uint32_t          m_read_pos;                                    /**< Position of the oldest record, free running. */
+static uint8_t           m_seq;                                         /**< Sequence number of the next record. */
+static uint32_t          m_dropped_count;                               /**< Number of records dropped because the ring was full. */
+static app_trace_sink_t  m_sink;                                        /**< Sink the ring is drained to, NULL if none. */
+
+
+/**@brief Function for getting the number of words of a record from its header. */
+static __INLINE uint32_t record_words(uint32_t header)
+{
+    uint32_t words = 1 + ((header & APP_TRACE_HDR_ARGC_MSK) >> APP_TRACE_HDR_ARGC_POS);
+
+    if ((header & APP_TRACE_HDR_TIMESTAMP_MSK) != 0)
+    {
+        words++;
+    }
+    return words;
+}
+
+
+/**@brief Function for discarding the oldest records until there is room for a new record.
+ *
+ * @param[in]   words   Number of words needed.
+ */
+static void oldest_discard(uint32_t words)
+{
+    while ((APP_TRACE_BUF_WORDS - (m_write_pos - m_read_pos)) < words)
+    {
+        m_read_pos += record_words(m_ring[m_read_pos & RING_MASK]);
+        m_dropped_count++;
+    }
+}
+
+
+void app_trace_init(app_trace_sink_t sink)
+{
+    m_sink          = sink;
+    m_write_pos     = 0;
+    m_read_pos      = 0;
+    m_seq           = 0;
+    m_dropped_count = 0;
+}
+
+
+void app_trace_write(uint16_t id, uint32_t argc, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    uint32_t pos    = m_write_pos;
+    uint32_t header = id                                                                     |
+                      ((argc << APP_TRACE_HDR_ARGC_POS) & APP_TRACE_HDR_ARGC_MSK)            |
+                      ((APP_TRACE_TIMESTAMP_ENABLED) ? APP_TRACE_HDR_TIMESTAMP_MSK : 0)      |
+                      ((uint32_t)m_seq << APP_TRACE_HDR_SEQ_POS);
+
+    // The sequence number also advances for a dropped record, so the decoder sees the gap.
+    m_seq++;
+
+    if ((APP_TRACE_BUF_WORDS - (pos - m_read_pos)) < (1 + TIMESTAMP_WORDS + argc))
+    {
+        if (m_sink != NULL)
+        {
+            m_dropped_count++;
+            return;
+        }
+        oldest_discard(1 + TIMESTAMP_WORDS + argc);
+    }
+
+    m_ring[pos++ & RING_MASK] = header;
+#if (APP_TRACE_TIMESTAMP_ENABLED)
+    m_ring[pos++ & RING_MASK] = NRF_RTC1->COUNTER;
+#endif
+    if (argc > 0)
+    {
+        m_ring[pos++ & RING_MASK] = arg0;
+        if (argc > 1)
+        {
+            m_ring[pos++ & RING_MASK] = arg1;
+            if (argc > 2)
+            {
+                m_ring[pos++ & RING_MASK] = arg2;
+            }
+        }
+    }
+
+    m_write_pos = pos;
+}
+
+
+void app_trace_process(void)
+{
+    uint32_t record[RECORD_WORDS_MAX];
+
+    if (m_sink == NULL)
+    {
+        return;
+    }
+
+    while (m_read_pos != m_write_pos)
+    {
+        uint32_t words = record_words(m_ring[m_read_pos & RING_MASK]);
+        uint32_t i;
+
+        // Copied out, as a record may wrap around the end of the ring.
+        for (i = 0; i < words; i++)
+        {
+            record[i] = m_ring[(m_read_pos + i) & RING_MASK];
+        }
+
+        if (m_sink((uint8_t *)record, (uint16_t)(words * sizeof(uint32_t))) != NRF_SUCCESS)
+        {
+            // Sink full, continue upon next call.
+            return;
+        }
+        m_read_pos += words;
+    }
+}
+
+
+uint32_t app_trace_dropped_count_get(void)
+{
+    return m_dropped_count;
+}
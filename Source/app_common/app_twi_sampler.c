@@ -0,0 +1,214 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "app_twi_sampler.h"
+#include <stddef.h>
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "app_util.h"
+#include "app_timer.h"
+#include "app_scheduler.h"
+#include "twi_master.h"
+
+static app_timer_id_t               m_timer_id;                                 /**< Timer starting each sample. */
+static twi_master_xfer_t            m_xfers[2 * APP_TWI_SAMPLER_MAX_READS];     /**< Register address write and burst read of each read. */
+static uint8_t                      m_registers[APP_TWI_SAMPLER_MAX_READS];     /**< Source of the register address writes. */
+static uint8_t                      m_xfer_count;                               /**< Number of transfers of a sample. */
+static uint32_t                     m_period_ticks;                             /**< Sample period. */
+static app_twi_sampler_handler_t    m_handler;                                  /**< Batch handler. */
+static uint8_t *                    mp_buffer;                                  /**< Sample buffer, two batches. */
+static uint16_t                     m_sample_size;                              /**< Size of a sample. */
+static uint16_t                     m_batch_size;                               /**< Number of samples in a batch. */
+static uint8_t                      m_half;                                     /**< Half of the buffer being filled. */
+static uint16_t                     m_count;                                    /**< Number of samples in the half being filled. */
+static uint32_t                     m_dropped_count;                            /**< Number of samples dropped since init. */
+static volatile bool                m_running;                                  /**< Sampling started. */
+
+
+/**@brief Function for getting a sample of the half being filled. */
+static __INLINE uint8_t * sample_addr(uint16_t index)
+{
+    return mp_buffer + ((uint32_t)m_half * m_batch_size + index) * m_sample_size;
+}
+
+
+/**@brief Function for passing a batch from the scheduler to the batch handler. */
+static void batch_evt_handle(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(event_size);
+    m_handler((const app_twi_sampler_batch_t *)p_event_data);
+}
+
+
+/**@brief Function for passing the half being filled to the scheduler, and moving on to the other
+ *        half.
+ */
+static void batch_deliver(void)
+{
+    app_twi_sampler_batch_t batch;
+
+    batch.p_samples     = sample_addr(0);
+    batch.count         = m_count;
+    batch.sample_size   = m_sample_size;
+    batch.dropped_count = m_dropped_count;
+
+    if (app_sched_event_put(&batch, sizeof(batch), batch_evt_handle) != NRF_SUCCESS)
+    {
+        m_dropped_count += m_count;
+    }
+
+    m_half ^= 1;
+    m_count = 0;
+}
+
+
+/**@brief Function for handling the end of the reads of a sample, in the TWI interrupt. */
+static void xfer_list_handler(bool success, void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (!success)
+    {
+        m_dropped_count++;
+        return;
+    }
+
+    if (++m_count == m_batch_size)
+    {
+        batch_deliver();
+    }
+}
+
+
+/**@brief Function for starting the reads of a sample, once per period. */
+static void timeout_handler(void * p_context)
+{
+    uint8_t * p_sample;
+    uint8_t * p_data;
+    uint8_t   i;
+
+    UNUSED_PARAMETER(p_context);
+
+    if (!m_running)
+    {
+        return;
+    }
+
+    // The timer may run from the scheduler, below the TWI interrupt.
+    CRITICAL_REGION_ENTER();
+    if (twi_master_xfer_list_busy())
+    {
+        twi_master_xfer_list_abort();
+        m_dropped_count++;
+    }
+    CRITICAL_REGION_EXIT();
+
+    p_sample = sample_addr(m_count);
+    (void)app_timer_cnt_get((uint32_t *)p_sample);
+
+    // Read straight into the sample.
+    p_data = p_sample + APP_TWI_SAMPLER_TIMESTAMP_SIZE;
+    for (i = 1; i < m_xfer_count; i += 2)
+    {
+        m_xfers[i].p_data = p_data;
+        p_data           += m_xfers[i].data_length;
+    }
+
+    if (!twi_master_xfer_list_start(m_xfers, m_xfer_count, xfer_list_handler, NULL))
+    {
+        m_dropped_count++;
+    }
+}
+
+
+uint32_t app_twi_sampler_init(const app_twi_sampler_init_t * p_init)
+{
+    uint32_t data_size = 0;
+    uint8_t  i;
+
+    if ((p_init->p_reads == NULL) || (p_init->p_buffer == NULL) || (p_init->handler == NULL))
+    {
+        return NRF_ERROR_NULL;
+    }
+    if ((p_init->read_count == 0) || (p_init->read_count > APP_TWI_SAMPLER_MAX_READS) ||
+        (p_init->batch_size == 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    for (i = 0; i < p_init->read_count; i++)
+    {
+        const app_twi_sampler_read_t * p_read = &p_init->p_reads[i];
+
+        if (p_read->length == 0)
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+
+        m_registers[i] = p_read->register_address;
+
+        m_xfers[2 * i].address                  = (uint8_t)(p_read->device_address << 1);
+        m_xfers[2 * i].p_data                   = &m_registers[i];
+        m_xfers[2 * i].data_length              = 1;
+        m_xfers[2 * i].issue_stop_condition     = TWI_DONT_ISSUE_STOP;
+
+        m_xfers[2 * i + 1].address              = (uint8_t)((p_read->device_address << 1) | TWI_READ_BIT);
+        m_xfers[2 * i + 1].p_data               = NULL;
+        m_xfers[2 * i + 1].data_length          = p_read->length;
+        m_xfers[2 * i + 1].issue_stop_condition = TWI_ISSUE_STOP;
+
+        data_size += p_read->length;
+    }
+
+    m_xfer_count    = (uint8_t)(2 * p_init->read_count);
+    m_period_ticks  = p_init->period_ticks;
+    m_handler       = p_init->handler;
+    mp_buffer       = (uint8_t *)p_init->p_buffer;
+    m_sample_size   = (uint16_t)APP_TWI_SAMPLER_SAMPLE_SIZE(data_size);
+    m_batch_size    = p_init->batch_size;
+    m_half          = 0;
+    m_count         = 0;
+    m_dropped_count = 0;
+    m_running       = false;
+
+    return app_timer_create(&m_timer_id, APP_TIMER_MODE_REPEATED, timeout_handler);
+}
+
+
+uint32_t app_twi_sampler_start(void)
+{
+    m_running = true;
+    return app_timer_start(m_timer_id, m_period_ticks, NULL);
+}
+
+
+uint32_t app_twi_sampler_stop(void)
+{
+    uint32_t err_code;
+
+    m_running = false;
+    err_code  = app_timer_stop(m_timer_id);
+
+    CRITICAL_REGION_ENTER();
+    if (twi_master_xfer_list_busy())
+    {
+        twi_master_xfer_list_abort();
+    }
+    if (m_count > 0)
+    {
+        batch_deliver();
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
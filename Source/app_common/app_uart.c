@@ -511,6 +511,22 @@ uint32_t app_uart_put(uint8_t byte)
 }
 
 
+uint32_t app_uart_put_buf(const uint8_t * p_data, uint16_t length)
+{
+    if (length == 0)
+    {
+        return NRF_SUCCESS;
+    }
+    if (length > 1)
+    {
+        // Only a single byte can be held for transmission.
+        return NRF_ERROR_NO_MEM;
+    }
+
+    return app_uart_put(p_data[0]);
+}
+
+
 uint32_t app_uart_flush(void)
 {
     return NRF_SUCCESS;
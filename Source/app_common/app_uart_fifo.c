@@ -555,6 +555,20 @@ uint32_t app_uart_put(uint8_t byte)
 }
 
 
+uint32_t app_uart_put_buf(const uint8_t * p_data, uint16_t length)
+{
+    uint32_t err_code;
+
+    err_code = app_fifo_write(&m_tx_fifo, p_data, length);
+    if (err_code == NRF_SUCCESS)
+    {
+        on_uart_event(ON_UART_PUT);
+    }
+
+    return err_code;
+}
+
+
 uint32_t app_uart_flush(void)
 {
     uint32_t err_code;
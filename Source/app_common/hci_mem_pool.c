@@ -14,6 +14,10 @@
 #include "hci_mem_pool_internal.h"
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+
+#define TX_CLASS_COUNT    2u                                        /**< Number of TX buffer size classes. */
+#define TX_CLASS_MAX_BUFS 8u                                        /**< Max number of buffers in a TX size class. */
 
 /**@brief RX buffer element instance structure. 
  */
@@ -36,14 +40,115 @@ typedef struct
     uint32_t           free_index;                                  /**< Free position index. */                                                                                                                  
 } rx_buffer_queue_t;
 
-static bool              m_is_tx_allocated;                         /**< Boolean value to determine if the TX buffer is allocated. */
-static rx_buffer_elem_t  m_rx_buffer_elem_queue[RX_BUF_QUEUE_SIZE]; /**< RX buffer element instances. */
-static rx_buffer_queue_t m_rx_buffer_queue;                         /**< RX buffer queue element instance. */
+/**@brief TX buffer size class instance structure. 
+ */
+typedef struct
+{
+    uint8_t * p_memory;                                             /**< Memory of the buffers in this class. */
+    uint32_t  buffer_size;                                          /**< Size of a single buffer in bytes. */
+    uint32_t  buffer_count;                                         /**< Number of buffers in this class. */
+    uint32_t  free_mask;                                            /**< Bit n set when buffer n is free. */
+    uint32_t  alloc_seq[TX_CLASS_MAX_BUFS];                         /**< Allocation sequence number of each buffer, for FIFO order freeing. */
+} tx_size_class_t;
+
+static uint8_t              m_tx_small_memory[TX_SMALL_BUF_QUEUE_SIZE][TX_SMALL_BUF_SIZE]; /**< Memory of the small TX buffers. */
+static uint8_t              m_tx_memory[TX_BUF_QUEUE_SIZE][TX_BUF_SIZE]; /**< Memory of the TX buffers. */
+static tx_size_class_t      m_tx_class[TX_CLASS_COUNT];             /**< TX buffer size classes, smallest first. */
+static uint32_t             m_tx_alloc_seq;                         /**< Sequence number of the next TX allocation. */
+static rx_buffer_elem_t     m_rx_buffer_elem_queue[RX_BUF_QUEUE_SIZE]; /**< RX buffer element instances. */
+static rx_buffer_queue_t    m_rx_buffer_queue;                      /**< RX buffer queue element instance. */
+static hci_mem_pool_stats_t m_stats;                                /**< Usage statistics. */
+
+/**@brief Index of the lowest set bit of a 4 bit value, 4 for value 0. */
+static const uint8_t m_nibble_lowest_bit[16] = {4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+
+
+/**@brief Function for getting the index of the lowest set bit of a non-zero 8 bit mask.
+ *
+ * @note Cortex-M0 has no count trailing zeros instruction, so a lookup table is used.
+ */
+static uint32_t lowest_bit_index(uint32_t mask)
+{
+    return ((mask & 0x0Fu) != 0) ? m_nibble_lowest_bit[mask & 0x0Fu] : 
+                                   (4u + m_nibble_lowest_bit[(mask >> 4u) & 0x0Fu]);
+}
+
+
+/**@brief Function for initializing a TX buffer size class.
+ */
+static void tx_class_init(tx_size_class_t * p_class, 
+                          uint8_t *         p_memory, 
+                          uint32_t          buffer_size, 
+                          uint32_t          buffer_count)
+{
+    p_class->p_memory     = p_memory;
+    p_class->buffer_size  = buffer_size;
+    p_class->buffer_count = buffer_count;
+    p_class->free_mask    = (1u << buffer_count) - 1u;
+    memset(p_class->alloc_seq, 0, sizeof(p_class->alloc_seq));
+}
+
+
+/**@brief Function for allocating a buffer from a TX buffer size class.
+ *
+ * @return Pointer to the buffer, NULL if the class has no free buffer.
+ */
+static void * tx_class_alloc(tx_size_class_t * p_class)
+{
+    uint32_t index;
+
+    if (p_class->free_mask == 0)
+    {
+        return NULL;
+    }
+
+    index                      = lowest_bit_index(p_class->free_mask);
+    p_class->free_mask        &= ~(1u << index);
+    p_class->alloc_seq[index]  = m_tx_alloc_seq++;
+
+    return &p_class->p_memory[index * p_class->buffer_size];
+}
+
+
+/**@brief Function for returning a buffer to its TX buffer size class.
+ */
+static void tx_class_free(tx_size_class_t * p_class, uint32_t index)
+{
+    p_class->free_mask |= (1u << index);
+    --(m_stats.tx_in_use);
+}
+
+
+/**@brief Function for updating the statistics upon a TX allocation attempt.
+ */
+static void tx_alloc_stats_update(bool is_allocated)
+{
+    if (is_allocated)
+    {
+        ++(m_stats.tx_alloc_count);
+        ++(m_stats.tx_in_use);
+        if (m_stats.tx_in_use > m_stats.tx_in_use_max)
+        {
+            m_stats.tx_in_use_max = m_stats.tx_in_use;
+        }
+    }
+    else
+    {
+        ++(m_stats.tx_alloc_fail_count);
+    }
+}
 
 
 uint32_t hci_mem_pool_open(void)
 {
-    m_is_tx_allocated                      = false;    
+    tx_class_init(&m_tx_class[0], 
+                  &m_tx_small_memory[0][0], 
+                  TX_SMALL_BUF_SIZE, 
+                  TX_SMALL_BUF_QUEUE_SIZE);
+    tx_class_init(&m_tx_class[1], &m_tx_memory[0][0], TX_BUF_SIZE, TX_BUF_QUEUE_SIZE);
+    m_tx_alloc_seq                         = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+
     m_rx_buffer_queue.p_buffer             = m_rx_buffer_elem_queue;
     m_rx_buffer_queue.free_window_count    = RX_BUF_QUEUE_SIZE;
     m_rx_buffer_queue.free_available_count = 0;
@@ -64,38 +169,104 @@ uint32_t hci_mem_pool_close(void)
 
 uint32_t hci_mem_pool_tx_alloc(void ** pp_buffer)
 {
-    static uint8_t tx_buffer[TX_BUF_SIZE];  
+    return hci_mem_pool_tx_alloc_sized(TX_BUF_SIZE, pp_buffer);
+}
 
-    uint32_t err_code;
+
+uint32_t hci_mem_pool_tx_alloc_sized(uint32_t length, void ** pp_buffer)
+{
+    uint32_t i;
     
     if (pp_buffer == NULL)
     {
         return NRF_ERROR_NULL;
     }
     
-    if (!m_is_tx_allocated)
-    {        
-            m_is_tx_allocated = true;
-            *pp_buffer        = tx_buffer;
-            err_code          = NRF_SUCCESS;
+    if (length > TX_BUF_SIZE)
+    {
+        return NRF_ERROR_DATA_SIZE;
     }
-    else
+
+    // Smallest fitting class first, a larger class is used when the fitting ones are exhausted.
+    for (i = 0; i < TX_CLASS_COUNT; i++)
     {
-        err_code              = NRF_ERROR_NO_MEM;
+        if (length <= m_tx_class[i].buffer_size)
+        {
+            *pp_buffer = tx_class_alloc(&m_tx_class[i]);
+            if (*pp_buffer != NULL)
+            {
+                tx_alloc_stats_update(true);
+                return NRF_SUCCESS;
+            }
+        }
     }
-    
-    return err_code;
+
+    tx_alloc_stats_update(false);
+    return NRF_ERROR_NO_MEM;
 }
 
 
 uint32_t hci_mem_pool_tx_free(void)
 {
-    m_is_tx_allocated = false;
+    tx_size_class_t * p_oldest_class = NULL;
+    uint32_t          oldest_index   = 0;
+    uint32_t          i;
+    uint32_t          j;
+    
+    for (i = 0; i < TX_CLASS_COUNT; i++)
+    {
+        tx_size_class_t * p_class = &m_tx_class[i];
+
+        for (j = 0; j < p_class->buffer_count; j++)
+        {
+            // Sequence numbers are compared as signed difference to stay valid on wrap around.
+            if (((p_class->free_mask & (1u << j)) == 0) && 
+                ((p_oldest_class == NULL) || 
+                 ((int32_t)(p_class->alloc_seq[j] - p_oldest_class->alloc_seq[oldest_index]) < 0)))
+            {
+                p_oldest_class = p_class;
+                oldest_index   = j;
+            }
+        }
+    }
+
+    if (p_oldest_class != NULL)
+    {
+        tx_class_free(p_oldest_class, oldest_index);
+    }
     
     return NRF_SUCCESS;
 }
 
 
+uint32_t hci_mem_pool_tx_buffer_free(void * p_buffer)
+{
+    uint32_t i;
+    
+    for (i = 0; i < TX_CLASS_COUNT; i++)
+    {
+        tx_size_class_t * p_class = &m_tx_class[i];
+        const uint32_t    offset  = (uint32_t)((uint8_t *)p_buffer - p_class->p_memory);
+
+        // @note: offset wraps around for addresses below the class memory.
+        if (offset < (p_class->buffer_size * p_class->buffer_count))
+        {
+            const uint32_t index = offset / p_class->buffer_size;
+
+            if (((offset % p_class->buffer_size) != 0) || (p_class->free_mask & (1u << index)))
+            {
+                return NRF_ERROR_INVALID_ADDR;
+            }
+
+            tx_class_free(p_class, index);
+            return NRF_SUCCESS;
+        }
+    }
+
+    return NRF_ERROR_INVALID_ADDR;
+}
+
+
 uint32_t hci_mem_pool_rx_produce(uint32_t length, void ** pp_buffer)
 {
     uint32_t err_code; 
@@ -123,6 +294,12 @@ uint32_t hci_mem_pool_rx_produce(uint32_t length, void ** pp_buffer)
             // "Making embedded systems: Elicia White".
             m_rx_buffer_queue.write_index = 
                     (m_rx_buffer_queue.write_index + 1u) & (RX_BUF_QUEUE_SIZE - 1u);
+
+            const uint8_t rx_in_use = RX_BUF_QUEUE_SIZE - m_rx_buffer_queue.free_window_count;
+            if (rx_in_use > m_stats.rx_in_use_max)
+            {
+                m_stats.rx_in_use_max = rx_in_use;
+            }
             
             err_code                      = NRF_SUCCESS;
         }
@@ -133,6 +310,7 @@ uint32_t hci_mem_pool_rx_produce(uint32_t length, void ** pp_buffer)
     }
     else
     {
+        ++(m_stats.rx_produce_fail_count);
         err_code = NRF_ERROR_NO_MEM;    
     }
     
@@ -144,39 +322,39 @@ uint32_t hci_mem_pool_rx_consume(uint8_t * p_buffer)
 {
     uint32_t err_code;
     uint32_t consume_index;
-    uint32_t start_index;
+    uint32_t oldest_index;
     
     if (m_rx_buffer_queue.free_available_count != 0)
     {
-        // Find the buffer that has been freed -
-        // Start at read_index minus free_available_count and then increment until read index.
-        err_code      = NRF_ERROR_INVALID_ADDR;
-        consume_index = (m_rx_buffer_queue.read_index - m_rx_buffer_queue.free_available_count) & 
+        // The buffer index follows from the address, the buffer must be an extracted one which 
+        // has not been consumed yet: one between the oldest extracted buffer and read_index.
+        const uint32_t offset = (uint32_t)(p_buffer - m_rx_buffer_queue.p_buffer[0].rx_buffer);
+        
+        consume_index = offset / sizeof(rx_buffer_elem_t);
+        oldest_index  = (m_rx_buffer_queue.read_index - m_rx_buffer_queue.free_available_count) & 
                         (RX_BUF_QUEUE_SIZE - 1u);
-        start_index   = consume_index;
         
-        do
+        if ((offset % sizeof(rx_buffer_elem_t) != 0)                                        || 
+            (consume_index >= RX_BUF_QUEUE_SIZE)                                            ||
+            (((consume_index - oldest_index) & (RX_BUF_QUEUE_SIZE - 1u)) >= 
+             m_rx_buffer_queue.free_available_count)                                       ||
+            !(m_rx_buffer_queue.free_index & (1u << consume_index)))
         {
-            if (m_rx_buffer_queue.p_buffer[consume_index].rx_buffer == p_buffer)
-            {
-                m_rx_buffer_queue.free_index ^= (1u << consume_index);
-                err_code = NRF_SUCCESS;
-                break;
-            }
-            else
-            {
-                consume_index = (consume_index + 1u) & (RX_BUF_QUEUE_SIZE - 1u);
-            }
+            return NRF_ERROR_INVALID_ADDR;
         }
-        while (consume_index != m_rx_buffer_queue.read_index);
 
-        while (!(m_rx_buffer_queue.free_index & (1 << start_index)) && 
-                (m_rx_buffer_queue.free_available_count != 0))
+        m_rx_buffer_queue.free_index ^= (1u << consume_index);
+
+        // Return the consumed buffers to the free window, in order starting from the oldest.
+        while ((m_rx_buffer_queue.free_available_count != 0) && 
+               !(m_rx_buffer_queue.free_index & (1u << oldest_index)))
         {
             --(m_rx_buffer_queue.free_available_count);
             ++(m_rx_buffer_queue.free_window_count);            
-            start_index = (consume_index + 1u) & (RX_BUF_QUEUE_SIZE - 1u);
+            oldest_index = (oldest_index + 1u) & (RX_BUF_QUEUE_SIZE - 1u);
         }
+        
+        err_code = NRF_SUCCESS;
     }
     else
     {
@@ -233,3 +411,9 @@ uint32_t hci_mem_pool_rx_extract(uint8_t ** pp_buffer, uint32_t * p_length)
     
     return err_code;
 }
+
+
+void hci_mem_pool_stats_get(hci_mem_pool_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
@@ -12,16 +12,23 @@
 
 #include "hci_slip.h"
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include "hci_transport_config.h"
 #include "app_uart.h"
 #include "boards.h"
 #include "nrf51_bitfields.h"
+#include "nordic_common.h"
+#include "compiler_abstraction.h"
 
 #define APP_SLIP_END        0xC0                            /**< SLIP code for identifying the beginning and end of a packet frame.. */
 #define APP_SLIP_ESC        0xDB                            /**< SLIP escape code. This code is used to specify that the following character is specially encoded. */
 #define APP_SLIP_ESC_END    0xDC                            /**< SLIP special code. When this code follows 0xDB, this character is interpreted as payload data 0xC0.. */
 #define APP_SLIP_ESC_ESC    0xDD                            /**< SLIP special code. When this code follows 0xDB, this character is interpreted as payload data 0xDB. */
 
+#define TX_CHUNK_SIZE       32u                             /**< Size of the buffer holding SLIP encoded bytes waiting for the UART. */
+#define RX_CHUNK_SIZE       16u                             /**< Max number of bytes fetched from the UART FIFO for decoding at a time. */
+
 /** @brief States for the SLIP state machine. */
 typedef enum
 {
@@ -30,6 +37,14 @@ typedef enum
     SLIP_TRANSMITTING,                                      /**< SLIP state is transmitting indicating write() has been called but data transmission has not completed. */
 } slip_states_t;
 
+/** @brief States of the SLIP decoder. */
+typedef enum
+{
+    RX_STATE_WAIT_START,                                    /**< Discarding bytes until a SLIP end byte is received. */
+    RX_STATE_DEFAULT,                                       /**< Decoding packet data. */
+    RX_STATE_ESC                                            /**< SLIP escape byte received, decoding the byte following it. */
+} slip_rx_state_t;
+
 static uint16_t                 m_uart_id;                  /** UART id returned from the UART module when calling app_uart_init, this id is kept, as it must be provided to the UART module when calling app_uart_close. */
 static slip_states_t            m_current_state = SLIP_OFF; /** Current state for the SLIP TX state machine. */
 
@@ -37,127 +52,150 @@ static hci_slip_event_handler_t m_slip_event_handler;       /** Event callback f
 
 static const uint8_t *          mp_tx_buffer;               /** Pointer to the current TX buffer that is in transmission. */
 static uint32_t                 m_tx_buffer_length;         /** Length of the current TX buffer that is in transmission. */
-static volatile uint32_t        m_tx_buffer_index;          /** Current index for next byte to transmit in the mp_tx_buffer. */
+static uint32_t                 m_tx_buffer_index;          /** Index of the next byte to encode in the mp_tx_buffer. */
+static uint8_t                  m_tx_chunk[TX_CHUNK_SIZE];  /** SLIP encoded bytes waiting for the UART. */
+static uint32_t                 m_tx_chunk_length;          /** Number of bytes in m_tx_chunk. */
+static uint32_t                 m_tx_chunk_index;           /** Index of the next byte to pass to the UART in m_tx_chunk. */
+static bool                     m_is_tx_end_encoded;        /** True when the closing SLIP end byte has been encoded. */
 
 static uint8_t *                mp_rx_buffer;               /** Pointer to the current RX buffer where the next SLIP decoded packet will be stored. */
 static uint32_t                 m_rx_buffer_length;         /** Length of the current RX buffer. */
 static uint32_t                 m_rx_received_count;        /** Number of SLIP decoded bytes received and stored in mp_rx_buffer. */
+static slip_rx_state_t          m_rx_state = RX_STATE_WAIT_START; /** Current state of the SLIP decoder. */
 
 
-/**@brief Function for parsing bytes received on the UART until a SLIP escape byte is received.
- *
- * @param[in]  byte  Byte received in UART module.
+/** @brief Function for checking whether a byte has to be escaped.
  */
-static void handle_rx_byte_default(uint8_t byte);
+static __INLINE bool is_special_byte(uint8_t byte)
+{
+    return (byte == APP_SLIP_END) || (byte == APP_SLIP_ESC);
+}
 
-/**@brief Function for parsing bytes received on the UART until SLIP end byte is received.
- *
- * @param[in]  byte  Byte received in UART module.
- */
-static void handle_rx_byte_wait_start(uint8_t byte);
 
-/**@brief Function for decoding a received SLIP escape byte.
- *        It will ensure correct decoding of the byte following the SLIP escape byte.
+/** @brief Function for finding the first SLIP end or escape byte in a buffer.
  *
- * @param[in]  byte  Byte received in UART module.
- */
-static void handle_rx_byte_esc(uint8_t byte);
-
-/**@brief Function pointer for parsing and decoding SLIP bytes from the UART module.
+ * @details Word aligned parts of the buffer are checked four bytes at a time.
  *
- * @param[in]  byte  Byte received in UART module.
- */
-static void (*handle_rx_byte) (uint8_t byte) = handle_rx_byte_wait_start;
-
-/**@brief Function pointer for sending a byte through the UART module.
- */
-static uint32_t send_tx_byte_default(void);
-
-/**@brief Function for transferring a SLIP escape byte (0xDB) when special bytes are transferred,
- *        that is 0xC0 and 0xDB.
- */
-static uint32_t send_tx_byte_esc(void);
-
-/**@brief Function for transferring a byte when it collides with SLIP commands and follows the SLIP
- *        escape byte, that is 0xC0 => 0xDC and 0xDB => 0xDD.
- */
-static uint32_t send_tx_byte_encoded(void);
-
-/**@brief Function for transferring the SLIP end frame byte, 0xC0.
- */
-static uint32_t send_tx_byte_end(void);
-
-/**@brief Function pointer for sending a byte through the UART module.
+ * @param[in]  p_data   Buffer to search.
+ * @param[in]  length   Number of bytes to search.
+ *
+ * @return     Index of the first special byte, or length if the buffer has none.
  */
-uint32_t (*send_tx_byte) (void) = send_tx_byte_default;
-
-
-static uint32_t send_tx_byte_end(void)
+static uint32_t special_byte_find(const uint8_t * p_data, uint32_t length)
 {
-    uint32_t err_code = app_uart_put(APP_SLIP_END);
+    uint32_t index = 0;
 
-    if ((err_code == NRF_SUCCESS) && (m_tx_buffer_index == 0))
+    while ((index < length) && (((uint32_t)&p_data[index] & 0x03u) != 0))
     {
-        // Packet transmission started.
-        send_tx_byte = send_tx_byte_default;
+        if (is_special_byte(p_data[index]))
+        {
+            return index;
+        }
+        index++;
     }
 
-    return err_code;
-}
-
+    while ((length - index) >= sizeof(uint32_t))
+    {
+        const uint32_t word    = *(const uint32_t *)&p_data[index];
+        const uint32_t end_xor = word ^ 0xC0C0C0C0u;
+        const uint32_t esc_xor = word ^ 0xDBDBDBDBu;
 
-static uint32_t send_tx_byte_default(void)
-{
-    uint32_t err_code = app_uart_put(mp_tx_buffer[m_tx_buffer_index]);
+        // A byte equal to zero in either value sets its top bit in the expression below.
+        if ((((end_xor - 0x01010101u) & ~end_xor) | ((esc_xor - 0x01010101u) & ~esc_xor)) &
+            0x80808080u)
+        {
+            break;
+        }
+        index += sizeof(uint32_t);
+    }
 
-    if (err_code == NRF_SUCCESS)
+    while ((index < length) && !is_special_byte(p_data[index]))
     {
-        m_tx_buffer_index++;
+        index++;
     }
 
-    return err_code;
+    return index;
 }
 
 
-static uint32_t send_tx_byte_encoded(void)
+/** @brief Function for SLIP encoding data, without frame delimiters.
+ *
+ * @details Runs without special bytes are copied as a block. Encoding stops when the source is
+ *          consumed or when the next run or escape sequence does not fit in the destination.
+ *
+ * @param[in]  p_src        Data to encode.
+ * @param[in]  src_length   Number of bytes to encode.
+ * @param[out] p_dst        Destination for the encoded bytes.
+ * @param[in]  dst_size     Size of the destination.
+ * @param[out] p_src_used   Number of source bytes encoded.
+ *
+ * @return     Number of bytes written to p_dst.
+ */
+static uint32_t slip_data_encode(const uint8_t * p_src,
+                                 uint32_t        src_length,
+                                 uint8_t *       p_dst,
+                                 uint32_t        dst_size,
+                                 uint32_t *      p_src_used)
 {
-    uint32_t err_code;
+    uint32_t src_index = 0;
+    uint32_t dst_index = 0;
 
-    switch(mp_tx_buffer[m_tx_buffer_index])
+    while ((src_index < src_length) && (dst_index < dst_size))
     {
-        case APP_SLIP_END:
-            err_code = app_uart_put(APP_SLIP_ESC_END);
-            break;
+        const uint32_t scan_length = MIN(src_length - src_index, dst_size - dst_index);
+        const uint32_t run_length  = special_byte_find(&p_src[src_index], scan_length);
 
-        case APP_SLIP_ESC:
-            err_code = app_uart_put(APP_SLIP_ESC_ESC);
-            break;
+        memcpy(&p_dst[dst_index], &p_src[src_index], run_length);
+        src_index += run_length;
+        dst_index += run_length;
 
-        default:
-            err_code = NRF_ERROR_NO_MEM;
+        if (run_length == scan_length)
+        {
+            continue;
+        }
+
+        if ((dst_size - dst_index) < 2)
+        {
             break;
-    }
+        }
 
-    if (err_code == NRF_SUCCESS)
-    {
-        m_tx_buffer_index++;
-        send_tx_byte = send_tx_byte_default;
+        p_dst[dst_index++] = APP_SLIP_ESC;
+        p_dst[dst_index++] = (p_src[src_index] == APP_SLIP_END) ? APP_SLIP_ESC_END
+                                                                : APP_SLIP_ESC_ESC;
+        src_index++;
     }
 
-    return err_code;
+    *p_src_used = src_index;
+    return dst_index;
 }
 
 
-static uint32_t send_tx_byte_esc(void)
+/** @brief Function for encoding the next part of the mp_tx_buffer into m_tx_chunk.
+ */
+static void tx_chunk_fill(void)
 {
-    uint32_t err_code = app_uart_put(APP_SLIP_ESC);
+    uint32_t src_used;
 
-    if (err_code == NRF_SUCCESS)
+    m_tx_chunk_length = 0;
+    m_tx_chunk_index  = 0;
+
+    if (m_tx_buffer_index == 0)
     {
-        send_tx_byte = send_tx_byte_encoded;
+        m_tx_chunk[m_tx_chunk_length++] = APP_SLIP_END;
     }
 
-    return err_code;
+    m_tx_chunk_length += slip_data_encode(&mp_tx_buffer[m_tx_buffer_index],
+                                          m_tx_buffer_length - m_tx_buffer_index,
+                                          &m_tx_chunk[m_tx_chunk_length],
+                                          TX_CHUNK_SIZE - m_tx_chunk_length,
+                                          &src_used);
+    m_tx_buffer_index += src_used;
+
+    if ((m_tx_buffer_index == m_tx_buffer_length) && (m_tx_chunk_length < TX_CHUNK_SIZE))
+    {
+        m_tx_chunk[m_tx_chunk_length++] = APP_SLIP_END;
+        m_is_tx_end_encoded             = true;
+    }
 }
 
 
@@ -167,41 +205,35 @@ static uint32_t send_tx_byte_esc(void)
  */
 static void transmit_buffer(void)
 {
-    uint32_t err_code = NRF_SUCCESS;
-
-    while (m_tx_buffer_index < m_tx_buffer_length)
+    for (;;)
     {
-        if ((mp_tx_buffer[m_tx_buffer_index] == APP_SLIP_END  ||
-             mp_tx_buffer[m_tx_buffer_index] == APP_SLIP_ESC) &&
-             send_tx_byte == send_tx_byte_default)
+        while (m_tx_chunk_index < m_tx_chunk_length)
         {
-            send_tx_byte = send_tx_byte_esc;
+            if (app_uart_put(m_tx_chunk[m_tx_chunk_index]) != NRF_SUCCESS)
+            {
+                // No memory left in UART TX buffer. Abort and wait for APP_UART_TX_EMPTY to 
+                // continue.
+                return;
+            }
+            m_tx_chunk_index++;
         }
 
-        err_code = send_tx_byte();
-
-        if (err_code == NRF_ERROR_NO_MEM)
+        if (m_is_tx_end_encoded)
         {
-            // No memory left in UART TX buffer. Abort and wait for APP_UART_TX_EMPTY to continue.
-            return;
+            break;
         }
-    }
 
-    send_tx_byte = send_tx_byte_end;
+        tx_chunk_fill();
+    }
 
-    err_code = send_tx_byte();
+    // Packet transmission ended. Notify higher level.
+    m_current_state = SLIP_READY;
 
-    if (err_code == NRF_SUCCESS)
+    if (m_slip_event_handler != NULL)
     {
-        // Packet transmission ended. Notify higher level.
-        m_current_state = SLIP_READY;
-
-        if (m_slip_event_handler != NULL)
-        {
-            hci_slip_evt_t event = {HCI_SLIP_TX_DONE, mp_tx_buffer, m_tx_buffer_index};
+        hci_slip_evt_t event = {HCI_SLIP_TX_DONE, mp_tx_buffer, m_tx_buffer_index};
 
-            m_slip_event_handler(event);
-        }
+        m_slip_event_handler(event);
     }
 }
 
@@ -230,81 +262,132 @@ static void handle_slip_end(void)
 }
 
 
-static void handle_rx_byte_esc(uint8_t byte)
+/** @brief Function for checking the current index and length of the RX buffer to determine if the
+ *         buffer is full. If an event handler has been registered, the callback function will
+ *         be executed..
+ *
+ * @retval true     If RX buffer has overflowed.
+ * @retval false    otherwise.
+ *
+ */
+static bool rx_buffer_overflowed(void)
 {
-    switch (byte)
+    if (mp_rx_buffer == NULL || m_rx_received_count >= m_rx_buffer_length)
     {
-        case APP_SLIP_END:
-            handle_slip_end();
-            break;
-
-        case APP_SLIP_ESC_END:
-            mp_rx_buffer[m_rx_received_count++] = APP_SLIP_END;
-            break;
-
-        case APP_SLIP_ESC_ESC:
-            mp_rx_buffer[m_rx_received_count++] = APP_SLIP_ESC;
-            break;
+        if (m_slip_event_handler != NULL)
+        {
+            hci_slip_evt_t event = {HCI_SLIP_RX_OVERFLOW, mp_rx_buffer, m_rx_received_count};
+            m_slip_event_handler(event);
+        }
 
-        default:
-            mp_rx_buffer[m_rx_received_count++] = byte;
-            break;
+        return true;
     }
 
-    handle_rx_byte = handle_rx_byte_default;
+    return false;
 }
 
 
-static void handle_rx_byte_default(uint8_t byte)
+/** @brief Function for decoding a byte in the escape state or in a state where it is not part
+ *         of a run of plain packet data.
+ *
+ * @param[in]  byte  Byte received in UART module.
+ */
+static void rx_byte_decode(uint8_t byte)
 {
-    switch (byte)
+    switch (m_rx_state)
     {
-        case APP_SLIP_END:
-            handle_slip_end();
+        case RX_STATE_WAIT_START:
+            if (byte == APP_SLIP_END)
+            {
+                m_rx_state = RX_STATE_DEFAULT;
+            }
             break;
 
-        case APP_SLIP_ESC:
-            handle_rx_byte = handle_rx_byte_esc;
+        case RX_STATE_ESC:
+            m_rx_state = RX_STATE_DEFAULT;
+            switch (byte)
+            {
+                case APP_SLIP_END:
+                    handle_slip_end();
+
+                    // As in the per-byte decoder, bytes following an escaped end byte are packet
+                    // data even if a new RX buffer was registered from the event handler.
+                    m_rx_state = RX_STATE_DEFAULT;
+                    break;
+
+                case APP_SLIP_ESC_END:
+                    mp_rx_buffer[m_rx_received_count++] = APP_SLIP_END;
+                    break;
+
+                case APP_SLIP_ESC_ESC:
+                    mp_rx_buffer[m_rx_received_count++] = APP_SLIP_ESC;
+                    break;
+
+                default:
+                    mp_rx_buffer[m_rx_received_count++] = byte;
+                    break;
+            }
             break;
 
+        case RX_STATE_DEFAULT:
         default:
-            mp_rx_buffer[m_rx_received_count++] = byte;
+            switch (byte)
+            {
+                case APP_SLIP_END:
+                    handle_slip_end();
+                    break;
+
+                case APP_SLIP_ESC:
+                    m_rx_state = RX_STATE_ESC;
+                    break;
+
+                default:
+                    mp_rx_buffer[m_rx_received_count++] = byte;
+                    break;
+            }
             break;
     }
 }
 
 
-static void handle_rx_byte_wait_start(uint8_t byte)
-{
-    if (byte == APP_SLIP_END)
-    {
-        handle_rx_byte = handle_rx_byte_default;
-    }
-}
-
-
-/** @brief Function for checking the current index and length of the RX buffer to determine if the
- *         buffer is full. If an event handler has been registered, the callback function will
- *         be executed..
+/** @brief Function for decoding a block of bytes received on the UART.
  *
- * @retval true     If RX buffer has overflowed.
- * @retval false    otherwise.
+ * @details Runs of plain packet data are copied into the RX buffer as a block, bounded by the
+ *          space left in the RX buffer. Every other byte is decoded by @ref rx_byte_decode.
  *
+ * @param[in]  p_data   Received bytes.
+ * @param[in]  length   Number of received bytes.
  */
-static bool rx_buffer_overflowed(void)
+static void rx_data_decode(const uint8_t * p_data, uint32_t length)
 {
-    if (mp_rx_buffer == NULL || m_rx_received_count >= m_rx_buffer_length)
+    uint32_t index = 0;
+
+    while (index < length)
     {
-        if (m_slip_event_handler != NULL)
+        if (rx_buffer_overflowed())
         {
-            hci_slip_evt_t event = {HCI_SLIP_RX_OVERFLOW, mp_rx_buffer, m_rx_received_count};
-            m_slip_event_handler(event);
+            // Byte is dropped.
+            index++;
+            continue;
         }
 
-        return true;
-    }
+        if (m_rx_state == RX_STATE_DEFAULT)
+        {
+            const uint32_t scan_length = MIN(length - index, 
+                                             m_rx_buffer_length - m_rx_received_count);
+            const uint32_t run_length  = special_byte_find(&p_data[index], scan_length);
+
+            if (run_length != 0)
+            {
+                memcpy(&mp_rx_buffer[m_rx_received_count], &p_data[index], run_length);
+                m_rx_received_count += run_length;
+                index               += run_length;
+                continue;
+            }
+        }
 
-    return false;
+        rx_byte_decode(p_data[index++]);
+    }
 }
 
 
@@ -315,14 +398,42 @@ static bool rx_buffer_overflowed(void)
  */
 static void slip_uart_eventhandler(app_uart_evt_t * uart_event)
 {
-    if (uart_event->evt_type == APP_UART_TX_EMPTY && m_current_state == SLIP_TRANSMITTING)
+    switch (uart_event->evt_type)
     {
-        transmit_buffer();
-    }
+        case APP_UART_TX_EMPTY:
+            if (m_current_state == SLIP_TRANSMITTING)
+            {
+                transmit_buffer();
+            }
+            break;
 
-    if ((uart_event->evt_type == APP_UART_DATA) && (!rx_buffer_overflowed()))
-    {
-        handle_rx_byte(uart_event->data.value);
+        case APP_UART_DATA:
+            rx_data_decode(&uart_event->data.value, 1);
+            break;
+
+        case APP_UART_DATA_READY:
+        {
+            // UART with FIFO: decode the received bytes in blocks.
+            uint8_t  rx_chunk[RX_CHUNK_SIZE];
+            uint32_t rx_chunk_length;
+
+            do
+            {
+                rx_chunk_length = 0;
+                while ((rx_chunk_length < RX_CHUNK_SIZE) &&
+                       (app_uart_get(&rx_chunk[rx_chunk_length]) == NRF_SUCCESS))
+                {
+                    rx_chunk_length++;
+                }
+                rx_data_decode(rx_chunk, rx_chunk_length);
+            }
+            while (rx_chunk_length == RX_CHUNK_SIZE);
+            break;
+        }
+
+        default:
+            // No implementation needed.
+            break;
     }
 }
 
@@ -402,12 +513,13 @@ uint32_t hci_slip_write(const uint8_t * p_buffer, uint32_t length)
     switch (m_current_state)
     {
         case SLIP_READY:
-            m_tx_buffer_index  = 0;
-            m_tx_buffer_length = length;
-            mp_tx_buffer       = p_buffer;
-            m_current_state    = SLIP_TRANSMITTING;
-            send_tx_byte       = send_tx_byte_end;
+            m_tx_buffer_index   = 0;
+            m_tx_buffer_length  = length;
+            mp_tx_buffer        = p_buffer;
+            m_current_state     = SLIP_TRANSMITTING;
+            m_is_tx_end_encoded = false;
 
+            tx_chunk_fill();
             transmit_buffer();
             return NRF_SUCCESS;
 
@@ -426,6 +538,102 @@ uint32_t hci_slip_rx_buffer_register(uint8_t * p_buffer, uint32_t length)
     mp_rx_buffer        = p_buffer;
     m_rx_buffer_length  = length;
     m_rx_received_count = 0;
-    handle_rx_byte      = handle_rx_byte_wait_start;
+    m_rx_state          = RX_STATE_WAIT_START;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t hci_slip_frame_encode(const uint8_t * p_src,
+                               uint32_t        src_length,
+                               uint8_t *       p_dst,
+                               uint32_t *      p_dst_length)
+{
+    uint32_t dst_index;
+    uint32_t src_used;
+
+    if ((p_src == NULL) || (p_dst == NULL) || (p_dst_length == NULL))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    if (*p_dst_length < 2)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    dst_index          = 0;
+    p_dst[dst_index++] = APP_SLIP_END;
+    dst_index         += slip_data_encode(p_src,
+                                          src_length,
+                                          &p_dst[dst_index],
+                                          *p_dst_length - 2,
+                                          &src_used);
+    if (src_used != src_length)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    p_dst[dst_index++] = APP_SLIP_END;
+
+    *p_dst_length = dst_index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t hci_slip_frame_decode(uint8_t * p_buffer, uint32_t * p_length)
+{
+    uint32_t src_index = 0;
+    uint32_t dst_index = 0;
+    uint32_t length;
+
+    if ((p_buffer == NULL) || (p_length == NULL))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    length = *p_length;
+
+    // Skip the opening SLIP end bytes.
+    while ((src_index < length) && (p_buffer[src_index] == APP_SLIP_END))
+    {
+        src_index++;
+    }
+
+    while (src_index < length)
+    {
+        const uint32_t run_length = special_byte_find(&p_buffer[src_index], length - src_index);
+
+        // Decoded data is never longer than the encoded data, so it can be moved in place.
+        memmove(&p_buffer[dst_index], &p_buffer[src_index], run_length);
+        src_index += run_length;
+        dst_index += run_length;
+
+        if ((src_index == length) || (p_buffer[src_index] == APP_SLIP_END))
+        {
+            break;
+        }
+
+        // Escape byte, decode the byte following it.
+        if (++src_index == length)
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+
+        switch (p_buffer[src_index])
+        {
+            case APP_SLIP_ESC_END:
+                p_buffer[dst_index++] = APP_SLIP_END;
+                break;
+
+            case APP_SLIP_ESC_ESC:
+                p_buffer[dst_index++] = APP_SLIP_ESC;
+                break;
+
+            default:
+                return NRF_ERROR_INVALID_DATA;
+        }
+        src_index++;
+    }
+
+    *p_length = dst_index;
     return NRF_SUCCESS;
 }
@@ -22,12 +22,17 @@
 #include "app_timer.h"
 #include "app_error.h"
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
 
 #define PKT_HDR_SIZE                    4u                                                                 /**< Packet header size in number of bytes. */
 #define PKT_CRC_SIZE                    2u                                                                 /**< Packet CRC size in number of bytes. */
 #define PKT_TYPE_VENDOR_SPECIFIC        14u                                                                /**< Packet type vendor specific. */
 #define PKT_TYPE_ACK                    0                                                                  /**< Packet type acknowledgement. */
+#define PKT_TYPE_LINK_CONTROL           15u                                                                /**< Packet type link control. */
+#define LINK_CTRL_PAYLOAD_SIZE          2u                                                                 /**< Link control packet payload size in number of bytes. */
+#define LINK_CTRL_SYNC                  0x7E01u                                                            /**< Link control SYNC message, as encoded by uint16_encode. */
+#define LINK_CTRL_SYNC_RSP              0x7D02u                                                            /**< Link control SYNC RESPONSE message, as encoded by uint16_encode. */
 #define DATA_INTEGRITY_MASK             (1u << 6u)                                                         /**< Mask for data integrity bit in the packet header. */
 #define RELIABLE_PKT_MASK               (1u << 7u)                                                         /**< Mask for reliable packet bit in the packet header. */
 #define INITIAL_ACK_NUMBER_EXPECTED     1u                                                                 /**< Initial acknowledge number expected. */
@@ -38,40 +43,41 @@
 #define APP_TIMER_PRESCALER             0                                                                  /**< Value of the RTC1 PRESCALER register. */
 #define RETRANSMISSION_TIMEOUT_IN_TICKS APP_TIMER_TICKS(RETRANSMISSION_TIMEOUT_IN_MS, APP_TIMER_PRESCALER) /**< Retransmission timeout for application packet in units of timer ticks. */             
 #define MAX_RETRY_COUNT                 5u                                                                 /**< Max retransmission retry count for application packets. */
-#define ACK_BUF_SIZE                    5u                                                                 /**< Length of module internal RX buffer which is big enough to hold an acknowledgement packet. */
+#define ACK_BUF_SIZE                    (PKT_HDR_SIZE + LINK_CTRL_PAYLOAD_SIZE + 1u)                       /**< Length of module internal RX buffer which is big enough to hold an acknowledgement or link control packet. */
 
-/**@brief States of the TX state machine. */
-typedef enum
+/**@brief TX window slot holding a reliable packet waiting for peer acknowledgement. */
+typedef struct
 {
-    TX_STATE_IDLE,                                                   /**< State for: no application transmission packet processing in progress. */                                                                                             
-    TX_STATE_PENDING,                                                /**< State for: TX in progress in slip layer and TX-done event is waited for to signal the end of transmission. */
-    TX_STATE_ACTIVE                                                  /**< State for: application packet has been delivered to slip for transmission and peer transport entity acknowledgement packet is waited for. */
-} tx_state_t;
+    uint8_t * p_buffer;                                              /**< Packet data including header and CRC. */
+    uint32_t  length;                                                /**< Length of packet data including header and CRC in bytes. */
+} tx_window_slot_t;
 
-/**@brief TX state machine events. */
-typedef enum
-{
-    TX_EVENT_STATE_ENTRY,                                            /**< Event for: state entry use case. */                                                                                             
-    TX_EVENT_SLIP_TX_DONE,                                           /**< Event for: HCI_SLIP_TX_DONE event use case. */
-    TX_EVENT_TIMEOUT,                                                /**< Event for: retransmission timeout use case. */
-    TX_EVENT_VALID_RX_ACK                                            /**< Event for: valid acknowledgement received for TX packet use case. */
-} tx_event_t;
-
-static void tx_sm_state_change(tx_state_t new_state);
-
-static tx_state_t                      m_tx_state;                   /**< Current TX state. */
 static hci_transport_tx_done_handler_t m_transport_tx_done_handle;   /**< TX done event callback function. */
 static hci_transport_event_handler_t   m_transport_event_handle;     /**< Event handler callback function. */
 static uint8_t *                       mp_slip_used_rx_buffer;       /**< Reference to RX buffer used by the slip layer. */
 static uint32_t                        m_packet_expected_seq_number; /**< Sequence number counter of the packet expected to be received . */ 
-static uint32_t                        m_packet_transmit_seq_number; /**< Sequence number counter of the transmitted packet for which acknowledgement packet is waited for. */ 
-static uint8_t *                       mp_tx_buffer;                 /**< Pointer to TX application buffer to be transmitted. */
-static uint32_t                        m_tx_buffer_length;           /**< Length of application TX packet data to be transmitted in bytes. */
-static bool                            m_is_slip_decode_ready;       /**< Boolean to determine has slip decode been completed or not. */
+static uint32_t                        m_packet_transmit_seq_number; /**< Sequence number of the oldest transmitted packet for which acknowledgement packet is waited for. */ 
+static tx_window_slot_t                m_tx_window[HCI_TRANSPORT_TX_WINDOW_SIZE]; /**< TX window, packets in sequence number order starting from m_tx_window_head. */
+static uint32_t                        m_tx_window_head;             /**< Index of the slot holding the oldest unacknowledged packet. */
+static uint32_t                        m_tx_window_count;            /**< Number of packets in the TX window. */
+static uint32_t                        m_tx_sent_count;              /**< Number of packets, from the oldest, delivered to the slip layer at least once. */
+static uint32_t                        m_tx_resend_index;            /**< Window offset of the next packet to retransmit. */
+static uint32_t                        m_tx_resend_end;              /**< Window offset where the ongoing retransmission round ends. */
+static bool                            m_is_ack_pending;             /**< Boolean to determine is an acknowledgement packet waiting for the slip layer. */
+static bool                            m_is_sync_pending;            /**< Boolean to determine is a SYNC packet waiting for the slip layer. */
+static bool                            m_is_sync_rsp_pending;        /**< Boolean to determine is a SYNC RESPONSE packet waiting for the slip layer. */
+static bool                            m_is_tx_resync;               /**< Boolean to determine are TX sequence numbers being resynchronized with the peer, see @ref tx_resync_start. */
+static bool                            m_is_rx_resynced;             /**< Boolean to determine has a SYNC been received after the last application packet. */
+static uint8_t                         m_sync_rsp_ack_number;        /**< Sequence number expected before the last SYNC, sent in SYNC RESPONSE. */
+static uint8_t                         m_tx_resync_round;            /**< Number of the ongoing TX resynchronization, sent in the Sequence Number of SYNC. */
+static uint8_t                         m_rx_sync_round;              /**< Resynchronization number of the last SYNC received, echoed in SYNC RESPONSE. */
+static bool                            m_is_tx_feeding;              /**< Boolean to determine is @ref tx_window_feed running. */
+static bool                            m_is_tx_feed_requested;       /**< Boolean to determine was @ref tx_window_feed called while running. */
+static uint32_t                        m_rx_ready_count;             /**< Number of received application packets not extracted yet. */
 static app_timer_id_t                  m_app_timer_id;               /**< Application timer id. */
-static uint32_t                        m_tx_retry_counter;           /**< Application packet retransmission counter. */
-static hci_transport_tx_done_result_t  m_tx_done_result_code;        /**< TX done event callback function result code. */
+static uint32_t                        m_tx_retry_counter;           /**< Retransmission rounds since the TX window last advanced. */
 static uint8_t                         m_rx_ack_buffer[ACK_BUF_SIZE];/**< RX buffer big enough to hold an acknowledgement packet and which is taken in use upon receiving  HCI_SLIP_RX_OVERFLOW event. */
+static hci_transport_stats_t           m_stats;                      /**< Transport statistics. */
 
 
 /**@brief Function for validating a received packet.
@@ -177,13 +183,67 @@ static void ack_transmit(void)
     ack_packet[2] = 0;        
     ack_packet[3] = header_checksum_calculate(ack_packet); 
 
-    // @note: no return value check needed for hci_slip_write(...) call as acknowledgement packets 
-    // are considered to be from system design point of view unreliable packets.Use case where 
-    // underlying slip layer does not accept a packet for transmission is managed either by:
-    // - acknowledged by possible future application packet as acknowledgement number header field 
-    // is included 
-    // - protocol peer entity will retransmit the packet        
-    UNUSED_VARIABLE(hci_slip_write(ack_packet, sizeof(ack_packet)));   
+    // If the slip layer is busy the acknowledgement is sent upon the next HCI_SLIP_TX_DONE event,
+    // ahead of any application packet. Acknowledgement packets are unreliable, so any other 
+    // failure is left to the retransmission algorithm of the peer protocol entity.
+    m_is_ack_pending = (hci_slip_write(ack_packet, sizeof(ack_packet)) == NRF_ERROR_NO_MEM);
+}
+
+
+/**@brief Function for writing a link control packet for transmission.
+ *
+ * @param[out] p_packet   Packet buffer, must stay valid until the packet has been transmitted.
+ * @param[in]  message    Link control message.
+ * @param[in]  seq_number Sequence Number of the packet, the resynchronization number.
+ * @param[in]  ack_number Acknowledge Number of the packet.
+ *
+ * @return true if the slip layer is busy and the packet has to be written again later.
+ */
+static bool link_ctrl_transmit(uint8_t * p_packet, 
+                               uint16_t  message, 
+                               uint8_t   seq_number, 
+                               uint8_t   ack_number)
+{
+    // TX link control packet format:
+    // - Unreliable Packet type without data integrity check
+    // - Payload Length set to LINK_CTRL_PAYLOAD_SIZE
+    // - Sequence Number set to the resynchronization number
+    // - Header checksum calculated
+    p_packet[0] = (uint8_t)((ack_number << 3u) | seq_number);
+    UNUSED_VARIABLE(uint16_encode(((LINK_CTRL_PAYLOAD_SIZE << 4u) | PKT_TYPE_LINK_CONTROL), 
+                                  &p_packet[1]));
+    p_packet[3] = header_checksum_calculate(p_packet);
+    UNUSED_VARIABLE(uint16_encode(message, &p_packet[PKT_HDR_SIZE]));
+
+    // Link control packets are unreliable: a SYNC is repeated on retransmission timeout until 
+    // answered.
+    return (hci_slip_write(p_packet, PKT_HDR_SIZE + LINK_CTRL_PAYLOAD_SIZE) == NRF_ERROR_NO_MEM);
+}
+
+
+/**@brief Function for writing a SYNC packet for transmission.
+ */
+static void sync_transmit(void)
+{
+    static uint8_t sync_packet[PKT_HDR_SIZE + LINK_CTRL_PAYLOAD_SIZE];
+
+    m_is_sync_pending = link_ctrl_transmit(sync_packet, LINK_CTRL_SYNC, m_tx_resync_round, 0);
+}
+
+
+/**@brief Function for writing a SYNC RESPONSE packet for transmission.
+ *
+ * The Acknowledge Number is the sequence number expected before the SYNC, which tells the peer 
+ * how many of its unacknowledged packets have been received.
+ */
+static void sync_rsp_transmit(void)
+{
+    static uint8_t sync_rsp_packet[PKT_HDR_SIZE + LINK_CTRL_PAYLOAD_SIZE];
+
+    m_is_sync_rsp_pending = link_ctrl_transmit(sync_rsp_packet, 
+                                               LINK_CTRL_SYNC_RSP, 
+                                               m_rx_sync_round,
+                                               m_sync_rsp_ack_number);
 }
 
 
@@ -233,6 +293,35 @@ static __INLINE uint32_t packet_type_decode(const uint8_t * p_buffer, uint32_t l
 }
 
 
+/**@brief Function for registering an RX buffer to the slip layer after a packet that is not 
+ *        passed to the application.
+ */
+static void rx_buffer_reset(void)
+{
+    uint32_t err_code;
+
+    // RX packet dropped: reset memory buffer to slip in order to avoid RX buffer overflow. 
+    // If existing mem pool produced RX buffer exists reuse that one. If existing mem pool produced
+    // RX buffer does not exist try to produce new one. If producing fails use the internal 
+    // acknowledgement buffer.                    
+    if (mp_slip_used_rx_buffer != NULL)
+    {
+        err_code = hci_slip_rx_buffer_register(mp_slip_used_rx_buffer, RX_BUF_SIZE);                                                            
+        APP_ERROR_CHECK(err_code);                                                                
+    }
+    else
+    {
+        err_code = hci_mem_pool_rx_produce(RX_BUF_SIZE, (void **)&mp_slip_used_rx_buffer); 
+        APP_ERROR_CHECK_BOOL((err_code == NRF_SUCCESS) || (err_code == NRF_ERROR_NO_MEM));
+
+        err_code = hci_slip_rx_buffer_register(
+            (err_code == NRF_SUCCESS) ? mp_slip_used_rx_buffer : m_rx_ack_buffer, 
+            (err_code == NRF_SUCCESS) ? RX_BUF_SIZE : ACK_BUF_SIZE);            
+        APP_ERROR_CHECK(err_code);                                                                
+    }
+}
+
+
 /**@brief Function for processing a received vendor specific packet.
  *
  * @param[in] p_buffer Pointer to the packet data. 
@@ -243,17 +332,27 @@ static void rx_vendor_specific_pkt_type_handle(const uint8_t * p_buffer, uint32_
     // @note: no pointer validation check needed as allready checked by calling function.
     uint32_t err_code;
     
-    if (is_rx_pkt_valid(p_buffer, length))
+    if (p_buffer == m_rx_ack_buffer)
+    {
+        // RX packet discarded: it was received into the internal acknowledgement buffer while no 
+        // memory pool RX buffer was available, and can not be passed to the application. It is not
+        // acknowledged, so the peer transmits it again.
+        ++m_stats.rx_discard_count;
+        rx_buffer_reset();
+    }
+    else if (is_rx_pkt_valid(p_buffer, length))
     {
         // RX packet is valid: validate sequence number.
         const uint8_t rx_seq_number = packet_seq_nmbr_extract(p_buffer);
         if (packet_number_expected_get() == rx_seq_number)
         {
             // Sequence number is valid: transmit acknowledgement.
+            ++m_stats.rx_pkt_count;
+            m_is_rx_resynced = false;
             packet_number_expected_inc();                    
             ack_transmit();                    
 
-            m_is_slip_decode_ready = true;            
+            ++m_rx_ready_count;
             
             err_code = hci_mem_pool_rx_data_size_set(length);
             APP_ERROR_CHECK(err_code);
@@ -280,8 +379,8 @@ static void rx_vendor_specific_pkt_type_handle(const uint8_t * p_buffer, uint32_
         {
             // RX packet discarded: sequence number not valid, set the same buffer to slip layer in 
             // order to avoid buffer overrun. 
-            err_code = hci_slip_rx_buffer_register(mp_slip_used_rx_buffer, RX_BUF_SIZE);                            
-            APP_ERROR_CHECK(err_code);                            
+            ++m_stats.rx_discard_count;
+            rx_buffer_reset();
                 
             // As packet did not have expected sequence number: send acknowledgement with the 
             // current expected sequence number.
@@ -292,48 +391,229 @@ static void rx_vendor_specific_pkt_type_handle(const uint8_t * p_buffer, uint32_
     {
         // RX packet discarded: reset the same buffer to slip layer in order to avoid buffer
         // overrun. 
-        err_code = hci_slip_rx_buffer_register(mp_slip_used_rx_buffer, RX_BUF_SIZE);                            
-        APP_ERROR_CHECK(err_code);                                    
+        ++m_stats.rx_discard_count;
+        rx_buffer_reset();
     }            
 }
 
 
-/**@brief Function for getting the sequence number of a reliable TX packet for which peer protocol 
- * entity acknowledgment is pending.
+/**@brief Function for getting a TX window slot.
  *
- * @return sequence number of a reliable TX packet for which peer protocol entity acknowledgement
- * is pending.
+ * @param[in] offset Offset of the slot from the oldest unacknowledged packet.
+ *
+ * @return Pointer to the slot.
+ */
+static __INLINE tx_window_slot_t * tx_window_slot_get(uint32_t offset)
+{
+    return &m_tx_window[(m_tx_window_head + offset) % HCI_TRANSPORT_TX_WINDOW_SIZE];
+}
+
+
+/**@brief Function for (re)starting the retransmission timer.
  */
-static __INLINE uint8_t packet_number_to_transmit_get(void)
+static void retransmission_timer_restart(void)
 {
-    return m_packet_transmit_seq_number;
+    uint32_t err_code;
+
+    err_code = app_timer_stop(m_app_timer_id);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_start(m_app_timer_id, RETRANSMISSION_TIMEOUT_IN_TICKS, NULL);
+    APP_ERROR_CHECK(err_code);
 }
 
 
-/**@brief Function for getting the expected acknowledgement number.
+/**@brief Function for sending a TX done event if registered handler exists.
  *
- * @return expected acknowledgement number.
+ * @param[in] result  TX done event result code.
+ * @param[in] count   Number of packets completed.
  */
-static __INLINE uint8_t expected_ack_number_get(void)
+static void tx_done_notify(hci_transport_tx_done_result_t result, uint32_t count)
 {
-    uint8_t seq_nmbr = packet_number_to_transmit_get(); 
-    ++seq_nmbr;
-    seq_nmbr &= 0x07u;
-    
-    return seq_nmbr;
+    for (; count != 0; --count)
+    {
+        if (m_transport_tx_done_handle != NULL)
+        {
+            m_transport_tx_done_handle(result);
+        }
+    }
+}
+
+
+/**@brief Function for delivering packets to the slip layer for as long as it accepts them.
+ *
+ * Delivery order: pending acknowledgement packet, pending link control packets, packets of an 
+ * ongoing retransmission round, packets not transmitted yet. No application packet is delivered
+ * while the TX sequence numbers are being resynchronized.
+ *
+ * @retval NRF_SUCCESS  Everything delivered, or slip layer busy and delivery continues upon 
+ *                      HCI_SLIP_TX_DONE event.
+ * @return Error code from the slip layer otherwise.
+ */
+static uint32_t tx_window_deliver(void)
+{
+    for (;;)
+    {
+        uint32_t           err_code;
+        uint32_t           offset;
+        tx_window_slot_t * p_slot;
+
+        if (m_is_ack_pending)
+        {
+            ack_transmit();
+            if (m_is_ack_pending)
+            {
+                return NRF_SUCCESS;
+            }
+        }
+
+        if (m_is_sync_rsp_pending)
+        {
+            sync_rsp_transmit();
+            if (m_is_sync_rsp_pending)
+            {
+                return NRF_SUCCESS;
+            }
+        }
+
+        if (m_is_sync_pending)
+        {
+            sync_transmit();
+            if (m_is_sync_pending)
+            {
+                return NRF_SUCCESS;
+            }
+        }
+
+        if (m_is_tx_resync)
+        {
+            return NRF_SUCCESS;
+        }
+        else if (m_tx_resend_index < m_tx_resend_end)
+        {
+            offset = m_tx_resend_index;
+        }
+        else if (m_tx_sent_count < m_tx_window_count)
+        {
+            offset = m_tx_sent_count;
+        }
+        else
+        {
+            return NRF_SUCCESS;
+        }
+
+        p_slot   = tx_window_slot_get(offset);
+        err_code = hci_slip_write(p_slot->p_buffer, p_slot->length);
+        if (err_code == NRF_ERROR_NO_MEM)
+        {
+            return NRF_SUCCESS;
+        }
+        else if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+
+        if (offset == m_tx_sent_count)
+        {
+            // First packet waiting for acknowledgement: arm retransmission timer.
+            if (m_tx_sent_count == 0)
+            {
+                retransmission_timer_restart();
+            }
+            ++m_tx_sent_count;
+        }
+        else
+        {
+            ++m_tx_resend_index;
+            ++m_stats.tx_retransmit_count;
+        }
+    }
+}
+
+
+/**@brief Function for delivering packets to the slip layer, see @ref tx_window_deliver.
+ *
+ * A packet which fits in the UART TX FIFO completes within hci_slip_write, and the 
+ * HCI_SLIP_TX_DONE event calls this function again before the packet has been accounted for. 
+ * The nested call only requests another delivery round, which would otherwise transmit the same 
+ * packet twice.
+ *
+ * @retval NRF_SUCCESS  Everything delivered, or slip layer busy and delivery continues upon 
+ *                      HCI_SLIP_TX_DONE event.
+ * @return Error code from the slip layer otherwise.
+ */
+static uint32_t tx_window_feed(void)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    m_is_tx_feed_requested = true;
+    if (m_is_tx_feeding)
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_is_tx_feeding = true;
+    while (m_is_tx_feed_requested && (err_code == NRF_SUCCESS))
+    {
+        m_is_tx_feed_requested = false;
+        err_code               = tx_window_deliver();
+    }
+    m_is_tx_feeding = false;
+
+    return err_code;
+}
+
+
+/**@brief Function for processing an acknowledgement number received from the peer.
+ *
+ * The acknowledgement number is the sequence number of the next packet the peer expects, so it 
+ * acknowledges every outstanding packet before it.
+ *
+ * @param[in] ack_number Received acknowledgement number.
+ */
+static void tx_ack_number_process(uint8_t ack_number)
+{
+    const uint32_t acked_count = (ack_number - m_packet_transmit_seq_number) & 0x07u;
+
+    // Duplicate acknowledgement, or acknowledgement number outside the TX window. While the 
+    // sequence numbers are resynchronized the peer may already count from the initial sequence 
+    // number, the SYNC RESPONSE tells which packets it received.
+    if ((acked_count == 0) || (acked_count > m_tx_sent_count) || m_is_tx_resync)
+    {
+        return;
+    }
+
+    m_tx_window_head             = (m_tx_window_head + acked_count) % HCI_TRANSPORT_TX_WINDOW_SIZE;
+    m_tx_window_count           -= acked_count;
+    m_tx_sent_count             -= acked_count;
+    m_tx_resend_index            = (m_tx_resend_index > acked_count) ? 
+                                   (m_tx_resend_index - acked_count) : 0;
+    m_tx_resend_end              = (m_tx_resend_end > acked_count) ? 
+                                   (m_tx_resend_end - acked_count) : 0;
+    m_packet_transmit_seq_number = ack_number;
+    m_tx_retry_counter           = 0;
+
+    if (m_tx_sent_count != 0)
+    {
+        retransmission_timer_restart();
+    }
+    else
+    {
+        const uint32_t err_code = app_timer_stop(m_app_timer_id);
+        APP_ERROR_CHECK(err_code);
+    }
+
+    tx_done_notify(HCI_TRANSPORT_TX_DONE_SUCCESS, acked_count);
 }
 
 
 /**@brief Function for processing a received acknowledgement packet.
  *
- * Verifies does the received acknowledgement packet has the expected acknowledgement number and 
- * that the header checksum is correct. 
+ * Verifies that the header checksum of the received acknowledgement packet is correct and 
+ * processes the acknowledgement number.
  *
  * @param[in] p_buffer Pointer to the packet data. 
- *
- * @return true if valid acknowledgement packet received.
  */
-static __INLINE bool rx_ack_pkt_type_handle(const uint8_t * p_buffer)
+static __INLINE void rx_ack_pkt_type_handle(const uint8_t * p_buffer)
 {
     // @note: no pointer validation check needed as allready checked by calling function.
     
@@ -342,124 +622,206 @@ static __INLINE bool rx_ack_pkt_type_handle(const uint8_t * p_buffer)
         ((p_buffer[0] + p_buffer[1] + p_buffer[2] + p_buffer[3])) & 0xFFu;
     if (expected_checksum != 0)
     {    
-        return false;
+        return;
     }
     
-    const uint8_t ack_number = (p_buffer[0] >> 3u) & 0x07u;
-    
-    // Verify expected acknowledgment number.
-    return (ack_number == expected_ack_number_get());
+    tx_ack_number_process((p_buffer[0] >> 3u) & 0x07u);
 }
 
 
-/**@brief Function for incrementing the sequence number counter of the TX packet. 
+/**@brief Function for renumbering a packet in a TX window slot.
+ *
+ * @param[in,out] p_slot     TX window slot.
+ * @param[in]     seq_number New sequence number of the packet.
  */
-static __INLINE void packet_number_tx_inc(void)
+static void pkt_seq_number_set(tx_window_slot_t * p_slot, uint8_t seq_number)
 {
-    ++m_packet_transmit_seq_number;
-    m_packet_transmit_seq_number &= 0x07u;
+    uint8_t * p_pkt = p_slot->p_buffer;
+
+    p_pkt[0] = (uint8_t)((p_pkt[0] & ~0x07u) | seq_number);
+    p_pkt[3] = header_checksum_calculate(p_pkt);
+
+    const uint16_t crc = crc16_compute(p_pkt, (p_slot->length - PKT_CRC_SIZE), NULL);
+    // @note: no use case for uint16_encode(...) return value.
+    UNUSED_VARIABLE(uint16_encode(crc, &(p_pkt[p_slot->length - PKT_CRC_SIZE])));
 }
 
 
-/**@brief Function for TX state machine event processing in a state centric manner.
+/**@brief Function for taking a packet never delivered to the slip layer back out of the TX window.
+ *
+ * The packet is not necessarily the newest one: packets written from within a TX done handler while
+ * it was being delivered are queued after it. These move up one slot and are renumbered.
+ *
+ * @param[in] p_pkt Start of the packet, i.e. of its header.
  *
- * @param[in] event Type of event occurred.
+ * @return true if the packet was found and removed, false if it has already been delivered.
  */
-static void tx_sm_event_handle(tx_event_t event)
+static bool tx_window_unsent_remove(const uint8_t * p_pkt)
 {
-    uint32_t err_code;
-    
-    switch (m_tx_state)
+    uint32_t offset;
+
+    for (offset = m_tx_sent_count; offset < m_tx_window_count; ++offset)
     {
-        case TX_STATE_IDLE:
-            if (event == TX_EVENT_STATE_ENTRY)
-            {                 
-                err_code = app_timer_stop(m_app_timer_id);
-                APP_ERROR_CHECK(err_code);
-                
-                // Send TX-done event if registered handler exists.
-                if (m_transport_tx_done_handle != NULL)                
-                {
-                    m_transport_tx_done_handle(m_tx_done_result_code);
-                }                
-            }
-            break;
-            
-        case TX_STATE_PENDING:
-            if (event == TX_EVENT_SLIP_TX_DONE)
-            {     
-                // @note: this call should always succeed as called from HCI_SLIP_TX_DONE context 
-                // and error cases are managed by dedicated error event from the slip layer.
-                err_code = hci_slip_write(mp_tx_buffer, 
-                                         (m_tx_buffer_length + PKT_HDR_SIZE + PKT_CRC_SIZE));  
-                APP_ERROR_CHECK(err_code);                                                  
-                tx_sm_state_change(TX_STATE_ACTIVE);                                              
-            }        
-            break;
-            
-        case TX_STATE_ACTIVE:
-            switch (event)
-            {
-                case TX_EVENT_VALID_RX_ACK:                    
-                    // Tx sequence number counter incremented as packet transmission 
-                    // acknowledged by peer transport entity.
-                    packet_number_tx_inc();                                  
-                    tx_sm_state_change(TX_STATE_IDLE);
-                    break;
-                    
-                case TX_EVENT_STATE_ENTRY:
-                    m_tx_retry_counter = 0;
-                    err_code = app_timer_start(m_app_timer_id, 
-                                               RETRANSMISSION_TIMEOUT_IN_TICKS, 
-                                               NULL);
-                    APP_ERROR_CHECK(err_code);
-                    break;
-                    
-                case TX_EVENT_TIMEOUT:
-                    if (m_tx_retry_counter != MAX_RETRY_COUNT)
-                    {
-                        ++m_tx_retry_counter;
-                        // @note: no return value check done for hci_slip_write(...) call as current 
-                        // system design allows use case where retransmission is not accepted by the 
-                        // slip layer due to existing acknowledgement packet transmission in the 
-                        // slip layer. 
-                        UNUSED_VARIABLE(hci_slip_write(mp_tx_buffer, 
-                                                      (m_tx_buffer_length + 
-                                                      PKT_HDR_SIZE        + 
-                                                      PKT_CRC_SIZE)));                
-                    }    
-                    else
-                    {
-                        // Application packet retransmission count reached: 
-                        // - set correct TX done event callback function result code
-                        // - execute state change    
-                        // @note: m_tx_retry_counter is reset in TX_STATE_ACTIVE state entry.
-                        m_tx_done_result_code = HCI_TRANSPORT_TX_DONE_FAILURE;         
-                        tx_sm_state_change(TX_STATE_IDLE);
-                    }                
-                    break;
-                    
-                default:
-                    // No implementation needed.
-                    break;
-            }
-            break;
-            
-        default:        
-            // No implementation needed.
+        if (tx_window_slot_get(offset)->p_buffer == p_pkt)
+        {
             break;
+        }
+    }
+    if (offset == m_tx_window_count)
+    {
+        return false;
     }
+
+    for (; (offset + 1u) < m_tx_window_count; ++offset)
+    {
+        tx_window_slot_t * p_slot = tx_window_slot_get(offset);
+
+        *p_slot = *tx_window_slot_get(offset + 1u);
+        pkt_seq_number_set(p_slot, (uint8_t)((m_packet_transmit_seq_number + offset) & 0x07u));
+    }
+    --m_tx_window_count;
+
+    return true;
 }
 
 
-/**@brief Function for changing the state of the TX state machine.
+/**@brief Function for starting the TX sequence number resynchronization.
  *
- * @param[in] new_state State TX state machine transits to.
+ * The peer may have received some of the outstanding packets with only the acknowledgements lost,
+ * so the sequence number it expects is unknown. The packets are kept, and SYNC packets are sent on
+ * every retransmission timeout until the peer answers with SYNC RESPONSE, see 
+ * @ref rx_link_ctrl_pkt_type_handle.
  */
-static void tx_sm_state_change(tx_state_t new_state)
+static void tx_resync_start(void)
 {
-    m_tx_state = new_state;
-    tx_sm_event_handle(TX_EVENT_STATE_ENTRY);
+    m_tx_resend_index  = 0;
+    m_tx_resend_end    = 0;
+    m_tx_retry_counter = 0;
+    m_is_tx_resync     = true;
+    m_is_sync_pending  = true;
+    m_tx_resync_round  = (m_tx_resync_round + 1u) & 0x07u;
+
+    ++m_stats.tx_resync_count;
+    retransmission_timer_restart();
+
+    const uint32_t err_code = tx_window_feed();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for completing every packet in the TX window as failed.
+ *
+ * Used when the peer does not answer the SYNCs either. The resynchronization continues, packets 
+ * written meanwhile are transmitted once the peer answers.
+ */
+static void tx_window_fail(void)
+{
+    const uint32_t failed_count = m_tx_window_count;
+
+    m_tx_window_count  = 0;
+    m_tx_sent_count    = 0;
+    m_tx_retry_counter = 0;
+
+    m_stats.tx_fail_count += failed_count;
+    tx_done_notify(HCI_TRANSPORT_TX_DONE_FAILURE, failed_count);
+}
+
+
+/**@brief Function for ending the TX sequence number resynchronization.
+ *
+ * The packets the peer received before the SYNC are completed, the others and the packets written
+ * while the resynchronization was in progress are renumbered from the initial sequence number and
+ * transmitted.
+ *
+ * @param[in] ack_number Acknowledge Number of the SYNC RESPONSE: the sequence number the peer 
+ *                       expected before the SYNC.
+ */
+static void tx_resync_complete(uint8_t ack_number)
+{
+    uint32_t offset;
+    uint32_t err_code;
+    uint32_t acked_count = (ack_number - m_packet_transmit_seq_number) & 0x07u;
+
+    err_code = app_timer_stop(m_app_timer_id);
+    APP_ERROR_CHECK(err_code);
+
+    if (acked_count > m_tx_sent_count)
+    {
+        // Packets completed as failed, or acknowledgement number outside the TX window.
+        acked_count = 0;
+    }
+
+    m_tx_window_head             = (m_tx_window_head + acked_count) % HCI_TRANSPORT_TX_WINDOW_SIZE;
+    m_tx_window_count           -= acked_count;
+    m_tx_sent_count              = 0;
+    m_tx_retry_counter           = 0;
+    m_is_tx_resync               = false;
+    m_packet_transmit_seq_number = INITIAL_ACK_NUMBER_TX;
+
+    for (offset = 0; offset < m_tx_window_count; ++offset)
+    {
+        pkt_seq_number_set(tx_window_slot_get(offset), 
+                           (uint8_t)((m_packet_transmit_seq_number + offset) & 0x07u));
+    }
+
+    tx_done_notify(HCI_TRANSPORT_TX_DONE_SUCCESS, acked_count);
+
+    err_code = tx_window_feed();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for processing a received link control packet.
+ *
+ * A SYNC restarts the reception from the initial sequence number and is answered by SYNC 
+ * RESPONSE. A SYNC RESPONSE ends an ongoing TX sequence number resynchronization. Other link 
+ * control messages are ignored.
+ *
+ * @param[in] p_buffer Pointer to the packet data. 
+ * @param[in] length   Length of packet data in bytes.  
+ */
+static void rx_link_ctrl_pkt_type_handle(const uint8_t * p_buffer, uint32_t length)
+{
+    // @note: no pointer validation check needed as allready checked by calling function.
+    uint32_t err_code;
+
+    const uint32_t expected_checksum = 
+        ((p_buffer[0] + p_buffer[1] + p_buffer[2] + p_buffer[3])) & 0xFFu;
+    if ((length != (PKT_HDR_SIZE + LINK_CTRL_PAYLOAD_SIZE)) || (expected_checksum != 0))
+    {
+        return;
+    }
+
+    switch (uint16_decode(&p_buffer[PKT_HDR_SIZE]))
+    {
+        case LINK_CTRL_SYNC:
+            // Repeated SYNCs of a resynchronization are answered alike, the peer sends nothing else
+            // until answered. A SYNC of a new resynchronization is answered with the sequence 
+            // number expected now, even if every packet since the previous one was lost.
+            if (!m_is_rx_resynced || (packet_seq_nmbr_extract(p_buffer) != m_rx_sync_round))
+            {
+                m_sync_rsp_ack_number = m_packet_expected_seq_number;
+                m_rx_sync_round       = packet_seq_nmbr_extract(p_buffer);
+                m_is_rx_resynced      = true;
+            }
+            m_packet_expected_seq_number = INITIAL_ACK_NUMBER_EXPECTED;
+            m_is_sync_rsp_pending        = true;
+
+            err_code = tx_window_feed();
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        case LINK_CTRL_SYNC_RSP:
+            // Answers to repeated SYNCs arrive after the first one has ended the resynchronization.
+            if (m_is_tx_resync && (packet_seq_nmbr_extract(p_buffer) == m_tx_resync_round))
+            {
+                tx_resync_complete((p_buffer[0] >> 3u) & 0x07u);
+            }
+            break;
+
+        default:
+            break;
+    }
 }
 
 
@@ -475,7 +837,8 @@ void slip_event_handle(hci_slip_evt_t event)
     switch (event.evt_type)
     {
         case HCI_SLIP_TX_DONE:   
-            tx_sm_event_handle(TX_EVENT_SLIP_TX_DONE);
+            err_code = tx_window_feed();
+            APP_ERROR_CHECK(err_code);
             break;
             
         case HCI_SLIP_RX_RDY:
@@ -488,38 +851,17 @@ void slip_event_handle(hci_slip_evt_t event)
                     break;
                     
                 case PKT_TYPE_ACK:
-                    if (rx_ack_pkt_type_handle(event.packet))
-                    {
-                        // Valid expected acknowledgement packet received: set correct TX done event 
-                        // callback function result code and execute state change.
-                        m_tx_done_result_code = HCI_TRANSPORT_TX_DONE_SUCCESS; 
-                        tx_sm_event_handle(TX_EVENT_VALID_RX_ACK);
-                    }
-                
-                /* fall-through */                
+                    rx_ack_pkt_type_handle(event.packet);
+                    rx_buffer_reset();
+                    break;
+
+                case PKT_TYPE_LINK_CONTROL:
+                    rx_link_ctrl_pkt_type_handle(event.packet, event.packet_length);
+                    rx_buffer_reset();
+                    break;
+
                 default:
-                    // RX packet dropped: reset memory buffer to slip in order to avoid RX buffer 
-                    // overflow. 
-                    // If existing mem pool produced RX buffer exists reuse that one. If existing 
-                    // mem pool produced RX buffer does not exist try to produce new one. If 
-                    // producing fails use the internal acknowledgement buffer.                    
-                    if (mp_slip_used_rx_buffer != NULL)
-                    {
-                        err_code = hci_slip_rx_buffer_register(mp_slip_used_rx_buffer, RX_BUF_SIZE);                                                            
-                        APP_ERROR_CHECK(err_code);                                                                
-                    }
-                    else
-                    {
-                        err_code = hci_mem_pool_rx_produce(RX_BUF_SIZE, 
-                                                           (void **)&mp_slip_used_rx_buffer); 
-                        APP_ERROR_CHECK_BOOL((err_code == NRF_SUCCESS) || 
-                                            (err_code == NRF_ERROR_NO_MEM));
-
-                        err_code = hci_slip_rx_buffer_register(
-                            (err_code == NRF_SUCCESS) ? mp_slip_used_rx_buffer : m_rx_ack_buffer, 
-                            (err_code == NRF_SUCCESS) ? RX_BUF_SIZE : ACK_BUF_SIZE);            
-                        APP_ERROR_CHECK(err_code);                                                                
-                    }
+                    rx_buffer_reset();
                     break;
             }
             break;
@@ -576,20 +918,72 @@ uint32_t hci_transport_tx_done_register(hci_transport_tx_done_handler_t event_ha
  */
 void hci_transport_timeout_handle(void * p_context)
 {
-    tx_sm_event_handle(TX_EVENT_TIMEOUT);
+    uint32_t err_code;
+
+    if (m_is_tx_resync)
+    {
+        // SYNC or SYNC RESPONSE lost: repeat the SYNC. Without an answer to MAX_RETRY_COUNT SYNCs
+        // the outstanding packets are failed.
+        if (m_tx_retry_counter != MAX_RETRY_COUNT)
+        {
+            ++m_tx_retry_counter;
+        }
+        else if (m_tx_window_count != 0)
+        {
+            tx_window_fail();
+        }
+        m_is_sync_pending = true;
+
+        err_code = tx_window_feed();
+        APP_ERROR_CHECK(err_code);
+        return;
+    }
+
+    if (m_tx_sent_count == 0)
+    {
+        return;
+    }
+
+    if (m_tx_retry_counter != MAX_RETRY_COUNT)
+    {
+        ++m_tx_retry_counter;
+        ++m_stats.tx_timeout_count;
+
+        // Start a retransmission round over the packets transmitted so far, oldest first.
+        m_tx_resend_index = 0;
+        m_tx_resend_end   = m_tx_sent_count;
+
+        err_code = tx_window_feed();
+        APP_ERROR_CHECK(err_code);
+    }
+    else
+    {
+        tx_resync_start();
+    }
 }
 
 
 uint32_t hci_transport_open(void)
 {
-    mp_tx_buffer                 = NULL;
-    m_tx_buffer_length           = 0;
+    m_tx_window_head             = 0;
+    m_tx_window_count            = 0;
+    m_tx_sent_count              = 0;
+    m_tx_resend_index            = 0;
+    m_tx_resend_end              = 0;
     m_tx_retry_counter           = 0;
-    m_is_slip_decode_ready       = false;
-    m_tx_state                   = TX_STATE_IDLE;
+    m_is_ack_pending             = false;
+    m_is_sync_pending            = false;
+    m_is_sync_rsp_pending        = false;
+    m_is_tx_resync               = false;
+    m_is_rx_resynced             = false;
+    m_sync_rsp_ack_number        = INITIAL_ACK_NUMBER_EXPECTED;
+    m_tx_resync_round            = 0;
+    m_rx_sync_round              = 0;
+    m_is_tx_feeding              = false;
+    m_is_tx_feed_requested       = false;
+    m_rx_ready_count             = 0;
     m_packet_expected_seq_number = INITIAL_ACK_NUMBER_EXPECTED;
     m_packet_transmit_seq_number = INITIAL_ACK_NUMBER_TX;
-    m_tx_done_result_code        = HCI_TRANSPORT_TX_DONE_FAILURE;
     
     uint32_t err_code = app_timer_create(&m_app_timer_id, 
                                          APP_TIMER_MODE_REPEATED, 
@@ -660,66 +1054,79 @@ uint32_t hci_transport_tx_alloc(uint8_t ** pp_memory)
 }
 
 
+uint32_t hci_transport_tx_alloc_sized(uint32_t length, uint8_t ** pp_memory)
+{
+    const uint32_t err_code = hci_mem_pool_tx_alloc_sized((length + PKT_HDR_SIZE + PKT_CRC_SIZE), 
+                                                          (void **)pp_memory);    
+    if (err_code == NRF_SUCCESS)
+    {
+        //lint -e(413) "Likely use of null pointer"        
+        *pp_memory += PKT_HDR_SIZE; 
+    }
+    
+    return err_code;
+}
+
+
 uint32_t hci_transport_tx_free(void)
 {
     return hci_mem_pool_tx_free();
 }
 
 
+uint32_t hci_transport_tx_buffer_free(uint8_t * p_memory)
+{
+    return hci_mem_pool_tx_buffer_free(p_memory - PKT_HDR_SIZE);
+}
+
+
 /**@brief Function for constructing 1st byte of the packet header of the packet to be transmitted.
+ *
+ * @param[in] seq_number Sequence number of the packet to be transmitted.
  *
  * @return 1st byte of the packet header of the packet to be transmitted
  */
-static __INLINE uint8_t tx_packet_byte_zero_construct(void)
+static __INLINE uint8_t tx_packet_byte_zero_construct(uint8_t seq_number)
 {
     const uint32_t value = DATA_INTEGRITY_MASK                  | 
                            RELIABLE_PKT_MASK                    | 
                            (packet_number_expected_get() << 3u) | 
-                           packet_number_to_transmit_get();   
+                           seq_number;   
     
     return (uint8_t) value;
 }
 
 
-/**@brief Function for handling the application packet write request in tx-idle state.
+/**@brief Function for constructing an application packet into a TX window slot.
+ *
+ * @param[out] p_slot     TX window slot.
+ * @param[in]  p_buffer   Application packet data, preceded by space reserved for the header.
+ * @param[in]  length     Length of application packet data in bytes.
+ * @param[in]  seq_number Sequence number of the packet.
  */
-static uint32_t pkt_write_handle(void)
+static void pkt_construct(tx_window_slot_t * p_slot, 
+                          uint8_t *          p_buffer, 
+                          uint32_t           length, 
+                          uint8_t            seq_number)
 {   
-    uint32_t err_code;     
-    
     // Set packet header fields.
 
-    mp_tx_buffer   -= PKT_HDR_SIZE;
-    mp_tx_buffer[0] = tx_packet_byte_zero_construct();
+    p_slot->p_buffer = p_buffer - PKT_HDR_SIZE;
+    p_slot->length   = length + PKT_HDR_SIZE + PKT_CRC_SIZE;
+
+    uint8_t * p_pkt = p_slot->p_buffer;
+    p_pkt[0]        = tx_packet_byte_zero_construct(seq_number);
                 
-    const uint16_t type_and_length_fields = ((m_tx_buffer_length << 4u) | PKT_TYPE_VENDOR_SPECIFIC);            
+    const uint16_t type_and_length_fields = ((length << 4u) | PKT_TYPE_VENDOR_SPECIFIC);            
     // @note: no use case for uint16_encode(...) return value.
-    UNUSED_VARIABLE(uint16_encode(type_and_length_fields, &(mp_tx_buffer[1])));
-    mp_tx_buffer[3] = header_checksum_calculate(mp_tx_buffer);
+    UNUSED_VARIABLE(uint16_encode(type_and_length_fields, &(p_pkt[1])));
+    p_pkt[3] = header_checksum_calculate(p_pkt);
     
-    // Calculate, append CRC to the packet and write it.
+    // Calculate and append CRC to the packet.
         
-    const uint16_t crc = crc16_compute(mp_tx_buffer, (PKT_HDR_SIZE + m_tx_buffer_length), NULL);
+    const uint16_t crc = crc16_compute(p_pkt, (PKT_HDR_SIZE + length), NULL);
     // @note: no use case for uint16_encode(...) return value.
-    UNUSED_VARIABLE(uint16_encode(crc, &(mp_tx_buffer[PKT_HDR_SIZE + m_tx_buffer_length])));        
-    err_code = hci_slip_write(mp_tx_buffer, (m_tx_buffer_length + PKT_HDR_SIZE + PKT_CRC_SIZE));        
-    switch (err_code)
-    {
-        case NRF_SUCCESS:
-            tx_sm_state_change(TX_STATE_ACTIVE);
-            break;
-                
-        case NRF_ERROR_NO_MEM:
-            tx_sm_state_change(TX_STATE_PENDING);            
-            err_code = NRF_SUCCESS;
-            break;
-                
-        default:
-            // No implementation needed.
-            break;
-    }
-    
-    return err_code;
+    UNUSED_VARIABLE(uint16_encode(crc, &(p_pkt[PKT_HDR_SIZE + length])));        
 }
 
 
@@ -729,17 +1136,27 @@ uint32_t hci_transport_pkt_write(const uint8_t * p_buffer, uint32_t length)
     
     if (p_buffer)
     {          
-        switch (m_tx_state)
+        if (m_tx_window_count != HCI_TRANSPORT_TX_WINDOW_SIZE)
         {
-            case TX_STATE_IDLE:
-                mp_tx_buffer       = (uint8_t *)p_buffer;
-                m_tx_buffer_length = length;            
-                err_code = pkt_write_handle();
-                break;
-                
-            default:
-                err_code = NRF_ERROR_NO_MEM;
-                break;
+            pkt_construct(tx_window_slot_get(m_tx_window_count), 
+                          (uint8_t *)p_buffer, 
+                          length, 
+                          (uint8_t)((m_packet_transmit_seq_number + m_tx_window_count) & 0x07u));
+            ++m_tx_window_count;
+
+            err_code = tx_window_feed();
+            if ((err_code == NRF_SUCCESS) || 
+                !tx_window_unsent_remove((uint8_t *)p_buffer - PKT_HDR_SIZE))
+            {
+                // Packet delivered: a slip layer error concerned a packet written after it from a 
+                // TX done handler, which is delivered again upon retransmission timeout.
+                err_code = NRF_SUCCESS;
+                ++m_stats.tx_pkt_count;
+            }
+        }
+        else
+        {
+            err_code = NRF_ERROR_NO_MEM;
         }
     }
     else
@@ -757,9 +1174,10 @@ uint32_t hci_transport_rx_pkt_extract(uint8_t ** pp_buffer, uint32_t * p_length)
     
     if (pp_buffer != NULL && p_length != NULL)
     {
-        if (m_is_slip_decode_ready)
+        // Every RX_RDY event allows one extraction, more than one packet may be waiting.
+        if (m_rx_ready_count != 0)
         {
-            m_is_slip_decode_ready = false;
+            --m_rx_ready_count;
             err_code               = hci_mem_pool_rx_extract(pp_buffer, p_length);
             *p_length             -= (PKT_HDR_SIZE + PKT_CRC_SIZE);
             *pp_buffer            += PKT_HDR_SIZE;
@@ -782,3 +1200,15 @@ uint32_t hci_transport_rx_pkt_consume(uint8_t * p_buffer)
 {
     return (hci_mem_pool_rx_consume(p_buffer - PKT_HDR_SIZE));     
 }
+
+
+void hci_transport_stats_get(hci_transport_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+
+void hci_transport_stats_reset(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
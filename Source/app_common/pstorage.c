@@ -685,6 +685,33 @@ uint32_t pstorage_clear(pstorage_handle_t * p_dest, pstorage_size_t size)
 }
 
 
+/**
+ * @brief API to clear a number of pages of a module.
+ */
+uint32_t pstorage_page_clear(pstorage_handle_t * p_dest, pstorage_size_t page_count)
+{
+    uint32_t base_page;
+    uint32_t first_page;
+
+    VERIFY_MODULE_INITIALIZED();
+    NULL_PARAM_CHECK(p_dest);
+    MODULE_ID_RANGE_CHECK(p_dest);
+    BLOCK_ID_RANGE_CHECK(p_dest);
+
+    base_page  = m_app_table[p_dest->module_id].base_id / PSTORAGE_FLASH_PAGE_SIZE;
+    first_page = p_dest->block_id / PSTORAGE_FLASH_PAGE_SIZE;
+
+    // Only the pages of the module may be erased.
+    if ((page_count == 0) ||
+        ((first_page - base_page + page_count) > m_app_table[p_dest->module_id].no_of_pages))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    return cmd_queue_enqueue(PSTORAGE_CLEAR_OP_CODE, p_dest, NULL, page_count, 0);
+}
+
+
 #ifdef PSTORAGE_RAW_MODE_ENABLE
 
 /**
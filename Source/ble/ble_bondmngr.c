@@ -29,9 +29,21 @@
 #define CCCD_SIZE                    6                                                                   /**< Number of bytes needed for storing the state of one CCCD. */
 #define CRC_SIZE                     2                                                                   /**< Size of CRC in sys_attribute data. */
 #define SYS_ATTR_BUFFER_MAX_LEN      (((BLE_BONDMNGR_CCCD_COUNT + 1) * CCCD_SIZE) + CRC_SIZE)            /**< Size of sys_attribute data. */
-#define MAX_NUM_CENTRAL_WHITE_LIST   MIN(BLE_BONDMNGR_MAX_BONDED_CENTRALS, 8)                            /**< Maximum number of whitelisted centrals supported.*/
-#define MAX_BONDS_IN_FLASH           10                                                                  /**< Maximum number of bonds that can be stored in flash. */
-#define BOND_MANAGER_DATA_SIGNATURE  0x53240000
+#define MAX_NUM_CENTRAL_WHITE_LIST   MIN(BLE_BONDMNGR_MAX_BONDED_CENTRALS, BLE_GAP_WHITELIST_ADDR_MAX_COUNT) /**< Maximum number of centrals in the whitelist given to the stack at a time.*/
+#define MAX_BONDS_IN_FLASH           MAX(10, BLE_BONDMNGR_MAX_BONDED_CENTRALS + 4)                       /**< Maximum number of records that can be stored in flash, with room for appending changes. */
+
+/**@brief Number of slots in each central index, a power of two at least twice the number of centrals. */
+#define CENTRAL_INDEX_SIZE           ((BLE_BONDMNGR_MAX_BONDED_CENTRALS <= 4)  ? 8  :                     \
+                                      (BLE_BONDMNGR_MAX_BONDED_CENTRALS <= 8)  ? 16 :                     \
+                                      (BLE_BONDMNGR_MAX_BONDED_CENTRALS <= 16) ? 32 :                     \
+                                      (BLE_BONDMNGR_MAX_BONDED_CENTRALS <= 32) ? 64 : 128)
+#define CENTRAL_INDEX_MASK           (CENTRAL_INDEX_SIZE - 1)                                            /**< Mask for turning a hash into an index slot. */
+#define CENTRAL_INDEX_HASH_MUL       2654435761UL                                                        /**< Multiplier of the index hash (Knuth's multiplicative hashing). */
+#define BOND_MANAGER_DATA_SIGNATURE  0x53000000                                                          /**< Signature in the top byte of the header of each record in flash. */
+#define BOND_MANAGER_DATA_VERSION    0x25                                                                /**< Record format with a CRC of the record itself. */
+#define BOND_MANAGER_DATA_VERSION_LEGACY 0x24                                                            /**< Record format with a CRC chained over all records before it. */
+#define BOND_MANAGER_HEADER_VERSION_POS  16                                                              /**< Position of the format version in a record header. */
+#define BOND_MANAGER_HEADER_EMPTY    0xFFFFFFFFU                                                         /**< Value of an erased flash word. */
 
 /**@defgroup ble_bond_mngr_sec_access  Bond Manager Security Status Access Macros
  * @brief    The following group of macros abstract access to Security Status with a peer.
@@ -179,12 +191,16 @@ static uint16_t            m_conn_handle;                                   /**<
 static central_t           m_central;                                       /**< Current central data. */
 static central_t           m_centrals_db[BLE_BONDMNGR_MAX_BONDED_CENTRALS]; /**< Pointer to start of bonded centrals database. */
 static uint8_t             m_centrals_in_db_count;                          /**< Number of bonded centrals. */
-static whitelist_addr_t    m_whitelist_addr[MAX_NUM_CENTRAL_WHITE_LIST];    /**< List of central's addresses  for the whitelist. */
-static whitelist_irk_t     m_whitelist_irk[MAX_NUM_CENTRAL_WHITE_LIST];     /**< List of central's IRKs  for the whitelist. */
+static whitelist_addr_t    m_whitelist_addr[BLE_BONDMNGR_MAX_BONDED_CENTRALS]; /**< List of central's addresses  for the whitelist. */
+static whitelist_irk_t     m_whitelist_irk[BLE_BONDMNGR_MAX_BONDED_CENTRALS];  /**< List of central's IRKs  for the whitelist. */
 static uint8_t             m_addr_count;                                    /**< Number of addresses in the whitelist. */
 static uint8_t             m_irk_count;                                     /**< Number of IRKs in the whitelist. */
-static uint16_t            m_crc_bond_info;                                 /**< Combined CRC for all Bonding Information currently stored in flash. */
-static uint16_t            m_crc_sys_attr;                                  /**< Combined CRC for all System Attributes currently stored in flash. */
+static uint8_t             m_whitelist_offset;                              /**< Start of the whitelist window given to the stack, see ble_bondmngr_whitelist_rotate(). */
+static int8_t              m_whitelist_irk_handles[MAX_NUM_CENTRAL_WHITE_LIST]; /**< Handles of the centrals in the IRK window given to the stack, indexed by IRK match index. */
+static int8_t              m_div_index[CENTRAL_INDEX_SIZE];                 /**< Open addressing index of the central handles by encryption diversifier. */
+static int8_t              m_addr_index[CENTRAL_INDEX_SIZE];                /**< Open addressing index of the central handles by address, for centrals without a resolvable address. */
+static uint16_t            m_crc_bond_info;                                 /**< Chained CRC of the Bonding Information loaded from flash, for checking legacy records. */
+static uint16_t            m_crc_sys_attr;                                  /**< Chained CRC of the System Attributes loaded from flash, for checking legacy records. */
 static pstorage_handle_t   mp_flash_bond_info;                              /**< Pointer to flash location to write next Bonding Information. */
 static pstorage_handle_t   mp_flash_sys_attr;                               /**< Pointer to flash location to write next System Attribute information. */
 static uint8_t             m_bond_info_in_flash_count;                      /**< Number of Bonding Information currently stored in flash. */
@@ -192,28 +208,53 @@ static uint8_t             m_sys_attr_in_flash_count;                       /**<
 static uint8_t             m_sec_con_status;                                /**< Variable to denote security status.*/
 static bool                m_bond_loaded;                                   /**< Variable to indicate if the bonding information of the currently connected central is available in the RAM.*/
 static bool                m_sys_attr_loaded;                               /**< Variable to indicate if the system attribute information of the currently connected central is loaded from the database and set in the S110 SoftDevice.*/
-static uint32_t            m_bond_crc_array[BLE_BONDMNGR_MAX_BONDED_CENTRALS];
-static uint32_t            m_sys_crc_array[BLE_BONDMNGR_MAX_BONDED_CENTRALS];
+static uint32_t            m_bond_crc_array[MAX_BONDS_IN_FLASH];            /**< Headers of the Bonding Information records, kept until written to flash. */
+static uint32_t            m_sys_crc_array[MAX_BONDS_IN_FLASH];             /**< Headers of the System Attributes records, kept until written to flash. */
+static uint32_t            m_bond_header_in_flash[BLE_BONDMNGR_MAX_BONDED_CENTRALS];     /**< Header of the latest Bonding Information record of each central in flash, 0 if none. */
+static uint32_t            m_sys_attr_header_in_flash[BLE_BONDMNGR_MAX_BONDED_CENTRALS]; /**< Header of the latest System Attributes record of each central in flash, 0 if none. */
 
-/**@brief      Function for extracting the CRC from an encoded 32 bit number that typical resides in
- *             the flash memory
+/**@brief      Function for making the header of a record to be written to flash.
  *
- * @param[in]  header   Header containing CRC and magic number.
- * @param[out] p_crc    Extracted CRC.
+ * @param[in]  p_record   Record.
+ * @param[in]  size       Size of the record.
+ *
+ * @return     Header with the signature, the format version and the CRC of the record.
+ */
+static uint32_t record_header(const void * p_record, uint16_t size)
+{
+    return BOND_MANAGER_DATA_SIGNATURE                                              |
+           ((uint32_t)BOND_MANAGER_DATA_VERSION << BOND_MANAGER_HEADER_VERSION_POS) |
+           crc16_compute((const uint8_t *)p_record, size, NULL);
+}
+
+
+/**@brief      Function for extracting the CRC and format version from an encoded 32 bit number
+ *             that typical resides in the flash memory
+ *
+ * @param[in]  header      Header containing CRC, format version and magic number.
+ * @param[out] p_crc       Extracted CRC.
+ * @param[out] p_version   Extracted format version.
  *
  * @retval      NRF_SUCCESS              CRC successfully extracted.
  * @retval      NRF_ERROR_NOT_FOUND      Flash seems to be empty.
- * @retval      NRF_ERROR_INVALID_DATA   Header does not contain the magic number.
+ * @retval      NRF_ERROR_INVALID_DATA   Header does not contain the magic number, or has an
+ *                                       unknown format version.
  */
-static uint32_t crc_extract(uint32_t header, uint16_t * p_crc)
+static uint32_t crc_extract(uint32_t header, uint16_t * p_crc, uint8_t * p_version)
 {
-    if ((header & 0xFFFF0000U) == BOND_MANAGER_DATA_SIGNATURE)
+    uint8_t version = (uint8_t)(header >> BOND_MANAGER_HEADER_VERSION_POS);
+
+    if (
+        ((header & 0xFF000000U) == BOND_MANAGER_DATA_SIGNATURE) &&
+        ((version == BOND_MANAGER_DATA_VERSION) || (version == BOND_MANAGER_DATA_VERSION_LEGACY))
+       )
     {
-        *p_crc = (uint16_t)(header & 0x0000FFFFU);
+        *p_crc     = (uint16_t)(header & 0x0000FFFFU);
+        *p_version = version;
 
         return NRF_SUCCESS;
     }
-    else if (header == 0xFFFFFFFFU)
+    else if (header == BOND_MANAGER_HEADER_EMPTY)
     {
         return NRF_ERROR_NOT_FOUND;
     }
@@ -224,11 +265,59 @@ static uint32_t crc_extract(uint32_t header, uint16_t * p_crc)
 }
 
 
-/**@brief      Function for storing the Bonding Information of the specified central to the flash.
+/**@brief      Function for reading the header of a flash block and checking if the block is used.
+ *
+ * @details    A block with an empty header is still used if the write of its record was
+ *             interrupted before the header was written. This is detected from the first word of
+ *             the record, the central handle, which is never empty in a written record.
+ *
+ * @param[in]  p_block    Flash block.
+ * @param[out] p_crc      CRC from the header.
+ * @param[out] p_version  Format version from the header.
+ *
+ * @retval     NRF_SUCCESS              Header is valid.
+ * @retval     NRF_ERROR_NOT_FOUND      Block is empty.
+ * @retval     NRF_ERROR_INVALID_DATA   Block is used, but does not hold a valid record.
+ */
+static uint32_t block_header_load(pstorage_handle_t * p_block, uint16_t * p_crc, uint8_t * p_version)
+{
+    uint32_t err_code;
+    uint32_t header;
+    uint32_t first_word;
+
+    err_code = pstorage_load((uint8_t *)&header, p_block, sizeof(uint32_t), 0);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = crc_extract(header, p_crc, p_version);
+    if (err_code == NRF_ERROR_NOT_FOUND)
+    {
+        err_code = pstorage_load((uint8_t *)&first_word, p_block, sizeof(uint32_t), sizeof(uint32_t));
+        if ((err_code == NRF_SUCCESS) && (first_word != BOND_MANAGER_HEADER_EMPTY))
+        {
+            err_code = NRF_ERROR_INVALID_DATA;
+        }
+        else if (err_code == NRF_SUCCESS)
+        {
+            err_code = NRF_ERROR_NOT_FOUND;
+        }
+    }
+
+    return err_code;
+}
+
+
+/**@brief      Function for appending the Bonding Information of the specified central to the flash.
+ *
+ * @details    The record is written to the next free block, and supersedes any earlier record of
+ *             the same central. No flash page is erased.
  *
  * @param[in]  p_bond   Bonding information to be stored.
  *
- * @return     NRF_SUCCESS on success, an error_code otherwise.
+ * @return     NRF_SUCCESS on success, NRF_ERROR_NO_MEM if the flash page is full, an error_code
+ *             otherwise.
  */
 static uint32_t bond_info_store(central_bond_t * p_bond)
 {
@@ -241,13 +330,6 @@ static uint32_t bond_info_store(central_bond_t * p_bond)
         return NRF_ERROR_NO_MEM;
     }
 
-    // Check if this is the first bond to be stored
-    if (m_bond_info_in_flash_count == 0)
-    {
-        // Initialize CRC
-        m_crc_bond_info = crc16_compute(NULL, 0, NULL);
-    }
-
     // Get block pointer from base
     err_code = pstorage_block_identifier_get(&mp_flash_bond_info,m_bond_info_in_flash_count,&dest_block);
     if (err_code != NRF_SUCCESS)
@@ -265,12 +347,9 @@ static uint32_t bond_info_store(central_bond_t * p_bond)
     {
         return err_code;
     }
-    m_crc_bond_info = crc16_compute((uint8_t *)p_bond,
-                                     sizeof(central_bond_t),
-                                     &m_crc_bond_info);
 
-    // Write header
-    m_bond_crc_array[m_bond_info_in_flash_count] = (BOND_MANAGER_DATA_SIGNATURE | m_crc_bond_info);
+    // Write header, after the record, so an interrupted write leaves no valid header.
+    m_bond_crc_array[m_bond_info_in_flash_count] = record_header(p_bond, sizeof(central_bond_t));
 
     err_code = pstorage_store (&dest_block, (uint8_t *)&m_bond_crc_array[m_bond_info_in_flash_count],sizeof(uint32_t),0);
     if (err_code != NRF_SUCCESS)
@@ -278,16 +357,25 @@ static uint32_t bond_info_store(central_bond_t * p_bond)
         return err_code;
     }
 
+    if ((p_bond->central_handle >= 0) && (p_bond->central_handle < BLE_BONDMNGR_MAX_BONDED_CENTRALS))
+    {
+        m_bond_header_in_flash[p_bond->central_handle] = m_bond_crc_array[m_bond_info_in_flash_count];
+    }
+
     m_bond_info_in_flash_count++;
     return NRF_SUCCESS;
 }
 
 
-/**@brief      Function for storing the System Attributes related to a specified central in flash.
+/**@brief      Function for appending the System Attributes related to a specified central to flash.
+ *
+ * @details    The record is written to the next free block, and supersedes any earlier record of
+ *             the same central. No flash page is erased.
  *
  * @param[in]  p_sys_attr   System Attributes to be stored.
  *
- * @return     NRF_SUCCESS on success, an error_code otherwise.
+ * @return     NRF_SUCCESS on success, NRF_ERROR_NO_MEM if the flash page is full, an error_code
+ *             otherwise.
  */
 static uint32_t sys_attr_store(central_sys_attr_t * p_sys_attr)
 {
@@ -300,14 +388,6 @@ static uint32_t sys_attr_store(central_sys_attr_t * p_sys_attr)
         return NRF_ERROR_NO_MEM;
     }
 
-    // Check if this is the first time any System Attributes is stored.
-    if (m_sys_attr_in_flash_count == 0)
-    {
-        // Initialize CRC
-        m_crc_sys_attr = crc16_compute(NULL, 0, NULL);
-    }
-
-
     // Get block pointer from base
     err_code = pstorage_block_identifier_get(&mp_flash_sys_attr,m_sys_attr_in_flash_count,&dest_block);
     if (err_code != NRF_SUCCESS)
@@ -325,12 +405,10 @@ static uint32_t sys_attr_store(central_sys_attr_t * p_sys_attr)
     {
         return err_code;
     }
-    m_crc_sys_attr = crc16_compute((uint8_t *)p_sys_attr,
-                                             sizeof(central_sys_attr_t),
-                                             &m_crc_sys_attr);
 
-    // Write header.
-    m_sys_crc_array[m_sys_attr_in_flash_count] = (BOND_MANAGER_DATA_SIGNATURE | m_crc_sys_attr);
+    // Write header, after the record, so an interrupted write leaves no valid header.
+    m_sys_crc_array[m_sys_attr_in_flash_count] = record_header(p_sys_attr,
+                                                               sizeof(central_sys_attr_t));
 
     err_code = pstorage_store (&dest_block,
                                (uint8_t *)&m_sys_crc_array[m_sys_attr_in_flash_count],
@@ -341,25 +419,40 @@ static uint32_t sys_attr_store(central_sys_attr_t * p_sys_attr)
         return err_code;
     }
 
+    if (
+        (p_sys_attr->central_handle >= 0) &&
+        (p_sys_attr->central_handle < BLE_BONDMNGR_MAX_BONDED_CENTRALS)
+       )
+    {
+        m_sys_attr_header_in_flash[p_sys_attr->central_handle] =
+            m_sys_crc_array[m_sys_attr_in_flash_count];
+    }
+
     m_sys_attr_in_flash_count++;
 
-    
     return NRF_SUCCESS;
 }
 
 
-/**@brief      Function for loading the Bonding Information of one central from flash.
+/**@brief      Function for loading the next Bonding Information record from flash.
+ *
+ * @details    Records in the current format are checked against their own CRC, legacy records
+ *             against the CRC chained over all records before them.
  *
  * @param[out] p_bond   Loaded Bonding Information.
  *
- * @return     NRF_SUCCESS on success, otherwise an error code.
+ * @retval     NRF_SUCCESS              Record loaded.
+ * @retval     NRF_ERROR_NOT_FOUND      No more records in flash.
+ * @retval     NRF_ERROR_INVALID_DATA   Record is corrupted, e.g. by an interrupted write, and is
+ *                                      skipped.
  */
 static uint32_t bonding_info_load_from_flash(central_bond_t * p_bond)
 {
     pstorage_handle_t source_block;
     uint32_t          err_code;
-    uint32_t          crc;
     uint16_t          crc_header;
+    uint8_t           version;
+    uint16_t          crc;
     
     // Check if this is the first bond to be loaded, in which case the
     // m_bond_info_in_flash_count variable would have the intial value 0.
@@ -377,15 +470,15 @@ static uint32_t bonding_info_load_from_flash(central_bond_t * p_bond)
     {
         return err_code;
     }
-        
-    err_code = pstorage_load((uint8_t *)&crc, &source_block, sizeof(uint32_t), 0);
-    if (err_code != NRF_SUCCESS)
+
+    err_code = block_header_load(&source_block, &crc_header, &version);
+    if (err_code == NRF_ERROR_NOT_FOUND)
     {
         return err_code;
     }
 
-    // Extract CRC from header.
-    err_code = crc_extract(crc, &crc_header);
+    // The block is in use from here on, even if its record is not valid.
+    m_bond_info_in_flash_count++;
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -405,31 +498,39 @@ static uint32_t bonding_info_load_from_flash(central_bond_t * p_bond)
     m_crc_bond_info = crc16_compute((uint8_t *)p_bond,
                                     sizeof(central_bond_t),
                                     &m_crc_bond_info);
-    if (m_crc_bond_info == crc_header)
+    if (version == BOND_MANAGER_DATA_VERSION_LEGACY)
     {
-        m_bond_info_in_flash_count++;
-        return NRF_SUCCESS;
+        crc = m_crc_bond_info;
     }
     else
     {
-        return NRF_ERROR_INVALID_DATA;
+        crc = crc16_compute((uint8_t *)p_bond, sizeof(central_bond_t), NULL);
     }
+
+    return (crc == crc_header) ? NRF_SUCCESS : NRF_ERROR_INVALID_DATA;
 }
 
 
 
-/**@brief      Function for loading the System Attributes related to one central from flash.
+/**@brief      Function for loading the next System Attributes record from flash.
+ *
+ * @details    Records in the current format are checked against their own CRC, legacy records
+ *             against the CRC chained over all records before them.
  *
  * @param[out] p_sys_attr   Loaded System Attributes.
  *
- * @return     NRF_SUCCESS on success, otherwise an error code.
+ * @retval     NRF_SUCCESS              Record loaded.
+ * @retval     NRF_ERROR_NOT_FOUND      No more records in flash.
+ * @retval     NRF_ERROR_INVALID_DATA   Record is corrupted, e.g. by an interrupted write, and is
+ *                                      skipped.
  */
 static uint32_t sys_attr_load_from_flash(central_sys_attr_t * p_sys_attr)
 {
     pstorage_handle_t source_block;
     uint32_t err_code;
-    uint32_t crc;
     uint16_t crc_header;
+    uint8_t  version;
+    uint16_t crc;
 
     // Check if this is the first time System Attributes is loaded from flash, in which case the
     // m_sys_attr_in_flash_count variable would have the initial value 0.
@@ -448,14 +549,14 @@ static uint32_t sys_attr_load_from_flash(central_sys_attr_t * p_sys_attr)
         return err_code;
     }
     
-    err_code = pstorage_load((uint8_t *)&crc, &source_block, sizeof(uint32_t), 0);
-    if (err_code != NRF_SUCCESS)
+    err_code = block_header_load(&source_block, &crc_header, &version);
+    if (err_code == NRF_ERROR_NOT_FOUND)
     {
         return err_code;
     }
-    
-    // Extract CRC from header.
-    err_code = crc_extract(crc, &crc_header);
+
+    // The block is in use from here on, even if its record is not valid.
+    m_sys_attr_in_flash_count++;
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -474,16 +575,16 @@ static uint32_t sys_attr_load_from_flash(central_sys_attr_t * p_sys_attr)
     m_crc_sys_attr = crc16_compute((uint8_t *)p_sys_attr,
                                    sizeof(central_sys_attr_t),
                                    &m_crc_sys_attr);
-
-    if (m_crc_sys_attr == crc_header)
+    if (version == BOND_MANAGER_DATA_VERSION_LEGACY)
     {
-        m_sys_attr_in_flash_count++;
-        return NRF_SUCCESS;
+        crc = m_crc_sys_attr;
     }
     else
     {
-        return NRF_ERROR_INVALID_DATA;
+        crc = crc16_compute((uint8_t *)p_sys_attr, sizeof(central_sys_attr_t), NULL);
     }
+
+    return (crc == crc_header) ? NRF_SUCCESS : NRF_ERROR_INVALID_DATA;
 }
 
 
@@ -503,52 +604,162 @@ static uint32_t flash_pages_erase(void)
         err_code = pstorage_clear(&mp_flash_sys_attr, MAX_BONDS_IN_FLASH);
     }
 
+    m_bond_info_in_flash_count = 0;
+    m_sys_attr_in_flash_count  = 0;
+    memset(m_bond_header_in_flash, 0, sizeof(m_bond_header_in_flash));
+    memset(m_sys_attr_header_in_flash, 0, sizeof(m_sys_attr_header_in_flash));
+
     return err_code;
 }
 
 
-/**@brief      Function for checking if Bonding Information in RAM is different from that in
- *             flash.
+/**@brief      Function for compacting the Bonding Information flash page.
+ *
+ * @details    Erases the page and writes the current record of each central in the database, so
+ *             the superseded records are dropped.
  *
- * @return     TRUE if Bonding Information in flash and RAM are different, FALSE otherwise.
+ * @return     NRF_SUCCESS on success, otherwise an error code.
  */
-static bool bond_info_changed(void)
+static uint32_t bond_info_compact(void)
 {
+    uint32_t err_code;
     int      i;
-    uint16_t crc = crc16_compute(NULL, 0, NULL);
 
-    // Compute CRC for all bonds in database.
+    err_code = pstorage_clear(&mp_flash_bond_info, MAX_BONDS_IN_FLASH);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_bond_info_in_flash_count = 0;
+    memset(m_bond_header_in_flash, 0, sizeof(m_bond_header_in_flash));
+
     for (i = 0; i < m_centrals_in_db_count; i++)
     {
-        crc = crc16_compute((uint8_t *)&m_centrals_db[i].bond,
-                                      sizeof(central_bond_t),
-                                      &crc);
+        err_code = bond_info_store(&m_centrals_db[i].bond);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
     }
 
-    // Compare the computed CRS to CRC stored in flash.
-    return (crc != m_crc_bond_info);
+    return NRF_SUCCESS;
 }
 
 
-/**@brief      Function for checking if System Attributes in RAM is different from that in flash.
+/**@brief      Function for compacting the System Attributes flash page.
  *
- * @return     TRUE if System Attributes in flash and RAM are different, FALSE otherwise.
+ * @details    Erases the page and writes the current record of each central in the database which
+ *             has System Attributes, so the superseded records are dropped.
+ *
+ * @return     NRF_SUCCESS on success, otherwise an error code.
  */
-static bool sys_attr_changed(void)
+static uint32_t sys_attr_compact(void)
 {
+    uint32_t err_code;
     int      i;
-    uint16_t crc = crc16_compute(NULL, 0, NULL);
 
-    // Compute CRC for all System Attributes in database.
+    err_code = pstorage_clear(&mp_flash_sys_attr, MAX_BONDS_IN_FLASH);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_sys_attr_in_flash_count = 0;
+    memset(m_sys_attr_header_in_flash, 0, sizeof(m_sys_attr_header_in_flash));
+
     for (i = 0; i < m_centrals_in_db_count; i++)
     {
-        crc = crc16_compute((uint8_t *)&m_centrals_db[i].sys_attr,
-                                      sizeof(central_sys_attr_t),
-                                      &crc);
+        if (m_centrals_db[i].sys_attr.central_handle == INVALID_CENTRAL_HANDLE)
+        {
+            continue;
+        }
+
+        err_code = sys_attr_store(&m_centrals_db[i].sys_attr);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
     }
 
-    // Compare the CRC of System Attributes in flash with that of the System Attributes in memory.
-    return (crc != m_crc_sys_attr);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief      Function for writing the Bonding Information which differs from that in flash.
+ *
+ * @details    Only the records of the changed centrals are appended. The page is compacted only
+ *             when it is full.
+ *
+ * @return     NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t bond_info_changed_store(void)
+{
+    uint32_t err_code;
+    int      i;
+
+    for (i = 0; i < m_centrals_in_db_count; i++)
+    {
+        central_bond_t * p_bond = &m_centrals_db[i].bond;
+
+        if (record_header(p_bond, sizeof(central_bond_t)) == m_bond_header_in_flash[i])
+        {
+            continue;
+        }
+
+        err_code = bond_info_store(p_bond);
+        if (err_code == NRF_ERROR_NO_MEM)
+        {
+            // Writes all centrals, including the remaining changed ones.
+            return bond_info_compact();
+        }
+        else if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief      Function for writing the System Attributes which differ from those in flash.
+ *
+ * @details    Only the records of the changed centrals are appended. The page is compacted only
+ *             when it is full.
+ *
+ * @return     NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t sys_attr_changed_store(void)
+{
+    uint32_t err_code;
+    int      i;
+
+    for (i = 0; i < m_centrals_in_db_count; i++)
+    {
+        central_sys_attr_t * p_sys_attr = &m_centrals_db[i].sys_attr;
+
+        if (
+            (p_sys_attr->central_handle == INVALID_CENTRAL_HANDLE) ||
+            (record_header(p_sys_attr, sizeof(central_sys_attr_t)) == m_sys_attr_header_in_flash[i])
+           )
+        {
+            continue;
+        }
+
+        err_code = sys_attr_store(p_sys_attr);
+        if (err_code == NRF_ERROR_NO_MEM)
+        {
+            // Writes all centrals, including the remaining changed ones.
+            return sys_attr_compact();
+        }
+        else if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
 }
 
 
@@ -581,12 +792,108 @@ static uint32_t central_sys_attr_set(central_t * p_central)
 }
 
 
-/**@brief Function for updating the whitelist data structures.
+/**@brief      Function for getting the first index slot of a key.
+ *
+ * @param[in]  key   Key to look up.
+ *
+ * @return     Slot to start probing at.
+ */
+static __INLINE uint8_t central_index_slot(uint32_t key)
+{
+    return (uint8_t)(((key * CENTRAL_INDEX_HASH_MUL) >> 24) & CENTRAL_INDEX_MASK);
+}
+
+
+/**@brief      Function for getting the index key of a central address.
+ *
+ * @param[in]  p_addr   Address of the central.
+ *
+ * @return     Key folded from the address bytes.
+ */
+static uint32_t addr_key(const ble_gap_addr_t * p_addr)
+{
+    return uint32_decode(&p_addr->addr[0]) ^ uint16_decode(&p_addr->addr[4]);
+}
+
+
+/**@brief      Function for adding a central to an index.
+ *
+ * @details    Uses linear probing. The index has at least twice as many slots as there are
+ *             centrals, so there is always a free slot.
+ *
+ * @param[in]  p_index          Index.
+ * @param[in]  key              Key of the central.
+ * @param[in]  central_handle   Handle of the central.
+ */
+static void central_index_add(int8_t * p_index, uint32_t key, int8_t central_handle)
+{
+    uint8_t slot = central_index_slot(key);
+
+    while (p_index[slot] != INVALID_CENTRAL_HANDLE)
+    {
+        slot = (slot + 1) & CENTRAL_INDEX_MASK;
+    }
+    p_index[slot] = central_handle;
+}
+
+
+/**@brief      Function for looking up a central by encryption diversifier.
+ *
+ * @param[in]  div   Encryption diversifier.
+ *
+ * @return     Handle of the first central added with this diversifier, INVALID_CENTRAL_HANDLE if
+ *             none.
+ */
+static int8_t central_index_div_find(uint16_t div)
+{
+    uint8_t slot = central_index_slot(div);
+
+    while (m_div_index[slot] != INVALID_CENTRAL_HANDLE)
+    {
+        if (m_centrals_db[m_div_index[slot]].bond.central_id_info.div == div)
+        {
+            return m_div_index[slot];
+        }
+        slot = (slot + 1) & CENTRAL_INDEX_MASK;
+    }
+    return INVALID_CENTRAL_HANDLE;
+}
+
+
+/**@brief      Function for looking up a central by address.
+ *
+ * @param[in]  p_addr   Address of the central.
+ *
+ * @return     Handle of the first central added with this address, INVALID_CENTRAL_HANDLE if
+ *             none.
+ */
+static int8_t central_index_addr_find(const ble_gap_addr_t * p_addr)
+{
+    uint8_t slot = central_index_slot(addr_key(p_addr));
+
+    while (m_addr_index[slot] != INVALID_CENTRAL_HANDLE)
+    {
+        ble_gap_addr_t * p_cur_addr = &m_centrals_db[m_addr_index[slot]].bond.central_addr;
+
+        if (memcmp(p_cur_addr->addr, p_addr->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return m_addr_index[slot];
+        }
+        slot = (slot + 1) & CENTRAL_INDEX_MASK;
+    }
+    return INVALID_CENTRAL_HANDLE;
+}
+
+
+/**@brief Function for updating the whitelist data structures and the central indexes.
  */
 static void update_whitelist(void)
 {
     int i;
 
+    memset(m_div_index, INVALID_CENTRAL_HANDLE, sizeof(m_div_index));
+    memset(m_addr_index, INVALID_CENTRAL_HANDLE, sizeof(m_addr_index));
+
     for (i = 0, m_addr_count = 0, m_irk_count = 0; i < m_centrals_in_db_count; i++)
     {
         central_bond_t * p_bond = &m_centrals_db[i].bond;
@@ -605,7 +912,11 @@ static void update_whitelist(void)
             m_whitelist_addr[m_addr_count].p_addr         = &(p_bond->central_addr);
 
             m_addr_count++;
+
+            central_index_add(m_addr_index, addr_key(&p_bond->central_addr), (int8_t)i);
         }
+
+        central_index_add(m_div_index, p_bond->central_id_info.div, (int8_t)i);
     }
 }
 
@@ -728,15 +1039,12 @@ static uint32_t central_update(void)
  */
 static uint32_t central_find_in_db(uint16_t central_id)
 {
-    int i;
+    int8_t central_handle = central_index_div_find(central_id);
 
-    for (i = 0; i < m_centrals_in_db_count; i++)
+    if (central_handle != INVALID_CENTRAL_HANDLE)
     {
-        if (central_id == m_centrals_db[i].bond.central_id_info.div)
-        {
-            m_central = m_centrals_db[i];
-            return NRF_SUCCESS;
-        }
+        m_central = m_centrals_db[central_handle];
+        return NRF_SUCCESS;
     }
 
     return NRF_ERROR_NOT_FOUND;
@@ -744,6 +1052,9 @@ static uint32_t central_find_in_db(uint16_t central_id)
 
 
 /**@brief      Function for loading all Bonding Information and System Attributes from flash.
+ *
+ * @details    The records are applied in the order they were written, so the latest record of
+ *             each central is the one kept. Corrupted records are skipped.
  *
  * @return     NRF_SUCCESS on success, otherwise an error code.
  */
@@ -754,7 +1065,7 @@ static uint32_t load_all_from_flash(void)
 
     m_centrals_in_db_count = 0;
 
-    while (m_centrals_in_db_count < BLE_BONDMNGR_MAX_BONDED_CENTRALS)
+    while (m_bond_info_in_flash_count < MAX_BONDS_IN_FLASH)
     {
         central_bond_t central_bond_info;
         int           central_handle;
@@ -766,16 +1077,25 @@ static uint32_t load_all_from_flash(void)
             // No more bonds in flash.
             break;
         }
+        else if (err_code == NRF_ERROR_INVALID_DATA)
+        {
+            // Corrupted record, a later record of the same central may still be valid.
+            continue;
+        }
         else if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
 
         central_handle = central_bond_info.central_handle;
-        if (central_handle > m_centrals_in_db_count)
+        if (
+            (central_handle < 0)                      ||
+            (central_handle > m_centrals_in_db_count) ||
+            (central_handle >= BLE_BONDMNGR_MAX_BONDED_CENTRALS)
+           )
         {
-            // Central handle value(s) missing in flash. This should never happen.
-            return NRF_ERROR_INVALID_DATA;
+            // Central handle value(s) missing in flash, e.g. because a record was skipped.
+            continue;
         }
         else
         {
@@ -796,7 +1116,7 @@ static uint32_t load_all_from_flash(void)
     }
 
     // Load System Attributes for all previously known centrals.
-    for (i = 0; i < m_centrals_in_db_count; i++)
+    while (m_sys_attr_in_flash_count < MAX_BONDS_IN_FLASH)
     {
         central_sys_attr_t central_sys_attr;
 
@@ -807,15 +1127,23 @@ static uint32_t load_all_from_flash(void)
             // No more System Attributes in flash.
             break;
         }
+        else if (err_code == NRF_ERROR_INVALID_DATA)
+        {
+            // Corrupted record, a later record of the same central may still be valid.
+            continue;
+        }
         else if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
 
-        if (central_sys_attr.central_handle > m_centrals_in_db_count)
+        if (
+            (central_sys_attr.central_handle < 0) ||
+            (central_sys_attr.central_handle >= m_centrals_in_db_count)
+           )
         {
-            // Central handle value(s) missing in flash. This should never happen.
-            return NRF_ERROR_INVALID_DATA;
+            // No Bonding Information for this central.
+            continue;
         }
         else
         {
@@ -824,6 +1152,19 @@ static uint32_t load_all_from_flash(void)
         }
     }
 
+    // Remember what is in flash, so only changes are written. Legacy records get a header in the
+    // current format, so they are only rewritten when they change.
+    for (i = 0; i < m_centrals_in_db_count; i++)
+    {
+        m_bond_header_in_flash[i] = record_header(&m_centrals_db[i].bond, sizeof(central_bond_t));
+
+        if (m_centrals_db[i].sys_attr.central_handle != INVALID_CENTRAL_HANDLE)
+        {
+            m_sys_attr_header_in_flash[i] = record_header(&m_centrals_db[i].sys_attr,
+                                                          sizeof(central_sys_attr_t));
+        }
+    }
+
     // Initialize the remaining empty bond entries in the memory.
     for (i = m_centrals_in_db_count; i < BLE_BONDMNGR_MAX_BONDED_CENTRALS; i++)
     {
@@ -855,29 +1196,25 @@ static void on_connect(ble_evt_t * p_ble_evt)
     {
         uint8_t irk_idx  = p_ble_evt->evt.gap_evt.params.connected.irk_match_idx;
 
+        // The match index refers to the IRK window given to the stack.
         if ((irk_idx >= MAX_NUM_CENTRAL_WHITE_LIST) ||
-            (m_whitelist_irk[irk_idx].central_handle >= BLE_BONDMNGR_MAX_BONDED_CENTRALS))
+            (m_whitelist_irk_handles[irk_idx] < 0) ||
+            (m_whitelist_irk_handles[irk_idx] >= m_centrals_in_db_count))
         {
             m_bondmngr_config.error_handler(NRF_ERROR_INTERNAL);
         }
         else
         {
-            m_central = m_centrals_db[m_whitelist_irk[irk_idx].central_handle];
+            m_central = m_centrals_db[m_whitelist_irk_handles[irk_idx]];
         }
     }
     else
     {
-        int i;
+        int8_t central_handle = central_index_addr_find(&m_central.bond.central_addr);
 
-        for (i = 0; i < m_addr_count; i++)
+        if (central_handle != INVALID_CENTRAL_HANDLE)
         {
-            ble_gap_addr_t * p_cur_addr = m_whitelist_addr[i].p_addr;
-
-            if (memcmp(p_cur_addr->addr, m_central.bond.central_addr.addr, BLE_GAP_ADDR_LEN) == 0)
-            {
-                m_central = m_centrals_db[m_whitelist_addr[i].central_handle];
-                break;
-            }
+            m_central = m_centrals_db[central_handle];
         }
     }
 
@@ -956,6 +1293,9 @@ static void auth_status_update(ble_gap_evt_auth_status_t * p_auth_status)
     memset(&(m_centrals_db[m_central.bond.central_handle]), 0, sizeof(central_t));
     m_centrals_db[m_central.bond.central_handle] = m_central;
 
+    // The diversifier and the IRK may have changed.
+    update_whitelist();
+
     // Write updated Bonding Information to flash.
     err_code = bond_info_store(&m_central.bond);
     if ((err_code == NRF_ERROR_NO_MEM) && (m_bondmngr_config.evt_handler != NULL))
@@ -1195,7 +1535,6 @@ void ble_bondmngr_on_ble_evt(ble_evt_t * p_ble_evt)
 uint32_t ble_bondmngr_bonded_centrals_store(void)
 {
     uint32_t err_code;
-    int      i;
 
     VERIFY_MODULE_INITIALIZED();
 
@@ -1223,48 +1562,18 @@ uint32_t ble_bondmngr_bonded_centrals_store(void)
         }
     }
 
-    // Save Bonding Information if changed.
-    if (bond_info_changed())
+    // Save Bonding Information of the changed centrals.
+    err_code = bond_info_changed_store();
+    if (err_code != NRF_SUCCESS)
     {
-        // Erase flash page.
-        err_code = pstorage_clear(&mp_flash_bond_info,MAX_BONDS_IN_FLASH);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        // Store bond information for all centrals.
-        m_bond_info_in_flash_count = 0;
-        for (i = 0; i < m_centrals_in_db_count; i++)
-        {
-            err_code = bond_info_store(&m_centrals_db[i].bond);
-            if (err_code != NRF_SUCCESS)
-            {
-                return err_code;
-            }
-        }
+        return err_code;
     }
 
-    // Save System Attributes, if changed.
-    if (sys_attr_changed())
+    // Save System Attributes of the changed centrals.
+    err_code = sys_attr_changed_store();
+    if (err_code != NRF_SUCCESS)
     {
-        // Erase flash page.
-        err_code = pstorage_clear(&mp_flash_sys_attr, MAX_BONDS_IN_FLASH);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        // Store System Attributes for all centrals.
-        m_sys_attr_in_flash_count = 0;
-        for (i = 0; i < m_centrals_in_db_count; i++)
-        {
-            err_code = sys_attr_store(&m_centrals_db[i].sys_attr);
-            if (err_code != NRF_SUCCESS)
-            {
-                return err_code;
-            }
-        }
+        return err_code;
     }
 
     m_conn_handle                     = BLE_CONN_HANDLE_INVALID;
@@ -1322,8 +1631,7 @@ uint32_t ble_bondmngr_bonded_centrals_delete(void)
     VERIFY_MODULE_INITIALIZED();
 
     m_centrals_in_db_count         = 0;
-    m_bond_info_in_flash_count     = 0;
-    m_sys_attr_in_flash_count      = 0;
+    update_whitelist();
 
     return flash_pages_erase();
 }
@@ -1355,21 +1663,48 @@ uint32_t ble_bondmngr_whitelist_get(ble_gap_whitelist_t * p_whitelist)
     static ble_gap_addr_t * s_addr[MAX_NUM_CENTRAL_WHITE_LIST];
     static ble_gap_irk_t  * s_irk[MAX_NUM_CENTRAL_WHITE_LIST];
 
-    int i;
+    uint8_t addr_count = MIN(m_addr_count, MAX_NUM_CENTRAL_WHITE_LIST);
+    uint8_t irk_count  = MIN(m_irk_count, MAX_NUM_CENTRAL_WHITE_LIST);
+    uint8_t addr_start = (m_addr_count > MAX_NUM_CENTRAL_WHITE_LIST) ?
+                         (m_whitelist_offset % m_addr_count) : 0;
+    uint8_t irk_start  = (m_irk_count > MAX_NUM_CENTRAL_WHITE_LIST) ?
+                         (m_whitelist_offset % m_irk_count) : 0;
+    int     i;
 
-    for (i = 0; i < m_irk_count; i++)
+    // Give the stack the current window of each list, wrapping around its end.
+    for (i = 0; i < irk_count; i++)
     {
-        s_irk[i] = m_whitelist_irk[i].p_irk;
+        whitelist_irk_t * p_entry = &m_whitelist_irk[(irk_start + i) % m_irk_count];
+
+        s_irk[i]                    = p_entry->p_irk;
+        m_whitelist_irk_handles[i]  = p_entry->central_handle;
     }
-    for (i = 0; i < m_addr_count; i++)
+    for (i = 0; i < addr_count; i++)
     {
-        s_addr[i] = m_whitelist_addr[i].p_addr;
+        s_addr[i] = m_whitelist_addr[(addr_start + i) % m_addr_count].p_addr;
     }
 
-    p_whitelist->addr_count = m_addr_count;
-    p_whitelist->pp_addrs   = (m_addr_count != 0) ? s_addr : NULL;
-    p_whitelist->irk_count  = m_irk_count;
-    p_whitelist->pp_irks    = (m_irk_count != 0) ? s_irk : NULL;
+    p_whitelist->addr_count = addr_count;
+    p_whitelist->pp_addrs   = (addr_count != 0) ? s_addr : NULL;
+    p_whitelist->irk_count  = irk_count;
+    p_whitelist->pp_irks    = (irk_count != 0) ? s_irk : NULL;
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_bondmngr_whitelist_rotate(void)
+{
+    VERIFY_MODULE_INITIALIZED();
+
+    if (MAX(m_addr_count, m_irk_count) <= MAX_NUM_CENTRAL_WHITE_LIST)
+    {
+        // All bonded centrals fit in one whitelist.
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_whitelist_offset = (m_whitelist_offset + MAX_NUM_CENTRAL_WHITE_LIST) %
+                         MAX(m_addr_count, m_irk_count);
 
     return NRF_SUCCESS;
 }
@@ -1435,6 +1770,12 @@ uint32_t ble_bondmngr_init(ble_bondmngr_init_t * p_init)
     m_bond_info_in_flash_count     = 0;
     m_sys_attr_in_flash_count      = 0;
 
+    memset(m_bond_header_in_flash, 0, sizeof(m_bond_header_in_flash));
+    memset(m_sys_attr_header_in_flash, 0, sizeof(m_sys_attr_header_in_flash));
+
+    m_whitelist_offset = 0;
+    memset(m_whitelist_irk_handles, INVALID_CENTRAL_HANDLE, sizeof(m_whitelist_irk_handles));
+
     SECURITY_STATUS_RESET();
 
     // Erase all stored centrals if specified.
@@ -1454,6 +1795,8 @@ uint32_t ble_bondmngr_init(ble_bondmngr_init_t * p_init)
             m_centrals_db[i].sys_attr.sys_attr_size  = 0;
             m_centrals_db[i].sys_attr.central_handle = INVALID_CENTRAL_HANDLE;
         }
+
+        update_whitelist();
     }
     else
     {
@@ -1546,36 +1889,18 @@ uint32_t ble_bondmngr_bonded_central_delete(uint16_t central_id)
 
     uint32_t err_code;
 
-    // Reinitialize the pointers to the memory where bonding info and System Attributes are stored
-    // in flash.
-    // Refresh the data in the flash memory (both Bonding Information and System Attributes).
-    // Erase and rewrite bonding info and System Attributes.
-
-    err_code = flash_pages_erase();
+    // The handles of the centrals after the deleted one have changed, so the records in flash
+    // no longer match. Compact both pages to rewrite them.
+    err_code = bond_info_compact();
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
 
-    m_bond_info_in_flash_count    = 0;
-    m_sys_attr_in_flash_count     = 0;
-
-    for (i = 0; i < m_centrals_in_db_count; i++)
-    {
-        err_code = bond_info_store(&(m_centrals_db[i].bond));
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-    }
-
-    for (i = 0; i < m_centrals_in_db_count; i++)
+    err_code = sys_attr_compact();
+    if (err_code != NRF_SUCCESS)
     {
-        err_code = sys_attr_store(&(m_centrals_db[i].sys_attr));
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+        return err_code;
     }
 
     update_whitelist();
@@ -0,0 +1,236 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "ble_conn_policy.h"
+#include "nordic_common.h"
+#include "app_timer.h"
+#include "ble_conn_params.h"
+#include "app_util.h"
+
+
+static ble_conn_policy_init_t m_policy_config;          /**< Configuration as specified by the application. */
+static uint16_t               m_conn_handle;            /**< Current connection handle. */
+static uint8_t                m_bulk_users;             /**< Bit mask of the users with an active bulk transfer. */
+static bool                   m_is_bulk_requested;      /**< True if the bulk parameters are the ones last requested. */
+static ble_gap_conn_params_t  m_granted_conn_params;    /**< Parameters of the current connection, as granted by the central. */
+static app_timer_id_t         m_timer_id;               /**< Relax delay after the last transfer, or bulk timeout while transfers are active. */
+
+
+static void error_report(uint32_t err_code)
+{
+    if ((err_code != NRF_SUCCESS) && (m_policy_config.error_handler != NULL))
+    {
+        m_policy_config.error_handler(err_code);
+    }
+}
+
+
+static void conn_params_request(bool bulk)
+{
+    uint32_t              err_code;
+    ble_gap_conn_params_t conn_params;
+
+    conn_params = bulk ? m_policy_config.bulk_conn_params : m_policy_config.idle_conn_params;
+
+    if (bulk)
+    {
+        // The Connection Parameters module takes the bulk interval as unacceptable.
+        error_report(ble_conn_params_stop());
+        err_code = sd_ble_gap_conn_param_update(m_conn_handle, &conn_params);
+    }
+    else
+    {
+        // Hands the negotiation back to the Connection Parameters module, stopped for the bulk
+        // transfer, with the idle parameters as the preferred ones.
+        err_code = ble_conn_params_change_conn_params(&conn_params);
+    }
+    if (err_code == NRF_ERROR_BUSY)
+    {
+        // Another update is in progress. The bulk request is retried when it completes, see
+        // on_conn_params_update, the idle request after another relax delay.
+        if (!bulk)
+        {
+            error_report(app_timer_start(m_timer_id, m_policy_config.relax_delay, NULL));
+        }
+        return;
+    }
+
+    m_is_bulk_requested = bulk;
+    error_report(err_code);
+}
+
+
+static void timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    // Either the relax delay has expired, or the bulk timeout of transfers that never ended.
+    m_bulk_users = 0;
+
+    if ((m_conn_handle != BLE_CONN_HANDLE_INVALID) && m_is_bulk_requested)
+    {
+        conn_params_request(false);
+    }
+}
+
+
+uint32_t ble_conn_policy_init(const ble_conn_policy_init_t * p_init)
+{
+    m_policy_config     = *p_init;
+    m_conn_handle       = BLE_CONN_HANDLE_INVALID;
+    m_bulk_users        = 0;
+    m_is_bulk_requested = false;
+
+    return app_timer_create(&m_timer_id,
+                            APP_TIMER_MODE_SINGLE_SHOT,
+                            timeout_handler);
+}
+
+
+uint32_t ble_conn_policy_bulk_start(uint8_t user)
+{
+    uint32_t err_code;
+
+    m_bulk_users |= user;
+
+    // A pending return to idle is no longer wanted, the bulk timeout starts over.
+    err_code = app_timer_stop(m_timer_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (m_policy_config.bulk_timeout != 0)
+    {
+        err_code = app_timer_start(m_timer_id, m_policy_config.bulk_timeout, NULL);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    if ((m_conn_handle != BLE_CONN_HANDLE_INVALID) && !m_is_bulk_requested)
+    {
+        conn_params_request(true);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_conn_policy_bulk_stop(uint8_t user)
+{
+    uint32_t err_code;
+
+    m_bulk_users &= (uint8_t)~user;
+
+    if (m_bulk_users == 0)
+    {
+        // Replaces the bulk timeout by the relax delay, or stops it if there is nothing to relax.
+        err_code = app_timer_stop(m_timer_id);
+        if ((err_code == NRF_SUCCESS) && m_is_bulk_requested &&
+            (m_conn_handle != BLE_CONN_HANDLE_INVALID))
+        {
+            err_code = app_timer_start(m_timer_id, m_policy_config.relax_delay, NULL);
+        }
+        return err_code;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_conn_policy_granted_get(ble_gap_conn_params_t * p_conn_params)
+{
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    *p_conn_params = m_granted_conn_params;
+    return NRF_SUCCESS;
+}
+
+
+bool ble_conn_policy_is_bulk_granted(void)
+{
+    return (m_conn_handle != BLE_CONN_HANDLE_INVALID) &&
+           (m_granted_conn_params.max_conn_interval <=
+            m_policy_config.bulk_conn_params.max_conn_interval);
+}
+
+
+static void on_connect(ble_evt_t * p_ble_evt)
+{
+    m_conn_handle         = p_ble_evt->evt.gap_evt.conn_handle;
+    m_granted_conn_params = p_ble_evt->evt.gap_evt.params.connected.conn_params;
+
+    // A transfer registered before the connection was established gets its parameters now.
+    if (m_bulk_users != 0)
+    {
+        conn_params_request(true);
+    }
+}
+
+
+static void on_disconnect(ble_evt_t * p_ble_evt)
+{
+    UNUSED_PARAMETER(p_ble_evt);
+
+    m_conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    // Transfers do not survive the connection.
+    m_bulk_users        = 0;
+    m_is_bulk_requested = false;
+
+    error_report(app_timer_stop(m_timer_id));
+}
+
+
+static void on_conn_params_update(ble_evt_t * p_ble_evt)
+{
+    m_granted_conn_params = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params;
+
+    if (m_is_bulk_requested)
+    {
+        // The Connection Parameters module has just seen the update, keep it from renegotiating.
+        error_report(ble_conn_params_stop());
+    }
+
+    if ((m_bulk_users != 0) && !m_is_bulk_requested)
+    {
+        // A bulk request that found the link busy.
+        conn_params_request(true);
+    }
+}
+
+
+void ble_conn_policy_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            on_connect(p_ble_evt);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            on_disconnect(p_ble_evt);
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            on_conn_params_update(p_ble_evt);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
@@ -11,6 +11,7 @@
  */
 
 #include <string.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <nrf51.h>
@@ -19,6 +20,43 @@
 #include "app_error.h"
 #include "nrf_gpio.h"
 #include "pstorage.h"
+#include "app_timer.h"
+#include "crc16.h"
+#include "nordic_common.h"
+
+#define CRASH_RING_MAGIC        0xC4A5E10Bu                                 /**< Marks a crash ring which survived the reset. */
+#define RECORD_CRC_LEN          offsetof(ble_error_log_record_t, crc)       /**< Number of record bytes covered by the CRC. */
+#define FLASH_SLOT_COUNT        (1024 / sizeof(ble_error_log_record_t))     /**< Number of records in the flash page, for 1 kB pages. */
+#define FLASH_SLOT_INVALID      0xFFFF                                      /**< Flash slot index while the next free slot is unknown. */
+#define LR_SCAN_DEPTH           32                                          /**< Number of stack words searched for a return address. */
+#define RTC_TICKS_PER_S_SHIFT   15                                          /**< log2 of the RTC frequency without prescaling (32768 Hz). */
+
+/**@brief Crash ring, in RAM which is not initialized at startup. */
+typedef struct
+{
+    uint32_t               magic;                                           /**< CRASH_RING_MAGIC if the ring is valid. */
+    uint32_t               write_count;                                     /**< Number of records added. */
+    uint32_t               flushed_count;                                   /**< Number of records copied to flash. */
+    ble_error_log_record_t records[BLE_ERROR_LOG_RING_SIZE];                /**< Records, indexed by their count modulo the ring size. */
+    uint32_t               reserved;                                        /**< Pads the ring to BLE_ERROR_LOG_RAM_SIZE. */
+} crash_ring_t;
+
+STATIC_ASSERT(sizeof(crash_ring_t) == BLE_ERROR_LOG_RAM_SIZE);
+
+#if defined ( __CC_ARM )
+static crash_ring_t       m_crash_ring __attribute__((at(BLE_ERROR_LOG_RAM_ADDR), zero_init)); /**< Crash ring, survives a reset. */
+#elif defined ( __GNUC__ )
+static crash_ring_t       m_crash_ring __attribute__((section(".noinit")));                    /**< Crash ring, survives a reset. */
+#else
+static crash_ring_t       m_crash_ring;                                                        /**< Crash ring, lost on reset with this compiler. */
+#endif
+
+static pstorage_handle_t  m_flash_handle;                                   /**< Flash page the records are copied to. */
+static uint16_t           m_flash_slot;                                     /**< Next free record slot in the flash page. */
+static bool               m_flash_busy;                                     /**< True while a flash operation is pending. */
+static app_timer_id_t     m_uptime_timer_id;                                /**< Uptime timer. */
+static uint32_t           m_uptime;                                         /**< Uptime at the last uptime timer timeout (in seconds). */
+static uint32_t           m_uptime_ticks;                                   /**< RTC counter at the last uptime timer timeout. */
 
 
 // Made static to avoid the error_log to go on the stack.
@@ -56,3 +94,287 @@ uint32_t ble_error_log_write(uint32_t err_code, const uint8_t * p_message, uint1
 
     return NRF_SUCCESS;
 }
+
+
+/**@brief Function for computing the CRC of a record. */
+static uint16_t record_crc(const ble_error_log_record_t * p_record)
+{
+    return crc16_compute((const uint8_t *)p_record, RECORD_CRC_LEN, NULL);
+}
+
+
+/**@brief Function for checking if a record in flash is erased. */
+static bool record_is_erased(const ble_error_log_record_t * p_record)
+{
+    const uint32_t * p_word = (const uint32_t *)p_record;
+    uint32_t         i;
+
+    for (i = 0; i < sizeof(ble_error_log_record_t) / sizeof(uint32_t); i++)
+    {
+        if (p_word[i] != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**@brief Function for getting the records in the flash page. */
+static const ble_error_log_record_t * flash_records(void)
+{
+    return (const ble_error_log_record_t *)m_flash_handle.block_id;
+}
+
+
+/**@brief Function for getting the time since startup, without dividing.
+ *
+ * @return      Uptime in seconds.
+ */
+static uint32_t uptime_get(void)
+{
+    uint32_t ticks = (NRF_RTC1->COUNTER - m_uptime_ticks) & 0x00FFFFFF;
+
+    return m_uptime + ((ticks * (NRF_RTC1->PRESCALER + 1)) >> RTC_TICKS_PER_S_SHIFT);
+}
+
+
+/**@brief Function for handling the uptime timer timeout.
+ *
+ * @param[in]   p_context   Not used.
+ */
+static void uptime_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    m_uptime      += BLE_ERROR_LOG_UPTIME_INTERVAL;
+    m_uptime_ticks = NRF_RTC1->COUNTER;
+}
+
+
+/**@brief Function for finding the first return address on the stack of the error handler.
+ *
+ * @param[in]   pc   Address the error handler was called from, skipped.
+ *
+ * @return      The first word on the stack which looks like a Thumb return address into code
+ *              flash, 0 if none is found.
+ */
+static uint32_t stack_return_address_find(uint32_t pc)
+{
+    const uint32_t * p_stack    = (const uint32_t *)GET_SP();
+    const uint32_t * initial_sp = (const uint32_t *)__Vectors;
+    uint32_t         code_end   = NRF_FICR->CODESIZE * NRF_FICR->CODEPAGESIZE;
+    uint32_t         i;
+
+    for (i = 0; (i < LR_SCAN_DEPTH) && (&p_stack[i] < initial_sp); i++)
+    {
+        uint32_t word = p_stack[i];
+
+        if (((word & 1) != 0) && (word < code_end) && ((word & ~1uL) != (pc & ~1uL)))
+        {
+            return word & ~1uL;
+        }
+    }
+    return 0;
+}
+
+
+/**@brief Function for handling pstorage events of the error log flash page. */
+static void flash_cb(pstorage_handle_t *  p_handle,
+                     uint8_t              op_code,
+                     uint32_t             result,
+                     uint8_t *            p_data,
+                     uint32_t             data_len)
+{
+    UNUSED_PARAMETER(p_handle);
+    UNUSED_PARAMETER(p_data);
+    UNUSED_PARAMETER(data_len);
+
+    m_flash_busy = false;
+    if (result != NRF_SUCCESS)
+    {
+        // Retried on the next call to ble_error_log_process().
+        return;
+    }
+
+    switch (op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            m_flash_slot++;
+            m_crash_ring.flushed_count++;
+            break;
+
+        case PSTORAGE_CLEAR_OP_CODE:
+            m_flash_slot = 0;
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
+uint32_t ble_error_log_init(void)
+{
+    uint32_t                err_code;
+    pstorage_module_param_t param;
+    uint16_t                i;
+
+    if (m_crash_ring.magic != CRASH_RING_MAGIC)
+    {
+        memset(&m_crash_ring, 0, sizeof(m_crash_ring));
+        m_crash_ring.magic = CRASH_RING_MAGIC;
+    }
+    else if ((m_crash_ring.write_count - m_crash_ring.flushed_count) > BLE_ERROR_LOG_RING_SIZE)
+    {
+        // The oldest records were overwritten before they could be copied.
+        m_crash_ring.flushed_count = m_crash_ring.write_count - BLE_ERROR_LOG_RING_SIZE;
+    }
+
+    m_flash_busy   = false;
+    m_uptime       = 0;
+    m_uptime_ticks = NRF_RTC1->COUNTER;
+
+    param.cb          = flash_cb;
+    param.block_size  = FLASH_SLOT_COUNT * sizeof(ble_error_log_record_t);
+    param.block_count = 1;
+
+    err_code = pstorage_register(&param, &m_flash_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Records are appended, so the first erased slot is the next free one.
+    m_flash_slot = FLASH_SLOT_INVALID;
+    for (i = 0; i < FLASH_SLOT_COUNT; i++)
+    {
+        if (record_is_erased(&flash_records()[i]))
+        {
+            m_flash_slot = i;
+            break;
+        }
+    }
+
+    err_code = app_timer_create(&m_uptime_timer_id, APP_TIMER_MODE_REPEATED, uptime_timeout_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return app_timer_start(m_uptime_timer_id,
+                           APP_TIMER_TICKS(BLE_ERROR_LOG_UPTIME_INTERVAL * 1000, NRF_RTC1->PRESCALER),
+                           NULL);
+}
+
+
+void ble_error_log_ring_add(uint32_t        err_code,
+                            uint32_t        line_number,
+                            const uint8_t * p_file_name,
+                            uint32_t        pc)
+{
+    ble_error_log_record_t * p_record;
+
+    if (m_crash_ring.magic != CRASH_RING_MAGIC)
+    {
+        // Error before ble_error_log_init(), start a new ring.
+        memset(&m_crash_ring, 0, sizeof(m_crash_ring));
+        m_crash_ring.magic = CRASH_RING_MAGIC;
+    }
+
+    p_record = &m_crash_ring.records[m_crash_ring.write_count % BLE_ERROR_LOG_RING_SIZE];
+
+    p_record->err_code    = err_code;
+    p_record->pc          = pc & ~1uL;
+    p_record->lr          = stack_return_address_find(pc);
+    p_record->uptime      = uptime_get();
+    p_record->line_number = (uint16_t)line_number;
+    p_record->file_hash   = (p_file_name != NULL) ?
+                            crc16_compute(p_file_name, strlen((const char *)p_file_name), NULL) : 0;
+    p_record->seq         = (uint16_t)m_crash_ring.write_count;
+    p_record->crc         = record_crc(p_record);
+
+    m_crash_ring.write_count++;
+}
+
+
+void ble_error_log_process(void)
+{
+    const ble_error_log_record_t * p_record;
+    uint32_t                       err_code;
+
+    if (m_flash_busy || (m_flash_handle.block_id == 0) ||
+        (m_crash_ring.flushed_count == m_crash_ring.write_count))
+    {
+        return;
+    }
+
+    if (m_flash_slot >= FLASH_SLOT_COUNT)
+    {
+        // Flash page full, start over.
+        err_code = pstorage_clear(&m_flash_handle, FLASH_SLOT_COUNT * sizeof(ble_error_log_record_t));
+    }
+    else
+    {
+        p_record = &m_crash_ring.records[m_crash_ring.flushed_count % BLE_ERROR_LOG_RING_SIZE];
+        if (record_crc(p_record) != p_record->crc)
+        {
+            // Corrupted before the reset, skip it.
+            m_crash_ring.flushed_count++;
+            return;
+        }
+
+        // The ring is not touched until the store has completed, so it can be the source.
+        err_code = pstorage_store(&m_flash_handle,
+                                  (uint8_t *)p_record,
+                                  sizeof(ble_error_log_record_t),
+                                  m_flash_slot * sizeof(ble_error_log_record_t));
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_flash_busy = true;
+    }
+}
+
+
+bool ble_error_log_is_flushed(void)
+{
+    return (m_flash_handle.block_id == 0) ||
+           (!m_flash_busy && (m_crash_ring.flushed_count == m_crash_ring.write_count));
+}
+
+
+uint16_t ble_error_log_records_get(ble_error_log_record_t * p_records, uint16_t max_count)
+{
+    uint16_t count = 0;
+    uint16_t slot  = (m_flash_slot > FLASH_SLOT_COUNT) ? FLASH_SLOT_COUNT : m_flash_slot;
+
+    if (m_flash_handle.block_id == 0)
+    {
+        return 0;
+    }
+
+    // Newest records are just below the next free slot.
+    while ((slot > 0) && (count < max_count))
+    {
+        slot--;
+        if (record_crc(&flash_records()[slot]) == flash_records()[slot].crc)
+        {
+            count++;
+        }
+    }
+
+    // Copy oldest first.
+    count = 0;
+    for ( ; (slot < FLASH_SLOT_COUNT) && (slot < m_flash_slot) && (count < max_count); slot++)
+    {
+        if (record_crc(&flash_records()[slot]) == flash_records()[slot].crc)
+        {
+            p_records[count++] = flash_records()[slot];
+        }
+    }
+
+    return count;
+}
@@ -44,10 +44,9 @@ typedef enum
 
 static gls_state_t      m_gls_state;                                        /**< Current communication state. */
 static uint16_t         m_next_seq_num;                                     /**< Sequence number of the next database record. */
-static uint8_t          m_racp_proc_operator;                               /**< Operator of current request. */
-static uint16_t         m_racp_proc_seq_num;                                /**< Sequence number of current request. */
-static uint8_t          m_racp_proc_record_ndx;                             /**< Current record index. */
-static uint8_t          m_racp_proc_records_reported;                       /**< Number of reported records. */
+static uint32_t         m_racp_proc_record_pos;                             /**< Position of the current record, see @ref ble_gls_db_removed_count_get. */
+static uint32_t         m_racp_proc_end_pos;                                /**< Position after the last record to be reported. */
+static uint16_t         m_racp_proc_records_reported;                       /**< Number of reported records. */
 static uint8_t          m_racp_proc_records_reported_since_txcomplete;      /**< Number of reported records since last TX_COMPLETE event. */
 static ble_racp_value_t m_pending_racp_response;                            /**< RACP response to be sent. */
 static uint8_t          m_pending_racp_response_operand[2];                 /**< Operand of RACP response to be sent. */
@@ -64,28 +63,32 @@ static void state_set(gls_state_t new_state)
 
 
 /**@brief Function for setting the next sequence number by reading the last record in the data base.
+ *
+ * @details Corrupt or deleted records at the end of the data base are passed over.
  *
  * @return      NRF_SUCCESS on successful initialization of service, otherwise an error code.
  */
 static uint32_t next_sequence_number_set(void)
 {
-    uint16_t      num_records;
-    ble_gls_rec_t rec;
+    uint16_t              num_records;
+    const ble_gls_rec_t * p_rec;
     
+    m_next_seq_num = 0;
+
     num_records = ble_gls_db_num_records_get();
-    if (num_records > 0)
+    while (num_records > 0)
     {
         // Get last record
-        uint32_t err_code = ble_gls_db_record_get(num_records - 1, &rec);
-        if (err_code != NRF_SUCCESS)
+        uint32_t err_code = ble_gls_db_record_ptr_get(--num_records, &p_rec);
+        if (err_code == NRF_SUCCESS)
+        {
+            m_next_seq_num = p_rec->meas.sequence_number + 1;
+            break;
+        }
+        else if (err_code != NRF_ERROR_INVALID_DATA)
         {
             return err_code;
         }
-        m_next_seq_num = rec.meas.sequence_number + 1;
-    }
-    else
-    {
-        m_next_seq_num = 0;
     }
     
     return NRF_SUCCESS;
@@ -184,11 +187,13 @@ static uint32_t glucose_measurement_char_add(ble_gls_t * p_gls)
     num_recs = ble_gls_db_num_records_get();
     if (num_recs > 0)
     {
-        uint32_t err_code = ble_gls_db_record_get(num_recs - 1, &initial_gls_rec_value);
+        const ble_gls_rec_t * p_rec;
+        uint32_t              err_code = ble_gls_db_record_ptr_get(num_recs - 1, &p_rec);
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
+        initial_gls_rec_value = *p_rec;
     }
     
     attr_char_value.p_uuid       = &ble_uuid;
@@ -481,7 +486,7 @@ static void racp_response_code_send(ble_gls_t * p_gls, uint8_t opcode, uint8_t v
  *
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-static uint32_t glucose_meas_send(ble_gls_t * p_gls, ble_gls_rec_t * p_rec)
+static uint32_t glucose_meas_send(ble_gls_t * p_gls, const ble_gls_rec_t * p_rec)
 {
     uint32_t               err_code;
     uint8_t                encoded_glm[MAX_GLM_LEN];
@@ -519,127 +524,157 @@ static uint32_t glucose_meas_send(ble_gls_t * p_gls, ble_gls_rec_t * p_rec)
 }
 
 
-/**@brief Function for responding to the ALL operation.
+/**@brief Function for checking whether a record can be reported.
  *
- * @param[in]   p_gls   Service instance.
+ * @param[in]   rec_ndx   Index of the record.
  *
- * @return      NRF_SUCCESS on success, otherwise an error code.
+ * @return      true unless the record is corrupt, e.g. torn by a reset, or deleted.
  */
-static uint32_t racp_report_records_all(ble_gls_t * p_gls)
+static bool is_record_valid(uint16_t rec_ndx)
 {
-    uint16_t total_records = ble_gls_db_num_records_get();
-    
-    if (m_racp_proc_record_ndx >= total_records)
-    {
-        state_set(STATE_NO_COMM);
-    }
-    else
-    {
-        uint32_t      err_code;
-        ble_gls_rec_t rec;
-        
-        err_code = ble_gls_db_record_get(m_racp_proc_record_ndx, &rec);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+    const ble_gls_rec_t * p_rec;
 
-        err_code = glucose_meas_send(p_gls, &rec);
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-    }
-    
-    return NRF_SUCCESS;
+    return (ble_gls_db_record_ptr_get(rec_ndx, &p_rec) == NRF_SUCCESS);
 }
 
 
-/**@brief Function for responding to the FIRST or the LAST operation.
+/**@brief Function for finding the records selected by a request.
  *
- * @param[in]   p_gls   Service instance.
+ * @details The records are sorted by sequence number, so the selection is a range of indexes,
+ *          found by a binary search. The range may hold corrupt records, which are not reported,
+ *          but the first and last records are the first and last which can be reported.
  *
- * @return      NRF_SUCCESS on success, otherwise an error code.
+ * @param[in]   p_racp_request   Request, already checked by is_request_to_be_executed().
+ * @param[out]  p_start_ndx      Index of the first selected record.
+ * @param[out]  p_end_ndx        Index after the last selected record.
  */
-static uint32_t racp_report_records_first_last(ble_gls_t * p_gls)
+static void racp_records_select(const ble_racp_value_t * p_racp_request,
+                                uint16_t *               p_start_ndx,
+                                uint16_t *               p_end_ndx)
 {
-    uint32_t      err_code;
-    ble_gls_rec_t rec;
-    uint16_t      total_records;
-    
-    total_records = ble_gls_db_num_records_get();
-    
-    if ((m_racp_proc_records_reported != 0) || (total_records == 0))
+    uint16_t total_records = ble_gls_db_num_records_get();
+    uint16_t seq_num_min   = 0;
+    uint16_t seq_num_max   = 0;
+
+    if (p_racp_request->operand_len >= 3)
     {
-        state_set(STATE_NO_COMM);
+        seq_num_min = uint16_decode(&p_racp_request->p_operand[1]);
+        seq_num_max = seq_num_min;
     }
-    else
+    if (p_racp_request->operand_len >= 5)
     {
-        if (m_racp_proc_operator == RACP_OPERATOR_FIRST)
-        {
-            err_code = ble_gls_db_record_get(0, &rec);
-            if (err_code != NRF_SUCCESS)
+        seq_num_max = uint16_decode(&p_racp_request->p_operand[3]);
+    }
+
+    *p_start_ndx = 0;
+    *p_end_ndx   = total_records;
+
+    switch (p_racp_request->operator)
+    {
+        case RACP_OPERATOR_FIRST:
+            while ((*p_start_ndx < total_records) && !is_record_valid(*p_start_ndx))
             {
-                return err_code;
+                (*p_start_ndx)++;
             }
-        }
-        else if (m_racp_proc_operator == RACP_OPERATOR_LAST)
-        {
-            err_code = ble_gls_db_record_get(total_records - 1, &rec);                
-            if (err_code != NRF_SUCCESS)
+            *p_end_ndx = (*p_start_ndx < total_records) ? (*p_start_ndx + 1) : total_records;
+            break;
+
+        case RACP_OPERATOR_LAST:
+            while ((*p_end_ndx > 0) && !is_record_valid(*p_end_ndx - 1))
             {
-                return err_code;
+                (*p_end_ndx)--;
             }
-        }
-            
-        err_code = glucose_meas_send(p_gls, &rec);
-        if (err_code != NRF_SUCCESS)
+            *p_start_ndx = (*p_end_ndx > 0) ? (*p_end_ndx - 1) : 0;
+            break;
+
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+            *p_start_ndx = ble_gls_db_seq_num_lower_bound(seq_num_min);
+            break;
+
+        case RACP_OPERATOR_LESS_OR_EQUAL:
+        case RACP_OPERATOR_RANGE:
+            if (p_racp_request->operator == RACP_OPERATOR_RANGE)
+            {
+                *p_start_ndx = ble_gls_db_seq_num_lower_bound(seq_num_min);
+            }
+            // Sequence numbers wrap around, so the maximum has a successor.
+            *p_end_ndx = ble_gls_db_seq_num_lower_bound(seq_num_max + 1);
+            break;
+
+        default:
+            // All records.
+            break;
+    }
+
+    if (*p_end_ndx < *p_start_ndx)
+    {
+        *p_end_ndx = *p_start_ndx;
+    }
+}
+
+
+/**@brief Function for counting the records of an index range which can be reported.
+ *
+ * @param[in]   start_ndx   Index of the first record.
+ * @param[in]   end_ndx     Index after the last record.
+ *
+ * @return      Number of records which are not corrupt.
+ */
+static uint16_t racp_records_count(uint16_t start_ndx, uint16_t end_ndx)
+{
+    uint16_t num_records = 0;
+
+    for (; start_ndx < end_ndx; start_ndx++)
+    {
+        if (is_record_valid(start_ndx))
         {
-            return err_code;
+            num_records++;
         }
     }
-    
-    return NRF_SUCCESS;
+
+    return num_records;
 }
 
 
-/**@brief Function for responding to the GREATER_OR_EQUAL operation.
+/**@brief Function for reporting the next record of the current request.
+ *
+ * @details The record is sent from where it is stored, without copying it. The report keeps its
+ *          place by position rather than index, so records removed while the report runs are
+ *          passed over. Corrupt records, e.g. torn by a reset while being written, are also
+ *          passed over.
  *
  * @param[in]   p_gls   Service instance.
  *
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-static uint32_t racp_report_records_greater_or_equal(ble_gls_t * p_gls)
+static uint32_t racp_report_records_next(ble_gls_t * p_gls)
 {
-    uint16_t total_records = ble_gls_db_num_records_get();
-    
-    while (m_racp_proc_record_ndx < total_records)
+    uint32_t removed_count = ble_gls_db_removed_count_get();
+
+    if (m_racp_proc_record_pos < removed_count)
     {
-        uint32_t      err_code;
-        ble_gls_rec_t rec;
+        m_racp_proc_record_pos = removed_count;
+    }
 
-        err_code = ble_gls_db_record_get(m_racp_proc_record_ndx, &rec);            
-        if (err_code != NRF_SUCCESS)
+    while (m_racp_proc_record_pos < m_racp_proc_end_pos)
+    {
+        uint32_t              err_code;
+        const ble_gls_rec_t * p_rec;
+
+        err_code = ble_gls_db_record_ptr_get(m_racp_proc_record_pos - removed_count, &p_rec);
+        if (err_code == NRF_SUCCESS)
         {
-            return err_code;
+            return glucose_meas_send(p_gls, p_rec);
         }
-
-        if (rec.meas.sequence_number >= m_racp_proc_seq_num)
+        else if (err_code != NRF_ERROR_INVALID_DATA)
         {
-            err_code = glucose_meas_send(p_gls, &rec);
-            if (err_code != NRF_SUCCESS)
-            {
-                return err_code;
-            }
-            break;
+            return err_code;
         }
-        m_racp_proc_record_ndx++;
+        m_racp_proc_record_pos++;
     }
-    if  (m_racp_proc_record_ndx == total_records)
-    {
-        state_set(STATE_NO_COMM);
-    }
-    
+
+    state_set(STATE_NO_COMM);
+
     return NRF_SUCCESS;
 }
 
@@ -676,32 +711,7 @@ static void racp_report_records_procedure(ble_gls_t * p_gls)
     while (m_gls_state == STATE_RACP_PROC_ACTIVE)
     {
         // Execute requested procedure
-        switch (m_racp_proc_operator)
-        {
-            case RACP_OPERATOR_ALL:
-                err_code = racp_report_records_all(p_gls);
-                break;
-                
-            case RACP_OPERATOR_FIRST:
-            case RACP_OPERATOR_LAST:
-                err_code = racp_report_records_first_last(p_gls);
-                break;
-                
-            case RACP_OPERATOR_GREATER_OR_EQUAL:
-                err_code = racp_report_records_greater_or_equal(p_gls);
-                break;
-                
-            default:
-                // Report error to application
-                if (p_gls->error_handler != NULL)
-                {
-                    p_gls->error_handler(NRF_ERROR_INTERNAL);
-                }
-
-                // Make sure state machine returns to the default state
-                state_set(STATE_NO_COMM);
-                return;
-        }
+        err_code = racp_report_records_next(p_gls);
 
         // Error handling
         switch (err_code)
@@ -709,7 +719,7 @@ static void racp_report_records_procedure(ble_gls_t * p_gls)
             case NRF_SUCCESS:
                 if (m_gls_state == STATE_RACP_PROC_ACTIVE)
                 {
-                    m_racp_proc_record_ndx++;
+                    m_racp_proc_record_pos++;
                 }
                 else
                 {
@@ -784,8 +794,9 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
         return false;
     }
     // supported opcodes
-    else if ((p_racp_request->opcode == RACP_OPCODE_REPORT_RECS) ||
-             (p_racp_request->opcode == RACP_OPCODE_REPORT_NUM_RECS))
+    else if ((p_racp_request->opcode == RACP_OPCODE_REPORT_RECS)     ||
+             (p_racp_request->opcode == RACP_OPCODE_REPORT_NUM_RECS) ||
+             (p_racp_request->opcode == RACP_OPCODE_DELETE_RECS))
     {
         switch (p_racp_request->operator)
         {
@@ -801,9 +812,26 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
                 
             // operators WITH a filter
             case RACP_OPERATOR_GREATER_OR_EQUAL:
-                if (p_racp_request->p_operand[0] == OPERAND_FILTER_TYPE_SEQ_NUM)
+            case RACP_OPERATOR_LESS_OR_EQUAL:
+            case RACP_OPERATOR_RANGE:
+                if (p_racp_request->operand_len == 0)
                 {
-                    if (p_racp_request->operand_len != 3)
+                    *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                }
+                else if (p_racp_request->p_operand[0] == OPERAND_FILTER_TYPE_SEQ_NUM)
+                {
+                    if (p_racp_request->operator == RACP_OPERATOR_RANGE)
+                    {
+                        // The minimum must not come after the maximum, in serial number
+                        // arithmetic as sequence numbers wrap around.
+                        if ((p_racp_request->operand_len != 5) ||
+                            ((int16_t)(uint16_decode(&p_racp_request->p_operand[3]) -
+                                       uint16_decode(&p_racp_request->p_operand[1])) < 0))
+                        {
+                            *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                        }
+                    }
+                    else if (p_racp_request->operand_len != 3)
                     {
                         *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
                     }
@@ -822,12 +850,6 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
                 }
                 break;
             
-            //  unsupported operators
-            case RACP_OPERATOR_LESS_OR_EQUAL:
-            case RACP_OPERATOR_RANGE:
-                    *p_response_code = RACP_RESPONSE_OPERATOR_UNSUPPORTED;
-                    break;
-
             // invalid operators
             case RACP_OPERATOR_NULL:
             default:
@@ -842,11 +864,6 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
                 break;
         }
     }
-    // unsupported opcodes
-    else if (p_racp_request->opcode == RACP_OPCODE_DELETE_RECS)
-    {
-        *p_response_code = RACP_RESPONSE_OPCODE_UNSUPPORTED;        
-    }
     // unknown opcodes
     else
     {
@@ -866,14 +883,16 @@ static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
  */
 static void report_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t * p_racp_request)
 {
-    uint16_t seq_num = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
+    uint16_t start_ndx;
+    uint16_t end_ndx;
+    uint32_t removed_count = ble_gls_db_removed_count_get();
 
     state_set(STATE_RACP_PROC_ACTIVE);
     
-    m_racp_proc_record_ndx       = 0;
-    m_racp_proc_operator         = p_racp_request->operator;
+    racp_records_select(p_racp_request, &start_ndx, &end_ndx);
+    m_racp_proc_record_pos       = start_ndx + removed_count;
+    m_racp_proc_end_pos          = end_ndx + removed_count;
     m_racp_proc_records_reported = 0;
-    m_racp_proc_seq_num          = seq_num;
 
     racp_report_records_procedure(p_gls);
 }
@@ -886,52 +905,13 @@ static void report_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t *
  */
 static void report_num_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t * p_racp_request)
 {
-    uint16_t total_records;
+    uint16_t start_ndx;
+    uint16_t end_ndx;
     uint16_t num_records;
     
-    total_records = ble_gls_db_num_records_get();
-    num_records   = 0;
-    
-    if (p_racp_request->operator == RACP_OPERATOR_ALL)
-    {
-        num_records = total_records;
-    }
-    else if (p_racp_request->operator == RACP_OPERATOR_GREATER_OR_EQUAL)
-    {
-        uint16_t seq_num;
-        uint16_t i;
-        
-        seq_num = (p_racp_request->p_operand[2] << 8) | p_racp_request->p_operand[1];
-        
-        for (i = 0; i < total_records; i++)
-        {
-            uint32_t      err_code;
-            ble_gls_rec_t rec;
-            
-            err_code = ble_gls_db_record_get(i, &rec);
-            if (err_code != NRF_SUCCESS)
-            {
-                if (p_gls->error_handler != NULL)
-                {
-                    p_gls->error_handler(err_code);
-                }
-                return;
-            }
-            
-            if (rec.meas.sequence_number >= seq_num)
-            {
-                num_records++;
-            }
-        }
-    }
-    else if ((p_racp_request->operator == RACP_OPERATOR_FIRST) ||
-             (p_racp_request->operator == RACP_OPERATOR_LAST))
-    {
-        if (total_records > 0)
-        {
-            num_records = 1;
-        }
-    }
+    // Corrupt records are not counted, as they are not reported.
+    racp_records_select(p_racp_request, &start_ndx, &end_ndx);
+    num_records = racp_records_count(start_ndx, end_ndx);
     
     m_pending_racp_response.opcode      = RACP_OPCODE_NUM_RECS_RESPONSE;
     m_pending_racp_response.operator    = RACP_OPERATOR_NULL;
@@ -945,6 +925,45 @@ static void report_num_records_request_execute(ble_gls_t * p_gls, ble_racp_value
 }
 
 
+/**@brief Function for processing a DELETE RECORDS request.
+ *
+ * @details The records are marked as deleted in flash in the background. Until then, they are
+ *          neither reported nor counted.
+ *
+ * @param[in]   p_gls            Service instance.
+ * @param[in]   p_racp_request   Request to be executed.
+ */
+static void delete_records_request_execute(ble_gls_t * p_gls, ble_racp_value_t * p_racp_request)
+{
+    uint32_t err_code;
+    uint16_t start_ndx;
+    uint16_t end_ndx;
+    uint8_t  resp_code_value;
+
+    racp_records_select(p_racp_request, &start_ndx, &end_ndx);
+
+    if (racp_records_count(start_ndx, end_ndx) == 0)
+    {
+        resp_code_value = RACP_RESPONSE_NO_RECORDS_FOUND;
+    }
+    else
+    {
+        err_code = ble_gls_db_records_delete(start_ndx, end_ndx - start_ndx);
+        if (err_code == NRF_SUCCESS)
+        {
+            resp_code_value = RACP_RESPONSE_SUCCESS;
+        }
+        else
+        {
+            // E.g. a previous deletion is still being written.
+            resp_code_value = RACP_RESPONSE_PROCEDURE_NOT_DONE;
+        }
+    }
+
+    racp_response_code_send(p_gls, RACP_OPCODE_DELETE_RECS, resp_code_value);
+}
+
+
 /**@brief Function for checking if the CCCDs are configured.
  *
  * @param[in]   p_gls                   Service instance.
@@ -1053,6 +1072,10 @@ static void on_racp_value_write(ble_gls_t * p_gls, ble_gatts_evt_write_t * p_evt
         {
             report_num_records_request_execute(p_gls, &racp_request);
         }
+        else if (racp_request.opcode == RACP_OPCODE_DELETE_RECS)
+        {
+            delete_records_request_execute(p_gls, &racp_request);
+        }
     }
     else if (response_code != RACP_RESPONSE_RESERVED)
     {
@@ -10,50 +10,147 @@
  */
 
 #include "ble_gls_db.h"
+#include <string.h>
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "app_flash_ring.h"
 
+#define RECORD_WORDS    CEIL_DIV(sizeof(ble_gls_rec_t), sizeof(uint32_t))      /**< Size of a record in flash, in 32 bit words. */
 
+static app_flash_ring_t m_ring;                                                     /**< Ring of records in flash. */
+static uint32_t         m_ring_buf[APP_FLASH_RING_BUF_WORDS(RECORD_WORDS * sizeof(uint32_t),
+                                                            BLE_GLS_DB_BUF_RECORDS)]; /**< Records waiting to be written to flash. */
+
+
+/**@brief Function for handling the pstorage events of the record pages.
+ *
+ * @param[in]   p_handle   Identifies the page the event is for.
+ * @param[in]   op_code    Operation the event is for.
+ * @param[in]   result     Result of the operation.
+ * @param[in]   p_data     Source of a store operation.
+ * @param[in]   data_len   Length of a store operation.
+ */
+static void db_pstorage_cb_handler(pstorage_handle_t * p_handle,
+                                   uint8_t             op_code,
+                                   uint32_t            result,
+                                   uint8_t *           p_data,
+                                   uint32_t            data_len)
+{
+    app_flash_ring_on_pstorage_evt(&m_ring, op_code, result, p_data);
+}
+
+
+/**@brief Function for handling flash errors of the record ring.
+ *
+ * @param[in]   nrf_error   Error code.
+ */
+static void db_error_handler(uint32_t nrf_error)
+{
+    APP_ERROR_HANDLER(nrf_error);
+}
+
+
+/**@brief Sequence number search key. */
 typedef struct
 {
-    bool          in_use_flag;
-    ble_gls_rec_t record;
-} database_entry_t;
-  
-static database_entry_t m_database[BLE_GLS_DB_MAX_RECORDS];
-static uint8_t          m_database_crossref[BLE_GLS_DB_MAX_RECORDS];
-static uint16_t         m_num_records;
+    uint16_t oldest_seq_num;                                                        /**< Sequence number of the oldest record. */
+    int32_t  offset;                                                                /**< Distance of the searched sequence number from oldest_seq_num. */
+} seq_num_key_t;
 
 
-uint32_t ble_gls_db_init(void)
+/**@brief Function for comparing the sequence number of a record to a search key.
+ *
+ * @details The records follow the oldest one, so their distance from it is taken as unsigned,
+ *          while the searched sequence number may also come before it.
+ */
+static int32_t seq_num_cmp(const uint8_t * p_data, const void * p_key)
+{
+    const ble_gls_rec_t * p_rec = (const ble_gls_rec_t *)p_data;
+    const seq_num_key_t * p_seq = (const seq_num_key_t *)p_key;
+
+    return (int32_t)(uint16_t)(p_rec->meas.sequence_number - p_seq->oldest_seq_num) - p_seq->offset;
+}
+
+
+/**@brief Function for comparing the base time of a record to a search key. */
+static int32_t time_cmp(const uint8_t * p_data, const void * p_key)
 {
-    int i;
-  
-    for (i = 0; i < BLE_GLS_DB_MAX_RECORDS; i++)
+    const ble_date_time_t * p_rec_time = &((const ble_gls_rec_t *)p_data)->meas.base_time;
+    const ble_date_time_t * p_time     = (const ble_date_time_t *)p_key;
+
+    if (p_rec_time->year != p_time->year)
+    {
+        return (int32_t)p_rec_time->year - p_time->year;
+    }
+    if (p_rec_time->month != p_time->month)
+    {
+        return (int32_t)p_rec_time->month - p_time->month;
+    }
+    if (p_rec_time->day != p_time->day)
     {
-        m_database[i].in_use_flag = false;
-        m_database_crossref[i]    = 0xFF;
+        return (int32_t)p_rec_time->day - p_time->day;
     }
+    if (p_rec_time->hours != p_time->hours)
+    {
+        return (int32_t)p_rec_time->hours - p_time->hours;
+    }
+    if (p_rec_time->minutes != p_time->minutes)
+    {
+        return (int32_t)p_rec_time->minutes - p_time->minutes;
+    }
+    return (int32_t)p_rec_time->seconds - p_time->seconds;
+}
 
-    m_num_records = 0;
-    
-    return NRF_SUCCESS;
+
+uint32_t ble_gls_db_init(void)
+{
+    app_flash_ring_init_t ring_init;
+
+    // Each record is written at once, so a measurement is not lost by a reset.
+    ring_init.pstorage_cb     = db_pstorage_cb_handler;
+    ring_init.error_handler   = db_error_handler;
+    ring_init.data_size       = RECORD_WORDS * sizeof(uint32_t);
+    ring_init.page_count      = BLE_GLS_DB_PAGE_COUNT;
+    ring_init.p_buffer        = m_ring_buf;
+    ring_init.buffer_records  = BLE_GLS_DB_BUF_RECORDS;
+    ring_init.write_threshold = 1;
+    ring_init.erase_ahead     = false;
+
+    return app_flash_ring_init(&m_ring, &ring_init);
 }
 
 
 uint16_t ble_gls_db_num_records_get(void)
 {
-    return m_num_records;
+    return (uint16_t)MIN(app_flash_ring_count_get(&m_ring), BLE_GLS_DB_MAX_RECORDS);
 }
 
 
-uint32_t ble_gls_db_record_get(uint8_t rec_ndx, ble_gls_rec_t * p_rec)
+uint32_t ble_gls_db_record_ptr_get(uint16_t rec_ndx, const ble_gls_rec_t ** pp_rec)
 {
-    if (rec_ndx >= m_num_records)
+    return app_flash_ring_get(&m_ring, rec_ndx, (const uint8_t **)pp_rec);
+}
+
+
+uint32_t ble_gls_db_record_get(uint16_t rec_ndx, ble_gls_rec_t * p_rec)
+{
+    uint32_t              err_code;
+    const ble_gls_rec_t * p_db_rec;
+
+    err_code = ble_gls_db_record_ptr_get(rec_ndx, &p_db_rec);
+    if (err_code == NRF_ERROR_NOT_FOUND)
     {
         return NRF_ERROR_INVALID_PARAM;
     }
+    else if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
 
     // copy record to the specified memory
-    *p_rec = m_database[m_database_crossref[rec_ndx]].record;
+    *p_rec = *p_db_rec;
 
     return NRF_SUCCESS;
 }
@@ -61,52 +158,64 @@ uint32_t ble_gls_db_record_get(uint8_t rec_ndx, ble_gls_rec_t * p_rec)
 
 uint32_t ble_gls_db_record_add(ble_gls_rec_t * p_rec)
 {
-    int i;
-  
-    if (m_num_records == BLE_GLS_DB_MAX_RECORDS)
-    {
-        return NRF_ERROR_NO_MEM;
-    }
-    
-    // find next available database entry
-    for (i = 0; i < BLE_GLS_DB_MAX_RECORDS; i++)
-    {
-        if (!m_database[i].in_use_flag)
-        {
-            m_database[i].in_use_flag = true;
-            m_database[i].record      = *p_rec;
-              
-            m_database_crossref[m_num_records] = i;
-            m_num_records++;
-    
-            return NRF_SUCCESS;
-        }
-    }
+    uint32_t data[RECORD_WORDS];
+
+    // Padding is cleared, so the CRC of a record does not depend on the stack contents.
+    memset(data, 0, sizeof(data));
+    memcpy(data, p_rec, sizeof(ble_gls_rec_t));
+
+    return app_flash_ring_add(&m_ring, (uint8_t *)data);
+}
+
+
+uint32_t ble_gls_db_record_delete(uint16_t rec_ndx)
+{
+    return ble_gls_db_records_delete(rec_ndx, 1);
+}
+
 
-    return NRF_ERROR_NO_MEM;
+uint32_t ble_gls_db_records_delete(uint16_t rec_ndx, uint16_t num_records)
+{
+    return app_flash_ring_delete(&m_ring, rec_ndx, num_records);
 }
 
 
-uint32_t ble_gls_db_record_delete(uint8_t rec_ndx)
+uint32_t ble_gls_db_removed_count_get(void)
 {
-    int i;
-  
-    if (rec_ndx >= m_num_records)
+    return app_flash_ring_removed_count_get(&m_ring);
+}
+
+
+uint16_t ble_gls_db_seq_num_lower_bound(uint16_t seq_num)
+{
+    uint16_t              num_records = ble_gls_db_num_records_get();
+    uint16_t              rec_ndx;
+    const ble_gls_rec_t * p_rec;
+    seq_num_key_t         key;
+
+    // The oldest record which is not corrupt is the reference for the comparisons.
+    for (rec_ndx = 0; rec_ndx < num_records; rec_ndx++)
     {
-        return NRF_ERROR_NOT_FOUND;
+        if (ble_gls_db_record_ptr_get(rec_ndx, &p_rec) == NRF_SUCCESS)
+        {
+            break;
+        }
     }
-    
-    // free entry
-    m_database[m_database_crossref[rec_ndx]].in_use_flag = false;
-  
-    // decrease number of records
-    m_num_records--;
-
-    // remove cross reference index
-    for (i = rec_ndx; i < m_num_records; i++)
+    if (rec_ndx == num_records)
     {
-        m_database_crossref[i] = m_database_crossref[i + 1];
+        return num_records;
     }
-    
-    return NRF_SUCCESS;
+
+    key.oldest_seq_num = p_rec->meas.sequence_number;
+    key.offset         = (int16_t)(seq_num - key.oldest_seq_num);
+
+    return (uint16_t)MIN(app_flash_ring_lower_bound(&m_ring, seq_num_cmp, &key),
+                         BLE_GLS_DB_MAX_RECORDS);
+}
+
+
+uint16_t ble_gls_db_time_lower_bound(const ble_date_time_t * p_time)
+{
+    return (uint16_t)MIN(app_flash_ring_lower_bound(&m_ring, time_cmp, p_time),
+                         BLE_GLS_DB_MAX_RECORDS);
 }
@@ -0,0 +1,1040 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "ble_sls.h"
+#include <string.h>
+#include "nordic_common.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "app_flash_ring.h"
+#include "ble_racp.h"
+#include "ble_srv_ntf_queue.h"
+#include "ble_conn_policy.h"
+
+#define SAMPLE_WORDS            CEIL_DIV(sizeof(ble_sls_sample_t), sizeof(uint32_t))   /**< Size of a sample in flash, in 32 bit words. */
+#define SAMPLE_ENCODED_MAX_LEN  (2 + 4 + 1 + (2 * BLE_SLS_SAMPLE_VALUES_MAX))          /**< Largest encoded sample. */
+#define SAMPLE_TYPE_MAX         0x3F                                                    /**< Largest sample type, the upper bits encode the number of values. */
+#define SAMPLE_VALUE_COUNT_POS  6                                                       /**< Position of the number of values in the encoded type byte. */
+
+#define FILTER_OPERAND_LEN      (1 + sizeof(uint32_t))                                  /**< Length of an operand with one filter value. */
+#define FILTER_RANGE_LEN        (1 + (2 * sizeof(uint32_t)))                            /**< Length of an operand with a filter range. */
+
+#define SLS_NACK_PROC_ALREADY_IN_PROGRESS   (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0)      /**< Reply when a request is written while another is running. */
+
+/**@brief Sensor Log Service communication state. */
+typedef enum
+{
+    STATE_NO_COMM,                                                                      /**< The service is not in a communicating state. */
+    STATE_RACP_PROC_ACTIVE,                                                             /**< Reporting samples. */
+    STATE_RACP_RESPONSE_PENDING,                                                        /**< There is a RACP indication waiting to be sent. */
+    STATE_RACP_RESPONSE_IND_VERIF                                                       /**< Waiting for a verification of a RACP indication. */
+} sls_state_t;
+
+static app_flash_ring_t m_ring;                                                         /**< Ring of samples in flash. */
+static uint32_t         m_ring_buf[APP_FLASH_RING_BUF_WORDS(SAMPLE_WORDS * sizeof(uint32_t),
+                                                            BLE_SLS_BUF_SAMPLES)];      /**< Samples waiting to be written to flash. */
+static sls_state_t      m_sls_state;                                                    /**< Current communication state. */
+static uint32_t         m_next_seq_num;                                                 /**< Sequence number of the next sample. */
+static uint32_t         m_last_timestamp;                                               /**< Timestamp of the newest sample. */
+static uint32_t         m_proc_pos;                                                     /**< Position of the next sample to be reported, see @ref app_flash_ring_removed_count_get. */
+static uint32_t         m_proc_end_pos;                                                 /**< Position after the last sample to be reported. */
+static uint32_t         m_proc_reported;                                                /**< Number of reported samples. */
+static ble_racp_value_t m_pending_racp_response;                                        /**< RACP response to be sent. */
+static uint8_t          m_pending_racp_response_operand[2];                             /**< Operand of RACP response to be sent. */
+
+
+/**@brief Function for handling the pstorage events of the sample pages.
+ *
+ * @param[in]   p_handle   Identifies the page the event is for.
+ * @param[in]   op_code    Operation the event is for.
+ * @param[in]   result     Result of the operation.
+ * @param[in]   p_data     Source of a store operation.
+ * @param[in]   data_len   Length of a store operation.
+ */
+static void sls_pstorage_cb_handler(pstorage_handle_t * p_handle,
+                                    uint8_t             op_code,
+                                    uint32_t            result,
+                                    uint8_t *           p_data,
+                                    uint32_t            data_len)
+{
+    app_flash_ring_on_pstorage_evt(&m_ring, op_code, result, p_data);
+}
+
+
+/**@brief Function for setting the SLS communication state.
+ *
+ * @param[in]   new_state   New communication state.
+ */
+static void state_set(sls_state_t new_state)
+{
+    m_sls_state = new_state;
+}
+
+
+/**@brief Function for comparing the sequence number of a sample to a search key. */
+static int32_t seq_num_cmp(const uint8_t * p_data, const void * p_key)
+{
+    uint32_t seq_num = ((const ble_sls_sample_t *)p_data)->seq_num;
+    uint32_t key     = *(const uint32_t *)p_key;
+
+    // Compared, not subtracted, as the difference may not fit an int32_t.
+    return (seq_num < key) ? -1 : ((seq_num > key) ? 1 : 0);
+}
+
+
+/**@brief Function for comparing the timestamp of a sample to a search key. */
+static int32_t timestamp_cmp(const uint8_t * p_data, const void * p_key)
+{
+    uint32_t timestamp = ((const ble_sls_sample_t *)p_data)->timestamp;
+    uint32_t key       = *(const uint32_t *)p_key;
+
+    return (timestamp < key) ? -1 : ((timestamp > key) ? 1 : 0);
+}
+
+
+/**@brief Function for setting the next sequence number and the last timestamp from the newest
+ *        valid sample in flash.
+ */
+static void newest_sample_read(void)
+{
+    uint32_t index = app_flash_ring_count_get(&m_ring);
+
+    m_next_seq_num   = 0;
+    m_last_timestamp = 0;
+
+    while (index > 0)
+    {
+        const ble_sls_sample_t * p_sample;
+
+        index--;
+        if (app_flash_ring_get(&m_ring, index, (const uint8_t **)&p_sample) == NRF_SUCCESS)
+        {
+            m_next_seq_num   = p_sample->seq_num + 1;
+            m_last_timestamp = p_sample->timestamp;
+            return;
+        }
+    }
+}
+
+
+/**@brief Function for encoding a sample for the Sample characteristic.
+ *
+ * @param[in]   p_sample           Sample to be encoded.
+ * @param[out]  p_encoded_buffer   Buffer where the encoded sample is to be stored.
+ *
+ * @return      Size of encoded sample.
+ */
+static uint8_t sample_encode(const ble_sls_sample_t * p_sample, uint8_t * p_encoded_buffer)
+{
+    uint8_t len = 0;
+    uint8_t i;
+
+    len += uint16_encode((uint16_t)p_sample->seq_num, &p_encoded_buffer[len]);
+    len += uint32_encode(p_sample->timestamp, &p_encoded_buffer[len]);
+
+    p_encoded_buffer[len++] = (uint8_t)((p_sample->value_count << SAMPLE_VALUE_COUNT_POS) |
+                                        p_sample->type);
+
+    for (i = 0; i < p_sample->value_count; i++)
+    {
+        len += uint16_encode((uint16_t)p_sample->value[i], &p_encoded_buffer[len]);
+    }
+
+    return len;
+}
+
+
+/**@brief Function for adding the Sample characteristic.
+ *
+ * @param[in]   p_sls        Service instance.
+ * @param[in]   p_sls_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS if characteristic was successfully added, otherwise an error code.
+ */
+static uint32_t sample_char_add(ble_sls_t * p_sls, const ble_sls_init_t * p_sls_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    cccd_md.write_perm = p_sls_init->sample_attr_md.cccd_write_perm;
+    cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.notify = 1;
+    char_md.p_char_user_desc  = NULL;
+    char_md.p_char_pf         = NULL;
+    char_md.p_user_desc_md    = NULL;
+    char_md.p_cccd_md         = &cccd_md;
+    char_md.p_sccd_md         = NULL;
+
+    ble_uuid.type = p_sls->uuid_type;
+    ble_uuid.uuid = BLE_SLS_UUID_SAMPLE_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 0;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = BLE_SRV_NTF_MAX_LEN;
+    attr_char_value.p_value      = NULL;
+
+    return sd_ble_gatts_characteristic_add(p_sls->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_sls->sample_handles);
+}
+
+
+/**@brief Function for adding the Record Access Control Point characteristic.
+ *
+ * @param[in]   p_sls        Service instance.
+ * @param[in]   p_sls_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS if characteristic was successfully added, otherwise an error code.
+ */
+static uint32_t record_access_control_point_char_add(ble_sls_t * p_sls, const ble_sls_init_t * p_sls_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    cccd_md.write_perm = p_sls_init->racp_attr_md.cccd_write_perm;
+    cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.indicate = 1;
+    char_md.char_props.write    = 1;
+    char_md.p_char_user_desc    = NULL;
+    char_md.p_char_pf           = NULL;
+    char_md.p_user_desc_md      = NULL;
+    char_md.p_cccd_md           = &cccd_md;
+    char_md.p_sccd_md           = NULL;
+
+    BLE_UUID_BLE_ASSIGN(ble_uuid, BLE_UUID_RECORD_ACCESS_CONTROL_POINT_CHAR);
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    attr_md.write_perm = p_sls_init->racp_attr_md.write_perm;
+
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 1;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 0;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = BLE_L2CAP_MTU_DEF;
+    attr_char_value.p_value      = NULL;
+
+    return sd_ble_gatts_characteristic_add(p_sls->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_sls->racp_handles);
+}
+
+
+uint32_t ble_sls_init(ble_sls_t * p_sls, const ble_sls_init_t * p_sls_init)
+{
+    uint32_t              err_code;
+    ble_uuid_t            ble_uuid;
+    ble_uuid128_t         base_uuid = BLE_SLS_UUID_BASE;
+    app_flash_ring_init_t ring_init;
+
+    // Samples are written a few at a time, with the next page erased ahead, to save energy.
+    ring_init.pstorage_cb     = sls_pstorage_cb_handler;
+    ring_init.error_handler   = p_sls_init->error_handler;
+    ring_init.data_size       = SAMPLE_WORDS * sizeof(uint32_t);
+    ring_init.page_count      = BLE_SLS_PAGE_COUNT;
+    ring_init.p_buffer        = m_ring_buf;
+    ring_init.buffer_records  = BLE_SLS_BUF_SAMPLES;
+    ring_init.write_threshold = BLE_SLS_WRITE_THRESHOLD;
+    ring_init.erase_ahead     = true;
+
+    err_code = app_flash_ring_init(&m_ring, &ring_init);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    newest_sample_read();
+
+    // Initialize service structure
+    p_sls->error_handler = p_sls_init->error_handler;
+    p_sls->conn_handle   = BLE_CONN_HANDLE_INVALID;
+
+    state_set(STATE_NO_COMM);
+
+    // Add service
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &p_sls->uuid_type);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    ble_uuid.type = p_sls->uuid_type;
+    ble_uuid.uuid = BLE_SLS_UUID_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_sls->service_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Add sample characteristic
+    err_code = sample_char_add(p_sls, p_sls_init);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Add record access control point characteristic
+    return record_access_control_point_char_add(p_sls, p_sls_init);
+}
+
+
+uint32_t ble_sls_sample_add(ble_sls_t * p_sls, ble_sls_sample_t * p_sample)
+{
+    uint32_t err_code;
+    uint32_t data[SAMPLE_WORDS];
+
+    if ((p_sample->value_count > BLE_SLS_SAMPLE_VALUES_MAX) ||
+        (p_sample->type > SAMPLE_TYPE_MAX)                   ||
+        (p_sample->timestamp < m_last_timestamp))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_sample->seq_num = m_next_seq_num;
+
+    // Padding is cleared, so the CRC of a sample does not depend on the stack contents.
+    memset(data, 0, sizeof(data));
+    memcpy(data, p_sample, sizeof(ble_sls_sample_t));
+
+    err_code = app_flash_ring_add(&m_ring, (uint8_t *)data);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_next_seq_num++;
+    m_last_timestamp = p_sample->timestamp;
+
+    return NRF_SUCCESS;
+}
+
+
+void ble_sls_flush(ble_sls_t * p_sls)
+{
+    app_flash_ring_flush(&m_ring);
+}
+
+
+uint32_t ble_sls_sample_count_get(void)
+{
+    return app_flash_ring_count_get(&m_ring);
+}
+
+
+/**@brief Function for sending a response from the Record Access Control Point.
+ *
+ * @details The response is held back until the reported samples have left the notification
+ *          queue, so the central gets it after the last sample.
+ *
+ * @param[in]   p_sls        Service instance.
+ * @param[in]   p_racp_val   RACP value to be sent.
+ */
+static void racp_send(ble_sls_t * p_sls, ble_racp_value_t * p_racp_val)
+{
+    uint32_t               err_code;
+    uint8_t                encoded_resp[25];
+    uint8_t                len;
+    uint16_t               hvx_len;
+    ble_gatts_hvx_params_t hvx_params;
+
+    if (ble_srv_ntf_queue_free_count_get() != BLE_SRV_NTF_QUEUE_SIZE)
+    {
+        // Wait for TX_COMPLETE event to drain the queue
+        state_set(STATE_RACP_RESPONSE_PENDING);
+        return;
+    }
+
+    // Send indication
+    len     = ble_racp_encode(p_racp_val, encoded_resp);
+    hvx_len = len;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle   = p_sls->racp_handles.value_handle;
+    hvx_params.type     = BLE_GATT_HVX_INDICATION;
+    hvx_params.offset   = 0;
+    hvx_params.p_len    = &hvx_len;
+    hvx_params.p_data   = encoded_resp;
+
+    err_code = sd_ble_gatts_hvx(p_sls->conn_handle, &hvx_params);
+
+    // Error handling
+    if ((err_code == NRF_SUCCESS) && (hvx_len != len))
+    {
+        err_code = NRF_ERROR_DATA_SIZE;
+    }
+    switch (err_code)
+    {
+        case NRF_SUCCESS:
+            // Wait for HVC event
+            state_set(STATE_RACP_RESPONSE_IND_VERIF);
+            break;
+
+        case BLE_ERROR_NO_TX_BUFFERS:
+            // Wait for TX_COMPLETE event to retry transmission
+            state_set(STATE_RACP_RESPONSE_PENDING);
+            break;
+
+        case NRF_ERROR_INVALID_STATE:
+            // Make sure state machine returns to the default state
+            state_set(STATE_NO_COMM);
+            break;
+
+        default:
+            // Report error to application
+            if (p_sls->error_handler != NULL)
+            {
+                p_sls->error_handler(err_code);
+            }
+
+            // Make sure state machine returns to the default state
+            state_set(STATE_NO_COMM);
+            break;
+    }
+}
+
+
+/**@brief Function for sending a RACP response containing a Response Code Op Code and a Response Code Value.
+ *
+ * @param[in]   p_sls    Service instance.
+ * @param[in]   opcode   RACP Op Code.
+ * @param[in]   value    RACP Response Code Value.
+ */
+static void racp_response_code_send(ble_sls_t * p_sls, uint8_t opcode, uint8_t value)
+{
+    m_pending_racp_response.opcode      = RACP_OPCODE_RESPONSE_CODE;
+    m_pending_racp_response.operator    = RACP_OPERATOR_NULL;
+    m_pending_racp_response.operand_len = 2;
+    m_pending_racp_response.p_operand   = m_pending_racp_response_operand;
+
+    m_pending_racp_response_operand[0] = opcode;
+    m_pending_racp_response_operand[1] = value;
+
+    racp_send(p_sls, &m_pending_racp_response);
+}
+
+
+/**@brief Function for finding the first sample not sorting before a filter value.
+ *
+ * @param[in]   filter_type   Filter type, see @ref BLE_SLS_FILTER_TYPES.
+ * @param[in]   value         Filter value.
+ *
+ * @return      Index of the sample, or the number of samples if there is none.
+ */
+static uint32_t filter_lower_bound(uint8_t filter_type, uint32_t value)
+{
+    if (filter_type == BLE_SLS_FILTER_TIMESTAMP)
+    {
+        return app_flash_ring_lower_bound(&m_ring, timestamp_cmp, &value);
+    }
+    return app_flash_ring_lower_bound(&m_ring, seq_num_cmp, &value);
+}
+
+
+/**@brief Function for finding the samples selected by a request.
+ *
+ * @details The samples are sorted by sequence number and by timestamp, so the selection is a
+ *          range of indexes, found by a binary search.
+ *
+ * @param[in]   p_racp_request   Request, already checked by is_request_to_be_executed().
+ * @param[out]  p_start_ndx      Index of the first selected sample.
+ * @param[out]  p_end_ndx        Index after the last selected sample.
+ */
+static void racp_samples_select(const ble_racp_value_t * p_racp_request,
+                                uint32_t *               p_start_ndx,
+                                uint32_t *               p_end_ndx)
+{
+    uint32_t total_samples = app_flash_ring_count_get(&m_ring);
+    uint8_t  filter_type   = 0;
+    uint32_t value_min     = 0;
+    uint32_t value_max     = 0;
+
+    if (p_racp_request->operand_len >= FILTER_OPERAND_LEN)
+    {
+        filter_type = p_racp_request->p_operand[0];
+        value_min   = uint32_decode(&p_racp_request->p_operand[1]);
+        value_max   = value_min;
+    }
+    if (p_racp_request->operand_len >= FILTER_RANGE_LEN)
+    {
+        value_max = uint32_decode(&p_racp_request->p_operand[1 + sizeof(uint32_t)]);
+    }
+
+    *p_start_ndx = 0;
+    *p_end_ndx   = total_samples;
+
+    switch (p_racp_request->operator)
+    {
+        case RACP_OPERATOR_FIRST:
+            *p_end_ndx = (total_samples > 0) ? 1 : 0;
+            break;
+
+        case RACP_OPERATOR_LAST:
+            *p_start_ndx = (total_samples > 0) ? (total_samples - 1) : 0;
+            break;
+
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+            *p_start_ndx = filter_lower_bound(filter_type, value_min);
+            break;
+
+        case RACP_OPERATOR_LESS_OR_EQUAL:
+        case RACP_OPERATOR_RANGE:
+            if (p_racp_request->operator == RACP_OPERATOR_RANGE)
+            {
+                *p_start_ndx = filter_lower_bound(filter_type, value_min);
+            }
+            if (value_max != 0xFFFFFFFF)
+            {
+                *p_end_ndx = filter_lower_bound(filter_type, value_max + 1);
+            }
+            break;
+
+        default:
+            // All samples.
+            break;
+    }
+
+    if (*p_end_ndx < *p_start_ndx)
+    {
+        *p_end_ndx = *p_start_ndx;
+    }
+}
+
+
+/**@brief Function for stopping the sample report and sending its response code.
+ *
+ * @param[in]   p_sls   Service instance.
+ */
+static void racp_report_samples_completed(ble_sls_t * p_sls)
+{
+    uint32_t err_code;
+
+    err_code = ble_conn_policy_bulk_stop(BLE_CONN_POLICY_USER_LOG);
+    if ((err_code != NRF_SUCCESS) && (p_sls->error_handler != NULL))
+    {
+        p_sls->error_handler(err_code);
+    }
+
+    racp_response_code_send(p_sls,
+                            RACP_OPCODE_REPORT_RECS,
+                            (m_proc_reported > 0) ? RACP_RESPONSE_SUCCESS
+                                                  : RACP_RESPONSE_NO_RECORDS_FOUND);
+}
+
+
+/**@brief Function for queueing samples of the current report until the notification queue is
+ *        full.
+ *
+ * @details The report keeps its place by position rather than index, so samples erased while
+ *          the report runs are passed over. Corrupt samples, e.g. torn by a reset while being
+ *          written, are also passed over.
+ *
+ * @param[in]   p_sls   Service instance.
+ */
+static void racp_report_samples_procedure(ble_sls_t * p_sls)
+{
+    while (m_sls_state == STATE_RACP_PROC_ACTIVE)
+    {
+        uint32_t                 err_code;
+        uint32_t                 removed_count = app_flash_ring_removed_count_get(&m_ring);
+        const ble_sls_sample_t * p_sample;
+        uint8_t                  encoded_sample[SAMPLE_ENCODED_MAX_LEN];
+        uint8_t                  len;
+
+        if (m_proc_pos < removed_count)
+        {
+            m_proc_pos = removed_count;
+        }
+        if (m_proc_pos >= m_proc_end_pos)
+        {
+            state_set(STATE_NO_COMM);
+            racp_report_samples_completed(p_sls);
+            return;
+        }
+
+        err_code = app_flash_ring_get(&m_ring,
+                                      m_proc_pos - removed_count,
+                                      (const uint8_t **)&p_sample);
+        if (err_code == NRF_SUCCESS)
+        {
+            len      = sample_encode(p_sample, encoded_sample);
+            err_code = ble_srv_ntf_queue_append(p_sls->conn_handle,
+                                                p_sls->sample_handles.value_handle,
+                                                encoded_sample,
+                                                len);
+            if (err_code == NRF_SUCCESS)
+            {
+                m_proc_reported++;
+            }
+        }
+        else if (err_code == NRF_ERROR_INVALID_DATA)
+        {
+            err_code = NRF_SUCCESS;
+        }
+
+        // Error handling
+        switch (err_code)
+        {
+            case NRF_SUCCESS:
+                m_proc_pos++;
+                break;
+
+            case NRF_ERROR_NO_MEM:
+                // Wait for TX_COMPLETE event to resume transmission
+                return;
+
+            case NRF_ERROR_INVALID_STATE:
+                // Notification is probably not enabled. Ignore request.
+                state_set(STATE_NO_COMM);
+                (void)ble_conn_policy_bulk_stop(BLE_CONN_POLICY_USER_LOG);
+                return;
+
+            default:
+                // Report error to application
+                if (p_sls->error_handler != NULL)
+                {
+                    p_sls->error_handler(err_code);
+                }
+
+                // Make sure state machine returns to the default state
+                state_set(STATE_NO_COMM);
+                (void)ble_conn_policy_bulk_stop(BLE_CONN_POLICY_USER_LOG);
+                return;
+        }
+    }
+}
+
+
+/**@brief Function for testing if the received request is to be executed.
+ *
+ * @param[in]   p_racp_request    Request to be checked.
+ * @param[out]  p_response_code   Response code to be sent in case the request is rejected.
+ *                                RACP_RESPONSE_RESERVED is returned if the received message is
+ *                                to be rejected without sending a response.
+ *
+ * @return      TRUE if the request is to be executed, FALSE if it is to be rejected.
+ */
+static bool is_request_to_be_executed(const ble_racp_value_t * p_racp_request,
+                                      uint8_t *                p_response_code)
+{
+    *p_response_code = RACP_RESPONSE_RESERVED;
+
+    if (p_racp_request->opcode == RACP_OPCODE_ABORT_OPERATION)
+    {
+        if (m_sls_state != STATE_RACP_PROC_ACTIVE)
+        {
+            *p_response_code = RACP_RESPONSE_ABORT_FAILED;
+        }
+        else if (p_racp_request->operator != RACP_OPERATOR_NULL)
+        {
+            *p_response_code = RACP_RESPONSE_INVALID_OPERATOR;
+        }
+        else if (p_racp_request->operand_len != 0)
+        {
+            *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+        }
+        else
+        {
+            *p_response_code = RACP_RESPONSE_SUCCESS;
+        }
+    }
+    else if (m_sls_state != STATE_NO_COMM)
+    {
+        return false;
+    }
+    else if ((p_racp_request->opcode == RACP_OPCODE_REPORT_RECS) ||
+             (p_racp_request->opcode == RACP_OPCODE_REPORT_NUM_RECS))
+    {
+        switch (p_racp_request->operator)
+        {
+            // operators WITHOUT a filter
+            case RACP_OPERATOR_ALL:
+            case RACP_OPERATOR_FIRST:
+            case RACP_OPERATOR_LAST:
+                if (p_racp_request->operand_len != 0)
+                {
+                    *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                }
+                break;
+
+            // operators WITH a filter
+            case RACP_OPERATOR_GREATER_OR_EQUAL:
+            case RACP_OPERATOR_LESS_OR_EQUAL:
+            case RACP_OPERATOR_RANGE:
+                if (p_racp_request->operand_len == 0)
+                {
+                    *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                }
+                else if ((p_racp_request->p_operand[0] != BLE_SLS_FILTER_SEQ_NUM) &&
+                         (p_racp_request->p_operand[0] != BLE_SLS_FILTER_TIMESTAMP))
+                {
+                    *p_response_code = RACP_RESPONSE_OPERAND_UNSUPPORTED;
+                }
+                else if (p_racp_request->operator == RACP_OPERATOR_RANGE)
+                {
+                    // The minimum must not be greater than the maximum.
+                    if ((p_racp_request->operand_len != FILTER_RANGE_LEN) ||
+                        (uint32_decode(&p_racp_request->p_operand[1]) >
+                         uint32_decode(&p_racp_request->p_operand[1 + sizeof(uint32_t)])))
+                    {
+                        *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                    }
+                }
+                else if (p_racp_request->operand_len != FILTER_OPERAND_LEN)
+                {
+                    *p_response_code = RACP_RESPONSE_INVALID_OPERAND;
+                }
+                break;
+
+            // invalid operators
+            case RACP_OPERATOR_NULL:
+            default:
+                if (p_racp_request->operator >= RACP_OPERATOR_RFU_START)
+                {
+                    *p_response_code = RACP_RESPONSE_OPERATOR_UNSUPPORTED;
+                }
+                else
+                {
+                    *p_response_code = RACP_RESPONSE_INVALID_OPERATOR;
+                }
+                break;
+        }
+    }
+    // unsupported and unknown opcodes, the log is only emptied by wrapping around
+    else
+    {
+        *p_response_code = RACP_RESPONSE_OPCODE_UNSUPPORTED;
+    }
+
+    return (*p_response_code == RACP_RESPONSE_RESERVED);
+}
+
+
+/**@brief Function for processing a REPORT RECORDS request.
+ *
+ * @param[in]   p_sls            Service instance.
+ * @param[in]   p_racp_request   Request to be executed.
+ */
+static void report_samples_request_execute(ble_sls_t * p_sls, ble_racp_value_t * p_racp_request)
+{
+    uint32_t err_code;
+    uint32_t start_ndx;
+    uint32_t end_ndx;
+    uint32_t removed_count = app_flash_ring_removed_count_get(&m_ring);
+
+    racp_samples_select(p_racp_request, &start_ndx, &end_ndx);
+
+    m_proc_pos      = start_ndx + removed_count;
+    m_proc_end_pos  = end_ndx + removed_count;
+    m_proc_reported = 0;
+
+    err_code = ble_conn_policy_bulk_start(BLE_CONN_POLICY_USER_LOG);
+    if ((err_code != NRF_SUCCESS) && (p_sls->error_handler != NULL))
+    {
+        p_sls->error_handler(err_code);
+    }
+
+    state_set(STATE_RACP_PROC_ACTIVE);
+    racp_report_samples_procedure(p_sls);
+}
+
+
+/**@brief Function for processing a REPORT NUM RECORDS request.
+ *
+ * @param[in]   p_sls            Service instance.
+ * @param[in]   p_racp_request   Request to be executed.
+ */
+static void report_num_samples_request_execute(ble_sls_t * p_sls, ble_racp_value_t * p_racp_request)
+{
+    uint32_t start_ndx;
+    uint32_t end_ndx;
+    uint16_t num_samples;
+
+    // Counted from the indexes, without reading the samples.
+    racp_samples_select(p_racp_request, &start_ndx, &end_ndx);
+    num_samples = (uint16_t)MIN(end_ndx - start_ndx, 0xFFFF);
+
+    m_pending_racp_response.opcode      = RACP_OPCODE_NUM_RECS_RESPONSE;
+    m_pending_racp_response.operator    = RACP_OPERATOR_NULL;
+    m_pending_racp_response.operand_len = sizeof(uint16_t);
+    m_pending_racp_response.p_operand   = m_pending_racp_response_operand;
+
+    (void)uint16_encode(num_samples, m_pending_racp_response_operand);
+
+    racp_send(p_sls, &m_pending_racp_response);
+}
+
+
+/**@brief Function for checking if the CCCDs of the service are configured.
+ *
+ * @param[in]   p_sls                   Service instance.
+ * @param[out]  p_are_cccd_configured   True if sample notification and RACP indication are enabled.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t are_cccd_configured(ble_sls_t * p_sls, bool * p_are_cccd_configured)
+{
+    uint32_t err_code;
+    uint8_t  cccd_value_buf[BLE_CCCD_VALUE_LEN];
+    uint16_t len = BLE_CCCD_VALUE_LEN;
+
+    *p_are_cccd_configured = false;
+
+    err_code = sd_ble_gatts_value_get(p_sls->sample_handles.cccd_handle, 0, &len, cccd_value_buf);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    if (!ble_srv_is_notification_enabled(cccd_value_buf))
+    {
+        return NRF_SUCCESS;
+    }
+
+    len      = BLE_CCCD_VALUE_LEN;
+    err_code = sd_ble_gatts_value_get(p_sls->racp_handles.cccd_handle, 0, &len, cccd_value_buf);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    *p_are_cccd_configured = ble_srv_is_indication_enabled(cccd_value_buf);
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for replying to an authorized write of the Record Access Control Point.
+ *
+ * @param[in]   p_sls         Service instance.
+ * @param[in]   gatt_status   GATT status of the reply.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t racp_write_reply(ble_sls_t * p_sls, uint16_t gatt_status)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    auth_reply.params.write.gatt_status = gatt_status;
+
+    return sd_ble_gatts_rw_authorize_reply(p_sls->conn_handle, &auth_reply);
+}
+
+
+/**@brief Function for handling a write to the Record Access Control Point.
+ *
+ * @param[in]   p_sls         Service instance.
+ * @param[in]   p_evt_write   Write to be handled.
+ */
+static void on_racp_value_write(ble_sls_t * p_sls, ble_gatts_evt_write_t * p_evt_write)
+{
+    ble_racp_value_t racp_request;
+    uint8_t          response_code;
+    bool             is_configured;
+    uint16_t         gatt_status;
+    uint32_t         err_code;
+
+    err_code = are_cccd_configured(p_sls, &is_configured);
+    if (err_code != NRF_SUCCESS)
+    {
+        if (p_sls->error_handler != NULL)
+        {
+            p_sls->error_handler(err_code);
+        }
+        return;
+    }
+
+    ble_racp_decode(p_evt_write->len, p_evt_write->data, &racp_request);
+
+    if (!is_configured)
+    {
+        gatt_status = BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR;
+    }
+    else if (is_request_to_be_executed(&racp_request, &response_code) ||
+             (response_code != RACP_RESPONSE_RESERVED))
+    {
+        gatt_status = BLE_GATT_STATUS_SUCCESS;
+    }
+    else
+    {
+        gatt_status = SLS_NACK_PROC_ALREADY_IN_PROGRESS;
+    }
+
+    err_code = racp_write_reply(p_sls, gatt_status);
+    if (err_code != NRF_SUCCESS)
+    {
+        if (p_sls->error_handler != NULL)
+        {
+            p_sls->error_handler(err_code);
+        }
+        return;
+    }
+    if (gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        return;
+    }
+
+    if (response_code != RACP_RESPONSE_RESERVED)
+    {
+        // Abort any running procedure, and respond with the response code
+        if (m_sls_state == STATE_RACP_PROC_ACTIVE)
+        {
+            (void)ble_conn_policy_bulk_stop(BLE_CONN_POLICY_USER_LOG);
+        }
+        state_set(STATE_NO_COMM);
+        racp_response_code_send(p_sls, racp_request.opcode, response_code);
+    }
+    else if (racp_request.opcode == RACP_OPCODE_REPORT_RECS)
+    {
+        report_samples_request_execute(p_sls, &racp_request);
+    }
+    else
+    {
+        report_num_samples_request_execute(p_sls, &racp_request);
+    }
+}
+
+
+/**@brief Function for handling the RW_AUTHORIZE_REQUEST event.
+ *
+ * @param[in]   p_sls         Sensor Log Service structure.
+ * @param[in]   p_gatts_evt   Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_sls_t * p_sls, ble_gatts_evt_t * p_gatts_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_gatts_evt->params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) &&
+        (p_auth_req->request.write.handle == p_sls->racp_handles.value_handle))
+    {
+        on_racp_value_write(p_sls, &p_auth_req->request.write);
+    }
+}
+
+
+/**@brief Function for handling the TX_COMPLETE event.
+ *
+ * @details The notification queue has already sent what it could, so the freed entries are
+ *          refilled, or the held back response is sent once the queue is empty.
+ *
+ * @param[in]   p_sls   Sensor Log Service structure.
+ */
+static void on_tx_complete(ble_sls_t * p_sls)
+{
+    if (m_sls_state == STATE_RACP_RESPONSE_PENDING)
+    {
+        racp_send(p_sls, &m_pending_racp_response);
+    }
+    else if (m_sls_state == STATE_RACP_PROC_ACTIVE)
+    {
+        racp_report_samples_procedure(p_sls);
+    }
+}
+
+
+/**@brief Function for handling the HVC event.
+ *
+ * @param[in]   p_sls       Sensor Log Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_hvc(ble_sls_t * p_sls, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_hvc_t * p_hvc = &p_ble_evt->evt.gatts_evt.params.hvc;
+
+    if ((p_hvc->handle == p_sls->racp_handles.value_handle) &&
+        (m_sls_state == STATE_RACP_RESPONSE_IND_VERIF))
+    {
+        // Indication has been acknowledged. Return to default state.
+        state_set(STATE_NO_COMM);
+    }
+}
+
+
+void ble_sls_on_ble_evt(ble_sls_t * p_sls, ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            p_sls->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+            state_set(STATE_NO_COMM);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (m_sls_state == STATE_RACP_PROC_ACTIVE)
+            {
+                (void)ble_conn_policy_bulk_stop(BLE_CONN_POLICY_USER_LOG);
+            }
+            p_sls->conn_handle = BLE_CONN_HANDLE_INVALID;
+            state_set(STATE_NO_COMM);
+            break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            on_rw_authorize_request(p_sls, &p_ble_evt->evt.gatts_evt);
+            break;
+
+        case BLE_EVT_TX_COMPLETE:
+            on_tx_complete(p_sls);
+            break;
+
+        case BLE_GATTS_EVT_HVC:
+            on_hvc(p_sls, p_ble_evt);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
@@ -0,0 +1,245 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "ble_srv_ntf_queue.h"
+#include <string.h>
+#include "nordic_common.h"
+#include "app_util.h"
+
+/**@brief Queued notification. */
+typedef struct
+{
+    uint16_t conn_handle;                                   /**< Connection to send the notification on. */
+    uint16_t value_handle;                                  /**< Value handle of the characteristic. */
+    uint16_t len;                                           /**< Length of the payload. */
+    uint8_t  data[BLE_SRV_NTF_MAX_LEN];                     /**< Payload. */
+} ntf_entry_t;
+
+static ble_srv_ntf_queue_init_t  m_queue_config;            /**< Configuration as specified by the application. */
+static ntf_entry_t               m_queue[BLE_SRV_NTF_QUEUE_SIZE]; /**< Queued notifications. */
+static uint8_t                   m_head;                    /**< Index of the oldest queued notification. */
+static uint8_t                   m_count;                   /**< Number of queued notifications. */
+static ble_srv_ntf_queue_stats_t m_stats;                   /**< Queue statistics. */
+
+
+/**@brief Function for reporting an error to the application. */
+static void error_report(uint32_t err_code)
+{
+    if ((err_code != NRF_SUCCESS) && (m_queue_config.error_handler != NULL))
+    {
+        m_queue_config.error_handler(err_code);
+    }
+}
+
+
+/**@brief Function for getting the queue index of the n-th queued notification. */
+static uint8_t queue_index(uint8_t n)
+{
+    return (uint8_t)((m_head + n) % BLE_SRV_NTF_QUEUE_SIZE);
+}
+
+
+/**@brief Function for removing the oldest queued notification. */
+static void queue_pop(void)
+{
+    m_head = queue_index(1);
+    m_count--;
+}
+
+
+/**@brief Function for passing queued notifications to the SoftDevice until it runs out of
+ *        TX buffers or the queue is empty.
+ */
+static void queue_process(void)
+{
+    while (m_count > 0)
+    {
+        uint32_t               err_code;
+        ble_gatts_hvx_params_t hvx_params;
+        ntf_entry_t *          p_entry = &m_queue[m_head];
+        uint16_t               hvx_len = p_entry->len;
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_entry->value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &hvx_len;
+        hvx_params.p_data = p_entry->data;
+
+        err_code = sd_ble_gatts_hvx(p_entry->conn_handle, &hvx_params);
+        switch (err_code)
+        {
+            case NRF_SUCCESS:
+                m_stats.sent++;
+                queue_pop();
+                break;
+
+            case BLE_ERROR_NO_TX_BUFFERS:
+                // All buffers are in use, retry on BLE_EVT_TX_COMPLETE.
+                return;
+
+            case NRF_ERROR_INVALID_STATE:
+            case BLE_ERROR_GATTS_SYS_ATTR_MISSING:
+            case BLE_ERROR_INVALID_CONN_HANDLE:
+                // Notification disabled by the peer, or the link is gone.
+                m_stats.dropped++;
+                queue_pop();
+                break;
+
+            default:
+                m_stats.dropped++;
+                queue_pop();
+                error_report(err_code);
+                break;
+        }
+    }
+}
+
+
+/**@brief Function for dropping all notifications queued for a connection. */
+static void queue_flush(uint16_t conn_handle)
+{
+    uint8_t kept = 0;
+    uint8_t i;
+
+    for (i = 0; i < m_count; i++)
+    {
+        ntf_entry_t * p_entry = &m_queue[queue_index(i)];
+
+        if (p_entry->conn_handle == conn_handle)
+        {
+            m_stats.dropped++;
+        }
+        else
+        {
+            if (kept != i)
+            {
+                m_queue[queue_index(kept)] = *p_entry;
+            }
+            kept++;
+        }
+    }
+    m_count = kept;
+}
+
+
+static void on_tx_complete(ble_evt_t * p_ble_evt)
+{
+    uint8_t count = p_ble_evt->evt.common_evt.params.tx_complete.count;
+
+    m_stats.tx_complete_evts++;
+    m_stats.tx_complete_pkts += count;
+    if (count > m_stats.max_pkts_per_evt)
+    {
+        m_stats.max_pkts_per_evt = count;
+    }
+
+    queue_process();
+}
+
+
+uint32_t ble_srv_ntf_queue_init(const ble_srv_ntf_queue_init_t * p_init)
+{
+    m_queue_config = *p_init;
+    m_head         = 0;
+    m_count        = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_srv_ntf_queue_send(uint16_t        conn_handle,
+                                uint16_t        value_handle,
+                                const uint8_t * p_data,
+                                uint16_t        len)
+{
+    ntf_entry_t * p_entry;
+
+    if (len > BLE_SRV_NTF_MAX_LEN)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    if (m_count == BLE_SRV_NTF_QUEUE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_entry               = &m_queue[queue_index(m_count)];
+    p_entry->conn_handle  = conn_handle;
+    p_entry->value_handle = value_handle;
+    p_entry->len          = len;
+    memcpy(p_entry->data, p_data, len);
+
+    m_count++;
+    m_stats.queued++;
+
+    queue_process();
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_srv_ntf_queue_append(uint16_t        conn_handle,
+                                  uint16_t        value_handle,
+                                  const uint8_t * p_data,
+                                  uint16_t        len)
+{
+    if (m_count > 0)
+    {
+        ntf_entry_t * p_tail = &m_queue[queue_index(m_count - 1)];
+
+        if ((p_tail->conn_handle == conn_handle)   &&
+            (p_tail->value_handle == value_handle) &&
+            (p_tail->len + len <= BLE_SRV_NTF_MAX_LEN))
+        {
+            // Still waiting for a TX buffer, so the sample can ride along.
+            memcpy(&p_tail->data[p_tail->len], p_data, len);
+            p_tail->len += len;
+            m_stats.packed++;
+            return NRF_SUCCESS;
+        }
+    }
+
+    return ble_srv_ntf_queue_send(conn_handle, value_handle, p_data, len);
+}
+
+
+uint8_t ble_srv_ntf_queue_free_count_get(void)
+{
+    return (uint8_t)(BLE_SRV_NTF_QUEUE_SIZE - m_count);
+}
+
+
+void ble_srv_ntf_queue_stats_get(ble_srv_ntf_queue_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+
+void ble_srv_ntf_queue_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_EVT_TX_COMPLETE:
+            on_tx_complete(p_ble_evt);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            queue_flush(p_ble_evt->evt.gap_evt.conn_handle);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
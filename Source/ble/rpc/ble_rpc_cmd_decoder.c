@@ -25,6 +25,48 @@
 #include "ble_gatts.h"
 #include "ble_ranges.h"
 #include "nordic_common.h"
+#include "app_scheduler.h"
+#include "app_error.h"
+
+#define RESP_SIZE_SMALL_MAX (RPC_CMD_RESP_STATUS_POS + sizeof(uint32_t) +                         \
+                             sizeof(ble_uuid128_t) + sizeof(uint8_t))  /**< Largest Command Response of the commands not listed in @ref resp_size_max_get. */
+
+static uint8_t *     mp_cmd;                       /**< Extracted command waiting for a TX buffer for its Command Response, NULL if none. */
+static uint32_t      m_cmd_length;                 /**< Length of the command in mp_cmd. */
+static uint32_t      m_cmd_unread_count;           /**< Number of received commands not yet extracted from the transport layer. */
+static uint8_t *     mp_resp_buffer;               /**< TX buffer reserved for the Command Response of the command being processed. */
+static uint32_t      m_resp_buffer_size;           /**< Size of the buffer in mp_resp_buffer. */
+static volatile bool m_is_retry_scheduled;         /**< True when @ref cmd_retry_handle has been scheduled and has not started yet. */
+
+
+/**@brief Function for getting a TX buffer for a Command Response.
+ *
+ * @details The buffer reserved before the command was processed is used if there is one.
+ *
+ * @param[in]   size        Size of the Command Response.
+ * @param[out]  pp_buffer   TX buffer.
+ *
+ * @retval      NRF_SUCCESS          TX buffer available.
+ * @retval      NRF_ERROR_DATA_SIZE  Command Response larger than the reserved buffer.
+ * @retval      NRF_ERROR_NO_MEM     No TX buffer available.
+ */
+static uint32_t resp_buffer_get(uint32_t size, uint8_t ** pp_buffer)
+{
+    if (mp_resp_buffer == NULL)
+    {
+        return hci_transport_tx_alloc_sized(size, pp_buffer);
+    }
+
+    if (size > m_resp_buffer_size)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    *pp_buffer     = mp_resp_buffer;
+    mp_resp_buffer = NULL;
+    return NRF_SUCCESS;
+}
+
 
 uint32_t ble_rpc_cmd_resp_send(uint8_t op_code, uint32_t status)
 {
@@ -32,14 +74,7 @@ uint32_t ble_rpc_cmd_resp_send(uint8_t op_code, uint32_t status)
     uint32_t  err_code;
     uint32_t  index = 0;
 
-    // Allocate a memory buffer from HCI transport layer for transmitting the Command Response.
-    // Loop until a buffer is available.
-    do
-    {    
-        err_code = hci_transport_tx_alloc(&p_buffer);
-    }
-    while (err_code == NRF_ERROR_NO_MEM);
-
+    err_code = resp_buffer_get(RPC_CMD_RESP_STATUS_POS + sizeof(uint32_t), &p_buffer);
     if (err_code == NRF_SUCCESS)
     {
         // Encode packet type.
@@ -67,14 +102,7 @@ uint32_t ble_rpc_cmd_resp_data_send(uint8_t               op_code,
     uint32_t  err_code;
     uint32_t  index = 0;
 
-    // Allocate a memory buffer from HCI transport layer for transmitting the Command Response.
-    // Loop until a buffer is available.
-    do
-    {    
-        err_code = hci_transport_tx_alloc(&p_buffer);
-    }
-    while (err_code == NRF_ERROR_NO_MEM);
-
+    err_code = resp_buffer_get(RPC_CMD_RESP_STATUS_POS + sizeof(uint32_t) + data_len, &p_buffer);
     if (err_code == NRF_SUCCESS)
     {
         // Encode packet type.
@@ -312,20 +340,111 @@ static uint32_t command_process(uint8_t * p_command, uint32_t command_len)
 }
 
 
+/**@brief Function for getting the size of the largest Command Response of a command.
+ *
+ * @param[in]   op_code     Operation code of the command.
+ *
+ * @return      Size of the largest Command Response in bytes.
+ */
+static uint32_t resp_size_max_get(uint8_t op_code)
+{
+    switch (op_code)
+    {
+        case SD_BLE_GAP_DEVICE_NAME_GET:
+        case SD_BLE_GATTS_SYS_ATTR_GET:
+            return RPC_BLE_PKT_MAX_SIZE;
+
+        default:
+            return RESP_SIZE_SMALL_MAX;
+    }
+}
+
+
+/**@brief Function for processing the received commands, for as long as TX buffers are available 
+ *        for their Command Responses.
+ *
+ * @details The TX buffer for the Command Response is reserved before the command is passed to the
+ *          SoftDevice. A command which does not get one is kept, and processed again once a TX 
+ *          buffer has been freed, see @ref ble_rpc_cmd_tx_done_handle.
+ */
+static void cmd_queue_process(void)
+{
+    uint32_t err_code;
+
+    while ((mp_cmd != NULL) || (m_cmd_unread_count != 0))
+    {
+        if (mp_cmd == NULL)
+        {
+            err_code = hci_transport_rx_pkt_extract(&mp_cmd, &m_cmd_length);
+            APP_ERROR_CHECK(err_code);
+            m_cmd_unread_count--;
+        }
+
+        m_resp_buffer_size = resp_size_max_get(mp_cmd[RPC_CMD_RESP_OP_CODE_POS]);
+        err_code           = hci_transport_tx_alloc_sized(m_resp_buffer_size, &mp_resp_buffer);
+        if (err_code == NRF_ERROR_NO_MEM)
+        {
+            mp_resp_buffer = NULL;
+            return;
+        }
+        APP_ERROR_CHECK(err_code);
+
+        err_code = command_process(&mp_cmd[RPC_CMD_RESP_OP_CODE_POS], m_cmd_length);
+        APP_ERROR_CHECK(err_code);
+
+        if (mp_resp_buffer != NULL)
+        {
+            // The command had no Command Response.
+            err_code = hci_transport_tx_buffer_free(mp_resp_buffer);
+            APP_ERROR_CHECK(err_code);
+            mp_resp_buffer = NULL;
+        }
+
+        err_code = hci_transport_rx_pkt_consume(mp_cmd);
+        APP_ERROR_CHECK(err_code);
+        mp_cmd = NULL;
+    }
+}
+
+
+/**@brief Function for processing the commands which waited for a TX buffer.
+ *
+ * @param[in]   p_event_data   Not used.
+ * @param[in]   event_size     Not used.
+ */
+static void cmd_retry_handle(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    m_is_retry_scheduled = false;
+    cmd_queue_process();
+}
+
+
 void ble_rpc_cmd_handle(void * p_event_data, uint16_t event_size)
 {
-    uint32_t  err_code;
-    uint32_t  rpc_cmd_length_read;
-    uint8_t * p_rpc_cmd_buffer;
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
 
-    err_code = hci_transport_rx_pkt_extract(&p_rpc_cmd_buffer, &rpc_cmd_length_read);
-    APP_ERROR_CHECK(err_code);
+    // Commands are processed in the order they were received, so this one may have to wait for 
+    // an earlier one.
+    m_cmd_unread_count++;
+    cmd_queue_process();
+}
 
-    err_code = command_process(&p_rpc_cmd_buffer[RPC_CMD_RESP_OP_CODE_POS], rpc_cmd_length_read);
-    APP_ERROR_CHECK(err_code);
 
-    err_code = hci_transport_rx_pkt_consume(p_rpc_cmd_buffer);
-    APP_ERROR_CHECK(err_code);
+void ble_rpc_cmd_tx_done_handle(void)
+{
+    // Scheduled even if no command is waiting, as one may be about to find no TX buffer.
+    if (!m_is_retry_scheduled)
+    {
+        uint32_t err_code;
+
+        m_is_retry_scheduled = true;
+        err_code             = app_sched_event_put(NULL, 0, cmd_retry_handle);
+        APP_ERROR_CHECK(err_code);
+    }
 }
 
 
@@ -20,6 +20,7 @@
 #include "ble_gap.h"
 #include "ble_rpc_cmd_decoder.h"
 #include "ble_rpc_defines.h"
+#include "ble_rpc_codec_gap.h"
 #include "nrf_error.h"
 #include "nordic_common.h"
 
@@ -41,31 +42,12 @@ static uint8_t conn_sec_mode_decode(ble_gap_conn_sec_mode_t * const p_conn_sec_m
 }
 
 
-/**@brief Function for decoding a ble_gap_addr_t from an input buffer.
- *
- * @param[out]  p_addr          The pointer to the decode result structure.
- * @param[in]   p_buffer        The buffer containing the encoded ble_gap_addr_t.
- *
- * @return      Number of bytes decoded.
- */
-static uint8_t addr_decode(ble_gap_addr_t * const p_addr, const uint8_t * const p_buffer)
-{
-    uint32_t index = 0;
-
-    p_addr->addr_type = p_buffer[index++];
-    memcpy(p_addr->addr, &(p_buffer[index]), BLE_GAP_ADDR_LEN);
-
-    index += BLE_GAP_ADDR_LEN;
-
-    return index;
-}
-
-
 /**@brief Function for decoding a ble_gap_whitelist_t from an input buffer.
  *
- * @param[out]   p_wl           The pointer to the decode result structure.
- * @param[in]    p_buffer       The buffer containing the encoded ble_gap_whitelist_t.
- * @param[out]   p_len          Number of bytes decoded.
+ * @param[out]    p_wl           The pointer to the decode result structure.
+ * @param[in]     p_buffer       The buffer containing the encoded ble_gap_whitelist_t.
+ * @param[in]     buf_len        Length of the data in the buffer.
+ * @param[in,out] p_index        Position in the buffer, advanced past the decoded whitelist.
  *
  * @retval NRF_SUCCESS               If the decoding of whitelists was successful.
  * @retval NRF_ERROR_INVALID_LENGTH  If the content length of the packet is not conforming to the
@@ -73,55 +55,66 @@ static uint8_t addr_decode(ble_gap_addr_t * const p_addr, const uint8_t * const
  */
 static uint32_t whitelist_decode(ble_gap_whitelist_t * const p_wl,
                                  const uint8_t * const       p_buffer,
-                                 uint8_t *                   p_len)
+                                 uint32_t                    buf_len,
+                                 uint32_t *                  p_index)
 {
-    uint32_t index      = 0;
-    uint32_t error_code = NRF_SUCCESS;
+    uint32_t i;
+    uint32_t err_code;
+    uint32_t index = *p_index;
 
     static ble_gap_addr_t * p_addresses[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
     static ble_gap_addr_t   addresses[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
     static ble_gap_irk_t  * p_irks[BLE_GAP_WHITELIST_IRK_MAX_COUNT];
     static ble_gap_irk_t    irks[BLE_GAP_WHITELIST_IRK_MAX_COUNT];
 
+    if (index >= buf_len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
     p_wl->addr_count = p_buffer[index++];
-
     if (p_wl->addr_count > BLE_GAP_WHITELIST_ADDR_MAX_COUNT)
     {
-        error_code = NRF_ERROR_INVALID_LENGTH;
+        return NRF_ERROR_INVALID_LENGTH;
     }
-    else
-    {
-        uint32_t i;
 
-        for (i = 0; i < p_wl->addr_count; i++)
+    for (i = 0; i < p_wl->addr_count; i++)
+    {
+        err_code = ble_rpc_struct_decode(&g_ble_rpc_gap_addr_desc,
+                                         &(addresses[i]),
+                                         p_buffer,
+                                         buf_len,
+                                         &index);
+        if (err_code != NRF_SUCCESS)
         {
-            index          += addr_decode(&(addresses[i]), &(p_buffer[index]));
-            p_addresses[i]  = &(addresses[i]);
+            return err_code;
         }
+        p_addresses[i] = &(addresses[i]);
+    }
 
-        p_wl->irk_count = p_buffer[index++];
-        if (p_wl->irk_count > BLE_GAP_WHITELIST_IRK_MAX_COUNT)
-        {
-            error_code = NRF_ERROR_INVALID_LENGTH;
-        }
-        else
-        {
-            for (i = 0; i < p_wl->irk_count; i++)
-            {
-                // Reuse the memory used by the buffer because irk is also a byte array like
-                // the buffer.
-                memcpy(irks[i].irk, &(p_buffer[index]), BLE_GAP_SEC_KEY_LEN);
-                index      += BLE_GAP_SEC_KEY_LEN;
-                p_irks[i]   = &irks[i];
-            }
-        }
-        p_wl->pp_addrs = (p_wl->addr_count != 0) ? p_addresses : NULL;
-        p_wl->pp_irks  = (p_wl->irk_count != 0) ? p_irks : NULL;
+    if (index >= buf_len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    p_wl->irk_count = p_buffer[index++];
+    if ((p_wl->irk_count > BLE_GAP_WHITELIST_IRK_MAX_COUNT) ||
+        (index + p_wl->irk_count * BLE_GAP_SEC_KEY_LEN > buf_len))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
     }
 
-    *p_len = index;
+    for (i = 0; i < p_wl->irk_count; i++)
+    {
+        memcpy(irks[i].irk, &(p_buffer[index]), BLE_GAP_SEC_KEY_LEN);
+        index     += BLE_GAP_SEC_KEY_LEN;
+        p_irks[i]  = &irks[i];
+    }
+
+    p_wl->pp_addrs = (p_wl->addr_count != 0) ? p_addresses : NULL;
+    p_wl->pp_irks  = (p_wl->irk_count != 0) ? p_irks : NULL;
+
+    *p_index = index;
 
-    return error_code;
+    return NRF_SUCCESS;
 }
 
 /**@brief Function for decoding security parameters fields in RPC_SD_BLE_GAP_SEC_PARAMS_REPLY
@@ -396,22 +389,16 @@ static uint32_t gap_ppcp_set_handle(uint8_t * p_command, uint32_t command_len)
     uint32_t                index        = 0;
     ble_gap_conn_params_t * p_conn_param = NULL;
 
-    if (p_command[index++] == RPC_BLE_FIELD_PRESENT)
+    err_code = ble_rpc_opt_struct_decode(&g_ble_rpc_gap_conn_params_desc,
+                                         &conn_params,
+                                         (void **)&p_conn_param,
+                                         p_command,
+                                         command_len,
+                                         &index);
+    if (err_code != NRF_SUCCESS)
     {
-        conn_params.min_conn_interval   = uint16_decode(&p_command[index]);
-        index += sizeof(uint16_t);
-
-        conn_params.max_conn_interval   = uint16_decode(&p_command[index]);
-        index += sizeof(uint16_t);
-
-        conn_params.slave_latency       = uint16_decode(&p_command[index]);
-        index += sizeof(uint16_t);
-
-        conn_params.conn_sup_timeout    = uint16_decode(&p_command[index]);
-        p_conn_param = &conn_params;
+        return ble_rpc_cmd_resp_send(SD_BLE_GAP_PPCP_SET, err_code);
     }
-    
-    RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_PPCP_SET);
 
     err_code = sd_ble_gap_ppcp_set(p_conn_param);
 
@@ -438,9 +425,9 @@ static uint32_t gap_ppcp_get_handle(uint8_t * p_command, uint32_t command_len)
 {
     uint32_t              err_code;
     ble_gap_conn_params_t conn_params;
-    uint8_t               resp_data[sizeof(ble_gap_conn_params_t)];
+    uint8_t               resp_data[BLE_RPC_GAP_CONN_PARAMS_SIZE_MAX];
 
-    uint8_t  encode_index = 0;
+    uint32_t encode_index = 0;
     uint32_t index        = 0;
 
     // Pointer to the connection parameters result buffer.
@@ -456,14 +443,21 @@ static uint32_t gap_ppcp_get_handle(uint8_t * p_command, uint32_t command_len)
 
     err_code = sd_ble_gap_ppcp_get(p_conn_params);
 
-    if (err_code == NRF_SUCCESS)
+    if ((err_code == NRF_SUCCESS) && (p_conn_params != NULL))
     {
-        encode_index += uint16_encode(p_conn_params->min_conn_interval, &resp_data[encode_index]);
-        encode_index += uint16_encode(p_conn_params->max_conn_interval, &resp_data[encode_index]);
-        encode_index += uint16_encode(p_conn_params->slave_latency    , &resp_data[encode_index]);
-        encode_index += uint16_encode(p_conn_params->conn_sup_timeout , &resp_data[encode_index]);
+        err_code = ble_rpc_struct_encode(&g_ble_rpc_gap_conn_params_desc,
+                                         p_conn_params,
+                                         resp_data,
+                                         sizeof(resp_data),
+                                         &encode_index);
+    }
 
-        return ble_rpc_cmd_resp_data_send(SD_BLE_GAP_PPCP_GET, err_code, resp_data, encode_index);
+    if (err_code == NRF_SUCCESS)
+    {
+        return ble_rpc_cmd_resp_data_send(SD_BLE_GAP_PPCP_GET, 
+                                          err_code, 
+                                          resp_data, 
+                                          (uint16_t)encode_index);
     }
     else
     {
@@ -489,6 +483,7 @@ static uint32_t gap_ppcp_get_handle(uint8_t * p_command, uint32_t command_len)
  */
 static uint32_t gap_adv_start_handle(uint8_t * p_command, uint32_t command_len)
 {
+    uint32_t             err_code;
     ble_gap_adv_params_t adv_params;
     ble_gap_addr_t       directed_peer_address;
     ble_gap_whitelist_t  white_list;
@@ -498,17 +493,16 @@ static uint32_t gap_adv_start_handle(uint8_t * p_command, uint32_t command_len)
     adv_params.type = p_command[index++];
     RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_ADV_START);
 
-    if (p_command[index++] == RPC_BLE_FIELD_PRESENT)
+    // Decode the peer address, if present.
+    err_code = ble_rpc_opt_struct_decode(&g_ble_rpc_gap_addr_desc,
+                                         &directed_peer_address,
+                                         (void **)&adv_params.p_peer_addr,
+                                         p_command,
+                                         command_len,
+                                         &index);
+    if (err_code != NRF_SUCCESS)
     {
-        // Peer Address Present. Decode the peer address.
-        index                  += addr_decode(&directed_peer_address, &(p_command[index]));
-        adv_params.p_peer_addr  = &(directed_peer_address);
-
-        RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_ADV_START);
-    }
-    else
-    {
-        adv_params.p_peer_addr = NULL;
+        return ble_rpc_cmd_resp_send(SD_BLE_GAP_ADV_START, err_code);
     }
 
     adv_params.fp = p_command[index++];
@@ -517,18 +511,12 @@ static uint32_t gap_adv_start_handle(uint8_t * p_command, uint32_t command_len)
     // Whitelist present.
     if (p_command[index++] == RPC_BLE_FIELD_PRESENT)
     {
-        uint8_t  decoded_length = 0;
-        uint32_t err_code       = whitelist_decode(&white_list,
-                                                   &(p_command[index]),
-                                                   &decoded_length);
+        err_code = whitelist_decode(&white_list, p_command, command_len, &index);
         if (err_code != NRF_SUCCESS)
         {
             return ble_rpc_cmd_resp_send(SD_BLE_GAP_ADV_START, err_code);
         }
-        index = index + decoded_length;
-        RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_ADV_START);
         adv_params.p_whitelist = &white_list;
-        RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_ADV_START);
     }
     else
     {
@@ -540,9 +528,10 @@ static uint32_t gap_adv_start_handle(uint8_t * p_command, uint32_t command_len)
     RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_ADV_START);
 
     adv_params.timeout  = uint16_decode(&p_command[index]);
+    index              += sizeof(uint16_t);
     RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_ADV_START);
 
-    uint32_t err_code   = sd_ble_gap_adv_start(&adv_params);
+    err_code = sd_ble_gap_adv_start(&adv_params);
 
     return ble_rpc_cmd_resp_send(SD_BLE_GAP_ADV_START, err_code);
 }
@@ -703,21 +692,18 @@ static uint32_t gap_conn_param_update_handle(const uint8_t * const p_command, ui
     index       += sizeof(uint16_t);
     RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_CONN_PARAM_UPDATE);
 
-    // Check if the Connection Parameters field is present.
-    if (p_command[index++] == RPC_BLE_FIELD_PRESENT)
+    // Decode the Connection Parameters field, if present.
+    err_code = ble_rpc_opt_struct_decode(&g_ble_rpc_gap_conn_params_desc,
+                                         &conn_params,
+                                         (void **)&p_conn_params,
+                                         p_command,
+                                         command_len,
+                                         &index);
+    if (err_code != NRF_SUCCESS)
     {
-        conn_params.min_conn_interval   = uint16_decode(&p_command[index]);
-        index                           += sizeof(uint16_t);
-        conn_params.max_conn_interval   = uint16_decode(&p_command[index]);
-        index                           += sizeof(uint16_t);
-        conn_params.slave_latency       = uint16_decode(&p_command[index]);
-        index                           += sizeof(uint16_t);
-        conn_params.conn_sup_timeout    = uint16_decode(&p_command[index]);
-        p_conn_params                   = &conn_params;
+        return ble_rpc_cmd_resp_send(SD_BLE_GAP_CONN_PARAM_UPDATE, err_code);
     }
 
-    RPC_DECODER_LENGTH_CHECK(command_len, index, SD_BLE_GAP_CONN_PARAM_UPDATE);
-
     err_code = sd_ble_gap_conn_param_update(conn_handle, p_conn_params);
 
     return ble_rpc_cmd_resp_send(SD_BLE_GAP_CONN_PARAM_UPDATE, err_code);
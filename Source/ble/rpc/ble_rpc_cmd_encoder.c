@@ -19,27 +19,192 @@
 #include "app_util.h"
 #include "hci_transport.h"
 #include "nordic_common.h"
+#include "app_timer.h"
 
 #define INVALID_OP_CODE 0xFF                 /**< Invalid operation code used for invalidating command response. */
+#define ASYNC_QUEUE_LEN (BLE_RPC_CMD_ASYNC_QUEUE_SIZE + 1) /**< Length of the asynchronous command queues, one entry is always left unused to tell a full queue from an empty one. */
+
+/**@brief Asynchronous command awaiting its response. */
+typedef struct
+{
+    uint16_t                   cmd_id;       /**< Identifier given to the command. */
+    uint8_t                    op_code;      /**< Operation code of the command. */
+    ble_rpc_cmd_resp_handler_t resp_handler; /**< Response handler, NULL if the response is not of interest. */
+    void *                     p_context;    /**< Context passed to the response handler. */
+    uint32_t                   send_ticks;   /**< RTC1 counter value when the command was sent. */
+    bool                       is_failed;    /**< True if the transport layer failed to deliver the command. */
+} async_cmd_t;
 
 uint8_t *               g_cmd_buffer;        /**< Pointer to the buffer used for storing serialized commands. */
 uint8_t *               g_cmd_response_buf;  /**< Pointer to the buffer used for storing command response. */
 volatile cmd_response_t g_cmd_response;      /**< Response of last received command/response. */
 volatile bool           m_tx_done = false;   /**< Variable used for signaling when transmission of the last command is complete. */
 
+static volatile bool    m_tx_failed;                             /**< True if the transport layer failed to deliver the last synchronous command. */
+static uint8_t          m_tx_failed_resp_buf[RPC_BLE_CMD_RESP_PKT_MIN_SIZE + sizeof(uint8_t)]; /**< Empty response given to a synchronous command which was not delivered. */
+
+static async_cmd_t      m_async_resp_queue[ASYNC_QUEUE_LEN]; /**< Asynchronous commands awaiting their response, in the order they were sent. */
+static volatile uint8_t m_async_resp_write_index;                         /**< Index where the next asynchronous command will be stored. */
+static volatile uint8_t m_async_resp_read_index;                          /**< Index of the oldest asynchronous command awaiting its response. */
+static uint8_t *        m_async_tx_queue[ASYNC_QUEUE_LEN];   /**< TX buffers of asynchronous commands awaiting TX done, in the order they were written. */
+static volatile uint8_t m_async_tx_write_index;                           /**< Index where the next TX buffer will be stored. */
+static volatile uint8_t m_async_tx_read_index;                            /**< Index of the oldest TX buffer awaiting TX done. */
+static uint8_t          m_async_tx_resp_index[ASYNC_QUEUE_LEN];           /**< Index in m_async_resp_queue of the command in the same entry of m_async_tx_queue. */
+static uint16_t         m_next_cmd_id;                                    /**< Identifier for the next asynchronous command. */
+static ble_rpc_cmd_stats_t m_stats;                                       /**< Command latency statistics. */
+
+
+/**@brief Function for reading the RTC1 counter.
+ *
+ * @return Current RTC1 counter value.
+ */
+static uint32_t ticks_get(void)
+{
+    uint32_t ticks = 0;
+
+    UNUSED_VARIABLE(app_timer_cnt_get(&ticks));
+    return ticks;
+}
+
+
+/**@brief Function for recording the completion of a command in the statistics.
+ *
+ * @param[in] send_ticks  RTC1 counter value when the command was sent.
+ */
+static void latency_record(uint32_t send_ticks)
+{
+    uint32_t latency = 0;
+    uint32_t bucket  = 0;
+
+    UNUSED_VARIABLE(app_timer_cnt_diff_compute(ticks_get(), send_ticks, &latency));
+
+    // Bucket n holds the latencies below 2^n ticks not held by bucket n - 1.
+    while ((bucket < (BLE_RPC_CMD_LATENCY_BUCKET_COUNT - 1)) && ((latency >> bucket) != 0))
+    {
+        bucket++;
+    }
+
+    if ((m_stats.cmd_count == 0) || (latency < m_stats.latency_min))
+    {
+        m_stats.latency_min = latency;
+    }
+    if (latency > m_stats.latency_max)
+    {
+        m_stats.latency_max = latency;
+    }
+    m_stats.latency_sum += latency;
+    m_stats.latency_histogram[bucket]++;
+    m_stats.cmd_count++;
+}
+
+
+/**@brief Function for advancing an index of the asynchronous command queues.
+ *
+ * @param[in] index   Index to advance.
+ *
+ * @return    The next index.
+ */
+static __INLINE uint8_t async_index_next(uint8_t index)
+{
+    return (uint8_t)((index + 1u) % ASYNC_QUEUE_LEN);
+}
+
+
+/**@brief Function for completing the oldest asynchronous command with its response.
+ *
+ * @param[in] packet          The response packet.
+ * @param[in] packet_length   The length of the response packet.
+ */
+static void async_resp_handle(uint8_t * packet, uint16_t packet_length)
+{
+    const async_cmd_t * p_cmd    = &m_async_resp_queue[m_async_resp_read_index];
+    uint32_t            err_code = NRF_ERROR_INTERNAL;
+    const uint8_t *     p_data   = NULL;
+    uint16_t            data_len = 0;
+
+    if ((packet_length >= RPC_BLE_CMD_RESP_PKT_MIN_SIZE) &&
+        (packet[BLE_PKT_TYPE_SIZE] == p_cmd->op_code))
+    {
+        err_code = uint32_decode(&packet[BLE_PKT_TYPE_SIZE + BLE_OP_CODE_SIZE]);
+        p_data   = &packet[RPC_BLE_CMD_RESP_PKT_MIN_SIZE];
+        data_len = packet_length - RPC_BLE_CMD_RESP_PKT_MIN_SIZE;
+    }
+
+    latency_record(p_cmd->send_ticks);
+
+    if (p_cmd->resp_handler != NULL)
+    {
+        p_cmd->resp_handler(p_cmd->cmd_id, err_code, p_data, data_len, p_cmd->p_context);
+    }
+
+    UNUSED_VARIABLE(hci_transport_rx_pkt_consume(packet));
+    m_async_resp_read_index = async_index_next(m_async_resp_read_index);
+}
+
+
+/**@brief Function for completing the oldest asynchronous commands for as long as they are ones
+ *        the transport layer failed to deliver.
+ *
+ * @details The response handler gets NRF_ERROR_TIMEOUT. A failed command is completed only once
+ *          the commands sent before it are, to keep the responses in order.
+ */
+static void async_failed_complete(void)
+{
+    while ((m_async_resp_read_index != m_async_resp_write_index) &&
+           m_async_resp_queue[m_async_resp_read_index].is_failed)
+    {
+        const async_cmd_t * p_cmd = &m_async_resp_queue[m_async_resp_read_index];
+
+        if (p_cmd->resp_handler != NULL)
+        {
+            p_cmd->resp_handler(p_cmd->cmd_id, NRF_ERROR_TIMEOUT, NULL, 0, p_cmd->p_context);
+        }
+
+        m_async_resp_read_index = async_index_next(m_async_resp_read_index);
+    }
+}
+
+
+/**@brief Function for marking the asynchronous command of the oldest TX buffer as failed.
+ *
+ * @details Nothing is done if the response of the command has already been received.
+ */
+static void async_tx_fail(void)
+{
+    const uint8_t resp_index = m_async_tx_resp_index[m_async_tx_read_index];
+
+    // Pending commands are the ones from the read index up to the write index.
+    if (((resp_index + ASYNC_QUEUE_LEN - m_async_resp_read_index) % ASYNC_QUEUE_LEN) <
+        ((m_async_resp_write_index + ASYNC_QUEUE_LEN - m_async_resp_read_index) % ASYNC_QUEUE_LEN))
+    {
+        m_async_resp_queue[resp_index].is_failed = true;
+    }
+}
+
 
 void ble_rpc_cmd_rsp_pkt_received(uint8_t * packet, uint16_t packet_length)
 {
     uint32_t index = 0;
 
-    g_cmd_response_buf = packet;
-
-    if (g_cmd_response_buf[index++] != BLE_RPC_PKT_RESP)
+    if (packet[0] != BLE_RPC_PKT_RESP)
     {
         // Received a packet that is not of interest to the command encoder.
         return;
     }
 
+    // The connectivity chip executes the commands in the order received, so a response belongs 
+    // to the oldest asynchronous command if there is one, otherwise to the synchronous command.
+    async_failed_complete();
+    if (m_async_resp_read_index != m_async_resp_write_index)
+    {
+        async_resp_handle(packet, packet_length);
+        return;
+    }
+
+    g_cmd_response_buf = packet;
+    index++;
+
+    g_cmd_response.length  = packet_length;
     g_cmd_response.op_code = g_cmd_response_buf[index++];
 
     if (packet_length >= RPC_BLE_CMD_RESP_PKT_MIN_SIZE)
@@ -55,11 +220,34 @@ void ble_rpc_cmd_rsp_pkt_received(uint8_t * packet, uint16_t packet_length)
 /**@brief Function for the transport layer to indicate when it has finished transmitting the bytes from 
  *        the TX buffer.
  *
+ * @details A synchronous command is only written once the earlier asynchronous commands are 
+ *          written, and no command is written while it is in transmission. The TX done events 
+ *          therefore belong to the queued asynchronous commands first.
+ *
+ *          A command which the transport layer failed to deliver is completed with
+ *          NRF_ERROR_TIMEOUT, as its response may never arrive. It runs in the same context as
+ *          @ref ble_rpc_cmd_rsp_pkt_received.
+ *
  * @param[in] result    TX done event result code.
  */
 void transport_tx_complete_handler(hci_transport_tx_done_result_t result)
 {
-    m_tx_done = true;
+    if (m_async_tx_read_index != m_async_tx_write_index)
+    {
+        if (result == HCI_TRANSPORT_TX_DONE_FAILURE)
+        {
+            async_tx_fail();
+        }
+
+        UNUSED_VARIABLE(hci_transport_tx_buffer_free(m_async_tx_queue[m_async_tx_read_index]));
+        m_async_tx_read_index = async_index_next(m_async_tx_read_index);
+
+        async_failed_complete();
+        return;
+    }
+
+    m_tx_failed = (result == HCI_TRANSPORT_TX_DONE_FAILURE);
+    m_tx_done   = true;
 }
 
 
@@ -72,6 +260,9 @@ void transport_tx_complete_handler(hci_transport_tx_done_result_t result)
  */
 uint32_t ble_rpc_cmd_resp_wait(uint8_t op_code)
 {
+    // The command has just been written.
+    const uint32_t send_ticks = ticks_get();
+
     for (;;)
     {
         __WFE();
@@ -79,10 +270,25 @@ uint32_t ble_rpc_cmd_resp_wait(uint8_t op_code)
         if (m_tx_done && (g_cmd_response.op_code == op_code))
         {
             m_tx_done              = false;
+            m_tx_failed            = false;
             g_cmd_response.op_code = INVALID_OP_CODE;
 
+            latency_record(send_ticks);
+
             return g_cmd_response.err_code;
         }
+
+        if (m_tx_done && m_tx_failed)
+        {
+            // No response will follow. The empty response makes the caller read no data, and 
+            // consuming it has no effect.
+            m_tx_done             = false;
+            m_tx_failed           = false;
+            g_cmd_response_buf    = m_tx_failed_resp_buf;
+            g_cmd_response.length = sizeof(m_tx_failed_resp_buf);
+
+            return NRF_ERROR_TIMEOUT;
+        }
     }
 }
 
@@ -96,12 +302,78 @@ uint32_t wait_for_tx_done(void)
         if (m_tx_done)
         {
             m_tx_done = false;
+            if (m_tx_failed)
+            {
+                m_tx_failed = false;
+                return NRF_ERROR_TIMEOUT;
+            }
             return NRF_SUCCESS;
         }
     }
 }
 
 
+uint32_t ble_rpc_cmd_async_send(uint8_t *                  p_buffer,
+                                uint16_t                   length,
+                                ble_rpc_cmd_resp_handler_t resp_handler,
+                                void *                     p_context,
+                                uint16_t *                 p_cmd_id)
+{
+    uint32_t      err_code;
+    async_cmd_t * p_cmd;
+    const uint8_t resp_write_index = m_async_resp_write_index;
+    const uint8_t tx_write_index   = m_async_tx_write_index;
+
+    if ((async_index_next(resp_write_index) == m_async_resp_read_index) ||
+        (async_index_next(tx_write_index) == m_async_tx_read_index))
+    {
+        UNUSED_VARIABLE(hci_transport_tx_buffer_free(p_buffer));
+        return NRF_ERROR_NO_MEM;
+    }
+
+    // Both queue entries must be in place before the packet is written, as the TX done event and 
+    // the response may arrive before the write function returns.
+    p_cmd               = &m_async_resp_queue[resp_write_index];
+    p_cmd->cmd_id       = m_next_cmd_id;
+    p_cmd->op_code      = p_buffer[BLE_PKT_TYPE_SIZE];
+    p_cmd->resp_handler = resp_handler;
+    p_cmd->p_context    = p_context;
+    p_cmd->send_ticks   = ticks_get();
+    p_cmd->is_failed    = false;
+
+    m_async_tx_queue[tx_write_index]      = p_buffer;
+    m_async_tx_resp_index[tx_write_index] = resp_write_index;
+
+    m_async_resp_write_index = async_index_next(resp_write_index);
+    m_async_tx_write_index   = async_index_next(tx_write_index);
+
+    err_code = hci_transport_pkt_write(p_buffer, length);
+    if (err_code != NRF_SUCCESS)
+    {
+        // Nothing was sent, so nothing was completed either.
+        m_async_resp_write_index = resp_write_index;
+        m_async_tx_write_index   = tx_write_index;
+        UNUSED_VARIABLE(hci_transport_tx_buffer_free(p_buffer));
+        return err_code;
+    }
+
+    if (p_cmd_id != NULL)
+    {
+        *p_cmd_id = m_next_cmd_id;
+    }
+    m_next_cmd_id++;
+
+    return NRF_SUCCESS;
+}
+
+
+uint8_t ble_rpc_cmd_async_pending_count_get(void)
+{
+    return (uint8_t)((m_async_resp_write_index + ASYNC_QUEUE_LEN - m_async_resp_read_index) % 
+                     ASYNC_QUEUE_LEN);
+}
+
+
 uint32_t sd_ble_uuid_encode(ble_uuid_t const * const p_uuid,
                             uint8_t          * const p_uuid_le_len,
                             uint8_t          * const p_uuid_le)
@@ -187,11 +459,53 @@ uint32_t sd_power_system_off(void)
 }
 
 
+void ble_rpc_cmd_stats_get(ble_rpc_cmd_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
+
+
+void ble_rpc_cmd_stats_reset(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+
+uint32_t ble_rpc_cmd_latency_percentile_get(const ble_rpc_cmd_stats_t * p_stats, uint8_t percent)
+{
+    uint32_t bucket;
+    uint32_t count  = 0;
+    uint32_t target = (uint32_t)(((uint64_t)p_stats->cmd_count * percent + 99) / 100);
+
+    if (p_stats->cmd_count == 0)
+    {
+        return 0;
+    }
+
+    for (bucket = 0; bucket < (BLE_RPC_CMD_LATENCY_BUCKET_COUNT - 1); bucket++)
+    {
+        count += p_stats->latency_histogram[bucket];
+        if (count >= target)
+        {
+            // Upper bound of the bucket, but never above the highest latency seen.
+            return MIN((1uL << bucket) - 1, p_stats->latency_max);
+        }
+    }
+
+    return p_stats->latency_max;
+}
+
+
 uint32_t ble_rpc_cmd_encoder_init(void)
 {
     // Allocate memory for serialized commands. This module will use the same memory for all
     // commands.
     uint32_t err_code;
+
+    m_async_resp_write_index = 0;
+    m_async_resp_read_index  = 0;
+    m_async_tx_write_index   = 0;
+    m_async_tx_read_index    = 0;
     
     err_code = hci_transport_tx_done_register(transport_tx_complete_handler);
     if (err_code != NRF_SUCCESS)
@@ -15,39 +15,16 @@
 #include "app_util.h"
 #include "ble_rpc_cmd_encoder.h"
 #include "ble_rpc_defines.h"
+#include "ble_rpc_codec_gap.h"
 #include "hci_transport.h"
 #include <string.h>
 
 // The following externals are defined in ble_rpc_dms_encoder.c.
-extern uint8_t * g_cmd_response_buf; /**< Pointer to the buffer used for storing command response. */
-extern uint8_t * g_cmd_buffer;       /**< Pointer to the buffer used for storing serialized commands. */
+extern uint8_t *               g_cmd_response_buf; /**< Pointer to the buffer used for storing command response. */
+extern uint8_t *               g_cmd_buffer;       /**< Pointer to the buffer used for storing serialized commands. */
+extern volatile cmd_response_t g_cmd_response;     /**< Response of last received command/response. */
 
-
-/**@brief       Function for encoding the peer address into the packet array provided and returning
- *              the number of bytes encoded.
- *
- * @param[in]   p_packet        Pointer to the memory location where the encoded peer address should
- *                              be stored. The memory location should hold minimum
- *                              @ref BLE_GAP_ADDR_LEN + addr_type of data (7 bytes total).
- * @param[in]   p_peer_address  Pointer to the peer address that should be encoded.
- *
- * @return      Number of bytes encoded.
- */
-static uint32_t peer_address_encode(uint8_t *                    p_packet,
-                                    const ble_gap_addr_t * const p_peer_address)
-{
-    uint32_t i;
-    uint32_t index = 0;
-
-    p_packet[index++] = p_peer_address->addr_type;
-
-    for (i = 0; i < BLE_GAP_ADDR_LEN; i++)
-    {
-        p_packet[index++] = p_peer_address->addr[i];
-    }
-
-    return index;
-}
+#define CMD_BUF_SIZE    RPC_BLE_PKT_MAX_SIZE        /**< Size of g_cmd_buffer, a TX buffer of the transport layer. */
 
 
 /**@brief       Function for encoding the whitelist into the packet array provided and returning
@@ -230,21 +207,17 @@ uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * const p_conn_params)
     g_cmd_buffer[index++] = BLE_RPC_PKT_CMD;
     g_cmd_buffer[index++] = SD_BLE_GAP_PPCP_SET;
 
-    if (p_conn_params != NULL)
-    {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-
-        index += uint16_encode(p_conn_params->min_conn_interval, &g_cmd_buffer[index]);
-        index += uint16_encode(p_conn_params->max_conn_interval, &g_cmd_buffer[index]);
-        index += uint16_encode(p_conn_params->slave_latency    , &g_cmd_buffer[index]);
-        index += uint16_encode(p_conn_params->conn_sup_timeout, &g_cmd_buffer[index]);
-    }
-    else
+    uint32_t err_code = ble_rpc_opt_struct_encode(&g_ble_rpc_gap_conn_params_desc,
+                                                  p_conn_params,
+                                                  g_cmd_buffer,
+                                                  CMD_BUF_SIZE,
+                                                  &index);
+    if (err_code != NRF_SUCCESS)
     {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+        return err_code;
     }
 
-    uint32_t err_code = hci_transport_pkt_write(g_cmd_buffer, index);
+    err_code = hci_transport_pkt_write(g_cmd_buffer, index);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -280,11 +253,14 @@ uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t * const p_conn_params)
     }
 
     err_code = ble_rpc_cmd_resp_wait(SD_BLE_GAP_PPCP_GET);
-    if (p_conn_params != NULL)
+    if ((err_code == NRF_SUCCESS) && (p_conn_params != NULL))
     {
-        memcpy(p_conn_params, 
-               &(g_cmd_response_buf[BLE_OP_CODE_SIZE + BLE_PKT_TYPE_SIZE + RPC_ERR_CODE_SIZE]),
-               sizeof(*p_conn_params));
+        index    = BLE_OP_CODE_SIZE + BLE_PKT_TYPE_SIZE + RPC_ERR_CODE_SIZE;
+        err_code = ble_rpc_struct_decode(&g_ble_rpc_gap_conn_params_desc,
+                                         p_conn_params,
+                                         g_cmd_response_buf,
+                                         g_cmd_response.length,
+                                         &index);
     }
                
     UNUSED_VARIABLE(hci_transport_rx_pkt_consume(g_cmd_response_buf));
@@ -300,15 +276,14 @@ uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * const p_adv_params)
     g_cmd_buffer[index++] = SD_BLE_GAP_ADV_START;
     g_cmd_buffer[index++] = p_adv_params->type;
 
-    if (p_adv_params->p_peer_addr == NULL)
-    {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
-    }
-    else
+    uint32_t err_code = ble_rpc_opt_struct_encode(&g_ble_rpc_gap_addr_desc,
+                                                  p_adv_params->p_peer_addr,
+                                                  g_cmd_buffer,
+                                                  CMD_BUF_SIZE,
+                                                  &index);
+    if (err_code != NRF_SUCCESS)
     {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-        index                += peer_address_encode(&g_cmd_buffer[index],
-                                                    p_adv_params->p_peer_addr);
+        return err_code;
     }
 
     g_cmd_buffer[index++] = p_adv_params->fp;
@@ -326,7 +301,7 @@ uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * const p_adv_params)
     index += uint16_encode(p_adv_params->interval, &g_cmd_buffer[index]);
     index += uint16_encode(p_adv_params->timeout, &g_cmd_buffer[index]);
     
-    uint32_t err_code = hci_transport_pkt_write(g_cmd_buffer, index);
+    err_code = hci_transport_pkt_write(g_cmd_buffer, index);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -466,24 +441,17 @@ uint32_t sd_ble_gap_conn_param_update(uint16_t                            conn_h
     g_cmd_buffer[index++] = SD_BLE_GAP_CONN_PARAM_UPDATE;
     index                += uint16_encode(conn_handle, &g_cmd_buffer[index]);
 
-    if (p_conn_params != NULL)
-    {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-        index                += uint16_encode(p_conn_params->min_conn_interval, 
-                                              &g_cmd_buffer[index]);
-        index                += uint16_encode(p_conn_params->max_conn_interval, 
-                                              &g_cmd_buffer[index]);
-        index                += uint16_encode(p_conn_params->slave_latency, 
-                                              &g_cmd_buffer[index]);
-        index                += uint16_encode(p_conn_params->conn_sup_timeout, 
-                                              &g_cmd_buffer[index]);
-    }
-    else
+    uint32_t err_code = ble_rpc_opt_struct_encode(&g_ble_rpc_gap_conn_params_desc,
+                                                  p_conn_params,
+                                                  g_cmd_buffer,
+                                                  CMD_BUF_SIZE,
+                                                  &index);
+    if (err_code != NRF_SUCCESS)
     {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+        return err_code;
     }
 
-    uint32_t err_code = hci_transport_pkt_write(g_cmd_buffer, index);
+    err_code = hci_transport_pkt_write(g_cmd_buffer, index);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
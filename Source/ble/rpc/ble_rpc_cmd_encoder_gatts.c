@@ -22,6 +22,9 @@
 extern uint8_t * g_cmd_response_buf; /**< Pointer to the buffer used for storing command response. */
 extern uint8_t * g_cmd_buffer;       /**< Pointer to the buffer used for storing serialized commands. */
 
+#define GATTS_HVX_CMD_SIZE(DATA_LEN)        (14u + (DATA_LEN)) /**< Size of a serialized sd_ble_gatts_hvx command carrying DATA_LEN bytes. */
+#define GATTS_VALUE_SET_CMD_SIZE(DATA_LEN)  (10u + (DATA_LEN)) /**< Size of a serialized sd_ble_gatts_value_set command carrying DATA_LEN bytes. */
+
 /**@brief Function for decoding the sd_ble_gatts_sys_attr_get API response data.
  *
  * @param[out] p_sys_attr_data Decode data buffer output.
@@ -175,20 +178,33 @@ uint32_t sd_ble_gatts_sys_attr_set(uint16_t              conn_handle,
 }
 
 
-uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * const p_hvx_params)
+/**@brief Function for encoding the sd_ble_gatts_hvx command.
+ *
+ * @param[in]  p_buffer       Buffer for the serialized command.
+ * @param[out] p_length       Length of the serialized command.
+ * @param[in]  conn_handle    Connection handle.
+ * @param[in]  p_hvx_params   Notification or indication parameters.
+ *
+ * @retval NRF_SUCCESS          Command encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Data does not fit in a command packet.
+ */
+static uint32_t gatts_hvx_encode(uint8_t * const                      p_buffer,
+                                 uint32_t * const                     p_length,
+                                 uint16_t                             conn_handle,
+                                 ble_gatts_hvx_params_t const * const p_hvx_params)
 {
     uint32_t index = 0;
 
-    g_cmd_buffer[index++] = BLE_RPC_PKT_CMD;
-    g_cmd_buffer[index++] = SD_BLE_GATTS_HVX;
-    index                += uint16_encode(conn_handle, &g_cmd_buffer[index]);
+    p_buffer[index++] = BLE_RPC_PKT_CMD;
+    p_buffer[index++] = SD_BLE_GATTS_HVX;
+    index             += uint16_encode(conn_handle, &p_buffer[index]);
 
     if (p_hvx_params != NULL)
     {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-        index                += uint16_encode(p_hvx_params->handle, &g_cmd_buffer[index]);
-        g_cmd_buffer[index++] = p_hvx_params->type;
-        index                += uint16_encode(p_hvx_params->offset, &g_cmd_buffer[index]);
+        p_buffer[index++] = RPC_BLE_FIELD_PRESENT;
+        index             += uint16_encode(p_hvx_params->handle, &p_buffer[index]);
+        p_buffer[index++] = p_hvx_params->type;
+        index             += uint16_encode(p_hvx_params->offset, &p_buffer[index]);
 
         if (p_hvx_params->p_len != NULL)
         {
@@ -212,33 +228,47 @@ uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * c
                 return NRF_ERROR_DATA_SIZE;
             }
 
-            g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-            index                += uint16_encode(*(p_hvx_params->p_len), &g_cmd_buffer[index]);
+            p_buffer[index++] = RPC_BLE_FIELD_PRESENT;
+            index             += uint16_encode(*(p_hvx_params->p_len), &p_buffer[index]);
 
             if (p_hvx_params->p_data != NULL)
             {
-                g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-                memcpy(&(g_cmd_buffer[index]), p_hvx_params->p_data, *(p_hvx_params->p_len));
-                index                += *(p_hvx_params->p_len);
+                p_buffer[index++] = RPC_BLE_FIELD_PRESENT;
+                memcpy(&(p_buffer[index]), p_hvx_params->p_data, *(p_hvx_params->p_len));
+                index             += *(p_hvx_params->p_len);
             }
             else
             {
-                g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+                p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
             }
         }
         else
         {
-            g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+            p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
             // @note: The data field is omitted if the length field is also omitted.
-            g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+            p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
         }
     }
     else
     {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+        p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
     }
 
-    uint32_t err_code = hci_transport_pkt_write(g_cmd_buffer, index);
+    *p_length = index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * const p_hvx_params)
+{
+    uint32_t index;
+    uint32_t err_code = gatts_hvx_encode(g_cmd_buffer, &index, conn_handle, p_hvx_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = hci_transport_pkt_write(g_cmd_buffer, index);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -429,17 +459,31 @@ uint32_t sd_ble_gatts_characteristic_add(uint16_t                    service_han
 }
 
 
-uint32_t sd_ble_gatts_value_set(uint16_t              handle,
-                                uint16_t              offset,
-                                uint16_t * const      p_len,
-                                uint8_t const * const p_value)
+/**@brief Function for encoding the sd_ble_gatts_value_set command.
+ *
+ * @param[in]  p_buffer   Buffer for the serialized command.
+ * @param[out] p_length   Length of the serialized command.
+ * @param[in]  handle     Attribute handle.
+ * @param[in]  offset     Offset in bytes to write.
+ * @param[in]  p_len      Length in bytes to write.
+ * @param[in]  p_value    Value to write.
+ *
+ * @retval NRF_SUCCESS          Command encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Data does not fit in a command packet.
+ */
+static uint32_t gatts_value_set_encode(uint8_t * const          p_buffer,
+                                       uint32_t * const         p_length,
+                                       uint16_t                 handle,
+                                       uint16_t                 offset,
+                                       uint16_t const * const   p_len,
+                                       uint8_t const * const    p_value)
 {
     uint32_t index  = 0;
 
-    g_cmd_buffer[index++] = BLE_RPC_PKT_CMD;
-    g_cmd_buffer[index++] = SD_BLE_GATTS_VALUE_SET;
-    index                += uint16_encode(handle, &g_cmd_buffer[index]);
-    index                += uint16_encode(offset, &g_cmd_buffer[index]);
+    p_buffer[index++] = BLE_RPC_PKT_CMD;
+    p_buffer[index++] = SD_BLE_GATTS_VALUE_SET;
+    index             += uint16_encode(handle, &p_buffer[index]);
+    index             += uint16_encode(offset, &p_buffer[index]);
 
     if (p_len != NULL)
     {
@@ -456,29 +500,46 @@ uint32_t sd_ble_gatts_value_set(uint16_t              handle,
             return NRF_ERROR_DATA_SIZE;
         }
 
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-        index                += uint16_encode(*p_len, &g_cmd_buffer[index]);
+        p_buffer[index++] = RPC_BLE_FIELD_PRESENT;
+        index             += uint16_encode(*p_len, &p_buffer[index]);
 
         if (p_value != NULL)
         {
-            g_cmd_buffer[index++] = RPC_BLE_FIELD_PRESENT;
-            memcpy(&(g_cmd_buffer[index]), p_value, *p_len);
-            index                += *p_len;
+            p_buffer[index++] = RPC_BLE_FIELD_PRESENT;
+            memcpy(&(p_buffer[index]), p_value, *p_len);
+            index             += *p_len;
         }
         else
         {
-            g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+            p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
         }
     }
     else
     {
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+        p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
 
         // @note: If length field is omitted value field must also be omitted.
-        g_cmd_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
+        p_buffer[index++] = RPC_BLE_FIELD_NOT_PRESENT;
     }
 
-    uint32_t err_code = hci_transport_pkt_write(g_cmd_buffer, index);
+    *p_length = index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_set(uint16_t              handle,
+                                uint16_t              offset,
+                                uint16_t * const      p_len,
+                                uint8_t const * const p_value)
+{
+    uint32_t index;
+    uint32_t err_code = gatts_value_set_encode(g_cmd_buffer, &index, handle, offset, p_len, p_value);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = hci_transport_pkt_write(g_cmd_buffer, index);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -543,3 +604,65 @@ uint32_t sd_ble_gatts_descriptor_add(uint16_t                       char_handle,
     // Not implemented yet.
     return NRF_ERROR_NOT_SUPPORTED;
 }
+
+
+uint32_t ble_rpc_gatts_hvx_async(uint16_t                             conn_handle,
+                                 ble_gatts_hvx_params_t const * const p_hvx_params,
+                                 ble_rpc_cmd_resp_handler_t           resp_handler,
+                                 void *                               p_context,
+                                 uint16_t *                           p_cmd_id)
+{
+    uint32_t  err_code;
+    uint32_t  index;
+    uint8_t * p_buffer;
+    uint16_t  data_len = 0;
+
+    if ((p_hvx_params != NULL) && (p_hvx_params->p_len != NULL))
+    {
+        data_len = *(p_hvx_params->p_len);
+    }
+
+    err_code = hci_transport_tx_alloc_sized(GATTS_HVX_CMD_SIZE(data_len), &p_buffer);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = gatts_hvx_encode(p_buffer, &index, conn_handle, p_hvx_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        UNUSED_VARIABLE(hci_transport_tx_buffer_free(p_buffer));
+        return err_code;
+    }
+
+    return ble_rpc_cmd_async_send(p_buffer, (uint16_t)index, resp_handler, p_context, p_cmd_id);
+}
+
+
+uint32_t ble_rpc_gatts_value_set_async(uint16_t                   handle,
+                                       uint16_t                   offset,
+                                       uint16_t                   len,
+                                       uint8_t const * const      p_value,
+                                       ble_rpc_cmd_resp_handler_t resp_handler,
+                                       void *                     p_context,
+                                       uint16_t *                 p_cmd_id)
+{
+    uint32_t  err_code;
+    uint32_t  index;
+    uint8_t * p_buffer;
+
+    err_code = hci_transport_tx_alloc_sized(GATTS_VALUE_SET_CMD_SIZE(len), &p_buffer);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code = gatts_value_set_encode(p_buffer, &index, handle, offset, &len, p_value);
+    if (err_code != NRF_SUCCESS)
+    {
+        UNUSED_VARIABLE(hci_transport_tx_buffer_free(p_buffer));
+        return err_code;
+    }
+
+    return ble_rpc_cmd_async_send(p_buffer, (uint16_t)index, resp_handler, p_context, p_cmd_id);
+}
@@ -0,0 +1,447 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "ble_rpc_codec.h"
+#include <string.h>
+#include <stdbool.h>
+#include "nrf_error.h"
+#include "nordic_common.h"
+#include "app_util.h"
+#include "ble_rpc_defines.h"
+
+#define VARINT_DATA_MASK    0x7Fu               /**< Value bits of a varint byte. */
+#define VARINT_MORE_FLAG    0x80u               /**< Set in all bytes of a varint but the last. */
+#define VARINT_SIZE_MAX     5                   /**< Largest size of a varint holding 32 bits. */
+
+
+/**@brief Function for getting the size of the field bitmap of a structure.
+ *
+ * @param[in] p_desc    Structure description.
+ *
+ * @return    Size of the bitmap, 0 if the structure does not omit zero fields.
+ */
+static uint32_t bitmap_size(const ble_rpc_struct_desc_t * p_desc)
+{
+    if ((p_desc->flags & BLE_RPC_STRUCT_OMIT_ZERO) == 0)
+    {
+        return 0;
+    }
+
+    return CEIL_DIV(p_desc->field_count, 8);
+}
+
+
+/**@brief Function for reading a value field from a structure.
+ *
+ * @param[in] p_field   Pointer to the field.
+ * @param[in] size      Size of the field.
+ *
+ * @return    Value of the field.
+ */
+static uint32_t field_value_get(const uint8_t * p_field, uint8_t size)
+{
+    switch (size)
+    {
+        case sizeof(uint8_t):
+            return *p_field;
+
+        case sizeof(uint16_t):
+            return *(const uint16_t *)p_field;
+
+        default:
+            return *(const uint32_t *)p_field;
+    }
+}
+
+
+/**@brief Function for writing a value field of a structure.
+ *
+ * @param[in] p_field   Pointer to the field.
+ * @param[in] size      Size of the field.
+ * @param[in] value     Value to write.
+ *
+ * @retval NRF_SUCCESS              Value written.
+ * @retval NRF_ERROR_INVALID_DATA   Value does not fit the field.
+ */
+static uint32_t field_value_set(uint8_t * p_field, uint8_t size, uint32_t value)
+{
+    switch (size)
+    {
+        case sizeof(uint8_t):
+            if (value > UINT8_MAX)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+            *p_field = (uint8_t)value;
+            break;
+
+        case sizeof(uint16_t):
+            if (value > UINT16_MAX)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+            *(uint16_t *)p_field = (uint16_t)value;
+            break;
+
+        default:
+            *(uint32_t *)p_field = value;
+            break;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for encoding a value little endian.
+ *
+ * @param[in]  value      Value to encode.
+ * @param[in]  size       Number of bytes to encode, 1, 2 or 4.
+ * @param[out] p_encoded  Buffer for the encoded value.
+ *
+ * @return     Number of bytes encoded.
+ */
+static uint8_t uint_encode(uint32_t value, uint8_t size, uint8_t * p_encoded)
+{
+    switch (size)
+    {
+        case sizeof(uint8_t):
+            p_encoded[0] = (uint8_t)value;
+            return sizeof(uint8_t);
+
+        case sizeof(uint16_t):
+            return uint16_encode((uint16_t)value, p_encoded);
+
+        default:
+            return uint32_encode(value, p_encoded);
+    }
+}
+
+
+/**@brief Function for decoding a little endian value.
+ *
+ * @param[in] p_encoded   Encoded value.
+ * @param[in] size        Number of bytes to decode, 1, 2 or 4.
+ *
+ * @return    Decoded value.
+ */
+static uint32_t uint_decode(const uint8_t * p_encoded, uint8_t size)
+{
+    switch (size)
+    {
+        case sizeof(uint8_t):
+            return p_encoded[0];
+
+        case sizeof(uint16_t):
+            return uint16_decode(p_encoded);
+
+        default:
+            return uint32_decode(p_encoded);
+    }
+}
+
+
+/**@brief Function for checking whether a field is zero.
+ *
+ * @param[in] p_field   Pointer to the field.
+ * @param[in] size      Size of the field.
+ *
+ * @return    true if all bytes of the field are zero.
+ */
+static bool field_is_zero(const uint8_t * p_field, uint8_t size)
+{
+    uint8_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (p_field[i] != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+uint32_t ble_rpc_varint_encode(uint32_t  value,
+                               uint8_t * p_buffer,
+                               uint32_t  buf_len,
+                               uint32_t * p_index)
+{
+    uint32_t index = *p_index;
+
+    do
+    {
+        uint8_t byte = (uint8_t)(value & VARINT_DATA_MASK);
+
+        value >>= 7;
+        if (value != 0)
+        {
+            byte |= VARINT_MORE_FLAG;
+        }
+
+        if (index >= buf_len)
+        {
+            return NRF_ERROR_DATA_SIZE;
+        }
+        p_buffer[index++] = byte;
+    }
+    while (value != 0);
+
+    *p_index = index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_rpc_varint_decode(uint32_t *      p_value,
+                               const uint8_t * p_buffer,
+                               uint32_t        buf_len,
+                               uint32_t *      p_index)
+{
+    uint32_t index = *p_index;
+    uint32_t value = 0;
+    uint32_t shift = 0;
+    uint8_t  byte;
+
+    do
+    {
+        if (index >= buf_len)
+        {
+            return NRF_ERROR_INVALID_LENGTH;
+        }
+        if (shift >= (VARINT_SIZE_MAX * 7))
+        {
+            return NRF_ERROR_INVALID_DATA;
+        }
+
+        byte   = p_buffer[index++];
+        value |= (uint32_t)(byte & VARINT_DATA_MASK) << shift;
+        shift += 7;
+    }
+    while ((byte & VARINT_MORE_FLAG) != 0);
+
+    *p_value = value;
+    *p_index = index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_rpc_struct_encode(const ble_rpc_struct_desc_t * p_desc,
+                               const void *                  p_struct,
+                               uint8_t *                     p_buffer,
+                               uint32_t                      buf_len,
+                               uint32_t *                    p_index)
+{
+    const uint8_t * p_src        = (const uint8_t *)p_struct;
+    const uint32_t  bitmap_index = *p_index;
+    uint32_t        index        = bitmap_index + bitmap_size(p_desc);
+    uint8_t         i;
+
+    if (index > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    memset(&p_buffer[bitmap_index], 0, index - bitmap_index);
+
+    for (i = 0; i < p_desc->field_count; i++)
+    {
+        const ble_rpc_field_desc_t * p_field = &p_desc->p_fields[i];
+        const uint8_t *              p_data  = &p_src[p_field->offset];
+        uint32_t                     err_code;
+
+        if ((p_desc->flags & BLE_RPC_STRUCT_OMIT_ZERO) != 0)
+        {
+            if (field_is_zero(p_data, p_field->size))
+            {
+                continue;
+            }
+            p_buffer[bitmap_index + (i >> 3)] |= (uint8_t)(1u << (i & 0x07));
+        }
+
+        switch (p_field->type)
+        {
+            case BLE_RPC_FIELD_VARUINT:
+                err_code = ble_rpc_varint_encode(field_value_get(p_data, p_field->size),
+                                                 p_buffer,
+                                                 buf_len,
+                                                 &index);
+                if (err_code != NRF_SUCCESS)
+                {
+                    return err_code;
+                }
+                break;
+
+            case BLE_RPC_FIELD_UINT:
+                if ((index + p_field->size) > buf_len)
+                {
+                    return NRF_ERROR_DATA_SIZE;
+                }
+                index += uint_encode(field_value_get(p_data, p_field->size),
+                                     p_field->size,
+                                     &p_buffer[index]);
+                break;
+
+            default:
+                if ((index + p_field->size) > buf_len)
+                {
+                    return NRF_ERROR_DATA_SIZE;
+                }
+                memcpy(&p_buffer[index], p_data, p_field->size);
+                index += p_field->size;
+                break;
+        }
+    }
+
+    *p_index = index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_rpc_struct_decode(const ble_rpc_struct_desc_t * p_desc,
+                               void *                        p_struct,
+                               const uint8_t *               p_buffer,
+                               uint32_t                      buf_len,
+                               uint32_t *                    p_index)
+{
+    uint8_t *      p_dst        = (uint8_t *)p_struct;
+    const uint32_t bitmap_index = *p_index;
+    uint32_t       index        = bitmap_index + bitmap_size(p_desc);
+    uint8_t        i;
+
+    if (index > buf_len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    for (i = 0; i < p_desc->field_count; i++)
+    {
+        const ble_rpc_field_desc_t * p_field = &p_desc->p_fields[i];
+        uint8_t *                    p_data  = &p_dst[p_field->offset];
+        uint32_t                     value;
+        uint32_t                     err_code;
+
+        if (((p_desc->flags & BLE_RPC_STRUCT_OMIT_ZERO) != 0) &&
+            ((p_buffer[bitmap_index + (i >> 3)] & (1u << (i & 0x07))) == 0))
+        {
+            memset(p_data, 0, p_field->size);
+            continue;
+        }
+
+        switch (p_field->type)
+        {
+            case BLE_RPC_FIELD_VARUINT:
+                err_code = ble_rpc_varint_decode(&value, p_buffer, buf_len, &index);
+                if (err_code != NRF_SUCCESS)
+                {
+                    return err_code;
+                }
+                err_code = field_value_set(p_data, p_field->size, value);
+                if (err_code != NRF_SUCCESS)
+                {
+                    return err_code;
+                }
+                break;
+
+            case BLE_RPC_FIELD_UINT:
+                if ((index + p_field->size) > buf_len)
+                {
+                    return NRF_ERROR_INVALID_LENGTH;
+                }
+                value = uint_decode(&p_buffer[index], p_field->size);
+                UNUSED_VARIABLE(field_value_set(p_data, p_field->size, value));
+                index += p_field->size;
+                break;
+
+            default:
+                if ((index + p_field->size) > buf_len)
+                {
+                    return NRF_ERROR_INVALID_LENGTH;
+                }
+                memcpy(p_data, &p_buffer[index], p_field->size);
+                index += p_field->size;
+                break;
+        }
+    }
+
+    *p_index = index;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_rpc_opt_struct_encode(const ble_rpc_struct_desc_t * p_desc,
+                                   const void *                  p_struct,
+                                   uint8_t *                     p_buffer,
+                                   uint32_t                      buf_len,
+                                   uint32_t *                    p_index)
+{
+    if (*p_index >= buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    if (p_struct == NULL)
+    {
+        p_buffer[(*p_index)++] = RPC_BLE_FIELD_NOT_PRESENT;
+        return NRF_SUCCESS;
+    }
+
+    p_buffer[(*p_index)++] = RPC_BLE_FIELD_PRESENT;
+    return ble_rpc_struct_encode(p_desc, p_struct, p_buffer, buf_len, p_index);
+}
+
+
+uint32_t ble_rpc_opt_struct_decode(const ble_rpc_struct_desc_t * p_desc,
+                                   void *                        p_storage,
+                                   void **                       pp_struct,
+                                   const uint8_t *               p_buffer,
+                                   uint32_t                      buf_len,
+                                   uint32_t *                    p_index)
+{
+    *pp_struct = NULL;
+
+    if (*p_index >= buf_len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    if (p_buffer[(*p_index)++] != RPC_BLE_FIELD_PRESENT)
+    {
+        return NRF_SUCCESS;
+    }
+
+    *pp_struct = p_storage;
+    return ble_rpc_struct_decode(p_desc, p_storage, p_buffer, buf_len, p_index);
+}
+
+
+uint32_t ble_rpc_struct_size_max(const ble_rpc_struct_desc_t * p_desc)
+{
+    uint32_t size = bitmap_size(p_desc);
+    uint8_t  i;
+
+    for (i = 0; i < p_desc->field_count; i++)
+    {
+        const ble_rpc_field_desc_t * p_field = &p_desc->p_fields[i];
+
+        if (p_field->type == BLE_RPC_FIELD_VARUINT)
+        {
+            // 7 bits per encoded byte.
+            size += CEIL_DIV(p_field->size * 8, 7);
+        }
+        else
+        {
+            size += p_field->size;
+        }
+    }
+
+    return size;
+}
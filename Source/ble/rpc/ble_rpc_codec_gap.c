@@ -0,0 +1,35 @@
+/* Copyright (c) 2013 Nordic Semiconductor. All Rights Reserved.
+ *
+ * The information contained herein is property of Nordic Semiconductor ASA.
+ * Terms and conditions of usage are described in detail in NORDIC
+ * SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
+ *
+ * Licensees are granted free, non-transferable use of the information. NO
+ * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
+ * the file.
+ *
+ */
+
+#include "ble_rpc_codec_gap.h"
+#include "ble_gap.h"
+
+
+static const ble_rpc_field_desc_t m_conn_params_fields[] =
+{
+    BLE_RPC_FIELD(BLE_RPC_FIELD_VARUINT, ble_gap_conn_params_t, min_conn_interval),
+    BLE_RPC_FIELD(BLE_RPC_FIELD_VARUINT, ble_gap_conn_params_t, max_conn_interval),
+    BLE_RPC_FIELD(BLE_RPC_FIELD_VARUINT, ble_gap_conn_params_t, slave_latency),
+    BLE_RPC_FIELD(BLE_RPC_FIELD_VARUINT, ble_gap_conn_params_t, conn_sup_timeout)
+};
+
+static const ble_rpc_field_desc_t m_addr_fields[] =
+{
+    BLE_RPC_FIELD(BLE_RPC_FIELD_UINT,  ble_gap_addr_t, addr_type),
+    BLE_RPC_FIELD(BLE_RPC_FIELD_ARRAY, ble_gap_addr_t, addr)
+};
+
+const ble_rpc_struct_desc_t g_ble_rpc_gap_conn_params_desc =
+    BLE_RPC_STRUCT(m_conn_params_fields, BLE_RPC_STRUCT_OMIT_ZERO);
+
+const ble_rpc_struct_desc_t g_ble_rpc_gap_addr_desc =
+    BLE_RPC_STRUCT(m_addr_fields, 0);
@@ -47,6 +47,7 @@ typedef struct
 static ble_rpc_event_packet_t m_packet_queue[EVENT_QUEUE_SIZE];   /**< Queue for holding received packets until they are fetched by the application through \ref sd_ble_evt_get . */
 static uint8_t                m_packet_queue_write_index;         /**< Write index where next packet will be stored. */
 static uint8_t                m_packet_queue_read_index;          /**< Read index for oldest packet in the queue. */
+static uint16_t               m_batch_offset;                     /**< Offset of the next event record in the oldest packet, when it is an event batch. */
 
 
 /** @brief Function for decoding a BLE event. The decoded BLE event will be returned in the memory
@@ -58,17 +59,22 @@ static uint8_t                m_packet_queue_read_index;          /**< Read inde
  * @param[out]  p_ble_evt       The pointer for storing the decoded event.
  * @param[in]   p_packet        The pointer to the encoded event.
  * @param[in]   packet_length   The length of the encoded event.
+ *
+ * @retval NRF_SUCCESS               Event decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Encoded event is truncated.
+ * @retval NRF_ERROR_INVALID_DATA    A value does not fit its field.
  */
-static void evt_packet_decode(ble_evt_t *           p_ble_evt,
-                              uint8_t const * const p_packet,
-                              uint16_t              packet_length)
+static uint32_t evt_packet_decode(ble_evt_t *           p_ble_evt,
+                                  uint8_t const * const p_packet,
+                                  uint16_t              packet_length)
 {
     uint32_t event_id = p_packet[EVENT_ID_POSITION];
 
     if ((BLE_GAP_EVT_BASE <= event_id) && (event_id < BLE_GAP_EVT_LAST))
     {
-        ble_rpc_gap_evt_packet_decode(p_ble_evt,
-                                      &p_packet[EVENT_ID_POSITION]);
+        return ble_rpc_gap_evt_packet_decode(p_ble_evt,
+                                             &p_packet[EVENT_ID_POSITION],
+                                             packet_length - EVENT_ID_POSITION);
     }
     else if ((BLE_GATTS_EVT_BASE <= event_id) && (event_id < BLE_GATTS_EVT_LAST))
     {
@@ -79,6 +85,8 @@ static void evt_packet_decode(ble_evt_t *           p_ble_evt,
     {
         // Do nothing.
     }
+
+    return NRF_SUCCESS;
 }
 
 
@@ -116,11 +124,103 @@ static void evt_length_decode(uint16_t *            p_event_length,
 }
 
 
+/** @brief Function for releasing the oldest packet in the queue.
+ */
+static void packet_queue_pop(void)
+{
+    uint8_t pop_index = m_packet_queue_read_index;
+
+    UNUSED_VARIABLE(hci_transport_rx_pkt_consume(m_packet_queue[pop_index].p_packet));
+    m_packet_queue[pop_index].p_packet = NULL;
+    m_batch_offset                     = 0;
+
+    if (++m_packet_queue_read_index >= EVENT_QUEUE_SIZE)
+    {
+        m_packet_queue_read_index = 0;
+    }
+}
+
+
+/** @brief Function for getting the next encoded event from the oldest packet in the queue.
+ *
+ * @details A plain event packet holds a single event. An event batch packet holds a sequence of
+ *          records, each a 16 bit length followed by an encoded event in plain event packet
+ *          format.
+ *
+ * @param[out]  pp_event        Encoded event, in plain event packet format.
+ * @param[out]  p_event_length  Length of the encoded event.
+ *
+ * @retval true     If an event is available.
+ * @retval false    If the queue is empty.
+ */
+static bool next_event_get(uint8_t ** pp_event, uint16_t * p_event_length)
+{
+    for (;;)
+    {
+        uint8_t * p_packet      = m_packet_queue[m_packet_queue_read_index].p_packet;
+        uint16_t  packet_length = m_packet_queue[m_packet_queue_read_index].packet_length;
+
+        if (p_packet == NULL)
+        {
+            return false;
+        }
+
+        if (p_packet[0] == BLE_RPC_PKT_EVT)
+        {
+            *pp_event       = p_packet;
+            *p_event_length = packet_length;
+            return true;
+        }
+
+        if ((p_packet[0] == BLE_RPC_PKT_EVT_BATCH) && (m_batch_offset == 0))
+        {
+            m_batch_offset = BLE_PKT_TYPE_SIZE;
+        }
+
+        if ((p_packet[0] == BLE_RPC_PKT_EVT_BATCH) &&
+            ((m_batch_offset + BLE_RPC_EVT_BATCH_LEN_SIZE) < packet_length))
+        {
+            uint16_t record_length = uint16_decode(&p_packet[m_batch_offset]);
+
+            if ((record_length > EVENT_ID_POSITION) &&
+                ((m_batch_offset + BLE_RPC_EVT_BATCH_LEN_SIZE + record_length) <= packet_length))
+            {
+                *pp_event       = &p_packet[m_batch_offset + BLE_RPC_EVT_BATCH_LEN_SIZE];
+                *p_event_length = record_length;
+                return true;
+            }
+        }
+
+        // Not an event packet, malformed batch or all events of the batch fetched.
+        packet_queue_pop();
+    }
+}
+
+
+/** @brief Function for releasing the event returned by @ref next_event_get.
+ *
+ * @param[in]   event_length    Length of the encoded event.
+ */
+static void event_release(uint16_t event_length)
+{
+    uint8_t * p_packet = m_packet_queue[m_packet_queue_read_index].p_packet;
+
+    if (p_packet[0] == BLE_RPC_PKT_EVT_BATCH)
+    {
+        // The packet is released when the next event is requested and none is left.
+        m_batch_offset += BLE_RPC_EVT_BATCH_LEN_SIZE + event_length;
+    }
+    else
+    {
+        packet_queue_pop();
+    }
+}
+
+
 uint32_t sd_ble_evt_get(uint8_t * p_dest, uint16_t * p_len)
 {
     ble_evt_t * p_ble_evt = (ble_evt_t *)p_dest;
     uint16_t    evt_length;
-    uint8_t     pop_index;
     uint8_t *   p_packet;
     uint16_t    packet_length;
 
@@ -135,42 +235,25 @@ uint32_t sd_ble_evt_get(uint8_t * p_dest, uint16_t * p_len)
         return NRF_ERROR_INVALID_ADDR;
     }
 
-    pop_index      = m_packet_queue_read_index;
-    p_packet       = m_packet_queue[pop_index].p_packet;
-    packet_length  = m_packet_queue[pop_index].packet_length;
-
-    // Check if there is any event received.
-    if (p_packet == NULL)
-    {
-        // No event received.
-        *p_len = 0;
-        return NRF_ERROR_NOT_FOUND;
-    }
-
-    if (p_packet[0] != BLE_RPC_PKT_EVT)
-    {
-        // No event received.
-        *p_len = 0;
-        return NRF_ERROR_NOT_FOUND;
-    }
-
-    evt_length_decode(&evt_length, p_packet, packet_length);
-
-    if (evt_length == 0)
+    for (;;)
     {
-        // Unsupported/Invalid event received - put packet pointer to NULL.
-        UNUSED_VARIABLE(hci_transport_rx_pkt_consume(p_packet));
+        // Check if there is any event received.
+        if (!next_event_get(&p_packet, &packet_length))
+        {
+            // No event received.
+            *p_len = 0;
+            return NRF_ERROR_NOT_FOUND;
+        }
 
-        m_packet_queue[pop_index].p_packet = NULL;
+        evt_length_decode(&evt_length, p_packet, packet_length);
 
-        if (++m_packet_queue_read_index >= EVENT_QUEUE_SIZE)
+        if (evt_length != 0)
         {
-            m_packet_queue_read_index = 0;
+            break;
         }
 
-        *p_len = 0;
-
-        return NRF_ERROR_NOT_FOUND;
+        // Unsupported/Invalid event received - skip it.
+        event_release(packet_length);
     }
 
     uint16_t ble_evt_len = evt_length + sizeof(ble_evt_hdr_t);
@@ -188,17 +271,19 @@ uint32_t sd_ble_evt_get(uint8_t * p_dest, uint16_t * p_len)
 
     if (p_dest != NULL)
     {
+        uint32_t err_code;
+
         // Decode the encoded event data.
         p_ble_evt->header.evt_len = evt_length;
-        evt_packet_decode(p_ble_evt, p_packet, packet_length);
+        err_code                  = evt_packet_decode(p_ble_evt, p_packet, packet_length);
 
-        // Clear the encoded packet to invalidate it.
-        UNUSED_VARIABLE(hci_transport_rx_pkt_consume(p_packet));
-        m_packet_queue[pop_index].p_packet = NULL;
+        // Release the encoded event to invalidate it, also when it could not be decoded.
+        event_release(packet_length);
 
-        if (++m_packet_queue_read_index >= EVENT_QUEUE_SIZE)
+        if (err_code != NRF_SUCCESS)
         {
-            m_packet_queue_read_index = 0;
+            *p_len = 0;
+            return err_code;
         }
     }
 
@@ -16,6 +16,7 @@
 #include <string.h>
 #include "app_util.h"
 #include "ble_rpc_event_decoder.h"
+#include "ble_rpc_codec_gap.h"
 
 
 /** @brief Function for decoding the event header id from an encoded event.
@@ -36,53 +37,46 @@ static uint8_t evt_header_id_decode(const uint8_t * const p_evt, ble_evt_hdr_t *
 }
 
 
-/** @brief Function for decoding a Bluetooth device address.
- *
- * @param[in]       p_encoded_ble_addr The pointer to the encoded Bluetooth device address.
- * @param[in, out]  p_addr             The pointer to the decoded address.
- *
- * @return          Number of bytes decoded.
- */
-static uint8_t ble_addr_decode(const uint8_t * const  p_encoded_ble_addr,
-                               ble_gap_addr_t * const p_addr)
-{
-    uint32_t index = 0;
-
-    p_addr->addr_type = p_encoded_ble_addr[index++];
-
-    memcpy(p_addr->addr, &(p_encoded_ble_addr[index]), BLE_GAP_ADDR_LEN);
-    index += BLE_GAP_ADDR_LEN;
-
-    return index;
-}
-
-
 /** @brief Function for decoding the BLE_GAP_EVT_CONNECTED event.
  *
  * @param[in]   p_evt_data      The pointer to the encoded event.
+ * @param[in]   evt_data_len    Length of the encoded event.
  * @param[out]  p_decoded_evt   The pointer to where the decoded event will be returned.
+ *
+ * @retval NRF_SUCCESS               Event decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Encoded event is truncated.
+ * @retval NRF_ERROR_INVALID_DATA    A value does not fit its field.
  */
-static void gap_connected_evt_decode(const uint8_t * const           p_evt_data,
-                                     ble_gap_evt_connected_t * const p_decoded_evt)
+static uint32_t gap_connected_evt_decode(const uint8_t * const           p_evt_data,
+                                         uint32_t                        evt_data_len,
+                                         ble_gap_evt_connected_t * const p_decoded_evt)
 {
+    uint32_t err_code;
     uint32_t index = 0;
 
-    index += ble_addr_decode(p_evt_data, &(p_decoded_evt->peer_addr));
+    err_code = ble_rpc_struct_decode(&g_ble_rpc_gap_addr_desc,
+                                     &(p_decoded_evt->peer_addr),
+                                     p_evt_data,
+                                     evt_data_len,
+                                     &index);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
 
+    if (index >= evt_data_len)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
     p_decoded_evt->irk_match      = (p_evt_data[index] & 0x01);
     p_decoded_evt->irk_match_idx  = (p_evt_data[index] & 0xFE) >> 1;
     index++;
 
-    p_decoded_evt->conn_params.min_conn_interval    = uint16_decode(&p_evt_data[index]);
-    index                                           += sizeof(uint16_t);
-
-    p_decoded_evt->conn_params.max_conn_interval    = uint16_decode(&p_evt_data[index]);
-    index                                           += sizeof(uint16_t);
-
-    p_decoded_evt->conn_params.slave_latency        = uint16_decode(&p_evt_data[index]);
-    index                                           += sizeof(uint16_t);
-
-    p_decoded_evt->conn_params.conn_sup_timeout     = uint16_decode(&p_evt_data[index]);
+    return ble_rpc_struct_decode(&g_ble_rpc_gap_conn_params_desc,
+                                 &(p_decoded_evt->conn_params),
+                                 p_evt_data,
+                                 evt_data_len,
+                                 &index);
 }
 
 
@@ -113,24 +107,25 @@ static void gap_timeout_evt_decode(const uint8_t * const          p_evt_data,
 /** @brief Function for decoding the BLE_GAP_EVT_CONN_PARAM_UPDATE event.
  *
  * @param[in]   p_evt_data      The pointer to the encoded event.
+ * @param[in]   evt_data_len    Length of the encoded event.
  * @param[out]  p_decoded_evt   The pointer to where the decoded event will be returned.
+ *
+ * @retval NRF_SUCCESS               Event decoded.
+ * @retval NRF_ERROR_INVALID_LENGTH  Encoded event is truncated.
+ * @retval NRF_ERROR_INVALID_DATA    A value does not fit its field.
  */
-static void gap_conn_param_update_evt_decode(
+static uint32_t gap_conn_param_update_evt_decode(
     const uint8_t * const                    p_evt_data,
+    uint32_t                                 evt_data_len,
     ble_gap_evt_conn_param_update_t * const  p_decoded_evt)
 {
     uint32_t index = 0;
 
-    p_decoded_evt->conn_params.min_conn_interval    = uint16_decode(&p_evt_data[index]);
-    index                                           += sizeof(uint16_t);
-
-    p_decoded_evt->conn_params.max_conn_interval    = uint16_decode(&p_evt_data[index]);
-    index                                           += sizeof(uint16_t);
-
-    p_decoded_evt->conn_params.slave_latency        = uint16_decode(&p_evt_data[index]);
-    index                                           += sizeof(uint16_t);
-
-    p_decoded_evt->conn_params.conn_sup_timeout     = uint16_decode(&p_evt_data[index]);
+    return ble_rpc_struct_decode(&g_ble_rpc_gap_conn_params_desc,
+                                 &(p_decoded_evt->conn_params),
+                                 p_evt_data,
+                                 evt_data_len,
+                                 &index);
 }
 
 
@@ -332,10 +327,12 @@ void ble_rpc_gap_evt_length_decode(uint8_t event_id, uint16_t * p_event_length)
 }
 
 
-void ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
-                                   uint8_t const * const p_packet)
+uint32_t ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
+                                       uint8_t const * const p_packet,
+                                       uint16_t              packet_length)
 {
-    uint32_t index = 0;
+    uint32_t err_code = NRF_SUCCESS;
+    uint32_t index    = 0;
 
     index += evt_header_id_decode(&p_packet[index], &(p_ble_evt->header));
 
@@ -346,8 +343,9 @@ void ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
             p_ble_evt->evt.gap_evt.conn_handle = uint16_decode(&(p_packet[index]));
             index                             += sizeof(p_ble_evt->evt.gap_evt.conn_handle);
 
-            gap_connected_evt_decode(&(p_packet[index]),
-                                     &(p_ble_evt->evt.gap_evt.params.connected));
+            err_code = gap_connected_evt_decode(&(p_packet[index]),
+                                                packet_length - index,
+                                                &(p_ble_evt->evt.gap_evt.params.connected));
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
@@ -369,8 +367,10 @@ void ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
             p_ble_evt->evt.gap_evt.conn_handle = uint16_decode(&(p_packet[index]));
             index                             += sizeof(p_ble_evt->evt.gap_evt.conn_handle);
 
-            gap_conn_param_update_evt_decode(&(p_packet[index]),
-                                             &(p_ble_evt->evt.gap_evt.params.conn_param_update));
+            err_code = gap_conn_param_update_evt_decode(
+                           &(p_packet[index]),
+                           packet_length - index,
+                           &(p_ble_evt->evt.gap_evt.params.conn_param_update));
             break;
 
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
@@ -409,4 +409,6 @@ void ble_rpc_gap_evt_packet_decode(ble_evt_t *           p_ble_evt,
             // No implementation needed.
             break;
     }
+
+    return err_code;
 }
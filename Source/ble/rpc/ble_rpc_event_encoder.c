@@ -20,51 +20,346 @@
 #include "ble_gap.h"
 #include "nrf_error.h"
 #include "hci_transport.h"
+#include "nordic_common.h"
+#include "ble_stack_handler_types.h"
+#include "ble_rpc_defines.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "nrf_soc.h"
+#if (BLE_RPC_EVT_BATCH_LATENCY_MS > 0)
+#include "app_timer.h"
+#endif
 
 
-void ble_rpc_event_handle(ble_evt_t * p_ble_evt)
+// An event batch must fit in a TX buffer, and have room for at least one event.
+STATIC_ASSERT((BLE_RPC_EVT_BATCH_SIZE_MAX <= RPC_BLE_PKT_MAX_SIZE) &&
+              (BLE_RPC_EVT_BATCH_SIZE_MAX >= 
+               BLE_PKT_TYPE_SIZE + BLE_RPC_EVT_BATCH_LEN_SIZE + BLE_RPC_EVT_ENCODED_SIZE_MAX));
+
+/**@brief Queued BLE event, word aligned storage for a @ref ble_evt_t. */
+typedef struct
 {
-    uint32_t  err_code;
-    uint8_t * p_buffer        = NULL;
-    uint8_t   evt_packet_size = 0;
+    uint32_t evt_buf[CEIL_DIV(BLE_STACK_EVT_MSG_BUF_SIZE, sizeof(uint32_t))]; /**< Event data. */
+} evt_queue_elem_t;
 
-    // Allocate a memory buffer from HCI transport layer for transmitting the Command Response.
-    // Loop until a buffer is available.
-    do
-    {
-        err_code = hci_transport_tx_alloc(&p_buffer);
-    }
-    while (err_code == NRF_ERROR_NO_MEM);
+static evt_queue_elem_t m_evt_queue[BLE_RPC_EVT_QUEUE_SIZE];  /**< Events waiting for a TX buffer. */
+static uint8_t          m_evt_queue_head;                     /**< Index of the oldest queued event. */
+static uint8_t          m_evt_queue_count;                    /**< Number of queued events. */
+static volatile bool    m_is_queue_process_scheduled;         /**< True when @ref queue_process_evt_handle has been scheduled and has not started yet. */
+static bool             m_is_tx_busy;                         /**< True from passing an event packet to the transport layer until the next TX done. */
+
+
+#if (BLE_RPC_EVT_BATCH_LATENCY_MS > 0)
+#define APP_TIMER_PRESCALER         0                                                             /**< Value of the RTC1 PRESCALER register. */
+#define BATCH_LATENCY_IN_TICKS      APP_TIMER_TICKS(BLE_RPC_EVT_BATCH_LATENCY_MS, APP_TIMER_PRESCALER) /**< Time an event batch is held open, in units of timer ticks. */
+
+static app_timer_id_t   m_batch_timer_id;                     /**< Timer bounding the time an event batch is held open. */
+static bool             m_is_batch_timer_created;             /**< True once the batch timer has been created. */
+#endif
+
+static uint8_t *        mp_batch_buffer;                      /**< TX buffer of the open event batch, NULL if no batch is open. */
+static uint16_t         m_batch_length;                       /**< Number of bytes used in the open event batch. */
+static uint8_t          m_batch_count;                        /**< Number of events in the open event batch. */
 
-    APP_ERROR_CHECK(err_code);
 
+/**@brief Function for encoding an event.
+ *
+ * @param[in]   p_ble_evt    S110 SoftDevice event to serialize.
+ * @param[out]  p_buffer     Buffer for the encoded event, in plain event packet format, with
+ *                           room for @ref BLE_RPC_EVT_ENCODED_SIZE_MAX bytes.
+ *
+ * @return      Length of the encoded event, 0 if the event is not serialized.
+ */
+static uint16_t event_serialize(ble_evt_t * p_ble_evt, uint8_t * p_buffer)
+{
     uint16_t event_id = p_ble_evt->header.evt_id;
 
     if ((BLE_GAP_EVT_BASE <= event_id) && (event_id < BLE_GAP_EVT_LAST))
     {
-        evt_packet_size = ble_rpc_evt_gap_encode(p_ble_evt, p_buffer);
+        uint32_t length;
+        uint32_t err_code = ble_rpc_evt_gap_encode(p_ble_evt, 
+                                                   p_buffer, 
+                                                   BLE_RPC_EVT_ENCODED_SIZE_MAX, 
+                                                   &length);
+        // BLE_RPC_EVT_ENCODED_SIZE_MAX holds any event the SoftDevice can give.
+        APP_ERROR_CHECK(err_code);
+        return (uint16_t)length;
     }
     else if ((BLE_GATTS_EVT_BASE <= event_id) && (event_id < BLE_GATTS_EVT_LAST))
     {
-        evt_packet_size = ble_rpc_evt_gatts_encode(p_ble_evt, p_buffer);
+        return (uint16_t)ble_rpc_evt_gatts_encode(p_ble_evt, p_buffer);
     }
-    else
+
+    return 0;
+}
+
+
+/**@brief Function for passing the open event batch to the transport layer.
+ *
+ * @details A batch holding a single event is sent as a plain event packet.
+ */
+static void batch_flush(void)
+{
+    uint32_t err_code;
+
+    if (mp_batch_buffer == NULL)
     {
-        // Do nothing.
+        return;
     }
 
-    if (evt_packet_size != 0)
+#if (BLE_RPC_EVT_BATCH_LATENCY_MS > 0)
+    err_code = app_timer_stop(m_batch_timer_id);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    if (m_batch_count == 0)
+    {
+        // No event was encoded, therefore the buffer is freed immediately. Other buffers may be 
+        // in flight, so this one is freed by address.
+        err_code = hci_transport_tx_buffer_free(mp_batch_buffer);
+        APP_ERROR_CHECK(err_code);
+    }
+    else
     {
-        err_code = hci_transport_pkt_write(p_buffer, evt_packet_size);
+        if (m_batch_count == 1)
+        {
+            // Drop the batch packet type and the record length.
+            m_batch_length -= BLE_PKT_TYPE_SIZE + BLE_RPC_EVT_BATCH_LEN_SIZE;
+            memmove(mp_batch_buffer, 
+                    &mp_batch_buffer[BLE_PKT_TYPE_SIZE + BLE_RPC_EVT_BATCH_LEN_SIZE], 
+                    m_batch_length);
+        }
+
+        err_code = hci_transport_pkt_write(mp_batch_buffer, m_batch_length);
         APP_ERROR_CHECK(err_code);
+        m_is_tx_busy = true;
         // @note: TX buffer must be freed upon TX done event from HCI Transport layer. The BLE 
         // connectivity example project handles this in main.c.
     }
-    else
+
+    mp_batch_buffer = NULL;
+}
+
+
+#if (BLE_RPC_EVT_BATCH_LATENCY_MS > 0)
+/**@brief Function for sending the open event batch from the scheduler, after the batch timer
+ *        timeout.
+ *
+ * @param[in]   p_event_data   Not used.
+ * @param[in]   event_size     Not used.
+ */
+static void batch_timeout_evt_handle(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    // A batch opened after the timeout is sent early, which only costs batching.
+    batch_flush();
+}
+
+
+/**@brief Function for handling the batch timer timeout.
+ *
+ * @details The batch is built in the context of @ref ble_rpc_event_handle, and the transport 
+ *          layer is not reentrant, so the batch is not touched from the timer interrupt.
+ *
+ * @param[in]   p_context   Not used.
+ */
+static void batch_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+
+    UNUSED_PARAMETER(p_context);
+
+    err_code = app_sched_event_put(NULL, 0, batch_timeout_evt_handle);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
+/**@brief Function for opening a new event batch.
+ *
+ * @retval      NRF_SUCCESS       Batch opened.
+ * @retval      NRF_ERROR_NO_MEM  No TX buffer available, the event must be retried later.
+ */
+static uint32_t batch_open(void)
+{
+    uint32_t err_code;
+
+    // Allocate a memory buffer from HCI transport layer for transmitting the events.
+    err_code = hci_transport_tx_alloc(&mp_batch_buffer);
+    if (err_code == NRF_ERROR_NO_MEM)
+    {
+        mp_batch_buffer = NULL;
+        return err_code;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    mp_batch_buffer[0] = BLE_RPC_PKT_EVT_BATCH;
+    m_batch_length     = BLE_PKT_TYPE_SIZE;
+    m_batch_count      = 0;
+
+#if (BLE_RPC_EVT_BATCH_LATENCY_MS > 0)
+    if (!m_is_batch_timer_created)
     {
-        // No event was encoded, therefore the buffer is freed immediately.
-        err_code = hci_transport_tx_free();
+        err_code = app_timer_create(&m_batch_timer_id, 
+                                    APP_TIMER_MODE_SINGLE_SHOT, 
+                                    batch_timeout_handler);
         APP_ERROR_CHECK(err_code);
+        m_is_batch_timer_created = true;
     }
+
+    err_code = app_timer_start(m_batch_timer_id, BATCH_LATENCY_IN_TICKS, NULL);
+    APP_ERROR_CHECK(err_code);
+#endif
+
+    return NRF_SUCCESS;
 }
 
+
+/**@brief Function for encoding an event into the open event batch, opening a new batch if needed.
+ *
+ * @details The batch is passed to the transport layer as soon as it may not have room for another
+ *          event, or holds @ref BLE_RPC_EVT_BATCH_COUNT_MAX events.
+ *
+ * @param[in]   p_ble_evt    S110 SoftDevice event to serialize.
+ *
+ * @retval      NRF_SUCCESS       Event was added to the batch, or it is not serialized.
+ * @retval      NRF_ERROR_NO_MEM  No TX buffer available, the event must be retried later.
+ */
+static uint32_t batch_append(ble_evt_t * p_ble_evt)
+{
+    uint16_t evt_packet_size;
+
+    if (mp_batch_buffer == NULL)
+    {
+        uint32_t err_code = batch_open();
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    evt_packet_size = event_serialize(p_ble_evt, 
+                                      &mp_batch_buffer[m_batch_length + BLE_RPC_EVT_BATCH_LEN_SIZE]);
+    if (evt_packet_size != 0)
+    {
+        m_batch_length += uint16_encode(evt_packet_size, &mp_batch_buffer[m_batch_length]);
+        m_batch_length += evt_packet_size;
+        m_batch_count++;
+    }
+
+    if (((m_batch_length + BLE_RPC_EVT_BATCH_LEN_SIZE + BLE_RPC_EVT_ENCODED_SIZE_MAX) > 
+         BLE_RPC_EVT_BATCH_SIZE_MAX) ||
+        (m_batch_count >= BLE_RPC_EVT_BATCH_COUNT_MAX))
+    {
+        batch_flush();
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for adding an event to the event queue.
+ *
+ * @param[in]   p_ble_evt    S110 SoftDevice event to queue.
+ */
+static void event_enqueue(ble_evt_t * p_ble_evt)
+{
+    const uint32_t evt_size = MIN(sizeof(ble_evt_hdr_t) + p_ble_evt->header.evt_len,
+                                  sizeof(evt_queue_elem_t));
+    const uint32_t index    = (m_evt_queue_head + m_evt_queue_count) % BLE_RPC_EVT_QUEUE_SIZE;
+
+    memcpy(m_evt_queue[index].evt_buf, p_ble_evt, evt_size);
+    m_evt_queue_count++;
+}
+
+
+void ble_rpc_event_queue_process(void)
+{
+    bool is_dequeued = false;
+
+    while (m_evt_queue_count != 0)
+    {
+        if (batch_append((ble_evt_t *)m_evt_queue[m_evt_queue_head].evt_buf) != NRF_SUCCESS)
+        {
+            // Still no TX buffer, continue upon next call.
+            break;
+        }
+
+        m_evt_queue_head = (m_evt_queue_head + 1) % BLE_RPC_EVT_QUEUE_SIZE;
+        m_evt_queue_count--;
+        is_dequeued      = true;
+    }
+
+    if (is_dequeued)
+    {
+        // The events have already waited for a TX buffer, do not hold them any longer.
+        batch_flush();
+    }
+}
+
+
+/**@brief Function for encoding the queued events from the scheduler.
+ *
+ * @param[in]   p_event_data   Not used.
+ * @param[in]   event_size     Not used.
+ */
+static void queue_process_evt_handle(void * p_event_data, uint16_t event_size)
+{
+    UNUSED_PARAMETER(p_event_data);
+    UNUSED_PARAMETER(event_size);
+
+    m_is_queue_process_scheduled = false;
+    m_is_tx_busy                 = false;
+    ble_rpc_event_queue_process();
+
+    // The transport layer has moved on, send the events collected in the meantime.
+    batch_flush();
+}
+
+
+void ble_rpc_event_tx_done_handle(void)
+{
+    // Scheduled even if the queue is empty, as an event may be about to find no TX buffer.
+    if (!m_is_queue_process_scheduled)
+    {
+        uint32_t err_code;
+
+        m_is_queue_process_scheduled = true;
+        err_code                     = app_sched_event_put(NULL, 0, queue_process_evt_handle);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+void ble_rpc_event_handle(ble_evt_t * p_ble_evt)
+{
+    // Events are encoded in the order they are received, so a new event goes directly to the 
+    // transport layer only when no earlier event is waiting.
+    ble_rpc_event_queue_process();
+
+    if ((m_evt_queue_count == 0) && (batch_append(p_ble_evt) == NRF_SUCCESS))
+    {
+        // While an earlier packet is in transfer the batch is held open to collect further 
+        // events, until TX done or the batch timer timeout.
+        if (!m_is_tx_busy)
+        {
+            batch_flush();
+        }
+        return;
+    }
+
+    // Queue full: sleep until a TX buffer is freed upon TX done event from HCI Transport layer.
+    // The TX done handler runs in interrupt context, so the buffer is freed while waiting here.
+    ble_rpc_event_queue_process();
+    while (m_evt_queue_count == BLE_RPC_EVT_QUEUE_SIZE)
+    {
+        uint32_t err_code = sd_app_evt_wait();
+        APP_ERROR_CHECK(err_code);
+
+        ble_rpc_event_queue_process();
+    }
+
+    event_enqueue(p_ble_evt);
+}
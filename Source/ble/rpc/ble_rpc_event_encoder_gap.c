@@ -14,137 +14,154 @@
 #include "ble_rpc_defines.h"
 #include "app_util.h"
 #include "ble_gap.h"
-
-
-/**@brief Function for encoding a peer address.
- *
- * @param[out]  p_buffer        Pointer to the buffer used for the encoded ble_gap_addr_t.
- * @param[in]   p_peer_address  Pointer to the structure to be encoded.
- *
- * @return      Number of bytes encoded.
- */
-static uint32_t peer_address_encode(uint8_t * const              p_buffer,
-                                    const ble_gap_addr_t * const p_peer_address)
-{
-    uint32_t i;    
-    uint32_t index = 0;
-
-    p_buffer[index++] = p_peer_address->addr_type;
-    for (i = 0; i < BLE_GAP_ADDR_LEN; i++)
-    {
-        p_buffer[index++] = p_peer_address->addr[i];
-    }
-
-    return index;
-}
+#include "nordic_common.h"
+#include "ble_rpc_codec_gap.h"
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_CONNECTED event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_connected_evt_encode(const ble_evt_t * const p_ble_evt,
-                                         uint8_t * const         p_buffer)
+                                         uint8_t * const         p_buffer,
+                                         uint32_t                buf_len,
+                                         uint32_t * const        p_index)
 {
-    uint32_t index = 0;
-
-    index += peer_address_encode(&p_buffer[index],
-                                 &(p_ble_evt->evt.gap_evt.params.connected.peer_addr));
-
-    p_buffer[index]  = (p_ble_evt->evt.gap_evt.params.connected.irk_match_idx << 1) & 0xFE;
-    p_buffer[index] |= p_ble_evt->evt.gap_evt.params.connected.irk_match;
-    index++;
-
-    const ble_gap_conn_params_t * p_conn_params;
-    p_conn_params = &(p_ble_evt->evt.gap_evt.params.connected.conn_params);
-
-    index += uint16_encode(p_conn_params->min_conn_interval,  &p_buffer[index]);
-    index += uint16_encode(p_conn_params->max_conn_interval,  &p_buffer[index]);
-    index += uint16_encode(p_conn_params->slave_latency     , &p_buffer[index]);
-    index += uint16_encode(p_conn_params->conn_sup_timeout,   &p_buffer[index]);
+    uint32_t                        err_code;
+    const ble_gap_evt_connected_t * p_connected = &(p_ble_evt->evt.gap_evt.params.connected);
+
+    err_code = ble_rpc_struct_encode(&g_ble_rpc_gap_addr_desc,
+                                     &(p_connected->peer_addr),
+                                     p_buffer,
+                                     buf_len,
+                                     p_index);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
 
-    return index;
+    if (*p_index + sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    p_buffer[*p_index]  = (p_connected->irk_match_idx << 1) & 0xFE;
+    p_buffer[*p_index] |= p_connected->irk_match;
+    (*p_index)++;
+
+    return ble_rpc_struct_encode(&g_ble_rpc_gap_conn_params_desc,
+                                 &(p_connected->conn_params),
+                                 p_buffer,
+                                 buf_len,
+                                 p_index);
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_DISCONNECTED event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_disconnected_evt_encode(const ble_evt_t * const p_ble_evt,
-                                            uint8_t * const         p_buffer)
+                                            uint8_t * const         p_buffer,
+                                            uint32_t                buf_len,
+                                            uint32_t * const        p_index)
 {
-    uint32_t index = 0;
+    if (*p_index + sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
 
-    p_buffer[index++] = p_ble_evt->evt.gap_evt.params.disconnected.reason;
+    p_buffer[(*p_index)++] = p_ble_evt->evt.gap_evt.params.disconnected.reason;
 
-    return index;
+    return NRF_SUCCESS;
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_TIMEOUT event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_timeout_evt_encode(const ble_evt_t * const p_ble_evt,
-                                       uint8_t * const         p_buffer)
+                                       uint8_t * const         p_buffer,
+                                       uint32_t                buf_len,
+                                       uint32_t * const        p_index)
 {
-    uint32_t index = 0;
+    if (*p_index + sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
 
-    p_buffer[index++] = p_ble_evt->evt.gap_evt.params.timeout.src;
+    p_buffer[(*p_index)++] = p_ble_evt->evt.gap_evt.params.timeout.src;
 
-    return index;
+    return NRF_SUCCESS;
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_CONN_PARAM_UPDATE event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_conn_param_upd_evt_encode(const ble_evt_t * const p_ble_evt,
-                                              uint8_t * const         p_buffer)
+                                              uint8_t * const         p_buffer,
+                                              uint32_t                buf_len,
+                                              uint32_t * const        p_index)
 {
-    uint32_t                      index = 0;
-    const ble_gap_conn_params_t * p_conn_params;
-
-    p_conn_params = &(p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params);
-
-    index += uint16_encode(p_conn_params->min_conn_interval, &p_buffer[index]);
-    index += uint16_encode(p_conn_params->max_conn_interval, &p_buffer[index]);
-    index += uint16_encode(p_conn_params->slave_latency,     &p_buffer[index]);
-    index += uint16_encode(p_conn_params->conn_sup_timeout,  &p_buffer[index]);
-
-    return index;
+    return ble_rpc_struct_encode(&g_ble_rpc_gap_conn_params_desc,
+                                 &(p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params),
+                                 p_buffer,
+                                 buf_len,
+                                 p_index);
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_SEC_PARAMS_REQUEST event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_sec_param_req_evt_encode(const ble_evt_t * const p_ble_evt,
-                                             uint8_t * const         p_buffer)
+                                             uint8_t * const         p_buffer,
+                                             uint32_t                buf_len,
+                                             uint32_t * const        p_index)
 {
-    uint32_t                                 index = 0;
+    uint32_t                                 index = *p_index;
     const ble_gap_evt_sec_params_request_t * p_sec_params_request;
 
     p_sec_params_request = &(p_ble_evt->evt.gap_evt.params.sec_params_request);
 
+    if (index + sizeof(uint16_t) + 3 * sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
     index += uint16_encode(p_sec_params_request->peer_params.timeout, &p_buffer[index]);
 
     p_buffer[index++] = (p_sec_params_request->peer_params.oob     << 5) |
@@ -155,51 +172,87 @@ static uint32_t gap_sec_param_req_evt_encode(const ble_evt_t * const p_ble_evt,
     p_buffer[index++] = p_sec_params_request->peer_params.min_key_size;
     p_buffer[index++] = p_sec_params_request->peer_params.max_key_size;
 
-    return index;
+    *p_index = index;
+
+    return NRF_SUCCESS;
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_SEC_INFO_REQUEST event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_sec_info_req_evt_encode(const ble_evt_t * const p_ble_evt,
-                                            uint8_t * const         p_buffer)
+                                            uint8_t * const         p_buffer,
+                                            uint32_t                buf_len,
+                                            uint32_t * const        p_index)
 {
-    uint32_t                               index = 0;
+    uint32_t                               err_code;
+    uint32_t                               index = *p_index;
     const ble_gap_evt_sec_info_request_t * p_sec_info_request;
 
     p_sec_info_request = &(p_ble_evt->evt.gap_evt.params.sec_info_request);
 
-    index += peer_address_encode(&p_buffer[index], &(p_sec_info_request->peer_addr));
+    err_code = ble_rpc_struct_encode(&g_ble_rpc_gap_addr_desc,
+                                     &(p_sec_info_request->peer_addr),
+                                     p_buffer,
+                                     buf_len,
+                                     &index);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (index + sizeof(uint16_t) + sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
     index += uint16_encode(p_sec_info_request->div, &p_buffer[index]);
 
     p_buffer[index++] = (p_sec_info_request->sign_info << 2 ) |
                         (p_sec_info_request->id_info   << 1 ) |
                         (p_sec_info_request->enc_info);
 
-    return index;
+    *p_index = index;
+
+    return NRF_SUCCESS;
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_AUTH_STATUS event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_auth_status_evt_encode(const ble_evt_t * const p_ble_evt,
-                                           uint8_t * const         p_buffer)
+                                           uint8_t * const         p_buffer,
+                                           uint32_t                buf_len,
+                                           uint32_t * const        p_index)
 {
-    uint32_t                          index = 0;
+    uint32_t                          index = *p_index;
     const ble_gap_evt_auth_status_t * p_auth_status;
 
     p_auth_status = &(p_ble_evt->evt.gap_evt.params.auth_status);
 
+    // Everything up to the identity address, which is checked by the structure codec.
+    if (index + 5 * sizeof(uint8_t) + sizeof(uint16_t) + 2 * BLE_GAP_SEC_KEY_LEN + 
+        sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+
     p_buffer[index++] = p_auth_status->auth_status;
     p_buffer[index++] = p_auth_status->error_src;
 
@@ -238,38 +291,60 @@ static uint32_t gap_auth_status_evt_encode(const ble_evt_t * const p_ble_evt,
         p_buffer[index++] = (p_auth_status->central_keys.irk.irk[i]);
     }
 
-    index += peer_address_encode(&p_buffer[index], &(p_auth_status->central_keys.id_info));
+    *p_index = index;
 
-    return index;
+    return ble_rpc_struct_encode(&g_ble_rpc_gap_addr_desc,
+                                 &(p_auth_status->central_keys.id_info),
+                                 p_buffer,
+                                 buf_len,
+                                 p_index);
 }
 
 
 /** @brief Function for encoding the BLE_GAP_EVT_CONN_SEC_UPDATE event.
  *
- * @param[in]   p_ble_evt       Input BLE event.
- * @param[out]  p_buffer        Pointer to a buffer for the encoded event.
+ * @param[in]     p_ble_evt     Input BLE event.
+ * @param[out]    p_buffer      Pointer to a buffer for the encoded event.
+ * @param[in]     buf_len       Size of the buffer.
+ * @param[in,out] p_index       Position in the buffer, advanced past the encoded event.
  *
- * @return Number of bytes encoded.
+ * @retval NRF_SUCCESS          Event encoded.
+ * @retval NRF_ERROR_DATA_SIZE  Buffer too small.
  */
 static uint32_t gap_con_sec_upd_evt_encode(const ble_evt_t * const p_ble_evt,
-                                           uint8_t * const         p_buffer)
+                                           uint8_t * const         p_buffer,
+                                           uint32_t                buf_len,
+                                           uint32_t * const        p_index)
 {
-    uint32_t                              index = 0;
     const ble_gap_evt_conn_sec_update_t * p_conn_sec_update;
 
     p_conn_sec_update = &(p_ble_evt->evt.gap_evt.params.conn_sec_update);
 
-    p_buffer[index++] = p_conn_sec_update->conn_sec.sec_mode.sm |
-                        (p_conn_sec_update->conn_sec.sec_mode.lv << 4);
-    p_buffer[index++] = p_conn_sec_update->conn_sec.encr_key_size;
+    if (*p_index + 2 * sizeof(uint8_t) > buf_len)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
 
-    return index;
+    p_buffer[(*p_index)++] = p_conn_sec_update->conn_sec.sec_mode.sm |
+                             (p_conn_sec_update->conn_sec.sec_mode.lv << 4);
+    p_buffer[(*p_index)++] = p_conn_sec_update->conn_sec.encr_key_size;
+
+    return NRF_SUCCESS;
 }
 
 
-uint32_t ble_rpc_evt_gap_encode(ble_evt_t * p_ble_evt, uint8_t * p_buffer)
+uint32_t ble_rpc_evt_gap_encode(ble_evt_t * p_ble_evt,
+                                uint8_t *   p_buffer,
+                                uint32_t    buf_len,
+                                uint32_t *  p_length)
 {
-    uint32_t  index  = 0;
+    uint32_t err_code;
+    uint32_t index = 0;
+
+    if (buf_len < BLE_PKT_TYPE_SIZE + 2 * sizeof(uint16_t))
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
 
     // Encode packet type.
     p_buffer[index++] = BLE_RPC_PKT_EVT;
@@ -284,41 +359,44 @@ uint32_t ble_rpc_evt_gap_encode(ble_evt_t * p_ble_evt, uint8_t * p_buffer)
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_CONNECTED:
-            index += gap_connected_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_connected_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
-            index += gap_disconnected_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_disconnected_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_TIMEOUT:
-            index += gap_timeout_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_timeout_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_CONN_PARAM_UPDATE:
-            index += gap_conn_param_upd_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_conn_param_upd_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
-            index += gap_sec_param_req_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_sec_param_req_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_SEC_INFO_REQUEST:
-            index += gap_sec_info_req_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_sec_info_req_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_AUTH_STATUS:
-            index += gap_auth_status_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_auth_status_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         case BLE_GAP_EVT_CONN_SEC_UPDATE:
-            index += gap_con_sec_upd_evt_encode(p_ble_evt, &p_buffer[index]);
+            err_code = gap_con_sec_upd_evt_encode(p_ble_evt, p_buffer, buf_len, &index);
             break;
 
         default:
             // No implementation needed.
+            err_code = NRF_SUCCESS;
             break;
     }
 
-    return index;
+    *p_length = index;
+
+    return err_code;
 }
@@ -45,7 +45,8 @@ void hci_pkt_handler(hci_transport_evt_t hci_event)
             {
                 ble_rpc_cmd_rsp_pkt_received(p_encoded_packet, (uint16_t) encoded_packet_length);
             }
-            else if (p_encoded_packet[0] == BLE_RPC_PKT_EVT)
+            else if ((p_encoded_packet[0] == BLE_RPC_PKT_EVT) || 
+                     (p_encoded_packet[0] == BLE_RPC_PKT_EVT_BATCH))
             {
                 err_code = ble_rpc_event_pkt_received(p_encoded_packet,
                                                       (uint16_t) encoded_packet_length);
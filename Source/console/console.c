@@ -17,14 +17,26 @@
  *
  */
 #include "console.h"
-#include "uart_legacy.h"
+#include <stdarg.h>
+#include <string.h>
+#include "app_uart.h"
+#include "boards.h"
+#include "nrf_error.h"
 
 static const uint8_t newline_input[] = CONSOLE_NEWLINE_INPUT; /*!< Needed to compare input against to find end of line */
 #define NEWLINE_INPUT_LEN (sizeof CONSOLE_NEWLINE_INPUT - 1)  /*!< Subtract one for the zero termination */
+#define NEWLINE_OUTPUT_LEN (sizeof CONSOLE_NEWLINE_OUTPUT - 1) /*!< Subtract one for the zero termination */
+
+#define DEC_DIGITS_MAX    10   /*!< Number of decimal digits of the largest 32-bit number */
 
 static const char hex_tab[] = "0123456789ABCDEF";    /*!< Table of ASCII hexadecimal digits */
+static const char hex_tab_lower[] = "0123456789abcdef"; /*!< Table of lower case ASCII hexadecimal digits */
 
-// static uint8_t m_IEN_status;  // not referenced
+/** Powers of ten subtracted to find the decimal digits, the Cortex-M0 has no divide instruction */
+static const uint32_t pow10_tab[DEC_DIGITS_MAX - 1] =
+{
+  1000000000uL, 100000000uL, 10000000uL, 1000000uL, 100000uL, 10000uL, 1000uL, 100uL, 10uL
+};
 
 /** Console init
 */
@@ -34,69 +46,199 @@ static enum
   CONSOLE_AVAILABLE
 } m_console = CONSOLE_UNINIT;
 
-void console_init(void)
+static uint32_t      m_dropped_count;          /*!< Number of messages dropped because the TX FIFO was full */
+static volatile bool m_tx_completed = true;    /*!< Set when the TX FIFO has been emptied */
+static bool          m_rx_peeked;              /*!< True if m_rx_char holds a received character */
+static uint8_t       m_rx_char;                /*!< Character read by console_chars_available() */
+
+
+/** Handler for app_uart events, run in the UART interrupt.
+ */
+static void uart_evt_handler(app_uart_evt_t * p_event)
 {
-  hal_uart_init(UART_BAUD_19K2);
-  m_console = CONSOLE_AVAILABLE;
+  if (p_event->evt_type == APP_UART_TX_EMPTY)
+  {
+    m_tx_completed = true;
+  }
 }
 
-bool console_available(void)
+
+/** Put a message in the TX FIFO as a whole, or drop and count it if it does not fit.
+ *
+ * \return true if the message was put in the TX FIFO.
+ */
+static bool tx_write(uint8_t const * chars, uint16_t num_chars)
 {
-  if ( m_console == CONSOLE_AVAILABLE )
+  if ( (m_console != CONSOLE_AVAILABLE) || (num_chars == 0) )
   {
-    return(true);
+    return false;
   }
-  else
+
+  // Cleared before the write, since the FIFO may be emptied before the write returns. If the 
+  // write fails the FIFO is full, so a TX empty event follows anyway.
+  m_tx_completed = false;
+  if (app_uart_put_buf(chars, num_chars) != NRF_SUCCESS)
   {
-    return(false);
+    m_dropped_count++;
+    return false;
   }
+  return true;
 }
 
-void console_put_string(uint8_t const * string)
+
+/** Wait for a received character.
+ */
+static uint8_t rx_char_wait(void)
 {
-  if ( m_console == CONSOLE_AVAILABLE )
+  uint8_t ch;
+
+  if (m_rx_peeked)
+  {
+    m_rx_peeked = false;
+    return m_rx_char;
+  }
+  while (app_uart_get(&ch) != NRF_SUCCESS)
+  {
+    // Wait for the UART interrupt to receive a character.
+  }
+  return ch;
+}
+
+
+/** Convert a number to decimal ASCII, without leading zeros.
+ *
+ * Each digit is found by subtracting its power of ten, at most nine times, instead of 
+ * dividing by ten.
+ *
+ * \param[in]  value Number to convert.
+ * \param[out] str   Buffer for the digits, room for DEC_DIGITS_MAX characters.
+ * \return Number of digits.
+ */
+static uint8_t dec_format(uint32_t value, uint8_t * str)
+{
+  uint8_t len = 0;
+  uint8_t i;
+
+  for (i = 0; i < sizeof(pow10_tab) / sizeof(pow10_tab[0]); i++)
   {
-    while(*string != 0)
+    uint8_t digit = '0';
+
+    while (value >= pow10_tab[i])
     {
-      hal_uart_putchar(*string++);
+      value -= pow10_tab[i];
+      digit++;
+    }
+    if ( (digit != '0') || (len != 0) )
+    {
+      str[len++] = digit;
     }
   }
+  str[len++] = (uint8_t)('0' + value);   // The remainder is the last digit.
+  return len;
 }
 
 
-void console_put_line(uint8_t const * string)
+/** Convert a number to hexadecimal ASCII, without leading zeros.
+ *
+ * \param[in]  value Number to convert.
+ * \param[in]  tab   Table of hexadecimal digits to use.
+ * \param[out] str   Buffer for the digits, room for 8 characters.
+ * \return Number of digits.
+ */
+static uint8_t hex_format(uint32_t value, char const * tab, uint8_t * str)
 {
-  if ( m_console == CONSOLE_AVAILABLE )
+  uint8_t len = 0;
+  int8_t  shift;
+
+  for (shift = 28; shift > 0; shift -= 4)
   {
-    while(*string != 0)
+    uint8_t nybble = (uint8_t)((value >> shift) & 0x0f);
+
+    if ( (nybble != 0) || (len != 0) )
     {
-      hal_uart_putchar(*string++);
+      str[len++] = (uint8_t)tab[nybble];
     }
-    console_put_string((uint8_t *)CONSOLE_NEWLINE_OUTPUT);
   }
+  str[len++] = (uint8_t)tab[value & 0x0f];
+  return len;
 }
 
 
-void console_put_newline(void)
+void console_init(void)
 {
+  uint32_t err_code;
+  const app_uart_comm_params_t comm_params =
+  {
+    RX_PIN_NUMBER,
+    TX_PIN_NUMBER,
+    RTS_PIN_NUMBER,
+    CTS_PIN_NUMBER,
+    HWFC ? APP_UART_FLOW_CONTROL_ENABLED : APP_UART_FLOW_CONTROL_DISABLED,
+    false,
+    CONSOLE_BAUDRATE
+  };
+
   if ( m_console == CONSOLE_AVAILABLE )
   {
-    console_put_string((uint8_t *)CONSOLE_NEWLINE_OUTPUT);
+    // app_uart must only be initialized once.
+    return;
   }
-}
 
+  m_dropped_count = 0;
+  m_tx_completed  = true;
+  m_rx_peeked     = false;
+
+  APP_UART_FIFO_INIT(&comm_params,
+                     CONSOLE_RX_BUF_SIZE,
+                     CONSOLE_TX_BUF_SIZE,
+                     uart_evt_handler,
+                     CONSOLE_IRQ_PRIORITY,
+                     err_code);
+  if (err_code == NRF_SUCCESS)
+  {
+    m_console = CONSOLE_AVAILABLE;
+  }
+}
 
-void console_put_chars(uint8_t const * chars, uint8_t num_chars)
+bool console_available(void)
 {
   if ( m_console == CONSOLE_AVAILABLE )
   {
-    for( ; num_chars > 0; num_chars--)
-    {
-      hal_uart_putchar(*chars++);
-    }
+    return(true);
+  }
+  else
+  {
+    return(false);
   }
 }
 
+void console_put_string(uint8_t const * string)
+{
+  (void)tx_write(string, (uint16_t)strlen((char const *)string));
+}
+
+
+void console_put_line(uint8_t const * string)
+{
+  // A line which is dropped leaves no empty line behind.
+  if ( tx_write(string, (uint16_t)strlen((char const *)string)) || (*string == 0) )
+  {
+    console_put_newline();
+  }
+}
+
+
+void console_put_newline(void)
+{
+  (void)tx_write((uint8_t const *)CONSOLE_NEWLINE_OUTPUT, NEWLINE_OUTPUT_LEN);
+}
+
+
+void console_put_chars(uint8_t const * chars, uint8_t num_chars)
+{
+  (void)tx_write(chars, num_chars);
+}
+
 
 void console_get_string(uint8_t * string, uint8_t num_chars)
 {
@@ -104,9 +246,9 @@ void console_get_string(uint8_t * string, uint8_t num_chars)
   {
     for( ; num_chars > 0; num_chars--)
     {
-      *string++ = hal_uart_getchar();
+      *string++ = rx_char_wait();
   #ifdef CONSOLE_ENABLE_ECHO
-      hal_uart_putchar(*(string-1));
+      console_put_char(*(string-1));
   #endif
     }    
     *string = 0;   /* Add zero terminator */
@@ -122,14 +264,14 @@ void console_get_line(uint8_t * string, uint8_t max_len)
     c = '\0';
     for( k = 0; k < max_len - 1 ; k++ )
     {
-      c = hal_uart_getchar();
+      c = rx_char_wait();
       if (c == newline_input[0])
       {
         break;
       }
       string[k] = c;
   #ifdef CONSOLE_ENABLE_ECHO
-      hal_uart_putchar(c);
+      console_put_char(c);
   #endif
     }
     string[k] = 0;
@@ -140,12 +282,12 @@ void console_get_line(uint8_t * string, uint8_t max_len)
     {
       for( m = 0; m < NEWLINE_INPUT_LEN - 1; m++)   /* We have already read the first character */
       {
-          c = hal_uart_getchar();
+          c = rx_char_wait();
       }
   #ifdef CONSOLE_ENABLE_ECHO
       /* We have read a newline, and since echo is enabled, we should also echo back a newline. */
       /* But this should be the output newline, which may differ from the input newline we read. */
-      console_put_string((uint8_t *)CONSOLE_NEWLINE_OUTPUT);    
+      console_put_newline();
   #endif
     }
   }
@@ -153,7 +295,11 @@ void console_get_line(uint8_t * string, uint8_t max_len)
 
 bool console_chars_available(void)
 {
-  return(hal_uart_chars_available());
+  if ( !m_rx_peeked && (app_uart_get(&m_rx_char) == NRF_SUCCESS) )
+  {
+    m_rx_peeked = true;
+  }
+  return(m_rx_peeked);
 }
 
 void console_get_chars(uint8_t * chars, uint8_t num_chars)
@@ -162,9 +308,9 @@ void console_get_chars(uint8_t * chars, uint8_t num_chars)
   {
     for( ; num_chars > 0; num_chars--)
     {
-      *chars++ = hal_uart_getchar();
+      *chars++ = rx_char_wait();
   #ifdef CONSOLE_ENABLE_ECHO
-      hal_uart_putchar(*(chars-1));
+      console_put_char(*(chars-1));
   #endif
     }    
   }
@@ -173,10 +319,7 @@ void console_get_chars(uint8_t * chars, uint8_t num_chars)
 
 void console_put_char(uint8_t ch)
 {
-  if ( m_console == CONSOLE_AVAILABLE )
-  {
-    hal_uart_putchar(ch);
-  }
+  (void)tx_write(&ch, 1);
 }  
 
 
@@ -186,9 +329,9 @@ uint8_t console_get_char(void)
 
   if ( m_console == CONSOLE_AVAILABLE )
   {
-    ch = hal_uart_getchar();
+    ch = rx_char_wait();
   #ifdef CONSOLE_ENABLE_ECHO
-      hal_uart_putchar(ch);
+      console_put_char(ch);
   #endif
   }
   return ch;
@@ -196,243 +339,49 @@ uint8_t console_get_char(void)
   
 void console_put_decbyte(uint8_t b) // b is in the range [0 255]
 {
-  uint8_t b0;
-  uint8_t b1;
-
-  if ( m_console == CONSOLE_AVAILABLE )
-  {
-    b0 = (b % 10); //Remainder of b when divided by 10 
-    b /= 10;       // forces w into the range [0 25]
-  
-    b1 = (b % 10); //Remainder of b when divided by 10
-    b /= 10;       // forces w into the range [0 2]
-  
-    if(b != 0)
-    {
-      hal_uart_putchar(b + '0');
-      hal_uart_putchar(b1 + '0');
-      hal_uart_putchar(b0 + '0');
-    }
-    else if (b1 != 0)
-    {
-      hal_uart_putchar(b1 + '0');
-      hal_uart_putchar(b0 + '0');    
-    }
-    else
-    {
-      hal_uart_putchar(b0 + '0');
-    }
-  }
+  console_put_dec32bit(b);
 }
 
 void console_put_decword(uint16_t w)  // w is in the range [0 65535]
 {
-  uint8_t w0;
-  uint8_t w1;
-  uint8_t w2;
-  uint8_t w3;
-
-  if ( m_console == CONSOLE_AVAILABLE )
-  {
-    w0 = (w % 10); //Remainder of w when divided by 10 
-    w /= 10;       // forces w into the range [0 6553]
-  
-    w1 = (w % 10); //Remainder of w when divided by 10
-    w /= 10;       // forces w into the range [0 655]
-  
-    w2 = (w % 10); //Remainder of w when divided by 10
-    w /= 10;       // forces w into the range [0 65]
-  
-    w3 = (w % 10); //Remainder of w when divided by 10
-    w /= 10;       // forces w into the range [0 6]
-  
-    if(w != 0)
-    {
-      hal_uart_putchar((uint8_t)w  + '0');   /* We may safely cast w to the smaller type, as we have */
-                                             /* made sure (above) that its value will fit. */
-      hal_uart_putchar(w3 + '0');
-      hal_uart_putchar(w2 + '0');
-      hal_uart_putchar(w1 + '0');
-      hal_uart_putchar(w0 + '0');
-    }
-    else if (w3 != 0)
-    {
-      hal_uart_putchar(w3 + '0');
-      hal_uart_putchar(w2 + '0');
-      hal_uart_putchar(w1 + '0');
-      hal_uart_putchar(w0 + '0');
-    }
-    else if (w2 != 0)
-    {
-      hal_uart_putchar(w2 + '0');
-      hal_uart_putchar(w1 + '0');
-      hal_uart_putchar(w0 + '0');    
-    }
-    else if (w1 != 0)
-    {
-      hal_uart_putchar(w1 + '0');
-      hal_uart_putchar(w0 + '0');    
-    }
-    else
-    {
-      hal_uart_putchar(w0 + '0');
-    }
-  }
+  console_put_dec32bit(w);
 }
 
 
 void console_put_dec32bit(uint32_t ww)  // ww is in the range [0 4294967295]
 {
-  uint8_t ww0;
-  uint8_t ww1;
-  uint8_t ww2;
-  uint8_t ww3;
-  uint8_t ww4;
-  uint8_t ww5;
-  uint8_t ww6;
-  uint8_t ww7;
-  uint8_t ww8;
+  uint8_t str[DEC_DIGITS_MAX];
 
-  if ( m_console == CONSOLE_AVAILABLE )
-  {
-    ww0 = (ww % 10); //Remainder of ww when divided by 10 
-    ww /= 10;       // forces ww into the range [0 429496729]
-  
-    ww1 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 42949672]
-  
-    ww2 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 4294967]
-  
-    ww3 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 429496]
-  
-    ww4 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 42949]
-  
-    ww5 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 4294]
-  
-    ww6 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 429]
-  
-    ww7 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 42]
-  
-    ww8 = (ww % 10); //Remainder of ww when divided by 10
-    ww /= 10;       // forces ww into the range [0 4]
-  
-  
-    if(ww != 0)
-    {
-      hal_uart_putchar((uint8_t)ww  + '0');   /* We may safely cast ww to the smaller type, as we have */
-                                              /* made sure (above) that its value will fit. */
-      hal_uart_putchar(ww8 + '0');
-      hal_uart_putchar(ww7 + '0');
-      hal_uart_putchar(ww6 + '0');
-      hal_uart_putchar(ww5 + '0');
-      hal_uart_putchar(ww4 + '0');
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');
-    }
-    else if (ww8 != 0)
-    {
-      hal_uart_putchar(ww8 + '0');
-      hal_uart_putchar(ww7 + '0');
-      hal_uart_putchar(ww6 + '0');
-      hal_uart_putchar(ww5 + '0');
-      hal_uart_putchar(ww4 + '0');
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');
-    }
-    else if (ww7 != 0)
-    {
-      hal_uart_putchar(ww7 + '0');
-      hal_uart_putchar(ww6 + '0');
-      hal_uart_putchar(ww5 + '0');
-      hal_uart_putchar(ww4 + '0');
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else if (ww6 != 0)
-    {
-      hal_uart_putchar(ww6 + '0');
-      hal_uart_putchar(ww5 + '0');
-      hal_uart_putchar(ww4 + '0');
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else if (ww5 != 0)
-    {
-      hal_uart_putchar(ww5 + '0');
-      hal_uart_putchar(ww4 + '0');
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else if (ww4 != 0)
-    {
-      hal_uart_putchar(ww4 + '0');
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else if (ww3 != 0)
-    {
-      hal_uart_putchar(ww3 + '0');
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else if (ww2 != 0)
-    {
-      hal_uart_putchar(ww2 + '0');
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else if (ww1 != 0)
-    {
-      hal_uart_putchar(ww1 + '0');
-      hal_uart_putchar(ww0 + '0');    
-    }
-    else
-    {
-      hal_uart_putchar(ww0 + '0');
-    }
-  }
+  (void)tx_write(str, dec_format(ww, str));
 }
 
 
 void console_put_hexnybble(uint8_t n)
 {
-  if ( m_console == CONSOLE_AVAILABLE )
-  {
-    hal_uart_putchar((uint8_t)hex_tab[n & 0x0f]);
-  }
+  console_put_char((uint8_t)hex_tab[n & 0x0f]);
 }
 
 
 void console_put_hexbyte(uint8_t b)
 {
-  console_put_hexnybble(b >> 4);
-  console_put_hexnybble(b & 0x0f);
+  uint8_t str[2];
+
+  str[0] = (uint8_t)hex_tab[b >> 4];
+  str[1] = (uint8_t)hex_tab[b & 0x0f];
+  (void)tx_write(str, sizeof(str));
 }
 
 
 void console_put_hexword(uint16_t w)
 {
-  console_put_hexbyte((uint8_t)(w >> 8));
-  console_put_hexbyte(w & 0xff);
+  uint8_t str[4];
+  uint8_t i;
+
+  for (i = 0; i < sizeof(str); i++)
+  {
+    str[i] = (uint8_t)hex_tab[(w >> (12 - 4 * i)) & 0x0f];
+  }
+  (void)tx_write(str, sizeof(str));
 }
 
 void console_put_hexbytearray(uint8_t* p, uint8_t n)
@@ -454,9 +403,9 @@ uint8_t console_get_hexnybble(void)
   uint8_t c;
   if ( m_console == CONSOLE_AVAILABLE )
   {
-    c = hal_uart_getchar();
+    c = rx_char_wait();
   #ifdef CONSOLE_ENABLE_ECHO
-    hal_uart_putchar(c);
+    console_put_char(c);
   #endif
     if (c >= '0' && c <= '9')
     {
@@ -494,11 +443,155 @@ uint16_t console_get_hexword(void)
   uint16_t bh = console_get_hexbyte();
   return (bh << 8) | console_get_hexbyte();
 }
-			   /*
+
+
 bool console_tx_completed(void)
 {
-  return hal_uart_tx_buf_empty();
+  return m_tx_completed;
+}
+
+
+/** Append a character to a formatted message, truncating it at CONSOLE_PRINTF_BUF_SIZE.
+ */
+static void fmt_put(uint8_t * buf, uint16_t * p_len, uint8_t ch)
+{
+  if (*p_len < CONSOLE_PRINTF_BUF_SIZE)
+  {
+    buf[(*p_len)++] = ch;
+  }
 }
-*/
 
 
+/** Append a field to a formatted message, padded to the given width.
+ */
+static void fmt_field_put(uint8_t *       buf,
+                          uint16_t *      p_len,
+                          uint8_t const * field,
+                          uint16_t        field_len,
+                          bool            is_negative,
+                          bool            is_zero_padded,
+                          uint8_t         width)
+{
+  uint16_t total_len = field_len + (is_negative ? 1 : 0);
+
+  if (is_negative && is_zero_padded)
+  {
+    fmt_put(buf, p_len, '-');
+  }
+  for ( ; width > total_len; width--)
+  {
+    fmt_put(buf, p_len, is_zero_padded ? '0' : ' ');
+  }
+  if (is_negative && !is_zero_padded)
+  {
+    fmt_put(buf, p_len, '-');
+  }
+  while (field_len-- > 0)
+  {
+    fmt_put(buf, p_len, *field++);
+  }
+}
+
+
+void console_printf(char const * p_format, ...)
+{
+  uint8_t  buf[CONSOLE_PRINTF_BUF_SIZE];
+  uint8_t  digits[DEC_DIGITS_MAX];
+  uint16_t len = 0;
+  va_list  args;
+
+  if ( m_console != CONSOLE_AVAILABLE )
+  {
+    return;
+  }
+
+  va_start(args, p_format);
+  while (*p_format != 0)
+  {
+    char     conv;
+    bool     is_zero_padded = false;
+    uint8_t  width          = 0;
+
+    if (*p_format != '%')
+    {
+      fmt_put(buf, &len, (uint8_t)*p_format++);
+      continue;
+    }
+    p_format++;
+
+    if (*p_format == '0')
+    {
+      is_zero_padded = true;
+      p_format++;
+    }
+    while ( (*p_format >= '0') && (*p_format <= '9') )
+    {
+      // Multiplying by ten is cheap, shifts and adds.
+      width = (uint8_t)((width << 3) + (width << 1) + (*p_format++ - '0'));
+    }
+    if (*p_format == 'l')
+    {
+      p_format++;
+    }
+
+    conv = *p_format;
+    if (conv == 0)
+    {
+      break;
+    }
+    p_format++;
+
+    switch (conv)
+    {
+      case 'd':
+      case 'i':
+      {
+        int32_t  value     = va_arg(args, int32_t);
+        uint32_t magnitude = (value < 0) ? (0u - (uint32_t)value) : (uint32_t)value;
+
+        fmt_field_put(buf, &len, digits, dec_format(magnitude, digits), (value < 0), 
+                      is_zero_padded, width);
+        break;
+      }
+
+      case 'u':
+        fmt_field_put(buf, &len, digits, dec_format(va_arg(args, uint32_t), digits), false,
+                      is_zero_padded, width);
+        break;
+
+      case 'x':
+      case 'X':
+        fmt_field_put(buf, &len, digits, 
+                      hex_format(va_arg(args, uint32_t), (conv == 'x') ? hex_tab_lower : hex_tab, digits),
+                      false, is_zero_padded, width);
+        break;
+
+      case 'c':
+        digits[0] = (uint8_t)va_arg(args, int);
+        fmt_field_put(buf, &len, digits, 1, false, false, width);
+        break;
+
+      case 's':
+      {
+        uint8_t const * str = va_arg(args, uint8_t const *);
+
+        fmt_field_put(buf, &len, str, (uint16_t)strlen((char const *)str), false, false, width);
+        break;
+      }
+
+      default:
+        // "%%", and unsupported conversions which are printed as is.
+        fmt_put(buf, &len, (uint8_t)conv);
+        break;
+    }
+  }
+  va_end(args);
+
+  (void)tx_write(buf, len);
+}
+
+
+uint32_t console_dropped_count_get(void)
+{
+  return m_dropped_count;
+}
@@ -12,6 +12,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #include "twi_master.h"
 #include "mpu6050.h"
@@ -20,10 +21,45 @@
 
 #define ADDRESS_WHO_AM_I (0x75U) //!< WHO_AM_I register identifies the device. Expected value is 0x68.
 #define ADDRESS_SIGNAL_PATH_RESET (0x68U) //!< 
+#define ADDRESS_ACCEL_CONFIG (0x1CU) //!< Accelerometer range and motion detection high pass filter.
+#define ADDRESS_MOT_THR (0x1FU) //!< Motion detection threshold.
+#define ADDRESS_MOT_DUR (0x20U) //!< Motion detection duration.
+#define ADDRESS_FIFO_EN (0x23U) //!< Selects the sensors written to the FIFO.
+#define ADDRESS_INT_PIN_CFG (0x37U) //!< INT pin polarity, drive and latching.
+#define ADDRESS_INT_ENABLE (0x38U) //!< Interrupt sources.
+#define ADDRESS_INT_STATUS (0x3AU) //!< Interrupt status, cleared on read.
+#define ADDRESS_MOT_DETECT_CTRL (0x69U) //!< Accelerometer power on delay and motion counter.
+#define ADDRESS_USER_CTRL (0x6AU) //!< FIFO enable and reset.
+#define ADDRESS_PWR_MGMT_1 (0x6BU) //!< Sleep, cycle and clock source.
+#define ADDRESS_PWR_MGMT_2 (0x6CU) //!< Wake up rate and sensor standby.
+#define ADDRESS_FIFO_COUNTH (0x72U) //!< FIFO count, high byte first.
+#define ADDRESS_FIFO_R_W (0x74U) //!< FIFO data, reads do not advance the register address.
+
+#define ACCEL_CONFIG_2G_HPF_5HZ (0x01U) //!< +-2 g, 5 Hz high pass filter in front of the motion detector.
+#define FIFO_EN_ACCEL (0x08U) //!< Accelerometer samples to the FIFO.
+#define INT_PIN_CFG_LATCH (0x20U) //!< Active high, push-pull, held until INT_STATUS is read.
+#define MOT_DETECT_CTRL_VALUE (0x15U) //!< 1 ms extra accelerometer power on delay, counters decrement by 1.
+#define USER_CTRL_FIFO_EN (0x40U) //!< FIFO enabled.
+#define USER_CTRL_FIFO_RESET (0x04U) //!< FIFO reset, clears itself.
+#define PWR_MGMT_1_CYCLE (0x20U | 0x08U) //!< Cycle between sleep and one sample, temperature sensor off, internal oscillator.
+#define PWR_MGMT_2_STBY_GYRO (0x07U) //!< Gyros in standby.
+#define PWR_MGMT_2_LP_WAKE_POS (6U) //!< Position of LP_WAKE_CTRL.
+
+#define FIFO_BURST_SAMPLES (42U) //!< Samples in a FIFO burst read, the most that fit in a 255 byte transfer.
+#define FIFO_BURSTS_MAX (((MPU6050_FIFO_SIZE / MPU6050_ACCEL_SAMPLE_SIZE) + FIFO_BURST_SAMPLES - 1) / FIFO_BURST_SAMPLES) //!< Burst reads to drain a full FIFO.
 
 static const uint8_t expected_who_am_i = 0x68U; //!< Expected value to get from WHO_AM_I register.
 static uint8_t m_device_address; //!< Device address in bits [7:1]
 
+static uint8_t m_drain_registers[] = {ADDRESS_INT_STATUS, ADDRESS_FIFO_COUNTH, ADDRESS_FIFO_R_W}; //!< Source of the register address writes of a drain.
+static twi_master_xfer_t m_drain_xfers[2 * FIFO_BURSTS_MAX]; //!< Register address write and read of each step of a drain.
+static mpu6050_fifo_handler_t m_drain_handler; //!< Handler of the running drain.
+static uint8_t * mp_drain_data; //!< Buffer of the running drain.
+static uint16_t m_drain_max_samples; //!< Number of samples that fit in the buffer.
+static uint16_t m_drain_samples; //!< Number of samples being read.
+static uint8_t m_drain_status; //!< INT_STATUS read by the running drain.
+static uint8_t m_drain_count[2]; //!< FIFO count read by the running drain.
+
 bool mpu6050_init(uint8_t device_address)
 {   
   bool transfer_succeeded = true;
@@ -78,4 +114,171 @@ bool mpu6050_register_read(uint8_t register_address, uint8_t *destination, uint8
   return transfer_succeeded;
 }
 
+bool mpu6050_motion_mode_enable(const mpu6050_motion_config_t * p_config)
+{
+  bool transfer_succeeded = true;
+
+  // Accelerometer only, awake while configuring.
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_PWR_MGMT_1, 0x00U);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_PWR_MGMT_2, PWR_MGMT_2_STBY_GYRO);
+
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_ACCEL_CONFIG, ACCEL_CONFIG_2G_HPF_5HZ);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_MOT_THR, p_config->motion_threshold);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_MOT_DUR, p_config->motion_duration_ms);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_MOT_DETECT_CTRL, MOT_DETECT_CTRL_VALUE);
+
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_INT_PIN_CFG, INT_PIN_CFG_LATCH);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_INT_ENABLE, MPU6050_INT_MOTION | MPU6050_INT_FIFO_OVERFLOW);
+
+  // Start from an empty FIFO.
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_USER_CTRL, USER_CTRL_FIFO_RESET);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_USER_CTRL, USER_CTRL_FIFO_EN);
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_FIFO_EN, FIFO_EN_ACCEL);
+
+  // Sample at the wake up rate, sleep in between.
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_PWR_MGMT_2,
+                                               (uint8_t)((p_config->wake_freq << PWR_MGMT_2_LP_WAKE_POS) | PWR_MGMT_2_STBY_GYRO));
+  transfer_succeeded &= mpu6050_register_write(ADDRESS_PWR_MGMT_1, PWR_MGMT_1_CYCLE);
+
+  return transfer_succeeded;
+}
+
+bool mpu6050_int_status_read(uint8_t * p_status)
+{
+  return mpu6050_register_read(ADDRESS_INT_STATUS, p_status, 1);
+}
+
+bool mpu6050_fifo_accel_read(uint8_t * p_data, uint16_t max_samples, uint16_t * p_sample_count)
+{
+  uint8_t  count[2];
+  uint16_t samples;
+
+  *p_sample_count = 0;
+
+  if (!mpu6050_register_read(ADDRESS_FIFO_COUNTH, count, sizeof(count)))
+  {
+    return false;
+  }
+
+  // Only whole samples, a partial one is completed by the time of the next call.
+  samples = (uint16_t)(((count[0] << 8) | count[1]) / MPU6050_ACCEL_SAMPLE_SIZE);
+  if (samples > max_samples)
+  {
+    samples = max_samples;
+  }
+
+  while (*p_sample_count < samples)
+  {
+    uint16_t burst = samples - *p_sample_count;
+
+    if (burst > FIFO_BURST_SAMPLES)
+    {
+      burst = FIFO_BURST_SAMPLES;
+    }
+    if (!mpu6050_register_read(ADDRESS_FIFO_R_W, p_data, (uint8_t)(burst * MPU6050_ACCEL_SAMPLE_SIZE)))
+    {
+      return false;
+    }
+    p_data          += burst * MPU6050_ACCEL_SAMPLE_SIZE;
+    *p_sample_count += burst;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Function for setting up a register address write and a read of the drain transfer list.
+ */
+static void drain_xfers_set(uint8_t index, uint8_t * p_register, uint8_t * p_data, uint8_t length)
+{
+  m_drain_xfers[2 * index].address                  = m_device_address;
+  m_drain_xfers[2 * index].p_data                   = p_register;
+  m_drain_xfers[2 * index].data_length              = 1;
+  m_drain_xfers[2 * index].issue_stop_condition     = TWI_DONT_ISSUE_STOP;
+
+  m_drain_xfers[2 * index + 1].address              = m_device_address | TWI_READ_BIT;
+  m_drain_xfers[2 * index + 1].p_data               = p_data;
+  m_drain_xfers[2 * index + 1].data_length          = length;
+  m_drain_xfers[2 * index + 1].issue_stop_condition = TWI_ISSUE_STOP;
+}
+
+/**
+ * @brief Function for handling the end of the FIFO burst reads, in the TWI interrupt.
+ */
+static void drain_data_handler(bool success, void * p_context)
+{
+  (void)p_context;
+
+  m_drain_handler(success, m_drain_status, success ? m_drain_samples : 0);
+}
+
+/**
+ * @brief Function for handling the end of the INT_STATUS and FIFO count reads, in the TWI interrupt.
+ *
+ * Starts the burst reads of the whole samples in the FIFO, from the same interrupt.
+ */
+static void drain_count_handler(bool success, void * p_context)
+{
+  uint16_t samples;
+  uint16_t burst;
+  uint8_t  count = 0;
+
+  (void)p_context;
+
+  if (!success)
+  {
+    m_drain_handler(false, 0, 0);
+    return;
+  }
+
+  // Only whole samples, a partial one is completed by the time of the next drain.
+  samples = (uint16_t)(((m_drain_count[0] << 8) | m_drain_count[1]) / MPU6050_ACCEL_SAMPLE_SIZE);
+  if (samples > m_drain_max_samples)
+  {
+    samples = m_drain_max_samples;
+  }
+  if (samples == 0)
+  {
+    m_drain_handler(true, m_drain_status, 0);
+    return;
+  }
+
+  // FIFO_R_W does not advance, each burst starts with the register address.
+  for (m_drain_samples = 0; m_drain_samples < samples; m_drain_samples += burst)
+  {
+    burst = samples - m_drain_samples;
+    if (burst > FIFO_BURST_SAMPLES)
+    {
+      burst = FIFO_BURST_SAMPLES;
+    }
+    drain_xfers_set(count++, &m_drain_registers[2],
+                    mp_drain_data + (m_drain_samples * MPU6050_ACCEL_SAMPLE_SIZE),
+                    (uint8_t)(burst * MPU6050_ACCEL_SAMPLE_SIZE));
+  }
+
+  if (!twi_master_xfer_list_start(m_drain_xfers, (uint8_t)(2 * count), drain_data_handler, NULL))
+  {
+    m_drain_handler(false, m_drain_status, 0);
+  }
+}
+
+bool mpu6050_fifo_drain_start(uint8_t * p_data, uint16_t max_samples, mpu6050_fifo_handler_t handler)
+{
+  if ((p_data == NULL) || (handler == NULL) || (max_samples > (MPU6050_FIFO_SIZE / MPU6050_ACCEL_SAMPLE_SIZE)))
+  {
+    return false;
+  }
+
+  m_drain_handler     = handler;
+  mp_drain_data       = p_data;
+  m_drain_max_samples = max_samples;
+  m_drain_samples     = 0;
+  m_drain_status      = 0;
+
+  drain_xfers_set(0, &m_drain_registers[0], &m_drain_status, 1);
+  drain_xfers_set(1, &m_drain_registers[1], m_drain_count, sizeof(m_drain_count));
+
+  return twi_master_xfer_list_start(m_drain_xfers, 4, drain_count_handler, NULL);
+}
+
 /*lint --flb "Leave library region" */ 
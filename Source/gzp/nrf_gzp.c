@@ -60,6 +60,26 @@ static const uint8_t gzp_secret_key[16] = GZP_SECRET_KEY;
  */
 static gzp_key_select_t gzp_key_select;
 
+#ifndef GZP_CRYPT_DISABLE
+/**
+ * Keystream block of one key selection, reused for as long as its key and
+ * session token are unchanged.
+ */
+typedef struct
+{
+    uint32_t key[4];            ///< AES key the keystream was generated with.
+    uint32_t iv[4];             ///< Init vector the keystream was generated from.
+    uint32_t keystream[5];      ///< Keystream, starting keystream_offset bytes in.
+    uint8_t keystream_offset;   ///< Alignment of the last destination buffer, so gzp_xor_cipher() can work on words.
+    bool valid;                 ///< False until the first keystream is generated.
+} gzp_keystream_cache_t;
+
+/**
+ * Keystream cache, one entry per key selection.
+ */
+static gzp_keystream_cache_t gzp_keystream_cache[GZP_DATA_EXCHANGE + 1];
+#endif
+
 
 /** @} */
 
@@ -156,6 +176,36 @@ void gzp_generate_channels(uint8_t* ch_dst, const uint8_t* system_address, uint8
     }
 }
 
+bool gzp_update_channel(uint8_t slot, uint8_t channel)
+{
+    uint8_t channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+    uint32_t channel_table_size = NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE;
+    bool update_ok;
+    bool gzll_enabled_state;
+
+    if(!nrf_gzll_get_channel_table(&channels[0], &channel_table_size))
+    {
+        return false;
+    }
+
+    // Keep the channels shared with Devices that are not paired yet
+    if((slot == 0) || (slot >= (channel_table_size - 1)) || (channel < GZP_CHANNEL_MIN) || (channel > GZP_CHANNEL_MAX))
+    {
+        return false;
+    }
+
+    channels[slot] = channel;
+
+    gzll_enabled_state = nrf_gzll_is_enabled();
+    nrf_gzp_disable_gzll();
+    update_ok = nrf_gzll_set_channel_table(&channels[0], channel_table_size);
+    if(gzll_enabled_state)
+    {
+        update_ok = nrf_gzll_enable() && update_ok;
+    }
+    return update_ok;
+}
+
 __INLINE void nrf_gzp_disable_gzll(void)
 {
     if(nrf_gzll_is_enabled())
@@ -172,14 +222,25 @@ __INLINE void nrf_gzp_disable_gzll(void)
 
 void gzp_xor_cipher(uint8_t* dst, const uint8_t* src, const uint8_t* pad, uint8_t length)
 {
-    uint8_t i;
+    uint8_t i = 0;
+
+    // Word by word if the buffers share their alignment, the Cortex-M0 faults on unaligned words
+    if(((((uint32_t)dst ^ (uint32_t)src) | ((uint32_t)dst ^ (uint32_t)pad)) & 3) == 0)
+    {
+        while((i < length) && (((uint32_t)&dst[i] & 3) != 0))
+        {
+            dst[i] = src[i] ^ pad[i];
+            i++;
+        }
+        for(; (i + 4) <= length; i += 4)
+        {
+            *(uint32_t*)&dst[i] = *(const uint32_t*)&src[i] ^ *(const uint32_t*)&pad[i];
+        }
+    }
 
-    for(i = 0; i < length; i++)
+    for(; i < length; i++)
     {
-        *dst = *src ^ *pad;
-        dst++;
-        src++;
-        pad++;
+        dst[i] = src[i] ^ pad[i];
     }
 }
 
@@ -220,9 +281,16 @@ void gzp_crypt_select_key(gzp_key_select_t key_select)
 
 void gzp_crypt(uint8_t* dst, const uint8_t* src, uint8_t length)
 {
+    static bool ecb_initialized = false;
     uint8_t i;
-    uint8_t key[16];
-    uint8_t iv[16];
+    uint32_t key_words[4];
+    uint32_t iv_words[4];
+    uint8_t* key = (uint8_t*)key_words;
+    uint8_t* iv = (uint8_t*)iv_words;
+    uint8_t offset = (uint8_t)((uint32_t)dst & 3);
+    uint8_t* keystream;
+    gzp_keystream_cache_t* p_cache;
+    nrf_ecb_job_t job;
 
     // Build AES key based on "gzp_key_select"
 
@@ -256,16 +324,43 @@ void gzp_crypt(uint8_t* dst, const uint8_t* src, uint8_t length)
         }
     }
 
-    // Set up hal_aes using new key and init vector
-    (void)nrf_ecb_init();
-    nrf_ecb_set_key(key);
-    //hal_aes_setup(false, ECB, key, NULL); // Note, here we skip the IV as we use ECB mode
+    p_cache = &gzp_keystream_cache[gzp_key_select];
+    keystream = (uint8_t*)p_cache->keystream + offset;
+
+    if(p_cache->valid &&
+       (memcmp(p_cache->key, key_words, sizeof(key_words)) == 0) &&
+       (memcmp(p_cache->iv, iv_words, sizeof(iv_words)) == 0))
+    {
+        // Same key and session token, so the same keystream. Only line it up with dst.
+        if(p_cache->keystream_offset != offset)
+        {
+            memmove(keystream, (uint8_t*)p_cache->keystream + p_cache->keystream_offset, 16);
+        }
+    }
+    else
+    {
+        if(!ecb_initialized)
+        {
+            ecb_initialized = nrf_ecb_init();
+        }
 
-    // Encrypt IV using ECB mode
-    (void)nrf_ecb_crypt(iv, iv);
+        // Encrypt IV using ECB mode, straight into the cache
+        memset(&job, 0, sizeof(job));
+        job.p_key = key;
+        job.mode = NRF_ECB_MODE_ECB;
+        job.p_in = iv;
+        job.p_out = keystream;
+        job.block_count = 1;
+        (void)nrf_ecb_job_run(&job);
+
+        memcpy(p_cache->key, key_words, sizeof(key_words));
+        memcpy(p_cache->iv, iv_words, sizeof(iv_words));
+        p_cache->valid = true;
+    }
+    p_cache->keystream_offset = offset;
 
     // Encrypt data by XOR'ing with AES output
-    gzp_xor_cipher(dst, src, iv, length);
+    gzp_xor_cipher(dst, src, keystream, length);
 
 }
 
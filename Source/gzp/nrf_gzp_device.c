@@ -53,12 +53,24 @@
 #define GZP_PARAMS_DB_ADR GZP_PARAMS_STORAGE_ADR                                    ///<
 #define GZP_PARAMS_DB_SIZE (GZP_PARAMS_DB_MAX_ENTRIES * GZP_PARAMS_DB_ELEMENT_SIZE) ///<
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+#define GZP_CHANNEL_LOG_SIZE (GZP_CHANNEL_LOG_ENTRIES * 4)                          ///< Channel update log, entries {index, slot, channel, generation}.
+#else
+#define GZP_CHANNEL_LOG_SIZE 0                                                      ///<
+#endif
+#define GZP_CHANNEL_LOG_ADR (GZP_PARAMS_STORAGE_ADR + GZP_DEVICE_PARAMS_STORAGE_SIZE - GZP_CHANNEL_LOG_SIZE) ///< At the end of the storage, word aligned.
+
+#define GZP_LAYOUT_VERSION 1                                                       ///< Version of the layout of the NV memory.
+#define GZP_LAYOUT_MARKER_SIZE 4                                                   ///<
+#define GZP_LAYOUT_MARKER_ADR (GZP_CHANNEL_LOG_ADR - GZP_LAYOUT_MARKER_SIZE)       ///< In front of the channel log.
+#define GZP_LAYOUT_MARKER (0x475A0000UL | (GZP_LAYOUT_VERSION << 8) | (GZP_CHANNEL_LOG_SIZE / 4)) ///< "GZ", layout version and number of channel log entries.
+
 #define GZP_INDEX_DB_ADR (GZP_PARAMS_STORAGE_ADR + GZP_PARAMS_DB_SIZE)             ///<
-#define GZP_INDEX_DB_SIZE (GZP_DEVICE_PARAMS_STORAGE_SIZE - GZP_PARAMS_DB_SIZE)    ///<
+#define GZP_INDEX_DB_SIZE (GZP_DEVICE_PARAMS_STORAGE_SIZE - GZP_PARAMS_DB_SIZE - GZP_LAYOUT_MARKER_SIZE - GZP_CHANNEL_LOG_SIZE) ///<
 
-#if(GZP_DEVICE_PARAMS_STORAGE_SIZE < GZP_PARAMS_DB_SIZE)
-  #error GZP_DEVICE_PARAMS_STORAGE_SIZE must be greater or equal to GZP_PAIRING_PARAMS_DB_SIZE
-#elif(GZP_DEVICE_PARAMS_STORAGE_SIZE == GZP_PARAMS_DB_SIZE )
+#if(GZP_DEVICE_PARAMS_STORAGE_SIZE < (GZP_PARAMS_DB_SIZE + GZP_LAYOUT_MARKER_SIZE + GZP_CHANNEL_LOG_SIZE))
+  #error GZP_DEVICE_PARAMS_STORAGE_SIZE must be greater or equal to GZP_PAIRING_PARAMS_DB_SIZE plus one word, plus GZP_CHANNEL_LOG_ENTRIES words with channel adaptation.
+#elif(GZP_DEVICE_PARAMS_STORAGE_SIZE == (GZP_PARAMS_DB_SIZE + GZP_LAYOUT_MARKER_SIZE + GZP_CHANNEL_LOG_SIZE))
   #warning GZP_DEVICE_PARAMS_STORAGE_SIZE to low to be able store any pairing parameters NV memory
 #endif
 /** @} */
@@ -149,6 +161,86 @@ static bool gzp_crypt_tx_transaction(const uint8_t *tx_packet, uint8_t length);
  */
 static bool gzp_key_update(void);
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+
+/**
+ * Function for clearing the channel statistics, after the channel table was
+ * generated again.
+ */
+static void gzp_channel_stats_reset(void);
+
+/**
+ * Function for updating the channel statistics after a successful transmission.
+ *
+ * Gazell starts every packet on the channel of the last successful one, and 
+ * moves on to the next channel of the table on every channel switch. All
+ * channels visited before the last one failed. 
+ * Failed packets are not counted, as the Host may be out of range.
+ *
+ * @param tx_info Information about the transmission.
+ */
+static void gzp_channel_stats_update(nrf_gzll_device_tx_info_t tx_info);
+
+/**
+ * Function for picking a channel to replace a failing one with.
+ *
+ * The channel keeps GZP_CHANNEL_SPACING_MIN from the rest of the table, and 
+ * avoids the neighbourhood of channels replaced before. 
+ *
+ * @param channels Current channel table.
+ * @param size Size of the channel table.
+ * @param slot Slot to replace.
+ *
+ * @return The new channel, or GZP_CHANNEL_NONE if there is no room.
+ */
+static uint8_t gzp_channel_pick(const uint8_t* channels, uint8_t size, uint8_t slot);
+
+/**
+ * Function for sending a pending "channel update" to the Host, and applying it 
+ * when the Host confirms.
+ *
+ * The update is made to generation channel_generation of the channel table.
+ * The Host applies it only if its table is of the same generation, and 
+ * responds with the generation after the update.
+ *
+ * Must be called right after a successful encrypted transaction, as it uses 
+ * the session token received in it. 
+ */
+static void gzp_channel_update_send(void);
+
+/**
+ * Function for reading the channel table of the Host, after another Device 
+ * updated it.
+ *
+ * Must be called right after a successful encrypted transaction, as it uses 
+ * the session token received in it. 
+ */
+static void gzp_channel_sync(void);
+
+/**
+ * Function for not using a replaced channel and its neighbourhood again.
+ *
+ * @param channel Channel replaced.
+ */
+static void gzp_channel_block(uint8_t channel);
+
+/**
+ * Function for appending a change of the channel table to the channel update
+ * log in NV memory, with the current generation.
+ *
+ * @param slot Slot that changed.
+ * @param channel New channel of the slot.
+ */
+static void gzp_channel_log_add(uint8_t slot, uint8_t channel);
+
+/**
+ * Function for applying the channel updates logged in NV memory for the 
+ * current Host, after the channel table was generated from the system address.
+ */
+static void gzp_channel_log_restore(void);
+
+#endif
+
 /**
  * Function for adding an element to "parameters data base" in non volatile (NV) memory. An element is
  * GZP_PARAMS_ELEMENT_SYSTEM_ADDRESS bytes long, holding the "system address" and  "host ID".
@@ -233,6 +325,16 @@ static bool gzp_params_store(bool store_all);
  */
 static bool gzp_params_restore(void);
 
+/**
+ * Function for bringing NV memory written with another layout to the current one.
+ *
+ * The layout is identified by the marker word in front of the channel log. 
+ * Without a marker, the "index data base" runs to the end of the storage. 
+ * The "parameters data base" and the current index are kept, the index 
+ * history and the channel log are erased.
+ */
+static void gzp_layout_update(void);
+
 /**
  * Delay function. Will add a delay equal to GZLL_RX_PERIOD * rx_periods [us].
  *
@@ -268,6 +370,18 @@ static nrf_gzll_device_tx_info_t latest_tx_info;  ///< Information about the las
 static bool tx_complete; ///< Flag to indicate whether a GZLL TX attempt has completed.
 static bool tx_success;  ///< Flag to indicate whether a GZLL TX attempt was successful.
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+static uint8_t channel_fail_rate[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE]; ///< Average failure rate of each channel table slot, in 1/256 units.
+static uint8_t channel_visits[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];    ///< Visits to each slot since it was assigned, saturating.
+static uint8_t channel_slot;                          ///< Slot of the last successful packet, where Gazell starts the next one.
+static uint32_t channel_blocked[4];                   ///< Channels not to be used again, one bit per channel.
+static volatile uint8_t channel_update_slot = GZP_CHANNEL_NONE; ///< Slot to replace, set from the Gazell callback.
+static uint8_t channel_update_channel = GZP_CHANNEL_NONE;       ///< Channel to put in channel_update_slot.
+static uint8_t channel_generation;                    ///< Generation of the channel table, the number of updates the Host applied to it.
+static uint8_t channel_host_generation;               ///< Generation of the Host channel table, from the last "encrypted user data" response.
+static bool channel_host_generation_valid;            ///< False if the Host sent no generation, it does not know "channel sync".
+#endif
+
 static const uint32_t database[GZP_DEVICE_PARAMS_STORAGE_SIZE/4] __attribute__((at(GZP_PARAMS_DB_ADR)))
 = {
 0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF, 
@@ -302,11 +416,16 @@ void gzp_init()
     gzp_id_req_pending = false;
 
 #ifndef GZP_NV_STORAGE_DISABLE
+    gzp_layout_update();
     (void)gzp_params_restore();
 #endif
 
     // Update radio parameters from gzp_system_address
     (void)gzp_update_radio_params(gzp_system_address);
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+    gzp_channel_stats_reset();
+    gzp_channel_log_restore();
+#endif
 }
 
 
@@ -314,6 +433,7 @@ void gzp_erase_pairing_data(void)
 {
     // Erase database flash page so that it can be later written to. 
     nrf_nvmc_page_erase((uint32_t)database);
+    nrf_nvmc_write_word(GZP_LAYOUT_MARKER_ADR, GZP_LAYOUT_MARKER);
 }
 
 bool gzp_address_req_send()
@@ -377,6 +497,9 @@ bool gzp_address_req_send()
                 {
                     memcpy(gzp_system_address, &rx_payload[GZP_CMD_HOST_ADDRESS_RESP_ADDRESS], GZP_SYSTEM_ADDRESS_WIDTH);
                     gzll_update_ok &= gzp_update_radio_params(&rx_payload[GZP_CMD_HOST_ADDRESS_RESP_ADDRESS]);
+                    #ifdef GZP_CHANNEL_ADAPT_ENABLE
+                    gzp_channel_stats_reset();
+                    #endif
                     #ifndef GZP_NV_STORAGE_DISABLE
                     (void)gzp_params_store(false); // "False" indicates that only "system address" part of DB element will be stored
                     #endif
@@ -504,6 +627,17 @@ bool gzp_crypt_data_send(const uint8_t *src, uint8_t length)
     {
         if(gzp_crypt_tx_transaction(src, length))
         {
+            #ifdef GZP_CHANNEL_ADAPT_ENABLE
+            // The channel table is shared by all Devices of the Host
+            if(channel_host_generation_valid && (channel_host_generation != channel_generation))
+            {
+                gzp_channel_sync();
+            }
+            else
+            {
+                gzp_channel_update_send();
+            }
+            #endif
             return true;
         }
         else
@@ -605,6 +739,10 @@ static gzp_tx_rx_trans_result_t gzp_tx_rx_transaction(const uint8_t *tx_packet,
             if(fetch_success)
             {
                 retval = GZP_TX_RX_SUCCESS;
+                if(rx_length != NULL)
+                {
+                    *rx_length = local_rx_length;
+                }
             }
             else
             {
@@ -633,6 +771,8 @@ static bool gzp_crypt_tx_transaction(const uint8_t *src, uint8_t length)
     uint8_t tx_packet[GZP_MAX_FW_PAYLOAD_LENGTH];
     uint8_t rx_packet[GZP_MAX_ACK_PAYLOAD_LENGTH];
     uint8_t tx_packet_length;
+    uint32_t rx_length = 0;
+    uint8_t crypt_length;
 
     gzp_tx_rx_trans_result_t result;
 
@@ -655,12 +795,20 @@ static bool gzp_crypt_tx_transaction(const uint8_t *src, uint8_t length)
     gzp_crypt(&tx_packet[1], &tx_packet[1], tx_packet_length - 1);
 
     // If packet was successfully sent AND a response packet was received
-    result = gzp_tx_rx_transaction(tx_packet, tx_packet_length, rx_packet, NULL, GZP_DATA_PIPE);
+    result = gzp_tx_rx_transaction(tx_packet, tx_packet_length, rx_packet, &rx_length, GZP_DATA_PIPE);
     if(result == GZP_TX_RX_SUCCESS)
     {
         if(rx_packet[0] == (uint8_t)GZP_CMD_ENCRYPTED_USER_DATA_RESP)
         {
-            gzp_crypt(&rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], &rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], GZP_VALIDATION_ID_LENGTH);
+            // Hosts without channel adaptation send no generation
+            crypt_length = GZP_VALIDATION_ID_LENGTH;
+            #ifdef GZP_CHANNEL_ADAPT_ENABLE
+            if(rx_length >= GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH)
+            {
+                crypt_length++;
+            }
+            #endif
+            gzp_crypt(&rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], &rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], crypt_length);
 
             // Validate response in order to know whether packet was correctly decrypted by host
             if(gzp_validate_id(&rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID]))
@@ -669,6 +817,10 @@ static bool gzp_crypt_tx_transaction(const uint8_t *src, uint8_t length)
                 if(!gzp_id_req_pending)
                 {
                     gzp_crypt_set_session_token(&rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_SESSION_TOKEN]);
+                    #ifdef GZP_CHANNEL_ADAPT_ENABLE
+                    channel_host_generation_valid = (crypt_length > GZP_VALIDATION_ID_LENGTH);
+                    channel_host_generation = rx_packet[GZP_CMD_ENCRYPTED_USER_DATA_RESP_GENERATION];
+                    #endif
                 }
                 return true;
             }
@@ -728,6 +880,320 @@ static bool gzp_key_update(void)
 
 #endif
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+
+static void gzp_channel_stats_reset(void)
+{
+    memset(channel_fail_rate, 0, sizeof(channel_fail_rate));
+    memset(channel_visits, 0, sizeof(channel_visits));
+    memset(channel_blocked, 0, sizeof(channel_blocked));
+    channel_slot = 0;
+    channel_update_channel = GZP_CHANNEL_NONE;
+    channel_update_slot = GZP_CHANNEL_NONE;
+    channel_generation = 0;
+    channel_host_generation_valid = false;
+}
+
+static void gzp_channel_stats_update(nrf_gzll_device_tx_info_t tx_info)
+{
+    uint32_t size = nrf_gzll_get_channel_table_size();
+    uint32_t switches = tx_info.num_channel_switches;
+    uint32_t slot;
+    uint8_t target;
+
+    if((nrf_gzll_get_device_channel_selection_policy() != NRF_GZLL_DEVICE_CHANNEL_SELECTION_POLICY_USE_SUCCESSFUL) ||
+       (size > NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE))
+    {
+        return;
+    }
+
+    channel_slot = (uint8_t)((channel_slot + switches) % size);
+
+    // Count every slot once, also if Gazell went round the table several times
+    if(switches >= size)
+    {
+        switches = size - 1;
+    }
+
+    slot = channel_slot;
+    do
+    {
+        target = (slot == channel_slot) ? 0 : 255;
+        channel_fail_rate[slot] = (uint8_t)(channel_fail_rate[slot] + ((target - channel_fail_rate[slot]) >> GZP_CHANNEL_FAIL_SHIFT));
+        if(channel_visits[slot] < 255)
+        {
+            channel_visits[slot]++;
+        }
+
+        if((channel_update_slot == GZP_CHANNEL_NONE) && 
+           (slot != 0) && (slot != (size - 1)) &&
+           (channel_visits[slot] >= GZP_CHANNEL_MIN_VISITS) &&
+           (channel_fail_rate[slot] >= GZP_CHANNEL_FAIL_THRESHOLD))
+        {
+            channel_update_slot = (uint8_t)slot;
+        }
+
+        slot = (slot + size - 1) % size;
+    } while(switches-- > 0);
+}
+
+static uint8_t gzp_channel_pick(const uint8_t* channels, uint8_t size, uint8_t slot)
+{
+    uint8_t span = (GZP_CHANNEL_MAX - GZP_CHANNEL_MIN) + 1;
+    uint8_t start, channel, i, j, pass;
+
+    gzp_random_numbers_generate(&start, 1);
+
+    // Second pass forgets the replaced channels, if they left no room
+    for(pass = 0; pass < 2; pass++)
+    {
+        for(i = 0; i < span; i++)
+        {
+            channel = GZP_CHANNEL_MIN + (uint8_t)((start + i) % span);
+            if(channel_blocked[channel >> 5] & (1UL << (channel & 31)))
+            {
+                continue;
+            }
+
+            for(j = 0; j < size; j++)
+            {
+                if((j != slot) && 
+                   (((channel > channels[j]) ? (channel - channels[j]) : (channels[j] - channel)) < GZP_CHANNEL_SPACING_MIN))
+                {
+                    break;
+                }
+            }
+            if(j == size)
+            {
+                return channel;
+            }
+        }
+        memset(channel_blocked, 0, sizeof(channel_blocked));
+    }
+    return GZP_CHANNEL_NONE;
+}
+
+static void gzp_channel_update_send(void)
+{
+    uint8_t tx_packet[GZP_CMD_CHANNEL_UPDATE_PAYLOAD_LENGTH];
+    uint8_t rx_packet[GZP_MAX_ACK_PAYLOAD_LENGTH];
+    uint8_t channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+    uint32_t channel_table_size = NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE;
+    uint8_t slot = channel_update_slot;
+
+    if((slot == GZP_CHANNEL_NONE) || gzp_id_req_pending || 
+       !nrf_gzll_get_channel_table(&channels[0], &channel_table_size))
+    {
+        return;
+    }
+
+    // Pick the channel once, so that a lost response is answered by the same update
+    if(channel_update_channel == GZP_CHANNEL_NONE)
+    {
+        channel_update_channel = gzp_channel_pick(channels, (uint8_t)channel_table_size, slot);
+        if(channel_update_channel == GZP_CHANNEL_NONE)
+        {
+            channel_update_slot = GZP_CHANNEL_NONE;
+            return;
+        }
+    }
+
+    // Build and encrypt "channel update" packet
+    tx_packet[0] = (uint8_t)GZP_CMD_CHANNEL_UPDATE;
+    gzp_add_validation_id(&tx_packet[GZP_CMD_CHANNEL_UPDATE_VALIDATION_ID]);
+    tx_packet[GZP_CMD_CHANNEL_UPDATE_GENERATION] = channel_generation;
+    tx_packet[GZP_CMD_CHANNEL_UPDATE_SLOT] = slot;
+    tx_packet[GZP_CMD_CHANNEL_UPDATE_CHANNEL] = channel_update_channel;
+
+    gzp_crypt_select_key(GZP_DATA_EXCHANGE);
+    gzp_crypt(&tx_packet[1], &tx_packet[1], GZP_CMD_CHANNEL_UPDATE_PAYLOAD_LENGTH - 1);
+
+    // Hosts without channel updates do not respond, and the table is kept
+    if(gzp_tx_rx_transaction(tx_packet, GZP_CMD_CHANNEL_UPDATE_PAYLOAD_LENGTH, rx_packet, NULL, GZP_DATA_PIPE) != GZP_TX_RX_SUCCESS)
+    {
+        return;
+    }
+    if(rx_packet[0] != (uint8_t)GZP_CMD_CHANNEL_UPDATE_RESP)
+    {
+        return;
+    }
+
+    gzp_crypt(&rx_packet[GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID], &rx_packet[GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID], GZP_VALIDATION_ID_LENGTH + 1);
+    if(!gzp_validate_id(&rx_packet[GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID]))
+    {
+        return;
+    }
+    gzp_crypt_set_session_token(&rx_packet[GZP_CMD_CHANNEL_UPDATE_RESP_SESSION_TOKEN]);
+    channel_host_generation = rx_packet[GZP_CMD_CHANNEL_UPDATE_RESP_GENERATION];
+    channel_host_generation_valid = true;
+
+    if(channel_host_generation == (uint8_t)(channel_generation + 1))
+    {
+        // The Host uses the new channel already. If the table can not be 
+        // updated here, the generation is kept and the next send syncs.
+        if(gzp_update_channel(slot, channel_update_channel))
+        {
+            gzp_channel_block(channels[slot]);
+            channel_generation = channel_host_generation;
+            gzp_channel_log_add(slot, channel_update_channel);
+        }
+    }
+
+    // Not applied if the Host table moved on, or the Host log is full. The 
+    // slot is judged again, on the table after the sync.
+    channel_fail_rate[slot] = 0;
+    channel_visits[slot] = 0;
+    channel_update_channel = GZP_CHANNEL_NONE;
+    channel_update_slot = GZP_CHANNEL_NONE;
+}
+
+static void gzp_channel_sync(void)
+{
+    uint8_t tx_packet[GZP_CMD_CHANNEL_SYNC_PAYLOAD_LENGTH];
+    uint8_t rx_packet[GZP_MAX_ACK_PAYLOAD_LENGTH];
+    uint8_t channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+    uint8_t host_channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+    uint32_t channel_table_size = NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE;
+    uint8_t generation = channel_host_generation;
+    uint8_t slot;
+    uint8_t logged_slot = GZP_CHANNEL_NONE;
+
+    if(gzp_id_req_pending || !nrf_gzll_get_channel_table(&channels[0], &channel_table_size) ||
+       (channel_table_size < 3))
+    {
+        return;
+    }
+
+    // The first and last slots are never replaced
+    for(slot = 1; slot < (channel_table_size - 1); slot++)
+    {
+        tx_packet[0] = (uint8_t)GZP_CMD_CHANNEL_SYNC;
+        gzp_add_validation_id(&tx_packet[GZP_CMD_CHANNEL_SYNC_VALIDATION_ID]);
+        tx_packet[GZP_CMD_CHANNEL_SYNC_GENERATION] = generation;
+        tx_packet[GZP_CMD_CHANNEL_SYNC_SLOT] = slot;
+
+        gzp_crypt_select_key(GZP_DATA_EXCHANGE);
+        gzp_crypt(&tx_packet[1], &tx_packet[1], GZP_CMD_CHANNEL_SYNC_PAYLOAD_LENGTH - 1);
+
+        if((gzp_tx_rx_transaction(tx_packet, GZP_CMD_CHANNEL_SYNC_PAYLOAD_LENGTH, rx_packet, NULL, GZP_DATA_PIPE) != GZP_TX_RX_SUCCESS) ||
+           (rx_packet[0] != (uint8_t)GZP_CMD_CHANNEL_SYNC_RESP))
+        {
+            return;
+        }
+
+        gzp_crypt(&rx_packet[GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID], &rx_packet[GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID], GZP_VALIDATION_ID_LENGTH + 1);
+        if(!gzp_validate_id(&rx_packet[GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID]))
+        {
+            return;
+        }
+        gzp_crypt_set_session_token(&rx_packet[GZP_CMD_CHANNEL_SYNC_RESP_SESSION_TOKEN]);
+
+        // The table changed on the way, the next "encrypted user data" 
+        // response tells the new generation
+        host_channels[slot] = rx_packet[GZP_CMD_CHANNEL_SYNC_RESP_CHANNEL];
+        if(host_channels[slot] == GZP_CHANNEL_NONE)
+        {
+            channel_host_generation_valid = false;
+            return;
+        }
+    }
+
+    for(slot = 1; slot < (channel_table_size - 1); slot++)
+    {
+        if(host_channels[slot] != channels[slot])
+        {
+            if(!gzp_update_channel(slot, host_channels[slot]))
+            {
+                return;
+            }
+            gzp_channel_block(channels[slot]);
+            channel_fail_rate[slot] = 0;
+            channel_visits[slot] = 0;
+        }
+    }
+
+    // A pending update was made to the old table
+    channel_update_channel = GZP_CHANNEL_NONE;
+    channel_update_slot = GZP_CHANNEL_NONE;
+    channel_generation = generation;
+
+    for(slot = 1; slot < (channel_table_size - 1); slot++)
+    {
+        if(host_channels[slot] != channels[slot])
+        {
+            gzp_channel_log_add(slot, host_channels[slot]);
+            logged_slot = slot;
+        }
+    }
+    // Record the generation also if no channel changed
+    if(logged_slot == GZP_CHANNEL_NONE)
+    {
+        gzp_channel_log_add(1, host_channels[1]);
+    }
+}
+
+static void gzp_channel_block(uint8_t channel)
+{
+    int16_t i;
+
+    for(i = (int16_t)channel - GZP_CHANNEL_BLOCK_WIDTH; i <= (int16_t)channel + GZP_CHANNEL_BLOCK_WIDTH; i++)
+    {
+        if((i >= 0) && (i < 128))
+        {
+            channel_blocked[i >> 5] |= (1UL << (i & 31));
+        }
+    }
+}
+
+static void gzp_channel_log_add(uint8_t slot, uint8_t channel)
+{
+#ifndef GZP_NV_STORAGE_DISABLE
+    uint8_t index = gzp_index_db_read();
+    uint16_t i;
+
+    if(index >= GZP_PARAMS_DB_MAX_ENTRIES)
+    {
+        return;
+    }
+
+    // A full log only costs a sync after the next reset
+    for(i = 0; i < GZP_CHANNEL_LOG_ENTRIES; i++)
+    {
+        if(*((uint32_t*)(GZP_CHANNEL_LOG_ADR + (i * 4))) == 0xFFFFFFFF)
+        {
+            nrf_nvmc_write_word(GZP_CHANNEL_LOG_ADR + (i * 4), 
+                                ((uint32_t)channel_generation << 24) | ((uint32_t)channel << 16) | ((uint32_t)slot << 8) | index);
+            return;
+        }
+    }
+#endif
+}
+
+static void gzp_channel_log_restore(void)
+{
+#ifndef GZP_NV_STORAGE_DISABLE
+    uint8_t index = gzp_index_db_read();
+    uint32_t entry;
+    uint16_t i;
+
+    // Entries of other Hosts are skipped, an erased word ends the log
+    for(i = 0; i < GZP_CHANNEL_LOG_ENTRIES; i++)
+    {
+        entry = *((uint32_t*)(GZP_CHANNEL_LOG_ADR + (i * 4)));
+        if(entry == 0xFFFFFFFF)
+        {
+            break;
+        }
+        if(((uint8_t)entry == index) && gzp_update_channel((uint8_t)(entry >> 8), (uint8_t)(entry >> 16)))
+        {
+            channel_generation = (uint8_t)(entry >> 24);
+        }
+    }
+#endif
+}
+
+#endif
+
 void gzp_set_host_id(const uint8_t * id)
 {
     memcpy(gzp_host_id, id, GZP_HOST_ID_LENGTH);
@@ -1023,6 +1489,54 @@ static bool gzp_params_store(bool store_all)
     return false;
 }
 
+static void gzp_layout_update(void)
+{
+    uint32_t marker = *((uint32_t*)GZP_LAYOUT_MARKER_ADR);
+    uint8_t params_db[GZP_PARAMS_DB_SIZE];
+    uint16_t index_db_size;
+    uint8_t index = 0xff;
+    uint16_t i;
+
+    if(marker == GZP_LAYOUT_MARKER)
+    {
+        return;
+    }
+
+    if(((marker >> 8) == (GZP_LAYOUT_MARKER >> 8)) &&
+       (((marker & 0xff) * 4) <= (GZP_DEVICE_PARAMS_STORAGE_SIZE - GZP_PARAMS_DB_SIZE - GZP_LAYOUT_MARKER_SIZE)))
+    {
+        // Same version with another channel log size, the index DB ends at the marker
+        index_db_size = GZP_DEVICE_PARAMS_STORAGE_SIZE - GZP_PARAMS_DB_SIZE - GZP_LAYOUT_MARKER_SIZE - ((marker & 0xff) * 4);
+    }
+    else
+    {
+        index_db_size = GZP_DEVICE_PARAMS_STORAGE_SIZE - GZP_PARAMS_DB_SIZE;
+    }
+
+    // Last written index, unless the index DB is full, see gzp_params_restore()
+    if(*(uint8_t*)(GZP_INDEX_DB_ADR + index_db_size - 1) == 0xff)
+    {
+        for(i = index_db_size; i > 0; i--)
+        {
+            index = *(uint8_t*)(GZP_INDEX_DB_ADR + i - 1);
+            if(index != 0xff)
+            {
+                index = ((index & 0xf0) != 0xf0) ? (index >> 4) : (index & 0x0f);
+                break;
+            }
+        }
+    }
+
+    memcpy(params_db, (uint8_t*)GZP_PARAMS_DB_ADR, GZP_PARAMS_DB_SIZE);
+    nrf_nvmc_page_erase(GZP_PARAMS_DB_ADR);
+    nrf_nvmc_write_bytes(GZP_PARAMS_DB_ADR, params_db, GZP_PARAMS_DB_SIZE);
+    if(index < GZP_PARAMS_DB_MAX_ENTRIES)
+    {
+        gzp_index_db_add(index);
+    }
+    nrf_nvmc_write_word(GZP_LAYOUT_MARKER_ADR, GZP_LAYOUT_MARKER);
+}
+
 static bool gzp_params_restore(void)
 {
     uint8_t i;
@@ -1063,6 +1577,13 @@ void gzp_tick_sleep_rx_periods(uint32_t rx_periods)
 void nrf_gzll_device_tx_success(uint32_t pipe, nrf_gzll_device_tx_info_t tx_info)
 {
     latest_tx_info = tx_info;
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+    // Pairing runs at reduced output power
+    if(pipe != GZP_PAIRING_PIPE)
+    {
+        gzp_channel_stats_update(tx_info);
+    }
+#endif
 
     tx_complete = true;
     tx_success = true;
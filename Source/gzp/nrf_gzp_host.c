@@ -33,6 +33,10 @@
 
 //lint -esym(40, GZP_PARAMS_STORAGE_ADR) "Undeclared identifier"
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+#define GZP_CHANNEL_LOG_ADR (GZP_PARAMS_STORAGE_ADR + ((GZP_HOST_ID_LENGTH + 2 + GZP_SYSTEM_ADDRESS_WIDTH + 3) & ~3)) ///< Channel update log, word aligned after the Host ID and the chip ID.
+#endif
+
 
 /******************************************************************************/
 /** @name Typedefs
@@ -129,6 +133,41 @@ static void gzp_process_key_update(uint8_t* rx_payload);
 static void gzp_process_encrypted_user_data(uint8_t* rx_payload, uint8_t length);
 
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+/**
+ * Function to process received Channel Update packet.
+ *
+ * Device replaces a channel of the channel table that keeps failing. The 
+ * channel table is shared by all Devices, so the Host only applies an update
+ * made to its current generation of the table. The response holds the 
+ * generation after the update, which tells the Device whether it was applied.
+ *
+ * @param rx_payload Pointer to rx_payload containing the channel update.
+ * @param length     Length of the channel update.
+ */
+static void gzp_process_channel_update(uint8_t* rx_payload, uint8_t length);
+
+
+/**
+ * Function to process received Channel Sync packet.
+ *
+ * Device that learned about a newer generation of the channel table reads 
+ * it one slot at a time. 
+ *
+ * @param rx_payload Pointer to rx_payload containing the channel sync.
+ * @param length     Length of the channel sync.
+ */
+static void gzp_process_channel_sync(uint8_t* rx_payload, uint8_t length);
+
+
+/**
+ * Function to apply the channel updates logged in NV memory, after the 
+ * channel table was generated from the system address.
+ */
+static void gzp_channel_log_restore(void);
+#endif
+
+
 /**
  * Function to preload the payload for the next ACK.
  *
@@ -217,6 +256,11 @@ static uint8_t gzp_encrypted_user_data_length;                           ///< Le
 
 static nrf_gzll_host_rx_info_t prev_gzp_rx_info = {0, 0};                ///< RSSI and status of ACK payload transmission of previous Gazell packet.
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+static uint8_t gzp_channel_generation;    ///< Number of channel updates applied to the channel table.
+static uint16_t gzp_channel_log_count;    ///< Number of entries in the channel update log.
+#endif
+
 /** @} */
 
 
@@ -234,6 +278,9 @@ void gzp_init()
 
   // Set up radio parameters (addresses and channel subset) from system_address
   (void)gzp_update_radio_params(system_address);
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+  gzp_channel_log_restore();
+#endif
 
   // Only "data pipe" enabled by default
   
@@ -318,6 +365,14 @@ void gzp_host_execute()
       case GZP_CMD_ENCRYPTED_USER_DATA:
         gzp_process_encrypted_user_data(rx_payload, payload_length);
         break;
+      #ifdef GZP_CHANNEL_ADAPT_ENABLE
+      case GZP_CMD_CHANNEL_UPDATE:
+        gzp_process_channel_update(rx_payload, payload_length);
+        break;
+      case GZP_CMD_CHANNEL_SYNC:
+        gzp_process_channel_sync(rx_payload, payload_length);
+        break;
+      #endif
 
       #endif
 
@@ -688,7 +743,11 @@ static void gzp_process_encrypted_user_data(uint8_t* rx_payload, uint8_t length)
   // Build response packet
   tx_payload[0] = (uint8_t)GZP_CMD_ENCRYPTED_USER_DATA_RESP;
   gzp_add_validation_id(&tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID]);
-  gzp_crypt(&tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], &tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], GZP_VALIDATION_ID_LENGTH);
+  #ifdef GZP_CHANNEL_ADAPT_ENABLE
+  // Devices on an older channel table catch up with "channel sync"
+  tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_GENERATION] = gzp_channel_generation;
+  #endif
+  gzp_crypt(&tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], &tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID], GZP_CMD_ENCRYPTED_USER_DATA_RESP_PAYLOAD_LENGTH - GZP_CMD_ENCRYPTED_USER_DATA_RESP_VALIDATION_ID);
   gzp_get_session_counter(&tx_payload[GZP_CMD_ENCRYPTED_USER_DATA_RESP_SESSION_TOKEN]);
 
   // Update "session token" only if no ID request is pending
@@ -702,6 +761,115 @@ static void gzp_process_encrypted_user_data(uint8_t* rx_payload, uint8_t length)
   ASSERT(nrf_gzll_get_error_code() == NRF_GZLL_ERROR_CODE_NO_ERROR);
 }
 
+#ifdef GZP_CHANNEL_ADAPT_ENABLE
+
+static void gzp_process_channel_update(uint8_t* rx_payload, uint8_t length)
+{
+  uint8_t tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_PAYLOAD_LENGTH];
+  uint8_t slot;
+  uint8_t channel;
+
+  // Only paired Devices use the data exchange key
+  if((length != GZP_CMD_CHANNEL_UPDATE_PAYLOAD_LENGTH) || gzp_id_req_received())
+  {
+    return;
+  }
+
+  gzp_crypt_select_key(GZP_DATA_EXCHANGE);
+  gzp_crypt(&rx_payload[1], &rx_payload[1], GZP_CMD_CHANNEL_UPDATE_PAYLOAD_LENGTH - 1);
+  if(!gzp_validate_id(&rx_payload[GZP_CMD_CHANNEL_UPDATE_VALIDATION_ID]))
+  {
+    return;
+  }
+
+  // An update made to an older table is not applied, the Device syncs first.
+  // With the log full the table is kept as it is.
+  slot = rx_payload[GZP_CMD_CHANNEL_UPDATE_SLOT];
+  channel = rx_payload[GZP_CMD_CHANNEL_UPDATE_CHANNEL];
+  if((rx_payload[GZP_CMD_CHANNEL_UPDATE_GENERATION] == gzp_channel_generation) && 
+     (gzp_channel_log_count < GZP_CHANNEL_LOG_ENTRIES))
+  {
+    gzll_goto_idle();
+    if(gzp_update_channel(slot, channel))
+    {
+      gzp_channel_generation++;
+      nrf_nvmc_write_word(GZP_CHANNEL_LOG_ADR + (gzp_channel_log_count * 4), 
+                          ((uint32_t)gzp_channel_generation << 16) | ((uint32_t)channel << 8) | slot);
+      gzp_channel_log_count++;
+    }
+  }
+
+  // Build response packet
+  tx_payload[0] = (uint8_t)GZP_CMD_CHANNEL_UPDATE_RESP;
+  gzp_add_validation_id(&tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID]);
+  tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_GENERATION] = gzp_channel_generation;
+  gzp_crypt(&tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID], &tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_VALIDATION_ID], GZP_VALIDATION_ID_LENGTH + 1);
+  gzp_get_session_counter(&tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_SESSION_TOKEN]);
+  gzp_crypt_set_session_token(&tx_payload[GZP_CMD_CHANNEL_UPDATE_RESP_SESSION_TOKEN]);
+
+  gzp_preload_ack(tx_payload, GZP_CMD_CHANNEL_UPDATE_RESP_PAYLOAD_LENGTH, GZP_DATA_PIPE);
+  ASSERT(nrf_gzll_get_error_code() == NRF_GZLL_ERROR_CODE_NO_ERROR);
+}
+
+static void gzp_process_channel_sync(uint8_t* rx_payload, uint8_t length)
+{
+  uint8_t tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_PAYLOAD_LENGTH];
+  uint8_t channels[NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE];
+  uint32_t channel_table_size = NRF_GZLL_CONST_MAX_CHANNEL_TABLE_SIZE;
+
+  // Only paired Devices use the data exchange key
+  if((length != GZP_CMD_CHANNEL_SYNC_PAYLOAD_LENGTH) || gzp_id_req_received())
+  {
+    return;
+  }
+
+  gzp_crypt_select_key(GZP_DATA_EXCHANGE);
+  gzp_crypt(&rx_payload[1], &rx_payload[1], GZP_CMD_CHANNEL_SYNC_PAYLOAD_LENGTH - 1);
+  if(!gzp_validate_id(&rx_payload[GZP_CMD_CHANNEL_SYNC_VALIDATION_ID]))
+  {
+    return;
+  }
+
+  // The Device starts over if the table changed while it was reading it
+  tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_CHANNEL] = GZP_CHANNEL_NONE;
+  if((rx_payload[GZP_CMD_CHANNEL_SYNC_GENERATION] == gzp_channel_generation) &&
+     nrf_gzll_get_channel_table(&channels[0], &channel_table_size) &&
+     (rx_payload[GZP_CMD_CHANNEL_SYNC_SLOT] < channel_table_size))
+  {
+    tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_CHANNEL] = channels[rx_payload[GZP_CMD_CHANNEL_SYNC_SLOT]];
+  }
+
+  // Build response packet
+  tx_payload[0] = (uint8_t)GZP_CMD_CHANNEL_SYNC_RESP;
+  gzp_add_validation_id(&tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID]);
+  gzp_crypt(&tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID], &tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_VALIDATION_ID], GZP_VALIDATION_ID_LENGTH + 1);
+  gzp_get_session_counter(&tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_SESSION_TOKEN]);
+  gzp_crypt_set_session_token(&tx_payload[GZP_CMD_CHANNEL_SYNC_RESP_SESSION_TOKEN]);
+
+  gzp_preload_ack(tx_payload, GZP_CMD_CHANNEL_SYNC_RESP_PAYLOAD_LENGTH, GZP_DATA_PIPE);
+  ASSERT(nrf_gzll_get_error_code() == NRF_GZLL_ERROR_CODE_NO_ERROR);
+}
+
+static void gzp_channel_log_restore(void)
+{
+  uint32_t entry;
+
+  gzp_channel_generation = 0;
+  for(gzp_channel_log_count = 0; gzp_channel_log_count < GZP_CHANNEL_LOG_ENTRIES; gzp_channel_log_count++)
+  {
+    // Entries are {slot, channel, generation, 0x00}, an erased word ends the log
+    entry = *((uint32_t*)(GZP_CHANNEL_LOG_ADR + (gzp_channel_log_count * 4)));
+    if((entry >> 24) != 0x00)
+    {
+      break;
+    }
+    (void)gzp_update_channel((uint8_t)entry, (uint8_t)(entry >> 8));
+    gzp_channel_generation = (uint8_t)(entry >> 16);
+  }
+}
+
+#endif
+
 //-----------------------------------------------------------------------------
 // Function added during LE1 -> nRF51 port
 //-----------------------------------------------------------------------------
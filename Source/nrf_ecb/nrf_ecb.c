@@ -2,16 +2,16 @@
 *
 * The information contained herein is property of Nordic Semiconductor ASA.
 * Terms and conditions of usage are described in detail in NORDIC
-* SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT. 
+* SEMICONDUCTOR STANDARD SOFTWARE LICENSE AGREEMENT.
 *
 * Licensees are granted free, non-transferable use of the information. NO
 * WARRANTY of ANY KIND is provided. This heading must NOT be removed from
 * the file.
 *
 * $LastChangedRevision: 25419 $
-*/ 
+*/
 
-/** 
+/**
  * @file
  * @brief Implementation of AES ECB driver
  */
@@ -22,53 +22,456 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
-#include "nrf.h" 
+#include "nrf.h"
 #include "nrf_ecb.h"
 
-static uint8_t  ecb_data[48];   ///< ECB data structure for RNG peripheral to access.
-static uint8_t* ecb_key;        ///< Key:        Starts at ecb_data 
-static uint8_t* ecb_cleartext;  ///< Cleartext:  Starts at ecb_data + 16 bytes.
-static uint8_t* ecb_ciphertext; ///< Ciphertext: Starts at ecb_data + 32 bytes.
+#if defined(BLE_STACK_SUPPORT_REQD) || defined(ANT_STACK_SUPPORT_REQD)
+#include "nrf_soc.h"
+
+// The SoftDevice restricts the ECB peripheral, blocks go through sd_ecb_block_encrypt() from a
+// software interrupt instead, see nrf_ecb.h.
+#define ECB_SOFTDEVICE
+#define ECB_IRQn              SWI3_IRQn     ///< Software interrupt running the jobs.
+#define ECB_IRQ_HANDLER       SWI3_IRQHandler
+#else
+#define ECB_IRQ_HANDLER       ECB_IRQHandler
+#endif
+
+static uint32_t        ecb_data[12];    ///< ECB data structure for ECB peripheral to access, word aligned. Same layout as nrf_ecb_hal_data_t.
+static uint8_t *       ecb_key;         ///< Key:        Starts at ecb_data
+static uint8_t *       ecb_cleartext;   ///< Cleartext:  Starts at ecb_data + 16 bytes.
+static uint8_t *       ecb_ciphertext;  ///< Ciphertext: Starts at ecb_data + 32 bytes.
+static uint8_t         crypt_key[16];   ///< Key of nrf_ecb_crypt().
+static nrf_ecb_job_t * job_head;        ///< Job being run, NULL if none.
+static nrf_ecb_job_t * job_tail;        ///< Last queued job.
+
+/**
+ * Start encrypting the current block of a job.
+ *
+ * The ciphertext of the previous block is still in place, which chains the
+ * CBC-MAC.
+ */
+static void block_start(nrf_ecb_job_t * p_job)
+{
+  uint32_t        offset = p_job->block * NRF_ECB_BLOCK_SIZE;
+  const uint8_t * p_prev;
+  uint32_t        i;
+
+  switch (p_job->mode)
+  {
+    case NRF_ECB_MODE_CTR:
+      memcpy(ecb_cleartext, p_job->p_chain, NRF_ECB_BLOCK_SIZE);
+      break;
+
+    case NRF_ECB_MODE_CBC_MAC:
+      p_prev = (p_job->block == 0) ? p_job->p_chain : ecb_ciphertext;
+      for (i = 0; i < NRF_ECB_BLOCK_SIZE; i++)
+      {
+        ecb_cleartext[i] = p_job->p_in[offset + i] ^ p_prev[i];
+      }
+      break;
+
+    default:
+      memcpy(ecb_cleartext, &p_job->p_in[offset], NRF_ECB_BLOCK_SIZE);
+      break;
+  }
+
+#ifdef ECB_SOFTDEVICE
+  (void)sd_nvic_SetPendingIRQ(ECB_IRQn);
+#else
+  NRF_ECB->TASKS_STARTECB = 1;
+#endif
+}
+
+/**
+ * Start the first block of a job.
+ */
+static void job_start(nrf_ecb_job_t * p_job)
+{
+  memcpy(ecb_key, p_job->p_key, NRF_ECB_BLOCK_SIZE);
+  block_start(p_job);
+}
+
+/**
+ * Increment a 128 bit big endian counter.
+ */
+static void counter_increment(uint8_t * p_counter)
+{
+  uint32_t i = NRF_ECB_BLOCK_SIZE;
+
+  while ((i > 0) && (++p_counter[--i] == 0))
+  {
+    // Carry into the next byte.
+  }
+}
+
+/**
+ * Store the result of the current block of a job.
+ */
+static void block_end(nrf_ecb_job_t * p_job)
+{
+  uint32_t offset = p_job->block * NRF_ECB_BLOCK_SIZE;
+  uint32_t i;
+
+  switch (p_job->mode)
+  {
+    case NRF_ECB_MODE_CTR:
+      for (i = 0; i < NRF_ECB_BLOCK_SIZE; i++)
+      {
+        p_job->p_out[offset + i] = ecb_ciphertext[i] ^
+                                   ((p_job->p_in != NULL) ? p_job->p_in[offset + i] : 0);
+      }
+      counter_increment(p_job->p_chain);
+      break;
+
+    case NRF_ECB_MODE_CBC_MAC:
+      if ((p_job->block + 1) == p_job->block_count)
+      {
+        memcpy(p_job->p_out, ecb_ciphertext, NRF_ECB_BLOCK_SIZE);
+      }
+      break;
+
+    default:
+      memcpy(&p_job->p_out[offset], ecb_ciphertext, NRF_ECB_BLOCK_SIZE);
+      break;
+  }
+}
+
+/**
+ * Store the block which is done, and start the next one.
+ */
+static void block_done(void)
+{
+  nrf_ecb_job_t * p_job = job_head;
+
+  if (p_job == NULL)
+  {
+    return;
+  }
+
+  block_end(p_job);
+  if (++p_job->block < p_job->block_count)
+  {
+    block_start(p_job);
+    return;
+  }
+
+  // Start the next job before calling the handler, to keep the peripheral busy.
+  job_head = p_job->p_next;
+  if (job_head != NULL)
+  {
+    job_start(job_head);
+  }
+
+  p_job->done = true;
+  if (p_job->handler != NULL)
+  {
+    p_job->handler(p_job);
+  }
+}
+
+#ifdef ECB_SOFTDEVICE
+/**
+ * Encrypt the current block through the SoftDevice, which blocks until done.
+ *
+ * Called from the software interrupt, or from nrf_ecb_job_run() when it blocks
+ * the interrupt.
+ */
+static void ecb_event_process(void)
+{
+  if (job_head != NULL)
+  {
+    // Only fails for a pointer outside RAM.
+    (void)sd_ecb_block_encrypt((nrf_ecb_hal_data_t *)ecb_data);
+    block_done();
+  }
+}
+
+/**
+ * Take the pending interrupt, from the priority of the interrupt or above.
+ */
+static bool ecb_irq_pending_take(void)
+{
+  uint32_t is_pending = 0;
+
+  (void)sd_nvic_GetPendingIRQ(ECB_IRQn, &is_pending);
+  if (is_pending != 0)
+  {
+    (void)sd_nvic_ClearPendingIRQ(ECB_IRQn);
+  }
+  return (is_pending != 0);
+}
+
+static uint32_t ecb_critical_region_enter(void)
+{
+  uint8_t is_nested = 0;
+
+  (void)sd_nvic_critical_region_enter(&is_nested);
+  return is_nested;
+}
+
+static void ecb_critical_region_exit(uint32_t is_nested)
+{
+  (void)sd_nvic_critical_region_exit((uint8_t)is_nested);
+}
+
+static void ecb_wait(void)
+{
+  // Returns at once if an interrupt has been taken since the previous call.
+  (void)sd_app_evt_wait();
+}
+#else
+/**
+ * Handle the ECB events.
+ *
+ * Called from the ECB interrupt, or from nrf_ecb_job_run() when it blocks the
+ * interrupt.
+ */
+static void ecb_event_process(void)
+{
+  if (NRF_ECB->EVENTS_ERRORECB != 0)
+  {
+    // Aborted by the CCM or AAR, the block is still in place, so just restart.
+    NRF_ECB->EVENTS_ERRORECB = 0;
+    if (job_head != NULL)
+    {
+      NRF_ECB->TASKS_STARTECB = 1;
+    }
+    return;
+  }
+  if (NRF_ECB->EVENTS_ENDECB == 0)
+  {
+    return;
+  }
+  NRF_ECB->EVENTS_ENDECB = 0;
+
+  block_done();
+}
+
+/**
+ * Take the pending interrupt, from the priority of the interrupt or above.
+ */
+static bool ecb_irq_pending_take(void)
+{
+  if (NVIC_GetPendingIRQ(ECB_IRQn) == 0)
+  {
+    return false;
+  }
+  NVIC_ClearPendingIRQ(ECB_IRQn);
+  return true;
+}
+
+static uint32_t ecb_critical_region_enter(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+static void ecb_critical_region_exit(uint32_t primask)
+{
+  __set_PRIMASK(primask);
+}
+
+static void ecb_wait(void)
+{
+  // Wake up on the ECB interrupt becoming pending, also if the caller blocks it.
+  SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+  __WFE();
+}
+#endif
+
+void ECB_IRQ_HANDLER(void)
+{
+  ecb_event_process();
+}
 
 bool nrf_ecb_init(void)
 {
-  ecb_key = ecb_data;
-  ecb_cleartext  = ecb_data + 16;
-  ecb_ciphertext = ecb_data + 32;
+  ecb_key        = (uint8_t *)&ecb_data[0];
+  ecb_cleartext  = (uint8_t *)&ecb_data[4];
+  ecb_ciphertext = (uint8_t *)&ecb_data[8];
+  job_head       = NULL;
+  job_tail       = NULL;
+
+#ifdef ECB_SOFTDEVICE
+  return (sd_nvic_ClearPendingIRQ(ECB_IRQn) == NRF_SUCCESS) &&
+         (sd_nvic_SetPriority(ECB_IRQn, (nrf_app_irq_priority_t)NRF_ECB_IRQ_PRIORITY) == NRF_SUCCESS) &&
+         (sd_nvic_EnableIRQ(ECB_IRQn) == NRF_SUCCESS);
+#else
+  NRF_ECB->ECBDATAPTR      = (uint32_t)ecb_data;
+  NRF_ECB->EVENTS_ENDECB   = 0;
+  NRF_ECB->EVENTS_ERRORECB = 0;
+  NRF_ECB->INTENSET        = ECB_INTENSET_ENDECB_Msk | ECB_INTENSET_ERRORECB_Msk;
 
-  NRF_ECB->ECBDATAPTR = (uint32_t)ecb_data;
+  NVIC_ClearPendingIRQ(ECB_IRQn);
+  NVIC_SetPriority(ECB_IRQn, NRF_ECB_IRQ_PRIORITY);
+  NVIC_EnableIRQ(ECB_IRQn);
   return true;
+#endif
 }
 
+bool nrf_ecb_job_submit(nrf_ecb_job_t * p_job)
+{
+  uint32_t region;
 
-bool nrf_ecb_crypt(uint8_t * dest_buf, const uint8_t * src_buf)
+  if ((ecb_key == NULL) || (p_job->block_count == 0) ||
+      ((p_job->mode != NRF_ECB_MODE_ECB) && (p_job->p_chain == NULL)))
+  {
+    return false;
+  }
+
+  p_job->block  = 0;
+  p_job->done   = false;
+  p_job->p_next = NULL;
+
+  // The queue is also changed from the ECB interrupt.
+  region = ecb_critical_region_enter();
+  if (job_head == NULL)
+  {
+    job_head = p_job;
+    job_start(p_job);
+  }
+  else
+  {
+    job_tail->p_next = p_job;
+  }
+  job_tail = p_job;
+  ecb_critical_region_exit(region);
+
+  return true;
+}
+
+bool nrf_ecb_job_run(nrf_ecb_job_t * p_job)
 {
-   uint32_t counter = 0x1000000;
-   if(src_buf != ecb_cleartext)
-   {
-     memcpy(ecb_cleartext,src_buf,16);
-   }
-   NRF_ECB->EVENTS_ENDECB = 0;
-   NRF_ECB->TASKS_STARTECB = 1;
-   while(NRF_ECB->EVENTS_ENDECB == 0)
-   {
-    counter--;
-    if(counter == 0)
+  uint32_t region;
+
+  if (!nrf_ecb_job_submit(p_job))
+  {
+    return false;
+  }
+
+  while (!p_job->done)
+  {
+    region = ecb_critical_region_enter();
+    if (ecb_irq_pending_take())
     {
-      return false;
+      // Called from the ECB priority or above, so handle the events here.
+      ecb_event_process();
     }
-   }
-   NRF_ECB->EVENTS_ENDECB = 0;
-   if(dest_buf != ecb_ciphertext)
-   {
-     memcpy(dest_buf,ecb_ciphertext,16);
-   }
-   return true;
+    ecb_critical_region_exit(region);
+
+    if (!p_job->done)
+    {
+      ecb_wait();
+    }
+  }
+  return true;
+}
+
+bool nrf_ecb_crypt(uint8_t * dest_buf, const uint8_t * src_buf)
+{
+  nrf_ecb_job_t job;
+
+  memset(&job, 0, sizeof(job));
+  job.p_key       = crypt_key;
+  job.mode        = NRF_ECB_MODE_ECB;
+  job.p_in        = src_buf;
+  job.p_out       = dest_buf;
+  job.block_count = 1;
+
+  return nrf_ecb_job_run(&job);
 }
 
 void nrf_ecb_set_key(const uint8_t * key)
 {
-  memcpy(ecb_key,key,16);
+  memcpy(crypt_key, key, 16);
 }
 
+/**
+ * Derive the next CMAC subkey: shift left by one bit, and reduce.
+ */
+static void cmac_subkey_double(uint8_t * p_subkey)
+{
+  uint8_t  msb = p_subkey[0] & 0x80;
+  uint32_t i;
+
+  for (i = 0; i < (NRF_ECB_BLOCK_SIZE - 1); i++)
+  {
+    p_subkey[i] = (uint8_t)((p_subkey[i] << 1) | (p_subkey[i + 1] >> 7));
+  }
+  p_subkey[NRF_ECB_BLOCK_SIZE - 1] <<= 1;
+
+  if (msb != 0)
+  {
+    p_subkey[NRF_ECB_BLOCK_SIZE - 1] ^= 0x87;
+  }
+}
 
+bool nrf_ecb_cmac(const uint8_t * p_key, const uint8_t * p_msg, uint32_t len, uint8_t * p_mac)
+{
+  nrf_ecb_job_t job;
+  uint8_t       subkey[NRF_ECB_BLOCK_SIZE];
+  uint8_t       chain[NRF_ECB_BLOCK_SIZE];
+  uint8_t       last[NRF_ECB_BLOCK_SIZE];
+  uint32_t      block_count = (len + NRF_ECB_BLOCK_SIZE - 1) / NRF_ECB_BLOCK_SIZE;
+  uint32_t      last_len;
+  uint32_t      i;
+
+  if (block_count == 0)
+  {
+    block_count = 1;
+  }
+  last_len = len - ((block_count - 1) * NRF_ECB_BLOCK_SIZE);
+
+  // Subkey K1 for a complete last block, K2 for a padded one.
+  memset(chain, 0, sizeof(chain));
+  memset(&job, 0, sizeof(job));
+  job.p_key       = p_key;
+  job.mode        = NRF_ECB_MODE_ECB;
+  job.p_in        = chain;
+  job.p_out       = subkey;
+  job.block_count = 1;
+  if (!nrf_ecb_job_run(&job))
+  {
+    return false;
+  }
+  cmac_subkey_double(subkey);
+  if (last_len != NRF_ECB_BLOCK_SIZE)
+  {
+    cmac_subkey_double(subkey);
+  }
+
+  // All blocks but the last are chained in one batch, from the zero IV.
+  job.mode    = NRF_ECB_MODE_CBC_MAC;
+  job.p_chain = chain;
+  if (block_count > 1)
+  {
+    job.p_in        = p_msg;
+    job.p_out       = chain;
+    job.block_count = (uint16_t)(block_count - 1);
+    if (!nrf_ecb_job_run(&job))
+    {
+      return false;
+    }
+  }
+
+  for (i = 0; i < NRF_ECB_BLOCK_SIZE; i++)
+  {
+    if (i < last_len)
+    {
+      last[i] = p_msg[((block_count - 1) * NRF_ECB_BLOCK_SIZE) + i];
+    }
+    else
+    {
+      last[i] = (i == last_len) ? 0x80 : 0x00;
+    }
+    last[i] ^= subkey[i];
+  }
+
+  job.p_in        = last;
+  job.p_out       = p_mac;
+  job.block_count = 1;
+  return nrf_ecb_job_run(&job);
+}
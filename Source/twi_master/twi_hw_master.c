@@ -14,6 +14,7 @@
 #include "twi_master_config.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "nrf.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
@@ -22,6 +23,22 @@
  * This is optimized way instead of using timers, this is not power aware. */
 #define MAX_TIMEOUT_LOOPS             (20000UL)        /**< MAX while loops to wait for RXD/TXD event */
 
+#define XFER_LIST_INT_MASK            (TWI_INTENSET_STOPPED_Msk  | \
+                                       TWI_INTENSET_RXDREADY_Msk | \
+                                       TWI_INTENSET_TXDSENT_Msk  | \
+                                       TWI_INTENSET_ERROR_Msk)  /**< Events handled by the transfer list interrupt. */
+
+static const twi_master_xfer_t * mp_xfers;        /**< Running transfer list, NULL if none. */
+static uint8_t                   m_xfer_count;    /**< Number of transfers in the list. */
+static uint8_t                   m_xfer_index;    /**< Transfer being run. */
+static uint8_t *                 mp_xfer_data;    /**< Next byte of the transfer. */
+static uint8_t                   m_xfer_left;     /**< Bytes left of the transfer. */
+static twi_master_xfer_handler_t m_xfer_handler;  /**< Completion handler of the list. */
+static void *                    mp_xfer_context; /**< Context of the completion handler. */
+static volatile bool             m_recover_pending; /**< A list failed or was aborted, the bus is recovered before the next transfer. */
+
+static void twi_master_recover(void);
+
 static bool twi_master_write(uint8_t *data, uint8_t data_length, bool issue_stop_condition)
 {
     uint32_t timeout = MAX_TIMEOUT_LOOPS;   /* max loops to wait for EVENTS_TXDSENT event*/
@@ -285,7 +302,12 @@ bool twi_master_transfer(uint8_t   address,
                          bool      issue_stop_condition)
 {
     bool transfer_succeeded = false;
-    if (data_length > 0 && twi_master_clear_bus())
+    if (data_length > 0 && mp_xfers == NULL && m_recover_pending)
+    {
+        // A transfer list failed or was aborted.
+        twi_master_recover();
+    }
+    if (data_length > 0 && mp_xfers == NULL && twi_master_clear_bus())
     {
         NRF_TWI1->ADDRESS = (address >> 1);
 
@@ -301,4 +323,227 @@ bool twi_master_transfer(uint8_t   address,
     return transfer_succeeded;
 }
 
+/** @brief Function for stopping the peripheral after an error or a stuck transfer of a list.
+ *
+ * @details Safe in the TWI interrupt, the pins are released at once. The recovery, which waits
+ *          and clocks the bus by software, is left to the next transfer.
+ */
+static void twi_master_halt(void)
+{
+    NRF_TWI1->INTENCLR     = XFER_LIST_INT_MASK;
+    NRF_PPI->CHENCLR       = PPI_CHENCLR_CH0_Msk;
+    NRF_TWI1->EVENTS_ERROR = 0;
+    NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Disabled << TWI_ENABLE_ENABLE_Pos;
+    m_recover_pending      = true;
+}
+
+
+/** @brief Function for resetting the peripheral and clearing the bus after @ref twi_master_halt.
+ */
+static void twi_master_recover(void)
+{
+    m_recover_pending = false;
+
+    // Recover the peripheral as indicated by PAN 56: "TWI: TWI module lock-up.", as the polled
+    // transfers do.
+    NRF_TWI1->POWER  = 0; 
+    nrf_delay_us(5); 
+    NRF_TWI1->POWER  = 1; 
+    NRF_TWI1->ENABLE = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
+
+    (void)twi_master_init();
+}
+
+
+/** @brief Function for starting the current transfer of the list.
+ */
+static void xfer_start(void)
+{
+    const twi_master_xfer_t * p_xfer = &mp_xfers[m_xfer_index];
+
+    mp_xfer_data      = p_xfer->p_data;
+    m_xfer_left       = p_xfer->data_length;
+    NRF_TWI1->ADDRESS = (p_xfer->address >> 1);
+
+    if (p_xfer->address & TWI_READ_BIT)
+    {
+        // Suspend after each byte until it is read, stop after the last one.
+        NRF_PPI->CH[0].TEP = (m_xfer_left == 1) ? (uint32_t)&NRF_TWI1->TASKS_STOP
+                                                : (uint32_t)&NRF_TWI1->TASKS_SUSPEND;
+        NRF_PPI->CHENSET        = PPI_CHENSET_CH0_Msk;
+        NRF_TWI1->TASKS_STARTRX = 1;
+    }
+    else
+    {
+        NRF_PPI->CHENCLR        = PPI_CHENCLR_CH0_Msk;
+        NRF_TWI1->TXD           = *mp_xfer_data++;
+        m_xfer_left--;
+        NRF_TWI1->TASKS_STARTTX = 1;
+    }
+}
+
+
+/** @brief Function for ending the list, and calling its handler.
+ */
+static void xfer_list_end(bool success)
+{
+    twi_master_xfer_handler_t handler = m_xfer_handler;
+
+    NRF_TWI1->INTENCLR = XFER_LIST_INT_MASK;
+    NRF_PPI->CHENCLR   = PPI_CHENCLR_CH0_Msk;
+    mp_xfers           = NULL;
+
+    // The handler may start the next list.
+    handler(success, mp_xfer_context);
+}
+
+
+/** @brief Function for moving on to the next transfer of the list.
+ */
+static void xfer_next(void)
+{
+    if (++m_xfer_index < m_xfer_count)
+    {
+        xfer_start();
+    }
+    else
+    {
+        xfer_list_end(true);
+    }
+}
+
+
+bool twi_master_xfer_list_start(const twi_master_xfer_t * p_xfers,
+                                uint8_t                   count,
+                                twi_master_xfer_handler_t handler,
+                                void *                    p_context)
+{
+    uint8_t i;
+
+    if (mp_xfers != NULL || count == 0 || handler == NULL)
+    {
+        return false;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (p_xfers[i].data_length == 0)
+        {
+            return false;
+        }
+    }
+    // The bus would stay held after the list.
+    if (((p_xfers[count - 1].address & TWI_READ_BIT) == 0) &&
+        !p_xfers[count - 1].issue_stop_condition)
+    {
+        return false;
+    }
+    if (m_recover_pending)
+    {
+        twi_master_recover();
+    }
+    if (!twi_master_clear_bus())
+    {
+        return false;
+    }
+
+    mp_xfers        = p_xfers;
+    m_xfer_count    = count;
+    m_xfer_index    = 0;
+    m_xfer_handler  = handler;
+    mp_xfer_context = p_context;
+
+    NRF_TWI1->EVENTS_STOPPED  = 0;
+    NRF_TWI1->EVENTS_RXDREADY = 0;
+    NRF_TWI1->EVENTS_TXDSENT  = 0;
+    NRF_TWI1->EVENTS_ERROR    = 0;
+    NRF_TWI1->INTENSET        = XFER_LIST_INT_MASK;
+
+    NVIC_ClearPendingIRQ(SPI1_TWI1_IRQn);
+    NVIC_SetPriority(SPI1_TWI1_IRQn, TWI_MASTER_IRQ_PRIORITY);
+    NVIC_EnableIRQ(SPI1_TWI1_IRQn);
+
+    xfer_start();
+    return true;
+}
+
+
+bool twi_master_xfer_list_busy(void)
+{
+    return (mp_xfers != NULL);
+}
+
+
+void twi_master_xfer_list_abort(void)
+{
+    if (mp_xfers != NULL)
+    {
+        mp_xfers = NULL;
+        twi_master_halt();
+    }
+}
+
+
+/** @brief Function for handling the TWI interrupt of a transfer list.
+ *
+ * @details The vector is shared with SPI1 and SPIS1, see twi_master.h.
+ */
+void SPI1_TWI1_IRQHandler(void)
+{
+    if (mp_xfers == NULL)
+    {
+        return;
+    }
+
+    if (NRF_TWI1->EVENTS_ERROR != 0)
+    {
+        // NACK or overrun, the rest of the list is dropped.
+        twi_master_halt();
+        xfer_list_end(false);
+        return;
+    }
+
+    if (NRF_TWI1->EVENTS_TXDSENT != 0)
+    {
+        NRF_TWI1->EVENTS_TXDSENT = 0;
+        if (m_xfer_left > 0)
+        {
+            NRF_TWI1->TXD = *mp_xfer_data++;
+            m_xfer_left--;
+        }
+        else if (mp_xfers[m_xfer_index].issue_stop_condition)
+        {
+            NRF_TWI1->TASKS_STOP = 1;
+        }
+        else
+        {
+            // Repeated start.
+            xfer_next();
+            return;
+        }
+    }
+
+    if (NRF_TWI1->EVENTS_RXDREADY != 0)
+    {
+        NRF_TWI1->EVENTS_RXDREADY = 0;
+        *mp_xfer_data++ = NRF_TWI1->RXD;
+
+        if (--m_xfer_left == 1)
+        {
+            NRF_PPI->CH[0].TEP = (uint32_t)&NRF_TWI1->TASKS_STOP;
+        }
+        if (m_xfer_left > 0)
+        {
+            // Same delay as the polled read, see PAN 56.
+            nrf_delay_us(20);
+            NRF_TWI1->TASKS_RESUME = 1;
+        }
+    }
+
+    if (NRF_TWI1->EVENTS_STOPPED != 0)
+    {
+        NRF_TWI1->EVENTS_STOPPED = 0;
+        xfer_next();
+    }
+}
+
 /*lint --flb "Leave library region" */